@@ -0,0 +1,126 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Benchmark: MED_session_stats_exec, run from the command line through its mexFunction() with the stub mx API (mx_shim.c)
+// Sweeps channel counts & returned sections ("none": session only, "channels": + channels, "all": + channels, contigua, & records).
+// No samples are returned, so rows report latency percentiles & peak resident memory (samples/s & MB/s are zero).
+
+//************************************************************************************************************************* Compile Line **************************************************************************************************************************//
+//****  cc -O3 -DMATLAB_m12 -I. -I.. MED_session_stats_bench.c bench_util.c mx_shim.c ../MED_session_stats_exec.c ../stage_timing.c ../session_manifest.c ../record_journal.c ../record_merge.c ../medlib_m12.c ../medrec_m12.c ../dhnlib_m12.c -lm -lpthread  ****//
+//*****************************************************************************************************************************************************************************************************************************************************************//
+//	usage: MED_session_stats_bench session_directory [--channels 1,4,16] [--returns none,channels,all] [--reps 10] [--password password] [--csv file]
+
+
+#include "bench_util.h"
+
+
+si4	main(si4 argc, si1 **argv)
+{
+	si1		*session_dir, *password, *csv_path, **chan_paths, **chan_list, **ret_list;
+	si4		i, c, v, n_avail, n_chans, n_ch_items, n_ret_items, reps, r;
+	sf8		t0;
+	mxLogical	ret_chans, ret_other;
+	FILE		*csv_fp;
+	mxArray		*plhs[1];
+	const mxArray	*prhs[6];
+	BENCH_RESULT	result;
+
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s session_directory [--channels 1,4,16] [--returns none,channels,all] [--reps 10] [--password password] [--csv file]\n", argv[0]);
+		return(1);
+	}
+
+	// defaults
+	session_dir = argv[1];
+	n_ch_items = bench_parse_list("1,4,16", &chan_list);
+	n_ret_items = bench_parse_list("none,channels,all", &ret_list);
+	reps = BENCH_DEFAULT_REPS;
+	password = csv_path = NULL;
+
+	// options
+	for (i = 2; i < argc; ++i) {
+		if (i + 1 == argc) {
+			fprintf(stderr, "%s needs a value\n", argv[i]);
+			return(1);
+		}
+		if (strcmp(argv[i], "--channels") == 0) {
+			bench_free_list(chan_list, n_ch_items);
+			n_ch_items = bench_parse_list(argv[++i], &chan_list);
+		} else if (strcmp(argv[i], "--returns") == 0) {
+			bench_free_list(ret_list, n_ret_items);
+			n_ret_items = bench_parse_list(argv[++i], &ret_list);
+		} else if (strcmp(argv[i], "--reps") == 0) {
+			reps = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--password") == 0) {
+			password = argv[++i];
+		} else if (strcmp(argv[i], "--csv") == 0) {
+			csv_path = argv[++i];
+		} else {
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return(1);
+		}
+	}
+	if (reps < 1)
+		reps = 1;
+
+	n_avail = bench_list_channels(session_dir, &chan_paths);
+	if (n_avail == 0) {
+		fprintf(stderr, "no time series channels in %s\n", session_dir);
+		return(1);
+	}
+	csv_fp = (csv_path == NULL) ? NULL : bench_open_csv(csv_path);
+	result.latencies = (sf8 *) calloc((size_t) reps, sizeof(sf8));
+	strcpy(result.gateway, "MED_session_stats");
+	result.reps = reps;
+	result.samples = result.bytes = 0;
+
+	bench_print_header();
+	for (c = 0; c < n_ch_items; ++c) {
+		n_chans = atoi(chan_list[c]);
+		if (n_chans < 1 || n_chans > n_avail) {
+			fprintf(stderr, "skipping %d channels (session has %d)\n", n_chans, n_avail);
+			continue;
+		}
+		for (v = 0; v < n_ret_items; ++v) {
+			ret_chans = (strcmp(ret_list[v], "none") == 0) ? false : true;
+			ret_other = (strcmp(ret_list[v], "all") == 0) ? true : false;
+			prhs[0] = bench_channel_cell(chan_paths, n_chans);
+			prhs[1] = (password == NULL) ? mxCreateDoubleMatrix(0, 0, mxREAL) : mxCreateString(password);
+			prhs[2] = mxCreateLogicalScalar(ret_chans);
+			prhs[3] = mxCreateLogicalScalar(ret_other);
+			prhs[4] = mxCreateLogicalScalar(ret_other);
+			prhs[5] = mxCreateLogicalScalar(false);
+
+			bench_reset_peak_rss();
+			for (r = 0; r < reps; ++r) {
+				plhs[0] = NULL;
+				t0 = bench_seconds();
+				mexFunction(1, plhs, 6, prhs);
+				result.latencies[r] = bench_seconds() - t0;
+				if (mxIsStruct(plhs[0]) == false) {
+					fprintf(stderr, "MED_session_stats failed (repetition %d)\n", r + 1);
+					return(1);
+				}
+				mxDestroyArray(plhs[0]);
+			}
+			result.peak_rss = bench_peak_rss();
+			for (i = 0; i < 6; ++i)
+				mxDestroyArray((mxArray *) prhs[i]);
+
+			snprintf(result.config, 256, "ch=%d returns=%s", n_chans, ret_list[v]);
+			bench_report(&result, csv_fp);
+		}
+	}
+
+	// clean up
+	mex_shim_unload();
+	if (csv_fp != NULL)
+		fclose(csv_fp);
+	free((void *) result.latencies);
+	bench_free_list(chan_paths, n_avail);
+	bench_free_list(chan_list, n_ch_items);
+	bench_free_list(ret_list, n_ret_items);
+
+	return(0);
+}
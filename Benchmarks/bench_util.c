@@ -0,0 +1,346 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Shared code for the gateway benchmarks: timing, latency percentiles, peak resident memory, channel listing, parameter structures, & reporting
+// Peak RSS is reset before each configuration on Linux (/proc/self/clear_refs), so each row reports its own peak. Elsewhere it is the process peak.
+
+
+#include "bench_util.h"
+#ifdef _MSC_VER
+	#include <windows.h>
+	#include <psapi.h>
+#else
+	#include <time.h>
+	#include <dirent.h>
+	#include <sys/resource.h>
+#endif
+
+
+sf8	bench_seconds(void)
+{
+#ifdef _MSC_VER
+	LARGE_INTEGER	count, freq;
+
+
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&freq);
+
+	return((sf8) count.QuadPart / (sf8) freq.QuadPart);
+#else
+	struct timespec	ts;
+
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return((sf8) ts.tv_sec + ((sf8) ts.tv_nsec / (sf8) 1e9));
+#endif
+}
+
+
+static si4	compare_sf8(const void *a, const void *b)
+{
+	if (*((sf8 *) a) > *((sf8 *) b))
+		return(1);
+	if (*((sf8 *) a) < *((sf8 *) b))
+		return(-1);
+
+	return(0);
+}
+
+
+// nearest rank percentiles (sorts x)
+void	bench_percentiles(sf8 *x, si4 n, sf8 *p50, sf8 *p90, sf8 *p99)
+{
+	if (n == 0) {
+		*p50 = *p90 = *p99 = 0.0;
+		return;
+	}
+
+	qsort((void *) x, (size_t) n, sizeof(sf8), compare_sf8);
+	*p50 = x[(si4) ceil(0.50 * (sf8) n) - 1];
+	*p90 = x[(si4) ceil(0.90 * (sf8) n) - 1];
+	*p99 = x[(si4) ceil(0.99 * (sf8) n) - 1];
+
+	return;
+}
+
+
+void	bench_reset_peak_rss(void)
+{
+#ifdef __linux__
+	FILE	*fp;
+
+
+	fp = fopen("/proc/self/clear_refs", "w");
+	if (fp == NULL)
+		return;
+	fputs("5", fp);  // resets VmHWM to current RSS
+	fclose(fp);
+#endif
+
+	return;
+}
+
+
+// returns bytes, or -1 if unknown
+si8	bench_peak_rss(void)
+{
+#ifdef _MSC_VER
+	PROCESS_MEMORY_COUNTERS	pmc;
+
+
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)) == 0)
+		return(-1);
+
+	return((si8) pmc.PeakWorkingSetSize);
+#else
+	si1		line[256];
+	si8		kb;
+	FILE		*fp;
+	struct rusage	ru;
+
+
+	fp = fopen("/proc/self/status", "r");
+	if (fp != NULL) {
+		while (fgets(line, 256, fp) != NULL) {
+			if (strncmp(line, "VmHWM:", 6) == 0) {
+				fclose(fp);
+				kb = strtoll(line + 6, NULL, 10);
+				return(kb * 1024);
+			}
+		}
+		fclose(fp);
+	}
+	if (getrusage(RUSAGE_SELF, &ru) != 0)
+		return(-1);
+	#ifdef __APPLE__
+		return((si8) ru.ru_maxrss);  // bytes on macOS
+	#else
+		return((si8) ru.ru_maxrss * 1024);
+	#endif
+#endif
+}
+
+
+static si4	compare_strings(const void *a, const void *b)
+{
+	return(strcmp(*((si1 **) a), *((si1 **) b)));
+}
+
+
+// returns number of time series channel directories in session, sorted by name (caller frees with bench_free_list())
+si4	bench_list_channels(si1 *session_dir, si1 ***chan_paths)
+{
+	si1		**paths;
+	si4		n_chans, len;
+#ifdef _MSC_VER
+	si1		pattern[FULL_FILE_NAME_BYTES_m12];
+	HANDLE		find_h;
+	WIN32_FIND_DATAA	find_data;
+#else
+	DIR		*dir;
+	struct dirent	*ent;
+#endif
+
+
+	paths = NULL;
+	n_chans = 0;
+#ifdef _MSC_VER
+	snprintf(pattern, FULL_FILE_NAME_BYTES_m12, "%s\\*.ticd", session_dir);
+	find_h = FindFirstFileA(pattern, &find_data);
+	if (find_h != INVALID_HANDLE_VALUE) {
+		do {
+			paths = (si1 **) realloc((void *) paths, (size_t) (n_chans + 1) * sizeof(si1 *));
+			len = (si4) (strlen(session_dir) + strlen(find_data.cFileName) + 2);
+			paths[n_chans] = (si1 *) malloc((size_t) len);
+			snprintf(paths[n_chans++], len, "%s\\%s", session_dir, find_data.cFileName);
+		} while (FindNextFileA(find_h, &find_data));
+		FindClose(find_h);
+	}
+#else
+	dir = opendir(session_dir);
+	if (dir == NULL)
+		return(0);
+	while ((ent = readdir(dir)) != NULL) {
+		len = (si4) strlen(ent->d_name);
+		if (len <= 5 || strcmp(ent->d_name + len - 5, ".ticd"))
+			continue;
+		paths = (si1 **) realloc((void *) paths, (size_t) (n_chans + 1) * sizeof(si1 *));
+		len += (si4) strlen(session_dir) + 2;
+		paths[n_chans] = (si1 *) malloc((size_t) len);
+		snprintf(paths[n_chans++], len, "%s/%s", session_dir, ent->d_name);
+	}
+	closedir(dir);
+#endif
+	if (n_chans)
+		qsort((void *) paths, (size_t) n_chans, sizeof(si1 *), compare_strings);
+	*chan_paths = paths;
+
+	return(n_chans);
+}
+
+
+void	bench_free_list(si1 **items, si4 n_items)
+{
+	si4	i;
+
+
+	for (i = 0; i < n_items; ++i)
+		free((void *) items[i]);
+	if (items != NULL)
+		free((void *) items);
+
+	return;
+}
+
+
+mxArray	*bench_channel_cell(si1 **chan_paths, si4 n_chans)
+{
+	si4	i;
+	mxArray	*cell;
+
+
+	cell = mxCreateCellMatrix(1, (mwSize) n_chans);
+	for (i = 0; i < n_chans; ++i)
+		mxSetCell(cell, (mwIndex) i, mxCreateString(chan_paths[i]));
+
+	return(cell);
+}
+
+
+// splits comma separated list (e.g. "1,4,16"), returns number of items (caller frees with bench_free_list())
+si4	bench_parse_list(si1 *arg, si1 ***items)
+{
+	si1	*c, *start, **list;
+	si4	n_items, len;
+
+
+	list = (si1 **) calloc((size_t) BENCH_MAX_LIST_ITEMS, sizeof(si1 *));
+	n_items = 0;
+	for (start = c = arg; n_items < BENCH_MAX_LIST_ITEMS; ++c) {
+		if (*c != ',' && *c)
+			continue;
+		len = (si4) (c - start);
+		if (len) {
+			list[n_items] = (si1 *) malloc((size_t) len + 1);
+			memcpy((void *) list[n_items], (void *) start, (size_t) len);
+			list[n_items++][len] = 0;
+		}
+		if (*c == 0)
+			break;
+		start = c + 1;
+	}
+	*items = list;
+
+	return(n_items);
+}
+
+
+// 1x1 structure with empty fields (gateways substitute defaults for empty fields)
+mxArray	*bench_param_struct(const si1 **field_names, si4 n_fields)
+{
+	si4	i;
+	mxArray	*ps;
+
+
+	ps = mxCreateStructMatrix(1, 1, n_fields, field_names);
+	for (i = 0; i < n_fields; ++i)
+		mxSetFieldByNumber(ps, 0, i, mxCreateDoubleMatrix(0, 0, mxREAL));
+
+	return(ps);
+}
+
+
+// replaces field's value, freeing the old one
+void	bench_set_field(mxArray *ps, const si1 *name, mxArray *value)
+{
+	si4	field_num;
+
+
+	field_num = mxGetFieldNumber(ps, name);
+	if (field_num < 0) {
+		fprintf(stderr, "bench_set_field(): no field \"%s\"\n", name);
+		exit(1);
+	}
+	mxDestroyArray(mxGetFieldByNumber(ps, 0, field_num));
+	mxSetFieldByNumber(ps, 0, field_num, value);
+
+	return;
+}
+
+
+// counts samples in a numeric array, or in a cell array of numeric arrays
+si8	bench_count_samples(const mxArray *data, si8 *bytes)
+{
+	si8	samples;
+	mwIndex	i;
+
+
+	samples = *bytes = 0;
+	if (data == NULL)
+		return(0);
+
+	if (mxIsCell(data) == true) {
+		for (i = 0; i < mxGetNumberOfElements(data); ++i) {
+			samples += (si8) mxGetNumberOfElements(mxGetCell(data, i));
+			*bytes += (si8) (mxGetNumberOfElements(mxGetCell(data, i)) * mxGetElementSize(mxGetCell(data, i)));
+		}
+	} else if (mxIsNumeric(data) == true) {
+		samples = (si8) mxGetNumberOfElements(data);
+		*bytes = (si8) (mxGetNumberOfElements(data) * mxGetElementSize(data));
+	}
+
+	return(samples);
+}
+
+
+FILE	*bench_open_csv(si1 *path)
+{
+	FILE	*fp;
+
+
+	fp = fopen(path, "a");
+	if (fp == NULL) {
+		fprintf(stderr, "cannot open %s\n", path);
+		exit(1);
+	}
+	if (ftell(fp) == 0)
+		fprintf(fp, "gateway,config,reps,samples_per_s,MB_per_s,p50_ms,p90_ms,p99_ms,peak_rss_MB\n");
+
+	return(fp);
+}
+
+
+void	bench_print_header(void)
+{
+	printf("%-18s %-48s %12s %10s %10s %10s %10s %10s\n", "gateway", "configuration", "samples/s", "MB/s", "p50 ms", "p90 ms", "p99 ms", "RSS MB");
+
+	return;
+}
+
+
+void	bench_report(BENCH_RESULT *result, FILE *csv_fp)
+{
+	si4	i;
+	sf8	total, samp_rate, MB_rate, p50, p90, p99, rss_MB;
+
+
+	for (i = 0, total = 0.0; i < result->reps; ++i)
+		total += result->latencies[i];
+	samp_rate = MB_rate = 0.0;
+	if (total > 0.0) {
+		samp_rate = (sf8) result->samples / total;
+		MB_rate = ((sf8) result->bytes / (sf8) 1e6) / total;
+	}
+	bench_percentiles(result->latencies, result->reps, &p50, &p90, &p99);
+	rss_MB = (result->peak_rss < 0) ? -1.0 : (sf8) result->peak_rss / (sf8) (1 << 20);
+
+	printf("%-18s %-48s %12.4e %10.1f %10.3f %10.3f %10.3f %10.1f\n", result->gateway, result->config, samp_rate, MB_rate, p50 * 1e3, p90 * 1e3, p99 * 1e3, rss_MB);
+	fflush(stdout);
+	if (csv_fp != NULL) {
+		fprintf(csv_fp, "%s,%s,%d,%.6e,%.3f,%.4f,%.4f,%.4f,%.1f\n", result->gateway, result->config, result->reps, samp_rate, MB_rate, p50 * 1e3, p90 * 1e3, p99 * 1e3, rss_MB);
+		fflush(csv_fp);
+	}
+
+	return;
+}
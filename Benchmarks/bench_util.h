@@ -0,0 +1,44 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+#ifndef BENCH_UTIL_IN
+#define BENCH_UTIL_IN
+
+// Includes
+#include "mex.h"
+#include "medlib_m12.h"
+
+// Miscellaneous
+#define BENCH_MAX_LIST_ITEMS	32
+#define BENCH_DEFAULT_REPS	10
+
+// Benchmark Result Structure
+typedef struct {
+	si1		gateway[32];
+	si1		config[256];  // e.g. "ch=16 win=10s fmt=int16 filt=none"
+	si4		reps;
+	si8		samples;  // returned over all repetitions
+	si8		bytes;  // returned over all repetitions
+	sf8		*latencies;  // seconds, one per repetition
+	si8		peak_rss;  // bytes (-1 if unknown)
+} BENCH_RESULT;
+
+
+// Prototypes
+sf8		bench_seconds(void);
+void		bench_percentiles(sf8 *x, si4 n, sf8 *p50, sf8 *p90, sf8 *p99);
+void		bench_reset_peak_rss(void);
+si8		bench_peak_rss(void);
+si4		bench_list_channels(si1 *session_dir, si1 ***chan_paths);
+void		bench_free_list(si1 **items, si4 n_items);
+mxArray		*bench_channel_cell(si1 **chan_paths, si4 n_chans);
+si4		bench_parse_list(si1 *arg, si1 ***items);
+mxArray		*bench_param_struct(const si1 **field_names, si4 n_fields);
+void		bench_set_field(mxArray *ps, const si1 *name, mxArray *value);
+si8		bench_count_samples(const mxArray *data, si8 *bytes);
+FILE		*bench_open_csv(si1 *path);
+void		bench_print_header(void);
+void		bench_report(BENCH_RESULT *result, FILE *csv_fp);
+
+
+#endif /* BENCH_UTIL_IN */
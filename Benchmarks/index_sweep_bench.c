@@ -0,0 +1,135 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Microbenchmark: sorted sweep time <=> sample conversion vs. per-element medlib conversion (MED_sample_for_time() & MED_time_for_sample() before the sweep)
+// Reports queries/s for each, & the number of results that differ (must be zero)
+
+//*********************************************************************************** Compile Line ***********************************************************************************//
+//****  cc -O3 -I.. index_sweep_bench.c ../index_sweep.c ../session_manifest.c ../record_journal.c ../work_queue.c ../medlib_m12.c ../medrec_m12.c ../dhnlib_m12.c -lm -lpthread  ****//
+//************************************************************************************************************************************************************************************//
+//	usage: index_sweep_bench channel_directory [queries (default 10^6)] [password]
+
+
+#include "index_sweep.h"
+#include "session_manifest.h"
+#ifdef _MSC_VER
+	#include <windows.h>
+#else
+	#include <time.h>
+#endif
+
+
+sf8	bench_seconds(void)
+{
+#ifdef _MSC_VER
+	LARGE_INTEGER	count, freq;
+
+
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&freq);
+
+	return((sf8) count.QuadPart / (sf8) freq.QuadPart);
+#else
+	struct timespec	ts;
+
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return((sf8) ts.tv_sec + ((sf8) ts.tv_nsec / (sf8) 1e9));
+#endif
+}
+
+
+void	report(const si1 *conversion, const si1 *version, sf8 secs, si8 n_queries, si8 mismatches)
+{
+	printf("%-16s %-10s %12.0f queries/s", conversion, version, (sf8) n_queries / secs);
+	if (mismatches >= 0)
+		printf("  %ld mismatches", (long) mismatches);
+	printf("\n");
+}
+
+
+si4	main(si4 argc, si1 **argv)
+{
+	si1		*password;
+	si8		i, n_queries, first_time, last_time, first_samp, last_samp, mismatches, *queries, *ref, *out;
+	sf8		t;
+	CHANNEL_m12	*chan;
+	TIME_SLICE_m12	slice;
+	SWEEP_MAP	*map;
+
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s channel_directory [queries (default 10^6)] [password]\n", argv[0]);
+		return(1);
+	}
+	n_queries = (argc > 2) ? (si8) strtoll(argv[2], NULL, 10) : (si8) 1000000;
+	password = (argc > 3) ? argv[3] : NULL;
+
+	G_initialize_medlib_m12(FALSE_m12, FALSE_m12);
+	G_initialize_time_slice_m12(&slice);
+	slice.start_time = BEGINNING_OF_TIME_m12;
+	slice.end_time = END_OF_TIME_m12;
+	chan = G_open_channel_m12(NULL, &slice, argv[1], (LH_READ_SEGMENT_METADATA_m12 | LH_MAP_ALL_SEGMENTS_m12), password);
+	if (chan == NULL || read_segment_indices(chan) == FALSE_m12) {
+		fprintf(stderr, "cannot open %s\n", argv[1]);
+		return(1);
+	}
+	map = build_sweep_map(chan);
+	if (map == NULL) {
+		fprintf(stderr, "cannot build block map\n");
+		return(1);
+	}
+	first_time = map->blocks[0].start_time;
+	last_time = map->blocks[map->n_blocks - 1].end_time;
+	first_samp = map->blocks[0].start_sample_number;
+	last_samp = map->blocks[map->n_blocks - 1].end_sample_number;
+
+	queries = (si8 *) malloc((size_t) n_queries * sizeof(si8));
+	ref = (si8 *) malloc((size_t) n_queries * sizeof(si8));
+	out = (si8 *) malloc((size_t) n_queries * sizeof(si8));
+
+	printf("%ld queries, %ld blocks\n\n", (long) n_queries, (long) map->n_blocks);
+
+	// unsorted spike-like times over the channel (a few before & after it)
+	srand(1);
+	for (i = 0; i < n_queries; ++i)
+		queries[i] = first_time + (si8) (((sf8) rand() / (sf8) RAND_MAX) * (sf8) (last_time - first_time)) + ((i % 10000) ? 0 : ((i % 20000) ? -1000000 : 1000000));
+	t = bench_seconds();
+	for (i = 0; i < n_queries; ++i)
+		ref[i] = G_sample_number_for_uutc_m12((LEVEL_HEADER_m12 *) chan, queries[i], (FIND_ABSOLUTE_m12 | FIND_CURRENT_m12));
+	report("sample_for_time", "medlib", bench_seconds() - t, n_queries, -1);
+	memcpy((void *) out, (void *) queries, (size_t) n_queries * sizeof(si8));
+	t = bench_seconds();
+	sweep_sample_for_time(chan, map, out, n_queries);
+	t = bench_seconds() - t;
+	for (i = mismatches = 0; i < n_queries; ++i)
+		if (out[i] != ref[i])
+			++mismatches;
+	report("sample_for_time", "sweep", t, n_queries, mismatches);
+
+	// unsorted sample numbers over the channel
+	for (i = 0; i < n_queries; ++i)
+		queries[i] = first_samp + (si8) (((sf8) rand() / (sf8) RAND_MAX) * (sf8) (last_samp - first_samp));
+	t = bench_seconds();
+	for (i = 0; i < n_queries; ++i)
+		ref[i] = G_uutc_for_sample_number_m12((LEVEL_HEADER_m12 *) chan, queries[i], (FIND_ABSOLUTE_m12 | FIND_CURRENT_m12));
+	report("time_for_sample", "medlib", bench_seconds() - t, n_queries, -1);
+	memcpy((void *) out, (void *) queries, (size_t) n_queries * sizeof(si8));
+	t = bench_seconds();
+	sweep_time_for_sample(chan, map, out, n_queries);
+	t = bench_seconds() - t;
+	for (i = mismatches = 0; i < n_queries; ++i)
+		if (out[i] != ref[i])
+			++mismatches;
+	report("time_for_sample", "sweep", t, n_queries, mismatches);
+
+	free((void *) queries);
+	free((void *) ref);
+	free((void *) out);
+	free_sweep_map(map);
+	G_free_channel_m12(chan, TRUE_m12);
+	G_free_globals_m12(TRUE_m12);
+
+	return(0);
+}
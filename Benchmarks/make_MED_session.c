@@ -0,0 +1,792 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Synthetic MED session generator, for benchmarks & scaling tests without patient recordings
+// Writes a session of deterministic (seeded) signals: each channel is two sinusoids plus noise, so compression ratios resemble recorded data.
+// Configurable: channel count, sampling rates (a list is cycled across channels for mixed rates), segment count & length, discontinuities per segment,
+// record density (Note, Seiz, & HFOc records per hour, in segmented session records; one Sgmt record per segment, in session records), & encryption level.
+// Files are written with the same medlib calls add_record_exec.c uses (FPS_allocate_processing_struct_m12() & G_write_file_m12()), & blocks are
+// compressed with CMP_encode_m12(). Each channel segment is generated & written one block at a time, so memory use does not grow with session size.
+
+//******************************************************* Compile Line *******************************************************//
+//****  cc -O3 -I.. -o make_MED_session make_MED_session.c ../medlib_m12.c ../medrec_m12.c ../dhnlib_m12.c -lm -lpthread  ****//
+//****************************************************************************************************************************//
+//	usage: make_MED_session output_directory [--name synthetic] [--channels 16] [--rates 1000 (or list, e.g. 1000,250)] [--segments 1]
+//			[--segment-seconds 600] [--block-seconds 1] [--gaps 0 (per segment)] [--gap-seconds 1] [--notes 0 (per hour)] [--seizures 0 (per hour)]
+//			[--hfos 0 (per hour)] [--encryption 0 (0, 1, or 2)] [--password level_1_password] [--password2 level_2_password] [--start uutc] [--seed 1]
+
+
+#include "make_MED_session.h"
+#ifdef _MSC_VER
+	#include <windows.h>
+#else
+	#include <time.h>
+#endif
+
+
+si4	main(si4 argc, si1 **argv)
+{
+	si1				chan_name[BASE_FILE_NAME_BYTES_m12], chan_path[FULL_FILE_NAME_BYTES_m12], recd_path[FULL_FILE_NAME_BYTES_m12];
+	si4				i, j, n_rates;
+	si8				n_recs, total_samps;
+	sf8				t0, rate;
+	ui8				chan_UID, rng_state;
+	TERN_m12			rates_vary;
+	GEN_PARAMS			gp;
+	GEN_RECORD			*recs, *Sgmt_recs;
+	FILE_PROCESSING_STRUCT_m12	*proto_fps;
+#ifdef _MSC_VER
+	LARGE_INTEGER			count, freq;
+#else
+	struct timespec			ts;
+#endif
+
+
+	if (parse_generator_options(argc, argv, &gp) < 0)
+		return(1);
+
+#ifdef _MSC_VER
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&freq);
+	t0 = (sf8) count.QuadPart / (sf8) freq.QuadPart;
+#else
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t0 = (sf8) ts.tv_sec + ((sf8) ts.tv_nsec / (sf8) 1e9);
+#endif
+
+	// initialize MED library
+	G_initialize_medlib_m12(FALSE_m12, FALSE_m12);
+
+	// session directory & prototype headers
+	sprintf_m12(gp.session_path, "%s/%s.%s", gp.out_dir, gp.session_name, SESSION_DIRECTORY_TYPE_STRING_m12);
+	if (G_exists_m12(gp.session_path) != DOES_NOT_EXIST_m12) {
+		fprintf(stderr, "%s already exists\n", gp.session_path);
+		return(1);
+	}
+	if (make_directory(gp.session_path) == FALSE_m12)
+		return(1);
+	gp.session_UID = G_generate_UID_m12(NULL);
+	gp.segment_UIDs = (ui8 *) malloc((size_t) gp.n_segs * sizeof(ui8));
+	for (i = 0; i < gp.n_segs; ++i)
+		gp.segment_UIDs[i] = G_generate_UID_m12(NULL);
+	proto_fps = build_prototype(&gp);
+	if (proto_fps == NULL)
+		return(1);
+
+	// time series channels
+	total_samps = 0;
+	for (i = 0; i < gp.n_chans; ++i) {
+		sprintf_m12(chan_name, "ch%03d", i + 1);
+		sprintf_m12(chan_path, "%s/%s.%s", gp.session_path, chan_name, TIME_SERIES_CHANNEL_DIRECTORY_TYPE_STRING_m12);
+		if (make_directory(chan_path) == FALSE_m12)
+			return(1);
+		chan_UID = G_generate_UID_m12(NULL);
+		for (j = 0; j < gp.n_segs; ++j)
+			if (write_channel_segment(&gp, proto_fps, i, chan_UID, j) == FALSE_m12)
+				return(1);
+		total_samps += (si8) gp.n_segs * (si8) round(gp.seg_secs * gp.rates[i % gp.n_rates]);
+	}
+
+	// segmented session records (Note, Seiz, HFOc)
+	rng_state = gp.seed ^ (ui8) 0x5245434F52445321;  // "RECORDS!"
+	sprintf_m12(recd_path, "%s/%s.%s", gp.session_path, gp.session_name, RECORD_DIRECTORY_TYPE_STRING_m12);
+	for (j = 0; j < gp.n_segs; ++j) {
+		n_recs = generate_segment_records(&gp, j, &recs, &rng_state);
+		if (n_recs) {
+			if (G_exists_m12(recd_path) == DOES_NOT_EXIST_m12)
+				if (make_directory(recd_path) == FALSE_m12)
+					return(1);
+			if (write_records(&gp, proto_fps, recd_path, gp.session_name, j + 1, segment_start_time(&gp, j), segment_start_time(&gp, j + 1) - 1, recs, n_recs) == FALSE_m12)
+				return(1);
+		}
+		free((void *) recs);
+	}
+
+	// session records (Sgmt)
+	n_rates = gp.n_rates;
+	if (n_rates > gp.n_chans)
+		n_rates = gp.n_chans;
+	rate = gp.rates[0];
+	for (i = 1, rates_vary = FALSE_m12; i < n_rates; ++i)
+		if (gp.rates[i] != rate)
+			rates_vary = TRUE_m12;
+	Sgmt_recs = (GEN_RECORD *) calloc((size_t) gp.n_segs, sizeof(GEN_RECORD));
+	for (j = 0; j < gp.n_segs; ++j) {
+		Sgmt_recs[j].type_code = REC_Sgmt_TYPE_CODE_m12;
+		Sgmt_recs[j].start_time = segment_start_time(&gp, j);
+		Sgmt_recs[j].end_time = segment_start_time(&gp, j + 1) - 1;
+		Sgmt_recs[j].segment_number = j + 1;
+		if (rates_vary == TRUE_m12) {
+			Sgmt_recs[j].sampling_frequency = REC_Sgmt_v10_SAMPLING_FREQUENCY_VARIABLE_m12;
+			Sgmt_recs[j].start_sample_number = Sgmt_recs[j].end_sample_number = SAMPLE_NUMBER_NO_ENTRY_m12;
+		} else {
+			Sgmt_recs[j].sampling_frequency = rate;
+			Sgmt_recs[j].start_sample_number = (si8) j * (si8) round(gp.seg_secs * rate);
+			Sgmt_recs[j].end_sample_number = ((si8) (j + 1) * (si8) round(gp.seg_secs * rate)) - 1;
+		}
+	}
+	if (write_records(&gp, proto_fps, gp.session_path, gp.session_name, 0, gp.start_time, segment_start_time(&gp, gp.n_segs) - 1, Sgmt_recs, (si8) gp.n_segs) == FALSE_m12)
+		return(1);
+
+#ifdef _MSC_VER
+	QueryPerformanceCounter(&count);
+	t0 = ((sf8) count.QuadPart / (sf8) freq.QuadPart) - t0;
+#else
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t0 = ((sf8) ts.tv_sec + ((sf8) ts.tv_nsec / (sf8) 1e9)) - t0;
+#endif
+	printf("%s: %d channels, %d segments, %ld samples (%.1f s)\n", gp.session_path, gp.n_chans, gp.n_segs, (long) total_samps, t0);
+
+	// clean up
+	free((void *) Sgmt_recs);
+	free((void *) gp.segment_UIDs);
+	FPS_free_processing_struct_m12(proto_fps, TRUE_m12);
+	G_free_globals_m12(TRUE_m12);
+
+	return(0);
+}
+
+
+// returns 0, or -1 on error
+si4	parse_generator_options(si4 argc, si1 **argv, GEN_PARAMS *gp)
+{
+	si1	*c, *rate_str;
+	si4	i;
+
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s output_directory [--name synthetic] [--channels 16] [--rates 1000 (or list, e.g. 1000,250)] [--segments 1]\n", argv[0]);
+		fprintf(stderr, "\t\t[--segment-seconds 600] [--block-seconds 1] [--gaps 0 (per segment)] [--gap-seconds 1] [--notes 0 (per hour)] [--seizures 0 (per hour)]\n");
+		fprintf(stderr, "\t\t[--hfos 0 (per hour)] [--encryption 0 (0, 1, or 2)] [--password level_1_password] [--password2 level_2_password] [--start uutc] [--seed 1]\n");
+		return(-1);
+	}
+
+	// defaults
+	memset((void *) gp, 0, sizeof(GEN_PARAMS));
+	snprintf(gp->out_dir, FULL_FILE_NAME_BYTES_m12, "%s", argv[1]);
+	strcpy(gp->session_name, GEN_DEFAULT_SESSION_NAME);
+	gp->n_chans = 16;
+	gp->n_rates = 1;
+	gp->rates[0] = 1000.0;
+	gp->n_segs = 1;
+	gp->seg_secs = 600.0;
+	gp->block_secs = 1.0;
+	gp->gap_secs = 1.0;
+	gp->start_time = GEN_DEFAULT_START_TIME;
+	gp->seed = 1;
+
+	// options
+	for (i = 2; i < argc; ++i) {
+		if (i + 1 == argc) {
+			fprintf(stderr, "%s needs a value\n", argv[i]);
+			return(-1);
+		}
+		if (strcmp(argv[i], "--name") == 0) {
+			snprintf(gp->session_name, BASE_FILE_NAME_BYTES_m12, "%s", argv[++i]);
+		} else if (strcmp(argv[i], "--channels") == 0) {
+			gp->n_chans = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--rates") == 0) {
+			rate_str = argv[++i];
+			for (gp->n_rates = 0, c = rate_str; *c && gp->n_rates < GEN_MAX_RATES; ) {
+				gp->rates[gp->n_rates++] = strtod(c, &c);
+				if (*c == ',')
+					++c;
+				else if (*c)
+					break;
+			}
+		} else if (strcmp(argv[i], "--segments") == 0) {
+			gp->n_segs = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--segment-seconds") == 0) {
+			gp->seg_secs = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--block-seconds") == 0) {
+			gp->block_secs = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--gaps") == 0) {
+			gp->gaps_per_seg = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--gap-seconds") == 0) {
+			gp->gap_secs = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--notes") == 0) {
+			gp->notes_per_hour = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--seizures") == 0) {
+			gp->seizures_per_hour = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--hfos") == 0) {
+			gp->HFOs_per_hour = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--encryption") == 0) {
+			gp->enc_level = (si1) atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--password") == 0) {
+			snprintf(gp->level_1_password, PASSWORD_BYTES_m12 + 1, "%s", argv[++i]);
+		} else if (strcmp(argv[i], "--password2") == 0) {
+			snprintf(gp->level_2_password, PASSWORD_BYTES_m12 + 1, "%s", argv[++i]);
+		} else if (strcmp(argv[i], "--start") == 0) {
+			gp->start_time = strtoll(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "--seed") == 0) {
+			gp->seed = strtoull(argv[++i], NULL, 10);
+		} else {
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return(-1);
+		}
+	}
+
+	// check parameters
+	if (gp->n_chans < 1 || gp->n_segs < 1 || gp->n_rates < 1) {
+		fprintf(stderr, "at least one channel, segment, & sampling rate required\n");
+		return(-1);
+	}
+	for (i = 0; i < gp->n_rates; ++i) {
+		if (gp->rates[i] <= 0.0 || gp->rates[i] * gp->block_secs < 1.0) {
+			fprintf(stderr, "sampling rates must be positive, with at least one sample per block\n");
+			return(-1);
+		}
+	}
+	if (gp->seg_secs < gp->block_secs || gp->block_secs <= 0.0 || gp->gaps_per_seg < 0 || gp->gap_secs <= 0.0) {
+		fprintf(stderr, "segments must be at least one block long, & gaps must be positive\n");
+		return(-1);
+	}
+	if (gp->enc_level < NO_ENCRYPTION_m12 || gp->enc_level > LEVEL_2_ENCRYPTION_m12) {
+		fprintf(stderr, "encryption level must be 0, 1, or 2\n");
+		return(-1);
+	}
+	if ((gp->enc_level >= LEVEL_1_ENCRYPTION_m12 && *gp->level_1_password == 0) || (gp->enc_level == LEVEL_2_ENCRYPTION_m12 && *gp->level_2_password == 0)) {
+		fprintf(stderr, "encryption level %d requires level 1%s password\n", gp->enc_level, (gp->enc_level == LEVEL_2_ENCRYPTION_m12) ? " & level 2" : "");
+		return(-1);
+	}
+
+	return(0);
+}
+
+
+// universal header & metadata shared by all files of the session (copied by FPS_allocate_processing_struct_m12())
+FILE_PROCESSING_STRUCT_m12	*build_prototype(GEN_PARAMS *gp)
+{
+	UNIVERSAL_HEADER_m12			*uh;
+	METADATA_SECTION_1_m12			*md1;
+	TIME_SERIES_METADATA_SECTION_2_m12	*tmd2;
+	METADATA_SECTION_3_m12			*md3;
+	FILE_PROCESSING_STRUCT_m12		*proto_fps;
+
+
+	proto_fps = FPS_allocate_processing_struct_m12(NULL, NULL, TIME_SERIES_METADATA_FILE_TYPE_CODE_m12, METADATA_BYTES_m12, NULL, NULL, 0);
+	if (proto_fps == NULL)
+		return(NULL);
+	G_initialize_universal_header_m12(proto_fps, TIME_SERIES_METADATA_FILE_TYPE_CODE_m12, TRUE_m12, TRUE_m12);
+	G_initialize_metadata_m12(proto_fps, TRUE_m12);
+
+	uh = proto_fps->universal_header;
+	strcpy(uh->session_name, gp->session_name);
+	strcpy(uh->anonymized_subject_ID, "synthetic");
+	uh->session_UID = gp->session_UID;
+	uh->session_start_time = uh->file_start_time = gp->start_time;
+
+	// passwords (sets validation fields in prototype header, & encryption keys in globals)
+	if (gp->enc_level > NO_ENCRYPTION_m12) {
+		if (G_generate_password_data_m12(proto_fps, gp->level_1_password, gp->level_2_password, NULL, NULL, NULL) == FALSE_m12) {
+			G_warning_message_m12("%s(): cannot generate password data\n", __FUNCTION__);
+			FPS_free_processing_struct_m12(proto_fps, TRUE_m12);
+			return(NULL);
+		}
+	}
+
+	// section 1: metadata encryption follows MED defaults (section 2 at level 1, section 3 at level 2), limited to the requested level (negative: encrypt on write)
+	md1 = &proto_fps->metadata->section_1;
+	md1->section_2_encryption_level = (gp->enc_level > NO_ENCRYPTION_m12) ? -LEVEL_1_ENCRYPTION_m12 : NO_ENCRYPTION_m12;
+	md1->section_3_encryption_level = -gp->enc_level;
+
+	// section 2: fields common to all channel segments
+	tmd2 = &proto_fps->metadata->time_series_section_2;
+	strcpy(tmd2->session_description, "synthetic session (make_MED_session)");
+	strcpy(tmd2->channel_description, "two sinusoids plus noise");
+	strcpy(tmd2->reference_description, "none");
+	strcpy(tmd2->equipment_description, "none");
+	tmd2->recording_duration = segment_start_time(gp, gp->n_segs) - gp->start_time;
+	tmd2->low_frequency_filter_setting = 0.1;
+	tmd2->AC_line_frequency = 60.0;
+	tmd2->amplitude_units_conversion_factor = 1.0;
+	strcpy(tmd2->amplitude_units_description, "microvolts");
+	tmd2->time_base_units_conversion_factor = 1.0;
+	strcpy(tmd2->time_base_units_description, "microseconds");
+
+	// section 3: absolute times (no recording time offset), UTC
+	md3 = &proto_fps->metadata->section_3;
+	md3->recording_time_offset = 0;
+	md3->standard_UTC_offset = 0;
+	strcpy(md3->standard_timezone_acronym, "UTC");
+	strcpy(md3->standard_timezone_string, "Coordinated Universal Time");
+	strcpy(md3->subject_name_1, "Synthetic");
+	strcpy(md3->subject_name_2, "Session");
+	strcpy(md3->subject_ID, "synthetic");
+	strcpy(md3->recording_institution, "none");
+
+	return(proto_fps);
+}
+
+
+TERN_m12	make_directory(si1 *path)
+{
+	si1	command[FULL_FILE_NAME_BYTES_m12 + 64];
+
+
+#if defined MACOS_m12 || defined LINUX_m12
+	sprintf_m12(command, "mkdir -p \"%s\" 1> %s 2> %s", path, NULL_DEVICE_m12, NULL_DEVICE_m12);
+#endif
+#ifdef WINDOWS_m12
+	sprintf(command, "mkdir \"%s\" 1> %s 2> %s", path, NULL_DEVICE_m12, NULL_DEVICE_m12);
+#endif
+	system_m12(command, FALSE_m12, __FUNCTION__, USE_GLOBAL_BEHAVIOR_m12);
+	if (G_exists_m12(path) != DIR_EXISTS_m12) {
+		G_warning_message_m12("%s(): cannot create directory \"%s\"\n", __FUNCTION__, path);
+		return(FALSE_m12);
+	}
+
+	return(TRUE_m12);
+}
+
+
+// header fields that differ between files (others copied from the prototype)
+void	set_file_header(FILE_PROCESSING_STRUCT_m12 *fps, si1 *chan_name, ui8 chan_UID, si4 seg_num, si8 seg_start_time, si8 seg_end_time)
+{
+	UNIVERSAL_HEADER_m12	*uh;
+
+
+	uh = fps->universal_header;
+	memset((void *) uh->channel_name, 0, BASE_FILE_NAME_BYTES_m12);
+	if (chan_name != NULL)
+		strcpy(uh->channel_name, chan_name);
+	uh->channel_UID = chan_UID;
+	uh->segment_number = seg_num;
+	uh->file_start_time = seg_start_time;
+	uh->segment_end_time = seg_end_time;
+	uh->file_UID = uh->provenance_UID = G_generate_UID_m12(NULL);  // originating files
+
+	return;
+}
+
+
+// segments follow each other without gaps: each lasts its sampled time plus its gaps
+si8	segment_start_time(GEN_PARAMS *gp, si4 seg_idx)
+{
+	sf8	seg_us;
+
+
+	seg_us = (gp->seg_secs + ((sf8) gp->gaps_per_seg * gp->gap_secs)) * (sf8) 1e6;
+
+	return(gp->start_time + (si8) round((sf8) seg_idx * seg_us));
+}
+
+
+// gaps are spread evenly across the segment's blocks, so all channels share them whatever their sampling rates
+si8	block_start_time(GEN_PARAMS *gp, si4 seg_idx, si8 block_idx, si8 n_blocks)
+{
+	si4	i, n_gaps;
+
+
+	for (i = 1, n_gaps = 0; i <= gp->gaps_per_seg; ++i)
+		if ((((si8) i * n_blocks) / (si8) (gp->gaps_per_seg + 1)) <= block_idx)
+			++n_gaps;
+
+	return(segment_start_time(gp, seg_idx) + (si8) round((((sf8) block_idx * gp->block_secs) + ((sf8) n_gaps * gp->gap_secs)) * (sf8) 1e6));
+}
+
+
+TERN_m12	gap_precedes_block(GEN_PARAMS *gp, si8 block_idx, si8 n_blocks)
+{
+	si4	i;
+
+
+	if (block_idx == 0)
+		return(FALSE_m12);
+
+	for (i = 1; i <= gp->gaps_per_seg; ++i)
+		if ((((si8) i * n_blocks) / (si8) (gp->gaps_per_seg + 1)) == block_idx)
+			return(TRUE_m12);
+
+	return(FALSE_m12);
+}
+
+
+// writes one channel segment (metadata, data, & indices), generating & encoding one block at a time
+TERN_m12	write_channel_segment(GEN_PARAMS *gp, FILE_PROCESSING_STRUCT_m12 *proto_fps, si4 chan_idx, ui8 chan_UID, si4 seg_idx)
+{
+	si1					chan_name[BASE_FILE_NAME_BYTES_m12], seg_name[BASE_FILE_NAME_BYTES_m12], seg_path[FULL_FILE_NAME_BYTES_m12];
+	si1					file_path[FULL_FILE_NAME_BYTES_m12], number_str[FILE_NUMBERING_DIGITS_m12 + 1];
+	si8					i, n_blocks, block_samps, seg_samps, n_samps, abs_start_samp, blk_time, seg_start_time, seg_end_time;
+	si8					n_discont, contig_blocks, contig_bytes, contig_samps;
+	sf8					rate;
+	ui8					rng_state;
+	TERN_m12				discont;
+	TIME_SERIES_INDEX_m12			*tsi;
+	TIME_SERIES_METADATA_SECTION_2_m12	*tmd2;
+	CMP_FIXED_BLOCK_HEADER_m12		*bh;
+	CMP_PROCESSING_STRUCT_m12		*cps;
+	FILE_PROCESSING_STRUCT_m12		*md_fps, *data_fps, *idx_fps;
+
+
+	rate = gp->rates[chan_idx % gp->n_rates];
+	block_samps = (si8) round(gp->block_secs * rate);
+	seg_samps = (si8) round(gp->seg_secs * rate);
+	n_blocks = (seg_samps + block_samps - 1) / block_samps;
+	abs_start_samp = (si8) seg_idx * seg_samps;
+	seg_start_time = segment_start_time(gp, seg_idx);
+	seg_end_time = segment_start_time(gp, seg_idx + 1) - 1;
+	rng_state = gp->seed ^ ((ui8) (chan_idx + 1) * (ui8) 0x9E3779B97F4A7C15) ^ ((ui8) (seg_idx + 1) * (ui8) 0xC2B2AE3D27D4EB4F);
+
+	// segment directory
+	sprintf_m12(chan_name, "ch%03d", chan_idx + 1);
+	G_numerical_fixed_width_string_m12(number_str, FILE_NUMBERING_DIGITS_m12, seg_idx + 1);
+	sprintf_m12(seg_name, "%s_s%s", chan_name, number_str);
+	sprintf_m12(seg_path, "%s/%s.%s/%s.%s", gp->session_path, chan_name, TIME_SERIES_CHANNEL_DIRECTORY_TYPE_STRING_m12, seg_name, TIME_SERIES_SEGMENT_DIRECTORY_TYPE_STRING_m12);
+	if (make_directory(seg_path) == FALSE_m12)
+		return(FALSE_m12);
+
+	// data file
+	sprintf_m12(file_path, "%s/%s.%s", seg_path, seg_name, TIME_SERIES_DATA_FILE_TYPE_STRING_m12);
+	data_fps = FPS_allocate_processing_struct_m12(NULL, file_path, TIME_SERIES_DATA_FILE_TYPE_CODE_m12, CMP_MAX_COMPRESSED_BYTES_m12(block_samps, 1), NULL, proto_fps, 0);
+	if (data_fps == NULL)
+		return(FALSE_m12);
+	data_fps->directives.open_mode = FPS_W_OPEN_MODE_m12;
+	data_fps->directives.close_file = FALSE_m12;
+	set_file_header(data_fps, chan_name, chan_UID, seg_idx + 1, seg_start_time, seg_end_time);
+	G_write_file_m12(data_fps, 0, UNIVERSAL_HEADER_BYTES_m12, FPS_UNIVERSAL_HEADER_ONLY_m12, NULL, USE_GLOBAL_BEHAVIOR_m12);
+	cps = CMP_allocate_processing_struct_m12(data_fps, CMP_COMPRESSION_m12, block_samps, CMP_MAX_COMPRESSED_BYTES_m12(block_samps, 1), CMP_MAX_KEYSAMPLE_BYTES_m12(block_samps), (ui4) block_samps, NULL, NULL);
+	if (cps == NULL) {
+		FPS_free_processing_struct_m12(data_fps, TRUE_m12);
+		return(FALSE_m12);
+	}
+	cps->directives.algorithm = CMP_RED_COMPRESSION_m12;
+	cps->directives.encryption_level = gp->enc_level;
+
+	// encode & write blocks
+	md_fps = FPS_allocate_processing_struct_m12(NULL, NULL, TIME_SERIES_METADATA_FILE_TYPE_CODE_m12, METADATA_BYTES_m12, NULL, proto_fps, METADATA_FILE_BYTES_m12);
+	tmd2 = &md_fps->metadata->time_series_section_2;
+	tsi = (TIME_SERIES_INDEX_m12 *) malloc((size_t) (n_blocks + 1) * sizeof(TIME_SERIES_INDEX_m12));
+	n_discont = contig_blocks = contig_bytes = contig_samps = 0;
+	tmd2->maximum_block_bytes = tmd2->maximum_block_samples = 0;
+	tmd2->maximum_contiguous_blocks = tmd2->maximum_contiguous_block_bytes = tmd2->maximum_contiguous_samples = 0;
+	for (i = 0; i < n_blocks; ++i) {
+		n_samps = seg_samps - (i * block_samps);
+		if (n_samps > block_samps)
+			n_samps = block_samps;
+		blk_time = block_start_time(gp, seg_idx, i, n_blocks);
+		discont = ((seg_idx == 0 && i == 0) || gap_precedes_block(gp, i, n_blocks) == TRUE_m12) ? TRUE_m12 : FALSE_m12;
+
+		generate_samples(cps->input_buffer, n_samps, abs_start_samp + (i * block_samps), rate, chan_idx, &rng_state);
+		CMP_encode_m12(data_fps, blk_time, chan_idx + 1, (ui4) n_samps);
+		bh = cps->block_header;
+		if (discont == TRUE_m12) {  // flag set after encoding, so block CRC is recalculated
+			bh->block_flags |= CMP_BF_DISCONTINUITY_MASK_m12;
+			bh->block_CRC = CRC_calculate_m12((ui1 *) bh + CMP_BLOCK_CRC_START_OFFSET_m12, (si8) bh->total_block_bytes - CMP_BLOCK_CRC_START_OFFSET_m12);
+		}
+
+		// index (negative file offset marks a discontinuity)
+		tsi[i].file_offset = (discont == TRUE_m12) ? -data_fps->parameters.flen : data_fps->parameters.flen;
+		tsi[i].start_time = blk_time;
+		tsi[i].start_sample_number = i * block_samps;  // segment relative
+		G_write_file_m12(data_fps, FPS_APPEND_m12, (size_t) bh->total_block_bytes, (size_t) 1, (void *) bh, USE_GLOBAL_BEHAVIOR_m12);
+
+		// block statistics
+		if (discont == TRUE_m12) {
+			++n_discont;
+			contig_blocks = contig_bytes = contig_samps = 0;
+		}
+		++contig_blocks;
+		contig_bytes += (si8) bh->total_block_bytes;
+		contig_samps += n_samps;
+		if ((si8) bh->total_block_bytes > tmd2->maximum_block_bytes)
+			tmd2->maximum_block_bytes = (si8) bh->total_block_bytes;
+		if (n_samps > (si8) tmd2->maximum_block_samples)
+			tmd2->maximum_block_samples = (ui4) n_samps;
+		if (contig_blocks > tmd2->maximum_contiguous_blocks)
+			tmd2->maximum_contiguous_blocks = contig_blocks;
+		if (contig_bytes > tmd2->maximum_contiguous_block_bytes)
+			tmd2->maximum_contiguous_block_bytes = contig_bytes;
+		if (contig_samps > tmd2->maximum_contiguous_samples)
+			tmd2->maximum_contiguous_samples = contig_samps;
+	}
+
+	// terminal index
+	tsi[n_blocks].file_offset = data_fps->parameters.flen;
+	tsi[n_blocks].start_time = seg_end_time + 1;
+	tsi[n_blocks].start_sample_number = seg_samps;
+
+	// close data file
+	data_fps->universal_header->number_of_entries = n_blocks;
+	data_fps->universal_header->maximum_entry_size = tmd2->maximum_block_samples;
+	G_write_file_m12(data_fps, 0, 0, FPS_CLOSE_m12, NULL, USE_GLOBAL_BEHAVIOR_m12);
+	FPS_free_processing_struct_m12(data_fps, TRUE_m12);  // frees its CMP processing struct
+
+	// indices file
+	sprintf_m12(file_path, "%s/%s.%s", seg_path, seg_name, TIME_SERIES_INDICES_FILE_TYPE_STRING_m12);
+	idx_fps = FPS_allocate_processing_struct_m12(NULL, file_path, TIME_SERIES_INDICES_FILE_TYPE_CODE_m12, TIME_SERIES_INDEX_BYTES_m12, NULL, proto_fps, 0);
+	idx_fps->directives.open_mode = FPS_W_OPEN_MODE_m12;
+	idx_fps->directives.close_file = FALSE_m12;
+	set_file_header(idx_fps, chan_name, chan_UID, seg_idx + 1, seg_start_time, seg_end_time);
+	idx_fps->universal_header->number_of_entries = n_blocks + 1;
+	idx_fps->universal_header->maximum_entry_size = 1;
+	G_write_file_m12(idx_fps, 0, UNIVERSAL_HEADER_BYTES_m12, FPS_UNIVERSAL_HEADER_ONLY_m12, NULL, USE_GLOBAL_BEHAVIOR_m12);
+	G_write_file_m12(idx_fps, FPS_APPEND_m12, (size_t) TIME_SERIES_INDEX_BYTES_m12, (size_t) (n_blocks + 1), (void *) tsi, USE_GLOBAL_BEHAVIOR_m12);
+	G_write_file_m12(idx_fps, 0, 0, FPS_CLOSE_m12, NULL, USE_GLOBAL_BEHAVIOR_m12);
+	FPS_free_processing_struct_m12(idx_fps, TRUE_m12);
+	free((void *) tsi);
+
+	// metadata file
+	sprintf_m12(file_path, "%s/%s.%s", seg_path, seg_name, TIME_SERIES_METADATA_FILE_TYPE_STRING_m12);
+	strcpy(md_fps->full_file_name, file_path);
+	md_fps->directives.open_mode = FPS_W_OPEN_MODE_m12;
+	md_fps->directives.close_file = FALSE_m12;
+	set_file_header(md_fps, chan_name, chan_UID, seg_idx + 1, seg_start_time, seg_end_time);
+	md_fps->universal_header->number_of_entries = 1;
+	md_fps->universal_header->maximum_entry_size = METADATA_BYTES_m12;
+	tmd2->sampling_frequency = rate;
+	tmd2->high_frequency_filter_setting = rate / 4.0;
+	tmd2->acquisition_channel_number = chan_idx + 1;
+	tmd2->absolute_start_sample_number = abs_start_samp;
+	tmd2->number_of_samples = seg_samps;
+	tmd2->number_of_blocks = n_blocks;
+	tmd2->maximum_block_keysample_bytes = CMP_MAX_KEYSAMPLE_BYTES_m12(tmd2->maximum_block_samples);
+	tmd2->maximum_block_duration = gp->block_secs * (sf8) 1e6;
+	tmd2->number_of_discontinuities = n_discont;
+	G_write_file_m12(md_fps, 0, UNIVERSAL_HEADER_BYTES_m12, FPS_UNIVERSAL_HEADER_ONLY_m12, NULL, USE_GLOBAL_BEHAVIOR_m12);
+	G_write_file_m12(md_fps, FPS_APPEND_m12, (size_t) METADATA_BYTES_m12, (size_t) 1, (void *) md_fps->metadata, USE_GLOBAL_BEHAVIOR_m12);
+	G_write_file_m12(md_fps, 0, 0, FPS_CLOSE_m12, NULL, USE_GLOBAL_BEHAVIOR_m12);
+	FPS_free_processing_struct_m12(md_fps, TRUE_m12);
+
+	return(TRUE_m12);
+}
+
+
+// two sinusoids (10 Hz & 3.3 Hz, phase varies with channel) plus uniform noise, continuous across blocks & segments
+void	generate_samples(si4 *samps, si8 n_samps, si8 start_samp, sf8 rate, si4 chan_idx, ui8 *rng_state)
+{
+	si8	i;
+	sf8	t, phase, val;
+
+
+	phase = (sf8) chan_idx * 0.7;
+	for (i = 0; i < n_samps; ++i) {
+		t = (sf8) (start_samp + i) / rate;
+		val = GEN_SIGNAL_AMPLITUDE * ((0.6 * sin((2.0 * M_PI * 10.0 * t) + phase)) + (0.4 * sin(2.0 * M_PI * 3.3 * t)));
+		val += GEN_NOISE_AMPLITUDE * ((2.0 * uniform_random(rng_state)) - 1.0);
+		samps[i] = (si4) lround(val);
+	}
+
+	return;
+}
+
+
+// writes record indices & data files: seg_num 0 writes session records (in dir), otherwise segmented session records (dir is the records directory)
+TERN_m12	write_records(GEN_PARAMS *gp, FILE_PROCESSING_STRUCT_m12 *proto_fps, si1 *dir, si1 *file_base, si4 seg_num, si8 seg_start_time, si8 seg_end_time, GEN_RECORD *recs, si8 n_recs)
+{
+	ui1				*record_bytes;
+	si1				ri_file[FULL_FILE_NAME_BYTES_m12], rd_file[FULL_FILE_NAME_BYTES_m12], number_str[FILE_NUMBERING_DIGITS_m12 + 1];
+	si4				uh_seg_num;
+	si8				i, rec_bytes, max_rec_bytes;
+	RECORD_INDEX_m12		ri;
+	RECORD_HEADER_m12		*rh;
+	FILE_PROCESSING_STRUCT_m12	*ri_fps, *rd_fps;
+
+
+	if (seg_num == 0) {
+		sprintf_m12(ri_file, "%s/%s.%s", dir, file_base, RECORD_INDICES_FILE_TYPE_STRING_m12);
+		sprintf_m12(rd_file, "%s/%s.%s", dir, file_base, RECORD_DATA_FILE_TYPE_STRING_m12);
+		uh_seg_num = UNIVERSAL_HEADER_SESSION_LEVEL_CODE_m12;
+	} else {
+		G_numerical_fixed_width_string_m12(number_str, FILE_NUMBERING_DIGITS_m12, seg_num);
+		sprintf_m12(ri_file, "%s/%s_s%s.%s", dir, file_base, number_str, RECORD_INDICES_FILE_TYPE_STRING_m12);
+		sprintf_m12(rd_file, "%s/%s_s%s.%s", dir, file_base, number_str, RECORD_DATA_FILE_TYPE_STRING_m12);
+		uh_seg_num = seg_num;
+	}
+
+	ri_fps = FPS_allocate_processing_struct_m12(NULL, ri_file, RECORD_INDICES_FILE_TYPE_CODE_m12, RECORD_INDEX_BYTES_m12, NULL, proto_fps, 0);
+	rd_fps = FPS_allocate_processing_struct_m12(NULL, rd_file, RECORD_DATA_FILE_TYPE_CODE_m12, REC_LARGEST_RECORD_BYTES_m12, NULL, proto_fps, 0);
+	if (ri_fps == NULL || rd_fps == NULL)
+		return(FALSE_m12);
+	ri_fps->directives.open_mode = rd_fps->directives.open_mode = FPS_W_OPEN_MODE_m12;
+	ri_fps->directives.close_file = rd_fps->directives.close_file = FALSE_m12;
+	set_file_header(ri_fps, NULL, UID_NO_ENTRY_m12, uh_seg_num, seg_start_time, seg_end_time);
+	set_file_header(rd_fps, NULL, UID_NO_ENTRY_m12, uh_seg_num, seg_start_time, seg_end_time);
+	G_write_file_m12(ri_fps, 0, UNIVERSAL_HEADER_BYTES_m12, FPS_UNIVERSAL_HEADER_ONLY_m12, NULL, USE_GLOBAL_BEHAVIOR_m12);
+	G_write_file_m12(rd_fps, 0, UNIVERSAL_HEADER_BYTES_m12, FPS_UNIVERSAL_HEADER_ONLY_m12, NULL, USE_GLOBAL_BEHAVIOR_m12);
+
+	// write records (already in time order)
+	record_bytes = (ui1 *) calloc((size_t) (RECORD_HEADER_BYTES_m12 + REC_LARGEST_RECORD_BYTES_m12), sizeof(ui1));
+	rh = (RECORD_HEADER_m12 *) record_bytes;
+	max_rec_bytes = 0;
+	for (i = 0; i < n_recs; ++i) {
+		rec_bytes = build_record(recs + i, (recs[i].type_code == REC_Sgmt_TYPE_CODE_m12) ? NO_ENCRYPTION_m12 : gp->enc_level, record_bytes);
+		if (rec_bytes > max_rec_bytes)
+			max_rec_bytes = rec_bytes;
+		ri.file_offset = rd_fps->parameters.flen;
+		ri.start_time = rh->start_time;
+		ri.type_code = rh->type_code;
+		ri.version_major = rh->version_major;
+		ri.version_minor = rh->version_minor;
+		ri.encryption_level = -rh->encryption_level;
+		G_write_file_m12(ri_fps, FPS_APPEND_m12, (size_t) INDEX_BYTES_m12, (size_t) 1, (void *) &ri, USE_GLOBAL_BEHAVIOR_m12);
+		G_write_file_m12(rd_fps, FPS_APPEND_m12, (size_t) rec_bytes, (size_t) 1, (void *) record_bytes, USE_GLOBAL_BEHAVIOR_m12);
+	}
+
+	// write terminal index
+	ri.file_offset = rd_fps->parameters.flen;
+	ri.start_time = seg_end_time + 1;
+	ri.type_code = REC_Term_TYPE_CODE_m12;
+	ri.version_major = 0xFF;
+	ri.version_minor = 0xFF;
+	ri.encryption_level = NO_ENCRYPTION_m12;
+	G_write_file_m12(ri_fps, FPS_APPEND_m12, INDEX_BYTES_m12, 1, &ri, USE_GLOBAL_BEHAVIOR_m12);
+
+	// update headers & close
+	ri_fps->universal_header->number_of_entries = n_recs + 1;
+	ri_fps->universal_header->maximum_entry_size = 1;
+	rd_fps->universal_header->number_of_entries = n_recs;
+	rd_fps->universal_header->maximum_entry_size = max_rec_bytes;
+	G_write_file_m12(ri_fps, 0, 0, FPS_CLOSE_m12, NULL, USE_GLOBAL_BEHAVIOR_m12);
+	G_write_file_m12(rd_fps, 0, 0, FPS_CLOSE_m12, NULL, USE_GLOBAL_BEHAVIOR_m12);
+
+	// clean up
+	free((void *) record_bytes);
+	FPS_free_processing_struct_m12(ri_fps, TRUE_m12);
+	FPS_free_processing_struct_m12(rd_fps, TRUE_m12);
+
+	return(TRUE_m12);
+}
+
+
+// builds record (header & padded body) in buffer, returns total record bytes
+// as in add_record_exec.c, the header's encryption level is negative: records are encrypted when written
+si8	build_record(GEN_RECORD *rec, si1 enc_level, ui1 *buffer)
+{
+	si1			*rec_str;
+	si8			text_len;
+	RECORD_HEADER_m12	*rh;
+	REC_Seiz_v10_m12	*Seiz_v10;
+	REC_HFOc_v10_m12	*HFOc_v10;
+	REC_Sgmt_v10_m12	*Sgmt_v10;
+
+
+	memset((void *) buffer, 0, (size_t) (RECORD_HEADER_BYTES_m12 + REC_LARGEST_RECORD_BYTES_m12));
+	rh = (RECORD_HEADER_m12 *) buffer;
+	rh->type_code = rec->type_code;
+	rh->version_major = 1;
+	rh->version_minor = 0;
+	rh->start_time = rec->start_time;
+	rh->encryption_level = -enc_level;
+
+	switch (rec->type_code) {
+		case REC_Note_TYPE_CODE_m12:
+			text_len = strlen(rec->text) + 1;  // account for terminal zero
+			rec_str = (si1 *) rh + RECORD_HEADER_BYTES_m12;
+			strcpy(rec_str, rec->text);
+			rh->total_record_bytes = (ui4) G_pad_m12((ui1 *) rec_str, text_len, REC_RECORD_BODY_ALIGNMENT_m12) + RECORD_HEADER_BYTES_m12;
+			break;
+		case REC_Seiz_TYPE_CODE_m12:
+			text_len = (strlen(rec->text) + 1) - REC_Seiz_v10_PAD_BYTES_m12;  // first 8 bytes of string within structure
+			if (text_len < 0)
+				text_len = 0;
+			Seiz_v10 = (REC_Seiz_v10_m12 *) (rh + 1);
+			Seiz_v10->end_time = rec->end_time;
+			strcpy(Seiz_v10->description, rec->text);
+			rh->total_record_bytes = (ui4) G_pad_m12((ui1 *) (rh + 1), REC_Seiz_v10_BYTES_m12 + text_len, REC_RECORD_BODY_ALIGNMENT_m12) + RECORD_HEADER_BYTES_m12;
+			break;
+		case REC_HFOc_TYPE_CODE_m12:
+			HFOc_v10 = (REC_HFOc_v10_m12 *) (rh + 1);
+			HFOc_v10->end_time = rec->end_time;
+			HFOc_v10->start_frequency = (sf4) rec->sampling_frequency;  // lower bound of the event's band
+			HFOc_v10->end_frequency = (sf4) (rec->sampling_frequency * 2.0);
+			rh->total_record_bytes = (ui4) G_pad_m12((ui1 *) (rh + 1), REC_HFOc_v10_BYTES_m12, REC_RECORD_BODY_ALIGNMENT_m12) + RECORD_HEADER_BYTES_m12;
+			break;
+		case REC_Sgmt_TYPE_CODE_m12:
+			Sgmt_v10 = (REC_Sgmt_v10_m12 *) (rh + 1);
+			Sgmt_v10->end_time = rec->end_time;
+			Sgmt_v10->start_sample_number = rec->start_sample_number;
+			Sgmt_v10->end_sample_number = rec->end_sample_number;
+			Sgmt_v10->segment_UID = G_generate_UID_m12(NULL);
+			Sgmt_v10->segment_number = rec->segment_number;
+			Sgmt_v10->acquisition_channel_number = REC_Sgmt_v10_ACQUISITION_CHANNEL_NUMBER_ALL_CHANNELS_m12;
+			Sgmt_v10->sampling_frequency = rec->sampling_frequency;
+			rh->total_record_bytes = (ui4) G_pad_m12((ui1 *) (rh + 1), REC_Sgmt_v10_BYTES_m12, REC_RECORD_BODY_ALIGNMENT_m12) + RECORD_HEADER_BYTES_m12;
+			break;
+	}
+
+	return((si8) rh->total_record_bytes);
+}
+
+
+// Note, Seiz, & HFOc records at random times in the segment (densities are per hour of sampled time), returns number of records (sorted by time)
+si8	generate_segment_records(GEN_PARAMS *gp, si4 seg_idx, GEN_RECORD **recs, ui8 *rng_state)
+{
+	si8		i, n_notes, n_seizures, n_HFOs, n_recs, seg_start_time, seg_us;
+	sf8		seg_hours;
+	GEN_RECORD	*rec;
+
+
+	seg_hours = gp->seg_secs / (sf8) 3600.0;
+	n_notes = (si8) round(gp->notes_per_hour * seg_hours);
+	n_seizures = (si8) round(gp->seizures_per_hour * seg_hours);
+	n_HFOs = (si8) round(gp->HFOs_per_hour * seg_hours);
+	n_recs = n_notes + n_seizures + n_HFOs;
+	*recs = (GEN_RECORD *) calloc((size_t) (n_recs + 1), sizeof(GEN_RECORD));
+	seg_start_time = segment_start_time(gp, seg_idx);
+	seg_us = segment_start_time(gp, seg_idx + 1) - seg_start_time;
+
+	for (i = 0, rec = *recs; i < n_recs; ++i, ++rec) {
+		rec->start_time = seg_start_time + (si8) (uniform_random(rng_state) * (sf8) seg_us);
+		if (i < n_notes) {
+			rec->type_code = REC_Note_TYPE_CODE_m12;
+			rec->end_time = rec->start_time;
+			sprintf_m12(rec->text, "synthetic note %ld (segment %d)", (long) (i + 1), seg_idx + 1);
+		} else if (i < n_notes + n_seizures) {
+			rec->type_code = REC_Seiz_TYPE_CODE_m12;
+			rec->end_time = rec->start_time + (si8) (GEN_SEIZURE_SECONDS * (sf8) 1e6);
+			sprintf_m12(rec->text, "synthetic seizure %ld", (long) (i - n_notes + 1));
+		} else {
+			rec->type_code = REC_HFOc_TYPE_CODE_m12;
+			rec->end_time = rec->start_time + (si8) (GEN_HFO_MILLISECONDS * (sf8) 1e3);
+			rec->sampling_frequency = 80.0 + (uniform_random(rng_state) * 170.0);  // band start: 80 - 250 Hz (ripples & fast ripples)
+		}
+		if (rec->end_time >= seg_start_time + seg_us)
+			rec->end_time = seg_start_time + seg_us - 1;
+	}
+	if (n_recs > 1)
+		qsort((void *) *recs, (size_t) n_recs, sizeof(GEN_RECORD), compare_records);
+
+	return(n_recs);
+}
+
+
+// xorshift64*
+ui8	next_random(ui8 *state)
+{
+	ui8	x;
+
+
+	x = *state;
+	if (x == 0)
+		x = (ui8) 0x9E3779B97F4A7C15;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*state = x;
+
+	return(x * (ui8) 0x2545F4914F6CDD1D);
+}
+
+
+// [0, 1)
+sf8	uniform_random(ui8 *state)
+{
+	return((sf8) (next_random(state) >> 11) * ((sf8) 1.0 / (sf8) ((ui8) 1 << 53)));
+}
+
+
+si4	compare_records(const void *a, const void *b)
+{
+	si8	a_time, b_time;
+
+
+	a_time = ((GEN_RECORD *) a)->start_time;
+	b_time = ((GEN_RECORD *) b)->start_time;
+	if (a_time > b_time)
+		return(1);
+	if (a_time < b_time)
+		return(-1);
+
+	return(0);
+}
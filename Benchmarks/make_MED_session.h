@@ -0,0 +1,76 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+#ifndef MAKE_MED_SESSION_IN
+#define MAKE_MED_SESSION_IN
+
+// Includes
+#include "medlib_m12.h"
+
+// Miscellaneous
+#define GEN_MAX_RATES			32
+#define GEN_DEFAULT_SESSION_NAME	"synthetic"
+#define GEN_DEFAULT_START_TIME		((si8) 1600000000000000)	// 2020-09-13 12:26:40 UTC
+#define GEN_NOTE_TEXT_BYTES		64
+#define GEN_SEIZURE_SECONDS		((sf8) 60.0)
+#define GEN_HFO_MILLISECONDS		((sf8) 50.0)
+#define GEN_SIGNAL_AMPLITUDE		((sf8) 2000.0)	// microvolts (amplitude units conversion factor 1.0)
+#define GEN_NOISE_AMPLITUDE		((sf8) 50.0)
+
+// Generator Parameters
+typedef struct {
+	si1	out_dir[FULL_FILE_NAME_BYTES_m12];
+	si1	session_name[BASE_FILE_NAME_BYTES_m12];
+	si1	session_path[FULL_FILE_NAME_BYTES_m12];
+	si4	n_chans;
+	si4	n_rates;
+	sf8	rates[GEN_MAX_RATES];  // channel i has rate (i % n_rates)
+	si4	n_segs;
+	sf8	seg_secs;  // sampled time per segment (segment durations also include their gaps)
+	sf8	block_secs;
+	si4	gaps_per_seg;
+	sf8	gap_secs;
+	sf8	notes_per_hour;
+	sf8	seizures_per_hour;
+	sf8	HFOs_per_hour;
+	si1	enc_level;  // time series data & records (0: none, 1: level 1, 2: level 2)
+	si1	level_1_password[PASSWORD_BYTES_m12 + 1];
+	si1	level_2_password[PASSWORD_BYTES_m12 + 1];
+	si8	start_time;
+	ui8	seed;
+	ui8	session_UID;
+	ui8	*segment_UIDs;
+} GEN_PARAMS;
+
+// Generated Record (before encoding)
+typedef struct {
+	si8	start_time;
+	si8	end_time;
+	ui4	type_code;
+	si4	segment_number;  // Sgmt records
+	sf8	sampling_frequency;  // Sgmt records
+	si8	start_sample_number;  // Sgmt records
+	si8	end_sample_number;  // Sgmt records
+	si1	text[GEN_NOTE_TEXT_BYTES];  // Note & Seiz records
+} GEN_RECORD;
+
+
+// Prototypes
+si4				parse_generator_options(si4 argc, si1 **argv, GEN_PARAMS *gp);
+FILE_PROCESSING_STRUCT_m12	*build_prototype(GEN_PARAMS *gp);
+TERN_m12			make_directory(si1 *path);
+void				set_file_header(FILE_PROCESSING_STRUCT_m12 *fps, si1 *chan_name, ui8 chan_UID, si4 seg_num, si8 seg_start_time, si8 seg_end_time);
+si8				segment_start_time(GEN_PARAMS *gp, si4 seg_idx);
+si8				block_start_time(GEN_PARAMS *gp, si4 seg_idx, si8 block_idx, si8 n_blocks);
+TERN_m12			gap_precedes_block(GEN_PARAMS *gp, si8 block_idx, si8 n_blocks);
+TERN_m12			write_channel_segment(GEN_PARAMS *gp, FILE_PROCESSING_STRUCT_m12 *proto_fps, si4 chan_idx, ui8 chan_UID, si4 seg_idx);
+void				generate_samples(si4 *samps, si8 n_samps, si8 start_samp, sf8 rate, si4 chan_idx, ui8 *rng_state);
+TERN_m12			write_records(GEN_PARAMS *gp, FILE_PROCESSING_STRUCT_m12 *proto_fps, si1 *dir, si1 *file_base, si4 seg_num, si8 seg_start_time, si8 seg_end_time, GEN_RECORD *recs, si8 n_recs);
+si8				build_record(GEN_RECORD *rec, si1 enc_level, ui1 *buffer);
+si8				generate_segment_records(GEN_PARAMS *gp, si4 seg_idx, GEN_RECORD **recs, ui8 *rng_state);
+ui8				next_random(ui8 *state);
+sf8				uniform_random(ui8 *state);
+si4				compare_records(const void *a, const void *b);
+
+
+#endif /* MAKE_MED_SESSION_IN */
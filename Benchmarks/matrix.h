@@ -0,0 +1,6 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Matlab declares the mx API in matrix.h (included by mex.h): the stub declares both in mex.h
+
+#include "mex.h"
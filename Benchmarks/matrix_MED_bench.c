@@ -0,0 +1,212 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Benchmark: matrix_MED_exec, run from the command line through its mexFunction() with the stub mx API (mx_shim.c)
+// Sweeps channel counts, window lengths, matrix sample counts, sample formats, & filters. Each repetition builds the matrix of the next window of the session
+// (paged, as a viewer would), & rows report samples/s, MB/s (matrix samples returned), latency percentiles, & peak resident memory.
+// --persist reads through one persistent session (open, read pages by handle, close), otherwise each read opens & closes the session.
+
+//*************************************************************************************************************************************************** Compile Line ****************************************************************************************************************************************************//
+//****  cc -O3 -DMATLAB_m12 -I. -I.. matrix_MED_bench.c bench_util.c mx_shim.c ../matrix_MED_exec.c ../prefetch.c ../session_registry.c ../stage_timing.c ../record_journal.c ../record_merge.c ../record_edit.c ../record_args.c ../record_query.c ../record_table.c ../medlib_m12.c ../medrec_m12.c ../dhnlib_m12.c -lm -lpthread  ****//
+//*********************************************************************************************************************************************************************************************************************************************************************************************************************//
+//	usage: matrix_MED_bench session_directory [--channels 1,4,16] [--windows 1,10,60 (seconds)] [--samples 1000,10000 (per channel)] [--formats double,int16]
+//			[--filters antialias,none,bandpass] [--low 1 (Hz)] [--high 40 (Hz)] [--reps 10] [--persist] [--password password] [--csv file]
+
+
+#include "bench_util.h"
+
+#define NUMBER_OF_MPS_FIELDS	28
+#define MPS_FIELD_NAMES { \
+	"Data", "SampDimMode", "SampDim", "ExtMode", "Start", "End", "TimeMode", "Pass", "IdxChan", "Filt", "LowCut", "HighCut", "Scale", "Format", \
+	"Padding", "Interp", "Binterp", "Persist", "Detrend", "Ranges", "Extrema", "Records", "Contigua", "ChanNames", "ChanFreqs", "Prefetch", "Handle", "Timing" \
+}
+
+
+mxArray	*call_matrix_MED(mxArray *mps)
+{
+	mxArray		*plhs[1];
+	const mxArray	*prhs[1];
+
+
+	plhs[0] = NULL;
+	prhs[0] = mps;
+	mexFunction(1, plhs, 1, prhs);
+
+	return(plhs[0]);
+}
+
+
+si4	main(si4 argc, si1 **argv)
+{
+	const si1	*mps_fields[NUMBER_OF_MPS_FIELDS] = MPS_FIELD_NAMES;
+	si1		*session_dir, *password, *csv_path, **chan_paths;
+	si1		**chan_list, **win_list, **samp_list, **fmt_list, **filt_list;
+	si4		i, c, w, s, f, t, n_avail, n_chans, n_ch_items, n_win_items, n_samp_items, n_fmt_items, n_filt_items, reps, r;
+	si8		samples, bytes, n_samps;
+	sf8		low_cut, high_cut, win_secs, t0;
+	TERN_m12	persist;
+	FILE		*csv_fp;
+	mxArray		*mps, *matrix, *handle;
+	BENCH_RESULT	result;
+
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s session_directory [--channels 1,4,16] [--windows 1,10,60] [--samples 1000,10000] [--formats double,int16]\n", argv[0]);
+		fprintf(stderr, "\t\t[--filters antialias,none,bandpass] [--low 1] [--high 40] [--reps 10] [--persist] [--password password] [--csv file]\n");
+		return(1);
+	}
+
+	// defaults
+	session_dir = argv[1];
+	n_ch_items = bench_parse_list("1,4,16", &chan_list);
+	n_win_items = bench_parse_list("1,10,60", &win_list);
+	n_samp_items = bench_parse_list("1000,10000", &samp_list);
+	n_fmt_items = bench_parse_list("double,int16", &fmt_list);
+	n_filt_items = bench_parse_list("antialias,none,bandpass", &filt_list);
+	low_cut = 1.0;
+	high_cut = 40.0;
+	reps = BENCH_DEFAULT_REPS;
+	persist = FALSE_m12;
+	password = csv_path = NULL;
+
+	// options
+	for (i = 2; i < argc; ++i) {
+		if (strcmp(argv[i], "--persist") == 0) {
+			persist = TRUE_m12;
+			continue;
+		}
+		if (i + 1 == argc) {
+			fprintf(stderr, "%s needs a value\n", argv[i]);
+			return(1);
+		}
+		if (strcmp(argv[i], "--channels") == 0) {
+			bench_free_list(chan_list, n_ch_items);
+			n_ch_items = bench_parse_list(argv[++i], &chan_list);
+		} else if (strcmp(argv[i], "--windows") == 0) {
+			bench_free_list(win_list, n_win_items);
+			n_win_items = bench_parse_list(argv[++i], &win_list);
+		} else if (strcmp(argv[i], "--samples") == 0) {
+			bench_free_list(samp_list, n_samp_items);
+			n_samp_items = bench_parse_list(argv[++i], &samp_list);
+		} else if (strcmp(argv[i], "--formats") == 0) {
+			bench_free_list(fmt_list, n_fmt_items);
+			n_fmt_items = bench_parse_list(argv[++i], &fmt_list);
+		} else if (strcmp(argv[i], "--filters") == 0) {
+			bench_free_list(filt_list, n_filt_items);
+			n_filt_items = bench_parse_list(argv[++i], &filt_list);
+		} else if (strcmp(argv[i], "--low") == 0) {
+			low_cut = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--high") == 0) {
+			high_cut = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--reps") == 0) {
+			reps = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--password") == 0) {
+			password = argv[++i];
+		} else if (strcmp(argv[i], "--csv") == 0) {
+			csv_path = argv[++i];
+		} else {
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return(1);
+		}
+	}
+	if (reps < 1)
+		reps = 1;
+
+	n_avail = bench_list_channels(session_dir, &chan_paths);
+	if (n_avail == 0) {
+		fprintf(stderr, "no time series channels in %s\n", session_dir);
+		return(1);
+	}
+	csv_fp = (csv_path == NULL) ? NULL : bench_open_csv(csv_path);
+	result.latencies = (sf8 *) calloc((size_t) reps, sizeof(sf8));
+	strcpy(result.gateway, (persist == TRUE_m12) ? "matrix_MED persist" : "matrix_MED");
+	result.reps = reps;
+
+	bench_print_header();
+	for (c = 0; c < n_ch_items; ++c) {
+		n_chans = atoi(chan_list[c]);
+		if (n_chans < 1 || n_chans > n_avail) {
+			fprintf(stderr, "skipping %d channels (session has %d)\n", n_chans, n_avail);
+			continue;
+		}
+		for (w = 0; w < n_win_items; ++w) {
+			win_secs = atof(win_list[w]);
+			for (s = 0; s < n_samp_items; ++s) {
+				n_samps = atoll(samp_list[s]);
+				for (f = 0; f < n_fmt_items; ++f) {
+					for (t = 0; t < n_filt_items; ++t) {
+						mps = bench_param_struct(mps_fields, NUMBER_OF_MPS_FIELDS);
+						bench_set_field(mps, "Data", bench_channel_cell(chan_paths, n_chans));
+						bench_set_field(mps, "SampDimMode", mxCreateString("count"));
+						bench_set_field(mps, "SampDim", mxCreateDoubleScalar((sf8) n_samps));
+						bench_set_field(mps, "ExtMode", mxCreateString("time"));
+						bench_set_field(mps, "TimeMode", mxCreateString("duration"));
+						if (password != NULL)
+							bench_set_field(mps, "Pass", mxCreateString(password));
+						bench_set_field(mps, "Filt", mxCreateString(filt_list[t]));
+						if (strcmp(filt_list[t], "none") && strcmp(filt_list[t], "antialias")) {
+							bench_set_field(mps, "LowCut", mxCreateDoubleScalar(low_cut));
+							bench_set_field(mps, "HighCut", mxCreateDoubleScalar(high_cut));
+						}
+						bench_set_field(mps, "Format", mxCreateString(fmt_list[f]));
+
+						// open persistent session (not timed)
+						if (persist == TRUE_m12) {
+							bench_set_field(mps, "Persist", mxCreateString("open"));
+							handle = call_matrix_MED(mps);  // "open" returns the handle only
+							if (mxIsNumeric(handle) == false || mxIsEmpty(handle) == true) {
+								fprintf(stderr, "matrix_MED 'open' returned no handle\n");
+								return(1);
+							}
+							bench_set_field(mps, "Handle", handle);
+							bench_set_field(mps, "Persist", mxCreateString("read"));
+						}
+
+						// read consecutive windows (negative times are relative to session start)
+						bench_reset_peak_rss();
+						result.samples = result.bytes = 0;
+						for (r = 0; r < reps; ++r) {
+							bench_set_field(mps, "Start", mxCreateDoubleScalar(-((sf8) r * win_secs * 1e6) - 1.0));
+							bench_set_field(mps, "End", mxCreateDoubleScalar(-((sf8) (r + 1) * win_secs * 1e6)));
+							t0 = bench_seconds();
+							matrix = call_matrix_MED(mps);
+							result.latencies[r] = bench_seconds() - t0;
+							if (mxIsStruct(matrix) == false) {
+								fprintf(stderr, "matrix_MED failed (repetition %d)\n", r + 1);
+								return(1);
+							}
+							samples = bench_count_samples(mxGetField(matrix, 0, "samples"), &bytes);
+							mxDestroyArray(matrix);
+							result.samples += samples;
+							result.bytes += bytes;
+						}
+						result.peak_rss = bench_peak_rss();
+
+						if (persist == TRUE_m12) {
+							bench_set_field(mps, "Persist", mxCreateString("close"));
+							mxDestroyArray(call_matrix_MED(mps));
+						}
+						mxDestroyArray(mps);
+
+						snprintf(result.config, 256, "ch=%d win=%gs samps=%ld fmt=%s filt=%s", n_chans, win_secs, (long) n_samps, fmt_list[f], filt_list[t]);
+						bench_report(&result, csv_fp);
+					}
+				}
+			}
+		}
+	}
+
+	// clean up
+	mex_shim_unload();
+	if (csv_fp != NULL)
+		fclose(csv_fp);
+	free((void *) result.latencies);
+	bench_free_list(chan_paths, n_avail);
+	bench_free_list(chan_list, n_ch_items);
+	bench_free_list(win_list, n_win_items);
+	bench_free_list(samp_list, n_samp_items);
+	bench_free_list(fmt_list, n_fmt_items);
+	bench_free_list(filt_list, n_filt_items);
+
+	return(0);
+}
@@ -0,0 +1,110 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Stub mx & mex API, so the gateways can be built & run without Matlab (benchmarks only: see mx_shim.c)
+// Arrays are column major, with char arrays stored as single byte characters. Only the functions the gateways use are provided.
+
+#ifndef MX_SHIM_IN
+#define MX_SHIM_IN
+
+// Includes
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+
+// Types
+typedef size_t		mwSize;
+typedef size_t		mwIndex;
+typedef bool		mxLogical;
+typedef char		mxChar;
+
+typedef enum {
+	mxUNKNOWN_CLASS = 0,
+	mxCELL_CLASS,
+	mxSTRUCT_CLASS,
+	mxLOGICAL_CLASS,
+	mxCHAR_CLASS,
+	mxVOID_CLASS,
+	mxDOUBLE_CLASS,
+	mxSINGLE_CLASS,
+	mxINT8_CLASS,
+	mxUINT8_CLASS,
+	mxINT16_CLASS,
+	mxUINT16_CLASS,
+	mxINT32_CLASS,
+	mxUINT32_CLASS,
+	mxINT64_CLASS,
+	mxUINT64_CLASS,
+	mxFUNCTION_CLASS
+} mxClassID;
+
+typedef enum {
+	mxREAL = 0,
+	mxCOMPLEX
+} mxComplexity;
+
+typedef struct mxArray_tag {
+	mxClassID		classid;
+	mwSize			m, n;
+	void			*data;  // numeric, logical, & char elements
+	int			n_fields;  // structs
+	char			**field_names;
+	struct mxArray_tag	**elements;  // struct fields (element major), or cells
+} mxArray;
+
+
+// Prototypes
+mxArray		*mxCreateNumericArray(mwSize ndim, const mwSize *dims, mxClassID classid, mxComplexity flag);
+mxArray		*mxCreateNumericMatrix(mwSize m, mwSize n, mxClassID classid, mxComplexity flag);
+mxArray		*mxCreateDoubleMatrix(mwSize m, mwSize n, mxComplexity flag);
+mxArray		*mxCreateDoubleScalar(double value);
+mxArray		*mxCreateLogicalScalar(mxLogical value);
+mxArray		*mxCreateString(const char *str);
+mxArray		*mxCreateStructMatrix(mwSize m, mwSize n, int nfields, const char **fieldnames);
+mxArray		*mxCreateCellMatrix(mwSize m, mwSize n);
+mxArray		*mxCreateCellArray(mwSize ndim, const mwSize *dims);
+mxArray		*mxDuplicateArray(const mxArray *pa);
+void		mxDestroyArray(mxArray *pa);
+mxClassID	mxGetClassID(const mxArray *pa);
+mwSize		mxGetM(const mxArray *pa);
+mwSize		mxGetN(const mxArray *pa);
+void		mxSetM(mxArray *pa, mwSize m);
+void		mxSetN(mxArray *pa, mwSize n);
+mwSize		mxGetNumberOfElements(const mxArray *pa);
+mwSize		mxGetElementSize(const mxArray *pa);
+bool		mxIsEmpty(const mxArray *pa);
+bool		mxIsStruct(const mxArray *pa);
+bool		mxIsCell(const mxArray *pa);
+bool		mxIsChar(const mxArray *pa);
+bool		mxIsNumeric(const mxArray *pa);
+bool		mxIsScalar(const mxArray *pa);
+bool		mxIsLogicalScalar(const mxArray *pa);
+bool		mxIsLogicalScalarTrue(const mxArray *pa);
+void		*mxGetData(const mxArray *pa);
+void		mxSetData(mxArray *pa, void *data);
+double		*mxGetPr(const mxArray *pa);
+double		mxGetScalar(const mxArray *pa);
+int		mxGetString(const mxArray *pa, char *buf, mwSize buflen);
+int		mxGetNumberOfFields(const mxArray *pa);
+int		mxGetFieldNumber(const mxArray *pa, const char *name);
+mxArray		*mxGetFieldByNumber(const mxArray *pa, mwIndex i, int fieldnum);
+mxArray		*mxGetField(const mxArray *pa, mwIndex i, const char *name);
+void		mxSetFieldByNumber(mxArray *pa, mwIndex i, int fieldnum, mxArray *value);
+void		mxSetField(mxArray *pa, mwIndex i, const char *name, mxArray *value);
+mxArray		*mxGetCell(const mxArray *pa, mwIndex i);
+void		mxSetCell(mxArray *pa, mwIndex i, mxArray *value);
+void		*mxMalloc(mwSize n);
+void		mxFree(void *ptr);
+void		mexMakeMemoryPersistent(void *ptr);
+void		mexErrMsgTxt(const char *msg);
+int		mexPrintf(const char *fmt, ...);
+int		mexEvalString(const char *cmd);
+int		mexAtExit(void (*exit_f)(void));
+void		mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+void		mex_shim_unload(void);
+
+
+#endif /* MX_SHIM_IN */
@@ -0,0 +1,580 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Stub mx & mex API
+// Lets the benchmark drivers link a gateway (e.g. read_MED_exec.c) & call its mexFunction() from the command line, without Matlab.
+// Arrays are plain heap allocations: there is no garbage collection, so drivers destroy the arrays the gateway returns.
+// mxSetFieldByNumber(), mxSetCell(), & mxSetData() do not free the values they replace (Matlab does not either).
+// mexErrMsgTxt() prints the message & exits (Matlab unwinds to the prompt). mex_shim_unload() runs the gateway's mexAtExit() function.
+
+
+#include "mex.h"
+
+// Globals
+static void	(*shim_exit_f)(void) = NULL;
+
+
+static mwSize	class_element_size(mxClassID classid)
+{
+	switch (classid) {
+		case mxLOGICAL_CLASS:
+			return(sizeof(mxLogical));
+		case mxCHAR_CLASS:
+			return(sizeof(mxChar));
+		case mxDOUBLE_CLASS:
+		case mxINT64_CLASS:
+		case mxUINT64_CLASS:
+			return(8);
+		case mxSINGLE_CLASS:
+		case mxINT32_CLASS:
+		case mxUINT32_CLASS:
+			return(4);
+		case mxINT16_CLASS:
+		case mxUINT16_CLASS:
+			return(2);
+		case mxINT8_CLASS:
+		case mxUINT8_CLASS:
+			return(1);
+		case mxCELL_CLASS:
+		case mxSTRUCT_CLASS:
+			return(sizeof(mxArray *));
+		default:
+			return(0);
+	}
+}
+
+
+static mxArray	*new_array(mxClassID classid, mwSize m, mwSize n)
+{
+	mxArray	*pa;
+
+
+	pa = (mxArray *) calloc((size_t) 1, sizeof(mxArray));
+	if (pa == NULL)
+		mexErrMsgTxt("mx_shim: out of memory");
+	pa->classid = classid;
+	pa->m = m;
+	pa->n = n;
+
+	return(pa);
+}
+
+
+mxArray	*mxCreateNumericMatrix(mwSize m, mwSize n, mxClassID classid, mxComplexity flag)
+{
+	mxArray	*pa;
+
+
+	if (flag != mxREAL)
+		mexErrMsgTxt("mx_shim: complex arrays are not supported");
+	pa = new_array(classid, m, n);
+	if ((m * n) > 0) {
+		pa->data = calloc((size_t) (m * n), (size_t) class_element_size(classid));
+		if (pa->data == NULL)
+			mexErrMsgTxt("mx_shim: out of memory");
+	}
+
+	return(pa);
+}
+
+
+// dimensions beyond the second are folded into the columns
+mxArray	*mxCreateNumericArray(mwSize ndim, const mwSize *dims, mxClassID classid, mxComplexity flag)
+{
+	mwSize	i, n;
+
+
+	if (ndim == 0)
+		return(mxCreateNumericMatrix(0, 0, classid, flag));
+	for (i = 2, n = (ndim > 1) ? dims[1] : 1; i < ndim; ++i)
+		n *= dims[i];
+
+	return(mxCreateNumericMatrix(dims[0], n, classid, flag));
+}
+
+
+mxArray	*mxCreateDoubleMatrix(mwSize m, mwSize n, mxComplexity flag)
+{
+	return(mxCreateNumericMatrix(m, n, mxDOUBLE_CLASS, flag));
+}
+
+
+mxArray	*mxCreateDoubleScalar(double value)
+{
+	mxArray	*pa;
+
+
+	pa = mxCreateNumericMatrix(1, 1, mxDOUBLE_CLASS, mxREAL);
+	*((double *) pa->data) = value;
+
+	return(pa);
+}
+
+
+mxArray	*mxCreateLogicalScalar(mxLogical value)
+{
+	mxArray	*pa;
+
+
+	pa = mxCreateNumericMatrix(1, 1, mxLOGICAL_CLASS, mxREAL);
+	*((mxLogical *) pa->data) = value;
+
+	return(pa);
+}
+
+
+mxArray	*mxCreateString(const char *str)
+{
+	mwSize	len;
+	mxArray	*pa;
+
+
+	if (str == NULL)
+		str = "";
+	len = (mwSize) strlen(str);
+	pa = mxCreateNumericMatrix((len) ? 1 : 0, len, mxCHAR_CLASS, mxREAL);
+	if (len)
+		memcpy(pa->data, (void *) str, (size_t) len);
+
+	return(pa);
+}
+
+
+mxArray	*mxCreateStructMatrix(mwSize m, mwSize n, int nfields, const char **fieldnames)
+{
+	int	i;
+	mxArray	*pa;
+
+
+	pa = new_array(mxSTRUCT_CLASS, m, n);
+	pa->n_fields = nfields;
+	pa->field_names = (char **) calloc((size_t) (nfields + 1), sizeof(char *));
+	for (i = 0; i < nfields; ++i)
+		pa->field_names[i] = strdup(fieldnames[i]);
+	pa->elements = (mxArray **) calloc((size_t) ((m * n * nfields) + 1), sizeof(mxArray *));
+
+	return(pa);
+}
+
+
+mxArray	*mxCreateCellMatrix(mwSize m, mwSize n)
+{
+	mxArray	*pa;
+
+
+	pa = new_array(mxCELL_CLASS, m, n);
+	pa->elements = (mxArray **) calloc((size_t) ((m * n) + 1), sizeof(mxArray *));
+
+	return(pa);
+}
+
+
+mxArray	*mxCreateCellArray(mwSize ndim, const mwSize *dims)
+{
+	mwSize	i, n;
+
+
+	if (ndim == 0)
+		return(mxCreateCellMatrix(0, 0));
+	for (i = 2, n = (ndim > 1) ? dims[1] : 1; i < ndim; ++i)
+		n *= dims[i];
+
+	return(mxCreateCellMatrix(dims[0], n));
+}
+
+
+mxArray	*mxDuplicateArray(const mxArray *pa)
+{
+	mwSize	i, n_elements;
+	mxArray	*dup;
+
+
+	if (pa == NULL)
+		return(NULL);
+
+	switch (pa->classid) {
+		case mxSTRUCT_CLASS:
+			dup = mxCreateStructMatrix(pa->m, pa->n, pa->n_fields, (const char **) pa->field_names);
+			n_elements = pa->m * pa->n * (mwSize) pa->n_fields;
+			break;
+		case mxCELL_CLASS:
+			dup = mxCreateCellMatrix(pa->m, pa->n);
+			n_elements = pa->m * pa->n;
+			break;
+		default:
+			dup = mxCreateNumericMatrix(pa->m, pa->n, pa->classid, mxREAL);
+			if ((pa->m * pa->n) > 0)
+				memcpy(dup->data, pa->data, (size_t) (pa->m * pa->n * class_element_size(pa->classid)));
+			return(dup);
+	}
+	for (i = 0; i < n_elements; ++i)
+		dup->elements[i] = mxDuplicateArray(pa->elements[i]);
+
+	return(dup);
+}
+
+
+void	mxDestroyArray(mxArray *pa)
+{
+	int	i;
+	mwSize	j, n_elements;
+
+
+	if (pa == NULL)
+		return;
+
+	n_elements = 0;
+	if (pa->classid == mxSTRUCT_CLASS)
+		n_elements = pa->m * pa->n * (mwSize) pa->n_fields;
+	else if (pa->classid == mxCELL_CLASS)
+		n_elements = pa->m * pa->n;
+	for (j = 0; j < n_elements; ++j)
+		mxDestroyArray(pa->elements[j]);
+	if (pa->elements != NULL)
+		free((void *) pa->elements);
+	if (pa->field_names != NULL) {
+		for (i = 0; i < pa->n_fields; ++i)
+			free((void *) pa->field_names[i]);
+		free((void *) pa->field_names);
+	}
+	if (pa->data != NULL)
+		free(pa->data);
+	free((void *) pa);
+
+	return;
+}
+
+
+mxClassID	mxGetClassID(const mxArray *pa)
+{
+	return((pa == NULL) ? mxUNKNOWN_CLASS : pa->classid);
+}
+
+
+mwSize	mxGetM(const mxArray *pa)
+{
+	return(pa->m);
+}
+
+
+mwSize	mxGetN(const mxArray *pa)
+{
+	return(pa->n);
+}
+
+
+// like Matlab, does not reallocate: callers only shrink arrays
+void	mxSetM(mxArray *pa, mwSize m)
+{
+	pa->m = m;
+
+	return;
+}
+
+
+void	mxSetN(mxArray *pa, mwSize n)
+{
+	pa->n = n;
+
+	return;
+}
+
+
+mwSize	mxGetNumberOfElements(const mxArray *pa)
+{
+	return(pa->m * pa->n);
+}
+
+
+mwSize	mxGetElementSize(const mxArray *pa)
+{
+	return(class_element_size(pa->classid));
+}
+
+
+bool	mxIsEmpty(const mxArray *pa)
+{
+	return((pa == NULL || pa->m * pa->n == 0) ? true : false);
+}
+
+
+bool	mxIsStruct(const mxArray *pa)
+{
+	return((pa != NULL && pa->classid == mxSTRUCT_CLASS) ? true : false);
+}
+
+
+bool	mxIsCell(const mxArray *pa)
+{
+	return((pa != NULL && pa->classid == mxCELL_CLASS) ? true : false);
+}
+
+
+bool	mxIsChar(const mxArray *pa)
+{
+	return((pa != NULL && pa->classid == mxCHAR_CLASS) ? true : false);
+}
+
+
+bool	mxIsNumeric(const mxArray *pa)
+{
+	if (pa == NULL)
+		return(false);
+
+	return((pa->classid >= mxDOUBLE_CLASS && pa->classid <= mxUINT64_CLASS) ? true : false);
+}
+
+
+bool	mxIsScalar(const mxArray *pa)
+{
+	return((pa != NULL && pa->m == 1 && pa->n == 1) ? true : false);
+}
+
+
+bool	mxIsLogicalScalar(const mxArray *pa)
+{
+	return((mxIsScalar(pa) == true && pa->classid == mxLOGICAL_CLASS) ? true : false);
+}
+
+
+bool	mxIsLogicalScalarTrue(const mxArray *pa)
+{
+	if (mxIsLogicalScalar(pa) == false)
+		return(false);
+
+	return(*((mxLogical *) pa->data));
+}
+
+
+void	*mxGetData(const mxArray *pa)
+{
+	return(pa->data);
+}
+
+
+// the array takes ownership of data (mxMalloc()ed), the replaced data is not freed (Matlab does not either)
+void	mxSetData(mxArray *pa, void *data)
+{
+	pa->data = data;
+
+	return;
+}
+
+
+double	*mxGetPr(const mxArray *pa)
+{
+	return((double *) pa->data);
+}
+
+
+double	mxGetScalar(const mxArray *pa)
+{
+	if (mxIsEmpty(pa) == true)
+		return(0.0);
+
+	switch (pa->classid) {
+		case mxDOUBLE_CLASS:
+			return(*((double *) pa->data));
+		case mxSINGLE_CLASS:
+			return((double) *((float *) pa->data));
+		case mxLOGICAL_CLASS:
+			return((double) *((mxLogical *) pa->data));
+		case mxCHAR_CLASS:
+			return((double) *((unsigned char *) pa->data));
+		case mxINT8_CLASS:
+			return((double) *((int8_t *) pa->data));
+		case mxUINT8_CLASS:
+			return((double) *((uint8_t *) pa->data));
+		case mxINT16_CLASS:
+			return((double) *((int16_t *) pa->data));
+		case mxUINT16_CLASS:
+			return((double) *((uint16_t *) pa->data));
+		case mxINT32_CLASS:
+			return((double) *((int32_t *) pa->data));
+		case mxUINT32_CLASS:
+			return((double) *((uint32_t *) pa->data));
+		case mxINT64_CLASS:
+			return((double) *((int64_t *) pa->data));
+		case mxUINT64_CLASS:
+			return((double) *((uint64_t *) pa->data));
+		default:
+			return(0.0);
+	}
+}
+
+
+// returns 0 on success, 1 if not a char array or truncated (as Matlab does)
+int	mxGetString(const mxArray *pa, char *buf, mwSize buflen)
+{
+	mwSize	len;
+
+
+	if (buflen == 0)
+		return(1);
+	if (mxIsChar(pa) == false) {
+		*buf = 0;
+		return(1);
+	}
+
+	len = pa->m * pa->n;
+	if (len >= buflen) {
+		memcpy((void *) buf, pa->data, (size_t) (buflen - 1));
+		buf[buflen - 1] = 0;
+		return(1);
+	}
+	if (len)
+		memcpy((void *) buf, pa->data, (size_t) len);
+	buf[len] = 0;
+
+	return(0);
+}
+
+
+int	mxGetNumberOfFields(const mxArray *pa)
+{
+	return((mxIsStruct(pa) == true) ? pa->n_fields : 0);
+}
+
+
+int	mxGetFieldNumber(const mxArray *pa, const char *name)
+{
+	int	i;
+
+
+	for (i = 0; i < mxGetNumberOfFields(pa); ++i)
+		if (strcmp(pa->field_names[i], name) == 0)
+			return(i);
+
+	return(-1);
+}
+
+
+mxArray	*mxGetFieldByNumber(const mxArray *pa, mwIndex i, int fieldnum)
+{
+	if (mxIsStruct(pa) == false || fieldnum < 0 || fieldnum >= pa->n_fields || i >= pa->m * pa->n)
+		return(NULL);
+
+	return(pa->elements[(i * (mwIndex) pa->n_fields) + (mwIndex) fieldnum]);
+}
+
+
+mxArray	*mxGetField(const mxArray *pa, mwIndex i, const char *name)
+{
+	return(mxGetFieldByNumber(pa, i, mxGetFieldNumber(pa, name)));
+}
+
+
+void	mxSetFieldByNumber(mxArray *pa, mwIndex i, int fieldnum, mxArray *value)
+{
+	if (mxIsStruct(pa) == false || fieldnum < 0 || fieldnum >= pa->n_fields || i >= pa->m * pa->n)
+		mexErrMsgTxt("mx_shim: mxSetFieldByNumber() index out of range");
+
+	pa->elements[(i * (mwIndex) pa->n_fields) + (mwIndex) fieldnum] = value;
+
+	return;
+}
+
+
+void	mxSetField(mxArray *pa, mwIndex i, const char *name, mxArray *value)
+{
+	mxSetFieldByNumber(pa, i, mxGetFieldNumber(pa, name), value);
+
+	return;
+}
+
+
+mxArray	*mxGetCell(const mxArray *pa, mwIndex i)
+{
+	if (mxIsCell(pa) == false || i >= pa->m * pa->n)
+		return(NULL);
+
+	return(pa->elements[i]);
+}
+
+
+void	mxSetCell(mxArray *pa, mwIndex i, mxArray *value)
+{
+	if (mxIsCell(pa) == false || i >= pa->m * pa->n)
+		mexErrMsgTxt("mx_shim: mxSetCell() index out of range");
+
+	pa->elements[i] = value;
+
+	return;
+}
+
+
+// Matlab memory is plain heap memory here (arrays free their data with free())
+void	*mxMalloc(mwSize n)
+{
+	void	*ptr;
+
+
+	ptr = malloc((size_t) n);
+	if (ptr == NULL && n > 0)
+		mexErrMsgTxt("mx_shim: out of memory");
+
+	return(ptr);
+}
+
+
+void	mxFree(void *ptr)
+{
+	free(ptr);
+
+	return;
+}
+
+
+// no garbage collection: all memory persists
+void	mexMakeMemoryPersistent(void *ptr)
+{
+	return;
+}
+
+
+void	mexErrMsgTxt(const char *msg)
+{
+	fprintf(stderr, "%s\n", msg);
+	fflush(stderr);
+	exit(1);
+}
+
+
+int	mexPrintf(const char *fmt, ...)
+{
+	int	ret;
+	va_list	args;
+
+
+	va_start(args, fmt);
+	ret = vprintf(fmt, args);
+	va_end(args);
+
+	return(ret);
+}
+
+
+// no interpreter: commands are ignored
+int	mexEvalString(const char *cmd)
+{
+	return(0);
+}
+
+
+int	mexAtExit(void (*exit_f)(void))
+{
+	shim_exit_f = exit_f;
+
+	return(0);
+}
+
+
+// equivalent of "clear mex": frees what the gateway keeps between calls
+void	mex_shim_unload(void)
+{
+	if (shim_exit_f != NULL)
+		(*shim_exit_f)();
+	shim_exit_f = NULL;
+
+	return;
+}
@@ -0,0 +1,229 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Benchmark: read_MED_exec, run from the command line through its mexFunction() with the stub mx API (mx_shim.c)
+// Sweeps channel counts, window lengths, sample formats, & filters. Each repetition reads the next window of the session (paged, as a viewer would),
+// & rows report samples/s, MB/s (samples returned), latency percentiles, & peak resident memory.
+// --persist reads through one persistent session (open, read pages by handle, close), otherwise each read opens & closes the session.
+
+//********************************************************************************************************************************************************************* Compile Line **********************************************************************************************************************************************************************//
+//****  cc -O3 -DMATLAB_m12 -I. -I.. read_MED_bench.c bench_util.c mx_shim.c ../read_MED_exec.c ../sample_conversion.c ../work_queue.c ../filter_cache.c ../prefetch.c ../session_registry.c ../block_cache.c ../stage_timing.c ../record_journal.c ../record_merge.c ../record_query.c ../record_table.c ../medlib_m12.c ../medrec_m12.c ../dhnlib_m12.c -lm -lpthread  ****//
+//*********************************************************************************************************************************************************************************************************************************************************************************************************************************************************//
+//	usage: read_MED_bench session_directory [--channels 1,4,16] [--windows 1,10,60 (seconds)] [--formats double,int16] [--filters none,bandpass]
+//			[--low 1 (Hz)] [--high 40 (Hz)] [--reps 10] [--persist] [--password password] [--csv file]
+
+
+#include "bench_util.h"
+
+#define NUMBER_OF_RPS_FIELDS	18
+#define RPS_FIELD_NAMES { \
+	"Data", "ExtMode", "Start", "End", "Pass", "IdxChan", "Format", "Filt", "LowCut", "HighCut", \
+	"Persist", "Metadata", "Records", "Contigua", "Prefetch", "Handle", "BlockCache", "Timing" \
+}
+
+
+mxArray	*call_read_MED(mxArray *rps)
+{
+	mxArray		*plhs[1];
+	const mxArray	*prhs[1];
+
+
+	plhs[0] = NULL;
+	prhs[0] = rps;
+	mexFunction(1, plhs, 1, prhs);
+
+	return(plhs[0]);
+}
+
+
+// returns samples in slice, or -1 if read failed
+si8	count_slice_samples(mxArray *slice, si8 *bytes)
+{
+	si8	samples, chan_samples, chan_bytes;
+	mwIndex	i;
+	mxArray	*chans;
+
+
+	*bytes = 0;
+	if (mxIsStruct(slice) == false)
+		return(-1);
+
+	chans = mxGetField(slice, 0, "channels");
+	if (chans == NULL)
+		return(0);
+	for (i = samples = 0; i < mxGetNumberOfElements(chans); ++i) {
+		chan_samples = bench_count_samples(mxGetField(chans, i, "data"), &chan_bytes);
+		samples += chan_samples;
+		*bytes += chan_bytes;
+	}
+
+	return(samples);
+}
+
+
+si4	main(si4 argc, si1 **argv)
+{
+	const si1	*rps_fields[NUMBER_OF_RPS_FIELDS] = RPS_FIELD_NAMES;
+	si1		*session_dir, *password, *csv_path, **chan_paths;
+	si1		**chan_list, **win_list, **fmt_list, **filt_list;
+	si4		i, c, w, f, t, n_avail, n_chans, n_ch_items, n_win_items, n_fmt_items, n_filt_items, reps, r;
+	si8		samples, bytes;
+	sf8		low_cut, high_cut, win_secs, t0;
+	TERN_m12	persist;
+	FILE		*csv_fp;
+	mxArray		*rps, *slice, *handle;
+	BENCH_RESULT	result;
+
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s session_directory [--channels 1,4,16] [--windows 1,10,60] [--formats double,int16] [--filters none,bandpass]\n", argv[0]);
+		fprintf(stderr, "\t\t[--low 1] [--high 40] [--reps 10] [--persist] [--password password] [--csv file]\n");
+		return(1);
+	}
+
+	// defaults
+	session_dir = argv[1];
+	n_ch_items = bench_parse_list("1,4,16", &chan_list);
+	n_win_items = bench_parse_list("1,10,60", &win_list);
+	n_fmt_items = bench_parse_list("double,int16", &fmt_list);
+	n_filt_items = bench_parse_list("none,bandpass", &filt_list);
+	low_cut = 1.0;
+	high_cut = 40.0;
+	reps = BENCH_DEFAULT_REPS;
+	persist = FALSE_m12;
+	password = csv_path = NULL;
+
+	// options
+	for (i = 2; i < argc; ++i) {
+		if (strcmp(argv[i], "--persist") == 0) {
+			persist = TRUE_m12;
+			continue;
+		}
+		if (i + 1 == argc) {
+			fprintf(stderr, "%s needs a value\n", argv[i]);
+			return(1);
+		}
+		if (strcmp(argv[i], "--channels") == 0) {
+			bench_free_list(chan_list, n_ch_items);
+			n_ch_items = bench_parse_list(argv[++i], &chan_list);
+		} else if (strcmp(argv[i], "--windows") == 0) {
+			bench_free_list(win_list, n_win_items);
+			n_win_items = bench_parse_list(argv[++i], &win_list);
+		} else if (strcmp(argv[i], "--formats") == 0) {
+			bench_free_list(fmt_list, n_fmt_items);
+			n_fmt_items = bench_parse_list(argv[++i], &fmt_list);
+		} else if (strcmp(argv[i], "--filters") == 0) {
+			bench_free_list(filt_list, n_filt_items);
+			n_filt_items = bench_parse_list(argv[++i], &filt_list);
+		} else if (strcmp(argv[i], "--low") == 0) {
+			low_cut = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--high") == 0) {
+			high_cut = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--reps") == 0) {
+			reps = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--password") == 0) {
+			password = argv[++i];
+		} else if (strcmp(argv[i], "--csv") == 0) {
+			csv_path = argv[++i];
+		} else {
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return(1);
+		}
+	}
+	if (reps < 1)
+		reps = 1;
+
+	n_avail = bench_list_channels(session_dir, &chan_paths);
+	if (n_avail == 0) {
+		fprintf(stderr, "no time series channels in %s\n", session_dir);
+		return(1);
+	}
+	csv_fp = (csv_path == NULL) ? NULL : bench_open_csv(csv_path);
+	result.latencies = (sf8 *) calloc((size_t) reps, sizeof(sf8));
+	strcpy(result.gateway, (persist == TRUE_m12) ? "read_MED persist" : "read_MED");
+	result.reps = reps;
+
+	bench_print_header();
+	for (c = 0; c < n_ch_items; ++c) {
+		n_chans = atoi(chan_list[c]);
+		if (n_chans < 1 || n_chans > n_avail) {
+			fprintf(stderr, "skipping %d channels (session has %d)\n", n_chans, n_avail);
+			continue;
+		}
+		for (w = 0; w < n_win_items; ++w) {
+			win_secs = atof(win_list[w]);
+			for (f = 0; f < n_fmt_items; ++f) {
+				for (t = 0; t < n_filt_items; ++t) {
+					rps = bench_param_struct(rps_fields, NUMBER_OF_RPS_FIELDS);
+					bench_set_field(rps, "Data", bench_channel_cell(chan_paths, n_chans));
+					bench_set_field(rps, "ExtMode", mxCreateString("time"));
+					if (password != NULL)
+						bench_set_field(rps, "Pass", mxCreateString(password));
+					bench_set_field(rps, "Format", mxCreateString(fmt_list[f]));
+					bench_set_field(rps, "Filt", mxCreateString(filt_list[t]));
+					if (strcmp(filt_list[t], "none")) {
+						bench_set_field(rps, "LowCut", mxCreateDoubleScalar(low_cut));
+						bench_set_field(rps, "HighCut", mxCreateDoubleScalar(high_cut));
+					}
+					bench_set_field(rps, "Metadata", mxCreateLogicalScalar(true));
+					bench_set_field(rps, "Records", mxCreateLogicalScalar(true));
+					bench_set_field(rps, "Contigua", mxCreateLogicalScalar(true));
+
+					// open persistent session (not timed)
+					if (persist == TRUE_m12) {
+						bench_set_field(rps, "Persist", mxCreateString("open"));
+						handle = call_read_MED(rps);  // "open" returns the handle only
+						if (mxIsNumeric(handle) == false || mxIsEmpty(handle) == true) {
+							fprintf(stderr, "read_MED 'open' returned no handle\n");
+							return(1);
+						}
+						bench_set_field(rps, "Handle", handle);
+						bench_set_field(rps, "Persist", mxCreateString("read"));
+					}
+
+					// read consecutive windows (negative times are relative to session start)
+					bench_reset_peak_rss();
+					result.samples = result.bytes = 0;
+					for (r = 0; r < reps; ++r) {
+						bench_set_field(rps, "Start", mxCreateDoubleScalar(-((sf8) r * win_secs * 1e6) - 1.0));
+						bench_set_field(rps, "End", mxCreateDoubleScalar(-((sf8) (r + 1) * win_secs * 1e6)));
+						t0 = bench_seconds();
+						slice = call_read_MED(rps);
+						result.latencies[r] = bench_seconds() - t0;
+						samples = count_slice_samples(slice, &bytes);
+						mxDestroyArray(slice);
+						if (samples < 0) {
+							fprintf(stderr, "read_MED failed (repetition %d)\n", r + 1);
+							return(1);
+						}
+						result.samples += samples;
+						result.bytes += bytes;
+					}
+					result.peak_rss = bench_peak_rss();
+
+					if (persist == TRUE_m12) {
+						bench_set_field(rps, "Persist", mxCreateString("close"));
+						mxDestroyArray(call_read_MED(rps));
+					}
+					mxDestroyArray(rps);
+
+					snprintf(result.config, 256, "ch=%d win=%gs fmt=%s filt=%s", n_chans, win_secs, fmt_list[f], filt_list[t]);
+					bench_report(&result, csv_fp);
+				}
+			}
+		}
+	}
+
+	// clean up
+	mex_shim_unload();
+	if (csv_fp != NULL)
+		fclose(csv_fp);
+	free((void *) result.latencies);
+	bench_free_list(chan_paths, n_avail);
+	bench_free_list(chan_list, n_ch_items);
+	bench_free_list(win_list, n_win_items);
+	bench_free_list(fmt_list, n_fmt_items);
+	bench_free_list(filt_list, n_filt_items);
+
+	return(0);
+}
@@ -0,0 +1,193 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Microbenchmark: session record assembly, k-way merge of the time ordered record files (merge_session_records()) vs. collecting pointers to every
+// record & sorting them (qsort(), as the gateways' build_session_records() did before the merge)
+// Reports records/s for each, & the number of record start times that differ (must be zero; records with equal times may come out in a different order)
+// A session with 10^6 records: make_MED_session session_directory --channels 1 --segments 24 --segment-seconds 3600 --hfos 41667
+
+//***************************************************************** Compile Line *****************************************************************//
+//****  cc -O3 -I.. record_merge_bench.c ../record_merge.c ../record_journal.c ../medlib_m12.c ../medrec_m12.c ../dhnlib_m12.c -lm -lpthread  ****//
+//************************************************************************************************************************************************//
+//	usage: record_merge_bench session_directory [repetitions (default 10)] [password]
+
+
+#include "record_merge.h"
+#ifdef _MSC_VER
+	#include <windows.h>
+#else
+	#include <time.h>
+#endif
+
+
+sf8	bench_seconds(void)
+{
+#ifdef _MSC_VER
+	LARGE_INTEGER	count, freq;
+
+
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&freq);
+
+	return((sf8) count.QuadPart / (sf8) freq.QuadPart);
+#else
+	struct timespec	ts;
+
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return((sf8) ts.tv_sec + ((sf8) ts.tv_nsec / (sf8) 1e9));
+#endif
+}
+
+
+void	report(const si1 *version, sf8 secs, si8 n_records, si8 mismatches)
+{
+	printf("%-8s %14.0f records/s  %10.3f ms", version, (sf8) n_records / secs, (secs * (sf8) 1e3));
+	if (mismatches >= 0)
+		printf("  %ld mismatches", (long) mismatches);
+	printf("\n");
+}
+
+
+// pointers to every record, with segment journals merged, sorted by time (returns number of records; free journals after using the pointers)
+si8	sort_session_records(SESSION_m12 *sess, RECORD_HEADER_m12 ***rec_ptrs, RECORD_JOURNAL ***rec_journals)
+{
+	si4				n_segs, seg_idx;
+	si8				i, j, k, n_items, tot_recs, n_recs, n_appends, seg_first;
+	ui1				*rd;
+	FILE_PROCESSING_STRUCT_m12	*rd_fps;
+	RECORD_HEADER_m12		**ptrs, **seg_ptrs, *rh;
+	RECORD_JOURNAL			**journals;
+
+
+	n_segs = sess->time_slice.number_of_segments;
+	seg_idx = G_get_segment_index_m12(sess->time_slice.start_segment_number);
+	tot_recs = (sess->record_data_fps == NULL) ? 0 : sess->record_data_fps->number_of_items;
+	if (sess->segmented_sess_recs != NULL) {
+		for (i = 0, j = seg_idx; i < n_segs; ++i, ++j) {
+			rd_fps = sess->segmented_sess_recs->record_data_fps[j];
+			if (rd_fps != NULL)
+				tot_recs += rd_fps->number_of_items;
+		}
+	}
+	journals = read_session_journals(sess, &n_appends);
+	ptrs = (RECORD_HEADER_m12 **) malloc((size_t) (tot_recs + n_appends + 1) * sizeof(RECORD_HEADER_m12 *));
+	seg_ptrs = (RECORD_HEADER_m12 **) malloc((size_t) (tot_recs + 1) * sizeof(RECORD_HEADER_m12 *));
+
+	n_recs = 0;
+	if (sess->record_data_fps != NULL) {
+		rd = sess->record_data_fps->record_data;
+		for (i = sess->record_data_fps->number_of_items; i--;) {
+			rh = (RECORD_HEADER_m12 *) rd;
+			if (excluded_record_type(rh->type_code) == FALSE_m12)
+				ptrs[n_recs++] = rh;
+			rd += rh->total_record_bytes;
+		}
+	}
+	if (sess->segmented_sess_recs != NULL || journals != NULL) {
+		for (i = 0, j = seg_idx; i < n_segs; ++i, ++j) {
+			seg_first = n_recs;
+			rd_fps = (sess->segmented_sess_recs == NULL) ? NULL : sess->segmented_sess_recs->record_data_fps[j];
+			n_items = (rd_fps == NULL) ? 0 : rd_fps->number_of_items;
+			rd = (rd_fps == NULL) ? NULL : rd_fps->record_data;
+			for (k = 0; k < n_items; ++k) {
+				rh = (RECORD_HEADER_m12 *) rd;
+				if (excluded_record_type(rh->type_code) == FALSE_m12)
+					ptrs[n_recs++] = rh;
+				rd += rh->total_record_bytes;
+			}
+			if (journals != NULL && journals[i] != NULL) {  // segment's records are time ordered
+				memcpy((void *) seg_ptrs, (void *) (ptrs + seg_first), (size_t) (n_recs - seg_first) * sizeof(RECORD_HEADER_m12 *));
+				n_recs = seg_first + merge_record_journal(journals[i], seg_ptrs, n_recs - seg_first, ptrs + seg_first, sess->time_slice.start_time, sess->time_slice.end_time);
+			}
+		}
+	}
+	free((void *) seg_ptrs);
+	qsort((void *) ptrs, (size_t) n_recs, sizeof(RECORD_HEADER_m12 *), compare_record_times);
+
+	*rec_ptrs = ptrs;
+	*rec_journals = journals;
+
+	return(n_recs);
+}
+
+
+si4	main(si4 argc, si1 **argv)
+{
+	si1			*password;
+	si4			r, n_reps;
+	si8			i, n_recs, n_merged, mismatches, *ref_times;
+	ui8			flags;
+	sf8			t;
+	RECORD_HEADER_m12	**rec_ptrs, *rh;
+	RECORD_JOURNAL		**journals;
+	RECORD_MERGE		*rm;
+	SESSION_m12		*sess;
+	TIME_SLICE_m12		slice;
+
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s session_directory [repetitions (default 10)] [password]\n", argv[0]);
+		return(1);
+	}
+	n_reps = (argc > 2) ? (si4) atoi(argv[2]) : (si4) 10;
+	if (n_reps < 1)
+		n_reps = 1;
+	password = (argc > 3) ? argv[3] : NULL;
+
+	G_initialize_medlib_m12(FALSE_m12, FALSE_m12);
+	G_initialize_time_slice_m12(&slice);
+	slice.start_time = BEGINNING_OF_TIME_m12;
+	slice.end_time = END_OF_TIME_m12;
+	flags = (LH_READ_SEGMENT_METADATA_m12 | LH_READ_SLICE_SESSION_RECORDS_m12 | LH_READ_SLICE_SEGMENTED_SESS_RECS_m12);
+	sess = G_read_session_m12(NULL, &slice, (void *) argv[1], 0, flags, password);
+	if (sess == NULL) {
+		fprintf(stderr, "cannot open %s\n", argv[1]);
+		return(1);
+	}
+
+	// reference order
+	n_recs = sort_session_records(sess, &rec_ptrs, &journals);
+	ref_times = (si8 *) malloc((size_t) (n_recs + 1) * sizeof(si8));
+	for (i = 0; i < n_recs; ++i)
+		ref_times[i] = rec_ptrs[i]->start_time;
+	free((void *) rec_ptrs);
+	free_session_journals(sess, journals);
+	printf("%ld records, %d segments, %d repetitions\n\n", (long) n_recs, sess->time_slice.number_of_segments, n_reps);
+	if (n_recs == 0) {
+		free((void *) ref_times);
+		G_free_session_m12(sess, TRUE_m12);
+		G_free_globals_m12(TRUE_m12);
+		return(0);
+	}
+
+	// pointer array & qsort
+	t = bench_seconds();
+	for (r = 0; r < n_reps; ++r) {
+		sort_session_records(sess, &rec_ptrs, &journals);
+		free((void *) rec_ptrs);
+		free_session_journals(sess, journals);
+	}
+	report("qsort", bench_seconds() - t, n_recs * (si8) n_reps, -1);
+
+	// k-way merge (records are visited in order, as the gateways fill Matlab records)
+	mismatches = 0;
+	t = bench_seconds();
+	for (r = 0; r < n_reps; ++r) {
+		rm = merge_session_records(sess);
+		for (n_merged = 0; (rh = next_merged_record(rm)) != NULL; ++n_merged)
+			if (n_merged >= n_recs || rh->start_time != ref_times[n_merged])
+				++mismatches;
+		if (n_merged != n_recs)
+			++mismatches;
+		free_record_merge(rm);
+	}
+	report("merge", bench_seconds() - t, n_recs * (si8) n_reps, mismatches);
+
+	free((void *) ref_times);
+	G_free_session_m12(sess, TRUE_m12);
+	G_free_globals_m12(TRUE_m12);
+
+	return(0);
+}
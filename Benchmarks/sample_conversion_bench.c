@@ -0,0 +1,182 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Microbenchmark: sample conversion kernels vs. the original scalar loops in read_MED_exec.c
+// Reports GB/s (bytes read + bytes written) for each kernel at each available instruction set, & checks results match
+
+//*************************************************** Compile Line ***************************************************//
+//****  cc -O3 -I.. sample_conversion_bench.c ../sample_conversion.c ../medlib_m12.c ../dhnlib_m12.c -lm -lpthread  ****//
+//********************************************************************************************************************//
+//	usage: sample_conversion_bench [samples (default 2^26)] [repetitions (default 10)]
+
+
+#include "sample_conversion.h"
+#ifdef _MSC_VER
+	#include <windows.h>
+#else
+	#include <time.h>
+#endif
+
+
+sf8	bench_seconds(void)
+{
+#ifdef _MSC_VER
+	LARGE_INTEGER	count, freq;
+
+
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&freq);
+
+	return((sf8) count.QuadPart / (sf8) freq.QuadPart);
+#else
+	struct timespec	ts;
+
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return((sf8) ts.tv_sec + ((sf8) ts.tv_nsec / (sf8) 1e9));
+#endif
+}
+
+
+// original loops (read_MED_exec.c distribute_and_filter(), before the conversion kernels)
+void	loop_si4_to_sf8(si4 *in, sf8 *out, si8 k)
+{
+	while (k--)
+		*out++ = (sf8) *in++;
+}
+
+
+void	loop_si4_to_sf4(si4 *in, sf4 *out, si8 k)
+{
+	while (k--)
+		*out++ = (sf4) *in++;
+}
+
+
+void	loop_si4_to_si2(si4 *in, si2 *out, si8 k)
+{
+	si4	val, pos_inf, neg_inf;
+
+
+	pos_inf = (si4) POS_INF_SI2_m12;
+	neg_inf = (si4) NEG_INF_SI2_m12;
+	while (k--) {
+		val = *in++;  // curtail overflow
+		if (val > pos_inf)
+			val = POS_INF_SI2_m12;
+		else if (val < neg_inf)
+			val = NEG_INF_SI2_m12;
+		*out++ = (si2) val;
+	}
+}
+
+
+void	report(const si1 *kernel, const si1 *version, sf8 secs, si8 n_samps, si4 in_bytes, si4 out_bytes, si4 reps, TERN_m12 match)
+{
+	sf8	gb;
+
+
+	gb = ((sf8) n_samps * (sf8) (in_bytes + out_bytes) * (sf8) reps) / (sf8) 1e9;
+	printf("%-12s %-10s %8.2f GB/s  %s\n", kernel, version, gb / secs, (match == TRUE_m12) ? "" : "MISMATCH");
+}
+
+
+si4	main(si4 argc, si1 **argv)
+{
+	si1		*set_names[] = { "scalar", "SSE2", "AVX2", "AVX-512" };
+	si2		*si2_ref, *si2_out;
+	si4		*si4_in, *si4_ref, *si4_out, reps, r, set;
+	sf4		*sf4_ref, *sf4_out;
+	si8		i, n_samps;
+	sf8		*sf8_in, *sf8_ref, *sf8_out, t;
+	TERN_m12	match;
+
+
+	n_samps = (argc > 1) ? (si8) strtoll(argv[1], NULL, 10) : ((si8) 1 << 26);
+	reps = (argc > 2) ? (si4) atoi(argv[2]) : 10;
+
+	si4_in = (si4 *) malloc((size_t) n_samps * sizeof(si4));
+	si4_ref = (si4 *) malloc((size_t) n_samps * sizeof(si4));
+	si4_out = (si4 *) malloc((size_t) n_samps * sizeof(si4));
+	sf8_in = (sf8 *) malloc((size_t) n_samps * sizeof(sf8));
+	sf8_ref = (sf8 *) malloc((size_t) n_samps * sizeof(sf8));
+	sf8_out = (sf8 *) malloc((size_t) n_samps * sizeof(sf8));
+	sf4_ref = (sf4 *) malloc((size_t) n_samps * sizeof(sf4));
+	sf4_out = (sf4 *) malloc((size_t) n_samps * sizeof(sf4));
+	si2_ref = (si2 *) malloc((size_t) n_samps * sizeof(si2));
+	si2_out = (si2 *) malloc((size_t) n_samps * sizeof(si2));
+
+	// EEG-like amplitudes with occasional excursions past the si2 range
+	srand(1);
+	for (i = 0; i < n_samps; ++i) {
+		si4_in[i] = (rand() % 20001) - 10000;
+		if ((i % 1000) == 0)
+			si4_in[i] *= 10;
+		sf8_in[i] = (sf8) si4_in[i] + ((sf8) rand() / (sf8) RAND_MAX) - 0.5;
+	}
+
+	printf("%ld samples, %d repetitions\n\n", (long) n_samps, reps);
+
+	// original loops
+	t = bench_seconds();
+	for (r = 0; r < reps; ++r)
+		loop_si4_to_sf8(si4_in, sf8_ref, n_samps);
+	report("si4_to_sf8", "loop", bench_seconds() - t, n_samps, 4, 8, reps, TRUE_m12);
+	t = bench_seconds();
+	for (r = 0; r < reps; ++r)
+		loop_si4_to_sf4(si4_in, sf4_ref, n_samps);
+	report("si4_to_sf4", "loop", bench_seconds() - t, n_samps, 4, 4, reps, TRUE_m12);
+	t = bench_seconds();
+	for (r = 0; r < reps; ++r)
+		loop_si4_to_si2(si4_in, si2_ref, n_samps);
+	report("si4_to_si2", "loop", bench_seconds() - t, n_samps, 4, 2, reps, TRUE_m12);
+	t = bench_seconds();
+	for (r = 0; r < reps; ++r)
+		CMP_sf8_to_si4_m12(sf8_in, si4_ref, n_samps, TRUE_m12);
+	report("sf8_to_si4", "CMP", bench_seconds() - t, n_samps, 8, 4, reps, TRUE_m12);
+	printf("\n");
+
+	// kernels
+	for (set = CONVERSION_SCALAR; set <= CONVERSION_AVX512; ++set) {
+		initialize_conversion_kernels(set);
+		if (strcmp(conversion_instruction_set_string(), set_names[set]))
+			continue;  // not supported by this processor
+
+		t = bench_seconds();
+		for (r = 0; r < reps; ++r)
+			convert_si4_to_sf8(si4_in, sf8_out, n_samps);
+		match = memcmp(sf8_ref, sf8_out, (size_t) n_samps * sizeof(sf8)) ? FALSE_m12 : TRUE_m12;
+		report("si4_to_sf8", set_names[set], bench_seconds() - t, n_samps, 4, 8, reps, match);
+
+		t = bench_seconds();
+		for (r = 0; r < reps; ++r)
+			convert_si4_to_sf4(si4_in, sf4_out, n_samps);
+		match = memcmp(sf4_ref, sf4_out, (size_t) n_samps * sizeof(sf4)) ? FALSE_m12 : TRUE_m12;
+		report("si4_to_sf4", set_names[set], bench_seconds() - t, n_samps, 4, 4, reps, match);
+
+		t = bench_seconds();
+		for (r = 0; r < reps; ++r)
+			convert_si4_to_si2(si4_in, si2_out, n_samps);
+		match = memcmp(si2_ref, si2_out, (size_t) n_samps * sizeof(si2)) ? FALSE_m12 : TRUE_m12;
+		report("si4_to_si2", set_names[set], bench_seconds() - t, n_samps, 4, 2, reps, match);
+
+		t = bench_seconds();
+		for (r = 0; r < reps; ++r)
+			convert_sf8_to_si4(sf8_in, si4_out, n_samps);
+		report("sf8_to_si4", set_names[set], bench_seconds() - t, n_samps, 8, 4, reps, TRUE_m12);
+
+		t = bench_seconds();
+		for (r = 0; r < reps; ++r)
+			convert_sf8_to_sf4(sf8_in, sf4_out, n_samps);
+		report("sf8_to_sf4", set_names[set], bench_seconds() - t, n_samps, 8, 4, reps, TRUE_m12);
+
+		t = bench_seconds();
+		for (r = 0; r < reps; ++r)
+			convert_sf8_to_si2(sf8_in, si2_out, n_samps);
+		report("sf8_to_si2", set_names[set], bench_seconds() - t, n_samps, 8, 2, reps, TRUE_m12);
+		printf("\n");
+	}
+
+	return(0);
+}
@@ -0,0 +1,125 @@
+function catalog = MED_catalog(sessions, varargin)
+
+    %
+    %   MED_catalog() requires 1 to 4 inputs
+    %
+    %   Prototype:
+    %   catalog = MED_catalog(sessions, [password], [max_threads], [max_open_files]);
+    %
+    %   MED_catalog returns a Matlab table with one row per session: path, start_time, end_time, duration (seconds), channels,
+    %   sampling_frequencies, gaps, record counts by type (HFOc, NlxP, Note, Seiz, Sgmt, other), & error (empty if cataloged)
+    %   Sessions with a current manifest are cataloged without opening them; others are opened (headers, metadata, & indices only), & a manifest is written
+    %
+    %   Arguments in square brackets are optional => '[]' will substitute default values
+    %
+    %   Input Arguments:
+    %   sessions:  root directory searched for sessions (.medd), or cell array of sessions and/or root directories
+    %   password:  if empty/absent, proceeds as if unencrypted (but, sessions whose necessary data are encrypted will have an error entry)
+    %   max_threads:  if empty/absent, defaults to 16
+    %   max_open_files:  if empty/absent, defaults to 64 (each thread holds up to 4 files & directories open)
+    %
+    %   Copyright Dark Horse Neuro, 2024
+
+
+    % Enter DEFAULT_PASSWORD here for convenience, if doing so does not violate your privacy requirements
+    DEFAULT_PASSWORD = [];  % put in single quotes to make it char array
+
+    catalog = false;  % failure return value
+
+    if nargin == 0 || nargin > 4 || nargout ~=  1
+        help MED_catalog;
+        return;
+    end
+    
+    % sessions
+    if ischar(sessions) == false
+        if isstring(sessions)
+            sessions = char(sessions);
+        elseif iscell(sessions)
+            for i = 1:numel(sessions)
+                if ischar(sessions{i}) == false
+                    if isstring(sessions{i})
+                        sessions{i} = char(sessions{i});
+                    else
+                        help MED_catalog;
+                        return;
+                   end
+                end
+            end
+        else
+            help MED_catalog;
+            return;
+        end
+    end
+
+    % password
+    if nargin > 1
+        password = varargin{1};
+        if isempty(password) == false
+            if ischar(password) == false
+                if isstring(password)  % mex functions only take strings as char arrays
+                    password = char(password);
+                else
+                    help MED_catalog;
+                    return;
+                end
+            end
+        end
+    else
+        password = DEFAULT_PASSWORD;
+    end
+
+    % max_threads
+    if nargin > 2
+        max_threads = varargin{2};
+    else
+        max_threads = [];
+    end
+
+    % max_open_files
+    if nargin > 3
+        max_open_files = varargin{3};
+    else
+        max_open_files = [];
+    end
+
+    % mex function
+    try
+        sessions = get_full_paths(sessions);
+        catalog = MED_catalog_exec(sessions, password, max_threads, max_open_files);
+        if islogical(catalog)  % false or structure - don't need to check if true
+            errordlg('MED_catalog() error', 'Read MED');
+            return;
+        end
+    catch ME
+        OS = computer;
+        if (strcmp(OS, 'PCWIN64') == 1)
+            DIR_DELIM = '\';
+        else
+            DIR_DELIM = '/';
+        end
+        switch ME.identifier
+            case 'MATLAB:UndefinedFunction'
+                [MED_CATALOG_PATH, ~, ~] = fileparts(which('MED_catalog'));
+                RESOURCES = [MED_CATALOG_PATH DIR_DELIM 'Resources'];
+                addpath(RESOURCES, MED_CATALOG_PATH, '-begin');
+                savepath;
+                msg = ['Added ', RESOURCES, ' to your search path.' newline];
+                beep
+                fprintf(2, '%s', msg);  % 2 == stderr, so red in command window
+                sessions = get_full_paths(sessions);
+                catalog = MED_catalog_exec(sessions, password, max_threads, max_open_files);
+                if islogical(catalog)  % false or structure - don't need to check if true
+                    errordlg('MED_catalog() error', 'Read MED');
+                    return;
+                end
+            otherwise
+                rethrow(ME);
+        end
+    end
+
+    % columns => table rows
+    catalog = struct2table(catalog);
+    
+end
+
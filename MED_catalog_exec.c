@@ -0,0 +1,587 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+
+//******************************************************************** Mex Compile Line *********************************************************************//
+//****  mex COMPFLAGS='$COMPFLAGS -Wall -O3' MED_catalog_exec.c session_manifest.c record_journal.c work_queue.c medlib_m12.c medrec_m12.c dhnlib_m12.c  ****//
+//***********************************************************************************************************************************************************//
+
+
+// catalog = MED_catalog_exec(sessions, [password], [max_threads], [max_open_files])
+// returns Matlab catalog structure: one column per field, one row per session (MED_catalog() converts it to a table)
+
+// Sessions are cataloged in two passes:
+// 1) a bounded pool of workers checks each session's manifest; sessions with a current manifest are cataloged from it directly. The index, metadata, &
+//    record indices files of the others are read into the page cache (each worker holds at most CATALOG_FILES_PER_WORKER files & directories open).
+// 2) sessions without a current manifest are opened one at a time on the calling thread (medlib session state is global), headers, metadata, & indices only,
+//    as in MED_session_stats(), & a manifest is written for them, so later catalogs of the same sessions only take the first pass.
+
+
+#include "MED_catalog_exec.h"
+
+#if defined MACOS_m12 || defined LINUX_m12
+	#include <sys/stat.h>
+	#include <dirent.h>
+#endif
+
+
+// Mex gateway routine
+void    mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[])
+{
+	si1			password[PASSWORD_BYTES_m12 + 1], path[FULL_FILE_NAME_BYTES_m12], **sess_paths;
+	si4			max_threads, max_open_files, len;
+	si8			i, n_inputs, n_sessions, max_sessions;
+	mxArray			*catalog, *mx_cell_p;
+
+
+	PROC_adjust_open_file_limit_m12(MAX_OPEN_FILES_m12(MAX_CHANNELS, 1), FALSE_m12);
+	PROC_increase_process_priority_m12(FALSE_m12, FALSE_m12);
+
+	// check for proper number of arguments
+	if (nlhs != 1)
+		mexErrMsgTxt("One output required: MED catalog structure\n");
+	plhs[0] = mxCreateLogicalScalar((mxLogical) 0);  // set "false" return value for any subsequent errors
+	if (nrhs < 1 || nrhs > 4)
+		mexErrMsgTxt("One to four inputs required: sessions, [password], [max_threads], [max_open_files]\n");
+
+	// check the sessions (argument 1)
+	n_inputs = 0;
+	if (mxIsEmpty(prhs[0]) == 1)
+		mexErrMsgTxt("No sessions specified\n");
+	if (mxGetClassID(prhs[0]) == mxCHAR_CLASS) {
+		if (mxGetNumberOfElements(prhs[0]) + 1 > FULL_FILE_NAME_BYTES_m12)
+			mexErrMsgTxt("'sessions' (input 1) is too long\n");
+	} else if (mxGetClassID(prhs[0]) == mxCELL_CLASS) {
+		n_inputs = (si8) mxGetNumberOfElements(prhs[0]);
+		if (n_inputs == 0)
+			mexErrMsgTxt("'sessions' (input 1) cell array contains no entries\n");
+		for (i = 0; i < n_inputs; ++i) {
+			mx_cell_p = mxGetCell(prhs[0], i);
+			if (mxGetClassID(mx_cell_p) != mxCHAR_CLASS)
+				mexErrMsgTxt("Elements of sessions cell array must be char arrays\n");
+			if (mxGetNumberOfElements(mx_cell_p) + 1 > FULL_FILE_NAME_BYTES_m12)
+				mexErrMsgTxt("'sessions' (input 1) is too long\n");
+		}
+	} else {
+		mexErrMsgTxt("'sessions' (input 1) must be a string or cell array\n");
+	}
+
+	// password
+	*password = 0;
+	if (nrhs > 1) {
+		if (mxIsEmpty(prhs[1]) == 0) {
+			if (mxGetClassID(prhs[1]) == mxCHAR_CLASS) {
+				len = mxGetNumberOfElements(prhs[1]); // Get the length of the input string
+				if (len > (PASSWORD_BYTES_m12))  // allow full 16 bytes for password
+					mexErrMsgTxt("'password' (input 2) is too long\n");
+				else
+					mxGetString(prhs[1], password, len + 1);
+			} else {
+				mexErrMsgTxt("'password' (input 2) must be a string\n");
+			}
+		}
+	}
+
+	// max threads
+	max_threads = CATALOG_DEFAULT_THREADS;
+	if (nrhs > 2) {
+		if (mxIsEmpty(prhs[2]) == 0) {
+			if (mxIsScalar(prhs[2]) == 0 || mxIsNumeric(prhs[2]) == 0)
+				mexErrMsgTxt("'max_threads' (input 3) must be a scalar\n");
+			max_threads = (si4) mxGetScalar(prhs[2]);
+			if (max_threads < 1)
+				mexErrMsgTxt("'max_threads' (input 3) must be at least 1\n");
+		}
+	}
+
+	// max open files
+	max_open_files = CATALOG_DEFAULT_MAX_OPEN_FILES;
+	if (nrhs > 3) {
+		if (mxIsEmpty(prhs[3]) == 0) {
+			if (mxIsScalar(prhs[3]) == 0 || mxIsNumeric(prhs[3]) == 0)
+				mexErrMsgTxt("'max_open_files' (input 4) must be a scalar\n");
+			max_open_files = (si4) mxGetScalar(prhs[3]);
+			if (max_open_files < CATALOG_FILES_PER_WORKER)
+				mexErrMsgTxt("'max_open_files' (input 4) must be at least 4\n");
+		}
+	}
+
+	// initialize MED library
+	G_initialize_medlib_m12(FALSE_m12, FALSE_m12);
+
+	// create session list (inputs that are not session directories are searched for sessions)
+	sess_paths = NULL;
+	n_sessions = max_sessions = 0;
+	if (n_inputs == 0) {
+		mxGetString(prhs[0], path, FULL_FILE_NAME_BYTES_m12);
+		find_sessions(path, &sess_paths, &n_sessions, &max_sessions);
+	} else {
+		for (i = 0; i < n_inputs; ++i) {
+			mx_cell_p = mxGetCell(prhs[0], i);
+			mxGetString(mx_cell_p, path, FULL_FILE_NAME_BYTES_m12);
+			find_sessions(path, &sess_paths, &n_sessions, &max_sessions);
+		}
+	}
+	if (n_sessions == 0) {
+		G_free_globals_m12(TRUE_m12);
+		mexErrMsgTxt("No MED sessions found\n");
+	}
+
+       // get out of here
+	catalog = MED_catalog(sess_paths, n_sessions, max_threads, max_open_files, password);
+	if (catalog != NULL) {
+		mxDestroyArray(plhs[0]);
+		plhs[0] = catalog;
+	}
+
+        // clean up
+	for (i = 0; i < n_sessions; ++i)
+		free((void *) sess_paths[i]);
+	free((void *) sess_paths);
+	G_free_globals_m12(TRUE_m12);
+
+        return;
+}
+
+
+mxArray	*MED_catalog(si1 **sess_paths, si8 n_sessions, si4 max_threads, si4 max_open_files, si1 *password)
+{
+	si4			i, n_workers;
+	si8			j;
+	ui1			**warm_buffers;
+	CATALOG_ENTRY		*entries;
+	CATALOG_TASK		*cat_tasks;
+	WQ_TASK			*tasks;
+	mxArray			*catalog;
+
+
+	entries = (CATALOG_ENTRY *) calloc((size_t) n_sessions, sizeof(CATALOG_ENTRY));
+	for (j = 0; j < n_sessions; ++j)
+		strcpy(entries[j].path, sess_paths[j]);
+
+	// workers bounded by threads & open files
+	n_workers = max_open_files / CATALOG_FILES_PER_WORKER;
+	if (max_threads < n_workers)
+		n_workers = max_threads;
+	if ((si8) n_workers > n_sessions)
+		n_workers = (si4) n_sessions;
+	if (n_workers > WQ_MAX_WORKERS)
+		n_workers = WQ_MAX_WORKERS;
+	if (n_workers < 1)
+		n_workers = 1;
+
+	// pass 1: manifests & page cache (parallel)
+	warm_buffers = (ui1 **) malloc((size_t) n_workers * sizeof(ui1 *));
+	for (i = 0; i < n_workers; ++i)
+		warm_buffers[i] = (ui1 *) malloc((size_t) CATALOG_WARM_BUFFER_BYTES);
+	cat_tasks = (CATALOG_TASK *) malloc((size_t) n_sessions * sizeof(CATALOG_TASK));
+	tasks = (WQ_TASK *) malloc((size_t) n_sessions * sizeof(WQ_TASK));
+	for (j = 0; j < n_sessions; ++j) {
+		cat_tasks[j].entry = entries + j;
+		cat_tasks[j].warm_buffers = warm_buffers;
+		tasks[j].task_f = survey_session;
+		tasks[j].arg = (void *) (cat_tasks + j);
+	}
+	run_work_queue(tasks, n_sessions, n_workers);
+	free((void *) tasks);
+	free((void *) cat_tasks);
+	for (i = 0; i < n_workers; ++i)
+		free((void *) warm_buffers[i]);
+	free((void *) warm_buffers);
+
+	// pass 2: open sessions without a current manifest (serial)
+	for (j = 0; j < n_sessions; ++j)
+		if (entries[j].needs_open == TRUE_m12)
+			open_session_entry(entries + j, password);
+
+	catalog = build_catalog(entries, n_sessions);
+	free((void *) entries);
+
+	return(catalog);
+}
+
+
+// appends root to session list if it is a session directory, otherwise appends the sessions below it (session directories are not descended), returns number found
+si8	find_sessions(si1 *root, si1 ***sess_paths, si8 *n_sessions, si8 *max_sessions)
+{
+	si1		path[FULL_FILE_NAME_BYTES_m12], *ext;
+	si4		len;
+	si8		n_found;
+	TERN_m12	is_dir;
+#if defined MACOS_m12 || defined LINUX_m12
+	DIR		*dir;
+	struct dirent	*entry;
+	struct stat	sb;
+#endif
+#ifdef WINDOWS_m12
+	HANDLE		find_handle;
+	WIN32_FIND_DATAA	find_data;
+#endif
+
+
+	// strip trailing delimiters
+	len = (si4) strlen(root);
+	while (len > 1 && (root[len - 1] == '/' || root[len - 1] == '\\'))
+		root[--len] = 0;
+
+	// session directory
+	ext = strrchr(root, '.');
+	if (ext != NULL && strcmp(ext + 1, SESSION_DIRECTORY_TYPE_STRING_m12) == 0) {
+		if (*n_sessions == *max_sessions) {
+			*max_sessions = (*max_sessions) ? *max_sessions << 1 : 64;
+			*sess_paths = (si1 **) realloc((void *) *sess_paths, (size_t) *max_sessions * sizeof(si1 *));
+		}
+		(*sess_paths)[*n_sessions] = (si1 *) malloc((size_t) FULL_FILE_NAME_BYTES_m12);
+		strcpy((*sess_paths)[(*n_sessions)++], root);
+		return(1);
+	}
+
+	// search subdirectories
+	n_found = 0;
+#if defined MACOS_m12 || defined LINUX_m12
+	dir = opendir(root);
+	if (dir == NULL)
+		return(0);
+	while ((entry = readdir(dir)) != NULL) {
+		if (*entry->d_name == '.')  // ".", "..", & hidden
+			continue;
+		if (strlen(root) + strlen(entry->d_name) + 2 > FULL_FILE_NAME_BYTES_m12)
+			continue;
+		sprintf_m12(path, "%s/%s", root, entry->d_name);
+		is_dir = FALSE_m12;
+		if (entry->d_type == DT_DIR)
+			is_dir = TRUE_m12;
+		else if (entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK)
+			if (stat(path, &sb) == 0 && S_ISDIR(sb.st_mode))
+				is_dir = TRUE_m12;
+#endif
+#ifdef WINDOWS_m12
+	sprintf_m12(path, "%s\\*", root);
+	find_handle = FindFirstFileA(path, &find_data);
+	if (find_handle == INVALID_HANDLE_VALUE)
+		return(0);
+	do {
+		if (*find_data.cFileName == '.')  // ".", "..", & hidden
+			continue;
+		if (strlen(root) + strlen(find_data.cFileName) + 2 > FULL_FILE_NAME_BYTES_m12)
+			continue;
+		sprintf_m12(path, "%s\\%s", root, find_data.cFileName);
+		is_dir = (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) ? TRUE_m12 : FALSE_m12;
+#endif
+		if (is_dir == TRUE_m12)
+			n_found += find_sessions(path, sess_paths, n_sessions, max_sessions);
+#if defined MACOS_m12 || defined LINUX_m12
+	}
+	closedir(dir);
+#endif
+#ifdef WINDOWS_m12
+	} while (FindNextFileA(find_handle, &find_data));
+	FindClose(find_handle);
+#endif
+
+	return(n_found);
+}
+
+
+// work queue task: catalogs session from its manifest, or marks it for opening & reads the files the open will need into the page cache
+void	survey_session(void *arg, si4 worker_id)
+{
+	CATALOG_TASK		*ct;
+	CATALOG_ENTRY		*entry;
+	SESSION_MANIFEST	*sm;
+
+
+	ct = (CATALOG_TASK *) arg;
+	entry = ct->entry;
+
+	sm = load_session_manifest(entry->path);
+	if (sm != NULL) {
+		if (fill_catalog_entry(entry, sm) == TRUE_m12) {
+			free_session_manifest(sm);
+			return;
+		}
+		free_session_manifest(sm);  // manifest of a channel subset: some sampling frequencies unknown
+	}
+
+	entry->needs_open = TRUE_m12;
+	warm_directory(entry->path, 0, ct->warm_buffers[worker_id]);
+
+	return;
+}
+
+
+// reads the metadata, time series indices, & record indices files below a session directory (depth 0) through buf, returns bytes read
+si8	warm_directory(si1 *dir_path, si4 depth, ui1 *buf)
+{
+	si1		path[FULL_FILE_NAME_BYTES_m12], *name, *ext;
+	si8		bytes_read, n_read;
+	TERN_m12	is_dir;
+	FILE		*fp;
+#if defined MACOS_m12 || defined LINUX_m12
+	DIR		*dir;
+	struct dirent	*entry;
+	struct stat	sb;
+#endif
+#ifdef WINDOWS_m12
+	HANDLE		find_handle;
+	WIN32_FIND_DATAA	find_data;
+#endif
+
+
+	bytes_read = 0;
+#if defined MACOS_m12 || defined LINUX_m12
+	dir = opendir(dir_path);
+	if (dir == NULL)
+		return(0);
+	while ((entry = readdir(dir)) != NULL) {
+		name = entry->d_name;
+		if (*name == '.')
+			continue;
+		sprintf_m12(path, "%s/%s", dir_path, name);
+		is_dir = FALSE_m12;
+		if (entry->d_type == DT_DIR)
+			is_dir = TRUE_m12;
+		else if (entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK)
+			if (stat(path, &sb) == 0 && S_ISDIR(sb.st_mode))
+				is_dir = TRUE_m12;
+#endif
+#ifdef WINDOWS_m12
+	sprintf_m12(path, "%s\\*", dir_path);
+	find_handle = FindFirstFileA(path, &find_data);
+	if (find_handle == INVALID_HANDLE_VALUE)
+		return(0);
+	do {
+		name = find_data.cFileName;
+		if (*name == '.')
+			continue;
+		sprintf_m12(path, "%s\\%s", dir_path, name);
+		is_dir = (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) ? TRUE_m12 : FALSE_m12;
+#endif
+		ext = strrchr(name, '.');
+		if (ext == NULL)
+			continue;
+		++ext;
+		if (is_dir == TRUE_m12) {
+			// session => channel & segmented session records directories => segment directories
+			if (depth == 0 && (strcmp(ext, TIME_SERIES_CHANNEL_DIRECTORY_TYPE_STRING_m12) == 0 || strcmp(ext, RECORD_DIRECTORY_TYPE_STRING_m12) == 0))
+				bytes_read += warm_directory(path, 1, buf);
+			else if (depth == 1 && strcmp(ext, TIME_SERIES_SEGMENT_DIRECTORY_TYPE_STRING_m12) == 0)
+				bytes_read += warm_directory(path, 2, buf);
+		} else if (strcmp(ext, TIME_SERIES_METADATA_FILE_TYPE_STRING_m12) == 0 || strcmp(ext, TIME_SERIES_INDICES_FILE_TYPE_STRING_m12) == 0 || \
+			   strcmp(ext, RECORD_INDICES_FILE_TYPE_STRING_m12) == 0) {
+			fp = fopen(path, "rb");
+			if (fp == NULL)
+				continue;
+			while ((n_read = (si8) fread((void *) buf, sizeof(ui1), (size_t) CATALOG_WARM_BUFFER_BYTES, fp)) > 0)
+				bytes_read += n_read;
+			fclose(fp);
+		}
+#if defined MACOS_m12 || defined LINUX_m12
+	}
+	closedir(dir);
+#endif
+#ifdef WINDOWS_m12
+	} while (FindNextFileA(find_handle, &find_data));
+	FindClose(find_handle);
+#endif
+
+	return(bytes_read);
+}
+
+
+// opens session (headers, metadata, & indices only), writes its manifest, & catalogs it; must be called from the calling thread
+void	open_session_entry(CATALOG_ENTRY *entry, si1 *password)
+{
+	ui8			flags;
+	SESSION_m12		*sess;
+	SESSION_MANIFEST	*sm;
+	TIME_SLICE_m12		slice;
+
+
+	G_initialize_time_slice_m12(&slice);
+	slice.start_time = BEGINNING_OF_TIME_m12;
+	slice.end_time = END_OF_TIME_m12;
+	flags = (LH_READ_SEGMENT_METADATA_m12 | LH_MAP_ALL_SEGMENTS_m12);  // as MED_session_stats(): no sample data is read
+	sess = G_open_session_m12(NULL, &slice, (void *) entry->path, 0, flags, password);
+	if (sess == NULL) {
+		strcpy(entry->error, "cannot open session => check the password, and that metadata files exist");
+		G_free_globals_m12(TRUE_m12);  // reset session state for the next session
+		G_initialize_medlib_m12(FALSE_m12, FALSE_m12);
+		return;
+	}
+	G_frequencies_vary_m12(sess);
+
+	// build manifest (the manifest is saved for later catalogs & opens, but cataloged from memory whether or not it could be saved)
+	sm = (SESSION_MANIFEST *) calloc((size_t) 1, sizeof(SESSION_MANIFEST));
+	sm->map = (void *) build_session_manifest(sess);
+	sm->mapped = FALSE_m12;
+	if (sm->map == NULL) {
+		strcpy(entry->error, "cannot read time series indices");
+	} else {
+		sm->map_bytes = ((MANIFEST_HEADER *) sm->map)->file_bytes;
+		save_session_manifest(sess->path, (ui1 *) sm->map);
+		if (attach_session_manifest(sm) == FALSE_m12 || fill_catalog_entry(entry, sm) == FALSE_m12)
+			strcpy(entry->error, "cannot read channel metadata");
+	}
+	free_session_manifest(sm);
+
+	// clean up
+	G_free_session_m12(sess, TRUE_m12);
+	G_free_globals_m12(TRUE_m12);  // reset session state for the next session
+	G_initialize_medlib_m12(FALSE_m12, FALSE_m12);
+
+	return;
+}
+
+
+// returns FALSE_m12 if the manifest does not describe every channel's sampling frequency
+TERN_m12	fill_catalog_entry(CATALOG_ENTRY *entry, SESSION_MANIFEST *sm)
+{
+	si4		i, j;
+	si8		k;
+	sf8		fs;
+	MANIFEST_HEADER	*hdr;
+
+
+	hdr = sm->header;
+
+	// sampling frequencies (distinct, ascending)
+	entry->n_rates = 0;
+	for (i = 0; i < hdr->number_of_channels; ++i) {
+		fs = sm->channels[i].sampling_frequency;
+		if (fs == FREQUENCY_NO_ENTRY_m12 || fs <= 0.0)
+			return(FALSE_m12);
+		for (j = 0; j < entry->n_rates; ++j)
+			if (entry->rates[j] == fs)
+				break;
+		if (j == entry->n_rates && entry->n_rates < CATALOG_MAX_RATES)
+			entry->rates[entry->n_rates++] = fs;
+	}
+	qsort((void *) entry->rates, (size_t) entry->n_rates, sizeof(sf8), compare_rates);
+
+	entry->start_time = hdr->session_start_time;
+	entry->end_time = hdr->session_end_time;
+	entry->n_chans = hdr->number_of_channels;
+	entry->n_gaps = (hdr->number_of_contigua > 0) ? hdr->number_of_contigua - 1 : 0;
+
+	// record counts
+	memset((void *) entry->rec_counts, 0, CATALOG_REC_TYPES * sizeof(si8));
+	for (k = 0; k < hdr->number_of_records; ++k) {
+		switch (sm->records[k].type_code) {
+			case REC_HFOc_TYPE_CODE_m12:
+				++entry->rec_counts[CATALOG_REC_HFOc_IDX];
+				break;
+			case REC_NlxP_TYPE_CODE_m12:
+				++entry->rec_counts[CATALOG_REC_NlxP_IDX];
+				break;
+			case REC_Note_TYPE_CODE_m12:
+				++entry->rec_counts[CATALOG_REC_Note_IDX];
+				break;
+			case REC_Seiz_TYPE_CODE_m12:
+				++entry->rec_counts[CATALOG_REC_Seiz_IDX];
+				break;
+			case REC_Sgmt_TYPE_CODE_m12:
+				++entry->rec_counts[CATALOG_REC_Sgmt_IDX];
+				break;
+			default:
+				++entry->rec_counts[CATALOG_REC_OTHER_IDX];
+				break;
+		}
+	}
+	entry->needs_open = FALSE_m12;
+
+	return(TRUE_m12);
+}
+
+
+mxArray	*build_catalog(CATALOG_ENTRY *entries, si8 n_sessions)
+{
+	si4			i;
+	si8			j, *start_times, *end_times;
+	sf8			*durations, *chans, *gaps, *rec_counts[CATALOG_REC_TYPES], *rates;
+	CATALOG_ENTRY		*entry;
+	mxArray			*catalog, *mat_paths, *mat_rates, *mat_errors, *mat_start_times, *mat_end_times, *mat_durations, *mat_chans, *mat_gaps, *mat_rec_counts[CATALOG_REC_TYPES], *tmp_mxa;
+	const si4		n_mat_catalog_fields = NUMBER_OF_CATALOG_FIELDS_mat;
+	const si1		*mat_catalog_field_names[] = CATALOG_FIELD_NAMES_mat;
+
+
+	catalog = mxCreateStructMatrix(1, 1, n_mat_catalog_fields, mat_catalog_field_names);
+
+	// create columns
+	mat_paths = mxCreateCellMatrix(n_sessions, 1);
+	mat_rates = mxCreateCellMatrix(n_sessions, 1);
+	mat_errors = mxCreateCellMatrix(n_sessions, 1);
+	mat_start_times = mxCreateNumericMatrix(n_sessions, 1, mxINT64_CLASS, mxREAL);
+	start_times = (si8 *) mxGetPr(mat_start_times);
+	mat_end_times = mxCreateNumericMatrix(n_sessions, 1, mxINT64_CLASS, mxREAL);
+	end_times = (si8 *) mxGetPr(mat_end_times);
+	mat_durations = mxCreateDoubleMatrix(n_sessions, 1, mxREAL);
+	durations = mxGetPr(mat_durations);
+	mat_chans = mxCreateDoubleMatrix(n_sessions, 1, mxREAL);
+	chans = mxGetPr(mat_chans);
+	mat_gaps = mxCreateDoubleMatrix(n_sessions, 1, mxREAL);
+	gaps = mxGetPr(mat_gaps);
+	for (i = 0; i < CATALOG_REC_TYPES; ++i) {
+		mat_rec_counts[i] = mxCreateDoubleMatrix(n_sessions, 1, mxREAL);
+		rec_counts[i] = mxGetPr(mat_rec_counts[i]);
+	}
+
+	// fill rows
+	for (j = 0; j < n_sessions; ++j) {
+		entry = entries + j;
+		tmp_mxa = mxCreateString(entry->path);
+		mxSetCell(mat_paths, j, tmp_mxa);
+		tmp_mxa = mxCreateString(entry->error);
+		mxSetCell(mat_errors, j, tmp_mxa);
+		if (*entry->error) {  // not cataloged
+			start_times[j] = end_times[j] = UUTC_NO_ENTRY_m12;
+			durations[j] = chans[j] = gaps[j] = mxGetNaN();
+			for (i = 0; i < CATALOG_REC_TYPES; ++i)
+				rec_counts[i][j] = mxGetNaN();
+			mxSetCell(mat_rates, j, mxCreateDoubleMatrix(1, 0, mxREAL));
+			continue;
+		}
+		start_times[j] = entry->start_time;
+		end_times[j] = entry->end_time;
+		durations[j] = (sf8) ((entry->end_time - entry->start_time) + 1) / (sf8) 1e6;  // seconds
+		chans[j] = (sf8) entry->n_chans;
+		gaps[j] = (sf8) entry->n_gaps;
+		for (i = 0; i < CATALOG_REC_TYPES; ++i)
+			rec_counts[i][j] = (sf8) entry->rec_counts[i];
+		tmp_mxa = mxCreateDoubleMatrix(1, entry->n_rates, mxREAL);
+		rates = mxGetPr(tmp_mxa);
+		for (i = 0; i < entry->n_rates; ++i)
+			rates[i] = entry->rates[i];
+		mxSetCell(mat_rates, j, tmp_mxa);
+	}
+
+	// set fields
+	mxSetFieldByNumber(catalog, 0, CATALOG_FIELDS_PATH_IDX_mat, mat_paths);
+	mxSetFieldByNumber(catalog, 0, CATALOG_FIELDS_START_TIME_IDX_mat, mat_start_times);
+	mxSetFieldByNumber(catalog, 0, CATALOG_FIELDS_END_TIME_IDX_mat, mat_end_times);
+	mxSetFieldByNumber(catalog, 0, CATALOG_FIELDS_DURATION_IDX_mat, mat_durations);
+	mxSetFieldByNumber(catalog, 0, CATALOG_FIELDS_CHANNELS_IDX_mat, mat_chans);
+	mxSetFieldByNumber(catalog, 0, CATALOG_FIELDS_RATES_IDX_mat, mat_rates);
+	mxSetFieldByNumber(catalog, 0, CATALOG_FIELDS_GAPS_IDX_mat, mat_gaps);
+	for (i = 0; i < CATALOG_REC_TYPES; ++i)
+		mxSetFieldByNumber(catalog, 0, CATALOG_FIELDS_RECORDS_IDX_mat + i, mat_rec_counts[i]);
+	mxSetFieldByNumber(catalog, 0, CATALOG_FIELDS_ERROR_IDX_mat, mat_errors);
+
+	return(catalog);
+}
+
+
+si4	compare_rates(const void *a, const void *b)
+{
+	sf8	fa, fb;
+
+
+	fa = *((sf8 *) a);
+	fb = *((sf8 *) b);
+	if (fa > fb)
+		return(1);
+	if (fa < fb)
+		return(-1);
+
+	return(0);
+}
@@ -0,0 +1,89 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+#ifndef MED_CATALOG_IN
+#define MED_CATALOG_IN
+
+// Includes
+#include "medlib_m12.h"
+#include "session_manifest.h"
+#include "work_queue.h"
+
+// Miscellaneous
+#define MAX_CHANNELS				512
+#define CATALOG_DEFAULT_THREADS			16	// I/O bound: more threads than cores helps on network storage
+#define CATALOG_DEFAULT_MAX_OPEN_FILES		64
+#define CATALOG_FILES_PER_WORKER		4	// session, channel, & segment directories, & one file
+#define CATALOG_MAX_RATES			32	// distinct sampling frequencies listed per session
+#define CATALOG_WARM_BUFFER_BYTES		((si8) 1 << 20)
+#define CATALOG_ERROR_BYTES			128
+
+// Record Types Counted (others are counted in "other_records")
+#define CATALOG_REC_TYPES			6
+#define CATALOG_REC_HFOc_IDX			0
+#define CATALOG_REC_NlxP_IDX			1
+#define CATALOG_REC_Note_IDX			2
+#define CATALOG_REC_Seiz_IDX			3
+#define CATALOG_REC_Sgmt_IDX			4
+#define CATALOG_REC_OTHER_IDX			5
+
+// Matlab Catalog Structure (one column per field, one row per session)
+#define NUMBER_OF_CATALOG_FIELDS_mat		14
+#define CATALOG_FIELD_NAMES_mat { \
+	"path", \
+	"start_time", \
+	"end_time", \
+	"duration", \
+	"channels", \
+	"sampling_frequencies", \
+	"gaps", \
+	"HFOc_records", \
+	"NlxP_records", \
+	"Note_records", \
+	"Seiz_records", \
+	"Sgmt_records", \
+	"other_records", \
+	"error" \
+}
+#define CATALOG_FIELDS_PATH_IDX_mat		0
+#define CATALOG_FIELDS_START_TIME_IDX_mat	1
+#define CATALOG_FIELDS_END_TIME_IDX_mat		2
+#define CATALOG_FIELDS_DURATION_IDX_mat		3
+#define CATALOG_FIELDS_CHANNELS_IDX_mat		4
+#define CATALOG_FIELDS_RATES_IDX_mat		5
+#define CATALOG_FIELDS_GAPS_IDX_mat		6
+#define CATALOG_FIELDS_RECORDS_IDX_mat		7	// first of CATALOG_REC_TYPES record count columns (same order)
+#define CATALOG_FIELDS_ERROR_IDX_mat		13
+
+// Catalog Structures
+typedef struct {
+	si1		path[FULL_FILE_NAME_BYTES_m12];
+	TERN_m12	needs_open;  // no current manifest: session is opened with medlib (calling thread)
+	si8		start_time, end_time;
+	si4		n_chans;
+	si4		n_rates;
+	sf8		rates[CATALOG_MAX_RATES];
+	si8		n_gaps;
+	si8		rec_counts[CATALOG_REC_TYPES];
+	si1		error[CATALOG_ERROR_BYTES];  // empty if cataloged
+} CATALOG_ENTRY;
+
+typedef struct {
+	CATALOG_ENTRY	*entry;
+	ui1		**warm_buffers;  // one per worker
+} CATALOG_TASK;
+
+
+// Prototypes
+void		mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[]);
+mxArray		*MED_catalog(si1 **sess_paths, si8 n_sessions, si4 max_threads, si4 max_open_files, si1 *password);
+si8		find_sessions(si1 *root, si1 ***sess_paths, si8 *n_sessions, si8 *max_sessions);
+void		survey_session(void *arg, si4 worker_id);
+si8		warm_directory(si1 *dir_path, si4 depth, ui1 *buf);
+void		open_session_entry(CATALOG_ENTRY *entry, si1 *password);
+TERN_m12	fill_catalog_entry(CATALOG_ENTRY *entry, SESSION_MANIFEST *sm);
+mxArray		*build_catalog(CATALOG_ENTRY *entries, si8 n_sessions);
+si4		compare_rates(const void *a, const void *b);
+
+
+#endif /* MED_CATALOG_IN */
@@ -1,11 +1,11 @@
 
-function sample_numbers = MED_sample_for_time(times, MED_directory, varargin)
+function [sample_numbers, channel_names] = MED_sample_for_time(times, MED_directory, varargin)
 
     %
-    %   MED_sample_for_time() requires 2 to 3 inputs
+    %   MED_sample_for_time() requires 2 to 4 inputs
     %
     %   Prototype:
-    %   sample_number(s) = MED_sample_for_time(time(s), MED_directory, [password]);
+    %   [sample_number(s), channel_names] = MED_sample_for_time(time(s), MED_directory, [password], [persist]);
     %
     %   MED_sample_for_time() returns sample number(s) for specified time(s),
     %   in Matlab index schema: (1:n) rather than 0:(n-1)
@@ -15,7 +15,15 @@ function sample_numbers = MED_sample_for_time(times, MED_directory, varargin)
     %   Input Arguments:
     %   time(s):  scalar or array of scalars specifying time(s) ('start' & 'end' are also accepted)
     %   MED_directory:  string specifying channel or session
+    %       cell array of channels, or regex (e.g. 'session.medd/*.ticd'), converts all matching channels in one call
+    %       (e.g. mixed rate micro & macro channels): result is a matrix with a column per channel, in channel_names order
     %   password:  if empty/absent, proceeds as if unencrypted (but, may error out)
+    %   persist:  if empty/absent, defaults to 'none' (options: 'none', 'open', 'close')
+    %       'open' keeps the channels' indices in memory, so later calls with the same MED_directory & password skip opening them
+    %       'close' frees the channels kept for MED_directory (all kept channels if MED_directory is ''), & returns true
+    %
+    %   Output Arguments:
+    %   channel_names:  (optional) cell array of channel names, in result column order
     %         
     %   Copyright Dark Horse Neuro, 2024
 
@@ -24,8 +32,9 @@ function sample_numbers = MED_sample_for_time(times, MED_directory, varargin)
     DEFAULT_PASSWORD = [];  % put in single quotes to make it char array
 
     sample_numbers = false;  % failure return value
+    channel_names = {};
 
-    if nargin < 2 || nargin > 3 || nargout ~=  1
+    if nargin < 2 || nargin > 4 || nargout < 1 || nargout > 2
         help MED_sample_for_time;
         return;
     end
@@ -48,9 +57,9 @@ function sample_numbers = MED_sample_for_time(times, MED_directory, varargin)
     end
 
     % MED_directory
-    if ischar(MED_directory) == false
+    if ischar(MED_directory) == false && iscell(MED_directory) == false
         if isstring(MED_directory)
-            MED_directory = char(MED_directory);
+            MED_directory = cellstr(MED_directory);
         else
             help MED_sample_for_time;
             return;
@@ -58,7 +67,7 @@ function sample_numbers = MED_sample_for_time(times, MED_directory, varargin)
     end
 
     % password
-    if nargin == 3
+    if nargin > 2
         password = varargin{1};
         if isempty(password) == false
             if ischar(password) == false
@@ -73,12 +82,24 @@ function sample_numbers = MED_sample_for_time(times, MED_directory, varargin)
     else
         password = DEFAULT_PASSWORD;
     end
+
+    % persist
+    if nargin > 3
+        persist = varargin{2};
+        if isstring(persist)  % mex functions only take strings as char arrays
+            persist = char(persist);
+        end
+    else
+        persist = [];
+    end
   
     % mex function
     try
-        MED_directory = get_full_paths(MED_directory);
-        sample_numbers = MED_sample_for_time_exec(times, MED_directory, password);
-        if islogical(sample_numbers)  % false or value - don't need to check if true
+        if isempty(MED_directory) == false
+            MED_directory = get_full_paths(MED_directory);
+        end
+        [sample_numbers, channel_names] = MED_sample_for_time_exec(times, MED_directory, password, persist);
+        if islogical(sample_numbers) && sample_numbers == false  % false, value, or true ('close')
             errordlg('MED_sample_for_time() error', 'Read MED');
             return;
         end
@@ -98,9 +119,11 @@ function sample_numbers = MED_sample_for_time(times, MED_directory, varargin)
                 msg = ['Added ', RESOURCES, ' to your search path.' newline];
                 beep
                 fprintf(2, '%s', msg);  % 2 == stderr, so red in command window
-                MED_directory = get_full_paths(MED_directory);
-                sample_numbers = MED_sample_for_time_exec(times, MED_directory, password);
-                if islogical(sample_numbers)  % false or value - don't need to check if true
+                if isempty(MED_directory) == false
+                    MED_directory = get_full_paths(MED_directory);
+                end
+                [sample_numbers, channel_names] = MED_sample_for_time_exec(times, MED_directory, password, persist);
+                if islogical(sample_numbers) && sample_numbers == false  % false, value, or true ('close')
                     errordlg('MED_sample_for_time() error', 'Read MED');
                     return;
                 end
@@ -1,12 +1,13 @@
 function session = MED_session_stats(file_list, varargin)
 
     %
-    %   MED_session_stats() requires 1 to 5 inputs
+    %   MED_session_stats() requires 1 to 6 inputs
     %
     %   Prototype:
-    %   session = MED_session_stats(file_list, [password], [return_channels], [return_contigua], [return_records]);
+    %   session = MED_session_stats(file_list, [password], [return_channels], [return_contigua], [return_records], [return_timing]);
     %
     %   MED_session_stats returns a single Matlab session structure
+    %   Only headers, metadata, records, & time series indices are read (no sample data), so large sessions are summarized quickly
     %
     %   Arguments in square brackets are optional => '[]' will substitute default values
     %
@@ -16,6 +17,7 @@ function session = MED_session_stats(file_list, varargin)
     %   return_channels:  if empty/absent, defaults to false (options: true, false)
     %   return_contigua:  if empty/absent, defaults to false (options: true, false)
     %   return_records:  if empty/absent, defaults to false (options: true, false)
+    %   return_timing:  if empty/absent, defaults to false (options: true, false); session.timing gives wall & CPU seconds of each stage of the call
     %         
     %   Copyright Dark Horse Neuro, 2023
 
@@ -25,7 +27,7 @@ function session = MED_session_stats(file_list, varargin)
 
     session = false;  % failure return value
 
-    if nargin == 0 || nargin > 5 || nargout ~=  1
+    if nargin == 0 || nargin > 6 || nargout ~=  1
         help MED_session_stats;
         return;
     end
@@ -104,10 +106,22 @@ function session = MED_session_stats(file_list, varargin)
         return_records = [];
     end
 
+    % return_timing
+    if nargin > 5
+        return_timing = varargin{5};
+        if isempty(return_timing) == false
+            if isstring(return_timing)  % mex functions only take strings as char arrays
+                return_timing = char(return_timing);
+            end
+        end
+    else
+        return_timing = [];
+    end
+
     % mex function
     try
         file_list = get_full_paths(file_list);
-        session = MED_session_stats_exec(file_list, password, return_channels, return_contigua, return_records);
+        session = MED_session_stats_exec(file_list, password, return_channels, return_contigua, return_records, return_timing);
         if islogical(session)  % false or structure - don't need to check if true
             errordlg('MED_session_stats() error', 'Read MED');
             return;
@@ -129,7 +143,7 @@ function session = MED_session_stats(file_list, varargin)
                 beep
                 fprintf(2, '%s', msg);  % 2 == stderr, so red in command window
                 file_list = get_full_paths(file_list);
-                session = MED_session_stats_exec(file_list, password, return_channels, return_contigua, return_records);
+                session = MED_session_stats_exec(file_list, password, return_channels, return_contigua, return_records, return_timing);
                 if islogical(session)  % false or structure - don't need to check if true
                     errordlg('MED_session_stats() error', 'Read MED');
                     return;
@@ -3,12 +3,12 @@
 // Copyright Dark Horse Neuro Inc, 2023
 
 
-//******************************************** Mex Compile Line *****************************************//
-//****  mex COMPFLAGS='$COMPFLAGS -Wall -O3' read_MED_exec.c medlib_m12.c medrec_m12.c dhnlib_m12.c  ****//
-//*******************************************************************************************************//
+//******************************************************************************** Mex Compile Line ********************************************************************************//
+//****  mex COMPFLAGS='$COMPFLAGS -Wall -O3' MED_session_stats_exec.c stage_timing.c session_manifest.c record_journal.c record_merge.c medlib_m12.c medrec_m12.c dhnlib_m12.c  ****//
+//**********************************************************************************************************************************************************************************//
 
 
-// session = get_session_stats(session_name, [password], [session_records])
+// session = get_session_stats(session_name, [password], [return_channels], [return_contigua], [return_records], [return_timing])
 // returns Matlab session structure
 
 
@@ -18,7 +18,7 @@
 // Mex gateway routine
 void    mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[])
 {
-        TERN_m12                return_channels, return_contigua, return_records;
+        TERN_m12                return_channels, return_contigua, return_records, return_timing;
         si1                     password[PASSWORD_BYTES_m12 + 1], **file_list_p, temp_str[16];
         si4                     i, n_files, len, max_len;
 	void			*file_list, *temp_ptr;
@@ -32,8 +32,8 @@ void    mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[])
 	if (nlhs != 1)
 		mexErrMsgTxt("One output required: MED session structure\n");
 	plhs[0] = mxCreateLogicalScalar((mxLogical) 0);  // set "false" return value for any subsequent errors
-	if (nrhs < 1 || nrhs > 5)
-		mexErrMsgTxt("One to five inputs required: session or channel name, [return_channels], [return_records], [return_contigua], [password]\n");
+	if (nrhs < 1 || nrhs > 6)
+		mexErrMsgTxt("One to six inputs required: session or channel name, [password], [return_channels], [return_contigua], [return_records], [return_timing]\n");
 
 	// get the input file name(s) (argument 1)
 	n_files = max_len = 0;
@@ -157,6 +157,33 @@ void    mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[])
 				mexErrMsgTxt("'return_records' (input 5) can be either true or false (default) only\n");
 		}
 	}
+
+	// return timing
+	return_timing = FALSE_m12;
+	if (nrhs > 5) {
+		if (mxIsEmpty(prhs[5]) == 0) {
+			return_timing = UNKNOWN_m12;
+			if (mxGetClassID(prhs[5]) == mxCHAR_CLASS) {
+				mxGetString(prhs[5], temp_str, 16);
+				if (*temp_str == 't' || *temp_str == 'T' || *temp_str == 'y' || *temp_str == 'Y' || *temp_str == '1')
+					return_timing = TRUE_m12;
+				else if (*temp_str == 'f' || *temp_str == 'F' || *temp_str == 'n' || *temp_str == 'N' || *temp_str == '0')
+					return_timing = FALSE_m12;
+			} else if (mxIsLogicalScalar(prhs[5])) {
+				if (mxIsLogicalScalarTrue(prhs[5]) == 1)
+					return_timing = TRUE_m12;
+				else
+					return_timing = FALSE_m12;
+			} else if (mxIsScalar(prhs[5])) {
+				if (mxGetScalar(prhs[5]) == 1)
+					return_timing = TRUE_m12;
+				else if (mxGetScalar(prhs[5]) == 0)
+					return_timing = FALSE_m12;
+			}
+			if (return_timing == UNKNOWN_m12)
+				mexErrMsgTxt("'return_timing' (input 6) can be either true or false (default) only\n");
+		}
+	}
 		
 	// initialize MED library
 	G_initialize_medlib_m12(FALSE_m12, FALSE_m12);
@@ -192,7 +219,7 @@ void    mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[])
 	}
 		
        // get out of here
-	sess = MED_session_stats(file_list, n_files, return_channels, return_contigua, return_records, password);
+	sess = MED_session_stats(file_list, n_files, return_channels, return_contigua, return_records, return_timing, password);
 	if (sess != NULL) {
 		mxDestroyArray(plhs[0]);
 		plhs[0] = sess;
@@ -206,12 +233,15 @@ void    mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[])
 }
 
 
-mxArray     *MED_session_stats(void *file_list, si4 n_files, TERN_m12 return_channels, TERN_m12 return_contigua, TERN_m12 return_records, si1 *password)
+mxArray     *MED_session_stats(void *file_list, si4 n_files, TERN_m12 return_channels, TERN_m12 return_contigua, TERN_m12 return_records, TERN_m12 return_timing, si1 *password)
 {
-	si4			n_channels;
-	ui8			flags;
+	si1			sess_path[FULL_FILE_NAME_BYTES_m12];
+	si4			i, n_channels;
+	si8			n_contigs;
         SESSION_m12		*sess;
-        TIME_SLICE_m12		slice;
+	SESSION_MANIFEST	*sm;
+	CONTIGUON_m12		*contigua;
+	STAGE_TIMING		timing;
         mxArray			*mat_session, *mat_channels;
         const si4		n_mat_session_fields = NUMBER_OF_SESSION_FIELDS_mat;
         const si1		*mat_session_field_names[] = SESSION_FIELD_NAMES_mat;
@@ -219,34 +249,53 @@ mxArray     *MED_session_stats(void *file_list, si4 n_files, TERN_m12 return_cha
 	const si1		*mat_channel_field_names[] = CHANNEL_FIELD_NAMES_mat;
         	
 	
+        // session manifest (if current, & records are not requested, only the first segment's metadata is read: the manifest has the rest)
+	initialize_stage_timing(&timing, return_timing);
+	begin_stage(&timing, "open_session");
+	sm = NULL;
+	if (return_records == FALSE_m12 && manifest_session_path(file_list, n_files, sess_path) == TRUE_m12)
+		sm = load_session_manifest(sess_path);
+
         // open session
-        G_initialize_time_slice_m12(&slice);
-	slice.start_time = BEGINNING_OF_TIME_m12;
-	slice.end_time = END_OF_TIME_m12;
-	flags = (LH_READ_SLICE_SEGMENT_DATA_m12 | LH_MAP_ALL_SEGMENTS_m12 | LH_THREAD_SEGMENT_READS_m12);  // LH_THREAD_SEGMENT_READS_m12 doesn't change speed noticably in most cases
-	if (return_records == TRUE_m12)
-		flags |= (LH_READ_FULL_SESSION_RECORDS_m12 | LH_READ_FULL_SEGMENTED_SESS_RECS_m12);
-	sess = G_open_session_m12(NULL, &slice, file_list, n_files, flags, password);  // threaded version
+	sess = open_stats_session(file_list, n_files, return_records, sm, password);
+	if (sess != NULL && sm != NULL && apply_session_manifest(sess, sm) == FALSE_m12) {  // manifest does not describe the open channels: open in full
+		G_free_session_m12(sess, TRUE_m12);
+		free_session_manifest(sm);
+		sm = NULL;
+		sess = open_stats_session(file_list, n_files, return_records, NULL, password);
+	}
 	if (sess == NULL) {
-		if (globals_m12->password_data.processed == 0) {
-			G_warning_message_m12("%s(): cannot open session => no matching input files\n", __FUNCTION__);
-		} else {
-			if (*globals_m12->password_data.level_1_password_hint || *globals_m12->password_data.level_2_password_hint)
-				G_warning_message_m12("%s(): cannot open session => check that the password is correct\n", __FUNCTION__);
-			else
-				G_warning_message_m12("%s(): cannot open session => check that the password is correct, and that metadata files exist\n", __FUNCTION__);
-		}
+		free_session_manifest(sm);
 		return(NULL);
 	}
-	
-	// get variable frequency (not done on open)
-	G_frequencies_vary_m12(sess);
+
+	// contigua from the session manifest, or built from the reference channel's time series indices (& saved in a new manifest)
+	contigua = NULL;
+	n_contigs = 0;
+	if (return_contigua == TRUE_m12) {
+		begin_stage(&timing, "read_indices");
+		if (sm == NULL)
+			sm = load_session_manifest(sess->path);
+		if (sm != NULL) {
+			n_contigs = manifest_contigua(sm, &contigua);
+		} else if (read_segment_indices(globals_m12->reference_channel) == TRUE_m12) {
+			n_contigs = index_contigua(sess, &contigua);
+			write_session_manifest(sess);
+		}
+		if (n_contigs <= 0)
+			G_warning_message_m12("%s(): cannot read time series indices => contigua not returned\n", __FUNCTION__);
+		if (return_channels == TRUE_m12 && globals_m12->time_series_frequencies_vary == TRUE_m12)  // channel sample numbers are looked up in their indices
+			for (i = 0; i < sess->number_of_time_series_channels; ++i)
+				read_segment_indices(sess->time_series_channels[i]);
+	}
+	free_session_manifest(sm);
 
        	/* ****************************************** */
         /* ********  Create Matlab structure  ******* */
         /* ****************************************** */
 
         // Create session output structure
+	begin_stage(&timing, "build_metadata");
         mat_session = mxCreateStructMatrix(1, 1, n_mat_session_fields, mat_session_field_names);
 
 	// Create channel output structures
@@ -263,20 +312,160 @@ mxArray     *MED_session_stats(void *file_list, si4 n_files, TERN_m12 return_cha
 	build_metadata(sess, mat_session, return_channels);
 
 	// Build contigua
-	if (return_contigua == TRUE_m12)
-		build_contigua(sess, mat_session, return_channels);
+	if (n_contigs > 0) {
+		begin_stage(&timing, "build_contigua");
+		build_contigua(sess, mat_session, return_channels, contigua, n_contigs);
+		free_m12((void *) contigua, __FUNCTION__);
+	}
 	
        	// Build session records
-	if (return_records == TRUE_m12)
+	if (return_records == TRUE_m12) {
+		begin_stage(&timing, "build_session_records");
         	build_session_records(sess, mat_session);
+	}
+	end_stage(&timing);
 	
 	// clean up
+	if (return_timing == TRUE_m12) {
+		timing.bytes_read = segment_header_bytes(sess);
+		timing.blocks_decoded = 0;
+	}
+	begin_stage(&timing, "free_session");
 	G_free_session_m12(sess, TRUE_m12);
+	
+	// timing
+	if (return_timing == TRUE_m12) {
+		finish_stage_timing(&timing);
+		build_timing(&timing, mat_session);
+	}
 
         return(mat_session);
 }
 
 
+// opens session for stats (headers & metadata only: no sample data is read), first segment only if there is a current manifest
+SESSION_m12	*open_stats_session(void *file_list, si4 n_files, TERN_m12 return_records, SESSION_MANIFEST *sm, si1 *password)
+{
+	ui8			flags;
+        SESSION_m12		*sess;
+        TIME_SLICE_m12		slice;
+
+
+        G_initialize_time_slice_m12(&slice);
+	if (sm != NULL) {
+		slice.start_segment_number = slice.end_segment_number = 1;
+		flags = (LH_READ_SEGMENT_METADATA_m12 | LH_THREAD_SEGMENT_READS_m12);
+	} else {
+		slice.start_time = BEGINNING_OF_TIME_m12;
+		slice.end_time = END_OF_TIME_m12;
+		flags = (LH_READ_SEGMENT_METADATA_m12 | LH_MAP_ALL_SEGMENTS_m12 | LH_THREAD_SEGMENT_READS_m12);
+		if (return_records == TRUE_m12)
+			flags |= (LH_READ_FULL_SESSION_RECORDS_m12 | LH_READ_FULL_SEGMENTED_SESS_RECS_m12);
+	}
+	sess = G_open_session_m12(NULL, &slice, file_list, n_files, flags, password);  // threaded version
+	if (sess == NULL) {
+		if (globals_m12->password_data.processed == 0) {
+			G_warning_message_m12("%s(): cannot open session => no matching input files\n", __FUNCTION__);
+		} else {
+			if (*globals_m12->password_data.level_1_password_hint || *globals_m12->password_data.level_2_password_hint)
+				G_warning_message_m12("%s(): cannot open session => check that the password is correct\n", __FUNCTION__);
+			else
+				G_warning_message_m12("%s(): cannot open session => check that the password is correct, and that metadata files exist\n", __FUNCTION__);
+		}
+		return(NULL);
+	}
+	
+	// get variable frequency (not done on open)
+	G_frequencies_vary_m12(sess);
+
+	return(sess);
+}
+
+
+// sets session extents from a current manifest (session opened on its first segment)
+// returns FALSE_m12 if the manifest does not describe every open channel, or their frequencies or sample counts vary (every segment must then be read)
+TERN_m12	apply_session_manifest(SESSION_m12 *sess, SESSION_MANIFEST *sm)
+{
+	si4			i, j;
+	si8			n_samps;
+	sf8			samp_freq;
+	CHANNEL_m12		*chan;
+	MANIFEST_CHANNEL	*m_chan;
+
+
+	samp_freq = FREQUENCY_NO_ENTRY_m12;
+	n_samps = SAMPLE_NUMBER_NO_ENTRY_m12;
+	for (i = 0; i < sess->number_of_time_series_channels; ++i) {
+		chan = sess->time_series_channels[i];
+		for (j = 0; j < sm->header->number_of_channels; ++j)
+			if (strcmp(chan->name, sm->channels[j].name) == 0)
+				break;
+		if (j == sm->header->number_of_channels)
+			return(FALSE_m12);
+		m_chan = sm->channels + j;
+		if (m_chan->sampling_frequency == FREQUENCY_NO_ENTRY_m12 || m_chan->number_of_samples == SAMPLE_NUMBER_NO_ENTRY_m12)
+			return(FALSE_m12);
+		if (i == 0) {
+			samp_freq = m_chan->sampling_frequency;
+			n_samps = m_chan->number_of_samples;
+		} else if (m_chan->sampling_frequency != samp_freq || m_chan->number_of_samples != n_samps) {
+			return(FALSE_m12);
+		}
+	}
+	if (n_samps == SAMPLE_NUMBER_NO_ENTRY_m12)
+		return(FALSE_m12);
+
+	globals_m12->session_start_time = sm->header->session_start_time;
+	globals_m12->session_end_time = sm->header->session_end_time;
+	globals_m12->time_series_frequencies_vary = FALSE_m12;
+	sess->time_slice.end_time = sm->header->session_end_time;
+	sess->time_slice.end_sample_number = n_samps - 1;
+	for (i = 0; i < sess->number_of_time_series_channels; ++i) {
+		chan = sess->time_series_channels[i];
+		chan->time_slice.end_time = sm->header->session_end_time;
+		chan->time_slice.end_sample_number = n_samps - 1;
+	}
+
+	return(TRUE_m12);
+}
+
+
+// stage times are the calling thread's (CPU includes medlib's segment read threads), no samples are read so there are no channel entries
+void	build_timing(STAGE_TIMING *st, mxArray *mat_session)
+{
+	si4			i;
+	mxArray			*mat_timing, *mat_stages;
+	const si4		n_mat_timing_fields = NUMBER_OF_TIMING_FIELDS_mat;
+	const si1		*mat_timing_field_names[] = TIMING_FIELD_NAMES_mat;
+	const si4		n_mat_stage_fields = NUMBER_OF_TIMING_STAGE_FIELDS_mat;
+	const si1		*mat_stage_field_names[] = TIMING_STAGE_FIELD_NAMES_mat;
+	const si4		n_mat_channel_fields = NUMBER_OF_TIMING_CHANNEL_FIELDS_mat;
+	const si1		*mat_channel_field_names[] = TIMING_CHANNEL_FIELD_NAMES_mat;
+
+
+	mat_timing = mxCreateStructMatrix(1, 1, n_mat_timing_fields, mat_timing_field_names);
+	mxSetFieldByNumber(mat_timing, 0, TIMING_FIELDS_WALL_IDX_mat, mxCreateDoubleScalar(st->wall));
+	mxSetFieldByNumber(mat_timing, 0, TIMING_FIELDS_CPU_IDX_mat, mxCreateDoubleScalar(st->cpu));
+
+	// stages
+	mat_stages = mxCreateStructMatrix(st->n_stages, 1, n_mat_stage_fields, mat_stage_field_names);
+	for (i = 0; i < st->n_stages; ++i) {
+		mxSetFieldByNumber(mat_stages, i, TIMING_STAGE_FIELDS_NAME_IDX_mat, mxCreateString(st->stages[i].name));
+		mxSetFieldByNumber(mat_stages, i, TIMING_STAGE_FIELDS_WALL_IDX_mat, mxCreateDoubleScalar(st->stages[i].wall));
+		mxSetFieldByNumber(mat_stages, i, TIMING_STAGE_FIELDS_CPU_IDX_mat, mxCreateDoubleScalar(st->stages[i].cpu));
+	}
+	mxSetFieldByNumber(mat_timing, 0, TIMING_FIELDS_STAGES_IDX_mat, mat_stages);
+
+	// totals (set by caller)
+	mxSetFieldByNumber(mat_timing, 0, TIMING_FIELDS_CHANNELS_IDX_mat, mxCreateStructMatrix(0, 1, n_mat_channel_fields, mat_channel_field_names));
+	mxSetFieldByNumber(mat_timing, 0, TIMING_FIELDS_BYTES_READ_IDX_mat, mxCreateDoubleScalar((sf8) st->bytes_read));
+	mxSetFieldByNumber(mat_timing, 0, TIMING_FIELDS_BLOCKS_DECODED_IDX_mat, mxCreateDoubleScalar((sf8) st->blocks_decoded));
+	mxSetFieldByNumber(mat_session, 0, SESSION_FIELDS_TIMING_IDX_mat, mat_timing);
+
+	return;
+}
+
+
 void	build_channel_names(SESSION_m12 *sess, mxArray *mat_sess)
 {
 	si8                             i, n_chans;
@@ -302,24 +491,18 @@ void	build_channel_names(SESSION_m12 *sess, mxArray *mat_sess)
 
 
 // NOTE: this function assumes all discontinuities are session wide, which is not required by MED
-void	build_contigua(SESSION_m12 *sess, mxArray *mat_session, TERN_m12 return_channels)
+void	build_contigua(SESSION_m12 *sess, mxArray *mat_session, TERN_m12 return_channels, CONTIGUON_m12 *contigua, si8 n_contigs)
 {
 	TERN_m12			var_freq, relative_days;
 	si1				time_str[TIME_STRING_BYTES_m12];
-	si8                             i, j, n_chans, n_contigs, samp_num;
+	si8                             i, j, n_chans, samp_num;
 	CHANNEL_m12                     *chan;
-	CONTIGUON_m12			*contigua;
 	mxArray                         *mat_sess_contigua, *mat_chan_contigua, *mat_channels, *tmp_mxa;
 	mwSize				n_dims, dims[2];
 	const si4                       n_mat_contiguon_fields = NUMBER_OF_CONTIGUON_FIELDS_mat;
 	const si1                       *mat_contiguon_field_names[] = CONTIGUON_FIELD_NAMES_mat;
 	
 	
-	// build session contigua
-	n_contigs = G_build_contigua_m12((LEVEL_HEADER_m12 *) sess);
-	if (n_contigs <= 0)
-		return;
-	
 	if (globals_m12->RTO_known == TRUE_m12)
 		relative_days = FALSE_m12;
 	else
@@ -327,13 +510,12 @@ void	build_contigua(SESSION_m12 *sess, mxArray *mat_session, TERN_m12 return_cha
 	
 	mat_sess_contigua = mxCreateStructMatrix(n_contigs, 1, n_mat_contiguon_fields, mat_contiguon_field_names);
 	dims[0] = dims[1] = 1; n_dims = 2;
-	contigua = sess->contigua;
 	
 	for (i = 0; i < n_contigs; ++i) {
 		// start index
 		if (globals_m12->time_series_frequencies_vary == TRUE_m12)
 			samp_num = -1;
-		else if (contigua[i].start_sample_number > 0)
+		else if (contigua[i].start_sample_number >= 0)
 			samp_num = contigua[i].start_sample_number + 1;
 		else
 			samp_num = G_sample_number_for_uutc_m12((LEVEL_HEADER_m12 *) sess, contigua[i].start_time, FIND_CURRENT_m12) + 1;
@@ -343,7 +525,7 @@ void	build_contigua(SESSION_m12 *sess, mxArray *mat_session, TERN_m12 return_cha
 		// end index
 		if (globals_m12->time_series_frequencies_vary == TRUE_m12)
 			samp_num = -1;
-		else if (contigua[i].end_sample_number > 0)
+		else if (contigua[i].end_sample_number >= 0)
 			samp_num = contigua[i].end_sample_number + 1;
 		else
 			samp_num = G_sample_number_for_uutc_m12((LEVEL_HEADER_m12 *) sess, contigua[i].end_time, FIND_CURRENT_m12) + 1;
@@ -403,6 +585,37 @@ void	build_contigua(SESSION_m12 *sess, mxArray *mat_session, TERN_m12 return_cha
 }
 
 
+// bytes of the files this gateway reads per segment (universal headers, metadata, & time series indices, when read)
+si8	segment_header_bytes(SESSION_m12 *sess)
+{
+	si4		i, j, seg_idx, n_segs;
+	si8		bytes;
+	CHANNEL_m12	*chan;
+	SEGMENT_m12	*seg;
+
+
+	bytes = 0;
+	for (i = 0; i < sess->number_of_time_series_channels; ++i) {
+		chan = sess->time_series_channels[i];
+		if ((chan->flags & LH_CHANNEL_ACTIVE_m12) == 0 || chan->segments == NULL)
+			continue;
+		n_segs = TIME_SLICE_SEGMENT_COUNT_m12(&chan->time_slice);
+		seg_idx = G_get_segment_index_m12(chan->time_slice.start_segment_number);
+		for (j = 0; j < n_segs; ++j) {
+			seg = chan->segments[seg_idx + j];
+			if (seg == NULL)
+				continue;
+			if (seg->metadata_fps != NULL)
+				bytes += METADATA_FILE_BYTES_m12;
+			if (seg->time_series_indices_fps != NULL)
+				bytes += UNIVERSAL_HEADER_BYTES_m12 + (seg->time_series_indices_fps->universal_header->number_of_entries * TIME_SERIES_INDEX_BYTES_m12);
+		}
+	}
+
+	return(bytes);
+}
+
+
 void    build_metadata(SESSION_m12 *sess, mxArray *mat_session, TERN_m12 return_channels)
 {
 	TERN_m12				relative_days;
@@ -722,92 +935,29 @@ void    build_metadata(SESSION_m12 *sess, mxArray *mat_session, TERN_m12 return_
 
 void    build_session_records(SESSION_m12 *sess, mxArray *mat_session)
 {
-	si4				n_segs, seg_idx;
-        si8                     	i, j, k, n_items, tot_recs, n_recs;
-        ui1                     	*rd;
-        mxArray                 	*mat_records, *mat_record;
-	FILE_PROCESSING_STRUCT_m12	*rd_fps;
-	RECORD_HEADER_m12       	**rec_ptrs, *rh;
+	si8			i;
+	mxArray			*mat_records;
+	RECORD_HEADER_m12	*rh;
+	RECORD_MERGE		*rm;
 
-        
-	n_segs = sess->time_slice.number_of_segments;
-        
-        // set up sorted records array
-        tot_recs = 0;
-        if (sess->record_data_fps != NULL && sess->record_indices_fps != NULL)
-                tot_recs = sess->record_data_fps->number_of_items;
-        if (sess->segmented_sess_recs != NULL) {
-		seg_idx = G_get_segment_index_m12(sess->time_slice.start_segment_number);
-		for (i = 0, j = seg_idx; i < n_segs; ++i, ++j) {
-			rd_fps = sess->segmented_sess_recs->record_data_fps[j];
-			if (rd_fps != NULL)
-                        	tot_recs += rd_fps->number_of_items;
-		}
-        }
-        if (tot_recs == 0)
-                return;
-	
-        rec_ptrs = (RECORD_HEADER_m12 **) malloc((size_t) tot_recs * sizeof(RECORD_HEADER_m12 *));
-	if (rec_ptrs == NULL)
+
+	// record files are time ordered: merge them
+	rm = merge_session_records(sess);
+	if (rm->number_of_records == 0) {
+		free_record_merge(rm);
 		return;
-        n_recs = 0;
-        if (sess->record_data_fps != NULL) {
-                n_items = sess->record_data_fps->number_of_items;
-                rd = sess->record_data_fps->record_data;
-                for (i = 0; i < n_items; ++i) {
-			rh = (RECORD_HEADER_m12 *) rd;
-			switch (rh->type_code) {
-				// excluded types
-				case REC_Term_TYPE_CODE_m12:
-				case REC_SyLg_TYPE_CODE_m12:
-					break;
-				default:  // include all other record types
-					rec_ptrs[n_recs++] = rh;
-					break;
-			}
-			rd += rh->total_record_bytes;
-                }
-        }
-        if (sess->segmented_sess_recs != NULL) {
-                for (i = 0, j = seg_idx; i < n_segs; ++i, ++j) {
-			rd_fps = sess->segmented_sess_recs->record_data_fps[j];
-			if (rd_fps == NULL)
-				continue;
-			n_items = rd_fps->number_of_items;
-                        rd = rd_fps->record_data;
-                        for (k = 0; k < n_items; ++k) {
-				rh = (RECORD_HEADER_m12 *) rd;
-				switch (rh->type_code) {
-					// excluded tyoes
-					case REC_Term_TYPE_CODE_m12:
-					case REC_SyLg_TYPE_CODE_m12:
-						break;
-					default:  // include all other record types
-						rec_ptrs[n_recs++] = rh;
-						break;
-				}
-				rd += rh->total_record_bytes;
-                        }
-                }
-        }
-        if (n_recs == 0) {
-                free((void *) rec_ptrs);
-                return;
-        }
-        qsort((void *) rec_ptrs, n_recs, sizeof(RECORD_HEADER_m12 *), rec_compare);
-
-        // create matlab records
-        mat_records = mxCreateCellMatrix(n_recs, 1);
-        mxSetFieldByNumber(mat_session, 0, SESSION_FIELDS_RECORDS_IDX_mat, mat_records);
-        for (i = 0; i < n_recs; ++i) {
-                mat_record = fill_record(rec_ptrs[i]);
-                mxSetCell(mat_records, i, mat_record);
-        }
+	}
 
-        // clean up
-	free((void *) rec_ptrs);
+	// create matlab records
+	mat_records = mxCreateCellMatrix(rm->number_of_records, 1);
+	mxSetFieldByNumber(mat_session, 0, SESSION_FIELDS_RECORDS_IDX_mat, mat_records);
+	for (i = 0; (rh = next_merged_record(rm)) != NULL; ++i)
+		mxSetCell(mat_records, i, fill_record(rh));
 
-        return;
+	// clean up
+	free_record_merge(rm);
+
+	return;
 }
 
 
@@ -1270,24 +1420,3 @@ si8     get_si8_scalar(const mxArray *mx_arr)
 
         return((si8) mxGetScalar(mx_arr));
 }
-
-
-si4     rec_compare(const void *a, const void *b)
-{
-	si8	time_d;
-	
-	
-	time_d = (*((RECORD_HEADER_m12 **) a))->start_time - (*((RECORD_HEADER_m12 **) b))->start_time;
-	
-	// sort by time
-	if (time_d > 0)
-		return(1);
-	if (time_d < 0)
-		return(-1);
-	
-	// if same time, sort by location in memory
-	if ((ui8) *((RECORD_HEADER_m12 **) a) > (ui8) *((RECORD_HEADER_m12 **) a))
-		return(1);
-
-	return(-1);
-}
@@ -7,6 +7,9 @@
 
 // Includes
 #include "medlib_m12.h"
+#include "stage_timing.h"
+#include "session_manifest.h"
+#include "record_merge.h"
 
 // Defines
 
@@ -18,17 +21,19 @@
 #define MAX_CHANNELS                        	512
 
 // Matlab Session Structure
-#define NUMBER_OF_SESSION_FIELDS_mat            4
+#define NUMBER_OF_SESSION_FIELDS_mat            5
 #define SESSION_FIELD_NAMES_mat { \
         "metadata", \
 	"channels", \
         "records", \
         "contigua", \
+	"timing" \
 }
 #define SESSION_FIELDS_METADATA_IDX_mat         0
 #define SESSION_FIELDS_CHANNELS_IDX_mat         1
 #define SESSION_FIELDS_RECORDS_IDX_mat          2
 #define SESSION_FIELDS_CONTIGUA_IDX_mat         3
+#define SESSION_FIELDS_TIMING_IDX_mat		4
 
 // Matlab Metadata Structure
 #define NUMBER_OF_METADATA_FIELDS_mat           39
@@ -296,13 +301,16 @@
 // Prototypes
 void            mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[]);
 si8             get_si8_scalar(const mxArray *mx_arr);
-mxArray		*MED_session_stats(void *file_list, si4 n_files, TERN_m12 return_channels, TERN_m12 return_contigua, TERN_m12 return_records, si1 *password);
+mxArray		*MED_session_stats(void *file_list, si4 n_files, TERN_m12 return_channels, TERN_m12 return_contigua, TERN_m12 return_records, TERN_m12 return_timing, si1 *password);
+SESSION_m12	*open_stats_session(void *file_list, si4 n_files, TERN_m12 return_records, SESSION_MANIFEST *sm, si1 *password);
+TERN_m12	apply_session_manifest(SESSION_m12 *sess, SESSION_MANIFEST *sm);
 void		build_channel_names(SESSION_m12 *sess, mxArray *mat_sess);
 void    	build_metadata(SESSION_m12 *sess, mxArray *mat_session, TERN_m12 return_channels);
-void		build_contigua(SESSION_m12 *sess, mxArray *mat_session, TERN_m12 return_channels);
+void		build_contigua(SESSION_m12 *sess, mxArray *mat_session, TERN_m12 return_channels, CONTIGUON_m12 *contigua, si8 n_contigs);
+si8		segment_header_bytes(SESSION_m12 *sess);
 void            build_session_records(SESSION_m12 *sess, mxArray *mat_session);
+void		build_timing(STAGE_TIMING *st, mxArray *mat_session);
 mxArray         *fill_record(RECORD_HEADER_m12 *rh);
-si4             rec_compare(const void *a, const void *b);
 
 
 #endif /* GET_SESSION_STATS_IN */
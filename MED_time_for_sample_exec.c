@@ -3,40 +3,102 @@
 // Copyright Dark Horse Neuro Inc, 2021
 
 
-//******************************************** Mex Compile Line *****************************************//
-//****  mex COMPFLAGS='$COMPFLAGS -Wall -O3' read_MED_exec.c medlib_m12.c medrec_m12.c dhnlib_m12.c  ****//
-//*******************************************************************************************************//
+//**************************************************************************************************** Mex Compile Line ****************************************************************************************************//
+//****  mex COMPFLAGS='$COMPFLAGS -Wall -O3' MED_time_for_sample_exec.c conversion_channels.c session_registry.c session_manifest.c record_journal.c index_sweep.c work_queue.c medlib_m12.c medrec_m12.c dhnlib_m12.c  ****//
+//**************************************************************************************************************************************************************************************************************************//
 
-// time = MED_time_for_sample(sample_number, MED_directory, [password])
+// [time, [channel_names]] = MED_time_for_sample(sample_number, MED_directory, [password], [persist])
 // sample_number: required
 // MED_directory: reference channel or session; if session default reference channel will be used
+//	cell array of channels, or regex (e.g. 'session.medd/*.ticd'): all matching channels are converted (each in its own sample numbering)
 // password: if empty/absent, proceeds as if unencrypted (may error out)
+// persist: 'none' (default), 'open' (channels are kept open for later calls with the same MED_directory & password), 'close' (returns true)
 // returns Matlab int64 value of sample number in absolute reference frame
+//	for several channels: n_samples x n_channels matrix (column per channel, in channel_names order)
 
 
 #include "MED_time_for_sample_exec.h"
 
+// Globals
+static TERN_m12		loaded = FALSE_m12;
+
+
+// Mex exit function
+void	mexExitFunction(void)
+{
+	// free open channels & globals
+	free_conversion_channels();
+
+	return;
+}
+
 
 // Mex gateway routine
 void    mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[])
 {
-	si1                    	MED_directory[FULL_FILE_NAME_BYTES_m12];
         si1                     password[PASSWORD_BYTES_m12 + 1], temp_str[16];
+	ui1			persist_mode;
         si4                     len, n_files;
+	void			*MED_paths;
 	si8			sample;
-        mxArray                 *samples, *mx_cell_p, *tmp_mxa;
+        mxArray                 *samples, *tmp_mxa;
 	mwSize			dims[2];
 
 	
-	PROC_adjust_open_file_limit_m12(MAX_OPEN_FILES_m12(MAX_CHANNELS, 1), FALSE_m12);
-	PROC_increase_process_priority_m12(FALSE_m12, FALSE_m12);
+	// function loaded
+	if (loaded == FALSE_m12) {
+		mexAtExit(mexExitFunction);
+		PROC_adjust_open_file_limit_m12(MAX_OPEN_FILES_m12(MAX_CHANNELS, 1), FALSE_m12);
+		PROC_increase_process_priority_m12(FALSE_m12, FALSE_m12);
+
+		// initialize medlib (open channels are kept in the registry between calls)
+		initialize_conversion_channels();
+
+		loaded = TRUE_m12;
+	}
 
 	//  check for proper number of arguments
-	if (nlhs != 1)
-		mexErrMsgTxt("One output required: time\n");
+	if (nlhs < 1 || nlhs > 2)
+		mexErrMsgTxt("One or two outputs: time, [channel_names]\n");
 	plhs[0] = mxCreateLogicalScalar((mxLogical) 0);  // set "false" return value for any subsequent errors
-	if (nrhs < 2 || nrhs > 3)
-		mexErrMsgTxt("Two to 3 inputs required: sample_number(s), MED_directory, [password]\n");
+	if (nlhs == 2)
+		plhs[1] = mxCreateCellMatrix((mwSize) 1, (mwSize) 0);
+	if (nrhs < 2 || nrhs > 4)
+		mexErrMsgTxt("Two to 4 inputs required: sample_number(s), MED_directory, [password], [persist]\n");
+
+	// persist
+	persist_mode = CONVERSION_PERSIST_NONE;
+	if (nrhs == 4) {
+		if (mxIsEmpty(prhs[3]) == 0) {
+			persist_mode = 0xFF;
+			if (mxGetClassID(prhs[3]) == mxCHAR_CLASS) {
+				mxGetString(prhs[3], temp_str, 16);
+				if (strcmp(temp_str, "none") == 0)
+					persist_mode = CONVERSION_PERSIST_NONE;
+				else if (strcmp(temp_str, "open") == 0)
+					persist_mode = CONVERSION_PERSIST_OPEN;
+				else if (strcmp(temp_str, "close") == 0)
+					persist_mode = CONVERSION_PERSIST_CLOSE;
+			} else if (mxIsLogicalScalar(prhs[3])) {
+				persist_mode = (mxIsLogicalScalarTrue(prhs[3]) == 1) ? CONVERSION_PERSIST_OPEN : CONVERSION_PERSIST_NONE;
+			} else if (mxIsScalar(prhs[3])) {
+				if (mxGetScalar(prhs[3]) >= 0.0 && mxGetScalar(prhs[3]) <= 2.0)
+					persist_mode = (ui1) mxGetScalar(prhs[3]);
+			}
+			if (persist_mode == 0xFF)
+				mexErrMsgTxt("'persist' (input 4) options: 'none' (0), 'open' (1), 'close' (2)\n");
+		}
+	}
+
+	// close: channels left open for MED_directory (all if empty)
+	if (persist_mode == CONVERSION_PERSIST_CLOSE) {
+		MED_paths = get_MED_paths(prhs[1], &n_files);
+		close_conversion_channels(MED_paths, n_files);
+		free_m12(MED_paths, __FUNCTION__);
+		mxDestroyArray(plhs[0]);
+		plhs[0] = mxCreateLogicalScalar((mxLogical) 1);
+		return;
+	}
 
 	// sample_number
 	if (mxIsEmpty(prhs[0]) == 1)
@@ -58,34 +120,9 @@ void    mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[])
 		samples = get_si8_array(prhs[0]);
 	}
 	
-        // get the MED directory
-	len = 0;  // initialized to avoid bogus compiler warning
-	if (mxIsEmpty(prhs[1]) == 1)
-		mexErrMsgTxt("'MED_directory' (input 2) must be specified\n");
-        if (mxGetClassID(prhs[1]) == mxCHAR_CLASS) {
-                len = mxGetNumberOfElements(prhs[1]) + TYPE_BYTES_m12; // get max length of the input string
-		if (len > FULL_FILE_NAME_BYTES_m12)
-			mexErrMsgTxt("'MED_directory' (input 2) is too long\n");
-        } else if (mxGetClassID(prhs[1]) == mxCELL_CLASS) {
-                n_files = mxGetNumberOfElements(prhs[1]);
-		if (n_files == 0)
-			mexErrMsgTxt("'MED_directory' (input 2) cell array contains no entries\n");
-		if (n_files > 1)
-			mexErrMsgTxt("'MED_directory' (input 2) cell array contains multiple entries\n");
-		mx_cell_p = mxGetCell(prhs[1], 0);
-		if (mxGetClassID(mx_cell_p) != mxCHAR_CLASS)
-			mexErrMsgTxt("Elements of 'MED_directory' (input 2) cell array must be char arrays\n");
-		len = mxGetNumberOfElements(mx_cell_p) + TYPE_BYTES_m12; // get max length of the input string
-		if (len > FULL_FILE_NAME_BYTES_m12)
-			mexErrMsgTxt("'MED_directory' (input 2) is too long\n");
-        } else {
-		mexErrMsgTxt("'MED_directory' (input 2) must be a string or cell array\n");
-        }
-	mxGetString(prhs[1], MED_directory, len);
-	
         // password
         *password = 0;
-        if (nrhs == 3) {
+        if (nrhs >= 3) {
                 if (mxIsEmpty(prhs[2]) == 0) {
                         if (mxGetClassID(prhs[2]) == mxCHAR_CLASS) {
                                 len = mxGetNumberOfElements(prhs[2]); // Get the length of the input string
@@ -99,67 +136,40 @@ void    mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[])
                 }
         }
          		
-	// initialize MED library
-	G_initialize_medlib_m12(FALSE_m12, FALSE_m12);
-                		
+        // get the MED directory (string, or cell array of strings; may include regex)
+	if (mxIsEmpty(prhs[1]) == 1)
+		mexErrMsgTxt("'MED_directory' (input 2) must be specified\n");
+	MED_paths = get_MED_paths(prhs[1], &n_files);
+
         // get out of here
-	tmp_mxa = MED_time_for_sample(samples, MED_directory, password);
+	tmp_mxa = MED_time_for_sample(samples, MED_paths, n_files, password, persist_mode, (nlhs == 2) ? &plhs[1] : NULL);
 	if (tmp_mxa != NULL) {
 		mxDestroyArray(plhs[0]);  // destroy default "false" return
 		plhs[0] = tmp_mxa;
 	}
-
-        // clean up
-	G_free_globals_m12(TRUE_m12);
+	free_m12(MED_paths, __FUNCTION__);
 
         return;
 }
 
 
-mxArray     *MED_time_for_sample(mxArray *samples, si1 *MED_directory, si1 *password)
+mxArray     *MED_time_for_sample(mxArray *samples, void *MED_paths, si4 n_files, si1 *password, ui1 persist_mode, mxArray **channel_names)
 {
-	si1			tmp_str[FULL_FILE_NAME_BYTES_m12], extension[TYPE_BYTES_m12], **channel_list;
-        si4			i, len, n_channels;
-	ui8			flags;
-	si8			*samps_p, min_samp, max_samp;
-        CHANNEL_m12		*chan;
-        TIME_SLICE_m12		slice;
+        si4			i, len;
+	si8			*samps_p;
+	TERN_m12		opened;
+	mwSize			dims[2];
+	mxArray			*results;
+	CONVERSION_CHANNELS	*cc;
+	REGISTRY_ENTRY		*entry;
 
 	
-	// get full MED directory name
-	G_path_from_root_m12(MED_directory, MED_directory);
-	G_extract_path_parts_m12(MED_directory, NULL, NULL, extension);
-	if (*extension == 0) {
-		// see if time series channel with this name exists
-		sprintf_m12(tmp_str, "%s.%s", MED_directory, TIME_SERIES_CHANNEL_DIRECTORY_TYPE_STRING_m12);
-		if (G_exists_m12(tmp_str) == DIR_EXISTS_m12) {
-			strcpy(MED_directory, tmp_str);
-			strcpy(extension, TIME_SERIES_CHANNEL_DIRECTORY_TYPE_STRING_m12);
-		} else {
-			// see if session with this name exists
-			sprintf_m12(MED_directory, "%s.%s", MED_directory, SESSION_DIRECTORY_TYPE_STRING_m12);
-			if (G_exists_m12(MED_directory) == DIR_EXISTS_m12)
-				strcpy(extension, SESSION_DIRECTORY_TYPE_STRING_m12);
-			else {
-				return(NULL);
-			}
-		}
-	}
-
-	// get a first channel from session
-	if (strcmp(extension, SESSION_DIRECTORY_TYPE_STRING_m12) == 0) {
-		channel_list = G_generate_file_list_m12(NULL, &n_channels, MED_directory, NULL, TIME_SERIES_CHANNEL_DIRECTORY_TYPE_STRING_m12, GFL_FULL_PATH_m12);
-		if (channel_list == NULL) {
-			G_warning_message_m12("No time series channels in session directory\n");
-			return(NULL);
-		}
-		strcpy(MED_directory, channel_list[0]);
-		free_m12((void *) channel_list, __FUNCTION__);
-	} else if (strcmp(extension, TIME_SERIES_CHANNEL_DIRECTORY_TYPE_STRING_m12)) {
-		G_warning_message_m12("'MED_directory' must be an existing MED channel or session\n");
+	// get channels (left open by an earlier call, or opened now: segment metadata & time series indices only, no sample data is read)
+	entry = get_conversion_channels(MED_paths, n_files, password, &opened);
+	if (entry == NULL)
 		return(NULL);
-	}
-		
+	cc = (CONVERSION_CHANNELS *) entry->client_data;
+
 	// get samples info
 	len = (si4) mxGetNumberOfElements(samples);
 	samps_p = (si8 *) mxGetPr(samples);
@@ -173,41 +183,88 @@ mxArray     *MED_time_for_sample(mxArray *samples, si1 *MED_directory, si1 *pass
 			--samps_p[i];
 	} // else there was a zero - assume all samples already in MED numbering
 
-	// get slice extents
-	max_samp = min_samp = samps_p[0];
-	for (i = 1; i < len; ++i) {
-		if (max_samp < samps_p[i])
-			max_samp = samps_p[i];
-		else if (min_samp > samps_p[i])
-			min_samp = samps_p[i];
+	// get times: in the input array for one channel, else a column per channel (sorted sweeps of the channels' block indices)
+	if (cc->n_chans == 1) {
+		results = samples;
+	} else {
+		dims[0] = (mwSize) len;
+		dims[1] = (mwSize) cc->n_chans;
+		results = mxCreateNumericArray((mwSize) 2, dims, mxINT64_CLASS, mxREAL);
 	}
+	sweep_channels(cc->chans, cc->maps, cc->n_chans, samps_p, (si8) len, (si8 *) mxGetPr(results), SWEEP_TIME_FOR_SAMPLE);
+	if (results != samples)
+		mxDestroyArray(samples);
+
+	// channel names (result column order)
+	if (channel_names != NULL) {
+		mxDestroyArray(*channel_names);
+		*channel_names = mxCreateCellMatrix((mwSize) 1, (mwSize) cc->n_chans);
+		for (i = 0; i < cc->n_chans; ++i)
+			mxSetCell(*channel_names, (mwIndex) i, mxCreateString(cc->chans[i]->name));
+	}
+	
+        // clean up (channels left open by "open" stay open)
+	if (opened == TRUE_m12 && persist_mode != CONVERSION_PERSIST_OPEN)
+		unregister_session(entry);
+
+        return(results);
+}
+
 
-        // open channel
-        G_initialize_time_slice_m12(&slice);
-	slice.start_sample_number = min_samp;
-	slice.end_sample_number = max_samp;
-	flags = (LH_READ_SLICE_SEGMENT_DATA_m12 | LH_MAP_ALL_SEGMENTS_m12);  // read in time series indices (this could be made more efficient)
-	chan = G_open_channel_m12(NULL, &slice, MED_directory, flags, password);  // threaded version
-	if (chan == NULL) {
-		if (globals_m12->password_data.processed == 0) {
-			G_warning_message_m12("%s(): cannot open channel => no matching input files\n", __FUNCTION__);
+// returns single string (*n_files == 0), or 2D array of *n_files strings (as medlib file lists); empty input returns an empty string
+void     *get_MED_paths(const mxArray *mx_arr, si4 *n_files)
+{
+	si1		**MED_paths_p;
+	si4		i, len, max_len;
+	void		*MED_paths;
+	mxArray		*mx_cell_p;
+
+
+	*n_files = max_len = 0;
+	if (mxIsEmpty(mx_arr) == 0) {
+		if (mxGetClassID(mx_arr) == mxCHAR_CLASS) {
+			max_len = mxGetNumberOfElements(mx_arr);
+		} else if (mxGetClassID(mx_arr) == mxCELL_CLASS) {
+			*n_files = mxGetNumberOfElements(mx_arr);
+			for (i = 0; i < *n_files; ++i) {
+				mx_cell_p = mxGetCell(mx_arr, i);
+				if (mxGetClassID(mx_cell_p) != mxCHAR_CLASS)
+					mexErrMsgTxt("Elements of 'MED_directory' (input 2) cell array must be char arrays\n");
+				len = mxGetNumberOfElements(mx_cell_p);
+				if (len > max_len)
+					max_len = len;
+			}
 		} else {
-			if (*globals_m12->password_data.level_1_password_hint || *globals_m12->password_data.level_2_password_hint)
-				G_warning_message_m12("%s(): cannot open channel => check that the password is correct\n", __FUNCTION__);
-			else
-				G_warning_message_m12("%s(): cannot open channel => check that the password is correct, and that metadata files exist\n", __FUNCTION__);
+			mexErrMsgTxt("'MED_directory' (input 2) must be a string or cell array\n");
 		}
-		return(NULL);
 	}
+	max_len += TYPE_BYTES_m12;  // add room for med type extension, in case not included
+	if (max_len > FULL_FILE_NAME_BYTES_m12)
+		mexErrMsgTxt("'MED_directory' (input 2) is too long\n");
 
-	// get times (put in samples array)
-	for (i = 0; i < len; ++i)
-		samps_p[i] = G_uutc_for_sample_number_m12((LEVEL_HEADER_m12 *) chan, samps_p[i], (FIND_ABSOLUTE_m12 | FIND_CURRENT_m12));
-	
-        // clean up
-	G_free_channel_m12(chan, TRUE_m12);
+	switch (*n_files) {
+		case 0:  // single string passed
+			MED_paths = calloc_m12((size_t) max_len, sizeof(si1), __FUNCTION__, USE_GLOBAL_BEHAVIOR_m12);
+			if (mxIsEmpty(mx_arr) == 0)
+				mxGetString(mx_arr, (si1 *) MED_paths, max_len);
+			break;
+		case 1:   // single string passed in cell array
+			MED_paths = calloc_m12((size_t) max_len, sizeof(si1), __FUNCTION__, USE_GLOBAL_BEHAVIOR_m12);
+			mx_cell_p = mxGetCell(mx_arr, 0);
+			mxGetString(mx_cell_p, (si1 *) MED_paths, max_len);
+			*n_files = 0;  // (indicates single string)
+			break;
+		default:  // multiple strings in cell array
+			MED_paths = (void *) calloc_2D_m12((size_t) *n_files, (size_t) max_len, sizeof(si1), __FUNCTION__, USE_GLOBAL_BEHAVIOR_m12);
+			MED_paths_p = (si1 **) MED_paths;
+			for (i = 0; i < *n_files; ++i) {
+				mx_cell_p = mxGetCell(mx_arr, i);
+				mxGetString(mx_cell_p, MED_paths_p[i], max_len);
+			}
+			break;
+	}
 
-        return(samples);
+	return(MED_paths);
 }
 
 
@@ -7,6 +7,7 @@
 
 // Includes
 #include "medlib_m12.h"
+#include "conversion_channels.h"
 
 // Defines
 
@@ -19,9 +20,11 @@
 
 
 // Prototypes
+void		mexExitFunction(void);
 void		mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[]);
 mxArray		*get_si8_array(const mxArray *mx_in_arr);
-mxArray		*MED_time_for_sample(mxArray *samples, si1 *MED_directory, si1 *password);
+mxArray		*MED_time_for_sample(mxArray *samples, void *MED_paths, si4 n_files, si1 *password, ui1 persist_mode, mxArray **channel_names);
+void		*get_MED_paths(const mxArray *mx_arr, si4 *n_files);
 
 
 #endif /* MED_TIME_FOR_SAMPLE_EXEC_IN */
@@ -0,0 +1,170 @@
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Behaviour test: decoded block cache (block_cache.c)
+// Checks hits & misses by key, that blocks are only returned to callers whose access level covers their encryption level, that the first of two
+// workers caching a block is kept, least recently used eviction within the byte budget (lookups refresh a block), that pinned blocks are not evicted,
+// that shrinking the budget frees blocks, & that a budget of 0 disables the cache (no storage is handed out, so decoders write straight to their output).
+
+//*************************************************** Compile Line ***************************************************//
+//****  cc -O2 -I.. -o block_cache_test block_cache_test.c test_util.c ../block_cache.c ../medlib_m12.c ../dhnlib_m12.c -lm -lpthread  ****//
+//********************************************************************************************************************//
+//	usage: block_cache_test
+
+
+#include "block_cache.h"
+#include "test_util.h"
+
+// Miscellaneous
+#define TEST_BLOCK_SAMPS	((si8) 1000)
+#define TEST_BLOCK_BYTES	((si8) sizeof(BLOCK_CACHE_ENTRY) + (TEST_BLOCK_SAMPS * (si8) sizeof(si4)))
+#define TEST_CHAN_UID		((ui8) 0x1234567890ABCDEF)
+
+
+// decodes a block into cache storage (samples: block_num + i) & caches it, returns FALSE_m12 if the cache handed out no storage
+TERN_m12	cache_test_block(si4 seg_num, si8 block_num, si1 enc_level)
+{
+	si8			i;
+	BLOCK_CACHE_ENTRY	*entry;
+
+
+	entry = new_cached_block(TEST_CHAN_UID, seg_num, block_num, enc_level, TEST_BLOCK_SAMPS);
+	if (entry == NULL)
+		return(FALSE_m12);
+	for (i = 0; i < TEST_BLOCK_SAMPS; ++i)
+		entry->samps[i] = (si4) (block_num + i);
+	insert_cached_block(entry);
+
+	return(TRUE_m12);
+}
+
+
+// returns TRUE_m12 if block is cached with its samples (lookup refreshes it)
+TERN_m12	test_block_cached(si4 seg_num, si8 block_num, ui1 access_level)
+{
+	si8			i;
+	TERN_m12		intact;
+	BLOCK_CACHE_ENTRY	*entry;
+
+
+	entry = get_cached_block(TEST_CHAN_UID, seg_num, block_num, access_level);
+	if (entry == NULL)
+		return(FALSE_m12);
+	intact = (entry->n_samps == TEST_BLOCK_SAMPS) ? TRUE_m12 : FALSE_m12;
+	for (i = 0; i < entry->n_samps && intact == TRUE_m12; ++i)
+		if (entry->samps[i] != (si4) (block_num + i))
+			intact = FALSE_m12;
+	release_cached_block(entry);
+	test_check(intact, "block %ld: cached samples differ", (long) block_num);
+
+	return(TRUE_m12);
+}
+
+
+void	test_keys_and_access(void)
+{
+	BLOCK_CACHE_STATS	stats;
+
+
+	set_block_cache_budget(TEST_BLOCK_BYTES * 16);
+	test_check(test_block_cached(1, 0, 0) == FALSE_m12 ? TRUE_m12 : FALSE_m12, "empty cache: block found");
+	test_check(cache_test_block(1, 0, NO_ENCRYPTION_m12), "budget of 16 blocks: no storage handed out");
+	test_check(test_block_cached(1, 0, 0), "cached block not found");
+	test_check(test_block_cached(2, 0, 0) == FALSE_m12 ? TRUE_m12 : FALSE_m12, "block found under another segment number");
+	test_check(test_block_cached(1, 1, 0) == FALSE_m12 ? TRUE_m12 : FALSE_m12, "block found under another block number");
+	test_check(block_is_cached(TEST_CHAN_UID, 1, 0, 0), "block_is_cached(): cached block not found");
+
+	// encryption levels
+	cache_test_block(1, 1, LEVEL_1_ENCRYPTION_m12);
+	cache_test_block(1, 2, LEVEL_2_ENCRYPTION_m12);
+	test_check(test_block_cached(1, 1, 0) == FALSE_m12 ? TRUE_m12 : FALSE_m12, "level 1 block returned without access");
+	test_check(test_block_cached(1, 1, 1), "level 1 block not returned with level 1 access");
+	test_check(test_block_cached(1, 2, 1) == FALSE_m12 ? TRUE_m12 : FALSE_m12, "level 2 block returned with level 1 access");
+	test_check(test_block_cached(1, 2, 2), "level 2 block not returned with level 2 access");
+	test_check(block_is_cached(TEST_CHAN_UID, 1, 2, 1) == FALSE_m12 ? TRUE_m12 : FALSE_m12, "block_is_cached(): level 2 block found with level 1 access");
+
+	// a second worker caching the same block: the first one in is kept
+	test_check(cache_test_block(1, 0, NO_ENCRYPTION_m12), "no storage handed out for a cached block");
+	get_block_cache_stats(&stats);
+	test_check(stats.n_blocks == 3 ? TRUE_m12 : FALSE_m12, "%ld blocks cached after caching a block twice, expected 3", (long) stats.n_blocks);
+	test_check(stats.bytes == 3 * TEST_BLOCK_BYTES ? TRUE_m12 : FALSE_m12, "cache holds %ld bytes, expected %ld", (long) stats.bytes, (long) (3 * TEST_BLOCK_BYTES));
+
+	set_block_cache_budget(0);
+
+	return;
+}
+
+
+void	test_eviction(void)
+{
+	si8			i;
+	BLOCK_CACHE_STATS	stats, stats_0;
+	BLOCK_CACHE_ENTRY	*pinned;
+
+
+	get_block_cache_stats(&stats_0);
+	set_block_cache_budget(TEST_BLOCK_BYTES * 4);
+	for (i = 0; i < 4; ++i)
+		cache_test_block(1, i, NO_ENCRYPTION_m12);
+	test_block_cached(1, 0, 0);  // block 0 is now most recently used: block 1 is evicted next
+	cache_test_block(1, 4, NO_ENCRYPTION_m12);
+	test_check(test_block_cached(1, 1, 0) == FALSE_m12 ? TRUE_m12 : FALSE_m12, "least recently used block not evicted");
+	test_check(test_block_cached(1, 0, 0), "recently looked up block evicted");
+	test_check(test_block_cached(1, 4, 0), "newest block not cached");
+	get_block_cache_stats(&stats);
+	test_check(stats.bytes <= stats.budget ? TRUE_m12 : FALSE_m12, "cache holds %ld bytes, over its budget of %ld", (long) stats.bytes, (long) stats.budget);
+	test_check(stats.evictions - stats_0.evictions == 1 ? TRUE_m12 : FALSE_m12, "%ld evictions, expected 1", (long) (stats.evictions - stats_0.evictions));
+
+	// pinned blocks are not evicted (block 2 is least recently used)
+	pinned = get_cached_block(TEST_CHAN_UID, 1, 2, 0);
+	test_check(pinned != NULL ? TRUE_m12 : FALSE_m12, "block 2 not cached");
+	for (i = 0; i < 4; ++i)
+		test_block_cached(1, (i == 0) ? 3 : ((i == 1) ? 0 : 4), 0);
+	cache_test_block(1, 5, NO_ENCRYPTION_m12);
+	cache_test_block(1, 6, NO_ENCRYPTION_m12);
+	if (pinned != NULL) {
+		test_check(pinned->samps[TEST_BLOCK_SAMPS - 1] == (si4) (2 + TEST_BLOCK_SAMPS - 1) ? TRUE_m12 : FALSE_m12, "pinned block overwritten");
+		release_cached_block(pinned);
+	}
+	test_check(test_block_cached(1, 2, 0), "pinned block evicted");
+
+	// shrinking the budget frees blocks
+	set_block_cache_budget(TEST_BLOCK_BYTES * 2);
+	get_block_cache_stats(&stats);
+	test_check(stats.n_blocks <= 2 ? TRUE_m12 : FALSE_m12, "%ld blocks cached after budget shrank to 2 blocks", (long) stats.n_blocks);
+
+	// a block larger than the budget is not cached
+	set_block_cache_budget(TEST_BLOCK_BYTES - 1);
+	test_check(cache_test_block(1, 7, NO_ENCRYPTION_m12) == FALSE_m12 ? TRUE_m12 : FALSE_m12, "storage handed out for a block larger than the budget");
+
+	set_block_cache_budget(0);
+
+	return;
+}
+
+
+void	test_disabled(void)
+{
+	BLOCK_CACHE_STATS	stats;
+
+
+	set_block_cache_budget(0);
+	get_block_cache_stats(&stats);
+	test_check(stats.n_blocks == 0 && stats.bytes == 0 ? TRUE_m12 : FALSE_m12, "disabling the cache left %ld blocks (%ld bytes)", (long) stats.n_blocks, (long) stats.bytes);
+	test_check(cache_test_block(1, 0, NO_ENCRYPTION_m12) == FALSE_m12 ? TRUE_m12 : FALSE_m12, "disabled cache handed out storage");
+	test_check(test_block_cached(1, 0, 0) == FALSE_m12 ? TRUE_m12 : FALSE_m12, "disabled cache returned a block");
+
+	return;
+}
+
+
+si4	main(si4 argc, si1 **argv)
+{
+	initialize_block_cache(0);
+	test_keys_and_access();
+	test_eviction();
+	test_disabled();
+	free_block_cache();
+
+	return(test_finish("block_cache_test"));
+}
+
@@ -0,0 +1,155 @@
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Behaviour test: tiled filtering (read_MED_exec.c filter_task()), run through read_MED_exec's mexFunction() with the stub mx API (../Benchmarks/mx_shim.c)
+// Each filter type is read over a window long enough to be split into several overlapping tiles, & over a window that fits in one tile. The filtered
+// output must match the unfiltered read filtered as a whole (FILT_filtfilt_m12() over the entire slice) to within TEST_TOLERANCE of its peak amplitude.
+// Tile overlaps let edge transients decay by FILT_SETTLE_NEPERS (e^-25 ~ 1.4e-11); the tolerance allows a factor of 10 for transients larger than the signal.
+// Cutoffs must be above ~0.001 of the sampling frequency (below that, the filter's own roundoff limits whole slice & tiled output alike to ~1e-6).
+// Test session: make_MED_session test_session --channels 1 --rates 1000 --segments 2 --segment-seconds 3600 (no discontinuities: tiles span segments)
+
+//*********************************************************************************************************************************************************************************************************** Compile Line ************************************************************************************************************************************************************************************************************//
+//****  cc -O2 -DMATLAB_m12 -I. -I../Benchmarks -I.. filter_tile_test.c test_util.c ../Benchmarks/bench_util.c ../Benchmarks/mx_shim.c ../read_MED_exec.c ../sample_conversion.c ../work_queue.c ../filter_cache.c ../prefetch.c ../session_registry.c ../block_cache.c ../stage_timing.c ../record_journal.c ../record_merge.c ../record_query.c ../record_table.c ../medlib_m12.c ../medrec_m12.c ../dhnlib_m12.c -lm -lpthread  ****//
+//*************************************************************************************************************************************************************************************************************************************************************************************************************************************************************************************************************************************//
+//	usage: filter_tile_test session_directory [password]
+
+
+#include "bench_util.h"
+#include "read_MED_exec.h"
+#include "test_util.h"
+
+// Miscellaneous
+#define TEST_TOLERANCE		((sf8) 1e-10)	// of peak filtered amplitude
+#define TEST_SHORT_SECONDS	((sf8) 60.0)	// single tile window
+#define TEST_N_FILTERS		4
+#define NUMBER_OF_RPS_FIELDS	10
+#define RPS_FIELD_NAMES { \
+	"Data", "ExtMode", "Start", "End", "Pass", "IdxChan", "Format", "Filt", "LowCut", "HighCut" \
+}
+
+
+// reads first channel from session start for secs seconds (secs <= 0: whole session) as doubles, returns NULL if read failed
+mxArray	*read_test_window(si1 *chan_path, si1 *password, sf8 secs, const si1 *filt, sf8 low_cut, sf8 high_cut, sf8 *samp_freq)
+{
+	const si1	*rps_fields[NUMBER_OF_RPS_FIELDS] = RPS_FIELD_NAMES;
+	mxArray		*rps, *slice, *chans, *metadata, *data, *plhs[1];
+	const mxArray	*prhs[1];
+
+
+	rps = bench_param_struct(rps_fields, NUMBER_OF_RPS_FIELDS);
+	bench_set_field(rps, "Data", bench_channel_cell(&chan_path, 1));
+	bench_set_field(rps, "ExtMode", mxCreateString("time"));
+	if (password != NULL)
+		bench_set_field(rps, "Pass", mxCreateString(password));
+	bench_set_field(rps, "Format", mxCreateString("double"));
+	bench_set_field(rps, "Filt", mxCreateString(filt));
+	if (strcmp(filt, "none")) {
+		bench_set_field(rps, "LowCut", mxCreateDoubleScalar(low_cut));
+		bench_set_field(rps, "HighCut", mxCreateDoubleScalar(high_cut));
+	}
+	if (secs > (sf8) 0.0) {  // negative times are relative to session start
+		bench_set_field(rps, "Start", mxCreateDoubleScalar((sf8) -1.0));
+		bench_set_field(rps, "End", mxCreateDoubleScalar(-(secs * (sf8) 1e6)));
+	}
+	plhs[0] = NULL;
+	prhs[0] = rps;
+	mexFunction(1, plhs, 1, prhs);
+	mxDestroyArray(rps);
+
+	slice = plhs[0];
+	if (slice == NULL || mxIsStruct(slice) == false)
+		return(NULL);
+	chans = mxGetField(slice, 0, "channels");
+	metadata = mxGetField(slice, 0, "metadata");
+	if (chans == NULL || metadata == NULL)
+		return(NULL);
+	*samp_freq = mxGetScalar(mxGetField(metadata, 0, "sampling_frequency"));
+	data = mxDuplicateArray(mxGetField(chans, 0, "data"));
+	mxDestroyArray(slice);
+
+	return(data);
+}
+
+
+// returns largest difference between the filtered read & the unfiltered read filtered as a whole, relative to the whole slice filter's peak amplitude
+sf8	tile_error(mxArray *unfilt, mxArray *filt, si4 filt_type, sf8 samp_freq, sf8 cut_1, sf8 cut_2)
+{
+	si8				i, n_samps;
+	sf8				*x, *y, diff, max_diff, peak;
+	FILT_PROCESSING_STRUCT_m12	*filtps;
+
+
+	n_samps = (si8) mxGetNumberOfElements(unfilt);
+	filtps = FILT_initialize_processing_struct_m12(FILTER_ORDER, filt_type, samp_freq, n_samps, TRUE_m12, TRUE_m12, TRUE_m12, RETURN_ON_FAIL_m12 | SUPPRESS_OUTPUT_m12, cut_1, cut_2);
+	if (filtps == NULL)
+		return((sf8) -1.0);
+	memcpy((void *) filtps->orig_data, (void *) mxGetPr(unfilt), (size_t) n_samps * sizeof(sf8));
+	FILT_filtfilt_m12(filtps);
+
+	x = filtps->filt_data;
+	y = mxGetPr(filt);
+	for (i = 0, max_diff = peak = (sf8) 0.0; i < n_samps; ++i) {
+		diff = fabs(y[i] - x[i]);
+		if (diff > max_diff)
+			max_diff = diff;
+		if (fabs(x[i]) > peak)
+			peak = fabs(x[i]);
+	}
+	FILT_free_processing_struct_m12(filtps, TRUE_m12, TRUE_m12, TRUE_m12, TRUE_m12);
+
+	return((peak > (sf8) 0.0) ? max_diff / peak : max_diff);
+}
+
+
+si4	main(si4 argc, si1 **argv)
+{
+	si1		*password, **chan_paths;
+	si4		f, w, n_chans;
+	sf8		samp_freq, secs, error, cut_1, cut_2;
+	mxArray		*unfilt, *filt;
+	const si1	*filt_names[TEST_N_FILTERS] = { "lowpass", "highpass", "bandpass", "bandstop" };
+	si4		filt_types[TEST_N_FILTERS] = { FILT_LOWPASS_TYPE_m12, FILT_HIGHPASS_TYPE_m12, FILT_BANDPASS_TYPE_m12, FILT_BANDSTOP_TYPE_m12 };
+	sf8		low_cuts[TEST_N_FILTERS] = { 0.0, 1.0, 1.0, 55.0 };
+	sf8		high_cuts[TEST_N_FILTERS] = { 40.0, 0.0, 40.0, 65.0 };
+
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s session_directory [password]\n", argv[0]);
+		return(1);
+	}
+	password = (argc > 2) ? argv[2] : NULL;
+	n_chans = bench_list_channels(argv[1], &chan_paths);
+	if (n_chans == 0) {
+		fprintf(stderr, "no time series channels in %s\n", argv[1]);
+		return(1);
+	}
+
+	for (w = 0; w < 2; ++w) {
+		secs = (w == 0) ? (sf8) 0.0 : TEST_SHORT_SECONDS;  // whole session (tiled), then a single tile
+		unfilt = read_test_window(chan_paths[0], password, secs, "none", (sf8) 0.0, (sf8) 0.0, &samp_freq);
+		if (test_check(unfilt != NULL ? TRUE_m12 : FALSE_m12, "unfiltered read of %s failed", chan_paths[0]) == FALSE_m12)
+			break;
+		if (w == 0)
+			test_check((si8) mxGetNumberOfElements(unfilt) > 2 * FILT_TILE_SAMPLES ? TRUE_m12 : FALSE_m12, \
+				   "session has %ld samples: too short to be read in several tiles", (long) mxGetNumberOfElements(unfilt));
+		for (f = 0; f < TEST_N_FILTERS; ++f) {
+			filt = read_test_window(chan_paths[0], password, secs, filt_names[f], low_cuts[f], high_cuts[f], &samp_freq);
+			if (test_check(filt != NULL ? TRUE_m12 : FALSE_m12, "%s read failed", filt_names[f]) == FALSE_m12)
+				continue;
+			if (test_check(mxGetNumberOfElements(filt) == mxGetNumberOfElements(unfilt) ? TRUE_m12 : FALSE_m12, "%s read returned %ld samples, unfiltered %ld", \
+				       filt_names[f], (long) mxGetNumberOfElements(filt), (long) mxGetNumberOfElements(unfilt)) == TRUE_m12) {
+				cut_1 = (filt_types[f] == FILT_LOWPASS_TYPE_m12) ? high_cuts[f] : low_cuts[f];
+				cut_2 = (filt_types[f] == FILT_BANDPASS_TYPE_m12 || filt_types[f] == FILT_BANDSTOP_TYPE_m12) ? high_cuts[f] : (sf8) -1.0;
+				error = tile_error(unfilt, filt, filt_types[f], samp_freq, cut_1, cut_2);
+				printf("%-8s %-13s %10ld samples  error %.2e of peak\n", filt_names[f], (w == 0) ? "(tiled)" : "(single tile)", (long) mxGetNumberOfElements(filt), error);
+				test_check((error >= (sf8) 0.0 && error <= TEST_TOLERANCE) ? TRUE_m12 : FALSE_m12, "%s %s: error %.2e of peak, tolerance %.0e", \
+					   filt_names[f], (w == 0) ? "tiled" : "single tile", error, TEST_TOLERANCE);
+			}
+			mxDestroyArray(filt);
+		}
+		mxDestroyArray(unfilt);
+	}
+	bench_free_list(chan_paths, n_chans);
+
+	return(test_finish("filter_tile_test"));
+}
+
@@ -0,0 +1,213 @@
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Behaviour test: sorted sweep time <=> sample conversion (index_sweep.c)
+// Queries every block's first & last times & samples (& their neighbours), discontinuities, the channel's edges, & an even grid over its whole index range.
+// sweep_chunk() must agree with G_sample_number_for_uutc_m12() & G_uutc_for_sample_number_m12() (FIND_ABSOLUTE_m12 | FIND_CURRENT_m12) on every query it
+// resolves, & may leave only queries outside every block to medlib. sweep_sample_for_time() & sweep_time_for_sample() must then agree on every query, in
+// the caller's (unsorted) order, across several runs of SWEEP_CHUNK_QUERIES.
+// Test channels: make_MED_session test_session --channels 1 --segments 3 --gaps 4 --block-seconds 1.37 (gaps & blocks of varying sample counts)
+
+//******************************************************************************************* Compile Line *******************************************************************************************//
+//****  cc -O2 -I.. -o index_sweep_test index_sweep_test.c test_util.c ../index_sweep.c ../session_manifest.c ../record_journal.c ../work_queue.c ../medlib_m12.c ../medrec_m12.c ../dhnlib_m12.c -lm -lpthread  ****//
+//****************************************************************************************************************************************************************************************************//
+//	usage: index_sweep_test channel_directory [password]
+
+
+#include "index_sweep.h"
+#include "session_manifest.h"
+#include "test_util.h"
+
+// Miscellaneous
+#define TEST_GRID_QUERIES	((si8) 200000)		// evenly spaced over the channel (several runs of SWEEP_CHUNK_QUERIES)
+#define TEST_OUTSIDE_OFFSET	((si8) 1000000)		// queries this far before & after the channel (microseconds or samples)
+#define TEST_FIND_MODE		(FIND_ABSOLUTE_m12 | FIND_CURRENT_m12)
+
+
+// returns queries around every block boundary, in discontinuities, outside the channel, & on an even grid over it (caller frees)
+si8	*sweep_test_queries(SWEEP_MAP *map, si4 direction, si8 *n_queries)
+{
+	si8		i, n, first, last, start, end, *queries;
+	SWEEP_BLOCK	*blk;
+
+
+	queries = (si8 *) malloc((size_t) ((map->n_blocks * 8) + TEST_GRID_QUERIES + 2) * sizeof(si8));
+	n = 0;
+	for (i = 0, blk = map->blocks; i < map->n_blocks; ++i, ++blk) {
+		start = (direction == SWEEP_SAMPLE_FOR_TIME) ? blk->start_time : blk->start_sample_number;
+		end = (direction == SWEEP_SAMPLE_FOR_TIME) ? blk->end_time : blk->end_sample_number;
+		queries[n++] = start - 1;
+		queries[n++] = start;
+		queries[n++] = start + 1;
+		queries[n++] = (start + end) / 2;
+		queries[n++] = end - 1;
+		queries[n++] = end;
+		queries[n++] = end + 1;
+		if (direction == SWEEP_SAMPLE_FOR_TIME && blk->contiguous_next == FALSE_m12 && i + 1 < map->n_blocks)
+			queries[n++] = (end + (blk + 1)->start_time) / 2;  // middle of discontinuity
+	}
+	first = (direction == SWEEP_SAMPLE_FOR_TIME) ? map->blocks[0].start_time : map->blocks[0].start_sample_number;
+	last = (direction == SWEEP_SAMPLE_FOR_TIME) ? map->blocks[map->n_blocks - 1].end_time : map->blocks[map->n_blocks - 1].end_sample_number;
+	queries[n++] = first - TEST_OUTSIDE_OFFSET;
+	queries[n++] = last + TEST_OUTSIDE_OFFSET;
+	for (i = 0; i < TEST_GRID_QUERIES; ++i)
+		queries[n++] = first + (si8) (((sf8) i / (sf8) (TEST_GRID_QUERIES - 1)) * (sf8) (last - first));
+	*n_queries = n;
+
+	return(queries);
+}
+
+
+// returns TRUE_m12 if value is within a block (start through end, inclusive)
+TERN_m12	inside_block(SWEEP_MAP *map, si8 value, si4 direction)
+{
+	si8		lo, hi, mid;
+	SWEEP_BLOCK	*blk;
+
+
+	lo = 0;
+	hi = map->n_blocks - 1;
+	while (lo <= hi) {
+		mid = (lo + hi) >> 1;
+		blk = map->blocks + mid;
+		if (value < ((direction == SWEEP_SAMPLE_FOR_TIME) ? blk->start_time : blk->start_sample_number))
+			hi = mid - 1;
+		else if (value > ((direction == SWEEP_SAMPLE_FOR_TIME) ? blk->end_time : blk->end_sample_number))
+			lo = mid + 1;
+		else
+			return(TRUE_m12);
+	}
+
+	return(FALSE_m12);
+}
+
+
+si8	medlib_conversion(CHANNEL_m12 *chan, si8 value, si4 direction)
+{
+	if (direction == SWEEP_SAMPLE_FOR_TIME)
+		return(G_sample_number_for_uutc_m12((LEVEL_HEADER_m12 *) chan, value, TEST_FIND_MODE));
+
+	return(G_uutc_for_sample_number_m12((LEVEL_HEADER_m12 *) chan, value, TEST_FIND_MODE));
+}
+
+
+// one sweep_chunk() over all queries (sorted): resolved results must match medlib, & only queries outside every block may be left unresolved
+void	test_sweep_chunk(CHANNEL_m12 *chan, SWEEP_MAP *map, si8 *values, si8 n_values, si4 direction, const si1 *conversion)
+{
+	ui1		*resolved;
+	si8		i, ref, *results, n_resolved;
+	SWEEP_QUERY	*queries;
+	SWEEP_CHUNK	chunk;
+
+
+	queries = (SWEEP_QUERY *) malloc((size_t) n_values * sizeof(SWEEP_QUERY));
+	for (i = 0; i < n_values; ++i) {
+		queries[i].value = values[i];
+		queries[i].idx = i;
+	}
+	qsort((void *) queries, (size_t) n_values, sizeof(SWEEP_QUERY), compare_sweep_queries);
+	results = (si8 *) malloc((size_t) n_values * sizeof(si8));
+	resolved = (ui1 *) calloc((size_t) n_values, sizeof(ui1));
+	chunk.map = map;
+	chunk.queries = queries;
+	chunk.n_queries = n_values;
+	chunk.results = results;
+	chunk.resolved = resolved;
+	chunk.direction = direction;
+	sweep_chunk((void *) &chunk, 0);
+
+	for (i = n_resolved = 0; i < n_values; ++i) {
+		if (resolved[i]) {
+			ref = medlib_conversion(chan, values[i], direction);
+			test_check(results[i] == ref ? TRUE_m12 : FALSE_m12, "%s sweep_chunk(): %ld -> %ld, medlib: %ld", conversion, (long) values[i], (long) results[i], (long) ref);
+			++n_resolved;
+		} else {
+			test_check(inside_block(map, values[i], direction) == FALSE_m12 ? TRUE_m12 : FALSE_m12, "%s sweep_chunk(): %ld (inside a block) left unresolved", conversion, (long) values[i]);
+		}
+	}
+	test_check(n_resolved > 0 ? TRUE_m12 : FALSE_m12, "%s sweep_chunk(): no queries resolved", conversion);
+	printf("%s: %ld queries, %ld resolved by sweep_chunk()\n", conversion, (long) n_values, (long) n_resolved);
+
+	free((void *) queries);
+	free((void *) results);
+	free((void *) resolved);
+
+	return;
+}
+
+
+// whole conversion, in place, on unsorted queries: every result (swept or left to medlib) must match medlib
+void	test_sweep_conversion(CHANNEL_m12 *chan, SWEEP_MAP *map, si8 *values, si8 n_values, si4 direction, const si1 *conversion)
+{
+	si8	i, j, tmp, ref, *out;
+
+
+	// unsort (deterministic shuffle)
+	srand(1);
+	for (i = n_values - 1; i > 0; --i) {
+		j = (si8) rand() % (i + 1);
+		tmp = values[i];
+		values[i] = values[j];
+		values[j] = tmp;
+	}
+	out = (si8 *) malloc((size_t) n_values * sizeof(si8));
+	memcpy((void *) out, (void *) values, (size_t) n_values * sizeof(si8));
+	if (direction == SWEEP_SAMPLE_FOR_TIME)
+		sweep_sample_for_time(chan, map, out, n_values);
+	else
+		sweep_time_for_sample(chan, map, out, n_values);
+	for (i = 0; i < n_values; ++i) {
+		ref = medlib_conversion(chan, values[i], direction);
+		test_check(out[i] == ref ? TRUE_m12 : FALSE_m12, "%s: query %ld (%ld) -> %ld, medlib: %ld", conversion, (long) i, (long) values[i], (long) out[i], (long) ref);
+	}
+	free((void *) out);
+
+	return;
+}
+
+
+si4	main(si4 argc, si1 **argv)
+{
+	si1		*password;
+	si8		n_queries, *queries;
+	CHANNEL_m12	*chan;
+	TIME_SLICE_m12	slice;
+	SWEEP_MAP	*map;
+
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s channel_directory [password]\n", argv[0]);
+		return(1);
+	}
+	password = (argc > 2) ? argv[2] : NULL;
+
+	G_initialize_medlib_m12(FALSE_m12, FALSE_m12);
+	G_initialize_time_slice_m12(&slice);
+	slice.start_time = BEGINNING_OF_TIME_m12;
+	slice.end_time = END_OF_TIME_m12;
+	chan = G_open_channel_m12(NULL, &slice, argv[1], (LH_READ_SEGMENT_METADATA_m12 | LH_MAP_ALL_SEGMENTS_m12), password);
+	if (chan == NULL || read_segment_indices(chan) == FALSE_m12) {
+		fprintf(stderr, "cannot open %s\n", argv[1]);
+		return(1);
+	}
+	map = build_sweep_map(chan);
+	if (test_check(map != NULL ? TRUE_m12 : FALSE_m12, "cannot build block map") == FALSE_m12)
+		return(test_finish("index_sweep_test"));
+	printf("%ld blocks\n", (long) map->n_blocks);
+
+	queries = sweep_test_queries(map, SWEEP_SAMPLE_FOR_TIME, &n_queries);
+	test_sweep_chunk(chan, map, queries, n_queries, SWEEP_SAMPLE_FOR_TIME, "sample_for_time");
+	test_sweep_conversion(chan, map, queries, n_queries, SWEEP_SAMPLE_FOR_TIME, "sample_for_time");
+	free((void *) queries);
+
+	queries = sweep_test_queries(map, SWEEP_TIME_FOR_SAMPLE, &n_queries);
+	test_sweep_chunk(chan, map, queries, n_queries, SWEEP_TIME_FOR_SAMPLE, "time_for_sample");
+	test_sweep_conversion(chan, map, queries, n_queries, SWEEP_TIME_FOR_SAMPLE, "time_for_sample");
+	free((void *) queries);
+
+	free_sweep_map(map);
+	G_free_channel_m12(chan, TRUE_m12);
+	G_free_globals_m12(TRUE_m12);
+
+	return(test_finish("index_sweep_test"));
+}
+
@@ -0,0 +1,225 @@
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Behaviour test: record journal (record_journal.c)
+// Writes a journal in a scratch directory, & checks that appended records read back in order, that an entry an interrupted writer did not finish
+// (bytes after the committed entries, or a header committed before its entries reached the disk) neither hides nor corrupts the entries appended after
+// it, that writers count entries from the header, & that merging applies tombstones as rewriting the record files would, within the slice's times only.
+
+//************************************************************************** Compile Line **************************************************************************//
+//****  cc -O2 -I.. -o record_journal_test record_journal_test.c test_util.c ../record_journal.c ../medlib_m12.c ../medrec_m12.c ../dhnlib_m12.c -lm -lpthread  ****//
+//******************************************************************************************************************************************************************//
+//	usage: record_journal_test
+
+
+#include "record_journal.h"
+#include "test_util.h"
+
+// Miscellaneous
+#define TEST_BODY_BYTES		16
+#define TEST_TYPE_NOTE		((ui4) 0x65746F4E)	// "Note"
+#define TEST_TYPE_SEIZ		((ui4) 0x7A696553)	// "Seiz"
+
+
+// returns unencrypted record with body text "<start_time>" (caller frees)
+RECORD_HEADER_m12	*new_test_record(si8 start_time, ui4 type_code)
+{
+	RECORD_HEADER_m12	*rh;
+
+
+	rh = (RECORD_HEADER_m12 *) calloc((size_t) 1, (size_t) (RECORD_HEADER_BYTES_m12 + TEST_BODY_BYTES));
+	rh->total_record_bytes = (ui4) (RECORD_HEADER_BYTES_m12 + TEST_BODY_BYTES);
+	rh->start_time = start_time;
+	rh->type_code = type_code;
+	rh->encryption_level = NO_ENCRYPTION_m12;
+	sprintf((si1 *) rh + RECORD_HEADER_BYTES_m12, "%ld", (long) start_time);
+
+	return(rh);
+}
+
+
+TERN_m12	append_test_record(SEGMENT_RECORD_FILES *srf, si8 start_time, ui4 type_code)
+{
+	TERN_m12		written;
+	RECORD_HEADER_m12	*rh;
+
+
+	rh = new_test_record(start_time, type_code);
+	written = append_journal_records(srf, &rh, 1);
+	free((void *) rh);
+
+	return(written);
+}
+
+
+// checks journal's appended records have the expected start times (& intact bodies), in order
+void	check_journal(SEGMENT_RECORD_FILES *srf, si8 *times, si8 n_times, const si1 *stage)
+{
+	si1			text[32];
+	si8			i, file_bytes;
+	FILE			*fp;
+	RJNL_ENTRY		*entry;
+	RECORD_JOURNAL		*jnl;
+	RECORD_HEADER_m12	*rh;
+
+
+	jnl = read_record_journal(srf->journal_file);
+	if (test_check(jnl != NULL ? TRUE_m12 : FALSE_m12, "%s: journal cannot be read", stage) == FALSE_m12)
+		return;
+	test_check(jnl->number_of_entries == n_times ? TRUE_m12 : FALSE_m12, "%s: %ld entries read, expected %ld", stage, (long) jnl->number_of_entries, (long) n_times);
+	for (i = 0, entry = next_journal_entry(jnl, NULL); entry != NULL && i < n_times; entry = next_journal_entry(jnl, entry), ++i) {
+		rh = (RECORD_HEADER_m12 *) (entry + 1);
+		sprintf(text, "%ld", (long) times[i]);
+		test_check((entry->op == RJNL_APPEND && rh->start_time == times[i] && strcmp((si1 *) rh + RECORD_HEADER_BYTES_m12, text) == 0) ? TRUE_m12 : FALSE_m12, \
+			   "%s: entry %ld is not the record appended at time %ld", stage, (long) i, (long) times[i]);
+	}
+	test_check(journal_entries(srf) == n_times ? TRUE_m12 : FALSE_m12, "%s: header counts %ld entries, expected %ld", stage, (long) journal_entries(srf), (long) n_times);
+
+	// the journal ends with its last committed entry once a writer has appended
+	fp = fopen(srf->journal_file, "rb");
+	if (fp != NULL) {
+		fseek(fp, 0, SEEK_END);
+		file_bytes = (si8) ftell(fp);
+		fclose(fp);
+		test_check(file_bytes == jnl->data_bytes ? TRUE_m12 : FALSE_m12, "%s: journal is %ld bytes, entries end at %ld", stage, (long) file_bytes, (long) jnl->data_bytes);
+	}
+	free_record_journal(jnl);
+
+	return;
+}
+
+
+// writes an entry (& part of its record) after the committed entries, as a writer interrupted before committing leaves it (longer than an appended
+// record, so bytes a writer failed to truncate would remain after its entry)
+void	write_torn_entry(SEGMENT_RECORD_FILES *srf)
+{
+	ui1		body[96];
+	FILE		*fp;
+	RJNL_ENTRY	entry;
+
+
+	memset((void *) &entry, 0, sizeof(RJNL_ENTRY));
+	entry.op = RJNL_APPEND;
+	entry.record_bytes = (ui4) (4 * (RECORD_HEADER_BYTES_m12 + TEST_BODY_BYTES));
+	entry.start_time = 999;
+	entry.type_code = TEST_TYPE_NOTE;
+	memset((void *) body, 0xFF, sizeof(body));
+	fp = fopen(srf->journal_file, "ab");
+	fwrite((void *) &entry, sizeof(RJNL_ENTRY), (size_t) 1, fp);
+	fwrite((void *) body, sizeof(body), (size_t) 1, fp);
+	fclose(fp);
+
+	return;
+}
+
+
+// rewrites the header to commit entries that are not in the file, as when the header reaches the disk before the entries it commits
+void	commit_missing_entries(SEGMENT_RECORD_FILES *srf)
+{
+	FILE		*fp;
+	RJNL_HEADER	hdr;
+
+
+	fp = fopen(srf->journal_file, "r+b");
+	fread((void *) &hdr, sizeof(RJNL_HEADER), (size_t) 1, fp);
+	hdr.number_of_entries += 2;
+	hdr.data_bytes += 2 * ((si8) sizeof(RJNL_ENTRY) + RECORD_HEADER_BYTES_m12 + TEST_BODY_BYTES);
+	fseek(fp, 0, SEEK_SET);
+	fwrite((void *) &hdr, sizeof(RJNL_HEADER), (size_t) 1, fp);
+	fclose(fp);
+
+	return;
+}
+
+
+void	test_torn_entries(SEGMENT_RECORD_FILES *srf)
+{
+	si8	times[] = { 100, 200, 300, 400, 500 };
+
+
+	test_check(append_test_record(srf, 100, TEST_TYPE_NOTE), "append to new journal failed");
+	test_check(append_test_record(srf, 200, TEST_TYPE_NOTE), "append failed");
+	test_check(append_test_record(srf, 300, TEST_TYPE_NOTE), "append failed");
+	check_journal(srf, times, 3, "appended");
+
+	// uncommitted bytes after the last entry: ignored by readers, truncated by the next writer
+	write_torn_entry(srf);
+	test_check(journal_entries(srf) == 3 ? TRUE_m12 : FALSE_m12, "torn entry counted");
+	test_check(append_test_record(srf, 400, TEST_TYPE_NOTE), "append after torn entry failed");
+	check_journal(srf, times, 4, "appended after torn entry");
+
+	// header committing entries that did not reach the disk (& a torn entry): the writer finds the last complete entry
+	write_torn_entry(srf);
+	commit_missing_entries(srf);
+	test_check(append_test_record(srf, 500, TEST_TYPE_NOTE), "append after missing entries failed");
+	check_journal(srf, times, 5, "appended after missing entries");
+
+	return;
+}
+
+
+// merges journal (appends at 100 through 500, then a tombstone at 200) with record file records at 150 & 200
+void	test_merge(SEGMENT_RECORD_FILES *srf)
+{
+	si8			i, n_merged;
+	RECORD_JOURNAL		*jnl;
+	RECORD_HEADER_m12	*file_recs[2], *merged[8];
+	si8			all_times[] = { 100, 150, 200, 300, 400, 500 };
+	si8			slice_times[] = { 150, 200, 300 };
+
+
+	test_check(append_journal_tombstone(srf, 200, TEST_TYPE_NOTE), "tombstone append failed");
+	file_recs[0] = new_test_record(150, TEST_TYPE_SEIZ);
+	file_recs[1] = new_test_record(200, TEST_TYPE_NOTE);
+	jnl = read_record_journal(srf->journal_file);
+	if (test_check(jnl != NULL ? TRUE_m12 : FALSE_m12, "journal with tombstone cannot be read") == FALSE_m12)
+		return;
+	test_check((jnl->number_of_entries == 6 && jnl->number_of_appends == 5) ? TRUE_m12 : FALSE_m12, "%ld entries (%ld appends), expected 6 (5)", (long) jnl->number_of_entries, (long) jnl->number_of_appends);
+
+	// whole session: the tombstone deletes the record file's record at 200 (the first with its type & time), not the journaled one
+	n_merged = merge_record_journal(jnl, file_recs, 2, merged, BEGINNING_OF_TIME_m12, END_OF_TIME_m12);
+	test_check(n_merged == 6 ? TRUE_m12 : FALSE_m12, "%ld records merged, expected 6", (long) n_merged);
+	for (i = 0; i < n_merged && i < 6; ++i)
+		test_check(merged[i]->start_time == all_times[i] ? TRUE_m12 : FALSE_m12, "merged record %ld at time %ld, expected %ld", (long) i, (long) merged[i]->start_time, (long) all_times[i]);
+	if (n_merged >= 3)
+		test_check(merged[2] != file_recs[1] ? TRUE_m12 : FALSE_m12, "tombstone deleted the journaled record instead of the record file's");
+
+	// slice 150 through 350: journaled records outside it are not merged
+	n_merged = merge_record_journal(jnl, file_recs, 2, merged, 150, 350);
+	test_check(n_merged == 3 ? TRUE_m12 : FALSE_m12, "%ld records merged in slice, expected 3", (long) n_merged);
+	for (i = 0; i < n_merged && i < 3; ++i)
+		test_check(merged[i]->start_time == slice_times[i] ? TRUE_m12 : FALSE_m12, "slice record %ld at time %ld, expected %ld", (long) i, (long) merged[i]->start_time, (long) slice_times[i]);
+
+	free_record_journal(jnl);
+	free((void *) file_recs[0]);
+	free((void *) file_recs[1]);
+
+	return;
+}
+
+
+si4	main(si4 argc, si1 **argv)
+{
+	si1			dir[FULL_FILE_NAME_BYTES_m12];
+	SEGMENT_RECORD_FILES	srf;
+
+
+	G_initialize_medlib_m12(FALSE_m12, FALSE_m12);
+	if (test_scratch_directory("record_journal_test", dir) == FALSE_m12) {
+		fprintf(stderr, "cannot create scratch directory \"%s\"\n", dir);
+		return(1);
+	}
+	memset((void *) &srf, 0, sizeof(SEGMENT_RECORD_FILES));
+	srf.segment_number = 1;
+	strcpy(srf.ssr_path, dir);
+	sprintf(srf.journal_file, "%s/test_s000001.%s", dir, RJNL_FILE_TYPE_STRING);
+	srf.ssr_exists = TRUE_m12;
+
+	test_torn_entries(&srf);
+	test_merge(&srf);
+
+	test_remove_directory(dir);
+	G_free_globals_m12(TRUE_m12);
+
+	return(test_finish("record_journal_test"));
+}
+
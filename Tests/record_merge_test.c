@@ -0,0 +1,178 @@
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Behaviour test: k-way record merge (record_merge.c)
+// Merges randomly generated record data, pointer, & index streams (1 to TEST_MAX_STREAMS streams, times repeated within & across streams, terminal &
+// system log records interspersed, & one data stream out of time order) & checks the merge against a stable sort of every stream's records: records come
+// out in time order, equal times in stream order & then in stream position, excluded record types are skipped, & every other record comes out once.
+
+//*************************************************************** Compile Line ***************************************************************//
+//****  cc -O2 -I.. -o record_merge_test record_merge_test.c test_util.c ../record_merge.c ../record_journal.c ../medlib_m12.c ../medrec_m12.c ../dhnlib_m12.c -lm -lpthread  ****//
+//********************************************************************************************************************************************//
+//	usage: record_merge_test
+
+
+#include "record_merge.h"
+#include "test_util.h"
+
+// Miscellaneous
+#define TEST_MAX_STREAMS	20
+#define TEST_MAX_RECORDS	200		// per stream
+#define TEST_TRIALS		200
+#define TEST_BODY_BYTES		16
+#define TEST_RECORD_BYTES	(RECORD_HEADER_BYTES_m12 + TEST_BODY_BYTES)
+#define TEST_TYPE_NOTE		((ui4) 0x65746F4E)	// "Note"
+#define TEST_DATA_STREAM	0
+#define TEST_POINTER_STREAM	1
+#define TEST_INDEX_STREAM	2
+
+// Test Structures
+typedef struct {  // expected merge position of a record
+	si8		start_time;
+	si4		stream;
+	si8		position;  // in stream
+	void		*item;  // record header or index
+} TEST_ITEM;
+
+
+// fills record data for a stream: time ordered (times repeat, & few distinct times are used, so they repeat across streams too), or out of time order
+// with distinct times; every 7th record is a terminal or system log record
+void	fill_test_records(ui1 *data, si8 n_recs, TERN_m12 ordered)
+{
+	si8			i, t;
+	RECORD_HEADER_m12	*rh;
+
+
+	memset((void *) data, 0, (size_t) (n_recs * TEST_RECORD_BYTES));
+	for (i = 0, t = 0; i < n_recs; ++i) {
+		rh = (RECORD_HEADER_m12 *) (data + (i * TEST_RECORD_BYTES));
+		rh->total_record_bytes = (ui4) TEST_RECORD_BYTES;
+		if (ordered == TRUE_m12)
+			rh->start_time = (t += (si8) (rand() % 3));
+		else
+			rh->start_time = (((i * 7919) % n_recs) * 2) + 1;  // distinct (qsort() does not keep the order of equal times)
+		rh->type_code = (i % 7 == 3) ? ((i % 2) ? REC_Term_TYPE_CODE_m12 : REC_SyLg_TYPE_CODE_m12) : TEST_TYPE_NOTE;
+	}
+
+	return;
+}
+
+
+si4	compare_test_items(const void *a, const void *b)
+{
+	TEST_ITEM	*item_a, *item_b;
+
+
+	item_a = (TEST_ITEM *) a;
+	item_b = (TEST_ITEM *) b;
+	if (item_a->start_time != item_b->start_time)
+		return((item_a->start_time > item_b->start_time) ? 1 : -1);
+	if (item_a->stream != item_b->stream)
+		return((item_a->stream > item_b->stream) ? 1 : -1);
+	if (item_a->position != item_b->position)
+		return((item_a->position > item_b->position) ? 1 : -1);
+
+	return(0);
+}
+
+
+// one merge of n_streams streams of one kind (data & pointer streams, the first of which is out of time order, or index streams)
+void	test_merge_trial(si4 trial, si4 n_streams, si4 kind)
+{
+	ui1			**data;
+	si4			s;
+	si8			i, n_items, n_expected, n_recs[TEST_MAX_STREAMS];
+	void			*item;
+	TERN_m12		ordered;
+	TEST_ITEM		*expected;
+	RECORD_HEADER_m12	*rh, **ptrs;
+	RECORD_INDEX_m12	**indices;
+	RECORD_MERGE		*rm;
+
+
+	rm = new_record_merge(n_streams);
+	data = (ui1 **) calloc((size_t) n_streams, sizeof(ui1 *));
+	indices = (RECORD_INDEX_m12 **) calloc((size_t) n_streams, sizeof(RECORD_INDEX_m12 *));
+	expected = (TEST_ITEM *) malloc((size_t) (n_streams * TEST_MAX_RECORDS) * sizeof(TEST_ITEM));
+	n_expected = 0;
+	for (s = 0; s < n_streams; ++s) {
+		n_recs[s] = 1 + (si8) (rand() % TEST_MAX_RECORDS);
+		data[s] = (ui1 *) malloc((size_t) (n_recs[s] * TEST_RECORD_BYTES));
+		ordered = (kind != TEST_INDEX_STREAM && s == 0) ? FALSE_m12 : TRUE_m12;
+		fill_test_records(data[s], n_recs[s], ordered);
+		switch (kind) {
+			case TEST_DATA_STREAM:
+				add_record_data_stream(rm, data[s], n_recs[s]);
+				break;
+			case TEST_POINTER_STREAM:
+				if (ordered == FALSE_m12) {
+					add_record_data_stream(rm, data[s], n_recs[s]);
+					break;
+				}
+				ptrs = (RECORD_HEADER_m12 **) malloc((size_t) n_recs[s] * sizeof(RECORD_HEADER_m12 *));
+				for (i = 0; i < n_recs[s]; ++i)
+					ptrs[i] = (RECORD_HEADER_m12 *) (data[s] + (i * TEST_RECORD_BYTES));
+				add_record_pointer_stream(rm, ptrs, n_recs[s], TRUE_m12);
+				break;
+			case TEST_INDEX_STREAM:
+				indices[s] = (RECORD_INDEX_m12 *) calloc((size_t) n_recs[s], sizeof(RECORD_INDEX_m12));
+				for (i = 0; i < n_recs[s]; ++i) {
+					rh = (RECORD_HEADER_m12 *) (data[s] + (i * TEST_RECORD_BYTES));
+					indices[s][i].start_time = rh->start_time;
+					indices[s][i].type_code = rh->type_code;
+				}
+				add_record_index_stream(rm, indices[s], n_recs[s]);
+				break;
+		}
+
+		// expected records
+		for (i = 0; i < n_recs[s]; ++i) {
+			rh = (RECORD_HEADER_m12 *) (data[s] + (i * TEST_RECORD_BYTES));
+			if (rh->type_code != TEST_TYPE_NOTE)
+				continue;
+			expected[n_expected].start_time = rh->start_time;
+			expected[n_expected].stream = s;
+			expected[n_expected].position = i;
+			expected[n_expected++].item = (kind == TEST_INDEX_STREAM) ? (void *) (indices[s] + i) : (void *) rh;
+		}
+	}
+	qsort((void *) expected, (size_t) n_expected, sizeof(TEST_ITEM), compare_test_items);
+	test_check(rm->number_of_records == n_expected ? TRUE_m12 : FALSE_m12, "trial %d: merge counts %ld records, expected %ld", trial, (long) rm->number_of_records, (long) n_expected);
+
+	// merge
+	start_record_merge(rm);
+	for (n_items = 0; ; ++n_items) {
+		item = (kind == TEST_INDEX_STREAM) ? (void *) next_merged_index(rm) : (void *) next_merged_record(rm);
+		if (item == NULL)
+			break;
+		if (n_items < n_expected)
+			test_check(item == expected[n_items].item ? TRUE_m12 : FALSE_m12, "trial %d: merged item %ld is not stream %d's item %ld (time %ld)", \
+				   trial, (long) n_items, expected[n_items].stream, (long) expected[n_items].position, (long) expected[n_items].start_time);
+	}
+	test_check(n_items == n_expected ? TRUE_m12 : FALSE_m12, "trial %d: %ld items merged, expected %ld", trial, (long) n_items, (long) n_expected);
+
+	free_record_merge(rm);
+	for (s = 0; s < n_streams; ++s) {
+		free((void *) data[s]);
+		free((void *) indices[s]);
+	}
+	free((void *) data);
+	free((void *) indices);
+	free((void *) expected);
+
+	return;
+}
+
+
+si4	main(si4 argc, si1 **argv)
+{
+	si4	trial, kind;
+
+
+	srand(1);
+	for (trial = 0; trial < TEST_TRIALS; ++trial)
+		for (kind = TEST_DATA_STREAM; kind <= TEST_INDEX_STREAM; ++kind)
+			test_merge_trial(trial, 1 + (trial % TEST_MAX_STREAMS), kind);
+
+	return(test_finish("record_merge_test"));
+}
+
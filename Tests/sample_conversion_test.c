@@ -0,0 +1,233 @@
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Behaviour test: sample conversion kernels (sample_conversion.c)
+// The scalar kernels are checked against the documented rules (saturation to the MED infinities with clip counts, rounding half away from zero,
+// NaNs to the output type's MED NaN), & each vector instruction set the processor supports must match the scalar kernels exactly: outputs & clip counts,
+// at every length through two vector widths past the unrolled loops (loop tails), from unaligned addresses, & with outputs overlaying inputs.
+
+//************************************************************** Compile Line **************************************************************//
+//****  cc -O2 -I.. -o sample_conversion_test sample_conversion_test.c test_util.c ../sample_conversion.c ../medlib_m12.c ../dhnlib_m12.c -lm -lpthread  ****//
+//******************************************************************************************************************************************//
+//	usage: sample_conversion_test
+
+
+#include "sample_conversion.h"
+#include "test_util.h"
+
+// Miscellaneous
+#define TEST_MAX_SAMPS		((si8) 300)	// lengths 0 through TEST_MAX_SAMPS (AVX-512 loops take 64 samples per iteration)
+#define TEST_OFFSET		1		// unaligned start
+
+
+// fills in & sf8_in with values around the edges of the output ranges (si4_in: exact sf8 values of sf8_in where they are integers)
+void	fill_inputs(si4 *si4_in, sf8 *sf8_in, si8 n_samps)
+{
+	si8		i;
+	static sf8	edges[] = { 0.0, 0.5, -0.5, 1.5, -1.5, 2.5, -2.49999, 32766.5, 32767.0, 32767.5, -32766.5, -32767.0, -32767.5, -32768.0, 40000.0, -40000.0,
+				    2147483646.4, 2147483647.0, 2147483647.6, -2147483646.6, -2147483647.0, -2147483648.0, 1e12, -1e12, INFINITY, -INFINITY, NAN };
+	static si4	si4_edges[] = { 0, 1, -1, 32766, 32767, 32768, -32766, -32767, -32768, -32769, 2147483647, -2147483647, (si4) 0x80000000 };
+
+
+	for (i = 0; i < n_samps; ++i) {
+		if (i % 3 == 0) {  // edge values
+			sf8_in[i] = edges[(i / 3) % (sizeof(edges) / sizeof(sf8))];
+			si4_in[i] = si4_edges[(i / 3) % (sizeof(si4_edges) / sizeof(si4))];
+		} else {  // EEG-like values
+			si4_in[i] = (si4) ((i * 7919) % 60001) - 30000;
+			sf8_in[i] = (sf8) si4_in[i] + ((sf8) (i % 11) / (sf8) 10.0) - 0.5;
+		}
+	}
+
+	return;
+}
+
+
+// reference rules: returns the number of samples clipped
+si8	reference_sf8_to_si4(sf8 *in, si4 *out, si8 n_samps)
+{
+	si8	i, n_clipped;
+	sf8	r;
+
+
+	for (i = n_clipped = 0; i < n_samps; ++i) {
+		if (isnan(in[i])) {
+			out[i] = NAN_SI4_m12;
+		} else if (in[i] > (sf8) POS_INF_SI4_m12) {
+			out[i] = POS_INF_SI4_m12;
+			++n_clipped;
+		} else if (in[i] < (sf8) NEG_INF_SI4_m12) {
+			out[i] = NEG_INF_SI4_m12;
+			++n_clipped;
+		} else {
+			r = (in[i] < 0.0) ? -floor(-in[i] + 0.5) : floor(in[i] + 0.5);
+			out[i] = (si4) r;
+		}
+	}
+
+	return(n_clipped);
+}
+
+
+si8	reference_sf8_to_si2(sf8 *in, si2 *out, si8 n_samps)
+{
+	si8	i, n_clipped;
+	sf8	r;
+
+
+	for (i = n_clipped = 0; i < n_samps; ++i) {
+		if (isnan(in[i])) {
+			out[i] = NAN_SI2_m12;
+		} else if (in[i] > (sf8) POS_INF_SI2_m12) {
+			out[i] = POS_INF_SI2_m12;
+			++n_clipped;
+		} else if (in[i] < (sf8) NEG_INF_SI2_m12) {
+			out[i] = NEG_INF_SI2_m12;
+			++n_clipped;
+		} else {
+			r = (in[i] < 0.0) ? -floor(-in[i] + 0.5) : floor(in[i] + 0.5);
+			out[i] = (si2) r;
+		}
+	}
+
+	return(n_clipped);
+}
+
+
+si8	reference_si4_to_si2(si4 *in, si2 *out, si8 n_samps)
+{
+	si8	i, n_clipped;
+
+
+	for (i = n_clipped = 0; i < n_samps; ++i) {
+		if (in[i] > (si4) POS_INF_SI2_m12) {
+			out[i] = POS_INF_SI2_m12;
+			++n_clipped;
+		} else if (in[i] < (si4) NEG_INF_SI2_m12) {
+			out[i] = NEG_INF_SI2_m12;
+			++n_clipped;
+		} else {
+			out[i] = (si2) in[i];
+		}
+	}
+
+	return(n_clipped);
+}
+
+
+// scalar kernels against the reference rules
+void	test_scalar_rules(si4 *si4_in, sf8 *sf8_in)
+{
+	si2	si2_ref[TEST_MAX_SAMPS], si2_out[TEST_MAX_SAMPS];
+	si4	si4_ref[TEST_MAX_SAMPS], si4_out[TEST_MAX_SAMPS];
+	si8	n_ref, n_out;
+
+
+	n_ref = reference_sf8_to_si4(sf8_in, si4_ref, TEST_MAX_SAMPS);
+	n_out = sf8_to_si4_scalar(sf8_in, si4_out, TEST_MAX_SAMPS);
+	test_check(memcmp(si4_ref, si4_out, sizeof(si4_ref)) ? FALSE_m12 : TRUE_m12, "scalar sf8_to_si4: outputs differ from the rules");
+	test_check(n_ref == n_out ? TRUE_m12 : FALSE_m12, "scalar sf8_to_si4: %ld samples clipped, expected %ld", (long) n_out, (long) n_ref);
+	test_check(n_ref > 0 ? TRUE_m12 : FALSE_m12, "sf8_to_si4: inputs include no clipped samples");
+
+	n_ref = reference_sf8_to_si2(sf8_in, si2_ref, TEST_MAX_SAMPS);
+	n_out = sf8_to_si2_scalar(sf8_in, si2_out, TEST_MAX_SAMPS);
+	test_check(memcmp(si2_ref, si2_out, sizeof(si2_ref)) ? FALSE_m12 : TRUE_m12, "scalar sf8_to_si2: outputs differ from the rules");
+	test_check(n_ref == n_out ? TRUE_m12 : FALSE_m12, "scalar sf8_to_si2: %ld samples clipped, expected %ld", (long) n_out, (long) n_ref);
+
+	n_ref = reference_si4_to_si2(si4_in, si2_ref, TEST_MAX_SAMPS);
+	n_out = si4_to_si2_scalar(si4_in, si2_out, TEST_MAX_SAMPS);
+	test_check(memcmp(si2_ref, si2_out, sizeof(si2_ref)) ? FALSE_m12 : TRUE_m12, "scalar si4_to_si2: outputs differ from the rules");
+	test_check(n_ref == n_out ? TRUE_m12 : FALSE_m12, "scalar si4_to_si2: %ld samples clipped, expected %ld", (long) n_out, (long) n_ref);
+
+	return;
+}
+
+
+// selected kernels against the scalar kernels, at every length from an unaligned address
+void	test_dispatch(const si1 *set_name, si4 *si4_in, sf8 *sf8_in)
+{
+	si2	si2_ref[TEST_MAX_SAMPS + TEST_OFFSET], si2_out[TEST_MAX_SAMPS + TEST_OFFSET];
+	si4	si4_ref[TEST_MAX_SAMPS + TEST_OFFSET], si4_out[TEST_MAX_SAMPS + TEST_OFFSET];
+	sf4	sf4_ref[TEST_MAX_SAMPS + TEST_OFFSET], sf4_out[TEST_MAX_SAMPS + TEST_OFFSET];
+	si8	n, n_ref, n_out;
+	sf8	sf8_ref[TEST_MAX_SAMPS + TEST_OFFSET], sf8_out[TEST_MAX_SAMPS + TEST_OFFSET];
+
+
+	for (n = 0; n <= TEST_MAX_SAMPS - TEST_OFFSET; ++n) {
+		si4_to_sf8_scalar(si4_in + TEST_OFFSET, sf8_ref, n);
+		convert_si4_to_sf8(si4_in + TEST_OFFSET, sf8_out + TEST_OFFSET, n);
+		test_check(memcmp(sf8_ref, sf8_out + TEST_OFFSET, (size_t) n * sizeof(sf8)) ? FALSE_m12 : TRUE_m12, "%s si4_to_sf8: outputs differ at length %ld", set_name, (long) n);
+
+		si4_to_sf4_scalar(si4_in + TEST_OFFSET, sf4_ref, n);
+		convert_si4_to_sf4(si4_in + TEST_OFFSET, sf4_out + TEST_OFFSET, n);
+		test_check(memcmp(sf4_ref, sf4_out + TEST_OFFSET, (size_t) n * sizeof(sf4)) ? FALSE_m12 : TRUE_m12, "%s si4_to_sf4: outputs differ at length %ld", set_name, (long) n);
+
+		sf8_to_sf4_scalar(sf8_in + TEST_OFFSET, sf4_ref, n);
+		convert_sf8_to_sf4(sf8_in + TEST_OFFSET, sf4_out + TEST_OFFSET, n);
+		test_check(memcmp(sf4_ref, sf4_out + TEST_OFFSET, (size_t) n * sizeof(sf4)) ? FALSE_m12 : TRUE_m12, "%s sf8_to_sf4: outputs differ at length %ld", set_name, (long) n);
+
+		n_ref = si4_to_si2_scalar(si4_in + TEST_OFFSET, si2_ref, n);
+		n_out = convert_si4_to_si2(si4_in + TEST_OFFSET, si2_out + TEST_OFFSET, n);
+		test_check(memcmp(si2_ref, si2_out + TEST_OFFSET, (size_t) n * sizeof(si2)) ? FALSE_m12 : TRUE_m12, "%s si4_to_si2: outputs differ at length %ld", set_name, (long) n);
+		test_check(n_ref == n_out ? TRUE_m12 : FALSE_m12, "%s si4_to_si2: %ld samples clipped at length %ld, scalar %ld", set_name, (long) n_out, (long) n, (long) n_ref);
+
+		n_ref = sf8_to_si4_scalar(sf8_in + TEST_OFFSET, si4_ref, n);
+		n_out = convert_sf8_to_si4(sf8_in + TEST_OFFSET, si4_out + TEST_OFFSET, n);
+		test_check(memcmp(si4_ref, si4_out + TEST_OFFSET, (size_t) n * sizeof(si4)) ? FALSE_m12 : TRUE_m12, "%s sf8_to_si4: outputs differ at length %ld", set_name, (long) n);
+		test_check(n_ref == n_out ? TRUE_m12 : FALSE_m12, "%s sf8_to_si4: %ld samples clipped at length %ld, scalar %ld", set_name, (long) n_out, (long) n, (long) n_ref);
+
+		n_ref = sf8_to_si2_scalar(sf8_in + TEST_OFFSET, si2_ref, n);
+		n_out = convert_sf8_to_si2(sf8_in + TEST_OFFSET, si2_out + TEST_OFFSET, n);
+		test_check(memcmp(si2_ref, si2_out + TEST_OFFSET, (size_t) n * sizeof(si2)) ? FALSE_m12 : TRUE_m12, "%s sf8_to_si2: outputs differ at length %ld", set_name, (long) n);
+		test_check(n_ref == n_out ? TRUE_m12 : FALSE_m12, "%s sf8_to_si2: %ld samples clipped at length %ld, scalar %ld", set_name, (long) n_out, (long) n, (long) n_ref);
+	}
+
+	return;
+}
+
+
+// outputs overlaying inputs at the same base address (read_MED converts filtered samples in place)
+void	test_overlay(const si1 *set_name, sf8 *sf8_in)
+{
+	si2	si2_ref[TEST_MAX_SAMPS];
+	si4	si4_ref[TEST_MAX_SAMPS];
+	si8	n_ref, n_out;
+	sf8	buf[TEST_MAX_SAMPS];
+
+
+	n_ref = sf8_to_si4_scalar(sf8_in, si4_ref, TEST_MAX_SAMPS);
+	memcpy(buf, sf8_in, sizeof(buf));
+	n_out = convert_sf8_to_si4(buf, (si4 *) buf, TEST_MAX_SAMPS);
+	test_check((memcmp(si4_ref, buf, sizeof(si4_ref)) || n_ref != n_out) ? FALSE_m12 : TRUE_m12, "%s sf8_to_si4: overlaid output differs", set_name);
+
+	n_ref = sf8_to_si2_scalar(sf8_in, si2_ref, TEST_MAX_SAMPS);
+	memcpy(buf, sf8_in, sizeof(buf));
+	n_out = convert_sf8_to_si2(buf, (si2 *) buf, TEST_MAX_SAMPS);
+	test_check((memcmp(si2_ref, buf, sizeof(si2_ref)) || n_ref != n_out) ? FALSE_m12 : TRUE_m12, "%s sf8_to_si2: overlaid output differs", set_name);
+
+	return;
+}
+
+
+si4	main(si4 argc, si1 **argv)
+{
+	si1	*set_names[] = { "scalar", "SSE2", "AVX2", "AVX-512" };
+	si4	set, si4_in[TEST_MAX_SAMPS];
+	sf8	sf8_in[TEST_MAX_SAMPS];
+
+
+	fill_inputs(si4_in, sf8_in, TEST_MAX_SAMPS);
+	test_scalar_rules(si4_in, sf8_in);
+
+	for (set = CONVERSION_SCALAR; set <= CONVERSION_AVX512; ++set) {
+		initialize_conversion_kernels(set);
+		if (strcmp(conversion_instruction_set_string(), set_names[set])) {
+			printf("%s: not supported by this processor\n", set_names[set]);
+			continue;
+		}
+		test_dispatch(set_names[set], si4_in, sf8_in);
+		test_overlay(set_names[set], sf8_in);
+	}
+
+	return(test_finish("sample_conversion_test"));
+}
+
@@ -0,0 +1,200 @@
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Behaviour test: session manifest (session_manifest.c)
+// Writes a manifest for a session & checks that it loads, that its contigua match those built from the reference channel's time series indices, & that it
+// depends on every segment's time series indices of every channel (not only the last segment's). Then each dependency in turn has its modification time
+// changed (no file contents are changed): the manifest must then be stale (not loaded), & loads again once rewritten.
+// Test session: make_MED_session test_session --channels 4 --segments 3 --segment-seconds 60 --gaps 2 --notes 60
+
+//*************************************************************************** Compile Line ***************************************************************************//
+//****  cc -O2 -I.. -o session_manifest_test session_manifest_test.c test_util.c ../session_manifest.c ../record_journal.c ../medlib_m12.c ../medrec_m12.c ../dhnlib_m12.c -lm -lpthread  ****//
+//********************************************************************************************************************************************************************//
+//	usage: session_manifest_test session_directory [password]
+
+
+#include "session_manifest.h"
+#include "test_util.h"
+
+#if defined MACOS_m12 || defined LINUX_m12
+	#include <sys/stat.h>
+	#include <utime.h>
+#endif
+#ifdef WINDOWS_m12
+	#include <sys/stat.h>
+	#include <sys/utime.h>
+#endif
+
+// Miscellaneous
+#define TEST_TOUCH_SECONDS	10	// modification time change
+
+
+// moves file's (or directory's) modification time forward, returns FALSE_m12 if it cannot be changed
+TERN_m12	touch_dependency(si1 *sess_path, MANIFEST_DEPENDENCY *dep)
+{
+	si1		path[FULL_FILE_NAME_BYTES_m12];
+#if defined MACOS_m12 || defined LINUX_m12
+	struct stat	sb;
+	struct utimbuf	times;
+#endif
+#ifdef WINDOWS_m12
+	struct _stat64		sb;
+	struct __utimbuf64	times;
+#endif
+
+
+	if (*dep->path)
+		sprintf_m12(path, "%s/%s", sess_path, dep->path);
+	else
+		strcpy(path, sess_path);
+#if defined MACOS_m12 || defined LINUX_m12
+	if (stat(path, &sb) != 0)
+		return(FALSE_m12);
+	times.actime = sb.st_atime;
+	times.modtime = sb.st_mtime + TEST_TOUCH_SECONDS;
+	if (utime(path, &times) != 0)
+		return(FALSE_m12);
+#endif
+#ifdef WINDOWS_m12
+	if (_stat64(path, &sb) != 0)
+		return(FALSE_m12);
+	times.actime = sb.st_atime;
+	times.modtime = sb.st_mtime + TEST_TOUCH_SECONDS;
+	if (_utime64(path, &times) != 0)
+		return(FALSE_m12);
+#endif
+
+	return(TRUE_m12);
+}
+
+
+// returns TRUE_m12 if manifest depends on path
+TERN_m12	has_dependency(SESSION_MANIFEST *sm, si1 *path)
+{
+	si8	i;
+
+
+	for (i = 0; i < sm->header->number_of_dependencies; ++i)
+		if (strcmp(sm->dependencies[i].path, path) == 0)
+			return(TRUE_m12);
+
+	return(FALSE_m12);
+}
+
+
+// manifest contents: contigua as built from the indices, & every segment's time series indices (of every channel) as dependencies
+void	test_contents(SESSION_m12 *sess, SESSION_MANIFEST *sm)
+{
+	si1		path[MANIFEST_PATH_BYTES], number_str[FILE_NUMBERING_DIGITS_m12 + 1], *name;
+	si4		i, j, n_segs;
+	si8		k, n_contigs, n_index_contigs;
+	CONTIGUON_m12	*contigua, *index_contigs;
+
+
+	n_segs = sm->header->number_of_segments;
+	test_check(n_segs == globals_m12->number_of_session_segments ? TRUE_m12 : FALSE_m12, "manifest has %d segments, session %d", n_segs, globals_m12->number_of_session_segments);
+	if (n_segs < 2)
+		printf("session has %d segment: earlier segments are not tested\n", n_segs);
+	test_check(sm->header->number_of_channels == sess->number_of_time_series_channels ? TRUE_m12 : FALSE_m12, "manifest has %d channels, session %d", \
+		   sm->header->number_of_channels, sess->number_of_time_series_channels);
+
+	// contigua
+	contigua = index_contigs = NULL;
+	n_contigs = manifest_contigua(sm, &contigua);
+	n_index_contigs = (read_segment_indices(globals_m12->reference_channel) == TRUE_m12) ? index_contigua(sess, &index_contigs) : 0;
+	if (test_check((n_contigs > 0 && n_contigs == n_index_contigs) ? TRUE_m12 : FALSE_m12, "manifest has %ld contigua, indices %ld", (long) n_contigs, (long) n_index_contigs) == TRUE_m12) {
+		for (k = 0; k < n_contigs; ++k)
+			test_check((contigua[k].start_time == index_contigs[k].start_time && contigua[k].end_time == index_contigs[k].end_time && \
+				    contigua[k].start_sample_number == index_contigs[k].start_sample_number && contigua[k].end_sample_number == index_contigs[k].end_sample_number) ? TRUE_m12 : FALSE_m12, \
+				   "contiguon %ld differs from the indices' contiguon", (long) k);
+	}
+	if (contigua != NULL)
+		free_m12((void *) contigua, __FUNCTION__);
+	if (index_contigs != NULL)
+		free_m12((void *) index_contigs, __FUNCTION__);
+
+	// every segment's time series indices
+	for (i = 0; i < sm->header->number_of_channels; ++i) {
+		name = sm->channels[i].name;
+		for (j = 1; j <= n_segs; ++j) {
+			G_numerical_fixed_width_string_m12(number_str, FILE_NUMBERING_DIGITS_m12, j);
+			snprintf(path, MANIFEST_PATH_BYTES, "%s.%s/%s_s%s.%s/%s_s%s.%s", name, TIME_SERIES_CHANNEL_DIRECTORY_TYPE_STRING_m12, name, number_str, \
+				 TIME_SERIES_SEGMENT_DIRECTORY_TYPE_STRING_m12, name, number_str, TIME_SERIES_INDICES_FILE_TYPE_STRING_m12);
+			test_check(has_dependency(sm, path), "manifest does not depend on \"%s\"", path);
+		}
+	}
+
+	return;
+}
+
+
+// each dependency changed in turn: manifest must be stale, & load again when rewritten
+void	test_staleness(SESSION_m12 *sess, si8 n_deps)
+{
+	si8			i;
+	TERN_m12		touched;
+	SESSION_MANIFEST	*sm;
+	MANIFEST_DEPENDENCY	dep;
+
+
+	for (i = 0; i < n_deps; ++i) {
+		sm = load_session_manifest(sess->path);
+		if (test_check(sm != NULL ? TRUE_m12 : FALSE_m12, "rewritten manifest not loaded (dependency %ld)", (long) i) == FALSE_m12)
+			return;
+		dep = sm->dependencies[i];
+		free_session_manifest(sm);
+		if (dep.size == MANIFEST_NO_FILE)  // absent (e.g. a segment without a journal)
+			continue;
+		touched = touch_dependency(sess->path, &dep);
+		if (test_check(touched, "cannot change modification time of \"%s\"", dep.path) == FALSE_m12)
+			continue;
+
+		sm = load_session_manifest(sess->path);
+		test_check(sm == NULL ? TRUE_m12 : FALSE_m12, "manifest loaded after \"%s\" changed", (*dep.path) ? dep.path : "<session directory>");
+		free_session_manifest(sm);
+		test_check(write_session_manifest(sess), "manifest not rewritten after \"%s\" changed", dep.path);
+	}
+
+	return;
+}
+
+
+si4	main(si4 argc, si1 **argv)
+{
+	si1			*password;
+	si8			n_deps;
+	SESSION_m12		*sess;
+	SESSION_MANIFEST	*sm;
+	TIME_SLICE_m12		slice;
+
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s session_directory [password]\n", argv[0]);
+		return(1);
+	}
+	password = (argc > 2) ? argv[2] : NULL;
+
+	G_initialize_medlib_m12(FALSE_m12, FALSE_m12);
+	G_initialize_time_slice_m12(&slice);
+	sess = G_open_session_m12(NULL, &slice, (void *) argv[1], 0, (LH_READ_SEGMENT_METADATA_m12 | LH_MAP_ALL_SEGMENTS_m12), password);
+	if (sess == NULL) {
+		fprintf(stderr, "cannot open %s\n", argv[1]);
+		return(1);
+	}
+
+	if (test_check(write_session_manifest(sess), "manifest not written") == FALSE_m12)
+		return(test_finish("session_manifest_test"));
+	sm = load_session_manifest(sess->path);
+	if (test_check(sm != NULL ? TRUE_m12 : FALSE_m12, "new manifest not loaded") == FALSE_m12)
+		return(test_finish("session_manifest_test"));
+	test_contents(sess, sm);
+	n_deps = sm->header->number_of_dependencies;
+	free_session_manifest(sm);
+	printf("%ld dependencies\n", (long) n_deps);
+	test_staleness(sess, n_deps);
+
+	G_free_session_m12(sess, TRUE_m12);
+	G_free_globals_m12(TRUE_m12);
+
+	return(test_finish("session_manifest_test"));
+}
+
@@ -0,0 +1,127 @@
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Shared code for the behaviour tests: failure counting & reporting, & scratch directories
+// Each test program checks one module & exits with the number of failed checks (0: passed), so the tests can be run from a script or CI.
+
+
+#include "test_util.h"
+#if defined MACOS_m12 || defined LINUX_m12
+	#include <sys/stat.h>
+	#include <unistd.h>
+	#include <dirent.h>
+#endif
+#ifdef WINDOWS_m12
+	#include <windows.h>
+#endif
+
+// Globals
+static si4	test_failures = 0;
+static si4	test_checks = 0;
+
+
+// counts a check, & reports it if it failed (fmt & following arguments describe the check), returns passed
+TERN_m12	test_check(TERN_m12 passed, const si1 *fmt, ...)
+{
+	va_list	args;
+
+
+	++test_checks;
+	if (passed == TRUE_m12)
+		return(TRUE_m12);
+
+	if (++test_failures <= TEST_MAX_REPORTED_FAILURES) {
+		fprintf(stderr, "FAILED: ");
+		va_start(args, fmt);
+		vfprintf(stderr, fmt, args);
+		va_end(args);
+		fprintf(stderr, "\n");
+	}
+
+	return(FALSE_m12);
+}
+
+
+// prints the test's result, returns the exit status (number of failed checks, at most 255)
+si4	test_finish(const si1 *test_name)
+{
+	if (test_failures == 0)
+		printf("%s: passed (%d checks)\n", test_name, test_checks);
+	else
+		printf("%s: FAILED (%d of %d checks)\n", test_name, test_failures, test_checks);
+
+	return((test_failures > 255) ? 255 : test_failures);
+}
+
+
+// creates an empty directory for the test's files in the system temporary directory (removed first if it exists), returns FALSE_m12 on failure
+TERN_m12	test_scratch_directory(const si1 *test_name, si1 *path)
+{
+	si1	*tmp_dir;
+
+
+	tmp_dir = getenv("TMPDIR");
+#ifdef WINDOWS_m12
+	if (tmp_dir == NULL)
+		tmp_dir = getenv("TEMP");
+#endif
+	if (tmp_dir == NULL)
+		tmp_dir = "/tmp";
+	sprintf(path, "%s/%s_%d", tmp_dir, test_name, (si4) getpid());
+	test_remove_directory(path);
+
+#if defined MACOS_m12 || defined LINUX_m12
+	if (mkdir(path, 0777))
+		return(FALSE_m12);
+#endif
+#ifdef WINDOWS_m12
+	if (CreateDirectoryA(path, NULL) == 0)
+		return(FALSE_m12);
+#endif
+
+	return(TRUE_m12);
+}
+
+
+// removes directory & its files (scratch directories hold no subdirectories)
+void	test_remove_directory(si1 *path)
+{
+	si1		file[FULL_FILE_NAME_BYTES_m12];
+#if defined MACOS_m12 || defined LINUX_m12
+	DIR		*dir;
+	struct dirent	*ent;
+
+
+	dir = opendir(path);
+	if (dir == NULL)
+		return;
+	while ((ent = readdir(dir)) != NULL) {
+		if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0)
+			continue;
+		sprintf(file, "%s/%s", path, ent->d_name);
+		remove(file);
+	}
+	closedir(dir);
+	rmdir(path);
+#endif
+#ifdef WINDOWS_m12
+	HANDLE			find;
+	WIN32_FIND_DATAA	fd;
+
+
+	sprintf(file, "%s/*", path);
+	find = FindFirstFileA(file, &fd);
+	if (find != INVALID_HANDLE_VALUE) {
+		do {
+			if (strcmp(fd.cFileName, ".") && strcmp(fd.cFileName, "..")) {
+				sprintf(file, "%s/%s", path, fd.cFileName);
+				DeleteFileA(file);
+			}
+		} while (FindNextFileA(find, &fd));
+		FindClose(find);
+	}
+	RemoveDirectoryA(path);
+#endif
+
+	return;
+}
+
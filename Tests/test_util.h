@@ -0,0 +1,22 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+#ifndef TEST_UTIL_IN
+#define TEST_UTIL_IN
+
+// Includes
+#include "medlib_m12.h"
+#include <stdarg.h>
+
+// Miscellaneous
+#define TEST_MAX_REPORTED_FAILURES	20	// per test program (later failures are counted only)
+
+
+// Prototypes
+TERN_m12	test_check(TERN_m12 passed, const si1 *fmt, ...);
+si4		test_finish(const si1 *test_name);
+TERN_m12	test_scratch_directory(const si1 *test_name, si1 *path);
+void		test_remove_directory(si1 *path);
+
+
+#endif /* TEST_UTIL_IN */
@@ -5,6 +5,9 @@
 #ifndef ADD_RECORD_EXEC_IN
 #define ADD_RECORD_EXEC_IN
 
+// Includes
+#include "record_args.h"
+
 
 // Defines
 
@@ -14,9 +17,8 @@
 
 
 // Prototypes
-void	mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[]);
-si8	get_si8_scalar(const mxArray *mx_arr);
-sf8	add_record(si1 *chan_dir, si1 *password, si1 *rec_type, si8 rec_time, si1 *rec_text, si1 enc_level);
+void		mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[]);
+sf8		add_records(si1 *chan_dir, si1 *password, NEW_RECORD *recs, si8 n_recs);
 
 
 #endif /* ADD_RECORD_EXEC_IN */
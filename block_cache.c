@@ -0,0 +1,287 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Decoded block cache
+// Decoded CMP blocks are keyed by (channel UID, segment number, block number), so overlapping reads (e.g. zooming out & back in) decode each block once,
+// even after the session was closed & reopened. Blocks are freed least recently used first when the cache exceeds its byte budget.
+// Entries keep their block's encryption level, & a lookup is only a hit if the caller's password access level covers it: samples decrypted with one
+// password are never returned to a caller with a lesser (or no) password.
+// Only read_MED's decoder uses the cache: matrix_MED builds pages inside medlib's DM_get_matrix_m12(), which decodes blocks itself.
+// Decode workers look blocks up concurrently: a found block is pinned while its samples are copied out, so eviction never frees a block being read.
+// NOTE: the cache lives as long as the mex function that links it (each mex file has its own cache).
+
+
+#include "block_cache.h"
+
+// Globals
+static TERN_m12			block_cache_initialized = FALSE_m12;
+static pthread_mutex_t_m12	block_cache_mutex;
+static BLOCK_CACHE_ENTRY	**block_cache_buckets = NULL;
+static BLOCK_CACHE_ENTRY	*lru_head = NULL, *lru_tail = NULL;  // head is most recently used
+static BLOCK_CACHE_STATS	block_cache_stats;
+
+
+// call once, from the calling thread, before any lookups
+void	initialize_block_cache(si8 budget)
+{
+	if (block_cache_initialized == TRUE_m12)
+		return;
+
+	pthread_mutex_init_m12(&block_cache_mutex, NULL);
+	memset((void *) &block_cache_stats, 0, sizeof(BLOCK_CACHE_STATS));
+	block_cache_stats.budget = budget;
+	block_cache_initialized = TRUE_m12;
+
+	return;
+}
+
+
+// frees least recently used blocks down to the new budget (0 disables the cache & frees all unpinned blocks)
+void	set_block_cache_budget(si8 budget)
+{
+	if (budget < 0)
+		budget = 0;
+
+	pthread_mutex_lock_m12(&block_cache_mutex);
+	block_cache_stats.budget = budget;
+	trim_block_cache(budget);
+	pthread_mutex_unlock_m12(&block_cache_mutex);
+
+	return;
+}
+
+
+// returns pinned block (caller must release it), or NULL on a miss (blocks encrypted above access_level are misses)
+BLOCK_CACHE_ENTRY	*get_cached_block(ui8 chan_UID, si4 seg_num, si8 block_num, ui1 access_level)
+{
+	BLOCK_CACHE_ENTRY	*entry;
+
+
+	if (block_cache_stats.budget == 0)
+		return(NULL);
+
+	pthread_mutex_lock_m12(&block_cache_mutex);
+	entry = find_cached_block(chan_UID, seg_num, block_num);
+	if (entry != NULL && entry->enc_level > (si1) access_level)
+		entry = NULL;
+	if (entry == NULL) {
+		++block_cache_stats.misses;
+	} else {
+		++block_cache_stats.hits;
+		++entry->pins;
+		// move to front of LRU list
+		if (entry != lru_head) {
+			entry->lru_prev->lru_next = entry->lru_next;
+			if (entry->lru_next == NULL)
+				lru_tail = entry->lru_prev;
+			else
+				entry->lru_next->lru_prev = entry->lru_prev;
+			entry->lru_prev = NULL;
+			entry->lru_next = lru_head;
+			lru_head->lru_prev = entry;
+			lru_head = entry;
+		}
+	}
+	pthread_mutex_unlock_m12(&block_cache_mutex);
+
+	return(entry);
+}
+
+
+// lookup for planning reads: does not pin the block or change its LRU position, & counts a miss if not cached (the block will be decoded)
+TERN_m12	block_is_cached(ui8 chan_UID, si4 seg_num, si8 block_num, ui1 access_level)
+{
+	BLOCK_CACHE_ENTRY	*entry;
+
+
+	if (block_cache_stats.budget == 0)
+		return(FALSE_m12);
+
+	pthread_mutex_lock_m12(&block_cache_mutex);
+	entry = find_cached_block(chan_UID, seg_num, block_num);
+	if (entry != NULL && entry->enc_level > (si1) access_level)
+		entry = NULL;
+	if (entry == NULL)
+		++block_cache_stats.misses;
+	pthread_mutex_unlock_m12(&block_cache_mutex);
+
+	if (entry == NULL)
+		return(FALSE_m12);
+
+	return(TRUE_m12);
+}
+
+
+void	release_cached_block(BLOCK_CACHE_ENTRY *entry)
+{
+	pthread_mutex_lock_m12(&block_cache_mutex);
+	--entry->pins;
+	pthread_mutex_unlock_m12(&block_cache_mutex);
+
+	return;
+}
+
+
+// allocates cache-owned storage for a block about to be decoded (entry->samps), or returns NULL if the cache is disabled or the block would not fit
+// enc_level is the block's encryption level as stored (NO_ENCRYPTION_m12 for unencrypted blocks); pass the entry to insert_cached_block() once decoded
+BLOCK_CACHE_ENTRY	*new_cached_block(ui8 chan_UID, si4 seg_num, si8 block_num, si1 enc_level, si8 n_samps)
+{
+	si8			entry_bytes;
+	BLOCK_CACHE_ENTRY	*entry;
+
+
+	entry_bytes = (si8) sizeof(BLOCK_CACHE_ENTRY) + (n_samps * (si8) sizeof(si4));
+	if (entry_bytes > block_cache_stats.budget)
+		return(NULL);
+
+	entry = (BLOCK_CACHE_ENTRY *) malloc((size_t) entry_bytes);
+	if (entry == NULL)
+		return(NULL);
+	entry->chan_UID = chan_UID;
+	entry->seg_num = seg_num;
+	entry->block_num = block_num;
+	entry->enc_level = enc_level;
+	entry->n_samps = n_samps;
+	entry->samps = (si4 *) (entry + 1);
+	entry->pins = 0;
+
+	return(entry);
+}
+
+
+// adds a decoded block from new_cached_block() to the cache (the entry is freed if another worker cached the block meanwhile: the first one in is kept),
+// & frees least recently used blocks to stay within budget
+void	insert_cached_block(BLOCK_CACHE_ENTRY *entry)
+{
+	si8			entry_bytes;
+	BLOCK_CACHE_ENTRY	**bucket;
+
+
+	entry_bytes = (si8) sizeof(BLOCK_CACHE_ENTRY) + (entry->n_samps * (si8) sizeof(si4));
+
+	pthread_mutex_lock_m12(&block_cache_mutex);
+	if (block_cache_buckets == NULL)
+		block_cache_buckets = (BLOCK_CACHE_ENTRY **) calloc((size_t) BLOCK_CACHE_HASH_BUCKETS, sizeof(BLOCK_CACHE_ENTRY *));
+	if (find_cached_block(entry->chan_UID, entry->seg_num, entry->block_num) != NULL) {
+		pthread_mutex_unlock_m12(&block_cache_mutex);
+		free((void *) entry);
+		return;
+	}
+	trim_block_cache(block_cache_stats.budget - entry_bytes);
+	bucket = block_cache_bucket(entry->chan_UID, entry->seg_num, entry->block_num);
+	entry->hash_next = *bucket;
+	*bucket = entry;
+	entry->lru_prev = NULL;
+	entry->lru_next = lru_head;
+	if (lru_head == NULL)
+		lru_tail = entry;
+	else
+		lru_head->lru_prev = entry;
+	lru_head = entry;
+	++block_cache_stats.n_blocks;
+	block_cache_stats.bytes += entry_bytes;
+	pthread_mutex_unlock_m12(&block_cache_mutex);
+
+	return;
+}
+
+
+void	get_block_cache_stats(BLOCK_CACHE_STATS *stats)
+{
+	pthread_mutex_lock_m12(&block_cache_mutex);
+	*stats = block_cache_stats;
+	pthread_mutex_unlock_m12(&block_cache_mutex);
+
+	return;
+}
+
+
+// frees all blocks (call when no decoding is in progress)
+void	free_block_cache(void)
+{
+	BLOCK_CACHE_ENTRY	*entry, *next;
+
+
+	if (block_cache_initialized == FALSE_m12)
+		return;
+
+	for (entry = lru_head; entry != NULL; entry = next) {
+		next = entry->lru_next;
+		free((void *) entry);
+	}
+	if (block_cache_buckets != NULL)
+		free((void *) block_cache_buckets);
+	block_cache_buckets = NULL;
+	lru_head = lru_tail = NULL;
+	block_cache_stats.n_blocks = block_cache_stats.bytes = 0;
+	pthread_mutex_destroy_m12(&block_cache_mutex);
+	block_cache_initialized = FALSE_m12;
+
+	return;
+}
+
+
+BLOCK_CACHE_ENTRY	**block_cache_bucket(ui8 chan_UID, si4 seg_num, si8 block_num)
+{
+	ui8	hash;
+
+
+	hash = chan_UID ^ ((ui8) seg_num * (ui8) 0x9E3779B97F4A7C15) ^ ((ui8) block_num * (ui8) 0xC2B2AE3D27D4EB4F);
+	hash ^= hash >> 29;
+
+	return(block_cache_buckets + (hash & (ui8) (BLOCK_CACHE_HASH_BUCKETS - 1)));
+}
+
+
+// call with mutex locked
+BLOCK_CACHE_ENTRY	*find_cached_block(ui8 chan_UID, si4 seg_num, si8 block_num)
+{
+	BLOCK_CACHE_ENTRY	*entry;
+
+
+	if (block_cache_buckets == NULL)
+		return(NULL);
+
+	for (entry = *block_cache_bucket(chan_UID, seg_num, block_num); entry != NULL; entry = entry->hash_next)
+		if (entry->block_num == block_num && entry->seg_num == seg_num && entry->chan_UID == chan_UID)
+			return(entry);
+
+	return(NULL);
+}
+
+
+// frees least recently used unpinned blocks until the cache holds no more than budget bytes (call with mutex locked)
+void	trim_block_cache(si8 budget)
+{
+	BLOCK_CACHE_ENTRY	*entry, *prev, **link;
+
+
+	for (entry = lru_tail; entry != NULL && block_cache_stats.bytes > budget; entry = prev) {
+		prev = entry->lru_prev;
+		if (entry->pins)
+			continue;
+
+		// unlink from hash chain
+		link = block_cache_bucket(entry->chan_UID, entry->seg_num, entry->block_num);
+		while (*link != entry)
+			link = &(*link)->hash_next;
+		*link = entry->hash_next;
+
+		// unlink from LRU list
+		if (prev == NULL)
+			lru_head = entry->lru_next;
+		else
+			prev->lru_next = entry->lru_next;
+		if (entry->lru_next == NULL)
+			lru_tail = prev;
+		else
+			entry->lru_next->lru_prev = prev;
+
+		--block_cache_stats.n_blocks;
+		block_cache_stats.bytes -= (si8) sizeof(BLOCK_CACHE_ENTRY) + (entry->n_samps * (si8) sizeof(si4));
+		++block_cache_stats.evictions;
+		free((void *) entry);
+	}
+
+	return;
+}
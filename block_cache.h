@@ -0,0 +1,47 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+#ifndef BLOCK_CACHE_IN
+#define BLOCK_CACHE_IN
+
+// Includes
+#include "medlib_m12.h"
+
+// Miscellaneous
+#define BLOCK_CACHE_DEFAULT_BYTES	((si8) 256 << 20)	// least recently used blocks beyond this are freed (0 disables the cache)
+#define BLOCK_CACHE_HASH_BUCKETS	((si8) 1 << 16)		// power of 2
+
+// Block Cache Structures
+typedef struct BLOCK_CACHE_ENTRY {
+	ui8				chan_UID;
+	si4				seg_num;
+	si8				block_num;
+	si1				enc_level;  // block's encryption level (decoded samples are only returned to callers with access to it)
+	si8				n_samps;
+	si4				*samps;  // decoded (follows entry in same allocation)
+	si4				pins;  // readers copying samples (pinned blocks are not evicted)
+	struct BLOCK_CACHE_ENTRY	*hash_next, *lru_prev, *lru_next;  // lru_prev is more recently used
+} BLOCK_CACHE_ENTRY;
+
+typedef struct {
+	si8				hits, misses, evictions;  // since mex function loaded
+	si8				n_blocks, bytes, budget;
+} BLOCK_CACHE_STATS;
+
+
+// Prototypes
+void			initialize_block_cache(si8 budget);
+void			set_block_cache_budget(si8 budget);
+BLOCK_CACHE_ENTRY	*get_cached_block(ui8 chan_UID, si4 seg_num, si8 block_num, ui1 access_level);
+TERN_m12		block_is_cached(ui8 chan_UID, si4 seg_num, si8 block_num, ui1 access_level);
+void			release_cached_block(BLOCK_CACHE_ENTRY *entry);
+BLOCK_CACHE_ENTRY	*new_cached_block(ui8 chan_UID, si4 seg_num, si8 block_num, si1 enc_level, si8 n_samps);
+void			insert_cached_block(BLOCK_CACHE_ENTRY *entry);
+void			get_block_cache_stats(BLOCK_CACHE_STATS *stats);
+void			free_block_cache(void);
+BLOCK_CACHE_ENTRY	**block_cache_bucket(ui8 chan_UID, si4 seg_num, si8 block_num);
+BLOCK_CACHE_ENTRY	*find_cached_block(ui8 chan_UID, si4 seg_num, si8 block_num);
+void			trim_block_cache(si8 budget);
+
+
+#endif /* BLOCK_CACHE_IN */
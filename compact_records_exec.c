@@ -0,0 +1,118 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+
+//****************************************************** Mex Compile Line *******************************************************//
+//****  mex COMPFLAGS='$COMPFLAGS -Wall -O3' compact_records_exec.c record_journal.c medlib_m12.c medrec_m12.c dhnlib_m12.c  ****//
+//*******************************************************************************************************************************//
+
+
+// success = compact_records_exec(chan_dir, password)
+// folds the record journals of every segment of the session (journaled add_record_exec() & delete_record_exec() edits) into the segments' record files,
+// & removes the journals. Returns 0 on success (including sessions without journals), or -1 on failure.
+
+
+#include "compact_records_exec.h"
+
+
+// Mex gateway routine
+void    mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[])
+{
+	si1	chan_dir[FULL_FILE_NAME_BYTES_m12], password[PASSWORD_BYTES_m12];
+	si8	len;
+	sf8	success;
+
+
+	PROC_increase_process_priority_m12(FALSE_m12, FALSE_m12);
+
+	//  check for proper number of output arguments
+	if (nlhs != 1) {
+		mexPrintf("One output required: success (0), or unspecified failure (-1)\n");
+		return;
+	}
+
+	// set unspecified fail return value for subsequent errors
+	plhs[0] = mxCreateDoubleMatrix(1, 1, mxREAL);
+	*((sf8 *) mxGetPr(plhs[0])) = -1.0;
+
+	//  check for proper number of input arguments
+	if (nrhs != 2) {
+		mexPrintf("Two inputs required: chan_dir, password\n");
+		return;
+	}
+
+	// session directory
+	if (mxIsEmpty(prhs[0]) == 1) {
+		mexPrintf("No channel directory (input 1) specified\n");
+		return;
+	}
+	if (mxGetClassID(prhs[0]) != mxCHAR_CLASS) {
+		mexPrintf("Channel directory (input 1) must be a string\n");
+		return;
+	}
+	mxGetString(prhs[0], chan_dir, FULL_FILE_NAME_BYTES_m12);
+
+	// password
+	*password = 0;
+	if (mxIsEmpty(prhs[1]) == 0) {
+		if (mxGetClassID(prhs[1]) == mxCHAR_CLASS) {
+			len = mxGetNumberOfElements(prhs[1]) + 1; // Get the length of the input string
+			if (len > (PASSWORD_BYTES_m12 + 1)) {  // allow full 16 bytes for password
+				mexPrintf("Password (input 2) is too long\n");
+				return;
+			} else {
+				mxGetString(prhs[1], password, len);
+			}
+		} else {
+			mexPrintf("Password (input 2) must be a string\n");
+			return;
+		}
+	}
+
+	// initialize MED library
+	G_initialize_medlib_m12(FALSE_m12, FALSE_m12);
+
+	// return codes: 0.0 == ok, -1.0 == unspecified error
+	success = compact_records(chan_dir, password);
+	*((sf8 *) mxGetPr(plhs[0])) = success;
+
+	// clean up
+	G_free_globals_m12(TRUE_m12);
+
+	return;
+}
+
+
+sf8	compact_records(si1 *chan_dir, si1 *password)
+{
+	ui8		flags;
+	si4		n_compacted;
+	SESSION_m12	*sess;
+	TIME_SLICE_m12	slice;
+
+
+	// read session (segment metadata for every segment: compaction uses it as the record files' prototype)
+	G_initialize_time_slice_m12(&slice);
+	slice.start_time = BEGINNING_OF_TIME_m12;
+	slice.end_time = END_OF_TIME_m12;
+	flags = LH_READ_SEGMENT_METADATA_m12;
+	sess = G_open_session_m12(NULL, &slice, chan_dir, 0, flags, password);
+	if (sess == NULL) {
+		if (globals_m12->password_data.processed == 0) {
+			G_warning_message_m12("%s(): cannot read session => no matching input files\n", __FUNCTION__);
+		} else {
+			if (*globals_m12->password_data.level_1_password_hint || *globals_m12->password_data.level_2_password_hint)
+				G_warning_message_m12("%s(): cannot read session => check that the password is correct\n", __FUNCTION__);
+			else
+				G_warning_message_m12("%s(): cannot read session => check that the password is correct, and that metadata files exist\n", __FUNCTION__);
+		}
+		return(-1.0);
+	}
+
+	n_compacted = compact_session_journals(sess);
+	G_free_session_m12(sess, TRUE_m12);
+	if (n_compacted < 0)
+		return(-1.0);
+
+	return(0.0);
+}
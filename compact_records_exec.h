@@ -0,0 +1,17 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+#ifndef COMPACT_RECORDS_EXEC_IN
+#define COMPACT_RECORDS_EXEC_IN
+
+// Includes
+#include "medlib_m12.h"
+#include "record_journal.h"
+
+
+// Prototypes
+void	mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[]);
+sf8	compact_records(si1 *chan_dir, si1 *password);
+
+
+#endif /* COMPACT_RECORDS_EXEC_IN */
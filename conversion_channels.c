@@ -0,0 +1,309 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Conversion channels
+// MED_sample_for_time() & MED_time_for_sample() resolve their queries against channels' time series indices. Opening the channels (directory
+// resolution, metadata, & indices) dominates repeated small conversions, so channels can be left open between calls in the session registry,
+// keyed by MED_directory (as passed) & password, with their block maps. Later calls with the same key skip the open entirely.
+// A single channel or session directory opens one channel (a session's first channel). A channel list (cell array, or regex) opens every matching
+// channel as one session, so mixed rate channels are converted in one call: medlib opens the channels, & their indices are read & mapped in parallel.
+// Each set has its own medlib globals in the registry (session start time & recording time offset), so calls can alternate between sets.
+
+
+#include "conversion_channels.h"
+
+
+// call once, when the gateway is loaded
+void	initialize_conversion_channels(void)
+{
+	G_initialize_medlib_m12(FALSE_m12, FALSE_m12);
+	initialize_registry(free_conversion_entry);
+
+	return;
+}
+
+
+// returns current entry for MED_paths & password (opened if not already open), or NULL if they cannot be opened
+// MED_paths: single string (n_files == 0), or array of n_files strings (as medlib file lists)
+// opened: set to TRUE_m12 if the channels were opened by this call
+REGISTRY_ENTRY	*get_conversion_channels(void *MED_paths, si4 n_files, si1 *password, TERN_m12 *opened)
+{
+	si1			*key;
+	CONVERSION_CHANNELS	key_cc;
+	REGISTRY_ENTRY		*entry;
+
+
+	key = conversion_key(MED_paths, n_files);
+	key_cc.MED_directory = key;
+	strcpy(key_cc.password, password);
+	entry = find_registry_entry(match_conversion_key, (void *) &key_cc);
+	if (entry != NULL) {
+		free((void *) key);
+		*opened = FALSE_m12;
+		return(entry);
+	}
+
+	*opened = TRUE_m12;
+	entry = open_conversion_channels(MED_paths, n_files, key, password);
+	if (entry == NULL)
+		free((void *) key);
+
+	return(entry);
+}
+
+
+// opens channels (segment metadata & time series indices only, no sample data), builds their block maps, & registers them (key is kept)
+REGISTRY_ENTRY	*open_conversion_channels(void *MED_paths, si4 n_files, si1 *key, si1 *password)
+{
+	si1			chan_path[FULL_FILE_NAME_BYTES_m12];
+	si4			i, n_chans;
+	ui8			flags;
+	void			*file_list;
+	SESSION_m12		*sess;
+	TIME_SLICE_m12		slice;
+	CONVERSION_CHANNELS	*cc;
+	CONVERSION_MAP_TASK	*map_tasks;
+	WQ_TASK			*tasks;
+
+
+	// single channel or session directory: one channel (channel lists & regex are expanded by medlib)
+	file_list = MED_paths;
+	if (n_files == 0 && strpbrk((si1 *) MED_paths, CONVERSION_REGEX_CHARS) == NULL) {
+		if (resolve_conversion_channel((si1 *) MED_paths, chan_path) == FALSE_m12)
+			return(NULL);
+		file_list = (void *) chan_path;
+	}
+
+	// open channels as one session (its globals are kept by the registry)
+	suspend_current_session();
+	G_initialize_time_slice_m12(&slice);
+	slice.start_time = BEGINNING_OF_TIME_m12;
+	slice.end_time = END_OF_TIME_m12;
+	flags = (LH_READ_SEGMENT_METADATA_m12 | LH_MAP_ALL_SEGMENTS_m12);
+	sess = G_open_session_m12(NULL, &slice, file_list, n_files, flags, password);
+	if (sess == NULL) {
+		if (globals_m12->password_data.processed == 0) {
+			G_warning_message_m12("%s(): cannot open channels => no matching input files\n", __FUNCTION__);
+		} else {
+			if (*globals_m12->password_data.level_1_password_hint || *globals_m12->password_data.level_2_password_hint)
+				G_warning_message_m12("%s(): cannot open channels => check that the password is correct\n", __FUNCTION__);
+			else
+				G_warning_message_m12("%s(): cannot open channels => check that the password is correct, and that metadata files exist\n", __FUNCTION__);
+		}
+		return(NULL);
+	}
+	n_chans = sess->number_of_time_series_channels;
+	if (n_chans == 0) {
+		G_warning_message_m12("%s(): no time series channels\n", __FUNCTION__);
+		G_free_session_m12(sess, TRUE_m12);
+		return(NULL);
+	}
+
+	// read indices & build block maps (one task per channel: medlib reads channels concurrently itself)
+	map_tasks = (CONVERSION_MAP_TASK *) calloc((size_t) n_chans, sizeof(CONVERSION_MAP_TASK));
+	tasks = (WQ_TASK *) malloc((size_t) n_chans * sizeof(WQ_TASK));
+	for (i = 0; i < n_chans; ++i) {
+		map_tasks[i].chan = sess->time_series_channels[i];
+		tasks[i].task_f = map_conversion_channel;
+		tasks[i].arg = (void *) (map_tasks + i);
+	}
+	run_work_queue(tasks, (si8) n_chans, work_queue_workers((si8) n_chans));
+	free((void *) tasks);
+	for (i = 0; i < n_chans; ++i) {
+		if (map_tasks[i].indices_read == FALSE_m12) {
+			G_warning_message_m12("%s(): cannot read time series indices of channel \"%s\"\n", __FUNCTION__, map_tasks[i].chan->name);
+			for (i = 0; i < n_chans; ++i)
+				free_sweep_map(map_tasks[i].map);
+			free((void *) map_tasks);
+			G_free_session_m12(sess, TRUE_m12);
+			return(NULL);
+		}
+	}
+
+	cc = (CONVERSION_CHANNELS *) calloc((size_t) 1, sizeof(CONVERSION_CHANNELS));
+	cc->MED_directory = key;
+	strcpy(cc->password, password);
+	cc->n_chans = n_chans;
+	cc->chans = (CHANNEL_m12 **) malloc((size_t) n_chans * sizeof(CHANNEL_m12 *));
+	cc->maps = (SWEEP_MAP **) malloc((size_t) n_chans * sizeof(SWEEP_MAP *));
+	for (i = 0; i < n_chans; ++i) {
+		cc->chans[i] = map_tasks[i].chan;
+		cc->maps[i] = map_tasks[i].map;
+	}
+	free((void *) map_tasks);
+
+	return(register_session(sess, (void *) cc, REGISTRY_NO_HANDLE));
+}
+
+
+// work queue task
+void	map_conversion_channel(void *arg, si4 worker_id)
+{
+	CONVERSION_MAP_TASK	*map_task;
+
+
+	map_task = (CONVERSION_MAP_TASK *) arg;
+	map_task->indices_read = read_segment_indices(map_task->chan);
+	if (map_task->indices_read == TRUE_m12)
+		map_task->map = build_sweep_map(map_task->chan);
+
+	return;
+}
+
+
+// closes channels left open for MED_paths (any password), or all channels if MED_paths is an empty string (returns TRUE_m12), returns TRUE_m12 if any were closed
+TERN_m12	close_conversion_channels(void *MED_paths, si4 n_files)
+{
+	si1		*key;
+	TERN_m12	closed;
+	REGISTRY_ENTRY	*entry;
+
+
+	if (n_files == 0 && *((si1 *) MED_paths) == 0) {
+		free_registry();
+		return(TRUE_m12);
+	}
+
+	key = conversion_key(MED_paths, n_files);
+	closed = FALSE_m12;
+	while ((entry = find_registry_entry(match_conversion_directory, (void *) key)) != NULL) {
+		unregister_session(entry);
+		closed = TRUE_m12;
+	}
+	free((void *) key);
+
+	return(closed);
+}
+
+
+// returns allocated registry key for MED_paths (list entries separated by newlines)
+si1	*conversion_key(void *MED_paths, si4 n_files)
+{
+	si1	*key, **paths;
+	si4	i;
+	size_t	len;
+
+
+	if (n_files == 0) {
+		key = (si1 *) malloc(strlen((si1 *) MED_paths) + 1);
+		strcpy(key, (si1 *) MED_paths);
+		return(key);
+	}
+
+	paths = (si1 **) MED_paths;
+	for (i = 0, len = 1; i < n_files; ++i)
+		len += strlen(paths[i]) + 1;
+	key = (si1 *) malloc(len);
+	*key = 0;
+	for (i = 0; i < n_files; ++i) {
+		if (i)
+			strcat(key, "\n");
+		strcat(key, paths[i]);
+	}
+
+	return(key);
+}
+
+
+// resolves MED_directory (channel, or session: its first channel) to a channel directory, returns FALSE_m12 if there is none
+TERN_m12	resolve_conversion_channel(si1 *MED_directory, si1 *chan_path)
+{
+	si1			tmp_str[FULL_FILE_NAME_BYTES_m12], extension[TYPE_BYTES_m12], **channel_list;
+	si4			n_channels;
+
+
+	// get full MED directory name
+	G_path_from_root_m12(MED_directory, chan_path);
+	G_extract_path_parts_m12(chan_path, NULL, NULL, extension);
+	if (*extension == 0) {
+		// see if time series channel with this name exists
+		sprintf_m12(tmp_str, "%s.%s", chan_path, TIME_SERIES_CHANNEL_DIRECTORY_TYPE_STRING_m12);
+		if (G_exists_m12(tmp_str) == DIR_EXISTS_m12) {
+			strcpy(chan_path, tmp_str);
+			strcpy(extension, TIME_SERIES_CHANNEL_DIRECTORY_TYPE_STRING_m12);
+		} else {
+			// see if session with this name exists
+			sprintf_m12(chan_path, "%s.%s", chan_path, SESSION_DIRECTORY_TYPE_STRING_m12);
+			if (G_exists_m12(chan_path) == DIR_EXISTS_m12)
+				strcpy(extension, SESSION_DIRECTORY_TYPE_STRING_m12);
+			else
+				return(FALSE_m12);
+		}
+	}
+
+	// get a first channel from session
+	if (strcmp(extension, SESSION_DIRECTORY_TYPE_STRING_m12) == 0) {
+		channel_list = G_generate_file_list_m12(NULL, &n_channels, chan_path, NULL, TIME_SERIES_CHANNEL_DIRECTORY_TYPE_STRING_m12, GFL_FULL_PATH_m12);
+		if (channel_list == NULL) {
+			G_warning_message_m12("No time series channels in session directory\n");
+			return(FALSE_m12);
+		}
+		strcpy(chan_path, channel_list[0]);
+		free_m12((void *) channel_list, __FUNCTION__);
+	} else if (strcmp(extension, TIME_SERIES_CHANNEL_DIRECTORY_TYPE_STRING_m12)) {
+		G_warning_message_m12("'MED_directory' must be an existing MED channel or session\n");
+		return(FALSE_m12);
+	}
+
+	return(TRUE_m12);
+}
+
+
+// registry match functions
+TERN_m12	match_conversion_key(REGISTRY_ENTRY *entry, void *arg)
+{
+	CONVERSION_CHANNELS	*cc, *key;
+
+
+	cc = (CONVERSION_CHANNELS *) entry->client_data;
+	key = (CONVERSION_CHANNELS *) arg;
+	if (strcmp(cc->MED_directory, key->MED_directory) || strcmp(cc->password, key->password))
+		return(FALSE_m12);
+
+	return(TRUE_m12);
+}
+
+
+TERN_m12	match_conversion_directory(REGISTRY_ENTRY *entry, void *arg)
+{
+	CONVERSION_CHANNELS	*cc;
+
+
+	cc = (CONVERSION_CHANNELS *) entry->client_data;
+	if (strcmp(cc->MED_directory, (si1 *) arg))
+		return(FALSE_m12);
+
+	return(TRUE_m12);
+}
+
+
+// registry free function (called with the channels' globals restored)
+void	free_conversion_entry(REGISTRY_ENTRY *entry)
+{
+	si4			i;
+	CONVERSION_CHANNELS	*cc;
+
+
+	cc = (CONVERSION_CHANNELS *) entry->client_data;
+	if (cc != NULL) {
+		for (i = 0; i < cc->n_chans; ++i)
+			free_sweep_map(cc->maps[i]);
+		free((void *) cc->maps);
+		free((void *) cc->chans);
+		free((void *) cc->MED_directory);
+		free((void *) cc);
+	}
+	G_free_session_m12(entry->sess, TRUE_m12);
+
+	return;
+}
+
+
+// call from the gateway's exit function
+void	free_conversion_channels(void)
+{
+	free_registry();
+	G_free_globals_m12(TRUE_m12);
+
+	return;
+}
@@ -0,0 +1,51 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+#ifndef CONVERSION_CHANNELS_IN
+#define CONVERSION_CHANNELS_IN
+
+// Includes
+#include "medlib_m12.h"
+#include "session_registry.h"
+#include "session_manifest.h"
+#include "index_sweep.h"
+
+// Persistence
+#define CONVERSION_PERSIST_NONE		((ui1) 0)	// open channels, convert, & close (channels left open by "open" are used, & left open)
+#define CONVERSION_PERSIST_OPEN		((ui1) 1)	// convert, & leave channels open for later calls with the same MED_directory & password
+#define CONVERSION_PERSIST_CLOSE	((ui1) 2)	// close channels left open for MED_directory (all channels if MED_directory is empty)
+
+// Miscellaneous
+#define CONVERSION_REGEX_CHARS		"*?[]{}|^$"	// a single MED_directory containing any of these is passed to medlib as a channel list
+
+// Open Conversion Channels (registry client data)
+typedef struct {
+	si1		*MED_directory;  // as passed, list entries separated by newlines (key)
+	si1		password[PASSWORD_BYTES_m12 + 1];  // (key)
+	si4		n_chans;
+	CHANNEL_m12	**chans;  // session's time series channels, in session order (result columns)
+	SWEEP_MAP	**maps;  // NULL entries if indices could not be mapped (per-element conversions)
+} CONVERSION_CHANNELS;
+
+typedef struct {  // work queue task: reads one channel's indices & builds its block map
+	CHANNEL_m12	*chan;
+	SWEEP_MAP	*map;
+	TERN_m12	indices_read;
+} CONVERSION_MAP_TASK;
+
+
+// Prototypes
+void			initialize_conversion_channels(void);
+REGISTRY_ENTRY		*get_conversion_channels(void *MED_paths, si4 n_files, si1 *password, TERN_m12 *opened);
+REGISTRY_ENTRY		*open_conversion_channels(void *MED_paths, si4 n_files, si1 *key, si1 *password);
+void			map_conversion_channel(void *arg, si4 worker_id);
+TERN_m12		close_conversion_channels(void *MED_paths, si4 n_files);
+si1			*conversion_key(void *MED_paths, si4 n_files);
+TERN_m12		resolve_conversion_channel(si1 *MED_directory, si1 *chan_path);
+TERN_m12		match_conversion_key(REGISTRY_ENTRY *entry, void *arg);
+TERN_m12		match_conversion_directory(REGISTRY_ENTRY *entry, void *arg);
+void			free_conversion_entry(REGISTRY_ENTRY *entry);
+void			free_conversion_channels(void);
+
+
+#endif /* CONVERSION_CHANNELS_IN */
@@ -7,6 +7,7 @@
 
 // Includes
 #include "medlib_m12.h"
+#include "record_edit.h"
 
 
 // Defines
@@ -0,0 +1,159 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Filter design cache
+// Designs are keyed by (order, type, sampling frequency, cutoffs) & live until the mex function is unloaded, so channels with the same rate,
+// & successive calls with the same settings, share one set of coefficients. Worker threads only read designs (each filters with its own instance).
+// NOTE: designs are looked up & freed by one thread at a time (the calling thread, or a prefetch thread the calling thread waits for before its next use), so the cache has no lock.
+
+
+#include "filter_cache.h"
+
+// Globals
+static FILT_CACHE_ENTRY		*filt_cache = NULL;
+static si4			n_filt_cache_entries = 0, filt_cache_size = 0;
+static ui8			filt_cache_generation = 1;
+static FILT_PROCESSING_STRUCT_m12	**uncached_designs = NULL;  // designed while every cached design was in use (freed with the generation)
+static si4			n_uncached_designs = 0, uncached_designs_size = 0;
+
+
+// returns shared design for filter settings (designed on first use), or NULL if filter cannot be designed
+FILT_PROCESSING_STRUCT_m12	*get_filter_design(si4 order, si4 type, sf8 samp_freq, sf8 cut_1, sf8 cut_2)
+{
+	si4			i;
+	FILT_CACHE_ENTRY	*entry;
+
+
+	for (i = 0; i < n_filt_cache_entries; ++i) {
+		entry = filt_cache + i;
+		if (entry->order == order && entry->type == type && entry->samp_freq == samp_freq && entry->cut_1 == cut_1 && entry->cut_2 == cut_2) {
+			entry->last_use = filt_cache_generation;
+			return(entry->design);
+		}
+	}
+
+	// make room (if every cached design is in use by this generation, the design is not cached, & lives until the next generation)
+	if (n_filt_cache_entries == FILT_CACHE_MAX_DESIGNS)
+		if (evict_filter_design() == 0)
+			return(uncached_filter_design(order, type, samp_freq, cut_1, cut_2));
+	if (n_filt_cache_entries == filt_cache_size) {
+		filt_cache_size = (filt_cache_size) ? filt_cache_size * 2 : 16;
+		filt_cache = (FILT_CACHE_ENTRY *) realloc((void *) filt_cache, (size_t) filt_cache_size * sizeof(FILT_CACHE_ENTRY));
+	}
+
+	// design (no data buffers), failures are cached too
+	entry = filt_cache + n_filt_cache_entries++;
+	entry->order = order;
+	entry->type = type;
+	entry->samp_freq = samp_freq;
+	entry->cut_1 = cut_1;
+	entry->cut_2 = cut_2;
+	entry->last_use = filt_cache_generation;
+	entry->design = FILT_initialize_processing_struct_m12(order, type, samp_freq, 0, FALSE_m12, FALSE_m12, FALSE_m12, RETURN_ON_FAIL_m12 | SUPPRESS_OUTPUT_m12, cut_1, cut_2);
+
+	return(entry->design);
+}
+
+
+// designs filter outside the cache: freed by the next advance_filter_cache() (or free_filter_cache()), so the cache never exceeds FILT_CACHE_MAX_DESIGNS
+FILT_PROCESSING_STRUCT_m12	*uncached_filter_design(si4 order, si4 type, sf8 samp_freq, sf8 cut_1, sf8 cut_2)
+{
+	FILT_PROCESSING_STRUCT_m12	*design;
+
+
+	design = FILT_initialize_processing_struct_m12(order, type, samp_freq, 0, FALSE_m12, FALSE_m12, FALSE_m12, RETURN_ON_FAIL_m12 | SUPPRESS_OUTPUT_m12, cut_1, cut_2);
+	if (design == NULL)
+		return(NULL);
+
+	if (n_uncached_designs == uncached_designs_size) {
+		uncached_designs_size = (uncached_designs_size) ? uncached_designs_size * 2 : 16;
+		uncached_designs = (FILT_PROCESSING_STRUCT_m12 **) realloc((void *) uncached_designs, (size_t) uncached_designs_size * sizeof(FILT_PROCESSING_STRUCT_m12 *));
+	}
+	uncached_designs[n_uncached_designs++] = design;
+
+	return(design);
+}
+
+
+// sets up a caller owned processing structure that shares the design's coefficients
+// filt_data & buffer must each hold data_len + FILT_FILT_PAD_SAMPLES_m12(design->n_poles) samples; orig_data is offset into filt_data, so data is filtered in place
+void	instantiate_filter(FILT_PROCESSING_STRUCT_m12 *design, FILT_PROCESSING_STRUCT_m12 *filtps, si8 data_len, sf8 *filt_data, sf8 *buffer)
+{
+	*filtps = *design;  // shallow copy (coefficient arrays are read only)
+	filtps->data_length = data_len;
+	filtps->filt_data = filt_data;
+	filtps->orig_data = FILT_OFFSET_ORIG_DATA_m12(filtps);  // offset to skip intial copy
+	filtps->buffer = buffer;
+
+	return;
+}
+
+
+// starts a new cache generation (call once per mex call, before looking up designs), & frees the last generation's uncached designs
+void	advance_filter_cache(void)
+{
+	free_uncached_filter_designs();
+	++filt_cache_generation;
+
+	return;
+}
+
+
+void	free_uncached_filter_designs(void)
+{
+	si4	i;
+
+
+	for (i = 0; i < n_uncached_designs; ++i)
+		FILT_free_processing_struct_m12(uncached_designs[i], FALSE_m12, FALSE_m12, FALSE_m12, TRUE_m12);
+	n_uncached_designs = 0;
+
+	return;
+}
+
+
+void	free_filter_cache(void)
+{
+	si4	i;
+
+
+	for (i = 0; i < n_filt_cache_entries; ++i)
+		if (filt_cache[i].design != NULL)
+			FILT_free_processing_struct_m12(filt_cache[i].design, FALSE_m12, FALSE_m12, FALSE_m12, TRUE_m12);
+	if (filt_cache != NULL)
+		free((void *) filt_cache);
+	filt_cache = NULL;
+	n_filt_cache_entries = filt_cache_size = 0;
+
+	free_uncached_filter_designs();
+	if (uncached_designs != NULL)
+		free((void *) uncached_designs);
+	uncached_designs = NULL;
+	uncached_designs_size = 0;
+
+	return;
+}
+
+
+// frees least recently used design not used in the current generation, returns number freed
+si4	evict_filter_design(void)
+{
+	si4	i, lru;
+
+
+	lru = -1;
+	for (i = 0; i < n_filt_cache_entries; ++i) {
+		if (filt_cache[i].last_use == filt_cache_generation)
+			continue;
+		if (lru == -1 || filt_cache[i].last_use < filt_cache[lru].last_use)
+			lru = i;
+	}
+	if (lru == -1)
+		return(0);
+
+	if (filt_cache[lru].design != NULL)
+		FILT_free_processing_struct_m12(filt_cache[lru].design, FALSE_m12, FALSE_m12, FALSE_m12, TRUE_m12);
+	filt_cache[lru] = filt_cache[--n_filt_cache_entries];
+
+	return(1);
+}
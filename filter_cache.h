@@ -0,0 +1,32 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+#ifndef FILTER_CACHE_IN
+#define FILTER_CACHE_IN
+
+// Includes
+#include "medlib_m12.h"
+
+// Miscellaneous
+#define FILT_CACHE_MAX_DESIGNS		64	// least recently used designs beyond this are freed (if all are in use by the current call, new designs are not cached)
+
+// Filter Cache Structures
+typedef struct {
+	si4				order, type;
+	sf8				samp_freq, cut_1, cut_2;
+	FILT_PROCESSING_STRUCT_m12	*design;  // coefficients only (no data buffers), NULL if design failed
+	ui8				last_use;  // cache generation
+} FILT_CACHE_ENTRY;
+
+
+// Prototypes
+FILT_PROCESSING_STRUCT_m12	*get_filter_design(si4 order, si4 type, sf8 samp_freq, sf8 cut_1, sf8 cut_2);
+FILT_PROCESSING_STRUCT_m12	*uncached_filter_design(si4 order, si4 type, sf8 samp_freq, sf8 cut_1, sf8 cut_2);
+void				instantiate_filter(FILT_PROCESSING_STRUCT_m12 *design, FILT_PROCESSING_STRUCT_m12 *filtps, si8 data_len, sf8 *filt_data, sf8 *buffer);
+void				advance_filter_cache(void);
+void				free_uncached_filter_designs(void);
+void				free_filter_cache(void);
+si4				evict_filter_design(void);
+
+
+#endif /* FILTER_CACHE_IN */
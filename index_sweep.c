@@ -0,0 +1,260 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Batched time <=> sample conversion
+// Converting large query arrays one element at a time repeats a segment & block search per query. Here queries are sorted (the permutation is kept,
+// & results are returned in the caller's order), & each run of SWEEP_CHUNK_QUERIES sorted queries finds its first block once & then sweeps forward
+// through a flat map of the channel's blocks. Runs are spread over the work queue. Several channels (e.g. mixed rate micro & macro channels) share
+// one sorted copy of the queries, & each channel's runs are separate tasks.
+// Within a block, results use the FIND_CURRENT_m12 arithmetic medlib uses (sample period containing a time, & start time of a sample's period).
+// Queries that fall outside every block (before the channel, past its end, or in a discontinuity) are left to the per-element medlib conversion,
+// on the calling thread, so their results (which depend on medlib's search mode) are unchanged.
+
+
+#include "index_sweep.h"
+
+
+// builds block map from the channel's time series indices (read_segment_indices() must have been called), returns NULL if indices are missing
+SWEEP_MAP	*build_sweep_map(CHANNEL_m12 *chan)
+{
+	si4					i, seg_idx, n_segs;
+	si8					j, n_blocks, n_map_blocks, abs_start_samp;
+	sf8					fs;
+	SEGMENT_m12				*seg;
+	TIME_SERIES_INDEX_m12			*tsi;
+	TIME_SERIES_METADATA_SECTION_2_m12	*tmd2;
+	SWEEP_BLOCK				*blk;
+	SWEEP_MAP				*map;
+
+
+	if (chan->segments == NULL)
+		return(NULL);
+	n_segs = TIME_SLICE_SEGMENT_COUNT_m12(&chan->time_slice);
+	seg_idx = G_get_segment_index_m12(chan->time_slice.start_segment_number);
+
+	// count blocks
+	for (i = 0, n_map_blocks = 0; i < n_segs; ++i) {
+		seg = chan->segments[seg_idx + i];
+		if (seg == NULL || seg->metadata_fps == NULL || seg->time_series_indices_fps == NULL)
+			return(NULL);
+		n_map_blocks += seg->metadata_fps->metadata->time_series_section_2.number_of_blocks;
+	}
+	if (n_map_blocks == 0)
+		return(NULL);
+
+	map = (SWEEP_MAP *) malloc(sizeof(SWEEP_MAP));
+	map->blocks = (SWEEP_BLOCK *) malloc((size_t) n_map_blocks * sizeof(SWEEP_BLOCK));
+	map->n_blocks = n_map_blocks;
+
+	// fill blocks (block end times from sample counts, as medlib does)
+	blk = map->blocks;
+	for (i = 0; i < n_segs; ++i) {
+		seg = chan->segments[seg_idx + i];
+		tsi = seg->time_series_indices_fps->time_series_indices;
+		tmd2 = &seg->metadata_fps->metadata->time_series_section_2;
+		n_blocks = tmd2->number_of_blocks;
+		abs_start_samp = tmd2->absolute_start_sample_number;
+		fs = tmd2->sampling_frequency;
+		for (j = 0; j < n_blocks; ++j, ++blk) {
+			blk->start_time = tsi[j].start_time;
+			blk->start_sample_number = abs_start_samp + tsi[j].start_sample_number;
+			blk->end_sample_number = (abs_start_samp + tsi[j + 1].start_sample_number) - 1;  // terminal index follows last block
+			blk->end_time = tsi[j].start_time + (si8) round(((sf8) (tsi[j + 1].start_sample_number - tsi[j].start_sample_number) * (sf8) 1e6) / fs) - 1;
+			blk->sampling_frequency = fs;
+			blk->contiguous_next = FALSE_m12;
+			if (j > 0 || i > 0)
+				(blk - 1)->contiguous_next = (tsi[j].file_offset < 0) ? FALSE_m12 : TRUE_m12;
+		}
+	}
+
+	return(map);
+}
+
+
+void	free_sweep_map(SWEEP_MAP *map)
+{
+	if (map == NULL)
+		return;
+
+	free((void *) map->blocks);
+	free((void *) map);
+
+	return;
+}
+
+
+// converts absolute (offset) uutc times to absolute sample numbers in place (FIND_ABSOLUTE_m12 | FIND_CURRENT_m12)
+void	sweep_sample_for_time(CHANNEL_m12 *chan, SWEEP_MAP *map, si8 *times, si8 n_times)
+{
+	sweep_channels(&chan, &map, 1, times, n_times, times, SWEEP_SAMPLE_FOR_TIME);
+
+	return;
+}
+
+
+// converts absolute sample numbers to absolute (offset) uutc times in place (FIND_ABSOLUTE_m12 | FIND_CURRENT_m12)
+void	sweep_time_for_sample(CHANNEL_m12 *chan, SWEEP_MAP *map, si8 *samps, si8 n_samps)
+{
+	sweep_channels(&chan, &map, 1, samps, n_samps, samps, SWEEP_TIME_FOR_SAMPLE);
+
+	return;
+}
+
+
+// converts values for each channel: results is n_values x n_chans (column major, column per channel), & may be values if n_chans == 1
+// queries are sorted once for all channels, & every (channel, run) pair is a work queue task
+// maps[i] == NULL: channel i is converted per element by medlib
+void	sweep_channels(CHANNEL_m12 **chans, SWEEP_MAP **maps, si4 n_chans, si8 *values, si8 n_values, si8 *results, si4 direction)
+{
+	si4		c;
+	si8		i, j, n_runs, n_tasks, *col;
+	ui1		*resolved, *res_col;
+	TERN_m12	sorted;
+	SWEEP_QUERY	*queries;
+	SWEEP_CHUNK	*chunks;
+	WQ_TASK		*tasks;
+
+
+	if (n_values <= 0 || n_chans <= 0)
+		return;
+
+	// sort queries (event lists are usually sorted already)
+	queries = (SWEEP_QUERY *) malloc((size_t) n_values * sizeof(SWEEP_QUERY));
+	sorted = TRUE_m12;
+	for (i = 0; i < n_values; ++i) {
+		queries[i].value = values[i];
+		queries[i].idx = i;
+		if (i && values[i] < values[i - 1])
+			sorted = FALSE_m12;
+	}
+	if (sorted == FALSE_m12)
+		qsort((void *) queries, (size_t) n_values, sizeof(SWEEP_QUERY), compare_sweep_queries);
+
+	// sweep runs of sorted queries
+	n_runs = (n_values + SWEEP_CHUNK_QUERIES - 1) / SWEEP_CHUNK_QUERIES;
+	resolved = (ui1 *) calloc((size_t) (n_values * (si8) n_chans), sizeof(ui1));
+	chunks = (SWEEP_CHUNK *) malloc((size_t) (n_runs * (si8) n_chans) * sizeof(SWEEP_CHUNK));
+	tasks = (WQ_TASK *) malloc((size_t) (n_runs * (si8) n_chans) * sizeof(WQ_TASK));
+	for (c = 0, n_tasks = 0; c < n_chans; ++c) {
+		if (maps[c] == NULL)
+			continue;
+		for (i = 0; i < n_runs; ++i, ++n_tasks) {
+			chunks[n_tasks].map = maps[c];
+			chunks[n_tasks].queries = queries + (i * SWEEP_CHUNK_QUERIES);
+			chunks[n_tasks].n_queries = (i == n_runs - 1) ? n_values - (i * SWEEP_CHUNK_QUERIES) : SWEEP_CHUNK_QUERIES;
+			chunks[n_tasks].results = results + ((si8) c * n_values);
+			chunks[n_tasks].resolved = resolved + ((si8) c * n_values);
+			chunks[n_tasks].direction = direction;
+			tasks[n_tasks].task_f = sweep_chunk;
+			tasks[n_tasks].arg = (void *) (chunks + n_tasks);
+		}
+	}
+	run_work_queue(tasks, n_tasks, work_queue_workers(n_tasks));
+	free((void *) tasks);
+	free((void *) chunks);
+	free((void *) queries);
+
+	// unresolved queries converted individually by medlib (queries are read from values, so results must not be written before they are read)
+	for (c = 0; c < n_chans; ++c) {
+		col = results + ((si8) c * n_values);
+		res_col = resolved + ((si8) c * n_values);
+		for (j = 0; j < n_values; ++j) {
+			if (res_col[j])
+				continue;
+			if (direction == SWEEP_SAMPLE_FOR_TIME)
+				col[j] = G_sample_number_for_uutc_m12((LEVEL_HEADER_m12 *) chans[c], values[j], (FIND_ABSOLUTE_m12 | FIND_CURRENT_m12));
+			else
+				col[j] = G_uutc_for_sample_number_m12((LEVEL_HEADER_m12 *) chans[c], values[j], (FIND_ABSOLUTE_m12 | FIND_CURRENT_m12));
+		}
+	}
+	free((void *) resolved);
+
+	return;
+}
+
+
+// work queue task: resolves a run of sorted queries in one forward pass over a channel's blocks
+void	sweep_chunk(void *arg, si4 worker_id)
+{
+	si8		i, b, n_blocks, val;
+	SWEEP_CHUNK	*chunk;
+	SWEEP_BLOCK	*blocks, *blk;
+	SWEEP_QUERY	*q;
+
+
+	chunk = (SWEEP_CHUNK *) arg;
+	blocks = chunk->map->blocks;
+	n_blocks = chunk->map->n_blocks;
+	q = chunk->queries;
+	b = sweep_start_block(chunk->map, q->value, chunk->direction);
+
+	if (chunk->direction == SWEEP_SAMPLE_FOR_TIME) {
+		for (i = chunk->n_queries; i--; ++q) {
+			while (b + 1 < n_blocks && blocks[b + 1].start_time <= q->value)
+				++b;
+			blk = blocks + b;
+			if (q->value < blk->start_time)  // before channel
+				continue;
+			if (q->value > blk->end_time) {
+				if (blk->contiguous_next == FALSE_m12)  // discontinuity or past end
+					continue;
+				val = blk->end_sample_number;  // rounding of block end time
+			} else {
+				val = blk->start_sample_number + (si8) (((sf8) (q->value - blk->start_time) * blk->sampling_frequency) / (sf8) 1e6);
+				if (val > blk->end_sample_number)
+					val = blk->end_sample_number;
+			}
+			chunk->results[q->idx] = val;
+			chunk->resolved[q->idx] = 1;
+		}
+	} else {  // SWEEP_TIME_FOR_SAMPLE
+		for (i = chunk->n_queries; i--; ++q) {
+			while (b + 1 < n_blocks && blocks[b + 1].start_sample_number <= q->value)
+				++b;
+			blk = blocks + b;
+			if (q->value < blk->start_sample_number || q->value > blk->end_sample_number)  // before or past channel
+				continue;
+			chunk->results[q->idx] = blk->start_time + (si8) round(((sf8) (q->value - blk->start_sample_number) * (sf8) 1e6) / blk->sampling_frequency);
+			chunk->resolved[q->idx] = 1;
+		}
+	}
+
+	return;
+}
+
+
+// returns index of last block starting at or before value (0 if none)
+si8	sweep_start_block(SWEEP_MAP *map, si8 value, si4 direction)
+{
+	si8		lo, hi, mid, block_start;
+
+
+	lo = 0;
+	hi = map->n_blocks - 1;
+	while (lo < hi) {
+		mid = (lo + hi + 1) >> 1;
+		block_start = (direction == SWEEP_SAMPLE_FOR_TIME) ? map->blocks[mid].start_time : map->blocks[mid].start_sample_number;
+		if (block_start > value)
+			hi = mid - 1;
+		else
+			lo = mid;
+	}
+
+	return(lo);
+}
+
+
+si4	compare_sweep_queries(const void *a, const void *b)
+{
+	si8	a_val, b_val;
+
+
+	a_val = ((SWEEP_QUERY *) a)->value;
+	b_val = ((SWEEP_QUERY *) b)->value;
+	if (a_val > b_val)
+		return(1);
+	if (a_val < b_val)
+		return(-1);
+
+	return(0);
+}
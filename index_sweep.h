@@ -0,0 +1,55 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+#ifndef INDEX_SWEEP_IN
+#define INDEX_SWEEP_IN
+
+// Includes
+#include "medlib_m12.h"
+#include "work_queue.h"
+
+// Miscellaneous
+#define SWEEP_CHUNK_QUERIES		((si8) 65536)	// sorted queries per work queue task
+#define SWEEP_SAMPLE_FOR_TIME		1
+#define SWEEP_TIME_FOR_SAMPLE		2
+
+// Index Sweep Structures
+typedef struct {  // one time series block (absolute sample numbers, inclusive end times & samples)
+	si8		start_time, end_time;
+	si8		start_sample_number, end_sample_number;
+	sf8		sampling_frequency;
+	TERN_m12	contiguous_next;  // next block follows without a discontinuity
+} SWEEP_BLOCK;
+
+typedef struct {
+	SWEEP_BLOCK	*blocks;
+	si8		n_blocks;
+} SWEEP_MAP;
+
+typedef struct {
+	si8		value;
+	si8		idx;  // position in caller's array
+} SWEEP_QUERY;
+
+typedef struct {
+	SWEEP_MAP	*map;
+	SWEEP_QUERY	*queries;  // run of sorted queries (shared by all channels)
+	si8		n_queries;
+	si8		*results;  // channel's column (caller's order)
+	ui1		*resolved;  // channel's column (0: left for the per-element medlib conversion)
+	si4		direction;
+} SWEEP_CHUNK;
+
+
+// Prototypes
+SWEEP_MAP	*build_sweep_map(CHANNEL_m12 *chan);
+void		free_sweep_map(SWEEP_MAP *map);
+void		sweep_sample_for_time(CHANNEL_m12 *chan, SWEEP_MAP *map, si8 *times, si8 n_times);
+void		sweep_time_for_sample(CHANNEL_m12 *chan, SWEEP_MAP *map, si8 *samps, si8 n_samps);
+void		sweep_channels(CHANNEL_m12 **chans, SWEEP_MAP **maps, si4 n_chans, si8 *values, si8 n_values, si8 *results, si4 direction);
+void		sweep_chunk(void *arg, si4 worker_id);
+si8		sweep_start_block(SWEEP_MAP *map, si8 value, si4 direction);
+si4		compare_sweep_queries(const void *a, const void *b);
+
+
+#endif /* INDEX_SWEEP_IN */
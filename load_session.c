@@ -3,9 +3,9 @@
 // Copyright Dark Horse Neuro Inc, 2021
 
 
-//******************************************** Mex Compile Line *****************************************//
-//****  mex COMPFLAGS='$COMPFLAGS -Wall -O3' read_MED_exec.c medlib_m12.c medrec_m12.c dhnlib_m12.c  ****//
-//*******************************************************************************************************//
+//******************************************************************* Mex Compile Line ********************************************************************//
+//****  mex COMPFLAGS='$COMPFLAGS -Wall -O3' load_session.c session_manifest.c record_journal.c record_merge.c medlib_m12.c medrec_m12.c dhnlib_m12.c  ****//
+//*********************************************************************************************************************************************************//
 
 
 // [session, record_times, discontigua] = read_MED(MED_dirs, [password])
@@ -130,9 +130,11 @@ void    mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[])
 
 si4     load_session(void *MED_dirs, si4 n_files, si1 *password, mxArray *plhs[])
 {
+	si1					sess_path[FULL_FILE_NAME_BYTES_m12];
         si4                                     n_channels;
 	ui8                                     flags;
         SESSION_m12                             *sess;
+	SESSION_MANIFEST			*sm;
         TIME_SLICE_m12                          local_sess_slice, *sess_slice;
         mxArray                                 *mat_session, *mat_channels;
 	const si4                               n_mat_session_fields = NUMBER_OF_SESSION_FIELDS_mat;
@@ -141,12 +143,20 @@ si4     load_session(void *MED_dirs, si4 n_files, si1 *password, mxArray *plhs[]
 	const si1                               *mat_channel_field_names[] = CHANNEL_FIELD_NAMES_mat;
 
 	
+	// session manifest (if current, records are not read)
+	sm = NULL;
+	if (manifest_session_path(MED_dirs, n_files, sess_path) == TRUE_m12)
+		sm = load_session_manifest(sess_path);
+
         // read session
 	sess_slice = &local_sess_slice;
         G_initialize_time_slice_m12(sess_slice);
-	flags = (LH_READ_SEGMENT_METADATA_m12 | LH_READ_SLICE_SESSION_RECORDS_m12 | LH_READ_SLICE_SEGMENTED_SESS_RECS_m12);
+	flags = LH_READ_SEGMENT_METADATA_m12;
+	if (sm == NULL)
+		flags |= (LH_READ_SLICE_SESSION_RECORDS_m12 | LH_READ_SLICE_SEGMENTED_SESS_RECS_m12);
 	sess = G_open_session_m12(NULL, sess_slice, MED_dirs, n_files, flags, password);
 	if (sess == NULL) {
+		free_session_manifest(sm);
 		if (globals_m12->password_data.processed == 0) {
 			G_warning_message_m12("%s(): cannot open session => no matching input files\n", __FUNCTION__);
 		} else {
@@ -161,6 +171,13 @@ si4     load_session(void *MED_dirs, si4 n_files, si1 *password, mxArray *plhs[]
 	// get variable frequency (not done on open)
 	G_frequencies_vary_m12(sess);
 
+	// no manifest named by the file list, or stale: write one for later opens
+	if (sm == NULL) {
+		sm = load_session_manifest(sess->path);
+		if (sm == NULL && write_session_manifest(sess) == TRUE_m12)
+			sm = load_session_manifest(sess->path);
+	}
+
 	// use slice from open_session_m12()
 	sess_slice = &sess->time_slice;
 
@@ -178,35 +195,46 @@ si4     load_session(void *MED_dirs, si4 n_files, si1 *password, mxArray *plhs[]
         mxSetFieldByNumber(mat_session, 0, SESSION_FIELDS_CHANNELS_IDX_mat, mat_channels);
 
   	// Create session record times output array
-	plhs[1] = get_sess_rec_times(sess);
+	plhs[1] = get_sess_rec_times(sess, sm);
 	
 	// Create discontigua output structure
-	plhs[2] = build_discontigua(sess);
+	plhs[2] = build_discontigua(sess, sm);
 	
 	// Build metadata
 	build_metadata(sess, mat_session);
 
 	// clean up
+	free_session_manifest(sm);
 	G_free_session_m12(sess, TRUE_m12);
 
         return(0);
 }
 
 
-mxArray    *build_discontigua(SESSION_m12 *sess)
+// contigua from the session manifest if there is one (no index files read)
+mxArray    *build_discontigua(SESSION_m12 *sess, SESSION_MANIFEST *sm)
 {
         mxArray                         *mat_discontigua, *tmp_mxa;
 	mwSize				n_dims, dims[2];
         si8                             i, n_contigs, n_discontigs, sess_start_time, start_time, end_time;
         const si4                       n_mat_discontiguon_fields = NUMBER_OF_DISCONTIGUON_FIELDS_mat;
 	sf8				sess_duration;
+	CONTIGUON_m12			*contigua;
         const si1                       *mat_discontiguon_field_names[] = DISCONTIGUON_FIELD_NAMES_mat;
         
         
-	n_contigs = G_build_contigua_m12((LEVEL_HEADER_m12 *) sess);
+	if (sm != NULL) {
+		n_contigs = manifest_contigua(sm, &contigua);
+	} else {
+		n_contigs = G_build_contigua_m12((LEVEL_HEADER_m12 *) sess);
+		contigua = sess->contigua;
+	}
 	n_discontigs = n_contigs - 1;
-	if (n_discontigs <= 0)
+	if (n_discontigs <= 0) {
+		if (sm != NULL)
+			free_m12((void *) contigua, __FUNCTION__);
 		return(NULL);
+	}
 	
 	// build discontigua
 	dims[0] = dims[1] = 1; n_dims = 2;
@@ -216,12 +244,12 @@ mxArray    *build_discontigua(SESSION_m12 *sess)
 	for (i = 0; i < n_discontigs; ++i) {
 		// start time
 		tmp_mxa = mxCreateNumericArray(n_dims, dims, mxINT64_CLASS, mxREAL);
-		start_time = sess->contigua[i].end_time + 1;
+		start_time = contigua[i].end_time + 1;
 		*((si8 *) mxGetPr(tmp_mxa)) = start_time;
 		mxSetFieldByNumber(mat_discontigua, i, DISCONTIGUON_FIELDS_START_TIME_IDX_mat, tmp_mxa);
 		// end time
 		tmp_mxa = mxCreateNumericArray(n_dims, dims, mxINT64_CLASS, mxREAL);
-		end_time = sess->contigua[i + 1].start_time - 1;
+		end_time = contigua[i + 1].start_time - 1;
 		*((si8 *) mxGetPr(tmp_mxa)) = end_time;
 		mxSetFieldByNumber(mat_discontigua, i, DISCONTIGUON_FIELDS_END_TIME_IDX_mat, tmp_mxa);
 		// start proportion
@@ -233,6 +261,8 @@ mxArray    *build_discontigua(SESSION_m12 *sess)
 		*((sf8 *) mxGetPr(tmp_mxa)) = (sf8) (end_time - sess_start_time) / sess_duration;
 		mxSetFieldByNumber(mat_discontigua, i, DISCONTIGUON_FIELDS_END_PROP_IDX_mat, tmp_mxa);
 	}
+	if (sm != NULL)
+		free_m12((void *) contigua, __FUNCTION__);
 
 	return(mat_discontigua);
 }
@@ -575,78 +605,52 @@ void    build_metadata(SESSION_m12 *sess, mxArray *mat_session)
 }
 
 
-mxArray     *get_sess_rec_times(SESSION_m12 *sess)
+// record times from the session manifest if there is one (records were not read)
+// manifest records are time ordered, & record index files are each time ordered, so index files are merged (not combined & sorted)
+mxArray     *get_sess_rec_times(SESSION_m12 *sess, SESSION_MANIFEST *sm)
 {
-	ui4				*n_recs, idx;
-	si4				n_segs, seg_idx;
-	si8                     	i, j, k, n_inds, tot_recs;
+	ui4				*n_recs;
+	si4				n_segs, seg_idx, idx;
+	si8                     	i, j, tot_recs;
 	sf8				**rec_props, *rec_prop, sess_dur, sess_start_time;
 	FILE_PROCESSING_STRUCT_m12	*ri_fps;
-	RECORD_INDEX_m12		*ri, *comb_inds;
+	RECORD_INDEX_m12		*ri;
+	RECORD_MERGE			*rm;
 	mxArray                 	*mat_rec_props, *tmp_mxa;
 	mwSize				n_dims, dims[2];
 	
 	
-	// count total records
-	tot_recs = 0;
-	seg_idx = 0;
+	// set up record index streams
+	rm = NULL;
 	n_segs = globals_m12->number_of_session_segments;
-	if (sess->record_indices_fps != NULL) {
-		ri_fps = sess->record_indices_fps;
-		tot_recs += ri_fps->universal_header->number_of_entries;
-	}
-	if (sess->segmented_sess_recs != NULL) {
-		seg_idx = G_get_segment_index_m12(sess->time_slice.start_segment_number);
-		for (i = 0, j = seg_idx; i < n_segs; ++i, ++j) {
-			ri_fps = sess->segmented_sess_recs->record_indices_fps[j];
-			if (ri_fps != NULL)
-				tot_recs += ri_fps->universal_header->number_of_entries;
+	if (sm == NULL) {
+		rm = new_record_merge(n_segs + 1);
+		if (sess->record_indices_fps != NULL) {
+			ri_fps = sess->record_indices_fps;
+			add_record_index_stream(rm, ri_fps->record_indices, ri_fps->universal_header->number_of_entries);
 		}
-	}
-	
-	// combine indices
-	comb_inds = (RECORD_INDEX_m12 *) calloc((size_t) tot_recs, sizeof(RECORD_INDEX_m12));
-	k = 0;
-	if (sess->record_indices_fps != NULL) {
-		ri_fps = sess->record_indices_fps;
-		n_inds = ri_fps->universal_header->number_of_entries;
-		memcpy((void *) (comb_inds + k), (void *) ri_fps->record_indices, (size_t) n_inds * sizeof(RECORD_INDEX_m12));
-		k += n_inds;
-	}
-	if (sess->segmented_sess_recs != NULL) {
-		for (i = 0, j = seg_idx; i < n_segs; ++i, ++j) {
-			ri_fps = sess->segmented_sess_recs->record_indices_fps[j];
-			if (ri_fps != NULL) {
-				n_inds = ri_fps->universal_header->number_of_entries;
-				memcpy((void *) (comb_inds + k), (void *) ri_fps->record_indices, (size_t) n_inds * sizeof(RECORD_INDEX_m12));
-				k += n_inds;
+		if (sess->segmented_sess_recs != NULL) {
+			seg_idx = G_get_segment_index_m12(sess->time_slice.start_segment_number);
+			for (i = 0, j = seg_idx; i < n_segs; ++i, ++j) {
+				ri_fps = sess->segmented_sess_recs->record_indices_fps[j];
+				if (ri_fps != NULL)
+					add_record_index_stream(rm, ri_fps->record_indices, ri_fps->universal_header->number_of_entries);
 			}
 		}
 	}
-
-	// sort combined indices
-	qsort((void *) comb_inds, tot_recs, sizeof(RECORD_INDEX_m12), compare_index_times);
-
-	// count record types
+	
+	// count record types (order independent)
 	n_recs = (ui4 *) calloc((size_t) NUM_REC_TYPES, sizeof(ui4));
-	for (ri = comb_inds, i = tot_recs; i--; ++ri) {
-		switch (ri->type_code) {
-			case REC_HFOc_TYPE_CODE_m12:
-				++n_recs[REC_HFOc_IDX];
-				break;
-			case REC_NlxP_TYPE_CODE_m12:
-				++n_recs[REC_NlxP_IDX];
-				break;
-			case REC_Note_TYPE_CODE_m12:
-				++n_recs[REC_Note_IDX];
-				break;
-			case REC_Seiz_TYPE_CODE_m12:
-				++n_recs[REC_Seiz_IDX];
-				break;
-			case REC_Sgmt_TYPE_CODE_m12:
-				++n_recs[REC_Sgmt_IDX];
-				break;
-		}
+	if (sm != NULL) {
+		tot_recs = sm->header->number_of_records;
+		for (i = 0; i < tot_recs; ++i)
+			if ((idx = rec_type_idx(sm->records[i].type_code)) >= 0)
+				++n_recs[idx];
+	} else {
+		for (i = 0; i < rm->number_of_streams; ++i)
+			for (ri = rm->streams[i].indices, j = rm->streams[i].remaining; j--; ++ri)
+				if ((idx = rec_type_idx(ri->type_code)) >= 0)
+					++n_recs[idx];
 	}
 	
 	// allocate matlab arrays
@@ -662,58 +666,51 @@ mxArray     *get_sess_rec_times(SESSION_m12 *sess)
 		}
 	}
 	
-	// divide record types & compute session proportions
+	// divide record types & compute session proportions (in time order)
 	sess_start_time = (sf8) globals_m12->session_start_time;
 	sess_dur = (sf8) globals_m12->session_end_time - sess_start_time;
-	for (ri = comb_inds, i = tot_recs; i--; ++ri) {
-		switch (ri->type_code) {
-			case REC_HFOc_TYPE_CODE_m12:
-				idx = REC_HFOc_IDX;
-				break;
-			case REC_NlxP_TYPE_CODE_m12:
-				idx = REC_NlxP_IDX;
-				break;
-			case REC_Note_TYPE_CODE_m12:
-				idx = REC_Note_IDX;
-				break;
-			case REC_Seiz_TYPE_CODE_m12:
-				idx = REC_Seiz_IDX;
-				break;
-			case REC_Sgmt_TYPE_CODE_m12:
-				idx = REC_Sgmt_IDX;
-				break;
-			default:
+	if (sm != NULL) {
+		for (i = 0; i < tot_recs; ++i) {
+			if ((idx = rec_type_idx(sm->records[i].type_code)) < 0)
 				continue;
+			rec_prop = rec_props[idx]++;
+			*rec_prop = ((sf8) sm->records[i].start_time - sess_start_time) / sess_dur;
+		}
+	} else {
+		start_record_merge(rm);
+		while ((ri = next_merged_index(rm)) != NULL) {
+			if ((idx = rec_type_idx(ri->type_code)) < 0)
+				continue;
+			rec_prop = rec_props[idx]++;
+			*rec_prop = ((sf8) ri->start_time - sess_start_time) / sess_dur;
 		}
-		
-		// calculate proportion
-		rec_prop = rec_props[idx]++;
-		*rec_prop = ((sf8) ri->start_time - sess_start_time) / sess_dur;
 	}
 		
 	// clean up
-	free((void *) comb_inds);
+	free_record_merge(rm);
+	free((void *) rec_props);
 	free((void *) n_recs);
 
 	return(mat_rec_props);
 }
 
 
-#ifndef WINDOWS_m12  // inline causes linking problem in Windows
-inline
-#endif
-si4     compare_index_times(const void *a, const void * b)
+// index of record type in record times, or -1 for other types
+si4	rec_type_idx(ui4 type_code)
 {
-	RECORD_INDEX_m12	*ria, *rib;
-	
-	
-	ria = (RECORD_INDEX_m12 *) a;
-	rib = (RECORD_INDEX_m12 *) b;
-	
-	if (ria->start_time > rib->start_time)
-		return(1);
-	else if (ria->start_time < rib->start_time)
-		return(-1);
-	return(0);
+	switch (type_code) {
+		case REC_HFOc_TYPE_CODE_m12:
+			return(REC_HFOc_IDX);
+		case REC_NlxP_TYPE_CODE_m12:
+			return(REC_NlxP_IDX);
+		case REC_Note_TYPE_CODE_m12:
+			return(REC_Note_IDX);
+		case REC_Seiz_TYPE_CODE_m12:
+			return(REC_Seiz_IDX);
+		case REC_Sgmt_TYPE_CODE_m12:
+			return(REC_Sgmt_IDX);
+	}
+
+	return(-1);
 }
 
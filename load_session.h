@@ -7,6 +7,8 @@
 
 // Includes
 #include "medlib_m12.h"
+#include "session_manifest.h"
+#include "record_merge.h"
 
 // Defines
 
@@ -154,10 +156,10 @@
 // Prototypes
 void            mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[]);
 si4     	load_session(void *file_list, si4 n_files, si1 *password, mxArray *plhs[]);
-mxArray    	*build_discontigua(SESSION_m12 *sess);
+mxArray    	*build_discontigua(SESSION_m12 *sess, SESSION_MANIFEST *sm);
 void		build_metadata(SESSION_m12 *sess, mxArray *mat_session);
-mxArray     	*get_sess_rec_times(SESSION_m12 *sess);
-si4     	compare_index_times(const void *a, const void * b);
+mxArray     	*get_sess_rec_times(SESSION_m12 *sess, SESSION_MANIFEST *sm);
+si4     	rec_type_idx(ui4 type_code);
 
 
 #endif /* LOAD_SESSION_IN */
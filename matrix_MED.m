@@ -74,11 +74,11 @@ function [mat, mps] = matrix_MED(varargin)
     %       'fast':  use bin mean or center, depending on whether ranges requested
     %   Persist specified as:
     %       ['none']:  single read behavior (default: this is identical to 'read close' below)
-    %       'open':  close & free any open session, open new session, & return
-    %		'close':  close & free any open session & return
-    %       'read':  read current session (& open if none exists), replace existing parameters with non-empty passed parameters
-    %       'read_new':  close any open session, open & read new session
-    %       'read_close':  read current session (& open if none exists), close session on return
+    %       'open':  open new session, & return its handle (other open sessions stay open)
+    %		'close':  close & free session (Handle's, or current) & return
+    %       'read':  read session (Handle's, or current) (& open if none exists), replace existing parameters with non-empty passed parameters
+    %       'read_new':  close session (Handle's, or current), open & read new session
+    %       'read_close':  read session (Handle's, or current) (& open if none exists), close session on return
     %   Detrend:  subtract linear regression line (minimum absolute deviation) from each channel; specfied as [false] or true
     %   Ranges:  return minima & maxima traces of samples in each matrix column contributing to output samples; specfied as [false] or true
     %   Extrema:  return minima & maxima of matrix output channels; specfied as [false] or true
@@ -86,6 +86,12 @@ function [mat, mps] = matrix_MED(varargin)
     %   Contigua:  return slice contigua; specfied as [false] or true
     %   ChanNames:  return array of channel names; specfied as [false] or true
     %   ChanFreqs:  return array of input channel sampling frequencies; specfied as [false] or true
+    %   Prefetch:  with a persistent session, build the likely next page in the background; specified as [false] or true
+    %   Handle:  persistent session to use, as returned by 'open' (also returned in mat.handle); specified as [empty] (current session) or handle
+    %   Timing:  return wall & CPU time of each stage of the call (in mat.timing); specified as [false] or true
+    %   RecordTypes:  return only records of these types; specified as [empty] (all types), type string (e.g. 'Seiz'), or cell array of type strings
+    %   RecordLimit:  return only the first records of the slice; specified as [empty] (all) or number of records
+    %   RecordFormat:  form of slice records; specified as ['struct'] (cell array of record structures) or 'table' (structure of record columns)
     %
     %
     %   NOTES:
@@ -97,6 +103,24 @@ function [mat, mps] = matrix_MED(varargin)
     %       d) if indices are used, index numbering begins at 1, per Matlab convention
     %       e) if the slice is defined by both time & indicies, time is used
     %
+    %   Session Handles:
+    %       a) several sessions can be open at once; pass the Handle of the one to read, along with its Data
+    %       b) least recently used sessions are closed when too many are open (or they use too much memory), & reopened from Data under the same handle when next read
+    %
+    %   Timing:
+    %       a) mat.timing.stages gives wall & CPU seconds of each stage (CPU includes worker threads), & mat.timing.wall & .cpu the whole call
+    %       b) samples are decoded, filtered, & resampled together (stage 'build_matrix'), so mat.timing.channels is empty, & bytes_read & blocks_decoded are those spanned by the slice
+    %       c) medlib decodes each page's blocks itself, so matrix_MED does not use (or fill) read_MED's decoded block cache
+    %
+    %   Record Queries:
+    %       a) with RecordTypes or RecordLimit, only the matching records are read (from an index of the session's records kept between calls), rather than all slice records
+    %       b) the index is rebuilt when the session's records change (e.g. by matrix_MED_exec(mps, 'add_record', ...))
+    %
+    %   Record Tables:
+    %       a) with RecordFormat 'table', mat.records is one structure of columns, a row per record in time order: start_index (in the matrix, -1: none), start_time, end_time (-1: none), type_code,
+    %          type_index (into types, a cell array of the type strings), version (major + minor / 1000), encryption, & text (note text, seizure & segment descriptions)
+    %       b) categorical(types(type_index)) gives a categorical type vector; other record fields (e.g. Epoc stages, Sgmt sample numbers) need 'struct'
+    %
     %   Matrix Sample Dimension: If define by both sample count & sampling frequency, count will be used
     %
     %   Time Mode: if padding is requested & discontinuit(ies) occur in the slice, limits are converted to absolute time for that read) 
@@ -197,6 +221,12 @@ function [mat, mps] = matrix_MED(varargin)
             mps.Contigua = 0;  % return slice contigua (in matrix frame): [false (0)] or true (1)
             mps.ChanNames = 0;  % return channnel names: [false (0)] or true (1)
             mps.ChanFreqs = 0;  % return channnel sampling frequencies: [false (0)] or true (1)
+            mps.Prefetch = 0;  % build next page ahead (persistent sessions): [false (0)] or true (1)
+            mps.Handle = [];  % persistent session handle (returned by 'open'): [empty (current session)] or handle
+            mps.Timing = 0;  % return per stage timing: [false (0)] or true (1)
+            mps.RecordTypes = [];  % record types to return: [empty (all)], type string, or cell array of type strings
+            mps.RecordLimit = [];  % maximum records to return: [empty (all)] or number
+            mps.RecordFormat = 0;  % record output format: ['struct' (0)] or 'table' (1)
         else
             mps.Data = [];  % required (MED session directory, or channel directories as cell array)
             mps.SampDimMode = 'count';  % matrix sample dimension mode: ['count'], or 'rate'
@@ -223,6 +253,12 @@ function [mat, mps] = matrix_MED(varargin)
             mps.Contigua = false;  % return slice contigua (in matrix frame): [false] or true
             mps.ChanNames = false;  % return channnel names: [false] or true
             mps.ChanFreqs = false;  % return channnel sampling frequencies: [false] or true
+            mps.Prefetch = false;  % build next page ahead (persistent sessions): [false] or true
+            mps.Handle = [];  % persistent session handle (returned by 'open'): [empty (current session)] or handle
+            mps.Timing = false;  % return per stage timing: [false] or true
+            mps.RecordTypes = [];  % record types to return: [empty (all)], type string, or cell array of type strings
+            mps.RecordLimit = [];  % maximum records to return: [empty (all)] or number
+            mps.RecordFormat = 'struct';  % record output format: ['struct'] or 'table'
         end
     end
 
@@ -296,6 +332,18 @@ function [mat, mps] = matrix_MED(varargin)
                 mps.ChanNames = value;
             case 'ChanFreqs'
                 mps.ChanFreqs = value;
+            case 'Prefetch'
+                mps.Prefetch = value;
+            case 'Handle'
+                mps.Handle = value;
+            case 'Timing'
+                mps.Timing = value;
+            case 'RecordTypes'
+                mps.RecordTypes = value;
+            case 'RecordLimit'
+                mps.RecordLimit = value;
+            case 'RecordFormat'
+                mps.RecordFormat = value;
         end
     end
 
@@ -664,6 +712,81 @@ function [mat, mps] = matrix_MED(varargin)
         return;
     end
 
+    % Prefetch
+    if (isfield(mps, 'Prefetch') == false)
+        mps.Prefetch = false;  % parameter structure from earlier version
+    end
+    mps.Prefetch = condition_logical(mps.Prefetch, false);
+    if (isnan(mps.Prefetch))
+        errordlg('''Prefetch'' options: true, false', 'Matrix MED');
+        return;
+    end
+
+    % Handle
+    if (isfield(mps, 'Handle') == false)
+        mps.Handle = [];  % parameter structure from earlier version
+    end
+    if (isempty(mps.Handle) == false)
+        if (isnumeric(mps.Handle) == false || isscalar(mps.Handle) == false || mps.Handle < 1)
+            errordlg('''Handle'' must be empty, or a handle returned by ''open''', 'Matrix MED');
+            return;
+        end
+    end
+
+    % Timing
+    if (isfield(mps, 'Timing') == false)
+        mps.Timing = false;  % parameter structure from earlier version
+    end
+    mps.Timing = condition_logical(mps.Timing, false);
+    if (isnan(mps.Timing))
+        errordlg('''Timing'' options: true, false', 'Matrix MED');
+        return;
+    end
+
+    % RecordTypes
+    if (isfield(mps, 'RecordTypes') == false)
+        mps.RecordTypes = [];  % parameter structure from earlier version
+    end
+    if (ischar(mps.RecordTypes) && isempty(mps.RecordTypes) == false)
+        mps.RecordTypes = {mps.RecordTypes};
+    end
+    if (isempty(mps.RecordTypes) == false)
+        if (iscellstr(mps.RecordTypes) == false || any(cellfun(@length, mps.RecordTypes) ~= 4))
+            errordlg('''RecordTypes'' must be empty, a four character record type string, or a cell array of them', 'Matrix MED');
+            return;
+        end
+    end
+
+    % RecordLimit
+    if (isfield(mps, 'RecordLimit') == false)
+        mps.RecordLimit = [];  % parameter structure from earlier version
+    end
+    if (isempty(mps.RecordLimit) == false)
+        if (isnumeric(mps.RecordLimit) == false || isscalar(mps.RecordLimit) == false || mps.RecordLimit < 1)
+            errordlg('''RecordLimit'' must be empty, or a positive number of records', 'Matrix MED');
+            return;
+        end
+        mps.RecordLimit = double(mps.RecordLimit);
+    end
+
+    % RecordFormat
+    if (isfield(mps, 'RecordFormat') == false)
+        mps.RecordFormat = 'struct';  % parameter structure from earlier version
+    end
+    mps.RecordFormat = condition_named_string(mps.RecordFormat, 'struct', 2);
+    if (isnan(mps.RecordFormat))
+        errordlg('''RecordFormat'' must be a string, char array, index, or empty', 'Matrix MED');  % empty OK
+        return;
+    end
+    if (ischar(mps.RecordFormat))
+        switch (mps.RecordFormat)
+            case {'struct', 'table'}
+            otherwise
+                errordlg('''RecordFormat'' options: struct, table', 'Matrix MED');
+                return;
+        end
+    end
+
     % convert to numerical values where applicable
     if (NUMERIC_VALUES == true)
 
@@ -788,6 +911,16 @@ function [mat, mps] = matrix_MED(varargin)
                     mps.Persist = 6;
             end
         end
+
+        % RecordFormat
+        if (ischar(mps.RecordFormat))
+            switch (mps.RecordFormat)
+                case 'struct'
+                    mps.RecordFormat = 0;
+                case 'table'
+                    mps.RecordFormat = 1;
+            end
+        end
     end
 
     % Call mex function
@@ -3,28 +3,26 @@
 // Copyright Dark Horse Neuro Inc, 2021
 
 
+//******************************************************************************************************* Mex Compile Line ********************************************************************************************************//
+//****  mex COMPFLAGS='$COMPFLAGS -Wall -O3' matrix_MED_exec.c prefetch.c session_registry.c stage_timing.c record_journal.c record_merge.c record_edit.c record_args.c record_query.c record_table.c medlib_m12.c medrec_m12.c dhnlib_m12.c  ****//
+//*********************************************************************************************************************************************************************************************************************************//
+
+
 #include "matrix_MED_exec.h"
 
 // Globals
 static TERN_m12			loaded = FALSE_m12;
-static SESSION_m12		*med_session = NULL;
-static DATA_MATRIX_m12		*med_matrix = NULL;
+static PREFETCH_THREAD		prefetch_thread;  // background build of the predicted next page of the last session read
+static MATRIX_PREFETCH		prefetch_page;
 
 
 // Mex exit function
 void	mexExitFunction(void)
 {
-	// free session
-	if (med_session != NULL) {
-		G_free_session_m12(med_session, TRUE_m12);
-		med_session = NULL;
-	}
-		
-	// free matrix
-	if (med_matrix != NULL) {
-		DM_free_matrix_m12(med_matrix, TRUE_m12);
-		med_matrix = NULL;
-	}
+	// free sessions & matrices (& prefetch), & record indices
+	wait_prefetch(&prefetch_thread);
+	free_registry();
+	free_record_indices();
 
 	G_free_globals_m12(TRUE_m12);
 	
@@ -41,6 +39,7 @@ void    mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[])
         mxArray				*tmp_mxa, *mx_cell_p, *mat_matrix;
 	const mxArray			*mps;
 	C_MPS				cmps;
+	REGISTRY_ENTRY			*entry;
 
 	
 	// mex function status
@@ -49,28 +48,36 @@ void    mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[])
 		mexAtExit(mexExitFunction);
 		
 		// adjust process limits (called this way, these functions do not require medlib to be initialized)
-		PROC_adjust_open_file_limit_m12(MAX_OPEN_FILES_m12(MAX_CHANNELS, 1), FALSE_m12);
+		PROC_adjust_open_file_limit_m12(MAX_OPEN_FILES_m12(MAX_CHANNELS * REGISTRY_MAX_SESSIONS, 1), FALSE_m12);
 		PROC_increase_process_priority_m12(FALSE_m12, FALSE_m12);
 		
 		// initialize medlib
 		G_initialize_medlib_m12(FALSE_m12, FALSE_m12);
 		
+		// open sessions (& their matrices) are kept in the registry between calls
+		initialize_registry(free_registry_entry);
+		
 		loaded = TRUE_m12;
 	}
 	
 	//  check for proper number of arguments
 	if (nlhs != 1) {
-		if (nrhs != 1)
+		if (nrhs < 1)
 			mexErrMsgTxt("One input: matrix_MED parameter structure\nOne output: matrix_MED data structure\n");
 		else
 			mexErrMsgTxt("One output: matrix_MED data structure\n");
 	}
 	plhs[0] = mxCreateLogicalScalar((mxLogical) 0);  // set "false" return value for any subsequent errors
-	if (nrhs != 1)
+	if (nrhs < 1)
 		mexErrMsgTxt("One input: matrix_MED parameter structure\n");
+	if (nrhs > 1 && mxGetClassID(prhs[1]) != mxCHAR_CLASS)  // record edit command
+		mexErrMsgTxt("One input: matrix_MED parameter structure (or parameter structure, record command, & command arguments)\n");
 	mps = prhs[0];
 	if (mxIsStruct(mps) == 0)
 		mexErrMsgTxt("Input must be a matrix_MED parameter structure\n");
+	
+	// the prefetch thread (if any) uses the session globals, so it must finish before sessions are switched
+	wait_prefetch(&prefetch_thread);
 
 	// get persistence mode if passed
 	cmps.persist_mode = PERSIST_READ_CLOSE;  // default
@@ -108,19 +115,37 @@ void    mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[])
 		}
 	}
 
+	// get session handle (older parameter structures may not have this field)
+	cmps.handle = REGISTRY_NO_HANDLE;
+	if (mxGetNumberOfFields(mps) > MPS_HANDLE_IDX) {
+		tmp_mxa = mxGetFieldByNumber(mps, 0, MPS_HANDLE_IDX);
+		if (mxIsEmpty(tmp_mxa) == 0) {
+			tmp_si8 = get_si8_scalar(tmp_mxa);
+			if (tmp_si8 <= REGISTRY_NO_HANDLE || tmp_si8 > (si8) 0x7FFFFFFF)
+				mexErrMsgTxt("Invalid 'Handle'\n");
+			cmps.handle = (si4) tmp_si8;
+		}
+	}
+
+	// record edit commands: edit the records of the passed handle's (or current) session, without closing it (persistence mode is not used)
+	if (nrhs > 1) {
+		mxDestroyArray(plhs[0]);
+		plhs[0] = mxCreateDoubleScalar(edit_session_records(&cmps, nrhs - 1, prhs + 1));
+		return;
+	}
+
+	// close: passed handle's (or current) session; open: replaces passed handle's session ("read_new" without a handle replaces the current session)
 	if (cmps.persist_mode & PERSIST_OPEN || cmps.persist_mode == PERSIST_CLOSE) {
-		if (med_session != NULL) {  // free session
-			G_free_session_m12(med_session, TRUE_m12);
-			med_session = NULL;
-			if (cmps.persist_mode == PERSIST_CLOSE) {  // set return to "true" for session closed
-				mxDestroyArray(plhs[0]);  // no mex "set" function for logicals
-				plhs[0] = mxCreateLogicalScalar((mxLogical) 1);
+		if (cmps.handle != REGISTRY_NO_HANDLE || cmps.persist_mode != PERSIST_OPEN) {
+			entry = get_registry_entry(cmps.handle);
+			if (entry != NULL) {
+				unregister_session(entry);  // free session & matrix
+				if (cmps.persist_mode == PERSIST_CLOSE) {  // set return to "true" for session closed
+					mxDestroyArray(plhs[0]);  // no mex "set" function for logicals
+					plhs[0] = mxCreateLogicalScalar((mxLogical) 1);
+				}
 			}
 		}
-		if (med_matrix != NULL) {
-			DM_free_matrix_m12(med_matrix, TRUE_m12);
-			med_matrix = NULL;
-		}
 		if (cmps.persist_mode == PERSIST_CLOSE)
 			return;
 	}
@@ -574,6 +599,70 @@ void    mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[])
 			mexErrMsgTxt("'ChanFreqs' can be either true or false\n");
 	}
 
+	// get prefetch (older parameter structures may not have this field)
+	cmps.prefetch = FALSE_m12;
+	if (mxGetNumberOfFields(mps) > MPS_PREFETCH_IDX) {
+		tmp_mxa = mxGetFieldByNumber(mps, 0, MPS_PREFETCH_IDX);
+		if (mxIsEmpty(tmp_mxa) == 0) {
+			cmps.prefetch = get_logical(tmp_mxa);
+			if (cmps.prefetch == UNKNOWN_m12)
+				mexErrMsgTxt("'Prefetch' can be either true or false\n");
+		}
+	}
+
+	// get timing (older parameter structures may not have this field)
+	cmps.timing = FALSE_m12;
+	if (mxGetNumberOfFields(mps) > MPS_TIMING_IDX) {
+		tmp_mxa = mxGetFieldByNumber(mps, 0, MPS_TIMING_IDX);
+		if (mxIsEmpty(tmp_mxa) == 0) {
+			cmps.timing = get_logical(tmp_mxa);
+			if (cmps.timing == UNKNOWN_m12)
+				mexErrMsgTxt("'Timing' can be either true or false\n");
+		}
+	}
+
+	// get record query: types & limit (older parameter structures may not have these fields)
+	initialize_record_query(&cmps.record_query);
+	if (mxGetNumberOfFields(mps) > MPS_RECORD_TYPES_IDX) {
+		tmp_mxa = mxGetFieldByNumber(mps, 0, MPS_RECORD_TYPES_IDX);
+		if (mxIsEmpty(tmp_mxa) == 0)
+			get_record_types(tmp_mxa, &cmps.record_query);
+	}
+	if (mxGetNumberOfFields(mps) > MPS_RECORD_LIMIT_IDX) {
+		tmp_mxa = mxGetFieldByNumber(mps, 0, MPS_RECORD_LIMIT_IDX);
+		if (mxIsEmpty(tmp_mxa) == 0) {
+			cmps.record_query.limit = get_si8_scalar(tmp_mxa);
+			if (cmps.record_query.limit < 1)
+				mexErrMsgTxt("'RecordLimit' must be a positive number of records\n");
+		}
+	}
+
+	// record format (older parameter structures may not have this field)
+	cmps.record_format = RECORD_FORMAT_STRUCT;
+	if (mxGetNumberOfFields(mps) > MPS_RECORD_FORMAT_IDX) {
+		tmp_mxa = mxGetFieldByNumber(mps, 0, MPS_RECORD_FORMAT_IDX);
+		if (mxIsEmpty(tmp_mxa) == 0) {
+			if (mxGetClassID(tmp_mxa) == mxCHAR_CLASS) {
+				len = mxGetNumberOfElements(tmp_mxa) + 1;  // get the length of the input string
+				if (len <= 16)
+					mxGetString(tmp_mxa, temp_str, len);
+				else
+					mexErrMsgTxt("Invalid 'RecordFormat' type\n");
+				if (strcmp(temp_str, "struct") == 0)
+					cmps.record_format = RECORD_FORMAT_STRUCT;
+				else if (strcmp(temp_str, "table") == 0)
+					cmps.record_format = RECORD_FORMAT_TABLE;
+				else
+					mexErrMsgTxt("Invalid 'RecordFormat' type\n");
+			} else {
+				tmp_si8 = get_si8_scalar(tmp_mxa);
+				if (tmp_si8 < RECORD_FORMAT_STRUCT || tmp_si8 > RECORD_FORMAT_TABLE)
+					mexErrMsgTxt("Invalid 'RecordFormat' type\n");
+				cmps.record_format = (si4) tmp_si8;
+			}
+		}
+	}
+
 	// create input file list
 	cmps.MED_paths = NULL;
 	tmp_mxa = mxGetFieldByNumber(mps, 0, MPS_DATA_IDX);
@@ -602,28 +691,27 @@ void    mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[])
         mat_matrix = matrix_MED(&cmps);
 	if (mat_matrix != NULL) {
 		mxDestroyArray(plhs[0]);  // get rid of logical return value
-		// set status
-		if (cmps.persist_mode == PERSIST_READ_CLOSE)  // "close" handled on entry, returns logical true
-			tmp_mxa = mxCreateString("closed");
-		else
-			tmp_mxa = mxCreateString("open");
-		mxSetFieldByNumber(mat_matrix, 0, MATRIX_STATUS_IDX_mat, tmp_mxa);
+		// set status & handle ("open" returns the handle only)
+		if (mxIsStruct(mat_matrix)) {
+			if (cmps.persist_mode == PERSIST_READ_CLOSE) {  // "close" handled on entry, returns logical true
+				mxSetFieldByNumber(mat_matrix, 0, MATRIX_STATUS_IDX_mat, mxCreateString("closed"));
+			} else {
+				mxSetFieldByNumber(mat_matrix, 0, MATRIX_STATUS_IDX_mat, mxCreateString("open"));
+				mxSetFieldByNumber(mat_matrix, 0, MATRIX_HANDLE_IDX_mat, mxCreateDoubleScalar((sf8) cmps.handle));
+			}
+		}
 		plhs[0] = mat_matrix;
 	}
 
         // clean up
         free_m12((void *) cmps.MED_paths, __FUNCTION__);
-	if (med_matrix != NULL)
-		med_matrix->data = med_matrix->range_minima = med_matrix->range_maxima = NULL;  // this memory belongs Matlab structure, must be allocated with each call
-	if (cmps.persist_mode & PERSIST_CLOSE) {
-		if (med_session != NULL) {
-			G_free_session_m12(med_session, TRUE_m12);  // resets session globals (no not need to free until function unloaded)
-			med_session = NULL;
-		}
-		if (med_matrix != NULL) {
-			DM_free_matrix_m12(med_matrix, TRUE_m12);
-			med_matrix = NULL;
-		}
+	entry = get_registry_entry(REGISTRY_NO_HANDLE);  // session just read
+	if (entry != NULL) {
+		clear_matlab_pointers((DATA_MATRIX_m12 *) entry->client_data);  // this memory belongs Matlab structure, must be allocated with each call
+		if (cmps.persist_mode & PERSIST_CLOSE)
+			unregister_session(entry);  // resets session globals (no not need to free until function unloaded)
+		else if (cmps.prefetch == TRUE_m12 && mat_matrix != NULL && entry->client_data != NULL)
+			start_matrix_prefetch(&cmps, entry);  // build the likely next page while Matlab uses this one (after the Matlab owned pointers are cleared)
 	}
 
         return;
@@ -633,20 +721,25 @@ void    mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[])
 mxArray	*matrix_MED(C_MPS *cmps)
 {
 	si1			*action_str, time_str[TIME_STRING_BYTES_m12];
+	TERN_m12		prefetched, read_records;
 	si4			n_chans, seg_idx;
 	ui8			read_flags, matrix_flags;
 	si8			i, n_out_samps, el_size;
-	sf8			*in_samp_freqs, out_secs;
+	sf8			*in_samp_freqs;
 	TIME_SLICE_m12		*slice, local_slice;
 	SESSION_m12		*sess;
 	mxArray			*mat_matrix, *tmp_mxa;
 	mwSize			n_dims, dims[2];
 	mxClassID 		classid;
 	DATA_MATRIX_m12		*dm;
+	REGISTRY_ENTRY		*entry;
+	STAGE_TIMING		timing;
 	const si4		n_mat_matrix_fields = NUMBER_OF_MATRIX_FIELDS_mat;
 	const si1		*mat_matrix_field_names[] = MATRIX_FIELD_NAMES_mat;
 	
 	
+	initialize_stage_timing(&timing, cmps->timing);
+
 	// set limit pairs
 	if (cmps->start_time == UUTC_NO_ENTRY_m12 && cmps->end_time == UUTC_NO_ENTRY_m12) {
 		if (cmps->start_index == SAMPLE_NUMBER_NO_ENTRY_m12 && cmps->end_index == SAMPLE_NUMBER_NO_ENTRY_m12) {  // nothing passed, default to time
@@ -675,9 +768,331 @@ mxArray	*matrix_MED(C_MPS *cmps)
 	slice->end_sample_number = cmps->end_index;
 
 	// set matrix flags
-	n_out_samps = cmps->n_out_samps;
+	matrix_flags = get_matrix_flags(cmps);
+
+	// get session: open modes start a new one, others use the passed handle's (or current) session, or reopen it if closed or evicted
+	if (cmps->persist_mode & PERSIST_OPEN)
+		entry = NULL;
+	else
+		entry = get_registry_entry(cmps->handle);
+
+	// background build ahead (finished on entry): use it if it built this page of this session
+	prefetched = FALSE_m12;
+	if (prefetch_page.entry != NULL) {
+		if (prefetch_page.entry == entry && prefetch_page.ready == TRUE_m12 && same_page(&prefetch_page.cmps, cmps) == TRUE_m12) {
+			prefetched = TRUE_m12;
+		} else if (prefetch_page.build_failed == TRUE_m12) {
+			if (prefetch_page.entry == entry)
+				entry = NULL;  // reopened below
+			unregister_session(prefetch_page.entry);  // session & matrix state unknown
+		} else {
+			discard_prefetch();
+		}
+	}
+	if (entry == NULL) {
+		suspend_current_session();
+		sess = NULL;
+		dm = NULL;
+	} else {
+		sess = entry->sess;
+		dm = (DATA_MATRIX_m12 *) entry->client_data;
+	}
+	
+	// open / read session (persistent sessions are read by DM_get_matrix_m12())
+	begin_stage(&timing, "read_session");
+	read_flags = LH_READ_SLICE_SEGMENT_DATA_m12;
+	if (cmps->persist_mode & PERSIST_CLOSE) {
+		if (sess == NULL)
+			read_flags |= LH_NO_CPS_CACHING_m12;  // caching not efficient for single reads
+	} else {
+		read_flags |= LH_MAP_ALL_SEGMENTS_m12;  // more efficient for sequential reads
+	}
+	if (cmps->persist_mode == PERSIST_OPEN) {
+		sess = G_open_session_m12(NULL, slice, cmps->MED_paths, cmps->n_files, read_flags, cmps->password);
+		if (sess != NULL) {
+			entry = register_session(sess, NULL, cmps->handle);  // save session
+			cmps->handle = entry->handle;
+			return(mxCreateDoubleScalar((sf8) entry->handle));
+		}
+		action_str = "open";
+	} else if (sess == NULL) {  // PERSIST_READ, PERSIST_READ_CLOSE
+		sess = G_open_session_m12(NULL, slice, cmps->MED_paths, cmps->n_files, read_flags, cmps->password);
+		action_str = "read";
+	}
+	
+	if (sess == NULL) {
+		if (globals_m12->password_data.processed == 0) {
+			G_warning_message_m12("%s(): cannot %s session => no matching input files\n", __FUNCTION__, action_str);
+		} else {
+			if (*globals_m12->password_data.level_1_password_hint || *globals_m12->password_data.level_2_password_hint)
+				G_warning_message_m12("%s(): cannot %s session => check that the password is correct\n", __FUNCTION__, action_str);
+			else
+				G_warning_message_m12("%s(): cannot %s session => check that the password is correct, and that metadata files exist\n", __FUNCTION__, action_str);
+		}
+		if (entry != NULL)  // free session & matrix if exist
+			unregister_session(entry);
+		return(NULL);
+	}
+
+	// slice records are read by medlib, unless they are queried (only matching records are read, from the record index)
+	read_records = (cmps->records == TRUE_m12 && record_query_active(&cmps->record_query) == FALSE_m12) ? TRUE_m12 : FALSE_m12;
+	if (sess->flags & LH_READ_SLICE_ALL_RECORDS_m12) {
+		if (read_records == FALSE_m12) {
+			read_flags &= ~(LH_READ_SLICE_SESSION_RECORDS_m12 | LH_READ_SLICE_SEGMENTED_SESS_RECS_m12);
+			G_propogate_flags_m12((LEVEL_HEADER_m12 *) sess, read_flags);
+		}
+	} else if (read_records == TRUE_m12) {
+		read_flags |= (LH_READ_SLICE_SESSION_RECORDS_m12 | LH_READ_SLICE_SEGMENTED_SESS_RECS_m12);
+		G_propogate_flags_m12((LEVEL_HEADER_m12 *) sess, read_flags);
+	}
+
+	// Create matrix output structure
+	n_chans = sess->number_of_time_series_channels;
+	mat_matrix = mxCreateStructMatrix(1, 1, n_mat_matrix_fields, mat_matrix_field_names);
+	switch (matrix_flags & DM_TYPE_MASK_m12) {
+		case DM_TYPE_SF8_m12:
+			classid = mxDOUBLE_CLASS;
+			el_size = 8;
+			break;
+		case DM_TYPE_SF4_m12:
+			classid = mxSINGLE_CLASS;
+			el_size = 4;
+			break;
+		case DM_TYPE_SI4_m12:
+			classid = mxINT32_CLASS;
+			el_size = 4;
+			break;
+		case DM_TYPE_SI2_m12:
+			classid = mxINT16_CLASS;
+			el_size = 2;
+			break;
+	}
+
+	if (prefetched == TRUE_m12) {  // built by prefetch thread into Matlab memory: arrays adopt its buffers (no copy)
+		begin_stage(&timing, "adopt_prefetched");
+		n_out_samps = dm->sample_count;
+		tmp_mxa = adopt_matrix_array((mwSize) n_out_samps, (mwSize) n_chans, classid, &prefetch_page.data);
+		mxSetFieldByNumber(mat_matrix, (mwIndex) 0, (si4) MATRIX_SAMPLES_IDX_mat, tmp_mxa);
+		if (matrix_flags & DM_TRACE_RANGES_m12) {
+			tmp_mxa = adopt_matrix_array((mwSize) n_out_samps, (mwSize) n_chans, classid, &prefetch_page.range_minima);
+			mxSetFieldByNumber(mat_matrix, (mwIndex) 0, (si4) MATRIX_RANGE_MINIMA_IDX_mat, tmp_mxa);
+			tmp_mxa = adopt_matrix_array((mwSize) n_out_samps, (mwSize) n_chans, classid, &prefetch_page.range_maxima);
+			mxSetFieldByNumber(mat_matrix, (mwIndex) 0, (si4) MATRIX_RANGE_MAXIMA_IDX_mat, tmp_mxa);
+		}
+		if (matrix_flags & DM_TRACE_EXTREMA_m12) {
+			tmp_mxa = adopt_matrix_array((mwSize) n_chans, (mwSize) 1, classid, &prefetch_page.trace_minima);
+			mxSetFieldByNumber(mat_matrix, (mwIndex) 0, (si4) MATRIX_TRACE_MINIMA_IDX_mat, tmp_mxa);
+			tmp_mxa = adopt_matrix_array((mwSize) n_chans, (mwSize) 1, classid, &prefetch_page.trace_maxima);
+			mxSetFieldByNumber(mat_matrix, (mwIndex) 0, (si4) MATRIX_TRACE_MAXIMA_IDX_mat, tmp_mxa);
+		}
+		discard_prefetch();  // frees unused prefetch buffers
+	} else {
+		// Create DM matrix structure (decoding, filtering, & resampling are done by DM_get_matrix_m12(), so read_MED's decoded block cache is not used)
+		begin_stage(&timing, "build_matrix");
+		if (dm == NULL) {
+			dm = (DATA_MATRIX_m12 *) calloc_m12((size_t) 1, sizeof(DATA_MATRIX_m12), __FUNCTION__, USE_GLOBAL_BEHAVIOR_m12);
+			dm->el_size = el_size;
+		}
+
+		// allocate Matlab output
+		n_out_samps = output_sample_count(cmps, slice);
+		dims[0] = n_out_samps; dims[1] = n_chans; n_dims = 2;
+		tmp_mxa = mxCreateNumericArray(n_dims, dims, classid, mxREAL);
+		mxSetFieldByNumber(mat_matrix, (mwIndex) 0, (si4) MATRIX_SAMPLES_IDX_mat, tmp_mxa);
+		dm->data = (void *) mxGetPr(tmp_mxa);
+		if (matrix_flags & DM_TRACE_RANGES_m12) {
+			dims[0] = n_out_samps; dims[1] = n_chans; n_dims = 2;
+			tmp_mxa = mxCreateNumericArray(n_dims, dims, classid, mxREAL);
+			mxSetFieldByNumber(mat_matrix, (mwIndex) 0, (si4) MATRIX_RANGE_MINIMA_IDX_mat, tmp_mxa);
+			dm->range_minima = (void *) mxGetPr(tmp_mxa);
+			tmp_mxa = mxCreateNumericArray(n_dims, dims, classid, mxREAL);
+			mxSetFieldByNumber(mat_matrix, (mwIndex) 0, (si4) MATRIX_RANGE_MAXIMA_IDX_mat, tmp_mxa);
+			dm->range_maxima = (void *) mxGetPr(tmp_mxa);
+		}
+		if (matrix_flags & DM_TRACE_EXTREMA_m12) {
+			dims[0] = n_chans; dims[1] = 1; n_dims = 2;
+		 	tmp_mxa = mxCreateNumericArray(n_dims, dims, classid, mxREAL);
+			mxSetFieldByNumber(mat_matrix, (mwIndex) 0, (si4) MATRIX_TRACE_MINIMA_IDX_mat, tmp_mxa);
+			dm->trace_minima = (void *) mxGetPr(tmp_mxa);
+			tmp_mxa = mxCreateNumericArray(n_dims, dims, classid, mxREAL);
+			mxSetFieldByNumber(mat_matrix, (mwIndex) 0, (si4) MATRIX_TRACE_MAXIMA_IDX_mat, tmp_mxa);
+			dm->trace_maxima = (void *) mxGetPr(tmp_mxa);
+		}
+
+		set_matrix_parameters(dm, cmps, n_chans, n_out_samps, matrix_flags);
+
+		// Build matrix (dm is allocated, so it is filled in place)
+		if (DM_get_matrix_m12(dm, sess, slice, FALSE_m12) == NULL) {
+			G_warning_message_m12("\n%s():\nError generating matrix.\n", __FUNCTION__);
+			clear_matlab_pointers(dm);
+			if (entry == NULL) {
+				G_free_session_m12(sess, TRUE_m12);
+				DM_free_matrix_m12(dm, TRUE_m12);
+			} else {
+				entry->client_data = (void *) dm;
+				unregister_session(entry);  // session & matrix state unknown
+			}
+			mxDestroyArray(mat_matrix);
+			return(NULL);
+		}
+
+		// Adjust output Matlab array sizes, if necessary
+		if (dm->sample_count != n_out_samps) {
+			n_out_samps = dm->sample_count;
+			tmp_mxa = mxGetFieldByNumber(mat_matrix, (mwIndex) 0, (si4) MATRIX_SAMPLES_IDX_mat);
+			mxSetM(tmp_mxa, (mwSize) n_out_samps);
+			if (matrix_flags & DM_TRACE_RANGES_m12) {
+				tmp_mxa = mxGetFieldByNumber(mat_matrix, (mwIndex) 0, (si4) MATRIX_RANGE_MINIMA_IDX_mat);
+				mxSetM(tmp_mxa, (mwSize) n_out_samps);
+				tmp_mxa = mxGetFieldByNumber(mat_matrix, (mwIndex) 0, (si4) MATRIX_RANGE_MAXIMA_IDX_mat);
+				mxSetM(tmp_mxa, (mwSize) n_out_samps);
+			}
+			if (matrix_flags & DM_TRACE_EXTREMA_m12) {
+				tmp_mxa = mxGetFieldByNumber(mat_matrix, (mwIndex) 0, (si4) MATRIX_TRACE_MINIMA_IDX_mat);
+				mxSetM(tmp_mxa, (mwSize) n_out_samps);
+				tmp_mxa = mxGetFieldByNumber(mat_matrix, (mwIndex) 0, (si4) MATRIX_TRACE_MAXIMA_IDX_mat);
+				mxSetM(tmp_mxa, (mwSize) n_out_samps);
+			}
+		}
+	}
+
+	// Switch to returned slice
+	slice = &sess->time_slice;
+
+	// Build channel names (duplicated in metadata, but convenient for viewing
+	begin_stage(&timing, "build_metadata");
+	if (cmps->chan_names == TRUE_m12)
+		build_channel_names(sess, mat_matrix);
+	
+	// Build contigua
+	if (matrix_flags & DM_DSCNT_CONTIG_m12) {
+		begin_stage(&timing, "build_contigua");
+		build_contigua(dm, mat_matrix);
+	}
+	
+	// Build session records
+	if (cmps->records == TRUE_m12) {
+		begin_stage(&timing, "build_session_records");
+		if (record_query_active(&cmps->record_query) == TRUE_m12)
+			build_queried_records(sess, &cmps->record_query, dm, cmps->record_format, mat_matrix);
+		else
+			build_session_records(sess, dm, cmps->record_format, mat_matrix);
+	}
+
+	// Fill in filter cutoffs
+	begin_stage(&timing, "build_metadata");
+	dims[0] = 1; dims[1] = 1; n_dims = 2;
+	tmp_mxa = mxCreateNumericArray(n_dims, dims, mxDOUBLE_CLASS, mxREAL);
+	if (isnan(dm->filter_low_fc))
+		*((sf8 *) mxGetPr(tmp_mxa)) = (sf8) -1.0;
+	else
+		*((sf8 *) mxGetPr(tmp_mxa)) = dm->filter_low_fc;
+	mxSetFieldByNumber(mat_matrix, 0, MATRIX_FIELDS_FILTER_LOW_CUTOFF_IDX_mat, tmp_mxa);
+	tmp_mxa = mxCreateNumericArray(n_dims, dims, mxDOUBLE_CLASS, mxREAL);
+	if (isnan(dm->filter_high_fc))
+		*((sf8 *) mxGetPr(tmp_mxa)) = (sf8) -1.0;
+	else
+		*((sf8 *) mxGetPr(tmp_mxa)) = dm->filter_high_fc;
+	mxSetFieldByNumber(mat_matrix, 0, MATRIX_FIELDS_FILTER_HIGH_CUTOFF_IDX_mat, tmp_mxa);
+
+	// Fill in sampling frequencies
+	dims[0] = dims[1] = 1; n_dims = 2;
+	tmp_mxa = mxCreateNumericArray(n_dims, dims, mxDOUBLE_CLASS, mxREAL);
+	*((sf8 *) mxGetPr(tmp_mxa)) = dm->sampling_frequency;
+	mxSetFieldByNumber(mat_matrix, 0, MATRIX_FIELDS_MATRIX_SAMPLING_FREQUENCY_IDX_mat, tmp_mxa);
+	if (cmps->chan_freqs == TRUE_m12) {
+		dims[0] = n_chans; dims[1] = 1; n_dims = 2;
+		tmp_mxa = mxCreateNumericArray(n_dims, dims, mxDOUBLE_CLASS, mxREAL);
+		in_samp_freqs = (sf8 *) mxGetPr(tmp_mxa);
+		seg_idx = G_get_segment_index_m12(slice->start_segment_number);
+		for (i = 0; i < n_chans; ++i)
+			in_samp_freqs[i] = sess->time_series_channels[i]->segments[seg_idx]->metadata_fps->metadata->time_series_section_2.sampling_frequency;
+		mxSetFieldByNumber(mat_matrix, 0, MATRIX_FIELDS_CHANNEL_SAMPLING_FREQUENCIES_IDX_mat, tmp_mxa);
+	}
+
+	// Fill page times
+	dims[0] = 1; dims[1] = 1; n_dims = 2;
+	
+	// slice start time
+	tmp_mxa = mxCreateNumericArray(n_dims, dims, mxINT64_CLASS, mxREAL);
+	*((si8 *) mxGetPr(tmp_mxa)) = slice->start_time;
+	mxSetFieldByNumber(mat_matrix, 0, MATRIX_FIELDS_SLICE_START_TIME_IDX_mat, tmp_mxa);
+	// slice start time string
+	STR_time_string_m12(slice->start_time, time_str, TRUE_m12, FALSE_m12, FALSE_m12);
+	tmp_mxa = mxCreateString(time_str);
+	mxSetFieldByNumber(mat_matrix, 0, MATRIX_FIELDS_SLICE_START_TIME_STRING_IDX_mat, tmp_mxa);
+	// slice end time
+	tmp_mxa = mxCreateNumericArray(n_dims, dims, mxINT64_CLASS, mxREAL);
+	*((si8 *) mxGetPr(tmp_mxa)) = slice->end_time;
+	mxSetFieldByNumber(mat_matrix, 0, MATRIX_FIELDS_SLICE_END_TIME_IDX_mat, tmp_mxa);
+	// slice end time string
+	STR_time_string_m12(slice->end_time, time_str, TRUE_m12, FALSE_m12, FALSE_m12);
+	tmp_mxa = mxCreateString(time_str);
+	mxSetFieldByNumber(mat_matrix, 0, MATRIX_FIELDS_SLICE_END_TIME_STRING_IDX_mat, tmp_mxa);
+	
+	// save session & matrix (matrix working buffers scale with the page)
+	begin_stage(&timing, "save_session");
+	if (entry == NULL)
+		entry = register_session(sess, (void *) dm, cmps->handle);
+	entry->client_data = (void *) dm;
+	cmps->handle = entry->handle;
+	update_session_bytes(entry, (si8) dm->data_bytes);
+	
+	// timing (before build ahead starts)
+	if (cmps->timing == TRUE_m12) {
+		finish_stage_timing(&timing);
+		build_timing(&timing, sess, mat_matrix);
+	}
+
+       	return(mat_matrix);
+}
+
+
+// stage times are the calling thread's (CPU includes medlib's worker threads)
+// NOTE: medlib decodes inside DM_get_matrix_m12(), so there are no per channel times, & bytes_read & blocks_decoded are those spanned by the slice
+void	build_timing(STAGE_TIMING *st, SESSION_m12 *sess, mxArray *mat_matrix)
+{
+	si4			i;
+	mxArray			*mat_timing, *mat_stages;
+	const si4		n_mat_timing_fields = NUMBER_OF_TIMING_FIELDS_mat;
+	const si1		*mat_timing_field_names[] = TIMING_FIELD_NAMES_mat;
+	const si4		n_mat_stage_fields = NUMBER_OF_TIMING_STAGE_FIELDS_mat;
+	const si1		*mat_stage_field_names[] = TIMING_STAGE_FIELD_NAMES_mat;
+	const si4		n_mat_channel_fields = NUMBER_OF_TIMING_CHANNEL_FIELDS_mat;
+	const si1		*mat_channel_field_names[] = TIMING_CHANNEL_FIELD_NAMES_mat;
+
+
+	mat_timing = mxCreateStructMatrix(1, 1, n_mat_timing_fields, mat_timing_field_names);
+	mxSetFieldByNumber(mat_timing, 0, TIMING_FIELDS_WALL_IDX_mat, mxCreateDoubleScalar(st->wall));
+	mxSetFieldByNumber(mat_timing, 0, TIMING_FIELDS_CPU_IDX_mat, mxCreateDoubleScalar(st->cpu));
+
+	// stages
+	mat_stages = mxCreateStructMatrix(st->n_stages, 1, n_mat_stage_fields, mat_stage_field_names);
+	for (i = 0; i < st->n_stages; ++i) {
+		mxSetFieldByNumber(mat_stages, i, TIMING_STAGE_FIELDS_NAME_IDX_mat, mxCreateString(st->stages[i].name));
+		mxSetFieldByNumber(mat_stages, i, TIMING_STAGE_FIELDS_WALL_IDX_mat, mxCreateDoubleScalar(st->stages[i].wall));
+		mxSetFieldByNumber(mat_stages, i, TIMING_STAGE_FIELDS_CPU_IDX_mat, mxCreateDoubleScalar(st->stages[i].cpu));
+	}
+	mxSetFieldByNumber(mat_timing, 0, TIMING_FIELDS_STAGES_IDX_mat, mat_stages);
+
+	// slice totals (no channel entries)
+	mxSetFieldByNumber(mat_timing, 0, TIMING_FIELDS_CHANNELS_IDX_mat, mxCreateStructMatrix(0, 1, n_mat_channel_fields, mat_channel_field_names));
+	count_slice_blocks(sess, &st->bytes_read, &st->blocks_decoded);
+	mxSetFieldByNumber(mat_timing, 0, TIMING_FIELDS_BYTES_READ_IDX_mat, mxCreateDoubleScalar((sf8) st->bytes_read));
+	mxSetFieldByNumber(mat_timing, 0, TIMING_FIELDS_BLOCKS_DECODED_IDX_mat, mxCreateDoubleScalar((sf8) st->blocks_decoded));
+	mxSetFieldByNumber(mat_matrix, 0, MATRIX_TIMING_IDX_mat, mat_timing);
+
+	return;
+}
+
+
+ui8	get_matrix_flags(C_MPS *cmps)
+{
+	ui8	matrix_flags;
+
+
 	matrix_flags = DM_FMT_CHANNEL_MAJOR_m12;
-	if (n_out_samps)
+	if (cmps->n_out_samps)
 		matrix_flags |= DM_EXTMD_SAMP_COUNT_m12;
 	else
 		matrix_flags |= DM_EXTMD_SAMP_FREQ_m12;
@@ -775,90 +1190,19 @@ mxArray	*matrix_MED(C_MPS *cmps)
 			}
 			break;
 	}
-	
-	// copy globals
-	sess = med_session;
-	dm = med_matrix;
-	
-	// open / read session
-	read_flags = LH_READ_SLICE_SEGMENT_DATA_m12;
-	if (cmps->persist_mode & PERSIST_CLOSE) {
-		if (sess == NULL)
-			read_flags |= LH_NO_CPS_CACHING_m12;  // caching not efficient for single reads
-	} else {
-		read_flags |= LH_MAP_ALL_SEGMENTS_m12;  // more efficient for sequential reads
-	}
-	if (cmps->persist_mode == PERSIST_OPEN) {
-		sess = G_open_session_m12(NULL, slice, cmps->MED_paths, cmps->n_files, read_flags, cmps->password);
-		if (sess != NULL) {
-			med_session = sess;  // save session
-			return(mxCreateLogicalScalar((mxLogical) 1));
-		}
-		action_str = "open";
-	} else if (sess == NULL) {  // PERSIST_READ, PERSIST_READ_CLOSE
-		sess = G_open_session_m12(NULL, slice, cmps->MED_paths, cmps->n_files, read_flags, cmps->password);
-		action_str = "read";
-	}
-	
-	if (sess == NULL) {
-		if (globals_m12->password_data.processed == 0) {
-			G_warning_message_m12("%s(): cannot %s session => no matching input files\n", __FUNCTION__, action_str);
-		} else {
-			if (*globals_m12->password_data.level_1_password_hint || *globals_m12->password_data.level_2_password_hint)
-				G_warning_message_m12("%s(): cannot %s session => check that the password is correct\n", __FUNCTION__, action_str);
-			else
-				G_warning_message_m12("%s(): cannot %s session => check that the password is correct, and that metadata files exist\n", __FUNCTION__, action_str);
-		}
-		if (med_session != NULL) {  // free session if exists
-			G_free_session_m12(med_session, TRUE_m12);
-			med_session = NULL;
-		}
-		if (med_matrix != NULL) {  // free matrix if exists
-			DM_free_matrix_m12(med_matrix, TRUE_m12);
-			med_matrix = NULL;
-		}
-		return(NULL);
-	}
 
-	if (sess->flags & LH_READ_SLICE_ALL_RECORDS_m12) {
-		if (cmps->records == FALSE_m12) {
-			read_flags &= ~(LH_READ_SLICE_SESSION_RECORDS_m12 | LH_READ_SLICE_SEGMENTED_SESS_RECS_m12);
-			G_propogate_flags_m12((LEVEL_HEADER_m12 *) sess, read_flags);
-		}
-	} else if (cmps->records == TRUE_m12) {
-		read_flags |= (LH_READ_SLICE_SESSION_RECORDS_m12 | LH_READ_SLICE_SEGMENTED_SESS_RECS_m12);
-		G_propogate_flags_m12((LEVEL_HEADER_m12 *) sess, read_flags);
-	}
+	return(matrix_flags);
+}
 
-	// Create matrix output structure
-	n_chans = sess->number_of_time_series_channels;
-	mat_matrix = mxCreateStructMatrix(1, 1, n_mat_matrix_fields, mat_matrix_field_names);
-	switch (matrix_flags & DM_TYPE_MASK_m12) {
-		case DM_TYPE_SF8_m12:
-			classid = mxDOUBLE_CLASS;
-			el_size = 8;
-			break;
-		case DM_TYPE_SF4_m12:
-			classid = mxSINGLE_CLASS;
-			el_size = 4;
-			break;
-		case DM_TYPE_SI4_m12:
-			classid = mxINT32_CLASS;
-			el_size = 4;
-			break;
-		case DM_TYPE_SI2_m12:
-			classid = mxINT16_CLASS;
-			el_size = 2;
-			break;
-	}
 
-	// Create DM matrix structure
-	if (dm == NULL) {
-		dm = (DATA_MATRIX_m12 *) calloc_m12((size_t) 1, sizeof(DATA_MATRIX_m12), __FUNCTION__, USE_GLOBAL_BEHAVIOR_m12);
-		dm->el_size = el_size;
-	}
+// returns matrix sample dimension (DM_get_matrix_m12() may return fewer)
+si8	output_sample_count(C_MPS *cmps, TIME_SLICE_m12 *slice)
+{
+	si8	n_out_samps;
+	sf8	out_secs;
 
-	// allocate Matlab output
+
+	n_out_samps = cmps->n_out_samps;
 	if (n_out_samps == 0) {  // sample dimension specified by frequency
 		if (G_get_search_mode_m12(slice) == TIME_SEARCH_m12) {
 			out_secs = (sf8) TIME_SLICE_DURATION_m12(slice) / (sf8) 1000000.0;  // requested time in seconds
@@ -867,29 +1211,13 @@ mxArray	*matrix_MED(C_MPS *cmps)
 			n_out_samps = TIME_SLICE_SAMPLE_COUNT_m12(slice);
 		}
 	}
-	dims[0] = n_out_samps; dims[1] = n_chans; n_dims = 2;
-	tmp_mxa = mxCreateNumericArray(n_dims, dims, classid, mxREAL);
-	mxSetFieldByNumber(mat_matrix, (mwIndex) 0, (si4) MATRIX_SAMPLES_IDX_mat, tmp_mxa);
-	dm->data = (void *) mxGetPr(tmp_mxa);
-	if (matrix_flags & DM_TRACE_RANGES_m12) {
-		dims[0] = n_out_samps; dims[1] = n_chans; n_dims = 2;
-		tmp_mxa = mxCreateNumericArray(n_dims, dims, classid, mxREAL);
-		mxSetFieldByNumber(mat_matrix, (mwIndex) 0, (si4) MATRIX_RANGE_MINIMA_IDX_mat, tmp_mxa);
-		dm->range_minima = (void *) mxGetPr(tmp_mxa);
-		tmp_mxa = mxCreateNumericArray(n_dims, dims, classid, mxREAL);
-		mxSetFieldByNumber(mat_matrix, (mwIndex) 0, (si4) MATRIX_RANGE_MAXIMA_IDX_mat, tmp_mxa);
-		dm->range_maxima = (void *) mxGetPr(tmp_mxa);
-	}
-	if (matrix_flags & DM_TRACE_EXTREMA_m12) {
-		dims[0] = n_chans; dims[1] = 1; n_dims = 2;
-	 	tmp_mxa = mxCreateNumericArray(n_dims, dims, classid, mxREAL);
-		mxSetFieldByNumber(mat_matrix, (mwIndex) 0, (si4) MATRIX_TRACE_MINIMA_IDX_mat, tmp_mxa);
-		dm->trace_minima = (void *) mxGetPr(tmp_mxa);
-		tmp_mxa = mxCreateNumericArray(n_dims, dims, classid, mxREAL);
-		mxSetFieldByNumber(mat_matrix, (mwIndex) 0, (si4) MATRIX_TRACE_MAXIMA_IDX_mat, tmp_mxa);
-		dm->trace_maxima = (void *) mxGetPr(tmp_mxa);
-	}
 
+	return(n_out_samps);
+}
+
+
+void	set_matrix_parameters(DATA_MATRIX_m12 *dm, C_MPS *cmps, si4 n_chans, si8 n_out_samps, ui8 matrix_flags)
+{
 	dm->channel_count = n_chans;
 	dm->sample_count = n_out_samps;
 	dm->sampling_frequency = cmps->out_freq;
@@ -912,103 +1240,264 @@ mxArray	*matrix_MED(C_MPS *cmps)
 		}
 	}
 
-	// Build matrix
-	dm = DM_get_matrix_m12(dm, sess, slice, FALSE_m12);
-	if (dm == NULL) {
-		G_warning_message_m12("\n%s():\nError generating matrix.\n", __FUNCTION__);
-		mexExitFunction();
-		return(NULL);
+
+	return;
+}
+
+
+// creates a Matlab array that adopts an mxMalloced buffer (*buffer is set to NULL: owned by the array)
+mxArray	*adopt_matrix_array(mwSize n_rows, mwSize n_cols, mxClassID classid, void **buffer)
+{
+	mxArray		*mx_arr;
+
+
+	mx_arr = mxCreateNumericMatrix((mwSize) 0, (mwSize) 0, classid, mxREAL);
+	mxSetData(mx_arr, *buffer);
+	mxSetM(mx_arr, n_rows);
+	mxSetN(mx_arr, n_cols);
+	*buffer = NULL;
+
+	return(mx_arr);
+}
+
+
+// predicts the next page of a persistent session, & starts a prefetch thread building it
+void	start_matrix_prefetch(C_MPS *cmps, REGISTRY_ENTRY *entry)
+{
+	si4		units, n_chans;
+	si8		start, end, next_start, next_end, el_size;
+	TIME_SLICE_m12	slice;
+
+
+	if (cmps->start_index == SAMPLE_NUMBER_NO_ENTRY_m12) {
+		units = PAGE_UNITS_TIME;
+		start = cmps->start_time;
+		end = cmps->end_time;
+	} else {
+		units = PAGE_UNITS_INDICES;
+		start = cmps->start_index;
+		end = cmps->end_index;
 	}
+	if (predict_page(&entry->page_predictor, units, start, end, &next_start, &next_end) == FALSE_m12)
+		return;
+	if (units == PAGE_UNITS_TIME && next_start > globals_m12->session_end_time)  // past end of session
+		return;
 
-	// Adjust output Matlab array sizes, if necessary
-	if (dm->sample_count != n_out_samps) {
-		n_out_samps = dm->sample_count;
-		tmp_mxa = mxGetFieldByNumber(mat_matrix, (mwIndex) 0, (si4) MATRIX_SAMPLES_IDX_mat);
-		mxSetM(tmp_mxa, (mwSize) n_out_samps);
-		if (matrix_flags & DM_TRACE_RANGES_m12) {
-			tmp_mxa = mxGetFieldByNumber(mat_matrix, (mwIndex) 0, (si4) MATRIX_RANGE_MINIMA_IDX_mat);
-			mxSetM(tmp_mxa, (mwSize) n_out_samps);
-			tmp_mxa = mxGetFieldByNumber(mat_matrix, (mwIndex) 0, (si4) MATRIX_RANGE_MAXIMA_IDX_mat);
-			mxSetM(tmp_mxa, (mwSize) n_out_samps);
-		}
-		if (matrix_flags & DM_TRACE_EXTREMA_m12) {
-			tmp_mxa = mxGetFieldByNumber(mat_matrix, (mwIndex) 0, (si4) MATRIX_TRACE_MINIMA_IDX_mat);
-			mxSetM(tmp_mxa, (mwSize) n_out_samps);
-			tmp_mxa = mxGetFieldByNumber(mat_matrix, (mwIndex) 0, (si4) MATRIX_TRACE_MAXIMA_IDX_mat);
-			mxSetM(tmp_mxa, (mwSize) n_out_samps);
-		}
+	prefetch_page.cmps = *cmps;
+	prefetch_page.cmps.MED_paths = NULL;  // not owned (freed by caller)
+	prefetch_page.cmps.n_files = 0;
+	if (units == PAGE_UNITS_TIME) {
+		prefetch_page.cmps.start_time = next_start;
+		prefetch_page.cmps.end_time = next_end;
+	} else {
+		prefetch_page.cmps.start_index = next_start;
+		prefetch_page.cmps.end_index = next_end;
+	}
+	prefetch_page.entry = entry;
+	prefetch_page.matrix_flags = get_matrix_flags(cmps);
+	prefetch_page.ready = prefetch_page.build_failed = FALSE_m12;
+
+	// output buffers (mx functions only on this thread): handed to the Matlab arrays if the page is used
+	G_initialize_time_slice_m12(&slice);
+	slice.start_time = prefetch_page.cmps.start_time;
+	slice.end_time = prefetch_page.cmps.end_time;
+	slice.start_sample_number = prefetch_page.cmps.start_index;
+	slice.end_sample_number = prefetch_page.cmps.end_index;
+	prefetch_page.n_out_samps = output_sample_count(&prefetch_page.cmps, &slice);
+	n_chans = entry->sess->number_of_time_series_channels;
+	el_size = ((DATA_MATRIX_m12 *) entry->client_data)->el_size;
+	prefetch_page.data = new_prefetch_buffer(prefetch_page.n_out_samps * n_chans * el_size);
+	if (prefetch_page.matrix_flags & DM_TRACE_RANGES_m12) {
+		prefetch_page.range_minima = new_prefetch_buffer(prefetch_page.n_out_samps * n_chans * el_size);
+		prefetch_page.range_maxima = new_prefetch_buffer(prefetch_page.n_out_samps * n_chans * el_size);
 	}
+	if (prefetch_page.matrix_flags & DM_TRACE_EXTREMA_m12) {
+		prefetch_page.trace_minima = new_prefetch_buffer(n_chans * el_size);
+		prefetch_page.trace_maxima = new_prefetch_buffer(n_chans * el_size);
+	}
+	launch_prefetch(&prefetch_thread, matrix_prefetch_thread, (void *) &prefetch_page);
 
-	// Switch to returned slice
-	slice = &sess->time_slice;
+	return;
+}
 
-	// Build channel names (duplicated in metadata, but convenient for viewing
-	if (cmps->chan_names == TRUE_m12)
-		build_channel_names(sess, mat_matrix);
-	
-	// Build contigua
-	if (matrix_flags & DM_DSCNT_CONTIG_m12)
-		build_contigua(dm, mat_matrix);
-	
-	// Build session records
-	if (cmps->records == TRUE_m12)
-		build_session_records(sess, dm, mat_matrix);
 
-	// Fill in filter cutoffs
-	dims[0] = 1; dims[1] = 1; n_dims = 2;
-	tmp_mxa = mxCreateNumericArray(n_dims, dims, mxDOUBLE_CLASS, mxREAL);
-	if (isnan(dm->filter_low_fc))
-		*((sf8 *) mxGetPr(tmp_mxa)) = (sf8) -1.0;
-	else
-		*((sf8 *) mxGetPr(tmp_mxa)) = dm->filter_low_fc;
-	mxSetFieldByNumber(mat_matrix, 0, MATRIX_FIELDS_FILTER_LOW_CUTOFF_IDX_mat, tmp_mxa);
-	tmp_mxa = mxCreateNumericArray(n_dims, dims, mxDOUBLE_CLASS, mxREAL);
-	if (isnan(dm->filter_high_fc))
-		*((sf8 *) mxGetPr(tmp_mxa)) = (sf8) -1.0;
+// allocates a prefetch output buffer that outlives this call (adopted by a Matlab array, or freed by discard_prefetch())
+void	*new_prefetch_buffer(si8 n_bytes)
+{
+	void	*buffer;
+
+
+	buffer = mxMalloc((size_t) n_bytes);
+	mexMakeMemoryPersistent(buffer);
+
+	return(buffer);
+}
+
+
+// builds the predicted page into the buffers allocated by the calling thread (no mx functions in this thread)
+// NOTE: the calling thread is back in Matlab, & waits for this thread before touching any session or matrix
+pthread_rval_m12	matrix_prefetch_thread(void *ptr)
+{
+	TIME_SLICE_m12		slice;
+	DATA_MATRIX_m12		*dm;
+	MATRIX_PREFETCH		*pf;
+	PROC_THREAD_INFO_m12	*pi;
+
+
+	pi = (PROC_THREAD_INFO_m12 *) ptr;
+	pi->status = PROC_THREAD_RUNNING_m12;  // volatile
+
+	pf = (MATRIX_PREFETCH *) pi->arg;
+	G_initialize_time_slice_m12(&slice);
+	slice.start_time = pf->cmps.start_time;
+	slice.end_time = pf->cmps.end_time;
+	slice.start_sample_number = pf->cmps.start_index;
+	slice.end_sample_number = pf->cmps.end_index;
+
+	// output buffers (sized for the page by the calling thread)
+	dm = (DATA_MATRIX_m12 *) pf->entry->client_data;
+	set_matrix_parameters(dm, &pf->cmps, pf->entry->sess->number_of_time_series_channels, pf->n_out_samps, pf->matrix_flags);
+	dm->data = pf->data;
+	dm->range_minima = pf->range_minima;
+	dm->range_maxima = pf->range_maxima;
+	dm->trace_minima = pf->trace_minima;
+	dm->trace_maxima = pf->trace_maxima;
+
+	// build matrix
+	if (DM_get_matrix_m12(dm, pf->entry->sess, &slice, FALSE_m12) == NULL)
+		pf->build_failed = TRUE_m12;
 	else
-		*((sf8 *) mxGetPr(tmp_mxa)) = dm->filter_high_fc;
-	mxSetFieldByNumber(mat_matrix, 0, MATRIX_FIELDS_FILTER_HIGH_CUTOFF_IDX_mat, tmp_mxa);
+		pf->ready = TRUE_m12;
 
-	// Fill in sampling frequencies
-	dims[0] = dims[1] = 1; n_dims = 2;
-	tmp_mxa = mxCreateNumericArray(n_dims, dims, mxDOUBLE_CLASS, mxREAL);
-	*((sf8 *) mxGetPr(tmp_mxa)) = dm->sampling_frequency;
-	mxSetFieldByNumber(mat_matrix, 0, MATRIX_FIELDS_MATRIX_SAMPLING_FREQUENCY_IDX_mat, tmp_mxa);
-	if (cmps->chan_freqs == TRUE_m12) {
-		dims[0] = n_chans; dims[1] = 1; n_dims = 2;
-		tmp_mxa = mxCreateNumericArray(n_dims, dims, mxDOUBLE_CLASS, mxREAL);
-		in_samp_freqs = (sf8 *) mxGetPr(tmp_mxa);
-		seg_idx = G_get_segment_index_m12(slice->start_segment_number);
-		for (i = 0; i < n_chans; ++i)
-			in_samp_freqs[i] = sess->time_series_channels[i]->segments[seg_idx]->metadata_fps->metadata->time_series_section_2.sampling_frequency;
-		mxSetFieldByNumber(mat_matrix, 0, MATRIX_FIELDS_CHANNEL_SAMPLING_FREQUENCIES_IDX_mat, tmp_mxa);
+	pi->status = PROC_THREAD_FINISHED_m12;  // volatile
+
+	return((pthread_rval_m12) 0);
+}
+
+
+// returns TRUE_m12 if the two parameter structures request the same matrix
+TERN_m12	same_page(C_MPS *cmps_1, C_MPS *cmps_2)
+{
+	if (cmps_1->start_time != cmps_2->start_time || cmps_1->end_time != cmps_2->end_time)
+		return(FALSE_m12);
+	if (cmps_1->start_index != cmps_2->start_index || cmps_1->end_index != cmps_2->end_index)
+		return(FALSE_m12);
+	if (get_matrix_flags(cmps_1) != get_matrix_flags(cmps_2))  // format, filter, padding, interpolation, & trace options
+		return(FALSE_m12);
+	if (cmps_1->n_out_samps != cmps_2->n_out_samps || cmps_1->out_freq != cmps_2->out_freq || cmps_1->scale != cmps_2->scale)
+		return(FALSE_m12);
+	if (cmps_1->low_cutoff != cmps_2->low_cutoff || cmps_1->high_cutoff != cmps_2->high_cutoff)
+		return(FALSE_m12);
+	if (cmps_1->records != cmps_2->records || strcmp(cmps_1->index_channel, cmps_2->index_channel))
+		return(FALSE_m12);
+	if (record_query_active(&cmps_1->record_query) != record_query_active(&cmps_2->record_query))  // slice records read or not
+		return(FALSE_m12);
+
+	return(TRUE_m12);
+}
+
+
+// waits for prefetch thread, & frees its buffers (those not adopted by Matlab arrays)
+void	discard_prefetch(void)
+{
+	wait_prefetch(&prefetch_thread);
+	if (prefetch_page.entry != NULL)  // matrix must not keep (or free) them
+		clear_matlab_pointers((DATA_MATRIX_m12 *) prefetch_page.entry->client_data);
+	if (prefetch_page.data != NULL)
+		mxFree(prefetch_page.data);
+	if (prefetch_page.range_minima != NULL)
+		mxFree(prefetch_page.range_minima);
+	if (prefetch_page.range_maxima != NULL)
+		mxFree(prefetch_page.range_maxima);
+	if (prefetch_page.trace_minima != NULL)
+		mxFree(prefetch_page.trace_minima);
+	if (prefetch_page.trace_maxima != NULL)
+		mxFree(prefetch_page.trace_maxima);
+	prefetch_page.data = prefetch_page.range_minima = prefetch_page.range_maxima = prefetch_page.trace_minima = prefetch_page.trace_maxima = NULL;
+	prefetch_page.ready = prefetch_page.build_failed = FALSE_m12;
+	prefetch_page.entry = NULL;
+
+	return;
+}
+
+
+// success = matrix_MED_exec(mps, 'add_record', rec_type(s), rec_time(s), rec_text(s), encryption_level(s))
+// success = matrix_MED_exec(mps, 'delete_record', rec_time, rec_type_code)
+// edits the records of a persistent session (record_edit.c): the session stays open, & only the edited segment's record files are released if its
+// journal is compacted. Returns 0 on success, -1 on failure (or if there is no open session), -2 if the password does not give access.
+// The session's record fps hold its record files, & every read of the session merges the journals with them, so the next read (of any page) returns
+// the edit. A prefetched page of the session was read before the edit (& may use record files compaction released), so it is discarded.
+sf8	edit_session_records(C_MPS *cmps, si4 n_args, const mxArray *args[])
+{
+	si1		command[32], message[RECORD_ARGS_MESSAGE_BYTES];
+	si8		n_recs;
+	sf8		success;
+	NEW_RECORD	*recs;
+	REGISTRY_ENTRY	*entry;
+
+
+	recs = NULL;
+	mxGetString(args[0], command, 32);
+	if (strcmp(command, "add_record") == 0) {
+		if (n_args != 5)
+			mexErrMsgTxt("'add_record' arguments: rec_type(s), rec_time(s), rec_text(s), encryption_level(s)\n");
+		recs = get_new_records(args[1], args[2], args[3], args[4], &n_recs, message);  // before the edit, so argument errors can't leave a partial edit
+		if (recs == NULL)
+			mexErrMsgTxt(message);
+	} else if (strcmp(command, "delete_record") == 0) {
+		if (n_args != 3)
+			mexErrMsgTxt("'delete_record' arguments: rec_time, rec_type_code\n");
+		if (mxIsEmpty(args[1]) == 1 || mxIsEmpty(args[2]) == 1)
+			mexErrMsgTxt("No record time or type code specified\n");
+	} else {
+		mexErrMsgTxt("Unrecognized record command\n");
 	}
 
-	// Fill page times
-	dims[0] = 1; dims[1] = 1; n_dims = 2;
-	
-	// slice start time
-	tmp_mxa = mxCreateNumericArray(n_dims, dims, mxINT64_CLASS, mxREAL);
-	*((si8 *) mxGetPr(tmp_mxa)) = slice->start_time;
-	mxSetFieldByNumber(mat_matrix, 0, MATRIX_FIELDS_SLICE_START_TIME_IDX_mat, tmp_mxa);
-	// slice start time string
-	STR_time_string_m12(slice->start_time, time_str, TRUE_m12, FALSE_m12, FALSE_m12);
-	tmp_mxa = mxCreateString(time_str);
-	mxSetFieldByNumber(mat_matrix, 0, MATRIX_FIELDS_SLICE_START_TIME_STRING_IDX_mat, tmp_mxa);
-	// slice end time
-	tmp_mxa = mxCreateNumericArray(n_dims, dims, mxINT64_CLASS, mxREAL);
-	*((si8 *) mxGetPr(tmp_mxa)) = slice->end_time;
-	mxSetFieldByNumber(mat_matrix, 0, MATRIX_FIELDS_SLICE_END_TIME_IDX_mat, tmp_mxa);
-	// slice end time string
-	STR_time_string_m12(slice->end_time, time_str, TRUE_m12, FALSE_m12, FALSE_m12);
-	tmp_mxa = mxCreateString(time_str);
-	mxSetFieldByNumber(mat_matrix, 0, MATRIX_FIELDS_SLICE_END_TIME_STRING_IDX_mat, tmp_mxa);
-	
-	// set globals
-	med_session = sess;
-	med_matrix = dm;
+	// session (restores its globals)
+	entry = get_registry_entry(cmps->handle);
+	if (entry == NULL) {
+		G_warning_message_m12("%s(): no open session to edit (use a 'Persist' mode to keep the session open)\n", __FUNCTION__);
+		if (recs != NULL)
+			free_new_records(recs, n_recs);
+		return(-1.0);
+	}
+	if (prefetch_page.entry == entry)
+		discard_prefetch();
 
-       	return(mat_matrix);
+	// delete
+	if (recs == NULL)
+		return(delete_session_record(entry->sess, get_si8_scalar(args[1]), (ui4) get_si8_scalar(args[2])));
+
+	// add
+	success = add_session_records(entry->sess, recs, n_recs);
+	free_new_records(recs, n_recs);
+
+	return(success);
+}
+
+
+// registry free function: frees a persistent session & its matrix (called with the session's globals restored)
+void	free_registry_entry(REGISTRY_ENTRY *entry)
+{
+	if (prefetch_page.entry == entry)
+		discard_prefetch();
+	G_free_session_m12(entry->sess, TRUE_m12);
+	if (entry->client_data != NULL)
+		DM_free_matrix_m12((DATA_MATRIX_m12 *) entry->client_data, TRUE_m12);
+
+	return;
+}
+
+
+// output arrays are Matlab's (or prefetch buffers): the matrix must not keep (or free) them
+void	clear_matlab_pointers(DATA_MATRIX_m12 *dm)
+{
+	if (dm == NULL)
+		return;
+
+	dm->data = dm->range_minima = dm->range_maxima = dm->trace_minima = dm->trace_maxima = NULL;
+
+	return;
 }
 
 
@@ -1098,92 +1587,72 @@ void	build_contigua(DATA_MATRIX_m12 *dm, mxArray *mat_matrix)
 }
 
 
-void    build_session_records(SESSION_m12 *sess, DATA_MATRIX_m12 *dm, mxArray *mat_matrix)
+void    build_session_records(SESSION_m12 *sess, DATA_MATRIX_m12 *dm, si4 record_format, mxArray *mat_matrix)
 {
-	si4				n_segs, seg_idx;
-	si8                     	i, j, k, n_items, tot_recs, n_recs;
-	ui1                     	*rd;
-	mxArray                 	*mat_records, *mat_record;
-	FILE_PROCESSING_STRUCT_m12	*rd_fps;
-	RECORD_HEADER_m12       	**rec_ptrs, *rh;
+	si8			i;
+	mxArray			*mat_records;
+	RECORD_HEADER_m12	*rh;
+	RECORD_MERGE		*rm;
+	RECORD_TABLE		rt;
 
-	
-	n_segs = sess->time_slice.number_of_segments;
-
-	// set up sorted records array
-	tot_recs = 0;
-	if (sess->record_data_fps != NULL && sess->record_indices_fps != NULL)
-		tot_recs = sess->record_data_fps->number_of_items;
-	if (sess->segmented_sess_recs != NULL) {
-		seg_idx = G_get_segment_index_m12(sess->time_slice.start_segment_number);
-		for (i = 0, j = seg_idx; i < n_segs; ++i, ++j) {
-			rd_fps = sess->segmented_sess_recs->record_data_fps[j];
-			if (rd_fps != NULL)
-				tot_recs += rd_fps->number_of_items;
-		}
-	}
-	if (tot_recs == 0)
-		return;
 
-	rec_ptrs = (RECORD_HEADER_m12 **) malloc((size_t) tot_recs * sizeof(RECORD_HEADER_m12 *));
-	if (rec_ptrs == NULL)
+	// record files are time ordered: merge them
+	rm = merge_session_records(sess);
+	if (rm->number_of_records == 0) {
+		free_record_merge(rm);
 		return;
-	n_recs = 0;
-	if (sess->record_data_fps != NULL) {
-		n_items = sess->record_data_fps->number_of_items;
-		rd = sess->record_data_fps->record_data;
-		for (i = 0; i < n_items; ++i) {
-			rh = (RECORD_HEADER_m12 *) rd;
-			switch (rh->type_code) {
-				// excluded types
-				case REC_Term_TYPE_CODE_m12:
-				case REC_SyLg_TYPE_CODE_m12:
-					break;
-				default:  // include all other record types
-					rec_ptrs[n_recs++] = rh;
-					break;
-			}
-			rd += rh->total_record_bytes;
-		}
 	}
-	if (sess->segmented_sess_recs != NULL) {
-		for (i = 0, j = seg_idx; i < n_segs; ++i, ++j) {
-			rd_fps = sess->segmented_sess_recs->record_data_fps[j];
-			if (rd_fps == NULL)
-				continue;
-			n_items = rd_fps->number_of_items;
-			rd = rd_fps->record_data;
-			for (k = 0; k < n_items; ++k) {
-				rh = (RECORD_HEADER_m12 *) rd;
-				switch (rh->type_code) {
-					// excluded types
-					case REC_Term_TYPE_CODE_m12:
-					case REC_SyLg_TYPE_CODE_m12:
-						break;
-					default:  // include all other record types
-						rec_ptrs[n_recs++] = rh;
-						break;
-				}
-				rd += rh->total_record_bytes;
-			}
+
+	// create matlab records
+	if (record_format == RECORD_FORMAT_TABLE) {
+		mat_records = create_record_table(rm->number_of_records, &rt, TRUE_m12);
+		for (i = 0; (rh = next_merged_record(rm)) != NULL; ++i) {
+			fill_record_table_row(&rt, i, rh);
+			rt.start_indices[i] = record_start_index(rh, dm);
 		}
+		finish_record_table(&rt);
+	} else {
+		mat_records = mxCreateCellMatrix(rm->number_of_records, 1);
+		for (i = 0; (rh = next_merged_record(rm)) != NULL; ++i)
+			mxSetCell(mat_records, i, fill_record(rh, dm));
 	}
-	if (n_recs == 0) {
-		free((void *) rec_ptrs);
-		return;
-	}
-	qsort((void *) rec_ptrs, n_recs, sizeof(RECORD_HEADER_m12 *), rec_compare);
-	
-	// create matlab records
-	mat_records = mxCreateCellMatrix(n_recs, 1);
 	mxSetFieldByNumber(mat_matrix, 0, MATRIX_FIELDS_RECORDS_IDX_mat, mat_records);
-	for (i = 0; i < n_recs; ++i) {
-		mat_record = fill_record(rec_ptrs[i], dm);
-		mxSetCell(mat_records, i, mat_record);
-	}
 
 	// clean up
-	free((void *) rec_ptrs);
+	free_record_merge(rm);
+
+	return;
+}
+
+
+// records of the slice matching the query's types & limit (only those records are read)
+void	build_queried_records(SESSION_m12 *sess, RECORD_QUERY *rq, DATA_MATRIX_m12 *dm, si4 record_format, mxArray *mat_matrix)
+{
+	si8			i;
+	mxArray			*mat_records;
+	RECORD_QUERY_RESULT	*res;
+	RECORD_TABLE		rt;
+
+
+	rq->start_time = sess->time_slice.start_time;
+	rq->end_time = sess->time_slice.end_time;
+	res = query_session_records(sess, rq);
+	if (res->number_of_records > 0) {
+		if (record_format == RECORD_FORMAT_TABLE) {
+			mat_records = create_record_table(res->number_of_records, &rt, TRUE_m12);
+			for (i = 0; i < res->number_of_records; ++i) {
+				fill_record_table_row(&rt, i, res->records[i]);
+				rt.start_indices[i] = record_start_index(res->records[i], dm);
+			}
+			finish_record_table(&rt);
+		} else {
+			mat_records = mxCreateCellMatrix(res->number_of_records, 1);
+			for (i = 0; i < res->number_of_records; ++i)
+				mxSetCell(mat_records, i, fill_record(res->records[i], dm));
+		}
+		mxSetFieldByNumber(mat_matrix, 0, MATRIX_FIELDS_RECORDS_IDX_mat, mat_records);
+	}
+	free_record_query_result(res);
 
 	return;
 }
@@ -1694,6 +2163,34 @@ mxArray	*fill_record(RECORD_HEADER_m12 *rh, DATA_MATRIX_m12 *dm)
 }
 
 
+// start index of a record in the matrix reference frame (RECORD_TABLE_NO_INDEX if not in the matrix)
+si8	record_start_index(RECORD_HEADER_m12 *rh, DATA_MATRIX_m12 *dm)
+{
+	si4			i;
+	si8			offset_samps, start_idx;
+	sf8			offset_secs;
+	CONTIGUON_m12		*contigua;
+
+
+	start_idx = RECORD_TABLE_NO_INDEX;
+	if (dm->flags & DM_DSCNT_CONTIG_m12) {
+		contigua = dm->contigua;
+		for (i = 0; i < dm->number_of_contigua; ++i)
+			if (rh->start_time <= contigua[i].end_time)
+				break;
+		if (i < dm->number_of_contigua) {
+			offset_secs = (sf8) (rh->start_time - contigua[i].start_time) / (sf8) 1e6;
+			offset_samps = (si8) round(offset_secs * dm->sampling_frequency);
+			start_idx = contigua[i].start_sample_number + offset_samps;
+			if (start_idx > dm->sample_count)
+				start_idx = RECORD_TABLE_NO_INDEX;
+		}
+	}
+
+	return(start_idx);
+}
+
+
 TERN_m12	get_logical(const mxArray *mx_arr)
 {
 	TERN_m12	val;
@@ -1755,27 +2252,3 @@ si8     get_si8_scalar(const mxArray *mx_arr)
         }
 }
 
-
-si4     rec_compare(const void *a, const void *b)
-{
-	si8			time_d;
-	RECORD_HEADER_m12	*rha, *rhb;
-	
-	
-	rha = *((RECORD_HEADER_m12 **) a);
-	rhb = *((RECORD_HEADER_m12 **) b);
-	time_d = rha->start_time - rhb->start_time;
-	
-	// sort by time
-	if (time_d > 0)
-		return(1);
-	if (time_d < 0)
-		return(-1);
-	
-	// if same time, sort by location in memory
-	if ((ui8) rha >= (ui8) rhb)
-		return(1);
-
-	return(-1);
-}
-
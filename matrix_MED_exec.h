@@ -7,6 +7,14 @@
 
 //Includes
 #include "medlib_m12.h"
+#include "prefetch.h"
+#include "session_registry.h"
+#include "stage_timing.h"
+#include "record_journal.h"
+#include "record_args.h"
+#include "record_query.h"
+#include "record_merge.h"
+#include "record_table.h"
 
 // Version (Read_MED package including matrix_MED)
 #define READ_MED_VER_MAJOR	((ui1) 1)
@@ -41,6 +49,12 @@
 #define MPS_CONTIGUA_IDX		22
 #define MPS_CHANNEL_NAMES_IDX		23
 #define MPS_CHANNEL_FREQUENCIES_IDX	24
+#define MPS_PREFETCH_IDX		25
+#define MPS_HANDLE_IDX			26
+#define MPS_TIMING_IDX			27
+#define MPS_RECORD_TYPES_IDX		28
+#define MPS_RECORD_LIMIT_IDX		29
+#define MPS_RECORD_FORMAT_IDX		30
 
 // Sample Dimension Modes
 #define SAMPLE_DIMENSION_MODE_COUNT		0
@@ -68,6 +82,10 @@
 #define	FORMAT_INT32		2
 #define	FORMAT_INT16		3
 
+// Record Formats
+#define RECORD_FORMAT_STRUCT	0  // cell array of record structures
+#define RECORD_FORMAT_TABLE	1  // structure of record columns
+
 // Padding
 #define PAD_NONE		0
 #define PAD_ZERO		1
@@ -89,14 +107,14 @@
 
 // Persistence
 #define PERSIST_NONE		((ui1) 0)	// read current session (& open if none exists), close after read
-#define PERSIST_OPEN		((ui1) 1)	// close & free any open session, open new session, & return
-#define PERSIST_CLOSE		((ui1) 2)	// close & free any open session & return
-#define PERSIST_READ		((ui1) 4)	// read current session (& open if none exists), replace existing parameters with non-empty passed parameters
-#define PERSIST_READ_NEW	(PERSIST_READ | PERSIST_OPEN)	// close & free any open session, open & read new session, leave open after read
-#define PERSIST_READ_CLOSE	(PERSIST_READ | PERSIST_CLOSE)	// read current session (& open if none exists), close after read
+#define PERSIST_OPEN		((ui1) 1)	// open new session (replacing passed handle's session), & return its handle
+#define PERSIST_CLOSE		((ui1) 2)	// close & free passed handle's (or current) session & return
+#define PERSIST_READ		((ui1) 4)	// read passed handle's (or current) session (& open if none exists), replace existing parameters with non-empty passed parameters
+#define PERSIST_READ_NEW	(PERSIST_READ | PERSIST_OPEN)	// close & free passed handle's (or current) session, open & read new session, leave open after read
+#define PERSIST_READ_CLOSE	(PERSIST_READ | PERSIST_CLOSE)	// read passed handle's (or current) session (& open if none exists), close after read
 
 // Matlab Matrix Structure
-#define NUMBER_OF_MATRIX_FIELDS_mat				17
+#define NUMBER_OF_MATRIX_FIELDS_mat				19
 #define MATRIX_FIELD_NAMES_mat { \
         "slice_start_time", \
 	"slice_start_time_string", \
@@ -114,7 +132,9 @@
 	"range_maxima", \
 	"trace_minima", \
 	"trace_maxima", \
-	"status" \
+	"status", \
+	"handle", \
+	"timing" \
 }
 #define MATRIX_FIELDS_SLICE_START_TIME_IDX_mat			0
 #define MATRIX_FIELDS_SLICE_START_TIME_STRING_IDX_mat		1
@@ -133,6 +153,8 @@
 #define MATRIX_TRACE_MINIMA_IDX_mat				14
 #define MATRIX_TRACE_MAXIMA_IDX_mat				15
 #define MATRIX_STATUS_IDX_mat					16
+#define MATRIX_HANDLE_IDX_mat					17
+#define MATRIX_TIMING_IDX_mat					18
 
 // Matlab Contiguon Structure (note indices here are relative to output page)
 #define NUMBER_OF_CONTIGUON_FIELDS_mat          	6
@@ -330,14 +352,16 @@
 #define UNKN_RECORD_FIELDS_COMMENT_IDX_mat	8
 
 typedef struct {
-	TERN_m12			detrend, ranges, extrema, records, contigua, chan_names, chan_freqs;
+	TERN_m12			detrend, ranges, extrema, records, contigua, chan_names, chan_freqs, prefetch, timing;
 	ui1				persist_mode;
+	si4				handle;  // session registry handle (REGISTRY_NO_HANDLE: current session)
 	void				*MED_paths;
 	si1				password[PASSWORD_BYTES_m12], index_channel[BASE_FILE_NAME_BYTES_m12];
-	si4				n_files, filter, format, padding, interpolation, bin_interpolation;
+	si4				n_files, filter, format, padding, interpolation, bin_interpolation, record_format;
 	si4				sample_dimension_mode, extents_mode, time_mode;
 	si8				start_time, end_time, start_index, end_index, n_out_samps;
 	sf8				out_freq, low_cutoff, high_cutoff, scale;
+	RECORD_QUERY			record_query;  // types & limit (window is the slice)
 } C_MPS;
 
 typedef struct {
@@ -355,14 +379,38 @@ typedef struct {
 	sf8		*maxs;
 } MATRIX_THREAD_INFO;
 
+typedef struct {
+	C_MPS				cmps;  // predicted page (MED_paths not used)
+	REGISTRY_ENTRY			*entry;  // session & matrix built (NULL: no prefetch)
+	ui8				matrix_flags;
+	si8				n_out_samps;  // buffer capacity (per channel)
+	TERN_m12			ready;  // matrix built
+	TERN_m12			build_failed;  // session & matrix state unknown
+	void				*data, *range_minima, *range_maxima, *trace_minima, *trace_maxima;  // mxMalloced (persistent) on the calling thread, adopted by Matlab arrays (NULL once adopted)
+} MATRIX_PREFETCH;
+
 // Prototypes
 void		mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[]);
 mxArray		*matrix_MED(C_MPS *cmps);
+ui8		get_matrix_flags(C_MPS *cmps);
+si8		output_sample_count(C_MPS *cmps, TIME_SLICE_m12 *slice);
+void		set_matrix_parameters(DATA_MATRIX_m12 *dm, C_MPS *cmps, si4 n_chans, si8 n_out_samps, ui8 matrix_flags);
+mxArray		*adopt_matrix_array(mwSize n_rows, mwSize n_cols, mxClassID classid, void **buffer);
+void		start_matrix_prefetch(C_MPS *cmps, REGISTRY_ENTRY *entry);
+void		*new_prefetch_buffer(si8 n_bytes);
+pthread_rval_m12	matrix_prefetch_thread(void *ptr);
+TERN_m12	same_page(C_MPS *cmps_1, C_MPS *cmps_2);
+void		discard_prefetch(void);
+sf8		edit_session_records(C_MPS *cmps, si4 n_args, const mxArray *args[]);
+void		free_registry_entry(REGISTRY_ENTRY *entry);
+void		clear_matlab_pointers(DATA_MATRIX_m12 *dm);
 void		build_channel_names(SESSION_m12 *sess, mxArray *mat_matrix);
 void		build_contigua(DATA_MATRIX_m12 *dm, mxArray *mat_raw_page);
-void		build_session_records(SESSION_m12 *sess, DATA_MATRIX_m12 *dm, mxArray *mat_raw_page);
+void		build_session_records(SESSION_m12 *sess, DATA_MATRIX_m12 *dm, si4 record_format, mxArray *mat_raw_page);
+void		build_queried_records(SESSION_m12 *sess, RECORD_QUERY *rq, DATA_MATRIX_m12 *dm, si4 record_format, mxArray *mat_matrix);
+void		build_timing(STAGE_TIMING *st, SESSION_m12 *sess, mxArray *mat_matrix);
 mxArray		*fill_record(RECORD_HEADER_m12 *rh, DATA_MATRIX_m12 *dm);
-si4		rec_compare(const void *a, const void *b);
+si8		record_start_index(RECORD_HEADER_m12 *rh, DATA_MATRIX_m12 *dm);
 TERN_m12	get_logical(const mxArray *mx_arr);
 si8		get_si8_scalar(const mxArray *mx_arr);
 
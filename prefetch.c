@@ -0,0 +1,77 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Background read-ahead for persistent sessions
+// After a page is returned, a prefetch thread reads the predicted next page while Matlab is busy with the current one.
+// Sessions are not thread safe, so every mex call waits for the prefetch thread before touching its session (a matching request then has nothing left to do).
+// Prefetch threads must not call mx functions: results go to malloced buffers, & are copied into Matlab arrays by the calling thread.
+
+
+#include "prefetch.h"
+
+
+// starts thread_f(thread_info) in the background (thread_f sets thread_info->status, & gets arg from thread_info->arg)
+void	launch_prefetch(PREFETCH_THREAD *pt, pthread_rval_m12 (*thread_f)(void *), void *arg)
+{
+	memset((void *) &pt->thread_info, 0, sizeof(PROC_THREAD_INFO_m12));
+	pt->thread_info.thread_f = thread_f;
+	pt->thread_info.thread_label = "prefetch";
+	pt->thread_info.priority = PROC_HIGH_PRIORITY_m12;
+	pt->thread_info.arg = arg;
+	PROC_distribute_jobs_m12(&pt->thread_info, 1, 0, FALSE_m12);  // no reserved cores, don't wait
+	pt->running = TRUE_m12;
+
+	return;
+}
+
+
+// returns when prefetch thread (if any) has finished
+void	wait_prefetch(PREFETCH_THREAD *pt)
+{
+	if (pt->running == FALSE_m12)
+		return;
+
+	pthread_join_m12(pt->thread_info.thread_id, NULL);
+	pt->running = FALSE_m12;
+
+	return;
+}
+
+
+// records page request & returns the likely next one: the same movement as the last (forward or backward, full or partial page), or the following page
+// returns FALSE_m12 for pages that cannot be paged from (open or session relative limits)
+TERN_m12	predict_page(PAGE_PREDICTOR *pp, si4 units, si8 start, si8 end, si8 *next_start, si8 *next_end)
+{
+	si8	step;
+
+
+	if (units == PAGE_UNITS_TIME) {
+		if (start <= 0 || end <= 0 || end == END_OF_TIME_m12) {  // open, unset, or session relative (negative) limits
+			pp->valid = FALSE_m12;
+			return(FALSE_m12);
+		}
+	} else {  // PAGE_UNITS_INDICES
+		if (end == END_OF_SAMPLE_NUMBERS_m12 || start == SAMPLE_NUMBER_NO_ENTRY_m12 || end == SAMPLE_NUMBER_NO_ENTRY_m12) {
+			pp->valid = FALSE_m12;
+			return(FALSE_m12);
+		}
+	}
+
+	step = (end - start) + 1;  // default: following page
+	if (pp->valid == TRUE_m12 && pp->units == units && (pp->end - pp->start) == (end - start) && start != pp->start)
+		step = start - pp->start;
+	pp->valid = TRUE_m12;
+	pp->units = units;
+	pp->start = start;
+	pp->end = end;
+	pp->step = step;
+
+	*next_start = start + step;
+	*next_end = end + step;
+	if (units == PAGE_UNITS_TIME && *next_start <= 0)  // would be session relative
+		return(FALSE_m12);
+	if (units == PAGE_UNITS_INDICES && *next_start < 0)
+		return(FALSE_m12);
+
+	return(TRUE_m12);
+}
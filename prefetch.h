@@ -0,0 +1,34 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+#ifndef PREFETCH_IN
+#define PREFETCH_IN
+
+// Includes
+#include "medlib_m12.h"
+
+// Page Units
+#define PAGE_UNITS_TIME		0
+#define PAGE_UNITS_INDICES	1
+
+// Prefetch Structures
+typedef struct {
+	PROC_THREAD_INFO_m12	thread_info;
+	TERN_m12		running;
+} PREFETCH_THREAD;
+
+typedef struct {
+	TERN_m12	valid;
+	si4		units;
+	si8		start, end;  // last page requested
+	si8		step;  // last page to page movement (signed)
+} PAGE_PREDICTOR;
+
+
+// Prototypes
+void			launch_prefetch(PREFETCH_THREAD *pt, pthread_rval_m12 (*thread_f)(void *), void *arg);
+void			wait_prefetch(PREFETCH_THREAD *pt);
+TERN_m12		predict_page(PAGE_PREDICTOR *pp, si4 units, si8 start, si8 end, si8 *next_start, si8 *next_end);
+
+
+#endif /* PREFETCH_IN */
@@ -42,7 +42,7 @@ function [slice, rps] = read_MED(varargin)
     %       ['double']:  8-byte signed float
     %       'single':  4-byte signed float
     %       'int32':  4-byte signed integer
-    %       'int16':  2-byte signed integer
+    %       'int16':  2-byte signed integer (samples outside its range are clipped, & a warning gives the number clipped)
     %   Filt specified as:
     %       ['none']:  no filtering
     %       'lowpass':  cutoff passed in HighCutOff (Hz)
@@ -53,14 +53,22 @@ function [slice, rps] = read_MED(varargin)
     %   HighCut: required for lowpass, bandpass, & bandstop filters
     %   Persist specified as:
 	%       ['none']:  single read behavior (identical to 'read close' below)
-	%       'open':  close any open session, open new session, & return
-	%       'close':  close & free any open session & return
-	%       'read':  read current session (& open if not)
-	%       'read_new':  close any open session, open & read new session
-	%       'read_close':  read current session (& open if not), close on return
+	%       'open':  open new session, & return its handle (other open sessions stay open)
+	%       'close':  close & free session (Handle's, or current) & return
+	%       'read':  read session (Handle's, or current) (& open if not)
+	%       'read_new':  close session (Handle's, or current), open & read new session
+	%       'read_close':  read session (Handle's, or current) (& open if not), close on return
     %   Metadata:  return slice session & channel metadata; specified as [true] or false
     %   Records:  return slice records; specified as [true] or false
     %   Contigua:  return slice contigua; specified as [true] or false
+    %   Prefetch:  with a persistent session, read the likely next page in the background; specified as true or [false]
+    %   Handle:  persistent session to use, as returned by 'open' (also returned in slice.handle); specified as [empty] (current session) or handle
+    %   BlockCache:  memory for decoded blocks kept between reads, in megabytes (0 disables); specified as [empty] (unchanged, initially 256) or megabytes
+    %   Timing:  return wall & CPU time of each stage of the read (in slice.timing); specified as true or [false]
+    %   RecordTypes:  return only records of these types; specified as [empty] (all types), type string (e.g. 'Seiz'), or cell array of type strings
+    %   RecordLimit:  return only the first records of the slice; specified as [empty] (all) or number of records
+    %   RecordFormat:  form of slice records; specified as ['struct'] (cell array of record structures) or 'table' (structure of record columns)
+    %   Stream:  with a persistent session & a filter, filter successive contiguous reads as one stream; specified as true or [false]
     %
     %
     %   NOTES:
@@ -72,6 +80,34 @@ function [slice, rps] = read_MED(varargin)
     %       d) if indices are used, index numbering begins at 1, per Matlab convention
     %       e) if the slice is defined by both time & indicies, time is used
     %
+    %   Session Handles:
+    %       a) several sessions can be open at once; pass the Handle of the one to read, along with its Data
+    %       b) least recently used sessions are closed when too many are open (or they use too much memory), & reopened from Data under the same handle when next read
+    %
+    %   Block Cache:
+    %       a) decoded blocks are kept between reads (of any session), so overlapping reads (e.g. zooming out & back in) do not decode them again
+    %       b) slice.block_cache reports the cache's hits, misses, & evictions since read_MED was loaded; raise BlockCache if evictions climb while re-reading
+    %       c) blocks of encrypted sessions are only reused by reads whose password gives access to them; matrix_MED does not use the cache (medlib decodes its pages)
+    %       d) blocks are decoded into the cache's storage, so caching costs no extra copy; for single reads of data that will not be read again, BlockCache = 0 decodes int32 blocks directly into the returned matrix
+    %
+    %   Timing:
+    %       a) slice.timing.stages gives wall & CPU seconds of each stage (CPU includes worker threads), & slice.timing.wall & .cpu the whole read
+    %       b) slice.timing.channels gives each channel's decode & filter seconds (summed over cores), & compressed bytes read & blocks decoded (cached blocks are neither)
+    %
+    %   Record Queries:
+    %       a) with RecordTypes or RecordLimit, only the matching records are read (from an index of the session's records kept between reads), rather than all slice records
+    %       b) the index is rebuilt when the session's records change (e.g. by add_record_exec() or delete_record_exec())
+    %
+    %   Record Tables:
+    %       a) with RecordFormat 'table', slice.records is one structure of columns, a row per record in time order: start_time, end_time (-1: none), type_code,
+    %          type_index (into types, a cell array of the type strings), version (major + minor / 1000), encryption, & text (note text, seizure & segment descriptions)
+    %       b) categorical(types(type_index)) gives a categorical type vector; other record fields (e.g. Epoc stages, Sgmt sample numbers) need 'struct'
+    %
+    %   Streaming:
+    %       a) by default a filtered read depends only on its own slice (each read is padded & filtered on its own)
+    %       b) with Stream true, a persistent session's read that continues the last one starts from its unfiltered end, & reads look ahead into their last
+    %          segment, so contiguous pages join without edge transients; the samples returned then depend on the session's previous reads
+    %
     %
     %   Copyright Dark Horse Neuro, 2021
 
@@ -157,6 +193,14 @@ function [slice, rps] = read_MED(varargin)
             rps.Metadata = 1;  % return slice session & channel metadata: [true (1)] or false (0)
             rps.Records = 1;  % return slice records: [true (1)] or false (0)
             rps.Contigua = 1;  % return slice contigua: [true (1)] or false (0)
+            rps.Prefetch = 0;  % read ahead next page (persistent sessions): true (1) or [false (0)]
+            rps.Handle = [];  % persistent session handle (returned by 'open'): [empty (current session)] or handle
+            rps.BlockCache = [];  % decoded block cache size in MB (0 disables): [empty (unchanged)] or megabytes
+            rps.Timing = 0;  % return per stage timing: true (1) or [false (0)]
+            rps.RecordTypes = [];  % record types to return: [empty (all)], type string, or cell array of type strings
+            rps.RecordLimit = [];  % maximum records to return: [empty (all)] or number
+            rps.RecordFormat = 0;  % record output format: ['struct' (0)] or 'table' (1)
+            rps.Stream = 0;  % filter contiguous reads as one stream (persistent sessions): true (1) or [false (0)]
         else
             rps.Data = [];  % required (MED session directory, or channel directories as cell array)
             rps.ExtMode = 'time';  % slice extents mode: ['time'] or 'indices'
@@ -172,6 +216,14 @@ function [slice, rps] = read_MED(varargin)
             rps.Metadata = true;  % return slice session & channel metadata: [true] or false
             rps.Records = true;  % return slice records: [true] or false
             rps.Contigua = true;  % return slice contigua: [true] or false
+            rps.Prefetch = false;  % read ahead next page (persistent sessions): true or [false]
+            rps.Handle = [];  % persistent session handle (returned by 'open'): [empty (current session)] or handle
+            rps.BlockCache = [];  % decoded block cache size in MB (0 disables): [empty (unchanged)] or megabytes
+            rps.Timing = false;  % return per stage timing: true or [false]
+            rps.RecordTypes = [];  % record types to return: [empty (all)], type string, or cell array of type strings
+            rps.RecordLimit = [];  % maximum records to return: [empty (all)] or number
+            rps.RecordFormat = 'struct';  % record output format: ['struct'] or 'table'
+            rps.Stream = false;  % filter contiguous reads as one stream (persistent sessions): true or [false]
         end
     end
 
@@ -225,6 +277,22 @@ function [slice, rps] = read_MED(varargin)
                 rps.Records = value;
             case 'Contigua'
                 rps.Contigua = value;
+            case 'Prefetch'
+                rps.Prefetch = value;
+            case 'Handle'
+                rps.Handle = value;
+            case 'BlockCache'
+                rps.BlockCache = value;
+            case 'Timing'
+                rps.Timing = value;
+            case 'RecordTypes'
+                rps.RecordTypes = value;
+            case 'RecordLimit'
+                rps.RecordLimit = value;
+            case 'RecordFormat'
+                rps.RecordFormat = value;
+            case 'Stream'
+                rps.Stream = value;
         end
     end
 
@@ -467,6 +535,103 @@ function [slice, rps] = read_MED(varargin)
         return;
     end
 
+    % Prefetch
+    if (isfield(rps, 'Prefetch') == false)
+        rps.Prefetch = false;  % parameter structure from earlier version
+    end
+    rps.Prefetch = condition_logical(rps.Prefetch, false);
+    if (isnan(rps.Prefetch))
+        errordlg('''Prefetch'' options: true, false', 'Read MED');
+        return;
+    end
+
+    % Handle
+    if (isfield(rps, 'Handle') == false)
+        rps.Handle = [];  % parameter structure from earlier version
+    end
+    if (isempty(rps.Handle) == false)
+        if (isnumeric(rps.Handle) == false || isscalar(rps.Handle) == false || rps.Handle < 1)
+            errordlg('''Handle'' must be empty, or a handle returned by ''open''', 'Read MED');
+            return;
+        end
+    end
+
+    % BlockCache
+    if (isfield(rps, 'BlockCache') == false)
+        rps.BlockCache = [];  % parameter structure from earlier version
+    end
+    if (isempty(rps.BlockCache) == false)
+        if (isnumeric(rps.BlockCache) == false || isscalar(rps.BlockCache) == false || rps.BlockCache < 0)
+            errordlg('''BlockCache'' must be empty, or a non-negative number of megabytes', 'Read MED');
+            return;
+        end
+        rps.BlockCache = double(rps.BlockCache);
+    end
+
+    % Timing
+    if (isfield(rps, 'Timing') == false)
+        rps.Timing = false;  % parameter structure from earlier version
+    end
+    rps.Timing = condition_logical(rps.Timing, false);
+    if (isnan(rps.Timing))
+        errordlg('''Timing'' options: true, false', 'Read MED');
+        return;
+    end
+
+    % RecordTypes
+    if (isfield(rps, 'RecordTypes') == false)
+        rps.RecordTypes = [];  % parameter structure from earlier version
+    end
+    if (ischar(rps.RecordTypes) && isempty(rps.RecordTypes) == false)
+        rps.RecordTypes = {rps.RecordTypes};
+    end
+    if (isempty(rps.RecordTypes) == false)
+        if (iscellstr(rps.RecordTypes) == false || any(cellfun(@length, rps.RecordTypes) ~= 4))
+            errordlg('''RecordTypes'' must be empty, a four character record type string, or a cell array of them', 'Read MED');
+            return;
+        end
+    end
+
+    % RecordLimit
+    if (isfield(rps, 'RecordLimit') == false)
+        rps.RecordLimit = [];  % parameter structure from earlier version
+    end
+    if (isempty(rps.RecordLimit) == false)
+        if (isnumeric(rps.RecordLimit) == false || isscalar(rps.RecordLimit) == false || rps.RecordLimit < 1)
+            errordlg('''RecordLimit'' must be empty, or a positive number of records', 'Read MED');
+            return;
+        end
+        rps.RecordLimit = double(rps.RecordLimit);
+    end
+
+    % RecordFormat
+    if (isfield(rps, 'RecordFormat') == false)
+        rps.RecordFormat = 'struct';  % parameter structure from earlier version
+    end
+    rps.RecordFormat = condition_named_string(rps.RecordFormat, 'struct', 2);
+    if (isnan(rps.RecordFormat))
+        errordlg('''RecordFormat'' must be a string, char array, index, or empty', 'Read MED');  % empty OK
+        return;
+    end
+    if (ischar(rps.RecordFormat))
+        switch (rps.RecordFormat)
+            case {'struct', 'table'}
+            otherwise
+                errordlg('''RecordFormat'' options: struct, table', 'Read MED');
+                return;
+        end
+    end
+
+    % Stream
+    if (isfield(rps, 'Stream') == false)
+        rps.Stream = false;  % parameter structure from earlier version
+    end
+    rps.Stream = condition_logical(rps.Stream, false);
+    if (isnan(rps.Stream))
+        errordlg('''Stream'' options: true, false', 'Read MED');
+        return;
+    end
+
     % convert to numerical values where applicable
     if (NUMERIC_VALUES == true)
 
@@ -527,6 +692,16 @@ function [slice, rps] = read_MED(varargin)
                     rps.Persist = 6;
             end
         end
+
+        % RecordFormat
+        if (ischar(rps.RecordFormat))
+            switch (rps.RecordFormat)
+                case 'struct'
+                    rps.RecordFormat = 0;
+                case 'table'
+                    rps.RecordFormat = 1;
+            end
+        end
     end
 
 
@@ -3,26 +3,33 @@
 // Copyright Dark Horse Neuro Inc, 2021
 
 
-//******************************************** Mex Compile Line *****************************************//
-//****  mex COMPFLAGS='$COMPFLAGS -Wall -O3' read_MED_exec.c medlib_m12.c medrec_m12.c dhnlib_m12.c  ****//
-//*******************************************************************************************************//
+//*********************************************************************************************************************** Mex Compile Line ************************************************************************************************************************//
+//****  mex COMPFLAGS='$COMPFLAGS -Wall -O3' read_MED_exec.c sample_conversion.c work_queue.c filter_cache.c prefetch.c session_registry.c block_cache.c stage_timing.c record_journal.c record_merge.c record_query.c record_table.c medlib_m12.c medrec_m12.c dhnlib_m12.c  ****//
+//*****************************************************************************************************************************************************************************************************************************************************************//
 
 
 #include "read_MED_exec.h"
 
 // Globals
 static TERN_m12			loaded = FALSE_m12;
-static SESSION_m12		*med_sess = NULL;
+static FILT_STREAM		**filt_streams = NULL;  // streaming filter state of persistent sessions' channels
+static si4			n_filt_streams = 0;
+static PREFETCH_THREAD		prefetch_thread;  // background read of the predicted next page of the last session read
+static READ_PREFETCH		prefetch_page;
 
 
 // Mex exit function
 void	mexExitFunction(void)
 {
-	// free session
-	if (med_sess != NULL) {
-		G_free_session_m12(med_sess, TRUE_m12);
-		med_sess = NULL;
-	}
+	// free sessions (& prefetch & filter streams)
+	wait_prefetch(&prefetch_thread);
+	free_registry();
+	free_filter_streams(NULL);
+	
+	// free filter designs, decoded blocks, & record indices
+	free_filter_cache();
+	free_block_cache();
+	free_record_indices();
 	
 	// free globals (pid is preserved between mex calls)
 	G_free_globals_m12(TRUE_m12);
@@ -39,6 +46,7 @@ void    mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[])
         si8                     	tmp_si8;
 	const mxArray			*rps;
 	C_RPS				crps;
+	REGISTRY_ENTRY			*entry;
         mxArray                 	*tmp_mxa, *mx_cell_p, *mat_sess;
 
 	
@@ -48,12 +56,21 @@ void    mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[])
 		mexAtExit(mexExitFunction);
 		
 		// adjust process limits
-		PROC_adjust_open_file_limit_m12(MAX_OPEN_FILES_m12(MAX_CHANNELS, 1), FALSE_m12);
+		PROC_adjust_open_file_limit_m12(MAX_OPEN_FILES_m12(MAX_CHANNELS * REGISTRY_MAX_SESSIONS, 1), FALSE_m12);
 		PROC_increase_process_priority_m12(FALSE_m12, FALSE_m12);
 		
 		// initialze medlib
 		G_initialize_medlib_m12(FALSE_m12, FALSE_m12);
 		
+		// open sessions are kept in the registry between calls
+		initialize_registry(free_registry_entry);
+		
+		// decoded blocks are kept across calls & sessions
+		initialize_block_cache(BLOCK_CACHE_DEFAULT_BYTES);
+		
+		// select conversion kernels for this processor
+		initialize_conversion_kernels(CONVERSION_AVX512);
+		
 		loaded = TRUE_m12;
 	}
 	
@@ -70,6 +87,9 @@ void    mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[])
 	rps = prhs[0];
 	if (mxIsStruct(rps) == 0)
 		mexErrMsgTxt("Input must be a read_MED parameter structure\n");
+	
+	// the prefetch thread (if any) uses the session globals, so it must finish before sessions are switched
+	wait_prefetch(&prefetch_thread);
 
 	// get persistence mode if passed
 	crps.persist_mode = PERSIST_READ_CLOSE;  // default
@@ -107,13 +127,28 @@ void    mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[])
 		}
 	}
 
+	// get session handle (older parameter structures may not have this field)
+	crps.handle = REGISTRY_NO_HANDLE;
+	if (mxGetNumberOfFields(rps) > RPS_HANDLE_IDX) {
+		tmp_mxa = mxGetFieldByNumber(rps, 0, RPS_HANDLE_IDX);
+		if (mxIsEmpty(tmp_mxa) == 0) {
+			tmp_si8 = get_si8_scalar(tmp_mxa);
+			if (tmp_si8 <= REGISTRY_NO_HANDLE || tmp_si8 > (si8) 0x7FFFFFFF)
+				mexErrMsgTxt("Invalid 'Handle'\n");
+			crps.handle = (si4) tmp_si8;
+		}
+	}
+
+	// close: passed handle's (or current) session; open: replaces passed handle's session ("read_new" without a handle replaces the current session)
 	if (crps.persist_mode & PERSIST_OPEN || crps.persist_mode == PERSIST_CLOSE) {
-		if (med_sess != NULL) {  // free session
-			G_free_session_m12(med_sess, TRUE_m12);
-			med_sess = NULL;
-			if (crps.persist_mode == PERSIST_CLOSE) {  // set return to "true" for session closed
-				mxDestroyArray(plhs[0]);
-				plhs[0] = mxCreateLogicalScalar((mxLogical) 1);
+		if (crps.handle != REGISTRY_NO_HANDLE || crps.persist_mode != PERSIST_OPEN) {
+			entry = get_registry_entry(crps.handle);
+			if (entry != NULL) {  // free session
+				unregister_session(entry);
+				if (crps.persist_mode == PERSIST_CLOSE) {  // set return to "true" for session closed
+					mxDestroyArray(plhs[0]);
+					plhs[0] = mxCreateLogicalScalar((mxLogical) 1);
+				}
 			}
 		}
 		if (crps.persist_mode == PERSIST_CLOSE)
@@ -366,6 +401,91 @@ void    mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[])
 			mexErrMsgTxt("'Contigua' can be either true or false\n");
 	}
 
+	// prefetch (older parameter structures may not have this field)
+	crps.prefetch = FALSE_m12;
+	if (mxGetNumberOfFields(rps) > RPS_PREFETCH_IDX) {
+		tmp_mxa = mxGetFieldByNumber(rps, 0, RPS_PREFETCH_IDX);
+		if (mxIsEmpty(tmp_mxa) == 0) {
+			crps.prefetch = get_logical(tmp_mxa);
+			if (crps.prefetch == UNKNOWN_m12)
+				mexErrMsgTxt("'Prefetch' can be either true or false\n");
+		}
+	}
+
+	// block cache budget in MB (older parameter structures may not have this field, empty leaves budget unchanged)
+	if (mxGetNumberOfFields(rps) > RPS_BLOCK_CACHE_IDX) {
+		tmp_mxa = mxGetFieldByNumber(rps, 0, RPS_BLOCK_CACHE_IDX);
+		if (mxIsEmpty(tmp_mxa) == 0) {
+			if (mxIsNumeric(tmp_mxa) == 0 || mxGetScalar(tmp_mxa) < (sf8) 0.0)
+				mexErrMsgTxt("'BlockCache' must be a non-negative number of megabytes (0 disables the cache)\n");
+			set_block_cache_budget((si8) (mxGetScalar(tmp_mxa) * (sf8) ((si8) 1 << 20)));
+		}
+	}
+
+	// timing (older parameter structures may not have this field)
+	crps.timing = FALSE_m12;
+	if (mxGetNumberOfFields(rps) > RPS_TIMING_IDX) {
+		tmp_mxa = mxGetFieldByNumber(rps, 0, RPS_TIMING_IDX);
+		if (mxIsEmpty(tmp_mxa) == 0) {
+			crps.timing = get_logical(tmp_mxa);
+			if (crps.timing == UNKNOWN_m12)
+				mexErrMsgTxt("'Timing' can be either true or false\n");
+		}
+	}
+
+	// record query: types & limit (older parameter structures may not have these fields)
+	initialize_record_query(&crps.record_query);
+	if (mxGetNumberOfFields(rps) > RPS_RECORD_TYPES_IDX) {
+		tmp_mxa = mxGetFieldByNumber(rps, 0, RPS_RECORD_TYPES_IDX);
+		if (mxIsEmpty(tmp_mxa) == 0)
+			get_record_types(tmp_mxa, &crps.record_query);
+	}
+	if (mxGetNumberOfFields(rps) > RPS_RECORD_LIMIT_IDX) {
+		tmp_mxa = mxGetFieldByNumber(rps, 0, RPS_RECORD_LIMIT_IDX);
+		if (mxIsEmpty(tmp_mxa) == 0) {
+			crps.record_query.limit = get_si8_scalar(tmp_mxa);
+			if (crps.record_query.limit < 1)
+				mexErrMsgTxt("'RecordLimit' must be a positive number of records\n");
+		}
+	}
+
+	// record format (older parameter structures may not have this field)
+	crps.record_format = RECORD_FORMAT_STRUCT;
+	if (mxGetNumberOfFields(rps) > RPS_RECORD_FORMAT_IDX) {
+		tmp_mxa = mxGetFieldByNumber(rps, 0, RPS_RECORD_FORMAT_IDX);
+		if (mxIsEmpty(tmp_mxa) == 0) {
+			if (mxGetClassID(tmp_mxa) == mxCHAR_CLASS) {
+				len = mxGetNumberOfElements(tmp_mxa) + 1;  // get the length of the input string
+				if (len <= 16)
+					mxGetString(tmp_mxa, temp_str, len);
+				else
+					mexErrMsgTxt("Invalid 'RecordFormat' type\n");
+				if (strcmp(temp_str, "struct") == 0)
+					crps.record_format = RECORD_FORMAT_STRUCT;
+				else if (strcmp(temp_str, "table") == 0)
+					crps.record_format = RECORD_FORMAT_TABLE;
+				else
+					mexErrMsgTxt("Invalid 'RecordFormat' type\n");
+			} else {
+				tmp_si8 = get_si8_scalar(tmp_mxa);
+				if (tmp_si8 < RECORD_FORMAT_STRUCT || tmp_si8 > RECORD_FORMAT_TABLE)
+					mexErrMsgTxt("Invalid 'RecordFormat' type\n");
+				crps.record_format = (si4) tmp_si8;
+			}
+		}
+	}
+
+	// stream (older parameter structures may not have this field)
+	crps.stream = FALSE_m12;
+	if (mxGetNumberOfFields(rps) > RPS_STREAM_IDX) {
+		tmp_mxa = mxGetFieldByNumber(rps, 0, RPS_STREAM_IDX);
+		if (mxIsEmpty(tmp_mxa) == 0) {
+			crps.stream = get_logical(tmp_mxa);
+			if (crps.stream == UNKNOWN_m12)
+				mexErrMsgTxt("'Stream' can be either true or false\n");
+		}
+	}
+
 	// create input file list
 	crps.MED_paths = NULL;
 	tmp_mxa = mxGetFieldByNumber(rps, 0, RPS_DATA_IDX);
@@ -394,12 +514,15 @@ void    mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[])
 	mat_sess = read_MED(&crps);
 	if (mat_sess != NULL) {
 		mxDestroyArray(plhs[0]);
-		// set  status
-		if (crps.persist_mode == PERSIST_READ_CLOSE)  // "close" handled on entry, returns logical true
-			tmp_mxa = mxCreateString("closed");
-		else
-			tmp_mxa = mxCreateString("open");
-		mxSetFieldByNumber(mat_sess, 0, SESSION_FIELDS_STATUS_IDX_mat, tmp_mxa);
+		// set  status & handle ("open" returns the handle only)
+		if (mxIsStruct(mat_sess)) {
+			if (crps.persist_mode == PERSIST_READ_CLOSE) {  // "close" handled on entry, returns logical true
+				mxSetFieldByNumber(mat_sess, 0, SESSION_FIELDS_STATUS_IDX_mat, mxCreateString("closed"));
+			} else {
+				mxSetFieldByNumber(mat_sess, 0, SESSION_FIELDS_STATUS_IDX_mat, mxCreateString("open"));
+				mxSetFieldByNumber(mat_sess, 0, SESSION_FIELDS_HANDLE_IDX_mat, mxCreateDoubleScalar((sf8) crps.handle));
+			}
+		}
 		plhs[0] = mat_sess;
 	}
 
@@ -407,10 +530,9 @@ void    mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[])
 	free_m12(crps.MED_paths, __FUNCTION__);
 	
 	if (crps.persist_mode & PERSIST_CLOSE) {
-		if (med_sess != NULL) {
-			G_free_session_m12(med_sess, TRUE_m12);  // resets session globals (no not need to free until function unloaded)
-			med_sess = NULL;
-		}
+		entry = get_registry_entry(REGISTRY_NO_HANDLE);  // session just read
+		if (entry != NULL)
+			unregister_session(entry);  // resets session globals (no not need to free until function unloaded)
 	}
 	
         return;
@@ -420,14 +542,16 @@ void    mexFunction(si4 nlhs, mxArray *plhs[], si4 nrhs, const mxArray *prhs[])
 mxArray     *read_MED(C_RPS *crps)
 {
 	si1					*action_str;
-        si4                                     n_channels, n_active_channels;
+	TERN_m12				prefetched;
+        si4                                     n_channels, n_active_channels, n_jobs;
 	ui8                                     flags;
         si8                                     i, j;
 	TIME_SLICE_m12				slice;
         SESSION_m12                             *sess;
         CHANNEL_m12                             *chan;
 	JOB_INFO				*jobs;
-	PROC_THREAD_INFO_m12			*proc_thread_infos;
+	REGISTRY_ENTRY				*entry;
+	STAGE_TIMING				timing;
         mxArray                                 *mat_sess, *mat_chans;
         const si4                               n_mat_sess_fields = NUMBER_OF_SESSION_FIELDS_mat;
         const si1                               *mat_sess_field_names[] = SESSION_FIELD_NAMES_mat;
@@ -435,6 +559,8 @@ mxArray     *read_MED(C_RPS *crps)
         const si1                               *mat_channel_field_names[] = CHANNEL_FIELD_NAMES_mat;
 
 
+	initialize_stage_timing(&timing, crps->timing);
+
 	// set limit pairs
 	if (crps->start_time == UUTC_NO_ENTRY_m12 && crps->end_time == UUTC_NO_ENTRY_m12) {
 		if (crps->start_index == SAMPLE_NUMBER_NO_ENTRY_m12 && crps->end_index == SAMPLE_NUMBER_NO_ENTRY_m12) {  // nothing passed, default to time
@@ -454,8 +580,31 @@ mxArray     *read_MED(C_RPS *crps)
 		crps->start_index = crps->end_index = SAMPLE_NUMBER_NO_ENTRY_m12;  // time supersedes indices
 	}
 
-	// copy global
-	sess = med_sess;
+	// get session: open modes start a new one, others use the passed handle's (or current) session, or reopen it if closed or evicted
+	if (crps->persist_mode & PERSIST_OPEN)
+		entry = NULL;
+	else
+		entry = get_registry_entry(crps->handle);
+
+	// background read ahead (finished on entry): use it if it read this page of this session
+	prefetched = FALSE_m12;
+	if (prefetch_page.entry != NULL) {
+		if (prefetch_page.entry == entry && prefetch_page.ready == TRUE_m12 && same_page(&prefetch_page.crps, crps) == TRUE_m12) {
+			prefetched = TRUE_m12;
+		} else if (prefetch_page.read_failed == TRUE_m12) {
+			if (prefetch_page.entry == entry)
+				entry = NULL;  // reopened below
+			unregister_session(prefetch_page.entry);  // session state unknown
+		} else {
+			discard_prefetch();
+		}
+	}
+	if (entry == NULL) {
+		suspend_current_session();
+		sess = NULL;
+	} else {
+		sess = entry->sess;
+	}
 	
         // read session
         G_initialize_time_slice_m12(&slice);
@@ -465,19 +614,28 @@ mxArray     *read_MED(C_RPS *crps)
 	slice.end_sample_number = crps->end_index;
 	if (*crps->index_channel)
 		strcpy(globals_m12->reference_channel_name, crps->index_channel);
-	flags = (LH_READ_SLICE_SEGMENT_DATA_m12 | LH_READ_SLICE_SESSION_RECORDS_m12 | LH_READ_SLICE_SEGMENTED_SESS_RECS_m12);
+	flags = (LH_READ_SEGMENT_METADATA_m12 | LH_READ_SLICE_SESSION_RECORDS_m12 | LH_READ_SLICE_SEGMENTED_SESS_RECS_m12);  // sample data is decoded directly into the Matlab arrays
+	if (record_query_active(&crps->record_query) == TRUE_m12)
+		flags &= ~(LH_READ_SLICE_SESSION_RECORDS_m12 | LH_READ_SLICE_SEGMENTED_SESS_RECS_m12);  // only matching records are read (from the record index)
 	if (crps->persist_mode & PERSIST_CLOSE) {
-		if (med_sess == NULL)
+		if (sess == NULL)
 			flags |= LH_NO_CPS_CACHING_m12;  // not efficient for single reads
 	} else {
 		flags |= LH_MAP_ALL_SEGMENTS_m12;  // more efficient for sequential reads
 	}
 	    
-	if (crps->persist_mode == PERSIST_OPEN) {
+	if (sess != NULL && prefetched == FALSE_m12 && (sess->flags & LH_READ_SLICE_ALL_RECORDS_m12) != (flags & LH_READ_SLICE_ALL_RECORDS_m12))  // persistent session's records reading changed
+		G_propogate_flags_m12((LEVEL_HEADER_m12 *) sess, (sess->flags & ~LH_READ_SLICE_ALL_RECORDS_m12) | (flags & LH_READ_SLICE_ALL_RECORDS_m12));
+
+	begin_stage(&timing, "read_session");
+	if (prefetched == TRUE_m12) {
+		action_str = "read";  // session already read by prefetch thread
+	} else if (crps->persist_mode == PERSIST_OPEN) {
 		sess = G_open_session_m12(NULL, &slice, crps->MED_paths, crps->n_files, flags, crps->password);
 		if (sess != NULL) {
-			med_sess = sess;  // save session
-			return(mxCreateLogicalScalar((mxLogical) 1));
+			entry = register_session(sess, NULL, crps->handle);  // save session
+			crps->handle = entry->handle;
+			return(mxCreateDoubleScalar((sf8) entry->handle));
 		}
 		action_str = "open";
 	} else {
@@ -493,10 +651,8 @@ mxArray     *read_MED(C_RPS *crps)
 			else
 				G_warning_message_m12("%s():Cannot %s session => check that the password is correct, and that crps.metadata files exist\n", __FUNCTION__, action_str);
 		}
-		if (med_sess != NULL) {  // free session if exists
-			G_free_session_m12(med_sess, TRUE_m12);
-			med_sess = NULL;
-		}
+		if (entry != NULL)  // free session if exists
+			unregister_session(entry);
 		return(NULL);
 	}
 	
@@ -505,6 +661,7 @@ mxArray     *read_MED(C_RPS *crps)
         /* ****************************************** */
 
         // Create session output structure
+	begin_stage(&timing, "build_metadata");
         mat_sess = mxCreateStructMatrix(1, 1, n_mat_sess_fields, mat_sess_field_names);
 
         // Create channel output structures
@@ -525,32 +682,61 @@ mxArray     *read_MED(C_RPS *crps)
 		build_metadata(sess, mat_sess);
 
 	// Build contigua
-	if (crps->contigua == TRUE_m12)
+	if (crps->contigua == TRUE_m12) {
+		begin_stage(&timing, "build_contigua");
 		build_contigua(sess, mat_sess);
+	}
 	
 	// Build session records
-	if (crps->records == TRUE_m12)
-        	build_session_records(sess, mat_sess);
+	if (crps->records == TRUE_m12) {
+		begin_stage(&timing, "build_session_records");
+		if (record_query_active(&crps->record_query) == TRUE_m12)
+			build_queried_records(sess, &crps->record_query, crps->record_format, mat_sess);
+		else
+        		build_session_records(sess, crps->record_format, mat_sess);
+	}
+	end_stage(&timing);
 	
-	// set up distribution & filtering jobs
-	jobs = (JOB_INFO *) malloc((size_t) n_active_channels * sizeof(JOB_INFO));
-	proc_thread_infos = (PROC_THREAD_INFO_m12 *) calloc((size_t) n_active_channels, sizeof(PROC_THREAD_INFO_m12));
-	for (i = j = 0; i < n_channels; ++i) {
-		chan = sess->time_series_channels[i];
-		if ((chan->flags & LH_CHANNEL_ACTIVE_m12) == 0)
-			continue;
-		jobs[j].channel = chan;
-		jobs[j].crps = crps;
-		jobs[j].samples = NULL;
-		proc_thread_infos[j].thread_f = distribute_and_filter;
-		proc_thread_infos[j].thread_label = "distribute_and_filter";
-		proc_thread_infos[j].priority = PROC_HIGH_PRIORITY_m12;
-		proc_thread_infos[j].arg = (void *) (jobs + j);
-		++j;
+	// Build block cache counters (for tuning the budget)
+	build_block_cache_stats(mat_sess);
+	
+	// channel data (Matlab arrays are created here, not in the threads)
+	if (prefetched == TRUE_m12) {  // decoded by prefetch thread into Matlab memory: arrays adopt its buffers (no copy)
+		begin_stage(&timing, "adopt_prefetched");
+		jobs = prefetch_page.jobs;
+		n_jobs = prefetch_page.n_jobs;
+		prefetch_page.jobs = NULL;
+		prefetch_page.n_jobs = 0;
+		prefetch_page.ready = FALSE_m12;
+		prefetch_page.entry = NULL;
+		for (i = 0; i < n_jobs; ++i) {
+			if (jobs[i].out == NULL || prefetch_buffer_output(&prefetch_page, i, jobs[i].out) == TRUE_m12) {
+				jobs[i].samples = create_samples_array(0, jobs[i].crps->format);
+				if (jobs[i].out != NULL) {
+					mxSetData(jobs[i].samples, (void *) jobs[i].out);
+					mxSetM(jobs[i].samples, (mwSize) jobs[i].data_len);
+					prefetch_page.buffers[i] = NULL;  // owned by array
+				}
+			} else {  // page outgrew the channel's buffer: decoded into malloced memory
+				jobs[i].samples = create_samples_array(jobs[i].data_len, jobs[i].crps->format);
+				memcpy(mxGetData(jobs[i].samples), (void *) jobs[i].out, (size_t) jobs[i].data_len * format_element_size(jobs[i].crps->format));
+				free((void *) jobs[i].out);
+				jobs[i].out = (ui1 *) mxGetData(jobs[i].samples);
+			}
+		}
+		free_prefetch_buffers();  // unused ones
+	} else {
+		begin_stage(&timing, "decode_and_filter");
+		advance_filter_cache();
+		jobs = create_jobs(sess, crps, &n_jobs);
+		for (i = 0; i < n_jobs; ++i) {
+			jobs[i].samples = create_samples_array(jobs[i].data_len, crps->format);
+			jobs[i].out = (ui1 *) mxGetData(jobs[i].samples);
+		}
+		decode_jobs(jobs, n_jobs);
 	}
-
-	// thread out distrution & filtering
-	PROC_distribute_jobs_m12(proc_thread_infos, n_active_channels, 0, TRUE_m12);  // no reserved cores, wait for completion
+	for (i = 0; i < n_jobs; ++i)
+		update_filter_stream(jobs + i);
 
 	// assign data
 	for (i = j = 0; i < n_channels; ++i) {
@@ -560,14 +746,104 @@ mxArray     *read_MED(C_RPS *crps)
 		mxSetFieldByNumber(mat_chans, j, CHANNEL_FIELDS_DATA_IDX_mat, jobs[j].samples);
 		++j;
 	}
+
+	// report saturated samples (here, on the calling thread)
+	for (i = 0; i < n_jobs; ++i)
+		if (jobs[i].samples_clipped > 0)
+			G_warning_message_m12("%s(): %ld samples of channel \"%s\" are outside the range of the output format (clipped)\n", __FUNCTION__, (long) jobs[i].samples_clipped, jobs[i].channel->name);
+	
+	// save session (mapped segments grow with the pages read)
+	begin_stage(&timing, "save_session");
+	if (entry == NULL)
+		entry = register_session(sess, NULL, crps->handle);
+	else
+		update_session_bytes(entry, 0);
+	crps->handle = entry->handle;
+	
+	// timing (before read ahead starts)
+	if (crps->timing == TRUE_m12) {
+		finish_stage_timing(&timing);
+		build_timing(&timing, jobs, n_jobs, mat_sess);
+	}
+	free((void *) jobs);
 	
-	// set global
-	med_sess = sess;
+	// read ahead the likely next page while Matlab uses this one
+	if (crps->prefetch == TRUE_m12 && (crps->persist_mode & PERSIST_CLOSE) == 0)
+		start_read_prefetch(crps, flags, entry);
 
         return(mat_sess);
 }
 
 
+void	build_block_cache_stats(mxArray *mat_sess)
+{
+	BLOCK_CACHE_STATS	stats;
+	mxArray			*mat_stats;
+	const si4		n_mat_stats_fields = NUMBER_OF_BLOCK_CACHE_FIELDS_mat;
+	const si1		*mat_stats_field_names[] = BLOCK_CACHE_FIELD_NAMES_mat;
+
+
+	get_block_cache_stats(&stats);
+	mat_stats = mxCreateStructMatrix(1, 1, n_mat_stats_fields, mat_stats_field_names);
+	mxSetFieldByNumber(mat_stats, 0, BLOCK_CACHE_FIELDS_HITS_IDX_mat, mxCreateDoubleScalar((sf8) stats.hits));
+	mxSetFieldByNumber(mat_stats, 0, BLOCK_CACHE_FIELDS_MISSES_IDX_mat, mxCreateDoubleScalar((sf8) stats.misses));
+	mxSetFieldByNumber(mat_stats, 0, BLOCK_CACHE_FIELDS_EVICTIONS_IDX_mat, mxCreateDoubleScalar((sf8) stats.evictions));
+	mxSetFieldByNumber(mat_stats, 0, BLOCK_CACHE_FIELDS_BLOCKS_IDX_mat, mxCreateDoubleScalar((sf8) stats.n_blocks));
+	mxSetFieldByNumber(mat_stats, 0, BLOCK_CACHE_FIELDS_BYTES_IDX_mat, mxCreateDoubleScalar((sf8) stats.bytes));
+	mxSetFieldByNumber(mat_stats, 0, BLOCK_CACHE_FIELDS_BUDGET_IDX_mat, mxCreateDoubleScalar((sf8) stats.budget));
+	mxSetFieldByNumber(mat_sess, 0, SESSION_FIELDS_BLOCK_CACHE_IDX_mat, mat_stats);
+
+	return;
+}
+
+
+// stage times are the calling thread's, per channel decode & filter times are summed over worker tasks (exceed wall time when channels are split across cores)
+// NOTE: a prefetched page reports the per channel times & counts of its background decode
+void	build_timing(STAGE_TIMING *st, JOB_INFO *jobs, si4 n_jobs, mxArray *mat_sess)
+{
+	si4			i;
+	mxArray			*mat_timing, *mat_stages, *mat_chans;
+	const si4		n_mat_timing_fields = NUMBER_OF_TIMING_FIELDS_mat;
+	const si1		*mat_timing_field_names[] = TIMING_FIELD_NAMES_mat;
+	const si4		n_mat_stage_fields = NUMBER_OF_TIMING_STAGE_FIELDS_mat;
+	const si1		*mat_stage_field_names[] = TIMING_STAGE_FIELD_NAMES_mat;
+	const si4		n_mat_channel_fields = NUMBER_OF_TIMING_CHANNEL_FIELDS_mat;
+	const si1		*mat_channel_field_names[] = TIMING_CHANNEL_FIELD_NAMES_mat;
+
+
+	mat_timing = mxCreateStructMatrix(1, 1, n_mat_timing_fields, mat_timing_field_names);
+	mxSetFieldByNumber(mat_timing, 0, TIMING_FIELDS_WALL_IDX_mat, mxCreateDoubleScalar(st->wall));
+	mxSetFieldByNumber(mat_timing, 0, TIMING_FIELDS_CPU_IDX_mat, mxCreateDoubleScalar(st->cpu));
+
+	// stages
+	mat_stages = mxCreateStructMatrix(st->n_stages, 1, n_mat_stage_fields, mat_stage_field_names);
+	for (i = 0; i < st->n_stages; ++i) {
+		mxSetFieldByNumber(mat_stages, i, TIMING_STAGE_FIELDS_NAME_IDX_mat, mxCreateString(st->stages[i].name));
+		mxSetFieldByNumber(mat_stages, i, TIMING_STAGE_FIELDS_WALL_IDX_mat, mxCreateDoubleScalar(st->stages[i].wall));
+		mxSetFieldByNumber(mat_stages, i, TIMING_STAGE_FIELDS_CPU_IDX_mat, mxCreateDoubleScalar(st->stages[i].cpu));
+	}
+	mxSetFieldByNumber(mat_timing, 0, TIMING_FIELDS_STAGES_IDX_mat, mat_stages);
+
+	// channels
+	mat_chans = mxCreateStructMatrix(n_jobs, 1, n_mat_channel_fields, mat_channel_field_names);
+	for (i = 0; i < n_jobs; ++i) {
+		mxSetFieldByNumber(mat_chans, i, TIMING_CHANNEL_FIELDS_NAME_IDX_mat, mxCreateString(jobs[i].channel->name));
+		mxSetFieldByNumber(mat_chans, i, TIMING_CHANNEL_FIELDS_DECODE_IDX_mat, mxCreateDoubleScalar(jobs[i].decode_seconds));
+		mxSetFieldByNumber(mat_chans, i, TIMING_CHANNEL_FIELDS_FILTER_IDX_mat, mxCreateDoubleScalar(jobs[i].filter_seconds));
+		mxSetFieldByNumber(mat_chans, i, TIMING_CHANNEL_FIELDS_BYTES_READ_IDX_mat, mxCreateDoubleScalar((sf8) jobs[i].bytes_read));
+		mxSetFieldByNumber(mat_chans, i, TIMING_CHANNEL_FIELDS_BLOCKS_DECODED_IDX_mat, mxCreateDoubleScalar((sf8) jobs[i].blocks_decoded));
+		st->bytes_read += jobs[i].bytes_read;
+		st->blocks_decoded += jobs[i].blocks_decoded;
+	}
+	mxSetFieldByNumber(mat_timing, 0, TIMING_FIELDS_CHANNELS_IDX_mat, mat_chans);
+	mxSetFieldByNumber(mat_timing, 0, TIMING_FIELDS_BYTES_READ_IDX_mat, mxCreateDoubleScalar((sf8) st->bytes_read));
+	mxSetFieldByNumber(mat_timing, 0, TIMING_FIELDS_BLOCKS_DECODED_IDX_mat, mxCreateDoubleScalar((sf8) st->blocks_decoded));
+	mxSetFieldByNumber(mat_sess, 0, SESSION_FIELDS_TIMING_IDX_mat, mat_timing);
+
+	return;
+}
+
+
 // NOTE: this function assumes all discontinuities are session wide, which is not required by MED
 void	build_contigua(SESSION_m12 *sess, mxArray *mat_sess)
 {
@@ -1060,94 +1336,70 @@ void    build_metadata(SESSION_m12 *sess, mxArray *mat_sess)
 }
 
 
-void    build_session_records(SESSION_m12 *sess, mxArray *mat_sess)
+void    build_session_records(SESSION_m12 *sess, si4 record_format, mxArray *mat_sess)
 {
-	si4				n_segs, seg_idx;
-        si8                     	i, j, k, n_items, tot_recs, n_recs;
-        ui1                     	*rd;
-        mxArray                 	*mat_records, *mat_record;
-	FILE_PROCESSING_STRUCT_m12	*rd_fps;
-	RECORD_HEADER_m12       	**rec_ptrs, *rh;
+	si8			i;
+	mxArray			*mat_records;
+	RECORD_HEADER_m12	*rh;
+	RECORD_MERGE		*rm;
+	RECORD_TABLE		rt;
 
-        
-	n_segs = sess->time_slice.number_of_segments;
-        
-        // set up sorted records array
-        tot_recs = 0;
-        if (sess->record_data_fps != NULL && sess->record_indices_fps != NULL)
-                tot_recs = sess->record_data_fps->number_of_items;
-        if (sess->segmented_sess_recs != NULL) {
-		seg_idx = G_get_segment_index_m12(sess->time_slice.start_segment_number);
-		for (i = 0, j = seg_idx; i < n_segs; ++i, ++j) {
-			rd_fps = sess->segmented_sess_recs->record_data_fps[j];
-			if (rd_fps != NULL)
-                        	tot_recs += rd_fps->number_of_items;
-		}
-        }
-        if (tot_recs == 0)
-                return;
-	
-        rec_ptrs = (RECORD_HEADER_m12 **) malloc((size_t) tot_recs * sizeof(RECORD_HEADER_m12 *));
-	if (rec_ptrs == NULL)
+
+	// record files are time ordered: merge them
+	rm = merge_session_records(sess);
+	if (rm->number_of_records == 0) {
+		free_record_merge(rm);
 		return;
-        n_recs = 0;
-        if (sess->record_data_fps != NULL) {
-                n_items = sess->record_data_fps->number_of_items;
-                rd = sess->record_data_fps->record_data;
-                for (i = 0; i < n_items; ++i) {
-			rh = (RECORD_HEADER_m12 *) rd;
-			switch (rh->type_code) {
-				// excluded types
-				case REC_Term_TYPE_CODE_m12:
-				case REC_SyLg_TYPE_CODE_m12:
-					break;
-				default:  // include all other record types
-					rec_ptrs[n_recs++] = rh;
-					break;
-			}
-			rd += rh->total_record_bytes;
-                }
-        }
-        if (sess->segmented_sess_recs != NULL) {
-                for (i = 0, j = seg_idx; i < n_segs; ++i, ++j) {
-			rd_fps = sess->segmented_sess_recs->record_data_fps[j];
-			if (rd_fps == NULL)
-				continue;
-			n_items = rd_fps->number_of_items;
-                        rd = rd_fps->record_data;
-                        for (k = 0; k < n_items; ++k) {
-				rh = (RECORD_HEADER_m12 *) rd;
-				switch (rh->type_code) {
-					// excluded tyoes
-					case REC_Term_TYPE_CODE_m12:
-					case REC_SyLg_TYPE_CODE_m12:
-						break;
-					default:  // include all other record types
-						rec_ptrs[n_recs++] = rh;
-						break;
-				}
-				rd += rh->total_record_bytes;
-                        }
-                }
-        }
-        if (n_recs == 0) {
-                free((void *) rec_ptrs);
-                return;
-        }
-        qsort((void *) rec_ptrs, n_recs, sizeof(RECORD_HEADER_m12 *), rec_compare);
-
-        // create matlab records
-        mat_records = mxCreateCellMatrix(n_recs, 1);
-        mxSetFieldByNumber(mat_sess, 0, SESSION_FIELDS_RECORDS_IDX_mat, mat_records);
-        for (i = 0; i < n_recs; ++i) {
-                mat_record = fill_record(rec_ptrs[i]);
-                mxSetCell(mat_records, i, mat_record);
-        }
+	}
 
-        // clean up
-	free((void *) rec_ptrs);
+	// create matlab records
+	if (record_format == RECORD_FORMAT_TABLE) {
+		mat_records = create_record_table(rm->number_of_records, &rt, FALSE_m12);
+		for (i = 0; (rh = next_merged_record(rm)) != NULL; ++i)
+			fill_record_table_row(&rt, i, rh);
+		finish_record_table(&rt);
+	} else {
+		mat_records = mxCreateCellMatrix(rm->number_of_records, 1);
+		for (i = 0; (rh = next_merged_record(rm)) != NULL; ++i)
+			mxSetCell(mat_records, i, fill_record(rh));
+	}
+	mxSetFieldByNumber(mat_sess, 0, SESSION_FIELDS_RECORDS_IDX_mat, mat_records);
 
-        return;
+	// clean up
+	free_record_merge(rm);
+
+	return;
+}
+
+
+// records of the slice matching the query's types & limit (only those records are read)
+void	build_queried_records(SESSION_m12 *sess, RECORD_QUERY *rq, si4 record_format, mxArray *mat_sess)
+{
+	si8			i;
+	mxArray			*mat_records;
+	RECORD_QUERY_RESULT	*res;
+	RECORD_TABLE		rt;
+
+
+	rq->start_time = sess->time_slice.start_time;
+	rq->end_time = sess->time_slice.end_time;
+	res = query_session_records(sess, rq);
+	if (res->number_of_records > 0) {
+		if (record_format == RECORD_FORMAT_TABLE) {
+			mat_records = create_record_table(res->number_of_records, &rt, FALSE_m12);
+			for (i = 0; i < res->number_of_records; ++i)
+				fill_record_table_row(&rt, i, res->records[i]);
+			finish_record_table(&rt);
+		} else {
+			mat_records = mxCreateCellMatrix(res->number_of_records, 1);
+			for (i = 0; i < res->number_of_records; ++i)
+				mxSetCell(mat_records, i, fill_record(res->records[i]));
+		}
+		mxSetFieldByNumber(mat_sess, 0, SESSION_FIELDS_RECORDS_IDX_mat, mat_records);
+	}
+	free_record_query_result(res);
+
+	return;
 }
 
 
@@ -1678,60 +1930,70 @@ si8     get_si8_scalar(const mxArray *mx_arr)
 }
 
 
-si4     rec_compare(const void *a, const void *b)
+
+// sets up a job for each active channel of the session (job outputs are set by caller)
+JOB_INFO	*create_jobs(SESSION_m12 *sess, C_RPS *crps, si4 *n_jobs)
 {
-	si8	time_d;
-	
-	
-	time_d = (*((RECORD_HEADER_m12 **) a))->start_time - (*((RECORD_HEADER_m12 **) b))->start_time;
-	
-	// sort by time
-	if (time_d > 0)
-		return(1);
-	if (time_d < 0)
-		return(-1);
-	
-	// if same time, sort by location in memory
-	if ((ui8) *((RECORD_HEADER_m12 **) a) > (ui8) *((RECORD_HEADER_m12 **) a))
-		return(1);
+	si4		i, n_channels;
+	CHANNEL_m12	*chan;
+	JOB_INFO	*jobs;
 
-	return(-1);
+
+	n_channels = sess->number_of_time_series_channels;
+	jobs = (JOB_INFO *) malloc((size_t) n_channels * sizeof(JOB_INFO));
+	*n_jobs = 0;
+	for (i = 0; i < n_channels; ++i) {
+		chan = sess->time_series_channels[i];
+		if ((chan->flags & LH_CHANNEL_ACTIVE_m12) == 0)
+			continue;
+		jobs[*n_jobs].channel = chan;
+		jobs[*n_jobs].crps = crps;
+		initialize_job(jobs + *n_jobs);
+		++(*n_jobs);
+	}
+
+	return(jobs);
 }
 
 
-pthread_rval_m12	distribute_and_filter(void *ptr)
+void	initialize_job(JOB_INFO *job)
 {
-	si2				*mat_si2_samps;
-	si4				*mat_si4_samps, seg_idx, n_segs, *seg_samps, filt_type, val, pos_inf, neg_inf;
-	sf4				*mat_sf4_samps;
-	si8				i, j, k, data_len;
-	sf8				*mat_sf8_samps, samp_freq, cut_1, cut_2;
-	PROC_THREAD_INFO_m12		*pi;
-	JOB_INFO 			*job;
-	TIME_SLICE_m12			*slice;
-	CHANNEL_m12			*chan;
-	SEGMENT_m12			*seg;
-	CMP_PROCESSING_STRUCT_m12	*cps;
-	FILT_PROCESSING_STRUCT_m12	*filtps;
-	C_RPS				*crps;
-	mwSize				n_dims, dims[2], pad_samps, el_size, element_multiplier;
-	mxArray				*samps;
-	mxClassID			mat_class;
+	si4					seg_idx, n_segs, filt_type;
+	si8					i;
+	sf8					samp_freq, cut_1, cut_2;
+	TIME_SLICE_m12				*slice;
+	CHANNEL_m12				*chan;
+	SEGMENT_m12				*seg;
+	C_RPS					*crps;
+	TIME_SERIES_METADATA_SECTION_2_m12	*tmd2;
+
 
-	
-	pi = (PROC_THREAD_INFO_m12 *) ptr;
-	pi->status = PROC_THREAD_RUNNING_m12;  // volatile
-	
-	job = (JOB_INFO *) (pi->arg);
 	chan = job->channel;
+	crps = job->crps;
 	slice = &chan->time_slice;
-	data_len = TIME_SLICE_SAMPLE_COUNT_m12(slice);
+	job->data_len = TIME_SLICE_SAMPLE_COUNT_m12(slice);
+	job->filt_design = NULL;
+	job->stream = NULL;
+	job->context_samps = job->lookahead_samps = job->n_new_tail_samps = 0;
+	job->new_tail = NULL;
+	job->out = NULL;  // set by caller
+	job->samples = NULL;
+	job->decode_seconds = job->filter_seconds = (sf8) 0.0;
+	job->bytes_read = job->blocks_decoded = job->samples_clipped = 0;
 	n_segs = TIME_SLICE_SEGMENT_COUNT_m12(slice);
 	seg_idx = G_get_segment_index_m12(slice->start_segment_number);
-	crps = job->crps;
 
-	// set up for format / filtering
-	if (crps->filter > FILT_NONE) {
+	// time series indices are needed to locate blocks (read here, the job threads share segments)
+	for (i = 0; i < n_segs; ++i) {
+		if (prepare_segment_indices(chan->segments[seg_idx + i]) == FALSE_m12) {
+			G_warning_message_m12("%s(): cannot read time series indices for channel \"%s\"\n", __FUNCTION__, chan->path);
+			job->data_len = 0;
+			break;
+		}
+	}
+
+	// set up for filtering (designs are shared by channels with the same sampling frequency, & across calls)
+	if (crps->filter > FILT_NONE && job->data_len > 0) {
 		switch (crps->filter) {
 			case FILT_LOWPASS:
 				filt_type = FILT_LOWPASS_TYPE_m12;
@@ -1747,6 +2009,7 @@ pthread_rval_m12	distribute_and_filter(void *ptr)
 				filt_type = FILT_BANDPASS_TYPE_m12;
 				cut_1 = crps->low_cutoff;
 				cut_2 = crps->high_cutoff;
+				break;
 			case FILT_BANDSTOP:
 				filt_type = FILT_BANDSTOP_TYPE_m12;
 				cut_1 = crps->low_cutoff;
@@ -1754,134 +2017,1059 @@ pthread_rval_m12	distribute_and_filter(void *ptr)
 				break;
 		}
 		samp_freq = chan->segments[seg_idx]->metadata_fps->metadata->time_series_section_2.sampling_frequency;
-		filtps = FILT_initialize_processing_struct_m12(FILTER_ORDER, filt_type, samp_freq, data_len, FALSE_m12, FALSE_m12, TRUE_m12, RETURN_ON_FAIL_m12 | SUPPRESS_OUTPUT_m12, cut_1, cut_2);
-		pad_samps = (mwSize) FILT_FILT_PAD_SAMPLES_m12(filtps->n_poles);
-	} else {
-		pad_samps = 0;
+		job->filt_design = get_filter_design(FILTER_ORDER, filt_type, samp_freq, cut_1, cut_2);
+		if (job->filt_design != NULL) {
+			job->overlap_samps = filter_overlap(filt_type, samp_freq, cut_1, cut_2);
+			
+			// streaming (persistent sessions, if requested): a read continuing the last one starts from its unfiltered tail, & every read looks ahead
+			// into its last segment, so successive pages are filtered as one stream, without padding or edge transients at page boundaries
+			// (otherwise a read's filtered samples depend only on its own slice)
+			if (crps->stream == TRUE_m12 && (crps->persist_mode & PERSIST_CLOSE) == 0) {
+				job->stream = get_filter_stream(job);
+				if (job->stream->next_samp == slice->start_sample_number) {
+					job->context_samps = job->stream->n_tail_samps;
+					if (job->context_samps > job->overlap_samps)
+						job->context_samps = job->overlap_samps;
+				}
+				seg = chan->segments[(seg_idx + n_segs) - 1];
+				tmd2 = &seg->metadata_fps->metadata->time_series_section_2;
+				job->lookahead_samps = ((tmd2->absolute_start_sample_number + tmd2->number_of_samples) - 1) - seg->time_slice.end_sample_number;
+				if (job->lookahead_samps > job->overlap_samps)
+					job->lookahead_samps = job->overlap_samps;
+				else if (job->lookahead_samps < 0)
+					job->lookahead_samps = 0;
+			}
+		}
 	}
 
-	switch (crps->format) {
+	return;
+}
+
+
+// allocates a Matlab samples array (filtering works in tile buffers, so the array is always the output size)
+mxArray	*create_samples_array(si8 data_len, si4 format)
+{
+	mwSize		n_dims, dims[2];
+	mxClassID	mat_class;
+
+
+	switch (format) {
 		case FORMAT_DOUBLE:
-			el_size = (mwSize) 8;
 			mat_class = mxDOUBLE_CLASS;
 			break;
 		case FORMAT_SINGLE:
-			el_size = (mwSize) 4;
 			mat_class = mxSINGLE_CLASS;
 			break;
 		case FORMAT_INT32:
-			el_size = (mwSize) 4;
 			mat_class = mxINT32_CLASS;
 			break;
 		case FORMAT_INT16:
-			el_size = (mwSize) 2;
 			mat_class = mxINT16_CLASS;
 			break;
 	}
-	if (crps->filter > FILT_NONE)
-		element_multiplier = (mwSize) 8 / el_size;  // need sf8s to filter
-	else
-		element_multiplier = (mwSize) 1;
-
-	// allocate Matlab array
 	n_dims = 2; dims[1] = 1;
-	dims[0] = ((mwSize) data_len * element_multiplier) + pad_samps;
-	samps = mxCreateNumericArray(n_dims, dims, mat_class, mxREAL);
+	dims[0] = (mwSize) data_len;
+
+	return(mxCreateNumericArray(n_dims, dims, mat_class, mxREAL));
+}
+
+
+// decodes & filters jobs into their out buffers: unfiltered channels split into segment & block range tasks, filtered channels into overlapping tiles,
+// so reads of few channels still use all cores
+void	decode_jobs(JOB_INFO *jobs, si4 n_jobs)
+{
+	si4			n_workers;
+	si8			i, n_tasks, n_tiles;
+	DECODE_TASK		*decode_tasks;
+	FILTER_TILE		*filter_tiles;
+	WORKER_CONTEXT		*worker_contexts;
+	WQ_TASK			*wq_tasks;
+
+
+	decode_tasks = build_decode_tasks(jobs, n_jobs, &n_tasks);
+	filter_tiles = build_filter_tiles(jobs, n_jobs, &n_tiles);
+	n_workers = work_queue_workers(n_tiles + n_tasks);
+	worker_contexts = (WORKER_CONTEXT *) calloc((size_t) n_workers, sizeof(WORKER_CONTEXT));
+	wq_tasks = (WQ_TASK *) malloc((size_t) (n_tiles + n_tasks) * sizeof(WQ_TASK));
+	for (i = 0; i < n_tiles; ++i) {  // tiles first (longer tasks)
+		filter_tiles[i].contexts = worker_contexts;
+		wq_tasks[i].task_f = filter_task;
+		wq_tasks[i].arg = (void *) (filter_tiles + i);
+	}
+	for (i = 0; i < n_tasks; ++i) {
+		decode_tasks[i].contexts = worker_contexts;
+		wq_tasks[n_tiles + i].task_f = decode_task;
+		wq_tasks[n_tiles + i].arg = (void *) (decode_tasks + i);
+	}
+	run_work_queue(wq_tasks, n_tiles + n_tasks, n_workers);
+
+	// channel times & counts
+	for (i = 0; i < n_tiles; ++i) {
+		filter_tiles[i].job->decode_seconds += filter_tiles[i].decode_seconds;
+		filter_tiles[i].job->filter_seconds += filter_tiles[i].filter_seconds;
+		filter_tiles[i].job->bytes_read += filter_tiles[i].bytes_read;
+		filter_tiles[i].job->blocks_decoded += filter_tiles[i].blocks_decoded;
+		filter_tiles[i].job->samples_clipped += filter_tiles[i].samples_clipped;
+	}
+	for (i = 0; i < n_tasks; ++i) {
+		decode_tasks[i].job->decode_seconds += decode_tasks[i].decode_seconds;
+		decode_tasks[i].job->bytes_read += decode_tasks[i].bytes_read;
+		decode_tasks[i].job->blocks_decoded += decode_tasks[i].blocks_decoded;
+		decode_tasks[i].job->samples_clipped += decode_tasks[i].samples_clipped;
+	}
+	for (i = 0; i < n_workers; ++i)
+		free_worker_context(worker_contexts + i);
+	free((void *) worker_contexts);
+	free((void *) decode_tasks);
+	free((void *) filter_tiles);
+	free((void *) wq_tasks);
+
+	return;
+}
+
+
+// builds block aligned decode tasks for all channel jobs
+DECODE_TASK	*build_decode_tasks(JOB_INFO *jobs, si4 n_jobs, si8 *n_tasks)
+{
+	ui1				*out;
+	si4				seg_idx, n_segs, format;
+	si8				i, j, k, blk, n_blocks, max_tasks, start_samp, end_samp, seg_start_samp, task_start, task_end;
+	JOB_INFO			*job;
+	TIME_SLICE_m12			*slice;
+	CHANNEL_m12			*chan;
+	SEGMENT_m12			*seg;
+	TIME_SERIES_INDEX_m12		*tsi;
+	DECODE_TASK			*tasks, *task;
+	mwSize				el_size;
+
+
+	max_tasks = (si8) n_jobs * 4;
+	tasks = (DECODE_TASK *) malloc((size_t) max_tasks * sizeof(DECODE_TASK));
+	*n_tasks = 0;
+	for (i = 0; i < n_jobs; ++i) {
+		job = jobs + i;
+		if (job->data_len == 0 || job->filt_design != NULL)  // filtered channels are decoded by their filter tiles
+			continue;
+		chan = job->channel;
+		slice = &chan->time_slice;
+		n_segs = TIME_SLICE_SEGMENT_COUNT_m12(slice);
+		seg_idx = G_get_segment_index_m12(slice->start_segment_number);
+
+		// decode destination: the Matlab array itself (or prefetch buffer)
+		format = job->crps->format;
+		out = job->out;
+		el_size = format_element_size(format);
+
+		for (j = 0; j < n_segs; ++j) {
+			seg = chan->segments[seg_idx + j];
+			seg_start_samp = seg->metadata_fps->metadata->time_series_section_2.absolute_start_sample_number;
+			start_samp = seg->time_slice.start_sample_number - seg_start_samp;
+			end_samp = seg->time_slice.end_sample_number - seg_start_samp;
+			tsi = seg->time_series_indices_fps->time_series_indices;
+			n_blocks = seg->metadata_fps->metadata->time_series_section_2.number_of_blocks;
+
+			// split segment on block boundaries (no block is decoded twice)
+			for (task_start = start_samp; task_start <= end_samp; task_start = task_end + 1) {
+				task_end = task_start + DECODE_TASK_SAMPLES;
+				if (task_end > end_samp) {
+					task_end = end_samp;
+				} else {
+					blk = find_block(tsi, n_blocks, task_end);
+					if (tsi[blk].start_sample_number > task_start)
+						task_end = tsi[blk].start_sample_number - 1;
+					else  // single block larger than task size
+						task_end = tsi[blk + 1].start_sample_number - 1;
+					if (task_end > end_samp)
+						task_end = end_samp;
+				}
+				if (*n_tasks == max_tasks) {
+					max_tasks *= 2;
+					tasks = (DECODE_TASK *) realloc((void *) tasks, (size_t) max_tasks * sizeof(DECODE_TASK));
+				}
+				task = tasks + (*n_tasks)++;
+				task->job = job;
+				task->segment = seg;
+				task->start_samp = task_start;
+				task->end_samp = task_end;
+				task->format = format;
+				task->out = out;
+				task->contexts = NULL;  // set by caller
+				task->decode_seconds = (sf8) 0.0;
+				task->bytes_read = task->blocks_decoded = task->samples_clipped = 0;
+				k = (task_end - task_start) + 1;
+				out += k * el_size;
+			}
+		}
+	}
+
+	return(tasks);
+}
+
+
+// builds overlapping filter tiles for filtered channel jobs
+FILTER_TILE	*build_filter_tiles(JOB_INFO *jobs, si4 n_jobs, si8 *n_tiles)
+{
+	si8		i, j, n_job_tiles, max_tiles, tile_samps;
+	JOB_INFO	*job;
+	FILTER_TILE	*tiles, *tile;
+
+
+	max_tiles = (si8) n_jobs * 4;
+	tiles = (FILTER_TILE *) malloc((size_t) max_tiles * sizeof(FILTER_TILE));
+	*n_tiles = 0;
+	for (i = 0; i < n_jobs; ++i) {
+		job = jobs + i;
+		if (job->data_len == 0 || job->filt_design == NULL)
+			continue;
+
+		// tiles at least 4 overlaps long, so overlap costs at most 50% extra work (a single tile filters the channel as a whole)
+		tile_samps = job->overlap_samps * 4;
+		if (tile_samps < FILT_TILE_SAMPLES)
+			tile_samps = FILT_TILE_SAMPLES;
+		n_job_tiles = (job->data_len + tile_samps - 1) / tile_samps;
+		for (j = 0; j < n_job_tiles; ++j) {
+			if (*n_tiles == max_tiles) {
+				max_tiles *= 2;
+				tiles = (FILTER_TILE *) realloc((void *) tiles, (size_t) max_tiles * sizeof(FILTER_TILE));
+			}
+			tile = tiles + (*n_tiles)++;
+			tile->job = job;
+			tile->start_samp = (job->data_len * j) / n_job_tiles;  // equal tiles
+			tile->end_samp = ((job->data_len * (j + 1)) / n_job_tiles) - 1;
+			tile->contexts = NULL;  // set by caller
+			tile->decode_seconds = tile->filter_seconds = (sf8) 0.0;
+			tile->bytes_read = tile->blocks_decoded = tile->samples_clipped = 0;
+		}
+	}
+
+	return(tiles);
+}
+
+
+// returns samples of overlap needed on each side of a tile for edge transients to decay by FILT_SETTLE_NEPERS
+// NOTE: the slowest decaying Butterworth pole has a decay rate of sin(pi / (2 * order)) * 2 * pi * f, where f is the cutoff, or for band filters, the lower
+// cutoff or half the bandwidth (whichever is smaller). The rate is halved because frequency warping & the band transforms make this estimate up to ~25% optimistic.
+// Tiled output matches whole channel filtering to ~1e-11 of peak amplitude for typical settings; cutoffs below ~0.001 of the sampling frequency are limited
+// to ~1e-6 (relative) by the filter's own roundoff, whole channel or tiled.
+si8	filter_overlap(si4 filt_type, sf8 samp_freq, sf8 cut_1, sf8 cut_2)
+{
+	sf8	f, decay_rate;
+
+
+	f = cut_1;
+	if (filt_type == FILT_BANDPASS_TYPE_m12 || filt_type == FILT_BANDSTOP_TYPE_m12)
+		if ((cut_2 - cut_1) / (sf8) 2.0 < f)
+			f = (cut_2 - cut_1) / (sf8) 2.0;
+	decay_rate = sin(FILT_PI / (sf8) (2 * FILTER_ORDER)) * FILT_PI * f;  // nepers per second (halved)
+
+	return((si8) ceil((FILT_SETTLE_NEPERS / decay_rate) * samp_freq));
+}
+
+
+void	decode_task(void *arg, si4 worker_id)
+{
+	si8		bytes_read, blocks_decoded, samples_clipped;
+	sf8		start_wall;
+	DECODE_TASK	*task;
+	DECODE_CONTEXT	*dc;
+
 
-	// Fill in channel data
-	mat_sf8_samps = (sf8 *) mxGetPr(samps);
-	switch (crps->format) {
+	task = (DECODE_TASK *) arg;
+	dc = &task->contexts[worker_id].dc;
+	if (size_decode_context(dc, task->segment) == FALSE_m12) {
+		G_warning_message_m12("%s(): cannot allocate decode buffers for channel \"%s\"\n", __FUNCTION__, task->job->channel->path);
+		return;
+	}
+	bytes_read = dc->bytes_read;
+	blocks_decoded = dc->blocks_decoded;
+	samples_clipped = dc->samples_clipped;
+	start_wall = (task->job->crps->timing == TRUE_m12) ? wall_seconds() : (sf8) 0.0;
+	decode_segment(task->segment, task->start_samp, task->end_samp, task->out, task->format, dc);
+	if (task->job->crps->timing == TRUE_m12)
+		task->decode_seconds = wall_seconds() - start_wall;
+	task->bytes_read = dc->bytes_read - bytes_read;
+	task->blocks_decoded = dc->blocks_decoded - blocks_decoded;
+	task->samples_clipped = dc->samples_clipped - samples_clipped;
+
+	return;
+}
+
+
+// decodes tile plus overlap (clipped at the slice edges) as sf8s, filters, & converts the tile portion into the Matlab array
+void	filter_task(void *arg, si4 worker_id)
+{
+	ui1				*out;
+	si8				ext_start, ext_end, ext_len, buf_samps, n_samps, n_tail_samps, bytes_read, blocks_decoded;
+	sf8				*filt_samps, start_wall, filt_wall;
+	JOB_INFO			*job;
+	FILTER_TILE			*tile;
+	WORKER_CONTEXT			*wc;
+	FILT_PROCESSING_STRUCT_m12	filtps;
+
+
+	tile = (FILTER_TILE *) arg;
+	job = tile->job;
+	wc = tile->contexts + worker_id;
+	ext_start = tile->start_samp - job->overlap_samps;
+	if (ext_start < -job->context_samps)
+		ext_start = -job->context_samps;
+	ext_end = tile->end_samp + job->overlap_samps;
+	if (ext_end >= job->data_len + job->lookahead_samps)
+		ext_end = (job->data_len + job->lookahead_samps) - 1;
+	ext_len = (ext_end - ext_start) + 1;
+
+	// worker's tile buffers (reused across tiles)
+	buf_samps = ext_len + (si8) FILT_FILT_PAD_SAMPLES_m12(job->filt_design->n_poles);
+	if (buf_samps > wc->filt_buffer_samps) {
+		if (wc->filt_data != NULL)
+			free((void *) wc->filt_data);
+		if (wc->filt_buffer != NULL)
+			free((void *) wc->filt_buffer);
+		wc->filt_data = (sf8 *) malloc((size_t) buf_samps * sizeof(sf8));
+		wc->filt_buffer = (sf8 *) malloc((size_t) buf_samps * sizeof(sf8));
+		wc->filt_buffer_samps = buf_samps;
+		if (wc->filt_data == NULL || wc->filt_buffer == NULL) {
+			free_worker_context(wc);
+			G_warning_message_m12("%s(): cannot allocate filter buffers for channel \"%s\"\n", __FUNCTION__, job->channel->path);
+			return;
+		}
+	}
+	instantiate_filter(job->filt_design, &filtps, ext_len, wc->filt_data, wc->filt_buffer);
+
+	bytes_read = wc->dc.bytes_read;
+	blocks_decoded = wc->dc.blocks_decoded;
+	start_wall = (job->crps->timing == TRUE_m12) ? wall_seconds() : (sf8) 0.0;
+	load_filter_range(job, ext_start, ext_end, filtps.orig_data, &wc->dc);
+	tile->bytes_read = wc->dc.bytes_read - bytes_read;
+	tile->blocks_decoded = wc->dc.blocks_decoded - blocks_decoded;
+	filt_wall = (job->crps->timing == TRUE_m12) ? wall_seconds() : (sf8) 0.0;
+	tile->decode_seconds = filt_wall - start_wall;
+
+	// streaming: last tile keeps the unfiltered end of the slice for a continuing read (before filtering in place)
+	if (job->stream != NULL && tile->end_samp == job->data_len - 1) {
+		n_tail_samps = job->data_len - ext_start;
+		if (n_tail_samps > job->overlap_samps)
+			n_tail_samps = job->overlap_samps;
+		job->new_tail = (sf8 *) malloc((size_t) n_tail_samps * sizeof(sf8));
+		if (job->new_tail != NULL) {
+			memcpy((void *) job->new_tail, (void *) (filtps.orig_data + ((job->data_len - n_tail_samps) - ext_start)), (size_t) n_tail_samps * sizeof(sf8));
+			job->n_new_tail_samps = n_tail_samps;
+		}
+	}
+
+	FILT_filtfilt_m12(&filtps);
+	if (job->crps->timing == TRUE_m12)
+		tile->filter_seconds = wall_seconds() - filt_wall;
+
+	// convert tile portion to output type (& round)
+	filt_samps = filtps.filt_data + (tile->start_samp - ext_start);  // base position + overlap
+	n_samps = (tile->end_samp - tile->start_samp) + 1;
+	out = job->out + (tile->start_samp * (si8) format_element_size(job->crps->format));
+	switch (job->crps->format) {
+		case FORMAT_DOUBLE:
+			memcpy((void *) out, (void *) filt_samps, (size_t) n_samps * sizeof(sf8));
+			break;
 		case FORMAT_SINGLE:
-			mat_sf4_samps = (sf4 *) mat_sf8_samps;
+			convert_sf8_to_sf4(filt_samps, (sf4 *) out, n_samps);
 			break;
 		case FORMAT_INT32:
-			mat_si4_samps = (si4 *) mat_sf8_samps;
+			tile->samples_clipped = convert_sf8_to_si4(filt_samps, (si4 *) out, n_samps);
 			break;
 		case FORMAT_INT16:
-			mat_si2_samps = (si2 *) mat_sf8_samps;
+			tile->samples_clipped = convert_sf8_to_si2(filt_samps, (si2 *) out, n_samps);
 			break;
 	}
 
-	
-	// no filtering
-	if (crps->filter == FILT_NONE) {
-		for (i = 0, j = seg_idx; i < n_segs; ++i, ++j) {
-			seg = chan->segments[j];
-			cps = seg->time_series_data_fps->parameters.cps;
-			seg_samps = cps->decompressed_data;
-			k = TIME_SLICE_SAMPLE_COUNT_S_m12(seg->time_slice);
-			switch (crps->format) {
-				case FORMAT_DOUBLE:
-					while (k--)
-						*mat_sf8_samps++ = (sf8) *seg_samps++;
-					break;
-				case FORMAT_SINGLE:
-					while (k--)
-						*mat_sf4_samps++ = (sf4) *seg_samps++;
-					break;
-				case FORMAT_INT32:
-					while (k--)
-						*mat_si4_samps++ = (si4) *seg_samps++;
-					break;
-				case FORMAT_INT16:
-					pos_inf = (si4) POS_INF_SI2_m12;
-					neg_inf = (si4) NEG_INF_SI2_m12;
-					while (k--) {
-						val = *seg_samps++;  // curtail overflow
-						if (val > pos_inf)
-							val = POS_INF_SI2_m12;
-						else if (val < neg_inf)
-							val = NEG_INF_SI2_m12;
-						*mat_si2_samps++ = (si2) val;
-					}
-					break;
-			}
+	return;
+}
+
+
+// decodes slice relative sample range [start_samp, end_samp] of a channel (across segments) into out, returns samples decoded
+si8	decode_channel_range(CHANNEL_m12 *chan, si8 start_samp, si8 end_samp, ui1 *out, si4 format, DECODE_CONTEXT *dc)
+{
+	si4		seg_idx, n_segs;
+	si8		i, seg_offset, seg_samps, seg_start_samp, local_start, first, last, n_samps;
+	TIME_SLICE_m12	*slice;
+	SEGMENT_m12	*seg;
+	mwSize		el_size;
+
+
+	slice = &chan->time_slice;
+	n_segs = TIME_SLICE_SEGMENT_COUNT_m12(slice);
+	seg_idx = G_get_segment_index_m12(slice->start_segment_number);
+	el_size = format_element_size(format);
+
+	n_samps = 0;
+	seg_offset = 0;  // slice relative sample number of segment's first sliced sample
+	for (i = 0; i < n_segs && seg_offset <= end_samp; ++i, seg_offset += seg_samps) {
+		seg = chan->segments[seg_idx + i];
+		seg_samps = (seg->time_slice.end_sample_number - seg->time_slice.start_sample_number) + 1;
+		if (seg_offset + seg_samps <= start_samp)
+			continue;
+		first = (start_samp > seg_offset) ? start_samp - seg_offset : 0;
+		last = (end_samp < seg_offset + seg_samps) ? end_samp - seg_offset : seg_samps - 1;
+		if (size_decode_context(dc, seg) == FALSE_m12) {
+			G_warning_message_m12("%s(): cannot allocate decode buffers for channel \"%s\"\n", __FUNCTION__, chan->path);
+			break;
 		}
-	} else {  // filter
-		
-		// fill original data as sf8s
-		filtps->filt_data = mat_sf8_samps;
-		filtps->orig_data = FILT_OFFSET_ORIG_DATA_m12(filtps);  // offset to skip intial copy, filter in place
-		mat_sf8_samps = filtps->orig_data;  // offset position
-		for (i = 0, j = seg_idx; i < n_segs; ++i, ++j) {
-			seg = chan->segments[j];
-			cps = seg->time_series_data_fps->parameters.cps;
-			seg_samps = cps->decompressed_data;
-			k = TIME_SLICE_SAMPLE_COUNT_S_m12(seg->time_slice);
-			while (k--)
-				*mat_sf8_samps++ = (sf8) *seg_samps++;
+		seg_start_samp = seg->metadata_fps->metadata->time_series_section_2.absolute_start_sample_number;
+		local_start = seg->time_slice.start_sample_number - seg_start_samp;
+		n_samps += decode_segment(seg, local_start + first, local_start + last, out + (((seg_offset + first) - start_samp) * el_size), format, dc);
+	}
+
+	return(n_samps);
+}
+
+
+// loads slice relative sample range [start_samp, end_samp] as sf8s for filtering: samples before the slice come from the stream tail, samples after it from the last segment
+void	load_filter_range(JOB_INFO *job, si8 start_samp, si8 end_samp, sf8 *out, DECODE_CONTEXT *dc)
+{
+	si8					last_samp, local_end;
+	TIME_SLICE_m12				*slice;
+	SEGMENT_m12				*seg;
+	TIME_SERIES_METADATA_SECTION_2_m12	*tmd2;
+
+
+	// stream tail
+	if (start_samp < 0) {
+		memcpy((void *) out, (void *) (job->stream->tail + (job->stream->n_tail_samps + start_samp)), (size_t) -start_samp * sizeof(sf8));
+		out += -start_samp;
+		start_samp = 0;
+	}
+
+	// slice
+	last_samp = (end_samp < job->data_len) ? end_samp : job->data_len - 1;
+	decode_channel_range(job->channel, start_samp, last_samp, (ui1 *) out, FORMAT_DOUBLE, dc);
+	out += (last_samp - start_samp) + 1;
+
+	// look ahead
+	if (end_samp >= job->data_len) {
+		slice = &job->channel->time_slice;
+		seg = job->channel->segments[G_get_segment_index_m12(slice->end_segment_number)];
+		if (size_decode_context(dc, seg) == FALSE_m12)
+			return;
+		tmd2 = &seg->metadata_fps->metadata->time_series_section_2;
+		local_end = seg->time_slice.end_sample_number - tmd2->absolute_start_sample_number;
+		decode_segment(seg, local_end + 1, local_end + (end_samp - job->data_len) + 1, (ui1 *) out, FORMAT_DOUBLE, dc);
+	}
+
+	return;
+}
+
+
+// returns channel's filter stream (tails are unfiltered, so they stay valid if the filter settings change)
+FILT_STREAM	*get_filter_stream(JOB_INFO *job)
+{
+	si4		i;
+	FILT_STREAM	*stream;
+
+
+	for (i = 0; i < n_filt_streams; ++i)
+		if (strcmp(filt_streams[i]->chan_path, job->channel->path) == 0)
+			break;
+	if (i == n_filt_streams) {
+		filt_streams = (FILT_STREAM **) realloc((void *) filt_streams, (size_t) (n_filt_streams + 1) * sizeof(FILT_STREAM *));
+		stream = filt_streams[n_filt_streams++] = (FILT_STREAM *) calloc((size_t) 1, sizeof(FILT_STREAM));
+		strcpy(stream->chan_path, job->channel->path);
+		stream->next_samp = SAMPLE_NUMBER_NO_ENTRY_m12;
+	} else {
+		stream = filt_streams[i];
+	}
+
+	return(stream);
+}
+
+
+// replaces stream tail with the one saved by the job's last tile (called after all tiles have run)
+void	update_filter_stream(JOB_INFO *job)
+{
+	FILT_STREAM	*stream;
+
+
+	stream = job->stream;
+	if (stream == NULL)
+		return;
+
+	if (stream->tail != NULL)
+		free((void *) stream->tail);
+	stream->tail = job->new_tail;
+	stream->n_tail_samps = job->n_new_tail_samps;
+	if (stream->tail == NULL)
+		stream->next_samp = SAMPLE_NUMBER_NO_ENTRY_m12;
+	else
+		stream->next_samp = job->channel->time_slice.end_sample_number + 1;
+	job->new_tail = NULL;
+
+	return;
+}
+
+
+// frees the filter streams of a session's channels (sess == NULL: all streams)
+void	free_filter_streams(SESSION_m12 *sess)
+{
+	si4	i, j;
+	size_t	len;
+
+
+	len = (sess == NULL) ? 0 : strlen(sess->path);
+	for (i = j = 0; i < n_filt_streams; ++i) {
+		if (sess != NULL && (strncmp(filt_streams[i]->chan_path, sess->path, len) || filt_streams[i]->chan_path[len] != '/')) {
+			filt_streams[j++] = filt_streams[i];  // another session's channel
+			continue;
 		}
-		
-		// filter
-		FILT_filtfilt_m12(filtps);
-		
-		// convert to output size (& round)
-		mat_sf8_samps = filtps->filt_data;  // base position
-		switch (crps->format) {
-			case FORMAT_DOUBLE:
-				break;
-			case FORMAT_SINGLE:
-				CMP_sf8_to_sf4_m12(mat_sf8_samps, mat_sf4_samps, data_len, TRUE_m12);
-				break;
-			case FORMAT_INT32:
-				CMP_sf8_to_si4_m12(mat_sf8_samps, mat_si4_samps, data_len, TRUE_m12);
-				break;
-			case FORMAT_INT16:
-				CMP_sf8_to_si2_m12(mat_sf8_samps, mat_si2_samps, data_len, TRUE_m12);
-				break;
+		if (filt_streams[i]->tail != NULL)
+			free((void *) filt_streams[i]->tail);
+		free((void *) filt_streams[i]);
+	}
+	n_filt_streams = j;
+	if (n_filt_streams == 0) {
+		if (filt_streams != NULL)
+			free((void *) filt_streams);
+		filt_streams = NULL;
+	}
+
+	return;
+}
+
+
+// predicts the next page of a persistent session, & starts a prefetch thread reading it
+void	start_read_prefetch(C_RPS *crps, ui8 flags, REGISTRY_ENTRY *entry)
+{
+	si4		units, i, n_chans;
+	si8		start, end, next_start, next_end, n_samps, el_size;
+	sf8		samp_freq, ref_freq;
+	SESSION_m12	*sess;
+	CHANNEL_m12	*chan;
+
+
+	if (crps->start_index == SAMPLE_NUMBER_NO_ENTRY_m12) {
+		units = PAGE_UNITS_TIME;
+		start = crps->start_time;
+		end = crps->end_time;
+	} else {
+		units = PAGE_UNITS_INDICES;
+		start = crps->start_index;
+		end = crps->end_index;
+	}
+	if (predict_page(&entry->page_predictor, units, start, end, &next_start, &next_end) == FALSE_m12)
+		return;
+	if (units == PAGE_UNITS_TIME && next_start > globals_m12->session_end_time)  // past end of session
+		return;
+
+	prefetch_page.crps = *crps;
+	prefetch_page.crps.MED_paths = NULL;  // not owned (freed by caller)
+	prefetch_page.crps.n_files = 0;
+	if (units == PAGE_UNITS_TIME) {
+		prefetch_page.crps.start_time = next_start;
+		prefetch_page.crps.end_time = next_end;
+	} else {
+		prefetch_page.crps.start_index = next_start;
+		prefetch_page.crps.end_index = next_end;
+	}
+	prefetch_page.entry = entry;
+	prefetch_page.flags = flags;
+	prefetch_page.ready = prefetch_page.read_failed = FALSE_m12;
+	prefetch_page.jobs = NULL;
+	prefetch_page.n_jobs = 0;
+
+	// output buffers (mx functions only on this thread): sized for the predicted page at each active channel's sampling frequency, & handed
+	// to the Matlab arrays if the page is used
+	sess = entry->sess;
+	n_chans = sess->number_of_time_series_channels;
+	prefetch_page.buffers = (ui1 **) calloc((size_t) n_chans, sizeof(ui1 *));
+	prefetch_page.buffer_samps = (si8 *) calloc((size_t) n_chans, sizeof(si8));
+	prefetch_page.n_buffers = 0;
+	if (prefetch_page.buffers == NULL || prefetch_page.buffer_samps == NULL) {
+		free_prefetch_buffers();
+		prefetch_page.entry = NULL;
+		return;
+	}
+	el_size = (si8) format_element_size(crps->format);
+	ref_freq = current_sampling_frequency(globals_m12->reference_channel);
+	for (i = 0; i < n_chans; ++i) {
+		chan = sess->time_series_channels[i];
+		if ((chan->flags & LH_CHANNEL_ACTIVE_m12) == 0)
+			continue;
+		samp_freq = current_sampling_frequency(chan);
+		if (samp_freq <= (sf8) 0.0 || ref_freq <= (sf8) 0.0) {
+			free_prefetch_buffers();
+			prefetch_page.entry = NULL;
+			return;
 		}
+		if (units == PAGE_UNITS_TIME)
+			n_samps = (si8) ceil((((sf8) ((next_end - next_start) + 1)) * samp_freq) / (sf8) 1e6);
+		else
+			n_samps = (si8) ceil((((sf8) ((next_end - next_start) + 1)) * samp_freq) / ref_freq);
+		n_samps += 2;  // slice rounding
+		prefetch_page.buffers[prefetch_page.n_buffers] = (ui1 *) mxMalloc((size_t) (n_samps * el_size));
+		mexMakeMemoryPersistent((void *) prefetch_page.buffers[prefetch_page.n_buffers]);  // outlives this call
+		prefetch_page.buffer_samps[prefetch_page.n_buffers++] = n_samps;
+	}
+	launch_prefetch(&prefetch_thread, read_prefetch_thread, (void *) &prefetch_page);
+
+	return;
+}
+
+
+// reads & decodes the predicted page into the buffers allocated by the calling thread (no mx functions in this thread)
+// NOTE: the calling thread is back in Matlab, & waits for this thread before touching any session, the filter cache, or filter streams
+// NOTE: channels whose page does not fit their buffer (e.g. the active channels changed) are decoded into malloced memory, & copied by the calling thread
+pthread_rval_m12	read_prefetch_thread(void *ptr)
+{
+	si4			i;
+	TIME_SLICE_m12		slice;
+	SESSION_m12		*sess;
+	JOB_INFO		*job;
+	READ_PREFETCH		*pf;
+	PROC_THREAD_INFO_m12	*pi;
+
 
-		// clean up
-		FILT_free_processing_struct_m12(filtps, FALSE_m12, FALSE_m12, TRUE_m12, FALSE_m12);
+	pi = (PROC_THREAD_INFO_m12 *) ptr;
+	pi->status = PROC_THREAD_RUNNING_m12;  // volatile
 
-		// resize
-		mxSetM(samps, (mwSize) data_len);
-		mxRealloc((void *) mat_sf8_samps, (mwSize) data_len * el_size);
+	pf = (READ_PREFETCH *) pi->arg;
+	G_initialize_time_slice_m12(&slice);
+	slice.start_time = pf->crps.start_time;
+	slice.end_time = pf->crps.end_time;
+	slice.start_sample_number = pf->crps.start_index;
+	slice.end_sample_number = pf->crps.end_index;
+	sess = G_read_session_m12(pf->entry->sess, &slice, NULL, 0, pf->flags, pf->crps.password);  // existing session: no file list
+	if (sess == NULL) {
+		pf->read_failed = TRUE_m12;
+		pi->status = PROC_THREAD_FINISHED_m12;  // volatile
+		return((pthread_rval_m12) 0);
 	}
-	
-	job->samples = samps;
-	
+
+	advance_filter_cache();
+	pf->jobs = create_jobs(sess, &pf->crps, &pf->n_jobs);
+	for (i = 0; i < pf->n_jobs; ++i) {
+		job = pf->jobs + i;
+		if (job->data_len == 0)
+			continue;
+		if (i < pf->n_buffers && job->data_len <= pf->buffer_samps[i]) {
+			job->out = pf->buffers[i];
+		} else {
+			job->out = (ui1 *) malloc((size_t) job->data_len * format_element_size(pf->crps.format));
+			if (job->out == NULL)
+				break;
+		}
+	}
+	if (i == pf->n_jobs) {
+		decode_jobs(pf->jobs, pf->n_jobs);
+		pf->ready = TRUE_m12;
+	}
+
 	pi->status = PROC_THREAD_FINISHED_m12;  // volatile
 
 	return((pthread_rval_m12) 0);
 }
+
+
+// returns TRUE_m12 if the two parameter structures request the same data
+TERN_m12	same_page(C_RPS *crps_1, C_RPS *crps_2)
+{
+	if (crps_1->start_time != crps_2->start_time || crps_1->end_time != crps_2->end_time)
+		return(FALSE_m12);
+	if (crps_1->start_index != crps_2->start_index || crps_1->end_index != crps_2->end_index)
+		return(FALSE_m12);
+	if (crps_1->format != crps_2->format || crps_1->filter != crps_2->filter)
+		return(FALSE_m12);
+	if (crps_1->filter != FILT_NONE && (crps_1->low_cutoff != crps_2->low_cutoff || crps_1->high_cutoff != crps_2->high_cutoff))
+		return(FALSE_m12);
+	if (strcmp(crps_1->index_channel, crps_2->index_channel))
+		return(FALSE_m12);
+	if (record_query_active(&crps_1->record_query) != record_query_active(&crps_2->record_query))  // slice records read or not
+		return(FALSE_m12);
+
+	return(TRUE_m12);
+}
+
+
+// waits for prefetch thread, & frees its results
+void	discard_prefetch(void)
+{
+	si4	i;
+
+
+	wait_prefetch(&prefetch_thread);
+	if (prefetch_page.jobs != NULL) {
+		for (i = 0; i < prefetch_page.n_jobs; ++i) {
+			if (prefetch_page.jobs[i].new_tail != NULL)
+				free((void *) prefetch_page.jobs[i].new_tail);
+			if (prefetch_page.jobs[i].out != NULL && prefetch_buffer_output(&prefetch_page, i, prefetch_page.jobs[i].out) == FALSE_m12)
+				free((void *) prefetch_page.jobs[i].out);
+		}
+		free((void *) prefetch_page.jobs);
+	}
+	free_prefetch_buffers();
+	prefetch_page.jobs = NULL;
+	prefetch_page.n_jobs = 0;
+	prefetch_page.ready = prefetch_page.read_failed = FALSE_m12;
+	prefetch_page.entry = NULL;
+
+	return;
+}
+
+
+// returns TRUE_m12 if output of job i of the prefetched page is its buffer (FALSE_m12: malloced memory, the page outgrew the buffer)
+TERN_m12	prefetch_buffer_output(READ_PREFETCH *pf, si4 i, ui1 *out)
+{
+	if (i < pf->n_buffers && pf->buffers[i] != NULL && out == pf->buffers[i])
+		return(TRUE_m12);
+
+	return(FALSE_m12);
+}
+
+
+// frees prefetch buffers not adopted by Matlab arrays (calling thread only)
+void	free_prefetch_buffers(void)
+{
+	si4	i;
+
+
+	if (prefetch_page.buffers != NULL) {
+		for (i = 0; i < prefetch_page.n_buffers; ++i)
+			if (prefetch_page.buffers[i] != NULL)
+				mxFree((void *) prefetch_page.buffers[i]);
+		free((void *) prefetch_page.buffers);
+	}
+	if (prefetch_page.buffer_samps != NULL)
+		free((void *) prefetch_page.buffer_samps);
+	prefetch_page.buffers = NULL;
+	prefetch_page.buffer_samps = NULL;
+	prefetch_page.n_buffers = 0;
+
+	return;
+}
+
+
+// sampling frequency of a channel's current slice (first segment)
+sf8	current_sampling_frequency(CHANNEL_m12 *chan)
+{
+	si4		seg_idx;
+	SEGMENT_m12	*seg;
+
+
+	if (chan == NULL)
+		return((sf8) -1.0);
+	seg_idx = G_get_segment_index_m12(chan->time_slice.start_segment_number);
+	seg = chan->segments[seg_idx];
+	if (seg == NULL || seg->metadata_fps == NULL)
+		return((sf8) -1.0);
+
+	return(seg->metadata_fps->metadata->time_series_section_2.sampling_frequency);
+}
+
+
+// registry free function: frees a persistent session, & everything that depends on it (called with the session's globals restored)
+void	free_registry_entry(REGISTRY_ENTRY *entry)
+{
+	if (prefetch_page.entry == entry)
+		discard_prefetch();
+	free_filter_streams(entry->sess);
+	G_free_session_m12(entry->sess, TRUE_m12);
+
+	return;
+}
+
+
+TERN_m12	prepare_segment_indices(SEGMENT_m12 *seg)
+{
+	si1	path[FULL_FILE_NAME_BYTES_m12];
+
+
+	if (seg->time_series_indices_fps != NULL)
+		return(TRUE_m12);
+
+	sprintf_m12(path, "%s/%s.%s", seg->path, seg->name, TIME_SERIES_INDICES_FILE_TYPE_STRING_m12);
+	seg->time_series_indices_fps = G_read_file_m12(NULL, path, 0, 0, FPS_FULL_FILE_m12, (LEVEL_HEADER_m12 *) seg, NULL, USE_GLOBAL_BEHAVIOR_m12);
+	if (seg->time_series_indices_fps == NULL)
+		return(FALSE_m12);
+
+	return(TRUE_m12);
+}
+
+
+// grows worker's decode buffers to fit the segment's largest block (contexts start zeroed)
+TERN_m12	size_decode_context(DECODE_CONTEXT *dc, SEGMENT_m12 *seg)
+{
+	si8					max_block_samps, max_block_bytes;
+	TIME_SERIES_METADATA_SECTION_2_m12	*tmd2;
+
+
+	tmd2 = &seg->metadata_fps->metadata->time_series_section_2;
+	max_block_samps = tmd2->maximum_block_samples;
+	max_block_bytes = tmd2->maximum_block_bytes;
+
+	if (max_block_samps > dc->max_block_samps || dc->cps == NULL) {
+		if (dc->block_samps != NULL)
+			free((void *) dc->block_samps);
+		if (dc->cps != NULL) {
+			dc->cps->compressed_data = NULL;  // not owned by cps
+			CMP_free_processing_struct_m12(dc->cps, TRUE_m12);
+		}
+		dc->block_samps = (si4 *) malloc((size_t) max_block_samps * sizeof(si4));
+		dc->cps = CMP_allocate_processing_struct_m12(NULL, CMP_DECOMPRESSION_m12, max_block_samps, max_block_bytes, 0, (ui4) max_block_samps, NULL, NULL);
+		dc->max_block_samps = max_block_samps;
+		if (dc->block_samps == NULL || dc->cps == NULL) {
+			free_decode_context(dc);
+			return(FALSE_m12);
+		}
+	}
+	if (max_block_bytes * DECODE_READ_BLOCKS > dc->compressed_bytes) {
+		if (dc->compressed_data != NULL)
+			free((void *) dc->compressed_data);
+		dc->compressed_bytes = max_block_bytes * DECODE_READ_BLOCKS;
+		dc->compressed_data = (ui1 *) malloc((size_t) dc->compressed_bytes);
+		if (dc->compressed_data == NULL) {
+			free_decode_context(dc);
+			return(FALSE_m12);
+		}
+	}
+	dc->cps->compressed_data = dc->compressed_data;
+
+	return(TRUE_m12);
+}
+
+
+void	free_decode_context(DECODE_CONTEXT *dc)
+{
+	if (dc->fp != NULL) {
+		fclose(dc->fp);
+		dc->fp = NULL;
+	}
+	*dc->data_path = 0;
+	if (dc->compressed_data != NULL) {
+		free((void *) dc->compressed_data);
+		dc->compressed_data = NULL;
+	}
+	dc->compressed_bytes = 0;
+	if (dc->block_samps != NULL) {
+		free((void *) dc->block_samps);
+		dc->block_samps = NULL;
+	}
+	if (dc->cps != NULL) {
+		dc->cps->compressed_data = NULL;  // not owned by cps
+		CMP_free_processing_struct_m12(dc->cps, TRUE_m12);
+		dc->cps = NULL;
+	}
+	dc->max_block_samps = 0;
+
+	return;
+}
+
+
+void	free_worker_context(WORKER_CONTEXT *wc)
+{
+	free_decode_context(&wc->dc);
+	if (wc->filt_data != NULL) {
+		free((void *) wc->filt_data);
+		wc->filt_data = NULL;
+	}
+	if (wc->filt_buffer != NULL) {
+		free((void *) wc->filt_buffer);
+		wc->filt_buffer = NULL;
+	}
+	wc->filt_buffer_samps = 0;
+
+	return;
+}
+
+
+// returns index of block containing segment relative sample number
+si8	find_block(TIME_SERIES_INDEX_m12 *tsi, si8 n_blocks, si8 samp_num)
+{
+	si8	lo, hi, mid;
+
+
+	lo = 0;
+	hi = n_blocks - 1;
+	while (lo < hi) {
+		mid = (lo + hi + 1) >> 1;
+		if (tsi[mid].start_sample_number > samp_num)
+			hi = mid - 1;
+		else
+			lo = mid;
+	}
+
+	return(lo);
+}
+
+
+// decodes segment relative sample range [start_samp, end_samp] into out (in output format), returns samples decoded
+// NOTE: with the block cache enabled, blocks are decompressed into cache storage & converted from there (no extra copy); with it disabled, whole blocks
+// are decompressed directly into out when no conversion is required, & partial blocks & conversions go through a single block buffer, while still in cache
+// blocks are CRC validated if the CRC mode asks for input validation, & encrypted blocks are decrypted in the read buffer (as medlib reads them, with
+// the session's password data); if the data cannot be read, validated, or decrypted, a warning is given & the rest of the range is zeroed
+si8	decode_segment(SEGMENT_m12 *seg, si8 start_samp, si8 end_samp, ui1 *out, si4 format, DECODE_CONTEXT *dc)
+{
+	si1				data_path[FULL_FILE_NAME_BYTES_m12];
+	ui1				*block_ptr;
+	si8				i, n_blocks, start_block, end_block, run_start_block, run_end_block;
+	si8				file_offset, n_bytes, blk_start_samp, blk_samps, first_samp, n_samps, out_samps;
+	ui1				access_level;
+	si1				blk_enc_level;
+	TERN_m12			validate_CRCs;
+	TIME_SERIES_INDEX_m12		*tsi;
+	CMP_FIXED_BLOCK_HEADER_m12	*bh;
+	CMP_PROCESSING_STRUCT_m12	*cps;
+	UNIVERSAL_HEADER_m12		*uh;
+	BLOCK_CACHE_ENTRY		*cached_block, *new_block;
+	mwSize				el_size;
+
+
+	if (end_samp < start_samp)
+		return(0);
+
+	tsi = seg->time_series_indices_fps->time_series_indices;
+	n_blocks = seg->metadata_fps->metadata->time_series_section_2.number_of_blocks;
+	start_block = find_block(tsi, n_blocks, start_samp);
+	end_block = find_block(tsi, n_blocks, end_samp);
+	cps = dc->cps;
+	el_size = format_element_size(format);
+	uh = seg->metadata_fps->universal_header;  // block cache key
+	cps->password_data = seg->metadata_fps->parameters.password_data;
+	access_level = cps->password_data->access_level;  // cached blocks are only used if it covers their encryption
+	validate_CRCs = (globals_m12->CRC_mode & (CRC_VALIDATE_m12 | CRC_VALIDATE_ON_INPUT_m12)) ? TRUE_m12 : FALSE_m12;
+
+	out_samps = 0;
+	for (run_start_block = start_block; run_start_block <= end_block; run_start_block = run_end_block + 1) {
+
+		// cached block
+		cached_block = get_cached_block(uh->channel_UID, uh->segment_number, run_start_block, access_level);
+		if (cached_block != NULL) {
+			first_samp = start_samp - tsi[run_start_block].start_sample_number;
+			if (first_samp < 0)
+				first_samp = 0;
+			n_samps = (end_samp - tsi[run_start_block].start_sample_number + 1) - first_samp;
+			if (n_samps > cached_block->n_samps - first_samp)
+				n_samps = cached_block->n_samps - first_samp;
+			dc->samples_clipped += convert_samples(cached_block->samps + first_samp, out + (out_samps * el_size), n_samps, format);
+			release_cached_block(cached_block);
+			out_samps += n_samps;
+			run_end_block = run_start_block;
+			continue;
+		}
+
+		// open data file (workers keep the last one open, successive tasks are usually in the same segment)
+		sprintf_m12(data_path, "%s/%s.%s", seg->path, seg->name, TIME_SERIES_DATA_FILE_TYPE_STRING_m12);
+		if (dc->fp == NULL || strcmp(data_path, dc->data_path)) {
+			if (dc->fp != NULL)
+				fclose(dc->fp);
+			strcpy(dc->data_path, data_path);
+			dc->fp = fopen_m12(dc->data_path, "r", __FUNCTION__, RETURN_ON_FAIL_m12 | SUPPRESS_OUTPUT_m12);
+			if (dc->fp == NULL) {
+				*dc->data_path = 0;
+				return(decode_segment_failed(seg, "cannot open data file", start_samp, end_samp, out, out_samps, el_size));
+			}
+		}
+
+		// read a run of uncached compressed blocks (terminal index gives end of last block)
+		for (run_end_block = run_start_block; run_end_block < end_block && (run_end_block - run_start_block) + 1 < DECODE_READ_BLOCKS; ++run_end_block)
+			if (block_is_cached(uh->channel_UID, uh->segment_number, run_end_block + 1, access_level) == TRUE_m12)
+				break;
+		file_offset = REMOVE_DISCONTINUITY_m12(tsi[run_start_block].file_offset);
+		n_bytes = REMOVE_DISCONTINUITY_m12(tsi[run_end_block + 1].file_offset) - file_offset;
+		if (n_bytes > dc->compressed_bytes) {
+			dc->compressed_data = (ui1 *) realloc((void *) dc->compressed_data, (size_t) n_bytes);
+			dc->compressed_bytes = n_bytes;
+			cps->compressed_data = dc->compressed_data;
+		}
+		fseek_m12(dc->fp, file_offset, SEEK_SET, dc->data_path, __FUNCTION__, RETURN_ON_FAIL_m12 | SUPPRESS_OUTPUT_m12);
+		if (fread_m12((void *) dc->compressed_data, sizeof(ui1), n_bytes, dc->fp, dc->data_path, __FUNCTION__, RETURN_ON_FAIL_m12 | SUPPRESS_OUTPUT_m12) != n_bytes)
+			return(decode_segment_failed(seg, "cannot read data file", start_samp, end_samp, out, out_samps, el_size));
+		dc->bytes_read += n_bytes;
+		dc->blocks_decoded += (run_end_block - run_start_block) + 1;
+
+		// decode blocks (& cache them)
+		block_ptr = dc->compressed_data;
+		for (i = run_start_block; i <= run_end_block; ++i) {
+			bh = (CMP_FIXED_BLOCK_HEADER_m12 *) block_ptr;
+			if ((si8) bh->total_block_bytes > n_bytes - (block_ptr - dc->compressed_data) || (si8) bh->total_block_bytes < (si8) CMP_BLOCK_CRC_START_OFFSET_m12)
+				return(decode_segment_failed(seg, "invalid block header", start_samp, end_samp, out, out_samps, el_size));
+			if (validate_CRCs == TRUE_m12 && CRC_validate_m12(block_ptr + CMP_BLOCK_CRC_START_OFFSET_m12, (si8) bh->total_block_bytes - CMP_BLOCK_CRC_START_OFFSET_m12, bh->block_CRC) == FALSE_m12)
+				return(decode_segment_failed(seg, "block CRC mismatch", start_samp, end_samp, out, out_samps, el_size));
+			cps->block_header = bh;
+			blk_enc_level = NO_ENCRYPTION_m12;
+			if (bh->block_flags & CMP_BF_ENCRYPTION_MASK_m12) {  // decrypted in place (CRCs are of the encrypted block)
+				blk_enc_level = (bh->block_flags & CMP_BF_LEVEL_2_ENCRYPTION_MASK_m12) ? LEVEL_2_ENCRYPTION_m12 : LEVEL_1_ENCRYPTION_m12;
+				if (CMP_decrypt_m12(cps) == FALSE_m12)
+					return(decode_segment_failed(seg, "password does not give access to encrypted block", start_samp, end_samp, out, out_samps, el_size));
+			}
+			blk_start_samp = tsi[i].start_sample_number;
+			blk_samps = (si8) bh->number_of_samples;
+			first_samp = start_samp - blk_start_samp;
+			if (first_samp < 0)
+				first_samp = 0;
+			n_samps = (end_samp - blk_start_samp + 1) - first_samp;
+			if (n_samps > blk_samps - first_samp)
+				n_samps = blk_samps - first_samp;
+
+			new_block = new_cached_block(uh->channel_UID, uh->segment_number, i, blk_enc_level, blk_samps);
+			if (new_block != NULL) {  // decoded into cache storage
+				cps->decompressed_ptr = new_block->samps;
+				CMP_decode_m12(cps);
+				dc->samples_clipped += convert_samples(new_block->samps + first_samp, out + (out_samps * el_size), n_samps, format);
+				insert_cached_block(new_block);
+			} else if (format == FORMAT_INT32 && n_samps == blk_samps) {  // zero copy
+				cps->decompressed_ptr = (si4 *) (out + (out_samps * el_size));
+				CMP_decode_m12(cps);
+			} else {
+				cps->decompressed_ptr = dc->block_samps;
+				CMP_decode_m12(cps);
+				dc->samples_clipped += convert_samples(dc->block_samps + first_samp, out + (out_samps * el_size), n_samps, format);
+			}
+			out_samps += n_samps;
+			block_ptr += bh->total_block_bytes;
+		}
+	}
+
+	return(out_samps);
+}
+
+
+// warns that a segment range could not be decoded, & zeros its undecoded samples (output buffers may be uninitialized), returns samples decoded
+si8	decode_segment_failed(SEGMENT_m12 *seg, si1 *reason, si8 start_samp, si8 end_samp, ui1 *out, si8 out_samps, mwSize el_size)
+{
+	G_warning_message_m12("%s(): %s of segment \"%s\": samples %ld through %ld (segment relative) are zeros\n", __FUNCTION__, reason, seg->path, (long) (start_samp + out_samps), (long) end_samp);
+	memset((void *) (out + (out_samps * el_size)), 0, (size_t) (((end_samp - start_samp) + 1) - out_samps) * el_size);
+
+	return(out_samps);
+}
+
+
+// returns the number of samples clipped (int16 output)
+si8	convert_samples(si4 *in, ui1 *out, si8 n_samps, si4 format)
+{
+	switch (format) {
+		case FORMAT_DOUBLE:
+			convert_si4_to_sf8(in, (sf8 *) out, n_samps);
+			break;
+		case FORMAT_SINGLE:
+			convert_si4_to_sf4(in, (sf4 *) out, n_samps);
+			break;
+		case FORMAT_INT32:
+			memcpy((void *) out, (void *) in, (size_t) n_samps * sizeof(si4));
+			break;
+		case FORMAT_INT16:
+			return(convert_si4_to_si2(in, (si2 *) out, n_samps));  // curtail overflow
+	}
+
+	return(0);
+}
+
+
+mwSize	format_element_size(si4 format)
+{
+	switch (format) {
+		case FORMAT_DOUBLE:
+			return((mwSize) 8);
+		case FORMAT_SINGLE:
+		case FORMAT_INT32:
+			return((mwSize) 4);
+		case FORMAT_INT16:
+			return((mwSize) 2);
+	}
+
+	return((mwSize) 0);
+}
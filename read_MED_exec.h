@@ -7,6 +7,17 @@
 
 // Includes
 #include "medlib_m12.h"
+#include "sample_conversion.h"
+#include "work_queue.h"
+#include "filter_cache.h"
+#include "prefetch.h"
+#include "session_registry.h"
+#include "block_cache.h"
+#include "stage_timing.h"
+#include "record_journal.h"
+#include "record_query.h"
+#include "record_merge.h"
+#include "record_table.h"
 
 // Version (Read_MED package including read_MED)
 #define READ_MED_VER_MAJOR	((ui1) 1)
@@ -30,6 +41,14 @@
 #define RPS_METADATA_IDX		11
 #define RPS_RECORDS_IDX			12
 #define RPS_CONTIGUA_IDX		13
+#define RPS_PREFETCH_IDX		14
+#define RPS_HANDLE_IDX			15
+#define RPS_BLOCK_CACHE_IDX		16
+#define RPS_TIMING_IDX			17
+#define RPS_RECORD_TYPES_IDX		18
+#define RPS_RECORD_LIMIT_IDX		19
+#define RPS_RECORD_FORMAT_IDX		20
+#define RPS_STREAM_IDX			21
 
 // Extents Modes
 #define EXTENTS_MODE_TIME	0
@@ -41,6 +60,10 @@
 #define	FORMAT_INT32		2
 #define	FORMAT_INT16		3
 
+// Record Formats
+#define RECORD_FORMAT_STRUCT	0  // cell array of record structures
+#define RECORD_FORMAT_TABLE	1  // structure of record columns
+
 // Filter Types
 #define FILT_NONE		0
 #define FILT_LOWPASS		1
@@ -50,26 +73,58 @@
 
 // Persistence
 #define PERSIST_NONE		((ui1) 0)	// read current session (& open if none exists), close after read
-#define PERSIST_OPEN		((ui1) 1)	// close & free any open session, open new session, & return
-#define PERSIST_CLOSE		((ui1) 2)	// close & free any open session & return
-#define PERSIST_READ		((ui1) 4)	// read current session (& open if none exists), replace existing parameters with non-empty passed parameters
-#define PERSIST_READ_NEW	(PERSIST_READ | PERSIST_OPEN)	// close & free any open session, open & read new session, leave open after read
-#define PERSIST_READ_CLOSE	(PERSIST_READ | PERSIST_CLOSE)	// read current session (& open if none exists), close after read
+#define PERSIST_OPEN		((ui1) 1)	// open new session (replacing passed handle's session), & return its handle
+#define PERSIST_CLOSE		((ui1) 2)	// close & free passed handle's (or current) session & return
+#define PERSIST_READ		((ui1) 4)	// read passed handle's (or current) session (& open if none exists), replace existing parameters with non-empty passed parameters
+#define PERSIST_READ_NEW	(PERSIST_READ | PERSIST_OPEN)	// close & free passed handle's (or current) session, open & read new session, leave open after read
+#define PERSIST_READ_CLOSE	(PERSIST_READ | PERSIST_CLOSE)	// read passed handle's (or current) session (& open if none exists), close after read
+
+// Decoding
+#define DECODE_READ_BLOCKS	256	// compressed blocks read per file access
+#define DECODE_TASK_SAMPLES	((si8) 1 << 20)	// target samples per decode task (tasks end on block boundaries)
+
+// Filtering
+#define FILT_TILE_SAMPLES	((si8) 1 << 20)	// minimum samples per filter tile
+#define FILT_PI			((sf8) 3.14159265358979323846)
+#define FILT_SETTLE_NEPERS	((sf8) 25.0)	// decay of tile edge transients before tile centers are kept (e^-25 ~ 1.4e-11)
 
 // Matlab Session Structure
-#define NUMBER_OF_SESSION_FIELDS_mat            5
+#define NUMBER_OF_SESSION_FIELDS_mat            8
 #define SESSION_FIELD_NAMES_mat { \
         "metadata", \
         "channels", \
         "records", \
         "contigua", \
-	"status" \
+	"status", \
+	"handle", \
+	"block_cache", \
+	"timing" \
 }
 #define SESSION_FIELDS_METADATA_IDX_mat         0
 #define SESSION_FIELDS_CHANNELS_IDX_mat         1
 #define SESSION_FIELDS_RECORDS_IDX_mat          2
 #define SESSION_FIELDS_CONTIGUA_IDX_mat         3
 #define SESSION_FIELDS_STATUS_IDX_mat		4
+#define SESSION_FIELDS_HANDLE_IDX_mat		5
+#define SESSION_FIELDS_BLOCK_CACHE_IDX_mat	6
+#define SESSION_FIELDS_TIMING_IDX_mat		7
+
+// Matlab Block Cache Structure (counts since read_MED_exec was loaded)
+#define NUMBER_OF_BLOCK_CACHE_FIELDS_mat	6
+#define BLOCK_CACHE_FIELD_NAMES_mat { \
+	"hits", \
+	"misses", \
+	"evictions", \
+	"blocks", \
+	"bytes", \
+	"budget" \
+}
+#define BLOCK_CACHE_FIELDS_HITS_IDX_mat		0
+#define BLOCK_CACHE_FIELDS_MISSES_IDX_mat	1
+#define BLOCK_CACHE_FIELDS_EVICTIONS_IDX_mat	2
+#define BLOCK_CACHE_FIELDS_BLOCKS_IDX_mat	3
+#define BLOCK_CACHE_FIELDS_BYTES_IDX_mat	4
+#define BLOCK_CACHE_FIELDS_BUDGET_IDX_mat	5
 
 // Matlab Metadata Structure
 #define NUMBER_OF_METADATA_FIELDS_mat           46
@@ -370,22 +425,92 @@
 #define FILTER_ORDER	4
 
 typedef struct {
-	TERN_m12                	metadata, records, contigua;
+	TERN_m12                	metadata, records, contigua, prefetch, timing, stream;
 	void                    	*MED_paths;
 	ui1				persist_mode;
+	si4				handle;  // session registry handle (REGISTRY_NO_HANDLE: current session)
 	si1                     	password[PASSWORD_BYTES_m12 + 1];
 	si1                     	index_channel[FULL_FILE_NAME_BYTES_m12];
-	si4                     	extents_mode, n_files, filter, format;
+	si4                     	extents_mode, n_files, filter, format, record_format;
 	si8                     	start_time, end_time, start_index, end_index;
 	sf8				low_cutoff, high_cutoff;
+	RECORD_QUERY			record_query;  // types & limit (window is the slice)
 } C_RPS;
 
 typedef struct {
-	CHANNEL_m12	*channel;
-	C_RPS		*crps;
-	mxArray		*samples;
+	FILE				*fp;
+	si1				data_path[FULL_FILE_NAME_BYTES_m12];
+	ui1				*compressed_data;
+	si8				compressed_bytes;
+	si4				*block_samps;  // single block buffer for partial blocks & conversions
+	si8				max_block_samps;
+	CMP_PROCESSING_STRUCT_m12	*cps;
+	si8				bytes_read, blocks_decoded;  // running totals (cache hits are neither)
+	si8				samples_clipped;  // running total (integer outputs saturated by conversion)
+} DECODE_CONTEXT;
+
+typedef struct {
+	DECODE_CONTEXT			dc;
+	sf8				*filt_data, *filt_buffer;  // tile samples, padding, & overlap
+	si8				filt_buffer_samps;
+} WORKER_CONTEXT;
+
+typedef struct {
+	si1				chan_path[FULL_FILE_NAME_BYTES_m12];
+	si8				next_samp;  // absolute sample number following the last read (a read starting here continues the filter)
+	si8				n_tail_samps;
+	sf8				*tail;  // unfiltered samples preceding next_samp
+} FILT_STREAM;
+
+typedef struct {
+	CHANNEL_m12			*channel;
+	C_RPS				*crps;
+	FILT_PROCESSING_STRUCT_m12	*filt_design;  // shared, read only (filter cache)
+	si8				overlap_samps;  // tile extension on each side
+	FILT_STREAM			*stream;  // persistent sessions only
+	si8				context_samps, lookahead_samps;  // unfiltered samples available before (stream tail) & after (in last segment) the slice
+	si8				n_new_tail_samps;
+	sf8				*new_tail;  // set by last tile, replaces stream tail after filtering
+	si8				data_len;
+	ui1				*out;  // decode destination (Matlab array data, or prefetch buffer)
+	mxArray				*samples;
+	sf8				decode_seconds, filter_seconds;  // summed over the channel's tasks (timing only)
+	si8				bytes_read, blocks_decoded;
+	si8				samples_clipped;  // outside the output format's range (saturated at its infinities)
 } JOB_INFO;
 
+typedef struct {
+	JOB_INFO			*job;
+	SEGMENT_m12			*segment;
+	si8				start_samp, end_samp;  // segment relative
+	si4				format;
+	ui1				*out;
+	WORKER_CONTEXT			*contexts;  // one per worker
+	sf8				decode_seconds;  // timing only
+	si8				bytes_read, blocks_decoded, samples_clipped;
+} DECODE_TASK;
+
+typedef struct {
+	JOB_INFO			*job;
+	si8				start_samp, end_samp;  // slice relative
+	WORKER_CONTEXT			*contexts;  // one per worker
+	sf8				decode_seconds, filter_seconds;  // timing only
+	si8				bytes_read, blocks_decoded, samples_clipped;
+} FILTER_TILE;
+
+typedef struct {
+	C_RPS				crps;  // predicted page (MED_paths not used)
+	REGISTRY_ENTRY			*entry;  // session read (NULL: no prefetch)
+	ui8				flags;
+	TERN_m12			ready;  // session read & channels decoded
+	TERN_m12			read_failed;  // session read failed (session state unknown)
+	si4				n_jobs;
+	JOB_INFO			*jobs;  // outputs in buffers
+	si4				n_buffers;  // one per active channel, in job order
+	ui1				**buffers;  // mxMalloced (persistent) on the calling thread, adopted by Matlab arrays (NULL once adopted)
+	si8				*buffer_samps;  // capacities
+} READ_PREFETCH;
+
 
 // Prototypes
 void			mexExitFunction(void);
@@ -396,10 +521,42 @@ mxArray     		*read_MED(C_RPS *crps);
 void			build_channel_names(SESSION_m12 *sess, mxArray *mat_sess);
 void    		build_metadata(SESSION_m12 *sess, mxArray *mat_session);
 void			build_contigua(SESSION_m12 *sess, mxArray *mat_session);
-void           		build_session_records(SESSION_m12 *sess, mxArray *mat_session);
+void			build_block_cache_stats(mxArray *mat_sess);
+void			build_timing(STAGE_TIMING *st, JOB_INFO *jobs, si4 n_jobs, mxArray *mat_sess);
+void           		build_session_records(SESSION_m12 *sess, si4 record_format, mxArray *mat_session);
+void			build_queried_records(SESSION_m12 *sess, RECORD_QUERY *rq, si4 record_format, mxArray *mat_sess);
 mxArray         	*fill_record(RECORD_HEADER_m12 *rh);
-si4             	rec_compare(const void *a, const void *b);
-pthread_rval_m12	distribute_and_filter(void *ptr);
+JOB_INFO		*create_jobs(SESSION_m12 *sess, C_RPS *crps, si4 *n_jobs);
+void			initialize_job(JOB_INFO *job);
+mxArray			*create_samples_array(si8 data_len, si4 format);
+void			decode_jobs(JOB_INFO *jobs, si4 n_jobs);
+DECODE_TASK		*build_decode_tasks(JOB_INFO *jobs, si4 n_jobs, si8 *n_tasks);
+FILTER_TILE		*build_filter_tiles(JOB_INFO *jobs, si4 n_jobs, si8 *n_tiles);
+si8			filter_overlap(si4 filt_type, sf8 samp_freq, sf8 cut_1, sf8 cut_2);
+void			decode_task(void *arg, si4 worker_id);
+void			filter_task(void *arg, si4 worker_id);
+si8			decode_channel_range(CHANNEL_m12 *chan, si8 start_samp, si8 end_samp, ui1 *out, si4 format, DECODE_CONTEXT *dc);
+void			load_filter_range(JOB_INFO *job, si8 start_samp, si8 end_samp, sf8 *out, DECODE_CONTEXT *dc);
+FILT_STREAM		*get_filter_stream(JOB_INFO *job);
+void			update_filter_stream(JOB_INFO *job);
+void			free_filter_streams(SESSION_m12 *sess);
+void			start_read_prefetch(C_RPS *crps, ui8 flags, REGISTRY_ENTRY *entry);
+pthread_rval_m12	read_prefetch_thread(void *ptr);
+TERN_m12		same_page(C_RPS *crps_1, C_RPS *crps_2);
+void			discard_prefetch(void);
+TERN_m12		prefetch_buffer_output(READ_PREFETCH *pf, si4 i, ui1 *out);
+void			free_prefetch_buffers(void);
+sf8			current_sampling_frequency(CHANNEL_m12 *chan);
+void			free_registry_entry(REGISTRY_ENTRY *entry);
+TERN_m12		prepare_segment_indices(SEGMENT_m12 *seg);
+TERN_m12		size_decode_context(DECODE_CONTEXT *dc, SEGMENT_m12 *seg);
+void			free_decode_context(DECODE_CONTEXT *dc);
+void			free_worker_context(WORKER_CONTEXT *wc);
+si8			find_block(TIME_SERIES_INDEX_m12 *tsi, si8 n_blocks, si8 samp_num);
+si8			decode_segment(SEGMENT_m12 *seg, si8 start_samp, si8 end_samp, ui1 *out, si4 format, DECODE_CONTEXT *dc);
+si8			decode_segment_failed(SEGMENT_m12 *seg, si1 *reason, si8 start_samp, si8 end_samp, ui1 *out, si8 out_samps, mwSize el_size);
+si8			convert_samples(si4 *in, ui1 *out, si8 n_samps, si4 format);
+mwSize			format_element_size(si4 format);
 
 
 #endif /* READ_MED_IN */
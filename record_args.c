@@ -0,0 +1,128 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Record arguments
+// Builds new records from the Matlab arguments of add_record_exec() & matrix_MED_exec(mps, 'add_record', ...), so both entry points accept the same
+// arguments & report the same errors. rec_type, rec_text, & encryption_level may have an entry per record time (cell arrays for strings), or one
+// entry shared by all records (a string, or a one element cell array).
+
+
+#include "record_args.h"
+
+
+// returns records (free with free_new_records()), or NULL with the reason in message (RECORD_ARGS_MESSAGE_BYTES)
+NEW_RECORD	*get_new_records(const mxArray *mx_types, const mxArray *mx_times, const mxArray *mx_texts, const mxArray *mx_levels, si8 *n_recs, si1 *message)
+{
+	si8		i, n_types, n_texts, n_levels, len;
+	const mxArray	*mx_p;
+	NEW_RECORD	*recs;
+
+
+	*n_recs = 0;
+	if (mxIsEmpty(mx_times) == 1) {
+		strcpy(message, "No record time specified\n");
+		return(NULL);
+	}
+	if (mxIsEmpty(mx_texts) == 1) {
+		strcpy(message, "No record text specified\n");
+		return(NULL);
+	}
+	if (mxIsEmpty(mx_levels) == 1) {
+		strcpy(message, "No encryption level specified\n");
+		return(NULL);
+	}
+
+	// one entry, or one entry per record time
+	n_types = (mxGetClassID(mx_types) == mxCELL_CLASS) ? (si8) mxGetNumberOfElements(mx_types) : 1;
+	n_texts = (mxGetClassID(mx_texts) == mxCELL_CLASS) ? (si8) mxGetNumberOfElements(mx_texts) : 1;
+	n_levels = (si8) mxGetNumberOfElements(mx_levels);
+	*n_recs = (si8) mxGetNumberOfElements(mx_times);
+	if ((n_types != 1 && n_types != *n_recs) || (n_texts != 1 && n_texts != *n_recs) || (n_levels != 1 && n_levels != *n_recs)) {
+		strcpy(message, "Record types, texts, & encryption levels must have one entry, or one entry per record time\n");
+		return(NULL);
+	}
+
+	recs = (NEW_RECORD *) calloc((size_t) *n_recs, sizeof(NEW_RECORD));
+	for (i = 0; i < *n_recs; ++i) {
+		recs[i].order = i;
+		recs[i].time = get_si8_element(mx_times, i);
+		recs[i].enc_level = (si1) get_si8_element(mx_levels, (n_levels == 1) ? 0 : i);
+
+		// rec type
+		mx_p = get_record_arg(mx_types, n_types, i);
+		if (mx_p != NULL && mxIsEmpty(mx_p) == 0) {
+			if (mxGetClassID(mx_p) != mxCHAR_CLASS) {
+				strcpy(message, "Record type must be a string\n");
+				free_new_records(recs, *n_recs);
+				return(NULL);
+			}
+			len = mxGetNumberOfElements(mx_p) + 1;  // get the length of the input string
+			if (len > TYPE_BYTES_m12) {
+				strcpy(message, "Record type is too long (types are four characters, e.g. \"Note\")\n");
+				free_new_records(recs, *n_recs);
+				return(NULL);
+			}
+			mxGetString(mx_p, recs[i].type, len);
+		}
+
+		// rec text
+		mx_p = get_record_arg(mx_texts, n_texts, i);
+		len = 1;
+		if (mx_p != NULL) {
+			if (mxGetClassID(mx_p) != mxCHAR_CLASS) {
+				strcpy(message, "Record text must be a string\n");
+				free_new_records(recs, *n_recs);
+				return(NULL);
+			}
+			len = mxGetNumberOfElements(mx_p) + 1;  // get the length of the input string
+		}
+		recs[i].text = calloc((size_t) len, sizeof(si1));
+		if (mx_p != NULL)
+			mxGetString(mx_p, recs[i].text, len);
+	}
+
+	return(recs);
+}
+
+
+// record's entry of a string argument: the argument itself, or its cell (a one element cell array is shared by all records)
+const mxArray	*get_record_arg(const mxArray *mx_arr, si8 n_entries, si8 idx)
+{
+	if (mxGetClassID(mx_arr) != mxCELL_CLASS)
+		return(mx_arr);
+
+	return(mxGetCell(mx_arr, (mwIndex) ((n_entries == 1) ? 0 : idx)));
+}
+
+
+si8	get_si8_element(const mxArray *mx_arr, si8 idx)
+{
+	switch (mxGetClassID(mx_arr)) {
+		case mxDOUBLE_CLASS:
+			return((si8) round(((sf8 *) mxGetData(mx_arr))[idx]));
+		case mxSINGLE_CLASS:
+			return((si8) round(((sf4 *) mxGetData(mx_arr))[idx]));
+		case mxCHAR_CLASS:
+			return((si8) ((mxChar *) mxGetData(mx_arr))[idx]);
+		case mxINT8_CLASS:
+			return((si8) ((si1 *) mxGetData(mx_arr))[idx]);
+		case mxUINT8_CLASS:
+			return((si8) ((ui1 *) mxGetData(mx_arr))[idx]);
+		case mxINT16_CLASS:
+			return((si8) ((si2 *) mxGetData(mx_arr))[idx]);
+		case mxUINT16_CLASS:
+			return((si8) ((ui2 *) mxGetData(mx_arr))[idx]);
+		case mxINT32_CLASS:
+			return((si8) ((si4 *) mxGetData(mx_arr))[idx]);
+		case mxUINT32_CLASS:
+			return((si8) ((ui4 *) mxGetData(mx_arr))[idx]);
+		case mxINT64_CLASS:
+			return(((si8 *) mxGetData(mx_arr))[idx]);
+		case mxUINT64_CLASS:
+			return((si8) ((ui8 *) mxGetData(mx_arr))[idx]);
+		case mxLOGICAL_CLASS:
+			return((((mxLogical *) mxGetData(mx_arr))[idx]) ? (si8) 1 : (si8) 0);
+		default:
+			return((si8) UUTC_NO_ENTRY_m12);
+	}
+}
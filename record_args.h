@@ -0,0 +1,21 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+#ifndef RECORD_ARGS_IN
+#define RECORD_ARGS_IN
+
+// Includes
+#include "medlib_m12.h"
+#include "record_edit.h"
+
+// Miscellaneous
+#define RECORD_ARGS_MESSAGE_BYTES	256
+
+
+// Prototypes
+NEW_RECORD	*get_new_records(const mxArray *mx_types, const mxArray *mx_times, const mxArray *mx_texts, const mxArray *mx_levels, si8 *n_recs, si1 *message);
+const mxArray	*get_record_arg(const mxArray *mx_arr, si8 n_entries, si8 idx);
+si8		get_si8_element(const mxArray *mx_arr, si8 idx);
+
+
+#endif /* RECORD_ARGS_IN */
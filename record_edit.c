@@ -0,0 +1,248 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Record editing
+// Adds & deletes segmented session records of an open session: add_record_exec() & delete_record_exec() open a session for one edit, & matrix_MED_exec()
+// edits the records of its persistent session, so viewers can annotate without closing & reopening their session.
+// Edits are journaled (record_journal.c): the session's record files (& its copies of them) are unchanged, & record readers merge the journal. When
+// a segment's journal is full, it is compacted with the edit, & the session's copies of that segment's record files are released (they are read again
+// by the next read of the segment). A journal is only compacted if the session has the segment's metadata (its record files' prototype): persistent
+// sessions may not have read it, & then the edit is journaled, & compacted later.
+
+
+#include "record_edit.h"
+
+
+// adds records to the open session, returns 0.0 on success, -1.0 on failure, -2.0 if the password does not give access to a record's encryption level
+// every segment's files are checked before any are written (a write error part way through can still leave earlier segments' records added)
+sf8	add_session_records(SESSION_m12 *sess, NEW_RECORD *recs, si8 n_recs)
+{
+	si1			max_enc_level;
+	si8			i, j;
+	sf8			success;
+	TERN_m12		*compact;
+	RECORD_HEADER_m12	**rec_ptrs;
+	SEGMENT_RECORD_FILES	srf;
+
+
+	// highest encryption level
+	max_enc_level = recs[0].enc_level;
+	for (i = 1; i < n_recs; ++i)
+		if (recs[i].enc_level > max_enc_level)
+			max_enc_level = recs[i].enc_level;
+	if (globals_m12->password_data.access_level < max_enc_level) {
+		G_warning_message_m12("%s(): password not valid for this encryption level\n", __FUNCTION__);
+		G_show_password_hints_m12(NULL, max_enc_level);
+		putchar_m12('\n');
+		return(-2.0);
+	}
+
+	// build records (before any files are written) & find their segments (as a single record open would)
+	for (i = 0; i < n_recs; ++i) {
+		if (build_new_record(recs + i) == FALSE_m12) {
+			G_warning_message_m12("%s(): unrecognized record type\n", __FUNCTION__);
+			return(-1.0);
+		}
+		recs[i].segment_number = record_segment_number(sess, recs[i].time);
+	}
+
+	// group by segment (time ordered, input order for equal times)
+	qsort((void *) recs, (size_t) n_recs, sizeof(NEW_RECORD), compare_new_records);
+
+	// check every segment before writing anything: journal each segment's records, or compact journals that would be full
+	compact = (TERN_m12 *) calloc((size_t) n_recs, sizeof(TERN_m12));  // by segment's first record
+	for (i = 0; i < n_recs; i = j) {
+		for (j = i + 1; j < n_recs; ++j)
+			if (recs[j].segment_number != recs[i].segment_number)
+				break;
+		find_segment_record_files(sess, recs[i].segment_number, &srf);
+		if (journal_entries(&srf) + (j - i) < RJNL_COMPACT_ENTRIES || segment_prototype(sess, recs[i].segment_number) == NULL)
+			compact[i] = FALSE_m12;
+		else
+			compact[i] = TRUE_m12;
+		if (segment_records_writable(&srf, compact[i]) == FALSE_m12) {
+			G_warning_message_m12("%s(): cannot write records of segment %d (no records were added)\n", __FUNCTION__, recs[i].segment_number);
+			free((void *) compact);
+			return(-1.0);
+		}
+	}
+
+	// write
+	success = 0.0;
+	rec_ptrs = (RECORD_HEADER_m12 **) malloc((size_t) n_recs * sizeof(RECORD_HEADER_m12 *));
+	for (i = 0; i < n_recs; ++i)
+		rec_ptrs[i] = (RECORD_HEADER_m12 *) recs[i].bytes;
+	for (i = 0; i < n_recs; i = j) {
+		for (j = i + 1; j < n_recs; ++j)
+			if (recs[j].segment_number != recs[i].segment_number)
+				break;
+		find_segment_record_files(sess, recs[i].segment_number, &srf);
+		if (compact[i] == FALSE_m12) {
+			if (append_journal_records(&srf, rec_ptrs + i, j - i) == FALSE_m12) {
+				G_warning_message_m12("%s(): cannot write record journal of segment %d\n", __FUNCTION__, recs[i].segment_number);
+				success = -1.0;
+			}
+		} else {
+			success = compact_segment_records(sess, recs[i].segment_number, rec_ptrs + i, j - i);
+		}
+		if (success < 0.0)
+			break;
+	}
+	free((void *) rec_ptrs);
+	free((void *) compact);
+
+	return(success);
+}
+
+
+// deletes the first record with rec_time & rec_type from the open session (segmented session records only)
+// returns 0.0 on success, -1.0 on failure (or if there is no such record), -2.0 if the password does not give access to the record's encryption level
+sf8	delete_session_record(SESSION_m12 *sess, si8 rec_time, ui4 rec_type)
+{
+	si8				i, n_recs;
+	sf8				success;
+	FILE_PROCESSING_STRUCT_m12	*ri_fps;
+	RECORD_JOURNAL			*jnl;
+	SEGMENT_RECORD			*recs;
+	SEGMENT_RECORD_FILES		srf;
+
+
+	// find segment's records
+	find_segment_record_files(sess, record_segment_number(sess, rec_time), &srf);
+	if (srf.ssr_exists == FALSE_m12) {  // no ssr directory
+		G_warning_message_m12("%s(): can only delete segmented session records at this time\n", __FUNCTION__);
+		putchar_m12('\n');
+		return(-1.0);
+	}
+	ri_fps = NULL;
+	if (srf.records_exist == TRUE_m12)
+		ri_fps = G_read_file_m12(NULL, srf.ri_file, 0, 0, FPS_FULL_FILE_m12, NULL, NULL, USE_GLOBAL_BEHAVIOR_m12);
+	jnl = read_record_journal(srf.journal_file);
+	if (ri_fps == NULL && jnl == NULL) {  // no records for this segment
+		G_warning_message_m12("%s(): segmented records not found for this segment\n", __FUNCTION__);
+		putchar_m12('\n');
+		return(-1.0);
+	}
+
+	// find first live record (indices & journal only: record data is not needed)
+	recs = collect_segment_records(ri_fps, NULL, jnl, NULL, 0, &n_recs);
+	for (i = 0; i < n_recs; ++i)
+		if (recs[i].live == TRUE_m12 && recs[i].ri.start_time == rec_time && recs[i].ri.type_code == rec_type)
+			break;
+	success = 0.0;
+	if (i == n_recs) {  // record not found in segmented session records
+		G_warning_message_m12("%s(): record not found\n", __FUNCTION__);
+		success = -1.0;
+	} else if (globals_m12->password_data.access_level < recs[i].ri.encryption_level) {  // insufficient access to delete
+		G_warning_message_m12("%s(): insufficient access to delete this record\n", __FUNCTION__);
+		G_show_password_hints_m12(NULL, recs[i].ri.encryption_level);
+		success = -2.0;
+	}
+	free((void *) recs);
+	free_record_journal(jnl);
+	FPS_free_processing_struct_m12(ri_fps, TRUE_m12);
+
+	// journal the deletion (compact journals that are full)
+	if (success == 0.0) {
+		if (append_journal_tombstone(&srf, rec_time, rec_type) == FALSE_m12) {
+			G_warning_message_m12("%s(): cannot write record journal of segment %d\n", __FUNCTION__, srf.segment_number);
+			success = -1.0;
+		} else if (journal_entries(&srf) >= RJNL_COMPACT_ENTRIES && segment_prototype(sess, srf.segment_number) != NULL) {
+			success = compact_segment_records(sess, srf.segment_number, NULL, 0);
+		}
+	}
+
+	return(success);
+}
+
+
+// returns number of the session segment containing rec_time (or the segment medlib assigns a time between segments)
+si4	record_segment_number(SESSION_m12 *sess, si8 rec_time)
+{
+	TIME_SLICE_m12	slice;
+
+
+	G_initialize_time_slice_m12(&slice);
+	slice.start_time = slice.end_time = rec_time;
+	G_condition_time_slice_m12(&slice);
+	G_get_segment_range_m12((LEVEL_HEADER_m12 *) sess, &slice);
+
+	return(slice.start_segment_number);
+}
+
+
+// builds record header & body, returns FALSE_m12 for unrecognized record types
+TERN_m12	build_new_record(NEW_RECORD *rec)
+{
+	si1				*rec_str;
+	si8				text_len;
+	RECORD_HEADER_m12		*nrh;
+	REC_Seiz_v10_m12		*Seiz_v10;
+
+
+	text_len = strlen(rec->text) + 1;  // account for terminal zero
+	if (strcmp(rec->type, "Note") == 0) {
+		rec->bytes = (ui1 *) calloc((size_t) (RECORD_HEADER_BYTES_m12 + text_len + REC_RECORD_BODY_ALIGNMENT_m12), sizeof(ui1));  // leave room for padding
+		nrh = (RECORD_HEADER_m12 *) rec->bytes;
+		nrh->type_code = REC_Note_TYPE_CODE_m12;
+		nrh->version_major = 1;
+		nrh->version_minor = 0;
+		nrh->start_time = rec->time;
+		nrh->encryption_level = -rec->enc_level;
+		rec_str = (si1 *) nrh + RECORD_HEADER_BYTES_m12;
+		strcpy(rec_str, rec->text);
+		nrh->total_record_bytes = (ui4) G_pad_m12((ui1 *) rec_str, text_len, REC_RECORD_BODY_ALIGNMENT_m12) + RECORD_HEADER_BYTES_m12;
+	} else if (strcmp(rec->type, "Seiz") == 0) {
+		text_len -= REC_Seiz_v10_PAD_BYTES_m12;  // first 8 bytes of string within structure
+		if (text_len < 0)
+			text_len = 0;
+		rec->bytes = (ui1 *) calloc((size_t) (RECORD_HEADER_BYTES_m12 + REC_Seiz_v10_DESCRIPTION_OFFSET_m12 + text_len + REC_RECORD_BODY_ALIGNMENT_m12), sizeof(ui1));  // leave room for padding
+		nrh = (RECORD_HEADER_m12 *) rec->bytes;
+		nrh->type_code = REC_Seiz_TYPE_CODE_m12;
+		nrh->version_major = 1;
+		nrh->version_minor = 0;
+		nrh->start_time = rec->time;
+		nrh->encryption_level = -rec->enc_level;
+		Seiz_v10 = (REC_Seiz_v10_m12 *) (nrh + 1);
+		Seiz_v10->end_time = UUTC_NO_ENTRY_m12;  // no option to enter seizure end time in this version
+		strcpy(Seiz_v10->description, rec->text);
+		nrh->total_record_bytes = (ui4) G_pad_m12((ui1 *) (nrh + 1), REC_Seiz_v10_BYTES_m12 + text_len, REC_RECORD_BODY_ALIGNMENT_m12) + RECORD_HEADER_BYTES_m12;
+	} else {
+		return(FALSE_m12);
+	}
+
+	return(TRUE_m12);
+}
+
+
+si4	compare_new_records(const void *a, const void *b)
+{
+	NEW_RECORD	*rec_a, *rec_b;
+
+
+	rec_a = (NEW_RECORD *) a;
+	rec_b = (NEW_RECORD *) b;
+	if (rec_a->segment_number != rec_b->segment_number)
+		return((rec_a->segment_number > rec_b->segment_number) ? 1 : -1);
+	if (rec_a->time != rec_b->time)
+		return((rec_a->time > rec_b->time) ? 1 : -1);
+	if (rec_a->order != rec_b->order)
+		return((rec_a->order > rec_b->order) ? 1 : -1);
+
+	return(0);
+}
+
+
+void	free_new_records(NEW_RECORD *recs, si8 n_recs)
+{
+	si8	i;
+
+
+	for (i = 0; i < n_recs; ++i) {
+		free((void *) recs[i].text);
+		free((void *) recs[i].bytes);
+	}
+	free((void *) recs);
+
+	return;
+}
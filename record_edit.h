@@ -0,0 +1,32 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+#ifndef RECORD_EDIT_IN
+#define RECORD_EDIT_IN
+
+// Includes
+#include "medlib_m12.h"
+#include "record_journal.h"
+
+// Record Edit Structures
+typedef struct {
+	si1			type[TYPE_BYTES_m12];
+	si8			time;
+	si1			*text;
+	si1			enc_level;
+	si4			segment_number;
+	si8			order;  // input order (kept for equal times)
+	ui1			*bytes;  // record header & body
+} NEW_RECORD;
+
+
+// Prototypes
+sf8		add_session_records(SESSION_m12 *sess, NEW_RECORD *recs, si8 n_recs);
+sf8		delete_session_record(SESSION_m12 *sess, si8 rec_time, ui4 rec_type);
+si4		record_segment_number(SESSION_m12 *sess, si8 rec_time);
+TERN_m12	build_new_record(NEW_RECORD *rec);
+si4		compare_new_records(const void *a, const void *b);
+void		free_new_records(NEW_RECORD *recs, si8 n_recs);
+
+
+#endif /* RECORD_EDIT_IN */
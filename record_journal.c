@@ -0,0 +1,983 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Record journal
+// Adding or deleting a segmented session record rewrote the segment's record files (.ridx & .rdat), so each edit cost O(records in segment).
+// Edits are now appended to a journal next to the record files (<session>_s<segment>.rjnl, in the segmented session records directory): appended records
+// (header & body, as they are written to the record data file), & tombstones (start time & type code of a record to delete). Readers merge a segment's
+// journal with its record files. Compaction folds the journal into the record files (one rewrite), & removes it, so compacted sessions are plain MED.
+// Entries are committed by rewriting the journal header (entry count & length) after they are written: readers ignore entries an interrupted writer
+// did not commit, & the next writer truncates them before appending. Writers count a journal's entries from its header.
+// Writers compact a journal that reaches RJNL_COMPACT_ENTRIES entries, & compact_records_exec() compacts all of a session's journals.
+// Journaled edits have the same results as rewriting: an added record follows records with the same or earlier times, & a tombstone deletes the first
+// (earliest added) record with its start time & type. Journaled record bodies are encrypted at their levels when appended (as medlib encrypts records
+// written to the record data file), & decrypted when the journal is read if the password gives access (as medlib decrypts record data it reads).
+
+
+#include "record_journal.h"
+
+#if defined MACOS_m12 || defined LINUX_m12
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+#ifdef WINDOWS_m12
+	#include <io.h>
+#endif
+
+
+// finds segment's record files (file system session name first, as medlib does), & sets the names new files would have if there are none
+void	find_segment_record_files(SESSION_m12 *sess, si4 segment_number, SEGMENT_RECORD_FILES *srf)
+{
+	si1	number_str[FILE_NUMBERING_DIGITS_m12 + 1], *sess_name, *ssr_name;
+	si4	fe;
+
+
+	srf->segment_number = segment_number;
+	G_numerical_fixed_width_string_m12(number_str, FILE_NUMBERING_DIGITS_m12, segment_number);
+
+	sess_name = globals_m12->fs_session_name;
+	sprintf_m12(srf->ssr_path, "%s/%s.%s", sess->path, sess_name, RECORD_DIRECTORY_TYPE_STRING_m12);
+	fe = G_exists_m12(srf->ssr_path);
+	if (fe == DOES_NOT_EXIST_m12) {
+		sess_name = globals_m12->uh_session_name;
+		sprintf_m12(srf->ssr_path, "%s/%s.%s", sess->path, sess_name, RECORD_DIRECTORY_TYPE_STRING_m12);
+		fe = G_exists_m12(srf->ssr_path);
+	}
+	srf->ssr_exists = (fe == DIR_EXISTS_m12) ? TRUE_m12 : FALSE_m12;
+	ssr_name = globals_m12->fs_session_name;
+	if (srf->ssr_exists == TRUE_m12) {
+		sprintf_m12(srf->ri_file, "%s/%s_s%s.%s", srf->ssr_path, ssr_name, number_str, RECORD_INDICES_FILE_TYPE_STRING_m12);
+		fe = G_exists_m12(srf->ri_file);
+		if (fe == DOES_NOT_EXIST_m12) {
+			ssr_name = globals_m12->uh_session_name;
+			sprintf_m12(srf->ri_file, "%s/%s_s%s.%s", srf->ssr_path, ssr_name, number_str, RECORD_INDICES_FILE_TYPE_STRING_m12);
+			fe = G_exists_m12(srf->ri_file);
+		}
+	} else {
+		fe = DOES_NOT_EXIST_m12;
+	}
+	if (fe == DOES_NOT_EXIST_m12) {  // new files
+		ssr_name = sess_name = globals_m12->fs_session_name;
+		sprintf_m12(srf->ssr_path, "%s/%s.%s", sess->path, sess_name, RECORD_DIRECTORY_TYPE_STRING_m12);
+		sprintf_m12(srf->ri_file, "%s/%s_s%s.%s", srf->ssr_path, ssr_name, number_str, RECORD_INDICES_FILE_TYPE_STRING_m12);
+		srf->records_exist = FALSE_m12;
+	} else {
+		srf->records_exist = TRUE_m12;
+	}
+	sprintf_m12(srf->rd_file, "%s/%s_s%s.%s", srf->ssr_path, ssr_name, number_str, RECORD_DATA_FILE_TYPE_STRING_m12);
+	sprintf_m12(srf->journal_file, "%s/%s_s%s.%s", srf->ssr_path, ssr_name, number_str, RJNL_FILE_TYPE_STRING);
+	sprintf_m12(srf->tmp_ri_file, "%s/tmp_%s_s%s.%s", srf->ssr_path, ssr_name, number_str, RECORD_INDICES_FILE_TYPE_STRING_m12);
+	sprintf_m12(srf->tmp_rd_file, "%s/tmp_%s_s%s.%s", srf->ssr_path, ssr_name, number_str, RECORD_DATA_FILE_TYPE_STRING_m12);
+	sprintf_m12(srf->bak_ri_file, "%s/bak_%s_s%s.%s", srf->ssr_path, ssr_name, number_str, RECORD_INDICES_FILE_TYPE_STRING_m12);
+	sprintf_m12(srf->bak_rd_file, "%s/bak_%s_s%s.%s", srf->ssr_path, ssr_name, number_str, RECORD_DATA_FILE_TYPE_STRING_m12);
+
+	return;
+}
+
+
+// returns journal, or NULL if there is none (or it is not a journal)
+RECORD_JOURNAL	*read_record_journal(si1 *journal_file)
+{
+	si8		file_bytes, offset;
+	FILE		*fp;
+	RJNL_HEADER	*hdr;
+	RJNL_ENTRY	*entry;
+	RECORD_JOURNAL	*jnl;
+
+
+	fp = fopen(journal_file, "rb");
+	if (fp == NULL)
+		return(NULL);
+	fseek(fp, 0, SEEK_END);
+	file_bytes = (si8) ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	if (file_bytes < (si8) sizeof(RJNL_HEADER)) {
+		fclose(fp);
+		return(NULL);
+	}
+	jnl = (RECORD_JOURNAL *) calloc((size_t) 1, sizeof(RECORD_JOURNAL));
+	jnl->data = (ui1 *) malloc((size_t) file_bytes);
+	if ((si8) fread((void *) jnl->data, sizeof(ui1), (size_t) file_bytes, fp) != file_bytes)
+		file_bytes = 0;
+	fclose(fp);
+	hdr = (RJNL_HEADER *) jnl->data;
+	if (file_bytes == 0 || hdr->magic != RJNL_MAGIC || hdr->version != RJNL_VERSION) {
+		free_record_journal(jnl);
+		return(NULL);
+	}
+	if (hdr->data_bytes < file_bytes)  // bytes beyond were not completely written
+		file_bytes = hdr->data_bytes;
+
+	// complete entries (checked: the header may be written before the entries reach the disk)
+	offset = (si8) sizeof(RJNL_HEADER);
+	while (offset + (si8) sizeof(RJNL_ENTRY) <= file_bytes) {
+		entry = (RJNL_ENTRY *) (jnl->data + offset);
+		if (offset + (si8) sizeof(RJNL_ENTRY) + (si8) entry->record_bytes > file_bytes)
+			break;
+		offset += (si8) sizeof(RJNL_ENTRY) + (si8) entry->record_bytes;
+		++jnl->number_of_entries;
+		if (entry->op == RJNL_APPEND)
+			++jnl->number_of_appends;
+	}
+	jnl->data_bytes = offset;
+
+	// decrypt appended records (records the password does not give access to stay encrypted)
+	for (entry = next_journal_entry(jnl, NULL); entry != NULL; entry = next_journal_entry(jnl, entry))
+		if (entry->op == RJNL_APPEND)
+			decrypt_journal_record((RECORD_HEADER_m12 *) (entry + 1));
+
+	return(jnl);
+}
+
+
+void	free_record_journal(RECORD_JOURNAL *jnl)
+{
+	if (jnl == NULL)
+		return;
+
+	free((void *) jnl->data);
+	free((void *) jnl);
+
+	return;
+}
+
+
+// returns first entry if entry is NULL, else the entry following it (NULL at end)
+RJNL_ENTRY	*next_journal_entry(RECORD_JOURNAL *jnl, RJNL_ENTRY *entry)
+{
+	si8	offset;
+
+
+	if (entry == NULL)
+		offset = (si8) sizeof(RJNL_HEADER);
+	else
+		offset = ((ui1 *) entry - jnl->data) + (si8) sizeof(RJNL_ENTRY) + (si8) entry->record_bytes;
+	if (offset >= jnl->data_bytes)
+		return(NULL);
+
+	return((RJNL_ENTRY *) (jnl->data + offset));
+}
+
+
+// merges segment's journal with its records in one pass: recs[0] through recs[n_recs - 1] are the segment's record file records (time ordered),
+// merged receives the live records in time order (equal times: record files' records, then journaled records as added), & must have room for n_recs
+// & the journal's appends (merged & recs may not overlap), returns number of merged records
+// journaled records are limited to start times from start_time through end_time (the time slice: recs are the slice's records)
+si8	merge_record_journal(RECORD_JOURNAL *jnl, RECORD_HEADER_m12 **recs, si8 n_recs, RECORD_HEADER_m12 **merged, si8 start_time, si8 end_time)
+{
+	si8		i, j, k, n_edits, n_merged, n_kept, group_first, t;
+	TERN_m12	deleted;
+	RJNL_ENTRY	*entry;
+	RJNL_EDIT	*edits;
+
+
+	if (jnl == NULL || jnl->number_of_entries == 0) {
+		memcpy((void *) merged, (void *) recs, (size_t) n_recs * sizeof(RECORD_HEADER_m12 *));
+		return(n_recs);
+	}
+
+	// journaled edits, sorted by time (journal order for equal times)
+	edits = (RJNL_EDIT *) malloc((size_t) jnl->number_of_entries * sizeof(RJNL_EDIT));
+	for (n_edits = i = 0, entry = next_journal_entry(jnl, NULL); entry != NULL; entry = next_journal_entry(jnl, entry), ++i) {
+		if (entry->start_time < start_time || entry->start_time > end_time)
+			continue;
+		edits[n_edits].rh = (entry->op == RJNL_APPEND) ? (RECORD_HEADER_m12 *) (entry + 1) : NULL;
+		edits[n_edits].start_time = entry->start_time;
+		edits[n_edits].type_code = entry->type_code;
+		edits[n_edits++].position = i;
+	}
+	qsort((void *) edits, (size_t) n_edits, sizeof(RJNL_EDIT), compare_journal_edits);
+
+	// merge by start time: each time's record file records, then its edits in journal order (a tombstone deletes the first live record with its type
+	// among the records before it: the time's record file records, & its appends earlier in the journal)
+	n_merged = 0;
+	for (i = j = 0; i < n_recs || j < n_edits;) {
+		if (j == n_edits || (i < n_recs && recs[i]->start_time <= edits[j].start_time))
+			t = recs[i]->start_time;
+		else
+			t = edits[j].start_time;
+		group_first = n_merged;
+		while (i < n_recs && recs[i]->start_time == t)
+			merged[n_merged++] = recs[i++];
+		deleted = FALSE_m12;
+		for (; j < n_edits && edits[j].start_time == t; ++j) {
+			if (edits[j].rh != NULL) {
+				merged[n_merged++] = edits[j].rh;
+				continue;
+			}
+			for (k = group_first; k < n_merged; ++k)
+				if (merged[k] != NULL && merged[k]->type_code == edits[j].type_code)
+					break;
+			if (k < n_merged) {
+				merged[k] = NULL;
+				deleted = TRUE_m12;
+			}
+		}
+		if (deleted == TRUE_m12) {  // close gaps
+			for (k = n_kept = group_first; k < n_merged; ++k)
+				if (merged[k] != NULL)
+					merged[n_kept++] = merged[k];
+			n_merged = n_kept;
+		}
+	}
+	free((void *) edits);
+
+	return(n_merged);
+}
+
+
+// returns journals of the session's time slice segments (NULL entries for segments without one), or NULL if there are none
+RECORD_JOURNAL	**read_session_journals(SESSION_m12 *sess, si8 *n_appends)
+{
+	si4			i, n_segs;
+	TERN_m12		found;
+	RECORD_JOURNAL		**journals;
+	SEGMENT_RECORD_FILES	srf;
+
+
+	*n_appends = 0;
+	n_segs = sess->time_slice.number_of_segments;
+	if (n_segs <= 0)
+		return(NULL);
+	journals = (RECORD_JOURNAL **) calloc((size_t) n_segs, sizeof(RECORD_JOURNAL *));
+	found = FALSE_m12;
+	for (i = 0; i < n_segs; ++i) {
+		find_segment_record_files(sess, sess->time_slice.start_segment_number + i, &srf);
+		if (srf.ssr_exists == FALSE_m12)
+			break;  // no segmented session records directory
+		journals[i] = read_record_journal(srf.journal_file);
+		if (journals[i] != NULL) {
+			*n_appends += journals[i]->number_of_appends;
+			found = TRUE_m12;
+		}
+	}
+	if (found == FALSE_m12) {
+		free((void *) journals);
+		return(NULL);
+	}
+
+	return(journals);
+}
+
+
+void	free_session_journals(SESSION_m12 *sess, RECORD_JOURNAL **journals)
+{
+	si4	i, n_segs;
+
+
+	if (journals == NULL)
+		return;
+
+	n_segs = sess->time_slice.number_of_segments;
+	for (i = 0; i < n_segs; ++i)
+		free_record_journal(journals[i]);
+	free((void *) journals);
+
+	return;
+}
+
+
+// returns number of entries in segment's journal (0 if there is none), from its header (the journal is not read)
+si8	journal_entries(SEGMENT_RECORD_FILES *srf)
+{
+	FILE		*fp;
+	RJNL_HEADER	hdr;
+
+
+	fp = fopen(srf->journal_file, "rb");
+	if (fp == NULL)
+		return(0);
+	if (fread((void *) &hdr, sizeof(RJNL_HEADER), (size_t) 1, fp) != 1 || hdr.magic != RJNL_MAGIC || hdr.version != RJNL_VERSION)
+		hdr.number_of_entries = 0;
+	fclose(fp);
+
+	return(hdr.number_of_entries);
+}
+
+
+// appends records (time sorted, or in the order they were added) to segment's journal (records to encrypt are encrypted in a copy: recs are unchanged)
+// the records are committed together (none are if any cannot be written)
+// returns FALSE_m12 if the journal cannot be written, or the password does not give access to a record's encryption level
+TERN_m12	append_journal_records(SEGMENT_RECORD_FILES *srf, RECORD_HEADER_m12 **recs, si8 n_recs)
+{
+	ui1			*enc_buf;
+	si8			i, enc_buf_bytes;
+	TERN_m12		written;
+	FILE			*fp;
+	RJNL_HEADER		hdr;
+	RJNL_ENTRY		entry;
+	RECORD_HEADER_m12	*rh;
+
+
+	fp = open_record_journal(srf, &hdr);
+	if (fp == NULL)
+		return(FALSE_m12);
+	written = TRUE_m12;
+	enc_buf = NULL;
+	enc_buf_bytes = 0;
+	memset((void *) &entry, 0, sizeof(RJNL_ENTRY));
+	entry.op = RJNL_APPEND;
+	for (i = 0; i < n_recs && written == TRUE_m12; ++i) {
+		rh = recs[i];
+		if (rh->encryption_level < NO_ENCRYPTION_m12) {  // in memory records carry negative encryption levels until written
+			if ((si8) rh->total_record_bytes > enc_buf_bytes) {
+				enc_buf_bytes = (si8) rh->total_record_bytes;
+				enc_buf = (ui1 *) realloc((void *) enc_buf, (size_t) enc_buf_bytes);
+			}
+			memcpy((void *) enc_buf, (void *) rh, (size_t) rh->total_record_bytes);
+			rh = (RECORD_HEADER_m12 *) enc_buf;
+			if (encrypt_journal_record(rh) == FALSE_m12) {
+				written = FALSE_m12;
+				break;
+			}
+		}
+		entry.record_bytes = rh->total_record_bytes;
+		entry.start_time = rh->start_time;
+		entry.type_code = rh->type_code;
+		entry.encryption_level = rh->encryption_level;
+		if (fwrite((void *) &entry, sizeof(RJNL_ENTRY), (size_t) 1, fp) != 1 || fwrite((void *) rh, (size_t) entry.record_bytes, (size_t) 1, fp) != 1)
+			written = FALSE_m12;
+		++hdr.number_of_entries;
+		hdr.data_bytes += (si8) sizeof(RJNL_ENTRY) + (si8) entry.record_bytes;
+	}
+	if (close_record_journal(fp, &hdr, written) == FALSE_m12)
+		written = FALSE_m12;
+	free((void *) enc_buf);
+
+	return(written);
+}
+
+
+// returns TRUE_m12 if segment's journal (or with compact, its record files) can be written: the records directory (or the session directory if it
+// does not exist yet) is writable, an existing journal is a journal, & record files to compact can be read
+TERN_m12	segment_records_writable(SEGMENT_RECORD_FILES *srf, TERN_m12 compact)
+{
+	si1		dir[FULL_FILE_NAME_BYTES_m12], *c;
+	FILE		*fp;
+	RJNL_HEADER	hdr;
+
+
+	strcpy(dir, srf->ssr_path);
+	if (srf->ssr_exists == FALSE_m12) {  // session directory
+		c = strrchr(dir, '/');
+		if (c != NULL)
+			*c = 0;
+	}
+#if defined MACOS_m12 || defined LINUX_m12
+	if (access(dir, W_OK))
+		return(FALSE_m12);
+#endif
+#ifdef WINDOWS_m12
+	if (_access(dir, 2))
+		return(FALSE_m12);
+#endif
+	fp = fopen(srf->journal_file, "rb");
+	if (fp != NULL) {
+		if (fread((void *) &hdr, sizeof(RJNL_HEADER), (size_t) 1, fp) != 1 || hdr.magic != RJNL_MAGIC || hdr.version != RJNL_VERSION) {
+			fclose(fp);
+			return(FALSE_m12);
+		}
+		fclose(fp);
+	}
+	if (compact == TRUE_m12 && srf->records_exist == TRUE_m12) {
+		if (G_exists_m12(srf->ri_file) != FILE_EXISTS_m12 || G_exists_m12(srf->rd_file) != FILE_EXISTS_m12)
+			return(FALSE_m12);
+	}
+
+	return(TRUE_m12);
+}
+
+
+// encrypts record body in place, as medlib encrypts records written to record data files (the header's encryption level becomes positive)
+// returns FALSE_m12 if the password does not give access to the record's encryption level
+TERN_m12	encrypt_journal_record(RECORD_HEADER_m12 *rh)
+{
+	ui1			*ui1_p, *key;
+	si1			enc_level;
+	si8			i, n_blocks;
+	PASSWORD_DATA_m12	*pwd;
+
+
+	enc_level = -rh->encryption_level;
+	if (enc_level <= NO_ENCRYPTION_m12)  // not encrypted, or already encrypted
+		return(TRUE_m12);
+	pwd = &globals_m12->password_data;
+	if (pwd->access_level < enc_level)
+		return(FALSE_m12);
+
+	key = (enc_level == LEVEL_1_ENCRYPTION_m12) ? pwd->level_1_encryption_key : pwd->level_2_encryption_key;
+	n_blocks = (si8) (rh->total_record_bytes - RECORD_HEADER_BYTES_m12) / ENCRYPTION_BLOCK_BYTES_m12;  // bodies are padded to REC_RECORD_BODY_ALIGNMENT_m12
+	ui1_p = (ui1 *) rh + RECORD_HEADER_BYTES_m12;
+	for (i = 0; i < n_blocks; ++i, ui1_p += ENCRYPTION_BLOCK_BYTES_m12)
+		AES_encrypt_m12(ui1_p, ui1_p, NULL, key);
+	rh->encryption_level = enc_level;
+
+	return(TRUE_m12);
+}
+
+
+// decrypts record body in place, as medlib decrypts records read from record data files (the header's encryption level becomes negative)
+// returns FALSE_m12 if the password does not give access to the record's encryption level (the record stays encrypted)
+TERN_m12	decrypt_journal_record(RECORD_HEADER_m12 *rh)
+{
+	ui1			*ui1_p, *key;
+	si1			enc_level;
+	si8			i, n_blocks;
+	PASSWORD_DATA_m12	*pwd;
+
+
+	enc_level = rh->encryption_level;
+	if (enc_level <= NO_ENCRYPTION_m12)  // not encrypted, or already decrypted
+		return(TRUE_m12);
+	pwd = &globals_m12->password_data;
+	if (pwd->access_level < enc_level)
+		return(FALSE_m12);
+
+	key = (enc_level == LEVEL_1_ENCRYPTION_m12) ? pwd->level_1_encryption_key : pwd->level_2_encryption_key;
+	n_blocks = (si8) (rh->total_record_bytes - RECORD_HEADER_BYTES_m12) / ENCRYPTION_BLOCK_BYTES_m12;
+	ui1_p = (ui1 *) rh + RECORD_HEADER_BYTES_m12;
+	for (i = 0; i < n_blocks; ++i, ui1_p += ENCRYPTION_BLOCK_BYTES_m12)
+		AES_decrypt_m12(ui1_p, ui1_p, NULL, key);
+	rh->encryption_level = -enc_level;
+
+	return(TRUE_m12);
+}
+
+
+TERN_m12	append_journal_tombstone(SEGMENT_RECORD_FILES *srf, si8 start_time, ui4 type_code)
+{
+	TERN_m12	written;
+	FILE		*fp;
+	RJNL_HEADER	hdr;
+	RJNL_ENTRY	entry;
+
+
+	fp = open_record_journal(srf, &hdr);
+	if (fp == NULL)
+		return(FALSE_m12);
+	memset((void *) &entry, 0, sizeof(RJNL_ENTRY));
+	entry.op = RJNL_TOMBSTONE;
+	entry.start_time = start_time;
+	entry.type_code = type_code;
+	written = (fwrite((void *) &entry, sizeof(RJNL_ENTRY), (size_t) 1, fp) == 1) ? TRUE_m12 : FALSE_m12;
+	++hdr.number_of_entries;
+	hdr.data_bytes += (si8) sizeof(RJNL_ENTRY);
+	if (close_record_journal(fp, &hdr, written) == FALSE_m12)
+		written = FALSE_m12;
+
+	return(written);
+}
+
+
+// opens segment's journal for appending (creating the records directory & journal if necessary), positioned after its last complete entry
+// bytes after it (an entry an interrupted writer did not finish) are truncated, so they cannot hide the entries appended after them
+FILE	*open_record_journal(SEGMENT_RECORD_FILES *srf, RJNL_HEADER *hdr)
+{
+	si8		file_bytes, n_entries, data_bytes;
+	FILE		*fp;
+
+
+	if (srf->ssr_exists == FALSE_m12) {
+#if defined MACOS_m12 || defined LINUX_m12
+		mkdir(srf->ssr_path, 0777);
+#endif
+#ifdef WINDOWS_m12
+		CreateDirectoryA(srf->ssr_path, NULL);
+#endif
+		srf->ssr_exists = TRUE_m12;
+	}
+	fp = fopen(srf->journal_file, "r+b");
+	if (fp == NULL) {  // new journal
+		fp = fopen(srf->journal_file, "w+b");
+		if (fp == NULL)
+			return(NULL);
+		hdr->magic = RJNL_MAGIC;
+		hdr->version = RJNL_VERSION;
+		hdr->number_of_entries = 0;
+		hdr->data_bytes = (si8) sizeof(RJNL_HEADER);
+		if (fwrite((void *) hdr, sizeof(RJNL_HEADER), (size_t) 1, fp) != 1 || fflush(fp) != 0) {
+			fclose(fp);
+			return(NULL);
+		}
+		return(fp);
+	}
+
+	fseek(fp, 0, SEEK_END);
+	file_bytes = (si8) ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	if (fread((void *) hdr, sizeof(RJNL_HEADER), (size_t) 1, fp) != 1 || hdr->magic != RJNL_MAGIC || hdr->version != RJNL_VERSION) {
+		G_warning_message_m12("%s(): \"%s\" is not a record journal\n", __FUNCTION__, srf->journal_file);
+		fclose(fp);
+		return(NULL);
+	}
+	if (hdr->data_bytes > file_bytes) {  // header written before its entries reached the disk: find the last complete entry
+		data_bytes = scan_journal_entries(fp, file_bytes, &n_entries);
+		hdr->number_of_entries = n_entries;
+		hdr->data_bytes = data_bytes;
+	}
+	if (file_bytes > hdr->data_bytes && truncate_record_journal(fp, hdr->data_bytes) == FALSE_m12) {
+		fclose(fp);
+		return(NULL);
+	}
+	fseek(fp, (long) hdr->data_bytes, SEEK_SET);
+
+	return(fp);
+}
+
+
+// writes the journal header with the appended entries if commit is TRUE_m12 (else the entries are left uncommitted, & truncated by the next writer)
+// returns FALSE_m12 if the journal cannot be written
+TERN_m12	close_record_journal(FILE *fp, RJNL_HEADER *hdr, TERN_m12 commit)
+{
+	TERN_m12	written;
+
+
+	written = TRUE_m12;
+	if (commit == TRUE_m12) {
+		if (fflush(fp) != 0)  // entries before the header that commits them
+			written = FALSE_m12;
+		fseek(fp, 0, SEEK_SET);
+		if (written == TRUE_m12 && fwrite((void *) hdr, sizeof(RJNL_HEADER), (size_t) 1, fp) != 1)
+			written = FALSE_m12;
+	}
+	if (fclose(fp) != 0)
+		written = FALSE_m12;
+
+	return(written);
+}
+
+
+// returns bytes through journal's last complete entry (entry headers are read: records are skipped), & sets n_entries
+si8	scan_journal_entries(FILE *fp, si8 file_bytes, si8 *n_entries)
+{
+	si8		offset;
+	RJNL_ENTRY	entry;
+
+
+	*n_entries = 0;
+	offset = (si8) sizeof(RJNL_HEADER);
+	while (offset + (si8) sizeof(RJNL_ENTRY) <= file_bytes) {
+		fseek(fp, (long) offset, SEEK_SET);
+		if (fread((void *) &entry, sizeof(RJNL_ENTRY), (size_t) 1, fp) != 1)
+			break;
+		if (offset + (si8) sizeof(RJNL_ENTRY) + (si8) entry.record_bytes > file_bytes)
+			break;
+		offset += (si8) sizeof(RJNL_ENTRY) + (si8) entry.record_bytes;
+		++(*n_entries);
+	}
+
+	return(offset);
+}
+
+
+TERN_m12	truncate_record_journal(FILE *fp, si8 bytes)
+{
+	fflush(fp);
+#if defined MACOS_m12 || defined LINUX_m12
+	if (ftruncate(fileno(fp), (off_t) bytes))
+		return(FALSE_m12);
+#endif
+#ifdef WINDOWS_m12
+	if (_chsize_s(_fileno(fp), (__int64) bytes))
+		return(FALSE_m12);
+#endif
+
+	return(TRUE_m12);
+}
+
+
+// returns segment's merged record list: record files' records (rd_fps may be NULL: indices only), journal entries, then new records (as added)
+SEGMENT_RECORD	*collect_segment_records(FILE_PROCESSING_STRUCT_m12 *ri_fps, FILE_PROCESSING_STRUCT_m12 *rd_fps, RECORD_JOURNAL *jnl, RECORD_HEADER_m12 **new_recs, si8 n_new_recs, si8 *n_recs)
+{
+	ui1			*rd;
+	si8			i, j, n_file_recs, n_appends;
+	RJNL_ENTRY		*entry;
+	RECORD_INDEX_m12	*ri;
+	SEGMENT_RECORD		*recs;
+
+
+	n_file_recs = 0;
+	if (ri_fps != NULL)
+		n_file_recs = ri_fps->universal_header->number_of_entries - 1;  // terminal index
+	if (n_file_recs < 0)
+		n_file_recs = 0;
+	n_appends = (jnl == NULL) ? 0 : jnl->number_of_appends;
+	recs = (SEGMENT_RECORD *) calloc((size_t) (n_file_recs + n_appends + n_new_recs + 1), sizeof(SEGMENT_RECORD));
+
+	// record files
+	ri = (ri_fps == NULL) ? NULL : ri_fps->record_indices;
+	rd = (rd_fps == NULL) ? NULL : rd_fps->record_data;
+	for (i = j = 0; i < n_file_recs; ++i) {
+		if (ri[i].type_code == REC_Term_TYPE_CODE_m12)
+			break;
+		recs[j].ri = ri[i];
+		if (rd != NULL) {
+			recs[j].rh = (RECORD_HEADER_m12 *) rd;
+			rd += recs[j].rh->total_record_bytes;
+		}
+		recs[j].order = j;
+		recs[j++].live = TRUE_m12;
+	}
+
+	// journal
+	if (jnl != NULL) {
+		for (entry = next_journal_entry(jnl, NULL); entry != NULL; entry = next_journal_entry(jnl, entry)) {
+			if (entry->op == RJNL_APPEND) {
+				recs[j].rh = (RECORD_HEADER_m12 *) (entry + 1);
+				journal_record_index(recs[j].rh, &recs[j].ri);
+				recs[j].order = j;
+				recs[j++].live = TRUE_m12;
+				continue;
+			}
+			for (i = 0; i < j; ++i)  // tombstone: first live record with its time & type
+				if (recs[i].live == TRUE_m12 && recs[i].ri.start_time == entry->start_time && recs[i].ri.type_code == entry->type_code)
+					break;
+			if (i < j)
+				recs[i].live = FALSE_m12;
+		}
+	}
+
+	// new records
+	for (i = 0; i < n_new_recs; ++i) {
+		recs[j].rh = new_recs[i];
+		journal_record_index(recs[j].rh, &recs[j].ri);
+		recs[j].order = j;
+		recs[j++].live = TRUE_m12;
+	}
+	*n_recs = j;
+
+	return(recs);
+}
+
+
+// record index of a journaled or new record (in memory records carry negative encryption levels until written)
+void	journal_record_index(RECORD_HEADER_m12 *rh, RECORD_INDEX_m12 *ri)
+{
+	memset((void *) ri, 0, sizeof(RECORD_INDEX_m12));
+	ri->start_time = rh->start_time;
+	ri->type_code = rh->type_code;
+	ri->version_major = rh->version_major;
+	ri->version_minor = rh->version_minor;
+	ri->encryption_level = (rh->encryption_level < 0) ? -rh->encryption_level : rh->encryption_level;
+
+	return;
+}
+
+
+// rewrites segment's record files with its journal & new records (in the order they were added) merged in, & removes the journal
+// the session must have this segment's metadata, & its copies of the segment's record files are released, returns 0.0 on success, -1.0 on failure
+sf8	compact_segment_records(SESSION_m12 *sess, si4 segment_number, RECORD_HEADER_m12 **new_recs, si8 n_new_recs)
+{
+	TERN_m12			replaced, ri_replaced, rd_replaced;
+	si8				i, n_recs, n_live;
+	RECORD_INDEX_m12		term_ri;
+	FILE_PROCESSING_STRUCT_m12	*orig_ri_fps, *orig_rd_fps, *new_ri_fps, *new_rd_fps, *proto_fps;
+	UNIVERSAL_HEADER_m12		*uh;
+	RECORD_JOURNAL			*jnl;
+	SEGMENT_RECORD			*recs;
+	SEGMENT_RECORD_FILES		srf;
+
+
+	find_segment_record_files(sess, segment_number, &srf);
+
+	// get a segment prototype
+	proto_fps = segment_prototype(sess, segment_number);
+	if (proto_fps == NULL) {
+		G_warning_message_m12("%s(): no metadata for segment %d\n", __FUNCTION__, segment_number);
+		return(-1.0);
+	}
+
+	// read original records & journal
+	orig_ri_fps = orig_rd_fps = NULL;
+	if (srf.records_exist == TRUE_m12) {
+		orig_ri_fps = G_read_file_m12(NULL, srf.ri_file, 0, 0, FPS_FULL_FILE_m12, NULL, NULL, USE_GLOBAL_BEHAVIOR_m12);
+		orig_rd_fps = G_read_file_m12(NULL, srf.rd_file, 0, 0, FPS_FULL_FILE_m12, NULL, NULL, USE_GLOBAL_BEHAVIOR_m12);
+		if (orig_ri_fps == NULL || orig_rd_fps == NULL) {
+			FPS_free_processing_struct_m12(orig_ri_fps, TRUE_m12);
+			FPS_free_processing_struct_m12(orig_rd_fps, TRUE_m12);
+			return(-1.0);
+		}
+	}
+	jnl = read_record_journal(srf.journal_file);
+
+	// merge: time order, & order added for equal times (record files are time sorted)
+	recs = collect_segment_records(orig_ri_fps, orig_rd_fps, jnl, new_recs, n_new_recs, &n_recs);
+	for (i = n_live = 0; i < n_recs; ++i)
+		if (recs[i].live == TRUE_m12)
+			recs[n_live++] = recs[i];
+	qsort((void *) recs, (size_t) n_live, sizeof(SEGMENT_RECORD), compare_segment_records);
+
+	// no records left: remove files
+	if (n_live == 0) {
+		free((void *) recs);
+		free_record_journal(jnl);
+		FPS_free_processing_struct_m12(orig_ri_fps, TRUE_m12);
+		FPS_free_processing_struct_m12(orig_rd_fps, TRUE_m12);
+		remove_segment_record_files(&srf);
+		release_segment_records(sess, segment_number);
+		return(0.0);
+	}
+
+	// create new segmented session record indices fps
+	new_ri_fps = FPS_allocate_processing_struct_m12(NULL, srf.tmp_ri_file, RECORD_INDICES_FILE_TYPE_CODE_m12, RECORD_INDEX_BYTES_m12, NULL, proto_fps, 0);
+	new_rd_fps = FPS_allocate_processing_struct_m12(NULL, srf.tmp_rd_file, RECORD_DATA_FILE_TYPE_CODE_m12, REC_LARGEST_RECORD_BYTES_m12, NULL, proto_fps, 0);
+	if (new_ri_fps == NULL || new_rd_fps == NULL) {
+		FPS_free_processing_struct_m12(new_ri_fps, TRUE_m12);
+		FPS_free_processing_struct_m12(new_rd_fps, TRUE_m12);
+		free((void *) recs);
+		free_record_journal(jnl);
+		FPS_free_processing_struct_m12(orig_ri_fps, TRUE_m12);
+		FPS_free_processing_struct_m12(orig_rd_fps, TRUE_m12);
+		return(-1.0);
+	}
+	new_ri_fps->directives.open_mode = FPS_W_OPEN_MODE_m12;
+	new_ri_fps->directives.close_file = FALSE_m12;
+	uh = new_ri_fps->universal_header;
+	memset((void *) uh->channel_name, 0, BASE_FILE_NAME_BYTES_m12);
+	uh->channel_UID = UID_NO_ENTRY_m12;
+	if (orig_ri_fps) {
+		uh->file_UID = orig_ri_fps->universal_header->file_UID;  // keep original file UIDs since overwriting
+		uh->provenance_UID = orig_ri_fps->universal_header->provenance_UID;  // keep original provenance UIDs since overwriting
+	}
+	G_write_file_m12(new_ri_fps, 0, UNIVERSAL_HEADER_BYTES_m12, FPS_UNIVERSAL_HEADER_ONLY_m12, NULL, USE_GLOBAL_BEHAVIOR_m12);
+
+	// create new segmented session record data fps
+	new_rd_fps->directives.open_mode = FPS_W_OPEN_MODE_m12;
+	new_rd_fps->directives.close_file = FALSE_m12;
+	uh = new_rd_fps->universal_header;
+	memset((void *) uh->channel_name, 0, BASE_FILE_NAME_BYTES_m12);
+	uh->channel_UID = UID_NO_ENTRY_m12;
+	if (orig_rd_fps) {
+		uh->file_UID = orig_rd_fps->universal_header->file_UID;  // keep original file UIDs since overwriting
+		uh->provenance_UID = orig_rd_fps->universal_header->provenance_UID;  // keep original provenance UIDs since overwriting
+	}
+	G_write_file_m12(new_rd_fps, 0, UNIVERSAL_HEADER_BYTES_m12, FPS_UNIVERSAL_HEADER_ONLY_m12, NULL, USE_GLOBAL_BEHAVIOR_m12);
+
+	// write records
+	for (i = 0; i < n_live; ++i) {
+		recs[i].ri.file_offset = new_rd_fps->parameters.flen;
+		G_write_file_m12(new_ri_fps, FPS_APPEND_m12, (size_t) INDEX_BYTES_m12, (size_t) 1, (void *) &recs[i].ri, USE_GLOBAL_BEHAVIOR_m12);
+		G_write_file_m12(new_rd_fps, FPS_APPEND_m12, (size_t) recs[i].rh->total_record_bytes, (size_t) 1, (void *) recs[i].rh, USE_GLOBAL_BEHAVIOR_m12);
+	}
+
+	// write terminal index
+	memset((void *) &term_ri, 0, sizeof(RECORD_INDEX_m12));
+	term_ri.file_offset = new_rd_fps->parameters.flen;
+	term_ri.start_time = new_ri_fps->universal_header->segment_end_time + 1;
+	term_ri.type_code = REC_Term_TYPE_CODE_m12;
+	term_ri.version_major = 0xFF;
+	term_ri.version_minor = 0xFF;
+	term_ri.encryption_level = NO_ENCRYPTION_m12;
+	G_write_file_m12(new_ri_fps, FPS_APPEND_m12, INDEX_BYTES_m12, 1, &term_ri, USE_GLOBAL_BEHAVIOR_m12);
+
+	// update headers & close
+	G_write_file_m12(new_ri_fps, 0, 0, FPS_CLOSE_m12, NULL, USE_GLOBAL_BEHAVIOR_m12);
+	G_write_file_m12(new_rd_fps, 0, 0, FPS_CLOSE_m12, NULL, USE_GLOBAL_BEHAVIOR_m12);
+
+	// close & free files
+	free((void *) recs);
+	free_record_journal(jnl);
+	FPS_free_processing_struct_m12(new_ri_fps, TRUE_m12);
+	FPS_free_processing_struct_m12(new_rd_fps, TRUE_m12);
+	FPS_free_processing_struct_m12(orig_ri_fps, TRUE_m12);
+	FPS_free_processing_struct_m12(orig_rd_fps, TRUE_m12);
+
+	// move original files aside & temp files into place, then remove journal (its edits are now in the record files)
+	// on failure the original files are restored, so the journal is never applied to record files that already have its edits
+	ri_replaced = rd_replaced = FALSE_m12;
+	if (srf.records_exist == TRUE_m12) {
+		ri_replaced = replace_record_file(srf.ri_file, srf.bak_ri_file);
+		rd_replaced = (ri_replaced == TRUE_m12) ? replace_record_file(srf.rd_file, srf.bak_rd_file) : FALSE_m12;
+		replaced = rd_replaced;
+	} else {
+		replaced = TRUE_m12;
+	}
+	if (replaced == TRUE_m12)
+		replaced = replace_record_file(srf.tmp_ri_file, srf.ri_file);
+	if (replaced == TRUE_m12)
+		replaced = replace_record_file(srf.tmp_rd_file, srf.rd_file);
+	if (replaced == TRUE_m12 && G_exists_m12(srf.journal_file) == FILE_EXISTS_m12 && remove(srf.journal_file))
+		replaced = FALSE_m12;
+	if (replaced == FALSE_m12) {
+		restore_record_files(&srf, ri_replaced, rd_replaced);
+		G_warning_message_m12("%s(): cannot replace record files of segment %d\n", __FUNCTION__, segment_number);
+		return(-1.0);
+	}
+	remove(srf.bak_ri_file);
+	remove(srf.bak_rd_file);
+	release_segment_records(sess, segment_number);
+
+	return(0.0);
+}
+
+
+// puts a failed compaction's original record files back (ri_replaced & rd_replaced: moved to their backup names), & removes its temp files
+void	restore_record_files(SEGMENT_RECORD_FILES *srf, TERN_m12 ri_replaced, TERN_m12 rd_replaced)
+{
+	if (ri_replaced == TRUE_m12)
+		replace_record_file(srf->bak_ri_file, srf->ri_file);
+	else if (srf->records_exist == FALSE_m12)
+		remove(srf->ri_file);
+	if (rd_replaced == TRUE_m12)
+		replace_record_file(srf->bak_rd_file, srf->rd_file);
+	else if (srf->records_exist == FALSE_m12)
+		remove(srf->rd_file);
+	remove(srf->tmp_ri_file);
+	remove(srf->tmp_rd_file);
+
+	return;
+}
+
+
+// returns metadata fps of the session's segment (record files' universal header prototype), or NULL if it has not been read
+FILE_PROCESSING_STRUCT_m12	*segment_prototype(SESSION_m12 *sess, si4 segment_number)
+{
+	si4		seg_idx;
+	SEGMENT_m12	*seg;
+
+
+	seg_idx = segment_slot(sess, segment_number);
+	if (seg_idx < 0 || sess->time_series_channels[0]->segments == NULL)
+		return(NULL);
+	seg = sess->time_series_channels[0]->segments[seg_idx];
+	if (seg == NULL)
+		return(NULL);
+
+	return(seg->metadata_fps);
+}
+
+
+// frees the session's copies of segment's record files (rewritten by compaction), so they are read again from disk by the next read of the segment
+void	release_segment_records(SESSION_m12 *sess, si4 segment_number)
+{
+	si4			seg_idx;
+	SEGMENTED_SESS_RECS_m12	*ssr;
+
+
+	ssr = sess->segmented_sess_recs;
+	seg_idx = segment_slot(sess, segment_number);
+	if (ssr == NULL || seg_idx < 0)
+		return;
+
+	FPS_free_processing_struct_m12(ssr->record_indices_fps[seg_idx], TRUE_m12);
+	ssr->record_indices_fps[seg_idx] = NULL;
+	FPS_free_processing_struct_m12(ssr->record_data_fps[seg_idx], TRUE_m12);
+	ssr->record_data_fps[seg_idx] = NULL;
+
+	return;
+}
+
+
+// returns index of segment in the session's segment arrays, or -1 if it has no entry (segment outside an unmapped session's slice)
+si4	segment_slot(SESSION_m12 *sess, si4 segment_number)
+{
+	si4	seg_idx, n_slots;
+
+
+	if (sess->flags & LH_MAP_ALL_SEGMENTS_m12)
+		n_slots = globals_m12->number_of_session_segments;
+	else
+		n_slots = TIME_SLICE_SEGMENT_COUNT_m12(&sess->time_slice);
+	seg_idx = G_get_segment_index_m12(segment_number);
+	if (seg_idx < 0 || seg_idx >= n_slots)
+		return(-1);
+
+	return(seg_idx);
+}
+
+
+// compacts journals of the session's time slice segments, returns number compacted, or -1 on failure
+si4	compact_session_journals(SESSION_m12 *sess)
+{
+	si4			i, n_segs, n_compacted;
+	SEGMENT_RECORD_FILES	srf;
+
+
+	n_segs = sess->time_slice.number_of_segments;
+	for (i = n_compacted = 0; i < n_segs; ++i) {
+		find_segment_record_files(sess, sess->time_slice.start_segment_number + i, &srf);
+		if (srf.ssr_exists == FALSE_m12)
+			break;
+		if (G_exists_m12(srf.journal_file) != FILE_EXISTS_m12)
+			continue;
+		if (compact_segment_records(sess, srf.segment_number, NULL, 0) < 0.0)
+			return(-1);
+		++n_compacted;
+	}
+
+	return(n_compacted);
+}
+
+
+// removes segment's record files & journal (& records directory if no other segment has records)
+void	remove_segment_record_files(SEGMENT_RECORD_FILES *srf)
+{
+	si1	**ssr_list;
+	si4	ssr_list_len;
+
+
+	remove(srf->ri_file);
+	remove(srf->rd_file);
+	remove(srf->journal_file);
+
+	ssr_list = G_generate_file_list_m12(NULL, &ssr_list_len, srf->ssr_path, NULL, RECORD_INDICES_FILE_TYPE_STRING_m12, GFL_FULL_PATH_m12);
+	if (ssr_list_len == 0) {  // no other ssr records - delete directory
+#if defined MACOS_m12 || defined LINUX_m12
+		rmdir(srf->ssr_path);
+#endif
+#ifdef WINDOWS_m12
+		RemoveDirectoryA(srf->ssr_path);
+#endif
+	}
+	free_m12((void *) ssr_list, __FUNCTION__);
+
+	return;
+}
+
+
+// atomically replaces file with tmp_file (same directory)
+TERN_m12	replace_record_file(si1 *tmp_file, si1 *file)
+{
+#if defined MACOS_m12 || defined LINUX_m12
+	if (rename(tmp_file, file))
+		return(FALSE_m12);
+#endif
+#ifdef WINDOWS_m12
+	if (MoveFileExA(tmp_file, file, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) == 0)
+		return(FALSE_m12);
+#endif
+
+	return(TRUE_m12);
+}
+
+
+si4	compare_segment_records(const void *a, const void *b)
+{
+	SEGMENT_RECORD	*rec_a, *rec_b;
+
+
+	rec_a = (SEGMENT_RECORD *) a;
+	rec_b = (SEGMENT_RECORD *) b;
+	if (rec_a->ri.start_time != rec_b->ri.start_time)
+		return((rec_a->ri.start_time > rec_b->ri.start_time) ? 1 : -1);
+	if (rec_a->order != rec_b->order)
+		return((rec_a->order > rec_b->order) ? 1 : -1);
+
+	return(0);
+}
+
+
+si4	compare_journal_edits(const void *a, const void *b)
+{
+	RJNL_EDIT	*edit_a, *edit_b;
+
+
+	edit_a = (RJNL_EDIT *) a;
+	edit_b = (RJNL_EDIT *) b;
+	if (edit_a->start_time != edit_b->start_time)
+		return((edit_a->start_time > edit_b->start_time) ? 1 : -1);
+	if (edit_a->position != edit_b->position)
+		return((edit_a->position > edit_b->position) ? 1 : -1);
+
+	return(0);
+}
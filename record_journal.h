@@ -0,0 +1,100 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+#ifndef RECORD_JOURNAL_IN
+#define RECORD_JOURNAL_IN
+
+// Includes
+#include "medlib_m12.h"
+
+// Miscellaneous
+#define RJNL_FILE_TYPE_STRING		"rjnl"				// <session>_s<segment>.rjnl, next to the segment's record files
+#define RJNL_MAGIC			((ui4) 0x4C4E4A52)		// "RJNL" (little endian)
+#define RJNL_VERSION			((ui4) 1)
+#define RJNL_APPEND			((ui4) 1)
+#define RJNL_TOMBSTONE			((ui4) 2)
+#define RJNL_COMPACT_ENTRIES		((si8) 4096)			// writers compact a segment's journal when it reaches this many entries
+
+// Record Journal File Structures
+typedef struct {  // rewritten after each write: entries beyond data_bytes were not completely written (a writer truncates them before appending)
+	ui4			magic;
+	ui4			version;
+	si8			number_of_entries;  // complete entries
+	si8			data_bytes;  // through last complete entry
+} RJNL_HEADER;
+
+typedef struct {  // appends are followed by the record (header & body, encrypted as in the record data file)
+	ui4			op;
+	ui4			record_bytes;  // 0 for tombstones
+	si8			start_time;
+	ui4			type_code;
+	si1			encryption_level;  // record's level (positive: stored encrypted)
+	si1			pad[3];
+} RJNL_ENTRY;
+
+// Read Journal
+typedef struct {
+	ui1			*data;  // journal file contents (appended records decrypted if the password gives access)
+	si8			data_bytes;  // through last complete entry (entries not completely written are ignored)
+	si8			number_of_entries;
+	si8			number_of_appends;
+} RECORD_JOURNAL;
+
+typedef struct {  // journal entry, in the order merge_record_journal() applies it
+	RECORD_HEADER_m12	*rh;  // appended record (NULL for tombstones)
+	si8			start_time;
+	ui4			type_code;
+	si8			position;  // entry number in the journal
+} RJNL_EDIT;
+
+// Segment Record Files
+typedef struct {
+	si4			segment_number;
+	si1			ssr_path[FULL_FILE_NAME_BYTES_m12];  // segmented session records directory
+	si1			ri_file[FULL_FILE_NAME_BYTES_m12], rd_file[FULL_FILE_NAME_BYTES_m12], journal_file[FULL_FILE_NAME_BYTES_m12];
+	si1			tmp_ri_file[FULL_FILE_NAME_BYTES_m12], tmp_rd_file[FULL_FILE_NAME_BYTES_m12];
+	si1			bak_ri_file[FULL_FILE_NAME_BYTES_m12], bak_rd_file[FULL_FILE_NAME_BYTES_m12];  // original record files during compaction
+	TERN_m12		ssr_exists, records_exist;
+} SEGMENT_RECORD_FILES;
+
+typedef struct {  // entry of a segment's merged record list
+	RECORD_HEADER_m12	*rh;  // NULL if only the record indices were read
+	RECORD_INDEX_m12	ri;
+	si8			order;  // record files' records by position, then journaled & new records as added
+	TERN_m12		live;  // FALSE_m12: deleted by a tombstone
+} SEGMENT_RECORD;
+
+
+// Prototypes
+void			find_segment_record_files(SESSION_m12 *sess, si4 segment_number, SEGMENT_RECORD_FILES *srf);
+RECORD_JOURNAL		*read_record_journal(si1 *journal_file);
+void			free_record_journal(RECORD_JOURNAL *jnl);
+RJNL_ENTRY		*next_journal_entry(RECORD_JOURNAL *jnl, RJNL_ENTRY *entry);
+si8			merge_record_journal(RECORD_JOURNAL *jnl, RECORD_HEADER_m12 **recs, si8 n_recs, RECORD_HEADER_m12 **merged, si8 start_time, si8 end_time);
+RECORD_JOURNAL		**read_session_journals(SESSION_m12 *sess, si8 *n_appends);
+void			free_session_journals(SESSION_m12 *sess, RECORD_JOURNAL **journals);
+si8			journal_entries(SEGMENT_RECORD_FILES *srf);
+TERN_m12		append_journal_records(SEGMENT_RECORD_FILES *srf, RECORD_HEADER_m12 **recs, si8 n_recs);
+TERN_m12		segment_records_writable(SEGMENT_RECORD_FILES *srf, TERN_m12 compact);
+TERN_m12		encrypt_journal_record(RECORD_HEADER_m12 *rh);
+TERN_m12		decrypt_journal_record(RECORD_HEADER_m12 *rh);
+TERN_m12		append_journal_tombstone(SEGMENT_RECORD_FILES *srf, si8 start_time, ui4 type_code);
+FILE			*open_record_journal(SEGMENT_RECORD_FILES *srf, RJNL_HEADER *hdr);
+TERN_m12		close_record_journal(FILE *fp, RJNL_HEADER *hdr, TERN_m12 commit);
+si8			scan_journal_entries(FILE *fp, si8 file_bytes, si8 *n_entries);
+TERN_m12		truncate_record_journal(FILE *fp, si8 bytes);
+SEGMENT_RECORD		*collect_segment_records(FILE_PROCESSING_STRUCT_m12 *ri_fps, FILE_PROCESSING_STRUCT_m12 *rd_fps, RECORD_JOURNAL *jnl, RECORD_HEADER_m12 **new_recs, si8 n_new_recs, si8 *n_recs);
+void			journal_record_index(RECORD_HEADER_m12 *rh, RECORD_INDEX_m12 *ri);
+sf8			compact_segment_records(SESSION_m12 *sess, si4 segment_number, RECORD_HEADER_m12 **new_recs, si8 n_new_recs);
+si4			compact_session_journals(SESSION_m12 *sess);
+FILE_PROCESSING_STRUCT_m12	*segment_prototype(SESSION_m12 *sess, si4 segment_number);
+void			release_segment_records(SESSION_m12 *sess, si4 segment_number);
+si4			segment_slot(SESSION_m12 *sess, si4 segment_number);
+void			remove_segment_record_files(SEGMENT_RECORD_FILES *srf);
+TERN_m12		replace_record_file(si1 *tmp_file, si1 *file);
+void			restore_record_files(SEGMENT_RECORD_FILES *srf, TERN_m12 ri_replaced, TERN_m12 rd_replaced);
+si4			compare_segment_records(const void *a, const void *b);
+si4			compare_journal_edits(const void *a, const void *b);
+
+
+#endif /* RECORD_JOURNAL_IN */
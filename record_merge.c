@@ -0,0 +1,388 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Record merging
+// The session's record files (session records, & each segment's segmented session records) are each time ordered on disk, so records are assembled by
+// a k-way merge of the files' streams (O(n log k) for k streams), rather than collecting pointers to every record & sorting them. A heap holds each
+// stream's next record; records come out in time order, & records with equal times in stream order (session records, then segments in order), & then
+// in file order. A segment with a journal is merged with it first, into its own stream: the journal's edits are sorted by time, & merged with the
+// segment's (time ordered) records in one pass that also applies its tombstones; journaled records go after records with equal times, as added.
+// Journaled records outside the session's time slice are skipped (medlib reads the slice's records from the record files).
+// Terminal & system log records are skipped (record readers exclude them). A record data file found out of time order is sorted into its own stream.
+// Merges are not locked: each is used by one thread.
+
+
+#include "record_merge.h"
+
+
+RECORD_MERGE	*new_record_merge(si4 max_streams)
+{
+	RECORD_MERGE	*rm;
+
+
+	rm = (RECORD_MERGE *) calloc((size_t) 1, sizeof(RECORD_MERGE));
+	rm->max_streams = (max_streams > 0) ? max_streams : 1;
+	rm->streams = (RECORD_STREAM *) calloc((size_t) rm->max_streams, sizeof(RECORD_STREAM));
+	rm->keys = (MERGE_KEY *) calloc((size_t) rm->max_streams, sizeof(MERGE_KEY));
+
+	return(rm);
+}
+
+
+// record data stream: n_items records in file order
+void	add_record_data_stream(RECORD_MERGE *rm, ui1 *data, si8 n_items)
+{
+	TERN_m12		ordered;
+	si8			i, n_recs, last_time;
+	ui1			*rd;
+	RECORD_HEADER_m12	*rh, **ptrs;
+	RECORD_STREAM		*rs;
+
+
+	if (data == NULL || n_items <= 0 || rm->number_of_streams == rm->max_streams)
+		return;
+
+	rs = rm->streams + rm->number_of_streams++;
+	rs->data = data;
+	rs->remaining = n_items;
+
+	// count merged records & check order (headers only)
+	ordered = TRUE_m12;
+	last_time = BEGINNING_OF_TIME_m12;
+	for (i = n_recs = 0, rd = data; i < n_items; ++i) {
+		rh = (RECORD_HEADER_m12 *) rd;
+		if (excluded_record_type(rh->type_code) == FALSE_m12) {
+			if (rh->start_time < last_time)
+				ordered = FALSE_m12;
+			last_time = rh->start_time;
+			++n_recs;
+		}
+		rd += rh->total_record_bytes;
+	}
+	rm->number_of_records += n_recs;
+
+	// records out of time order (files from other writers): sorted pointer stream
+	if (ordered == FALSE_m12) {
+		ptrs = (RECORD_HEADER_m12 **) malloc((size_t) n_recs * sizeof(RECORD_HEADER_m12 *));
+		for (i = n_recs = 0, rd = data; i < n_items; ++i) {
+			rh = (RECORD_HEADER_m12 *) rd;
+			if (excluded_record_type(rh->type_code) == FALSE_m12)
+				ptrs[n_recs++] = rh;
+			rd += rh->total_record_bytes;
+		}
+		qsort((void *) ptrs, (size_t) n_recs, sizeof(RECORD_HEADER_m12 *), compare_record_times);
+		rs->data = NULL;
+		rs->ptrs = ptrs;
+		rs->remaining = n_recs;
+		rs->allocated = (void *) ptrs;
+	}
+
+	return;
+}
+
+
+// pointer stream: n_ptrs time ordered records (ptrs is freed with the merge if free_ptrs is TRUE_m12)
+void	add_record_pointer_stream(RECORD_MERGE *rm, RECORD_HEADER_m12 **ptrs, si8 n_ptrs, TERN_m12 free_ptrs)
+{
+	si8		i;
+	RECORD_STREAM	*rs;
+
+
+	if (ptrs == NULL || n_ptrs <= 0 || rm->number_of_streams == rm->max_streams) {
+		if (free_ptrs == TRUE_m12)
+			free((void *) ptrs);
+		return;
+	}
+
+	rs = rm->streams + rm->number_of_streams++;
+	rs->ptrs = ptrs;
+	rs->remaining = n_ptrs;
+	if (free_ptrs == TRUE_m12)
+		rs->allocated = (void *) ptrs;
+	for (i = 0; i < n_ptrs; ++i)
+		if (excluded_record_type(ptrs[i]->type_code) == FALSE_m12)
+			++rm->number_of_records;
+
+	return;
+}
+
+
+// record indices stream: n_indices record indices in file order (a terminal index is skipped)
+void	add_record_index_stream(RECORD_MERGE *rm, RECORD_INDEX_m12 *indices, si8 n_indices)
+{
+	si8		i;
+	RECORD_STREAM	*rs;
+
+
+	if (indices == NULL || n_indices <= 0 || rm->number_of_streams == rm->max_streams)
+		return;
+
+	rs = rm->streams + rm->number_of_streams++;
+	rs->indices = indices;
+	rs->remaining = n_indices;
+	for (i = 0; i < n_indices; ++i)
+		if (excluded_record_type(indices[i].type_code) == FALSE_m12)
+			++rm->number_of_records;
+
+	return;
+}
+
+
+// builds heap of the streams' first records (call after adding streams)
+void	start_record_merge(RECORD_MERGE *rm)
+{
+	si4		i;
+	RECORD_STREAM	*rs;
+
+
+	rm->number_of_keys = 0;
+	for (i = 0; i < rm->number_of_streams; ++i) {
+		rs = rm->streams + i;
+		skip_excluded_records(rs);
+		if (rs->remaining == 0)
+			continue;
+		rm->keys[rm->number_of_keys].start_time = stream_start_time(rs);
+		rm->keys[rm->number_of_keys++].stream = i;
+	}
+	for (i = (rm->number_of_keys >> 1) - 1; i >= 0; --i)
+		sift_merge_key(rm, i);
+
+	return;
+}
+
+
+// returns next record in time order, or NULL when the streams are exhausted (data & pointer streams)
+RECORD_HEADER_m12	*next_merged_record(RECORD_MERGE *rm)
+{
+	RECORD_STREAM		*rs;
+	RECORD_HEADER_m12	*rh;
+
+
+	if (rm->number_of_keys == 0)
+		return(NULL);
+
+	rs = rm->streams + rm->keys[0].stream;
+	rh = (rs->data != NULL) ? (RECORD_HEADER_m12 *) rs->data : *rs->ptrs;
+	pop_merge_stream(rm);
+
+	return(rh);
+}
+
+
+// returns next record index in time order, or NULL when the streams are exhausted (index streams)
+RECORD_INDEX_m12	*next_merged_index(RECORD_MERGE *rm)
+{
+	RECORD_STREAM		*rs;
+	RECORD_INDEX_m12	*ri;
+
+
+	if (rm->number_of_keys == 0)
+		return(NULL);
+
+	rs = rm->streams + rm->keys[0].stream;
+	ri = rs->indices;
+	pop_merge_stream(rm);
+
+	return(ri);
+}
+
+
+void	free_record_merge(RECORD_MERGE *rm)
+{
+	si4	i;
+
+
+	if (rm == NULL)
+		return;
+
+	for (i = 0; i < rm->number_of_streams; ++i)
+		free((void *) rm->streams[i].allocated);
+	free((void *) rm->streams);
+	free((void *) rm->keys);
+	if (rm->journals != NULL)
+		free_session_journals(rm->sess, rm->journals);
+	free((void *) rm);
+
+	return;
+}
+
+
+// merge of the session's time slice records (session records, & segmented session records with their journals merged)
+RECORD_MERGE	*merge_session_records(SESSION_m12 *sess)
+{
+	TERN_m12			ordered;
+	si4				n_segs, seg_idx;
+	si8				i, j, k, n_items, n_ptrs, n_appends, last_time;
+	ui1				*rd;
+	RECORD_HEADER_m12		**ptrs, **merged, *rh;
+	RECORD_MERGE			*rm;
+	FILE_PROCESSING_STRUCT_m12	*rd_fps;
+
+
+	n_segs = sess->time_slice.number_of_segments;
+	seg_idx = G_get_segment_index_m12(sess->time_slice.start_segment_number);
+	rm = new_record_merge(n_segs + 1);
+	rm->sess = sess;
+	rm->journals = read_session_journals(sess, &n_appends);  // journaled record edits
+
+	// session records
+	if (sess->record_data_fps != NULL)
+		add_record_data_stream(rm, sess->record_data_fps->record_data, sess->record_data_fps->number_of_items);
+
+	// segmented session records
+	if (sess->segmented_sess_recs != NULL || rm->journals != NULL) {
+		for (i = 0, j = seg_idx; i < n_segs; ++i, ++j) {
+			rd_fps = (sess->segmented_sess_recs == NULL) ? NULL : sess->segmented_sess_recs->record_data_fps[j];
+			n_items = (rd_fps == NULL) ? 0 : rd_fps->number_of_items;
+			if (rm->journals == NULL || rm->journals[i] == NULL) {
+				if (rd_fps != NULL)
+					add_record_data_stream(rm, rd_fps->record_data, n_items);
+				continue;
+			}
+
+			// segment's record files' records (time ordered), merged with its journal
+			ptrs = (RECORD_HEADER_m12 **) malloc((size_t) (n_items + 1) * sizeof(RECORD_HEADER_m12 *));
+			n_ptrs = 0;
+			ordered = TRUE_m12;
+			last_time = BEGINNING_OF_TIME_m12;
+			rd = (rd_fps == NULL) ? NULL : rd_fps->record_data;
+			for (k = 0; k < n_items; ++k) {
+				rh = (RECORD_HEADER_m12 *) rd;
+				if (excluded_record_type(rh->type_code) == FALSE_m12) {
+					if (rh->start_time < last_time)
+						ordered = FALSE_m12;
+					last_time = rh->start_time;
+					ptrs[n_ptrs++] = rh;
+				}
+				rd += rh->total_record_bytes;
+			}
+			if (ordered == FALSE_m12)  // files from other writers
+				qsort((void *) ptrs, (size_t) n_ptrs, sizeof(RECORD_HEADER_m12 *), compare_record_times);
+			merged = (RECORD_HEADER_m12 **) malloc((size_t) (n_ptrs + rm->journals[i]->number_of_appends + 1) * sizeof(RECORD_HEADER_m12 *));
+			n_ptrs = merge_record_journal(rm->journals[i], ptrs, n_ptrs, merged, sess->time_slice.start_time, sess->time_slice.end_time);
+			free((void *) ptrs);
+			add_record_pointer_stream(rm, merged, n_ptrs, TRUE_m12);
+		}
+	}
+	start_record_merge(rm);
+
+	return(rm);
+}
+
+
+// sort by time, then by location in memory (file order)
+si4	compare_record_times(const void *a, const void *b)
+{
+	RECORD_HEADER_m12	*rha, *rhb;
+
+
+	rha = *((RECORD_HEADER_m12 **) a);
+	rhb = *((RECORD_HEADER_m12 **) b);
+	if (rha->start_time != rhb->start_time)
+		return((rha->start_time > rhb->start_time) ? 1 : -1);
+	if ((ui8) rha != (ui8) rhb)
+		return(((ui8) rha > (ui8) rhb) ? 1 : -1);
+
+	return(0);
+}
+
+
+TERN_m12	excluded_record_type(ui4 type_code)
+{
+	switch (type_code) {
+		case REC_Term_TYPE_CODE_m12:
+		case REC_SyLg_TYPE_CODE_m12:
+			return(TRUE_m12);
+		default:  // include all other record types
+			return(FALSE_m12);
+	}
+}
+
+
+void	skip_excluded_records(RECORD_STREAM *rs)
+{
+	while (rs->remaining > 0) {
+		if (rs->data != NULL) {
+			if (excluded_record_type(((RECORD_HEADER_m12 *) rs->data)->type_code) == FALSE_m12)
+				break;
+		} else if (rs->ptrs != NULL) {
+			if (excluded_record_type((*rs->ptrs)->type_code) == FALSE_m12)
+				break;
+		} else if (excluded_record_type(rs->indices->type_code) == FALSE_m12) {
+			break;
+		}
+		advance_record_stream(rs);
+	}
+
+	return;
+}
+
+
+void	advance_record_stream(RECORD_STREAM *rs)
+{
+	if (rs->data != NULL)
+		rs->data += ((RECORD_HEADER_m12 *) rs->data)->total_record_bytes;
+	else if (rs->ptrs != NULL)
+		++rs->ptrs;
+	else
+		++rs->indices;
+	--rs->remaining;
+
+	return;
+}
+
+
+si8	stream_start_time(RECORD_STREAM *rs)
+{
+	if (rs->data != NULL)
+		return(((RECORD_HEADER_m12 *) rs->data)->start_time);
+	if (rs->ptrs != NULL)
+		return((*rs->ptrs)->start_time);
+
+	return(rs->indices->start_time);
+}
+
+
+// moves key down to its place in the heap
+void	sift_merge_key(RECORD_MERGE *rm, si4 key_idx)
+{
+	si4		child;
+	MERGE_KEY	key, *keys;
+
+
+	keys = rm->keys;
+	key = keys[key_idx];
+	while ((child = (key_idx << 1) + 1) < rm->number_of_keys) {
+		if (child + 1 < rm->number_of_keys) {
+			if (keys[child + 1].start_time < keys[child].start_time || (keys[child + 1].start_time == keys[child].start_time && keys[child + 1].stream < keys[child].stream))
+				++child;
+		}
+		if (key.start_time < keys[child].start_time || (key.start_time == keys[child].start_time && key.stream < keys[child].stream))
+			break;
+		keys[key_idx] = keys[child];
+		key_idx = child;
+	}
+	keys[key_idx] = key;
+
+	return;
+}
+
+
+// advances the top stream past its current entry, & restores the heap (the stream leaves it when exhausted)
+void	pop_merge_stream(RECORD_MERGE *rm)
+{
+	RECORD_STREAM	*rs;
+
+
+	rs = rm->streams + rm->keys[0].stream;
+	advance_record_stream(rs);
+	skip_excluded_records(rs);
+	if (rs->remaining > 0)
+		rm->keys[0].start_time = stream_start_time(rs);
+	else
+		rm->keys[0] = rm->keys[--rm->number_of_keys];
+	if (rm->number_of_keys > 1)
+		sift_merge_key(rm, 0);
+
+	return;
+}
@@ -0,0 +1,55 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+#ifndef RECORD_MERGE_IN
+#define RECORD_MERGE_IN
+
+// Includes
+#include "medlib_m12.h"
+#include "record_journal.h"
+
+// Record Merge Structures
+typedef struct {  // one time ordered stream of records (or record indices)
+	ui1			*data;  // record data (headers & bodies, in file order)
+	RECORD_HEADER_m12	**ptrs;  // records merged with a journal (merge_record_journal())
+	RECORD_INDEX_m12	*indices;
+	si8			remaining;  // entries left (excluded types included)
+	void			*allocated;  // freed with the merge (pointer streams)
+} RECORD_STREAM;
+
+typedef struct {
+	si8			start_time;  // of the stream's next entry
+	si4			stream;
+} MERGE_KEY;
+
+typedef struct {  // k-way merge: min heap of stream heads (start time, then stream: equal times come out in stream order)
+	si4			number_of_streams, max_streams;
+	RECORD_STREAM		*streams;
+	si4			number_of_keys;
+	MERGE_KEY		*keys;
+	si8			number_of_records;  // excluding terminal & system log records
+	RECORD_JOURNAL		**journals;  // merge_session_records(): journaled records are read from here
+	SESSION_m12		*sess;
+} RECORD_MERGE;
+
+
+// Prototypes
+RECORD_MERGE		*new_record_merge(si4 max_streams);
+void			add_record_data_stream(RECORD_MERGE *rm, ui1 *data, si8 n_items);
+void			add_record_pointer_stream(RECORD_MERGE *rm, RECORD_HEADER_m12 **ptrs, si8 n_ptrs, TERN_m12 free_ptrs);
+void			add_record_index_stream(RECORD_MERGE *rm, RECORD_INDEX_m12 *indices, si8 n_indices);
+void			start_record_merge(RECORD_MERGE *rm);
+RECORD_HEADER_m12	*next_merged_record(RECORD_MERGE *rm);
+RECORD_INDEX_m12	*next_merged_index(RECORD_MERGE *rm);
+void			free_record_merge(RECORD_MERGE *rm);
+RECORD_MERGE		*merge_session_records(SESSION_m12 *sess);
+si4			compare_record_times(const void *a, const void *b);
+TERN_m12		excluded_record_type(ui4 type_code);
+void			skip_excluded_records(RECORD_STREAM *rs);
+void			advance_record_stream(RECORD_STREAM *rs);
+si8			stream_start_time(RECORD_STREAM *rs);
+void			sift_merge_key(RECORD_MERGE *rm, si4 key_idx);
+void			pop_merge_stream(RECORD_MERGE *rm);
+
+
+#endif /* RECORD_MERGE_IN */
@@ -0,0 +1,437 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Record queries
+// Returns a session's records in a time window, optionally only some record types & the first few, decoding only the matching records.
+// Queries use an index of every live record of the session (session records, & the segmented session records of every segment, with their journals
+// merged), built from the record indices files, & kept between queries (the RQ_CACHED_SESSIONS most recently queried sessions). An index is rebuilt
+// when the session's record indices files or journals change (size or modification time). Matching records in the record data files are read in runs
+// of adjacent records (medlib decrypts them if the password allows); journaled records are taken from the index's copies of the journals (decrypted
+// when they are read if the password allows, so an index is only reused at the access level it was built with).
+// Indices are not locked: queries are made from the mex function's thread only.
+// get_record_types() parses the gateways' 'RecordTypes' option (Matlab arguments).
+
+
+#include "record_query.h"
+
+#if defined MACOS_m12 || defined LINUX_m12
+	#include <sys/stat.h>
+#endif
+
+// Globals
+static RECORD_INDEX	*record_indices[RQ_CACHED_SESSIONS] = { NULL };
+static ui8		record_index_clock = 0;
+
+
+void	initialize_record_query(RECORD_QUERY *rq)
+{
+	rq->number_of_types = 0;
+	rq->start_time = BEGINNING_OF_TIME_m12;
+	rq->end_time = END_OF_TIME_m12;
+	rq->limit = RQ_NO_LIMIT;
+
+	return;
+}
+
+
+// sets query's record types from a type string (e.g. 'Seiz'), or a cell array of type strings
+void	get_record_types(const mxArray *mx_arr, RECORD_QUERY *rq)
+{
+	si1		type_str[TYPE_BYTES_m12];
+	si4		i, n_types;
+	const mxArray	*mx_p;
+
+
+	n_types = (mxGetClassID(mx_arr) == mxCELL_CLASS) ? (si4) mxGetNumberOfElements(mx_arr) : 1;
+	if (n_types > RQ_MAX_TYPES)
+		mexErrMsgTxt("Too many 'RecordTypes'\n");
+	for (i = 0; i < n_types; ++i) {
+		mx_p = (mxGetClassID(mx_arr) == mxCELL_CLASS) ? mxGetCell(mx_arr, (mwIndex) i) : mx_arr;
+		if (mx_p == NULL || mxGetClassID(mx_p) != mxCHAR_CLASS || mxGetNumberOfElements(mx_p) != TYPE_BYTES_m12 - 1)
+			mexErrMsgTxt("'RecordTypes' must be a four character record type string, or a cell array of them\n");
+		mxGetString(mx_p, type_str, TYPE_BYTES_m12);
+		rq->type_codes[i] = (ui4) (ui1) type_str[0] | ((ui4) (ui1) type_str[1] << 8) | ((ui4) (ui1) type_str[2] << 16) | ((ui4) (ui1) type_str[3] << 24);  // type codes are their strings' bytes
+	}
+	rq->number_of_types = n_types;
+
+	return;
+}
+
+
+// returns TRUE_m12 if the query selects fewer records than a full read of its window
+TERN_m12	record_query_active(RECORD_QUERY *rq)
+{
+	if (rq->number_of_types > 0 || rq->limit != RQ_NO_LIMIT)
+		return(TRUE_m12);
+
+	return(FALSE_m12);
+}
+
+
+// returns the records matching the query (an empty result if there are none, or the session's records cannot be read)
+RECORD_QUERY_RESULT	*query_session_records(SESSION_m12 *sess, RECORD_QUERY *rq)
+{
+	si4				t;
+	si8				i, j, k, first, end, n_matches, run_bytes;
+	ui1				*rd;
+	RQ_ENTRY			*entry, **matches;
+	RECORD_INDEX			*ridx;
+	RECORD_QUERY_RESULT		*res;
+	FILE_PROCESSING_STRUCT_m12	*fps;
+
+
+	res = (RECORD_QUERY_RESULT *) calloc((size_t) 1, sizeof(RECORD_QUERY_RESULT));
+	ridx = session_record_index(sess);
+	if (ridx == NULL)
+		return(res);
+
+	// matching entries (time ordered)
+	record_entry_range(ridx, rq->start_time, rq->end_time, &first, &end);
+	if (end <= first)
+		return(res);
+	matches = (RQ_ENTRY **) malloc((size_t) (end - first) * sizeof(RQ_ENTRY *));
+	n_matches = 0;
+	for (i = first; i < end; ++i) {
+		entry = ridx->entries + i;
+		if (rq->number_of_types > 0) {
+			for (t = 0; t < rq->number_of_types; ++t)
+				if (entry->type_code == rq->type_codes[t])
+					break;
+			if (t == rq->number_of_types)
+				continue;
+		}
+		matches[n_matches++] = entry;
+		if (n_matches == rq->limit)
+			break;
+	}
+	if (n_matches == 0) {
+		free((void *) matches);
+		return(res);
+	}
+
+	// decode matches: journaled records are in the index, record file records are read in runs of adjacent records
+	res->records = (RECORD_HEADER_m12 **) malloc((size_t) n_matches * sizeof(RECORD_HEADER_m12 *));
+	res->fps = (FILE_PROCESSING_STRUCT_m12 **) malloc((size_t) n_matches * sizeof(FILE_PROCESSING_STRUCT_m12 *));
+	for (i = 0; i < n_matches; i = k) {
+		entry = matches[i];
+		if (entry->rh != NULL) {
+			res->records[res->number_of_records++] = entry->rh;
+			k = i + 1;
+			continue;
+		}
+		run_bytes = entry->bytes;
+		for (k = i + 1; k < n_matches; ++k) {
+			if (matches[k]->rh != NULL || matches[k]->source != entry->source || matches[k]->file_offset != entry->file_offset + run_bytes)
+				break;
+			run_bytes += matches[k]->bytes;
+		}
+		fps = G_read_file_m12(NULL, ridx->sources[entry->source].rd_file, entry->file_offset, run_bytes, k - i, NULL, NULL, USE_GLOBAL_BEHAVIOR_m12);
+		if (fps == NULL) {
+			G_warning_message_m12("%s(): cannot read records of segment %d\n", __FUNCTION__, ridx->sources[entry->source].segment_number);
+			continue;
+		}
+		res->fps[res->number_of_fps++] = fps;
+		rd = fps->record_data;
+		for (j = i; j < k; ++j) {
+			res->records[res->number_of_records++] = (RECORD_HEADER_m12 *) rd;
+			rd += ((RECORD_HEADER_m12 *) rd)->total_record_bytes;
+		}
+	}
+	free((void *) matches);
+
+	return(res);
+}
+
+
+void	free_record_query_result(RECORD_QUERY_RESULT *res)
+{
+	si8	i;
+
+
+	if (res == NULL)
+		return;
+
+	for (i = 0; i < res->number_of_fps; ++i)
+		FPS_free_processing_struct_m12(res->fps[i], TRUE_m12);
+	free((void *) res->fps);
+	free((void *) res->records);
+	free((void *) res);
+
+	return;
+}
+
+
+// returns the session's cached record index (rebuilt if its files changed), or a new one (replacing the least recently used)
+RECORD_INDEX	*session_record_index(SESSION_m12 *sess)
+{
+	si4		i, slot;
+
+
+	for (i = 0; i < RQ_CACHED_SESSIONS; ++i)
+		if (record_indices[i] != NULL && strcmp(record_indices[i]->sess_path, sess->path) == 0)
+			break;
+	if (i < RQ_CACHED_SESSIONS) {
+		slot = i;
+		if (record_indices[slot]->number_of_sources == globals_m12->number_of_session_segments + 1 && record_indices[slot]->access_level == globals_m12->password_data.access_level && record_index_current(record_indices[slot]) == TRUE_m12) {
+			record_indices[slot]->last_used = ++record_index_clock;
+			return(record_indices[slot]);
+		}
+	} else {  // empty slot, or least recently used
+		for (i = slot = 0; i < RQ_CACHED_SESSIONS; ++i) {
+			if (record_indices[i] == NULL) {
+				slot = i;
+				break;
+			}
+			if (record_indices[i]->last_used < record_indices[slot]->last_used)
+				slot = i;
+		}
+	}
+	free_record_index(record_indices[slot]);
+	record_indices[slot] = build_record_index(sess);
+	if (record_indices[slot] != NULL)
+		record_indices[slot]->last_used = ++record_index_clock;
+
+	return(record_indices[slot]);
+}
+
+
+// builds index of the session's live records (files are stamped before they are read, so changes while building are seen by the next query)
+RECORD_INDEX	*build_record_index(SESSION_m12 *sess)
+{
+	si1				*sess_name;
+	si4				i, n_segs;
+	si8				j, n_recs, max_entries;
+	RQ_SOURCE			*src;
+	RQ_ENTRY			*entry;
+	RECORD_INDEX			*ridx;
+	SEGMENT_RECORD			*recs;
+	SEGMENT_RECORD_FILES		srf;
+	FILE_PROCESSING_STRUCT_m12	*ri_fps;
+
+
+	n_segs = globals_m12->number_of_session_segments;
+	if (n_segs < 0)
+		return(NULL);
+	ridx = (RECORD_INDEX *) calloc((size_t) 1, sizeof(RECORD_INDEX));
+	strcpy(ridx->sess_path, sess->path);
+	ridx->access_level = globals_m12->password_data.access_level;
+	ridx->number_of_sources = n_segs + 1;
+	ridx->sources = (RQ_SOURCE *) calloc((size_t) ridx->number_of_sources, sizeof(RQ_SOURCE));
+
+	// session records (no journal)
+	src = ridx->sources;
+	sess_name = globals_m12->fs_session_name;
+	sprintf_m12(src->ri_file, "%s/%s.%s", sess->path, sess_name, RECORD_INDICES_FILE_TYPE_STRING_m12);
+	if (G_exists_m12(src->ri_file) == DOES_NOT_EXIST_m12) {
+		sess_name = globals_m12->uh_session_name;
+		sprintf_m12(src->ri_file, "%s/%s.%s", sess->path, sess_name, RECORD_INDICES_FILE_TYPE_STRING_m12);
+	}
+	sprintf_m12(src->rd_file, "%s/%s.%s", sess->path, sess_name, RECORD_DATA_FILE_TYPE_STRING_m12);
+
+	// segmented session records
+	for (i = 1; i <= n_segs; ++i) {
+		src = ridx->sources + i;
+		find_segment_record_files(sess, i, &srf);
+		src->segment_number = i;
+		strcpy(src->ri_file, srf.ri_file);
+		strcpy(src->rd_file, srf.rd_file);
+		strcpy(src->journal_file, srf.journal_file);
+	}
+
+	// entries
+	max_entries = 0;
+	for (i = 0; i < ridx->number_of_sources; ++i) {
+		src = ridx->sources + i;
+		stamp_record_file(src->ri_file, &src->ri_stamp);
+		ri_fps = NULL;
+		if (src->ri_stamp.size != RQ_NO_FILE)
+			ri_fps = G_read_file_m12(NULL, src->ri_file, 0, 0, FPS_FULL_FILE_m12, NULL, NULL, USE_GLOBAL_BEHAVIOR_m12);
+		if (*src->journal_file) {
+			stamp_record_file(src->journal_file, &src->journal_stamp);
+			if (src->journal_stamp.size != RQ_NO_FILE)
+				src->jnl = read_record_journal(src->journal_file);
+		}
+		if (ri_fps == NULL && src->jnl == NULL)
+			continue;
+		recs = collect_segment_records(ri_fps, NULL, src->jnl, NULL, 0, &n_recs);
+		if (ridx->number_of_entries + n_recs > max_entries) {
+			max_entries = (ridx->number_of_entries + n_recs) * 2;
+			ridx->entries = (RQ_ENTRY *) realloc((void *) ridx->entries, (size_t) max_entries * sizeof(RQ_ENTRY));
+		}
+		for (j = 0; j < n_recs; ++j) {
+			if (recs[j].live == FALSE_m12)
+				continue;
+			switch (recs[j].ri.type_code) {
+				// excluded types (as record readers exclude them)
+				case REC_Term_TYPE_CODE_m12:
+				case REC_SyLg_TYPE_CODE_m12:
+					continue;
+				default:
+					break;
+			}
+			entry = ridx->entries + ridx->number_of_entries++;
+			entry->start_time = recs[j].ri.start_time;
+			entry->type_code = recs[j].ri.type_code;
+			entry->source = i;
+			entry->order = recs[j].order;
+			entry->rh = recs[j].rh;
+			if (entry->rh == NULL) {  // record files' records come first, in index order (terminal index gives the last one's end)
+				entry->file_offset = recs[j].ri.file_offset;
+				entry->bytes = ri_fps->record_indices[recs[j].order + 1].file_offset - entry->file_offset;
+			} else {
+				entry->file_offset = entry->bytes = 0;
+			}
+		}
+		free((void *) recs);
+		FPS_free_processing_struct_m12(ri_fps, TRUE_m12);
+	}
+	if (ridx->number_of_entries > 0)
+		qsort((void *) ridx->entries, (size_t) ridx->number_of_entries, sizeof(RQ_ENTRY), compare_record_entries);
+
+	return(ridx);
+}
+
+
+// returns TRUE_m12 if none of the index's record indices files or journals changed since it was built
+TERN_m12	record_index_current(RECORD_INDEX *ridx)
+{
+	si4		i;
+	RQ_STAMP	stamp;
+	RQ_SOURCE	*src;
+
+
+	for (i = 0; i < ridx->number_of_sources; ++i) {
+		src = ridx->sources + i;
+		stamp_record_file(src->ri_file, &stamp);
+		if (stamp.mtime != src->ri_stamp.mtime || stamp.size != src->ri_stamp.size)
+			return(FALSE_m12);
+		if (*src->journal_file == 0)
+			continue;
+		stamp_record_file(src->journal_file, &stamp);
+		if (stamp.mtime != src->journal_stamp.mtime || stamp.size != src->journal_stamp.size)
+			return(FALSE_m12);
+	}
+
+	return(TRUE_m12);
+}
+
+
+void	free_record_index(RECORD_INDEX *ridx)
+{
+	si4	i;
+
+
+	if (ridx == NULL)
+		return;
+
+	for (i = 0; i < ridx->number_of_sources; ++i)
+		free_record_journal(ridx->sources[i].jnl);
+	free((void *) ridx->sources);
+	free((void *) ridx->entries);
+	free((void *) ridx);
+
+	return;
+}
+
+
+// frees cached indices (mex exit functions)
+void	free_record_indices(void)
+{
+	si4	i;
+
+
+	for (i = 0; i < RQ_CACHED_SESSIONS; ++i) {
+		free_record_index(record_indices[i]);
+		record_indices[i] = NULL;
+	}
+
+	return;
+}
+
+
+// sets file's modification time & size (RQ_NO_FILE if it does not exist)
+void	stamp_record_file(si1 *path, RQ_STAMP *stamp)
+{
+#if defined MACOS_m12 || defined LINUX_m12
+	struct stat	sb;
+#endif
+#ifdef WINDOWS_m12
+	struct __stat64	sb;
+#endif
+
+
+#if defined MACOS_m12 || defined LINUX_m12
+	if (stat(path, &sb) != 0) {
+		stamp->mtime = stamp->size = RQ_NO_FILE;
+		return;
+	}
+	#ifdef MACOS_m12
+	stamp->mtime = ((si8) sb.st_mtimespec.tv_sec * (si8) 1000000000) + (si8) sb.st_mtimespec.tv_nsec;
+	#else
+	stamp->mtime = ((si8) sb.st_mtim.tv_sec * (si8) 1000000000) + (si8) sb.st_mtim.tv_nsec;
+	#endif
+	stamp->size = (si8) sb.st_size;
+#endif
+#ifdef WINDOWS_m12
+	if (_stat64(path, &sb) != 0) {
+		stamp->mtime = stamp->size = RQ_NO_FILE;
+		return;
+	}
+	stamp->mtime = (si8) sb.st_mtime * (si8) 1000000000;
+	stamp->size = (si8) sb.st_size;
+#endif
+
+	return;
+}
+
+
+// sets [first, end) to the entries with start times in [start_time, end_time]
+void	record_entry_range(RECORD_INDEX *ridx, si8 start_time, si8 end_time, si8 *first, si8 *end)
+{
+	si8	lo, hi, mid;
+
+
+	// first entry at or after start_time
+	lo = 0;
+	hi = ridx->number_of_entries;
+	while (lo < hi) {
+		mid = lo + ((hi - lo) >> 1);
+		if (ridx->entries[mid].start_time < start_time)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	*first = lo;
+
+	// first entry after end_time
+	hi = ridx->number_of_entries;
+	while (lo < hi) {
+		mid = lo + ((hi - lo) >> 1);
+		if (ridx->entries[mid].start_time <= end_time)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	*end = lo;
+
+	return;
+}
+
+
+// sort by time, then by source (session records first, then segment order), then by position in the source
+si4	compare_record_entries(const void *a, const void *b)
+{
+	RQ_ENTRY	*ea, *eb;
+
+
+	ea = (RQ_ENTRY *) a;
+	eb = (RQ_ENTRY *) b;
+	if (ea->start_time != eb->start_time)
+		return((ea->start_time > eb->start_time) ? 1 : -1);
+	if (ea->source != eb->source)
+		return((ea->source > eb->source) ? 1 : -1);
+	if (ea->order != eb->order)
+		return((ea->order > eb->order) ? 1 : -1);
+
+	return(0);
+}
@@ -0,0 +1,81 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+#ifndef RECORD_QUERY_IN
+#define RECORD_QUERY_IN
+
+// Includes
+#include "medlib_m12.h"
+#include "record_journal.h"
+
+// Miscellaneous
+#define RQ_CACHED_SESSIONS		4				// session record indices kept between queries (least recently used are freed)
+#define RQ_MAX_TYPES			32
+#define RQ_NO_LIMIT			((si8) 0)
+#define RQ_NO_FILE			((si8) -1)			// stamp of a file that did not exist
+
+// Record Query Structures
+typedef struct {
+	ui4			type_codes[RQ_MAX_TYPES];
+	si4			number_of_types;  // 0: all types
+	si8			start_time, end_time;  // window of record start times (inclusive)
+	si8			limit;  // first limit matching records (RQ_NO_LIMIT: all)
+} RECORD_QUERY;
+
+typedef struct {
+	si8			number_of_records;
+	RECORD_HEADER_m12	**records;  // time ordered: point into fps, or into the index's journals
+	si8			number_of_fps;
+	FILE_PROCESSING_STRUCT_m12	**fps;  // record data read for the query
+} RECORD_QUERY_RESULT;
+
+// Record Index Structures
+typedef struct {
+	si8			mtime;  // nanoseconds (seconds resolution on some file systems)
+	si8			size;
+} RQ_STAMP;
+
+typedef struct {  // record files of the session (segment 0), or of one segment
+	si4			segment_number;
+	si1			ri_file[FULL_FILE_NAME_BYTES_m12], rd_file[FULL_FILE_NAME_BYTES_m12], journal_file[FULL_FILE_NAME_BYTES_m12];  // journal_file is "" for session records
+	RQ_STAMP		ri_stamp, journal_stamp;
+	RECORD_JOURNAL		*jnl;  // journaled records are decoded from here
+} RQ_SOURCE;
+
+typedef struct {
+	si8			start_time;
+	ui4			type_code;
+	si4			source;  // index into sources (sources are in segment order)
+	si8			order;  // position in source's merged records
+	si8			file_offset, bytes;  // in source's record data file (records in the record files)
+	RECORD_HEADER_m12	*rh;  // journaled records, else NULL
+} RQ_ENTRY;
+
+typedef struct {  // live records of every segment (& the session), sorted by start time (terminal & system log records excluded)
+	si1			sess_path[FULL_FILE_NAME_BYTES_m12];
+	si4			number_of_sources;
+	RQ_SOURCE		*sources;
+	si8			number_of_entries;
+	RQ_ENTRY		*entries;
+	ui1			access_level;  // password access level the journals were decrypted with
+	ui8			last_used;
+} RECORD_INDEX;
+
+
+// Prototypes
+void			initialize_record_query(RECORD_QUERY *rq);
+void			get_record_types(const mxArray *mx_arr, RECORD_QUERY *rq);
+TERN_m12		record_query_active(RECORD_QUERY *rq);
+RECORD_QUERY_RESULT	*query_session_records(SESSION_m12 *sess, RECORD_QUERY *rq);
+void			free_record_query_result(RECORD_QUERY_RESULT *res);
+RECORD_INDEX		*session_record_index(SESSION_m12 *sess);
+RECORD_INDEX		*build_record_index(SESSION_m12 *sess);
+TERN_m12		record_index_current(RECORD_INDEX *ridx);
+void			free_record_index(RECORD_INDEX *ridx);
+void			free_record_indices(void);
+void			stamp_record_file(si1 *path, RQ_STAMP *stamp);
+void			record_entry_range(RECORD_INDEX *ridx, si8 start_time, si8 end_time, si8 *first, si8 *end);
+si4			compare_record_entries(const void *a, const void *b);
+
+
+#endif /* RECORD_QUERY_IN */
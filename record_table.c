@@ -0,0 +1,170 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Record tables
+// Builds the gateways' 'table' record format: a struct of columns (start & end times, type codes & indices, versions, encryption levels, & text),
+// a row per record, with the distinct record type strings. matrix_MED tables have a start index column first (filled by matrix_MED).
+
+
+#include "record_table.h"
+
+
+// record table: one column per field, with n_recs rows (filled by fill_record_table_row(), in time order, then finish_record_table())
+mxArray	*create_record_table(si8 n_recs, RECORD_TABLE *rt, TERN_m12 start_indices)
+{
+	ui8			n_dims;
+	mwSize			dims[2];
+	mxArray			*tmp_mxa;
+	si4			i, n_mat_record_table_fields;
+	const si1		*mat_record_table_field_names[NUMBER_OF_RECORD_TABLE_FIELDS_mat + 1];
+	const si1		*table_field_names[] = RECORD_TABLE_FIELD_NAMES_mat;
+
+
+	// field names
+	n_mat_record_table_fields = 0;
+	if (start_indices == TRUE_m12)
+		mat_record_table_field_names[n_mat_record_table_fields++] = RECORD_TABLE_START_INDEX_FIELD_NAME_mat;
+	rt->field_offset = n_mat_record_table_fields;
+	for (i = 0; i < NUMBER_OF_RECORD_TABLE_FIELDS_mat; ++i)
+		mat_record_table_field_names[n_mat_record_table_fields++] = table_field_names[i];
+
+	dims[0] = (mwSize) n_recs; dims[1] = 1; n_dims = 2;
+	rt->mat_table = mxCreateStructMatrix(1, 1, n_mat_record_table_fields, mat_record_table_field_names);
+	// start index (filled by the caller)
+	rt->start_indices = NULL;
+	if (start_indices == TRUE_m12) {
+		tmp_mxa = mxCreateNumericArray(n_dims, dims, mxINT64_CLASS, mxREAL);
+		rt->start_indices = (si8 *) mxGetPr(tmp_mxa);
+		mxSetFieldByNumber(rt->mat_table, 0, RECORD_TABLE_FIELDS_START_INDEX_IDX_mat, tmp_mxa);
+	}
+	// start time
+	tmp_mxa = mxCreateNumericArray(n_dims, dims, mxINT64_CLASS, mxREAL);
+	rt->start_times = (si8 *) mxGetPr(tmp_mxa);
+	mxSetFieldByNumber(rt->mat_table, 0, rt->field_offset + RECORD_TABLE_FIELDS_START_TIME_IDX_mat, tmp_mxa);
+	// end time
+	tmp_mxa = mxCreateNumericArray(n_dims, dims, mxINT64_CLASS, mxREAL);
+	rt->end_times = (si8 *) mxGetPr(tmp_mxa);
+	mxSetFieldByNumber(rt->mat_table, 0, rt->field_offset + RECORD_TABLE_FIELDS_END_TIME_IDX_mat, tmp_mxa);
+	// type code
+	tmp_mxa = mxCreateNumericArray(n_dims, dims, mxUINT32_CLASS, mxREAL);
+	rt->type_codes = (ui4 *) mxGetPr(tmp_mxa);
+	mxSetFieldByNumber(rt->mat_table, 0, rt->field_offset + RECORD_TABLE_FIELDS_TYPE_CODE_IDX_mat, tmp_mxa);
+	// type index
+	tmp_mxa = mxCreateNumericArray(n_dims, dims, mxUINT8_CLASS, mxREAL);
+	rt->type_indices = (ui1 *) mxGetPr(tmp_mxa);
+	mxSetFieldByNumber(rt->mat_table, 0, rt->field_offset + RECORD_TABLE_FIELDS_TYPE_INDEX_IDX_mat, tmp_mxa);
+	// version
+	tmp_mxa = mxCreateNumericArray(n_dims, dims, mxDOUBLE_CLASS, mxREAL);
+	rt->versions = (sf8 *) mxGetPr(tmp_mxa);
+	mxSetFieldByNumber(rt->mat_table, 0, rt->field_offset + RECORD_TABLE_FIELDS_VERSION_IDX_mat, tmp_mxa);
+	// encryption
+	tmp_mxa = mxCreateNumericArray(n_dims, dims, mxINT8_CLASS, mxREAL);
+	rt->encryptions = (si1 *) mxGetPr(tmp_mxa);
+	mxSetFieldByNumber(rt->mat_table, 0, rt->field_offset + RECORD_TABLE_FIELDS_ENCRYPTION_IDX_mat, tmp_mxa);
+	// text (records without text are left empty)
+	rt->mat_text = mxCreateCellMatrix(n_recs, 1);
+	mxSetFieldByNumber(rt->mat_table, 0, rt->field_offset + RECORD_TABLE_FIELDS_TEXT_IDX_mat, rt->mat_text);
+
+	rt->number_of_types = 0;
+
+	return(rt->mat_table);
+}
+
+
+void	fill_record_table_row(RECORD_TABLE *rt, si8 row, RECORD_HEADER_m12 *rh)
+{
+	si1			*text;
+	si4			i;
+	si8			end_time;
+	REC_Note_v11_m12	*Note_v11;
+	REC_Seiz_v10_m12	*Seiz_v10;
+	REC_Epoc_v20_m12	*Epoc_v20;
+	REC_Sgmt_v10_m12	*Sgmt_v10;
+	REC_Sgmt_v11_m12	*Sgmt_v11;
+
+
+	// header fields
+	rt->start_times[row] = rh->start_time;
+	rt->type_codes[row] = rh->type_code;
+	rt->versions[row] = (sf8) rh->version_major + ((sf8) rh->version_minor / (sf8) 1000.0);
+	rt->encryptions[row] = rh->encryption_level;
+
+	// type index (Matlab indexing into types; 0 if too many types)
+	for (i = rt->number_of_types; i--;)
+		if (rt->type_codes_seen[i] == rh->type_code)
+			break;
+	if (i < 0 && rt->number_of_types < RECORD_TABLE_MAX_TYPES) {
+		i = rt->number_of_types++;
+		rt->type_codes_seen[i] = rh->type_code;
+		memcpy((void *) rt->type_strings[i], (void *) rh->type_string, (size_t) TYPE_BYTES_m12);
+		rt->type_strings[i][TYPE_BYTES_m12 - 1] = 0;
+	}
+	rt->type_indices[row] = (ui1) (i + 1);
+
+	// end time & text (no access to encrypted record bodies)
+	end_time = RECORD_TABLE_NO_TIME;
+	text = NULL;
+	if (rh->encryption_level <= 0) {
+		switch (rh->type_code) {
+			case REC_Note_TYPE_CODE_m12:
+				if (rh->version_major == 1 && rh->version_minor == 0) {
+					if (rh->total_record_bytes > RECORD_HEADER_BYTES_m12)
+						text = (si1 *) rh + RECORD_HEADER_BYTES_m12;
+				} else if (rh->version_major == 1 && rh->version_minor == 1) {
+					Note_v11 = (REC_Note_v11_m12 *) ((ui1 *) rh + RECORD_HEADER_BYTES_m12);
+					end_time = Note_v11->end_time;
+					text = Note_v11->text;
+				}
+				break;
+			case REC_Seiz_TYPE_CODE_m12:
+				if (rh->version_major == 1 && rh->version_minor == 0) {
+					Seiz_v10 = (REC_Seiz_v10_m12 *) ((ui1 *) rh + RECORD_HEADER_BYTES_m12);
+					if (Seiz_v10->end_time > 0)
+						end_time = Seiz_v10->end_time;
+					text = Seiz_v10->description;
+				}
+				break;
+			case REC_Epoc_TYPE_CODE_m12:
+				if (rh->version_major == 2 && rh->version_minor == 0) {
+					Epoc_v20 = (REC_Epoc_v20_m12 *) ((ui1 *) rh + RECORD_HEADER_BYTES_m12);
+					end_time = Epoc_v20->end_time;
+				}
+				break;
+			case REC_Sgmt_TYPE_CODE_m12:
+				if (rh->version_major == 1 && rh->version_minor == 0) {
+					Sgmt_v10 = (REC_Sgmt_v10_m12 *) ((ui1 *) rh + RECORD_HEADER_BYTES_m12);
+					end_time = Sgmt_v10->end_time;
+					if (rh->total_record_bytes > (RECORD_HEADER_BYTES_m12 + REC_Sgmt_v10_BYTES_m12))
+						text = (si1 *) rh + RECORD_HEADER_BYTES_m12 + REC_Sgmt_v10_BYTES_m12;
+				} else if (rh->version_major == 1 && rh->version_minor == 1) {
+					Sgmt_v11 = (REC_Sgmt_v11_m12 *) ((ui1 *) rh + RECORD_HEADER_BYTES_m12);
+					end_time = Sgmt_v11->end_time;
+					if (rh->total_record_bytes > (RECORD_HEADER_BYTES_m12 + REC_Sgmt_v11_BYTES_m12))
+						text = (si1 *) rh + RECORD_HEADER_BYTES_m12 + REC_Sgmt_v11_BYTES_m12;
+				}
+				break;
+		}
+	}
+	rt->end_times[row] = end_time;
+	if (text != NULL && *text)
+		mxSetCell(rt->mat_text, (mwIndex) row, mxCreateString(text));
+
+	return;
+}
+
+
+// sets the table's types (distinct record type strings, in order of first appearance)
+void	finish_record_table(RECORD_TABLE *rt)
+{
+	si4		i;
+	mxArray		*mat_types;
+
+
+	mat_types = mxCreateCellMatrix(rt->number_of_types, 1);
+	for (i = 0; i < rt->number_of_types; ++i)
+		mxSetCell(mat_types, (mwIndex) i, mxCreateString(rt->type_strings[i]));
+	mxSetFieldByNumber(rt->mat_table, 0, rt->field_offset + RECORD_TABLE_FIELDS_TYPES_IDX_mat, mat_types);
+
+	return;
+}
+
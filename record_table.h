@@ -0,0 +1,61 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+#ifndef RECORD_TABLE_IN
+#define RECORD_TABLE_IN
+
+// Includes
+#include "medlib_m12.h"
+
+// Matlab Record Table Structure (RecordFormat 'table': a row per record)
+#define NUMBER_OF_RECORD_TABLE_FIELDS_mat	8
+#define RECORD_TABLE_FIELD_NAMES_mat { \
+	"start_time", \
+	"end_time", \
+	"type_code", \
+	"type_index", \
+	"types", \
+	"version", \
+	"encryption", \
+	"text" \
+}
+#define RECORD_TABLE_FIELDS_START_TIME_IDX_mat	0
+#define RECORD_TABLE_FIELDS_END_TIME_IDX_mat	1
+#define RECORD_TABLE_FIELDS_TYPE_CODE_IDX_mat	2
+#define RECORD_TABLE_FIELDS_TYPE_INDEX_IDX_mat	3
+#define RECORD_TABLE_FIELDS_TYPES_IDX_mat	4
+#define RECORD_TABLE_FIELDS_VERSION_IDX_mat	5
+#define RECORD_TABLE_FIELDS_ENCRYPTION_IDX_mat	6
+#define RECORD_TABLE_FIELDS_TEXT_IDX_mat	7
+// tables with start indices (matrix_MED) have "start_index" as their first field (the fields above follow it)
+#define RECORD_TABLE_START_INDEX_FIELD_NAME_mat	"start_index"
+#define RECORD_TABLE_FIELDS_START_INDEX_IDX_mat	0
+
+// Miscellaneous
+#define RECORD_TABLE_MAX_TYPES			255  // distinct types given a type index (further types get 0)
+#define RECORD_TABLE_NO_TIME			((si8) -1)
+#define RECORD_TABLE_NO_INDEX			((si8) -1)  // record not in the matrix
+
+// Record Table Structures
+typedef struct {  // record table columns (filled a row at a time)
+	mxArray			*mat_table, *mat_text;
+	si4			field_offset;  // 1 if the table has start indices, else 0
+	si8			*start_indices;  // NULL if the table has none (set by the caller)
+	si8			*start_times, *end_times;
+	ui4			*type_codes;
+	ui1			*type_indices;
+	sf8			*versions;
+	si1			*encryptions;
+	si4			number_of_types;
+	ui4			type_codes_seen[RECORD_TABLE_MAX_TYPES];
+	si1			type_strings[RECORD_TABLE_MAX_TYPES][TYPE_BYTES_m12];
+} RECORD_TABLE;
+
+
+// Prototypes
+mxArray		*create_record_table(si8 n_recs, RECORD_TABLE *rt, TERN_m12 start_indices);
+void		fill_record_table_row(RECORD_TABLE *rt, si8 row, RECORD_HEADER_m12 *rh);
+void		finish_record_table(RECORD_TABLE *rt);
+
+
+#endif /* RECORD_TABLE_IN */
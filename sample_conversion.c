@@ -0,0 +1,716 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Vectorized sample conversion kernels for the Matlab output formats
+// The widest instruction set supported by the processor (SSE2, AVX2, or AVX-512) is selected at run time
+
+
+#include "sample_conversion.h"
+
+// Globals (scalar kernels until initialize_conversion_kernels() selects the processor's, so dispatch never checks)
+static CONVERSION_KERNELS	kernels = { CONVERSION_SCALAR, si4_to_sf8_scalar, si4_to_sf4_scalar, si4_to_si2_scalar, sf8_to_sf4_scalar, sf8_to_si4_scalar, sf8_to_si2_scalar };
+
+// clip counts are accumulated in 32-bit vector lanes & flushed every chunk
+#define CONVERSION_CHUNK_SAMPS	((si8) 1 << 20)
+
+
+// selects the kernels: call from the calling thread while no conversions are running (read_MED calls it once, when it is loaded)
+void	initialize_conversion_kernels(si4 max_instruction_set)
+{
+	si4	instruction_set;
+
+
+	instruction_set = CONVERSION_SCALAR;
+#ifdef CONVERSION_X86
+	instruction_set = supported_instruction_set();
+#endif
+	if (instruction_set > max_instruction_set)
+		instruction_set = max_instruction_set;
+
+	switch (instruction_set) {
+#ifdef CONVERSION_X86
+		case CONVERSION_AVX512:
+			kernels.si4_to_sf8 = si4_to_sf8_avx512;
+			kernels.si4_to_sf4 = si4_to_sf4_avx512;
+			kernels.si4_to_si2 = si4_to_si2_avx512;
+			kernels.sf8_to_sf4 = sf8_to_sf4_avx512;
+			kernels.sf8_to_si4 = sf8_to_si4_avx512;
+			kernels.sf8_to_si2 = sf8_to_si2_avx512;
+			break;
+		case CONVERSION_AVX2:
+			kernels.si4_to_sf8 = si4_to_sf8_avx2;
+			kernels.si4_to_sf4 = si4_to_sf4_avx2;
+			kernels.si4_to_si2 = si4_to_si2_avx2;
+			kernels.sf8_to_sf4 = sf8_to_sf4_avx2;
+			kernels.sf8_to_si4 = sf8_to_si4_avx2;
+			kernels.sf8_to_si2 = sf8_to_si2_avx2;
+			break;
+		case CONVERSION_SSE2:
+			kernels.si4_to_sf8 = si4_to_sf8_sse2;
+			kernels.si4_to_sf4 = si4_to_sf4_sse2;
+			kernels.si4_to_si2 = si4_to_si2_sse2;
+			kernels.sf8_to_sf4 = sf8_to_sf4_sse2;
+			kernels.sf8_to_si4 = sf8_to_si4_sse2;
+			kernels.sf8_to_si2 = sf8_to_si2_sse2;
+			break;
+#endif
+		default:
+			instruction_set = CONVERSION_SCALAR;
+			kernels.si4_to_sf8 = si4_to_sf8_scalar;
+			kernels.si4_to_sf4 = si4_to_sf4_scalar;
+			kernels.si4_to_si2 = si4_to_si2_scalar;
+			kernels.sf8_to_sf4 = sf8_to_sf4_scalar;
+			kernels.sf8_to_si4 = sf8_to_si4_scalar;
+			kernels.sf8_to_si2 = sf8_to_si2_scalar;
+			break;
+	}
+	kernels.instruction_set = instruction_set;
+
+	return;
+}
+
+
+const si1	*conversion_instruction_set_string(void)
+{
+	switch (kernels.instruction_set) {
+		case CONVERSION_AVX512:
+			return("AVX-512");
+		case CONVERSION_AVX2:
+			return("AVX2");
+		case CONVERSION_SSE2:
+			return("SSE2");
+	}
+
+	return("scalar");
+}
+
+
+//************************************************************************************************//
+//*************************************  Dispatching Kernels  ************************************//
+//************************************************************************************************//
+
+void	convert_si4_to_sf8(si4 *in, sf8 *out, si8 n_samps)
+{
+	(*kernels.si4_to_sf8)(in, out, n_samps);
+
+	return;
+}
+
+
+void	convert_si4_to_sf4(si4 *in, sf4 *out, si8 n_samps)
+{
+	(*kernels.si4_to_sf4)(in, out, n_samps);
+
+	return;
+}
+
+
+si8	convert_si4_to_si2(si4 *in, si2 *out, si8 n_samps)
+{
+	return((*kernels.si4_to_si2)(in, out, n_samps));
+}
+
+
+void	convert_sf8_to_sf4(sf8 *in, sf4 *out, si8 n_samps)
+{
+	(*kernels.sf8_to_sf4)(in, out, n_samps);
+
+	return;
+}
+
+
+si8	convert_sf8_to_si4(sf8 *in, si4 *out, si8 n_samps)
+{
+	return((*kernels.sf8_to_si4)(in, out, n_samps));
+}
+
+
+si8	convert_sf8_to_si2(sf8 *in, si2 *out, si8 n_samps)
+{
+	return((*kernels.sf8_to_si2)(in, out, n_samps));
+}
+
+
+//************************************************************************************************//
+//***************************************  Scalar Kernels  ***************************************//
+//************************************************************************************************//
+
+void	si4_to_sf8_scalar(si4 *in, sf8 *out, si8 n_samps)
+{
+	while (n_samps-- > 0)
+		*out++ = (sf8) *in++;
+
+	return;
+}
+
+
+void	si4_to_sf4_scalar(si4 *in, sf4 *out, si8 n_samps)
+{
+	while (n_samps-- > 0)
+		*out++ = (sf4) *in++;
+
+	return;
+}
+
+
+si8	si4_to_si2_scalar(si4 *in, si2 *out, si8 n_samps)
+{
+	si4	val;
+	si8	n_clipped;
+
+
+	n_clipped = 0;
+	while (n_samps-- > 0) {
+		val = *in++;  // curtail overflow
+		if (val > (si4) POS_INF_SI2_m12) {
+			val = (si4) POS_INF_SI2_m12;
+			++n_clipped;
+		} else if (val < (si4) NEG_INF_SI2_m12) {
+			val = (si4) NEG_INF_SI2_m12;
+			++n_clipped;
+		}
+		*out++ = (si2) val;
+	}
+
+	return(n_clipped);
+}
+
+
+void	sf8_to_sf4_scalar(sf8 *in, sf4 *out, si8 n_samps)
+{
+	while (n_samps-- > 0)
+		*out++ = (sf4) *in++;
+
+	return;
+}
+
+
+si8	sf8_to_si4_scalar(sf8 *in, si4 *out, si8 n_samps)
+{
+	si8	n_clipped;
+	sf8	val, lo, hi;
+
+
+	lo = (sf8) NEG_INF_SI4_m12;
+	hi = (sf8) POS_INF_SI4_m12;
+	n_clipped = 0;
+	while (n_samps-- > 0) {
+		val = *in++;
+		if (isnan(val)) {
+			*out++ = NAN_SI4_m12;
+			continue;
+		}
+		if (val > hi) {
+			val = hi;
+			++n_clipped;
+		} else if (val < lo) {
+			val = lo;
+			++n_clipped;
+		}
+		*out++ = (si4) (val + (signbit(val) ? (sf8) -0.5 : (sf8) 0.5));  // round half away from zero
+	}
+
+	return(n_clipped);
+}
+
+
+si8	sf8_to_si2_scalar(sf8 *in, si2 *out, si8 n_samps)
+{
+	si8	n_clipped;
+	sf8	val, lo, hi;
+
+
+	lo = (sf8) NEG_INF_SI2_m12;
+	hi = (sf8) POS_INF_SI2_m12;
+	n_clipped = 0;
+	while (n_samps-- > 0) {
+		val = *in++;
+		if (isnan(val)) {
+			*out++ = NAN_SI2_m12;
+			continue;
+		}
+		if (val > hi) {
+			val = hi;
+			++n_clipped;
+		} else if (val < lo) {
+			val = lo;
+			++n_clipped;
+		}
+		*out++ = (si2) (val + (signbit(val) ? (sf8) -0.5 : (sf8) 0.5));  // round half away from zero
+	}
+
+	return(n_clipped);
+}
+
+
+#ifdef CONVERSION_X86
+
+//************************************************************************************************//
+//****************************************  SSE2 Kernels  ****************************************//
+//************************************************************************************************//
+
+static si4	count_mask_bits(ui4 mask)
+{
+	si4	n;
+
+
+	for (n = 0; mask; ++n)
+		mask &= mask - 1;
+
+	return(n);
+}
+
+
+CONVERSION_TARGET("sse2")
+static si8	sum_si4_lanes_sse2(__m128i acc)
+{
+	si4	lanes[4];
+
+
+	_mm_storeu_si128((__m128i *) lanes, acc);
+
+	return((si8) lanes[0] + (si8) lanes[1] + (si8) lanes[2] + (si8) lanes[3]);
+}
+
+
+CONVERSION_TARGET("sse2")
+void	si4_to_sf8_sse2(si4 *in, sf8 *out, si8 n_samps)
+{
+	__m128i	a, b;
+
+
+	for (; n_samps >= 8; n_samps -= 8, in += 8, out += 8) {
+		a = _mm_loadu_si128((__m128i *) in);
+		b = _mm_loadu_si128((__m128i *) (in + 4));
+		_mm_storeu_pd(out, _mm_cvtepi32_pd(a));
+		_mm_storeu_pd(out + 2, _mm_cvtepi32_pd(_mm_shuffle_epi32(a, 0x0E)));
+		_mm_storeu_pd(out + 4, _mm_cvtepi32_pd(b));
+		_mm_storeu_pd(out + 6, _mm_cvtepi32_pd(_mm_shuffle_epi32(b, 0x0E)));
+	}
+	si4_to_sf8_scalar(in, out, n_samps);
+
+	return;
+}
+
+
+CONVERSION_TARGET("sse2")
+void	si4_to_sf4_sse2(si4 *in, sf4 *out, si8 n_samps)
+{
+	__m128i	a, b;
+
+
+	for (; n_samps >= 8; n_samps -= 8, in += 8, out += 8) {
+		a = _mm_loadu_si128((__m128i *) in);
+		b = _mm_loadu_si128((__m128i *) (in + 4));
+		_mm_storeu_ps(out, _mm_cvtepi32_ps(a));
+		_mm_storeu_ps(out + 4, _mm_cvtepi32_ps(b));
+	}
+	si4_to_sf4_scalar(in, out, n_samps);
+
+	return;
+}
+
+
+CONVERSION_TARGET("sse2")
+si8	si4_to_si2_sse2(si4 *in, si2 *out, si8 n_samps)
+{
+	si8	n_clipped, chunk;
+	__m128i	a, b, hi, lo, lo_16, acc;
+
+
+	hi = _mm_set1_epi32((si4) POS_INF_SI2_m12);
+	lo = _mm_set1_epi32((si4) NEG_INF_SI2_m12);
+	lo_16 = _mm_set1_epi16((si2) NEG_INF_SI2_m12);
+	n_clipped = 0;
+	while (n_samps >= 8) {
+		chunk = (n_samps < CONVERSION_CHUNK_SAMPS) ? n_samps : CONVERSION_CHUNK_SAMPS;
+		n_samps -= chunk & ~((si8) 7);
+		acc = _mm_setzero_si128();
+		for (; chunk >= 8; chunk -= 8, in += 8, out += 8) {
+			a = _mm_loadu_si128((__m128i *) in);
+			b = _mm_loadu_si128((__m128i *) (in + 4));
+			acc = _mm_sub_epi32(acc, _mm_or_si128(_mm_cmpgt_epi32(a, hi), _mm_cmplt_epi32(a, lo)));
+			acc = _mm_sub_epi32(acc, _mm_or_si128(_mm_cmpgt_epi32(b, hi), _mm_cmplt_epi32(b, lo)));
+			_mm_storeu_si128((__m128i *) out, _mm_max_epi16(_mm_packs_epi32(a, b), lo_16));  // pack saturates high, max sets floor
+		}
+		n_clipped += sum_si4_lanes_sse2(acc);
+	}
+	n_clipped += si4_to_si2_scalar(in, out, n_samps);
+
+	return(n_clipped);
+}
+
+
+CONVERSION_TARGET("sse2")
+void	sf8_to_sf4_sse2(sf8 *in, sf4 *out, si8 n_samps)
+{
+	__m128d	a, b;
+
+
+	for (; n_samps >= 4; n_samps -= 4, in += 4, out += 4) {
+		a = _mm_loadu_pd(in);
+		b = _mm_loadu_pd(in + 2);
+		_mm_storeu_ps(out, _mm_movelh_ps(_mm_cvtpd_ps(a), _mm_cvtpd_ps(b)));
+	}
+	sf8_to_sf4_scalar(in, out, n_samps);
+
+	return;
+}
+
+
+// clamp (NaNs pass through), round half away from zero, & truncate
+CONVERSION_TARGET("sse2")
+static __m128i	round_sf8_sse2(__m128d v, __m128d lo, __m128d hi, si8 *n_clipped)
+{
+	const __m128d	half = _mm_set1_pd((sf8) 0.5);
+	const __m128d	sign = _mm_set1_pd((sf8) -0.0);
+
+
+	*n_clipped += count_mask_bits((ui4) _mm_movemask_pd(_mm_or_pd(_mm_cmpgt_pd(v, hi), _mm_cmplt_pd(v, lo))));
+	v = _mm_min_pd(hi, _mm_max_pd(lo, v));
+	v = _mm_add_pd(v, _mm_or_pd(_mm_and_pd(v, sign), half));
+
+	return(_mm_cvttpd_epi32(v));  // NaN => 0x80000000
+}
+
+
+CONVERSION_TARGET("sse2")
+si8	sf8_to_si4_sse2(sf8 *in, si4 *out, si8 n_samps)
+{
+	si8	n_clipped;
+	__m128d	lo, hi;
+	__m128i	a, b;
+
+
+	lo = _mm_set1_pd((sf8) NEG_INF_SI4_m12);
+	hi = _mm_set1_pd((sf8) POS_INF_SI4_m12);
+	n_clipped = 0;
+	for (; n_samps >= 4; n_samps -= 4, in += 4, out += 4) {
+		a = round_sf8_sse2(_mm_loadu_pd(in), lo, hi, &n_clipped);
+		b = round_sf8_sse2(_mm_loadu_pd(in + 2), lo, hi, &n_clipped);
+		_mm_storeu_si128((__m128i *) out, _mm_unpacklo_epi64(a, b));
+	}
+	n_clipped += sf8_to_si4_scalar(in, out, n_samps);
+
+	return(n_clipped);
+}
+
+
+CONVERSION_TARGET("sse2")
+si8	sf8_to_si2_sse2(sf8 *in, si2 *out, si8 n_samps)
+{
+	si8	n_clipped;
+	__m128d	lo, hi;
+	__m128i	a, b, c, d;
+
+
+	lo = _mm_set1_pd((sf8) NEG_INF_SI2_m12);
+	hi = _mm_set1_pd((sf8) POS_INF_SI2_m12);
+	n_clipped = 0;
+	for (; n_samps >= 8; n_samps -= 8, in += 8, out += 8) {
+		a = round_sf8_sse2(_mm_loadu_pd(in), lo, hi, &n_clipped);
+		b = round_sf8_sse2(_mm_loadu_pd(in + 2), lo, hi, &n_clipped);
+		c = round_sf8_sse2(_mm_loadu_pd(in + 4), lo, hi, &n_clipped);
+		d = round_sf8_sse2(_mm_loadu_pd(in + 6), lo, hi, &n_clipped);
+		_mm_storeu_si128((__m128i *) out, _mm_packs_epi32(_mm_unpacklo_epi64(a, b), _mm_unpacklo_epi64(c, d)));  // NaN saturates to 0x8000
+	}
+	n_clipped += sf8_to_si2_scalar(in, out, n_samps);
+
+	return(n_clipped);
+}
+
+
+//************************************************************************************************//
+//****************************************  AVX2 Kernels  ****************************************//
+//************************************************************************************************//
+
+CONVERSION_TARGET("avx2")
+void	si4_to_sf8_avx2(si4 *in, sf8 *out, si8 n_samps)
+{
+	for (; n_samps >= 8; n_samps -= 8, in += 8, out += 8) {
+		_mm256_storeu_pd(out, _mm256_cvtepi32_pd(_mm_loadu_si128((__m128i *) in)));
+		_mm256_storeu_pd(out + 4, _mm256_cvtepi32_pd(_mm_loadu_si128((__m128i *) (in + 4))));
+	}
+	si4_to_sf8_scalar(in, out, n_samps);
+
+	return;
+}
+
+
+CONVERSION_TARGET("avx2")
+void	si4_to_sf4_avx2(si4 *in, sf4 *out, si8 n_samps)
+{
+	for (; n_samps >= 16; n_samps -= 16, in += 16, out += 16) {
+		_mm256_storeu_ps(out, _mm256_cvtepi32_ps(_mm256_loadu_si256((__m256i *) in)));
+		_mm256_storeu_ps(out + 8, _mm256_cvtepi32_ps(_mm256_loadu_si256((__m256i *) (in + 8))));
+	}
+	si4_to_sf4_scalar(in, out, n_samps);
+
+	return;
+}
+
+
+CONVERSION_TARGET("avx2")
+si8	si4_to_si2_avx2(si4 *in, si2 *out, si8 n_samps)
+{
+	si4	lanes[8];
+	si8	n_clipped, chunk;
+	__m256i	a, b, hi, lo, lo_16, acc;
+
+
+	hi = _mm256_set1_epi32((si4) POS_INF_SI2_m12);
+	lo = _mm256_set1_epi32((si4) NEG_INF_SI2_m12);
+	lo_16 = _mm256_set1_epi16((si2) NEG_INF_SI2_m12);
+	n_clipped = 0;
+	while (n_samps >= 16) {
+		chunk = (n_samps < CONVERSION_CHUNK_SAMPS) ? n_samps : CONVERSION_CHUNK_SAMPS;
+		n_samps -= chunk & ~((si8) 15);
+		acc = _mm256_setzero_si256();
+		for (; chunk >= 16; chunk -= 16, in += 16, out += 16) {
+			a = _mm256_loadu_si256((__m256i *) in);
+			b = _mm256_loadu_si256((__m256i *) (in + 8));
+			acc = _mm256_sub_epi32(acc, _mm256_or_si256(_mm256_cmpgt_epi32(a, hi), _mm256_cmpgt_epi32(lo, a)));
+			acc = _mm256_sub_epi32(acc, _mm256_or_si256(_mm256_cmpgt_epi32(b, hi), _mm256_cmpgt_epi32(lo, b)));
+			a = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);  // pack works within 128-bit lanes
+			_mm256_storeu_si256((__m256i *) out, _mm256_max_epi16(a, lo_16));
+		}
+		_mm256_storeu_si256((__m256i *) lanes, acc);
+		n_clipped += (si8) lanes[0] + (si8) lanes[1] + (si8) lanes[2] + (si8) lanes[3] + (si8) lanes[4] + (si8) lanes[5] + (si8) lanes[6] + (si8) lanes[7];
+	}
+	n_clipped += si4_to_si2_scalar(in, out, n_samps);
+
+	return(n_clipped);
+}
+
+
+CONVERSION_TARGET("avx2")
+void	sf8_to_sf4_avx2(sf8 *in, sf4 *out, si8 n_samps)
+{
+	for (; n_samps >= 8; n_samps -= 8, in += 8, out += 8) {
+		_mm_storeu_ps(out, _mm256_cvtpd_ps(_mm256_loadu_pd(in)));
+		_mm_storeu_ps(out + 4, _mm256_cvtpd_ps(_mm256_loadu_pd(in + 4)));
+	}
+	sf8_to_sf4_scalar(in, out, n_samps);
+
+	return;
+}
+
+
+// clamp (NaNs pass through), round half away from zero, & truncate
+CONVERSION_TARGET("avx2")
+static __m128i	round_sf8_avx2(__m256d v, __m256d lo, __m256d hi, si8 *n_clipped)
+{
+	const __m256d	half = _mm256_set1_pd((sf8) 0.5);
+	const __m256d	sign = _mm256_set1_pd((sf8) -0.0);
+
+
+	*n_clipped += count_mask_bits((ui4) _mm256_movemask_pd(_mm256_or_pd(_mm256_cmp_pd(v, hi, _CMP_GT_OQ), _mm256_cmp_pd(v, lo, _CMP_LT_OQ))));
+	v = _mm256_min_pd(hi, _mm256_max_pd(lo, v));
+	v = _mm256_add_pd(v, _mm256_or_pd(_mm256_and_pd(v, sign), half));
+
+	return(_mm256_cvttpd_epi32(v));  // NaN => 0x80000000
+}
+
+
+CONVERSION_TARGET("avx2")
+si8	sf8_to_si4_avx2(sf8 *in, si4 *out, si8 n_samps)
+{
+	si8	n_clipped;
+	__m256d	lo, hi;
+
+
+	lo = _mm256_set1_pd((sf8) NEG_INF_SI4_m12);
+	hi = _mm256_set1_pd((sf8) POS_INF_SI4_m12);
+	n_clipped = 0;
+	for (; n_samps >= 8; n_samps -= 8, in += 8, out += 8) {
+		_mm_storeu_si128((__m128i *) out, round_sf8_avx2(_mm256_loadu_pd(in), lo, hi, &n_clipped));
+		_mm_storeu_si128((__m128i *) (out + 4), round_sf8_avx2(_mm256_loadu_pd(in + 4), lo, hi, &n_clipped));
+	}
+	n_clipped += sf8_to_si4_scalar(in, out, n_samps);
+
+	return(n_clipped);
+}
+
+
+CONVERSION_TARGET("avx2")
+si8	sf8_to_si2_avx2(sf8 *in, si2 *out, si8 n_samps)
+{
+	si8	n_clipped;
+	__m256d	lo, hi;
+	__m128i	a, b;
+
+
+	lo = _mm256_set1_pd((sf8) NEG_INF_SI2_m12);
+	hi = _mm256_set1_pd((sf8) POS_INF_SI2_m12);
+	n_clipped = 0;
+	for (; n_samps >= 8; n_samps -= 8, in += 8, out += 8) {
+		a = round_sf8_avx2(_mm256_loadu_pd(in), lo, hi, &n_clipped);
+		b = round_sf8_avx2(_mm256_loadu_pd(in + 4), lo, hi, &n_clipped);
+		_mm_storeu_si128((__m128i *) out, _mm_packs_epi32(a, b));  // NaN saturates to 0x8000
+	}
+	n_clipped += sf8_to_si2_scalar(in, out, n_samps);
+
+	return(n_clipped);
+}
+
+
+//************************************************************************************************//
+//***************************************  AVX-512 Kernels  **************************************//
+//************************************************************************************************//
+
+CONVERSION_TARGET("avx512f")
+void	si4_to_sf8_avx512(si4 *in, sf8 *out, si8 n_samps)
+{
+	for (; n_samps >= 16; n_samps -= 16, in += 16, out += 16) {
+		_mm512_storeu_pd(out, _mm512_cvtepi32_pd(_mm256_loadu_si256((__m256i *) in)));
+		_mm512_storeu_pd(out + 8, _mm512_cvtepi32_pd(_mm256_loadu_si256((__m256i *) (in + 8))));
+	}
+	si4_to_sf8_scalar(in, out, n_samps);
+
+	return;
+}
+
+
+CONVERSION_TARGET("avx512f")
+void	si4_to_sf4_avx512(si4 *in, sf4 *out, si8 n_samps)
+{
+	for (; n_samps >= 16; n_samps -= 16, in += 16, out += 16)
+		_mm512_storeu_ps(out, _mm512_cvtepi32_ps(_mm512_loadu_si512((void *) in)));
+	si4_to_sf4_scalar(in, out, n_samps);
+
+	return;
+}
+
+
+CONVERSION_TARGET("avx512f")
+si8	si4_to_si2_avx512(si4 *in, si2 *out, si8 n_samps)
+{
+	si8	n_clipped;
+	__m512i	v, hi, lo;
+
+
+	hi = _mm512_set1_epi32((si4) POS_INF_SI2_m12);
+	lo = _mm512_set1_epi32((si4) NEG_INF_SI2_m12);
+	n_clipped = 0;
+	for (; n_samps >= 16; n_samps -= 16, in += 16, out += 16) {
+		v = _mm512_loadu_si512((void *) in);
+		n_clipped += count_mask_bits((ui4) (_mm512_cmpgt_epi32_mask(v, hi) | _mm512_cmplt_epi32_mask(v, lo)));
+		_mm256_storeu_si256((__m256i *) out, _mm512_cvtsepi32_epi16(_mm512_max_epi32(v, lo)));  // conversion saturates high
+	}
+	n_clipped += si4_to_si2_scalar(in, out, n_samps);
+
+	return(n_clipped);
+}
+
+
+CONVERSION_TARGET("avx512f")
+void	sf8_to_sf4_avx512(sf8 *in, sf4 *out, si8 n_samps)
+{
+	for (; n_samps >= 16; n_samps -= 16, in += 16, out += 16) {
+		_mm256_storeu_ps(out, _mm512_cvtpd_ps(_mm512_loadu_pd(in)));
+		_mm256_storeu_ps(out + 8, _mm512_cvtpd_ps(_mm512_loadu_pd(in + 8)));
+	}
+	sf8_to_sf4_scalar(in, out, n_samps);
+
+	return;
+}
+
+
+// clamp (NaNs pass through), round half away from zero, & truncate
+CONVERSION_TARGET("avx512f")
+static __m256i	round_sf8_avx512(__m512d v, __m512d lo, __m512d hi, si8 *n_clipped)
+{
+	const __m512i	half = _mm512_castpd_si512(_mm512_set1_pd((sf8) 0.5));
+	const __m512i	sign = _mm512_castpd_si512(_mm512_set1_pd((sf8) -0.0));
+
+
+	*n_clipped += count_mask_bits((ui4) (_mm512_cmp_pd_mask(v, hi, _CMP_GT_OQ) | _mm512_cmp_pd_mask(v, lo, _CMP_LT_OQ)));
+	v = _mm512_min_pd(hi, _mm512_max_pd(lo, v));
+	v = _mm512_add_pd(v, _mm512_castsi512_pd(_mm512_or_si512(_mm512_and_si512(_mm512_castpd_si512(v), sign), half)));
+
+	return(_mm512_cvttpd_epi32(v));  // NaN => 0x80000000
+}
+
+
+CONVERSION_TARGET("avx512f")
+si8	sf8_to_si4_avx512(sf8 *in, si4 *out, si8 n_samps)
+{
+	si8	n_clipped;
+	__m512d	lo, hi;
+
+
+	lo = _mm512_set1_pd((sf8) NEG_INF_SI4_m12);
+	hi = _mm512_set1_pd((sf8) POS_INF_SI4_m12);
+	n_clipped = 0;
+	for (; n_samps >= 8; n_samps -= 8, in += 8, out += 8)
+		_mm256_storeu_si256((__m256i *) out, round_sf8_avx512(_mm512_loadu_pd(in), lo, hi, &n_clipped));
+	n_clipped += sf8_to_si4_scalar(in, out, n_samps);
+
+	return(n_clipped);
+}
+
+
+CONVERSION_TARGET("avx512f")
+si8	sf8_to_si2_avx512(sf8 *in, si2 *out, si8 n_samps)
+{
+	si8	n_clipped;
+	__m512d	lo, hi;
+	__m512i	v;
+
+
+	lo = _mm512_set1_pd((sf8) NEG_INF_SI2_m12);
+	hi = _mm512_set1_pd((sf8) POS_INF_SI2_m12);
+	n_clipped = 0;
+	for (; n_samps >= 16; n_samps -= 16, in += 16, out += 16) {
+		v = _mm512_castsi256_si512(round_sf8_avx512(_mm512_loadu_pd(in), lo, hi, &n_clipped));
+		v = _mm512_inserti64x4(v, round_sf8_avx512(_mm512_loadu_pd(in + 8), lo, hi, &n_clipped), 1);
+		_mm256_storeu_si256((__m256i *) out, _mm512_cvtsepi32_epi16(v));  // NaN saturates to 0x8000
+	}
+	n_clipped += sf8_to_si2_scalar(in, out, n_samps);
+
+	return(n_clipped);
+}
+
+
+//************************************************************************************************//
+//*************************************  Processor Detection  ************************************//
+//************************************************************************************************//
+
+si4	supported_instruction_set(void)
+{
+#ifdef _MSC_VER
+	si4	info[4], max_leaf;
+	ui8	xcr0;
+
+
+	__cpuid(info, 0);
+	max_leaf = info[0];
+	__cpuid(info, 1);
+	if ((info[3] & (1 << 26)) == 0)  // SSE2
+		return(CONVERSION_SCALAR);
+	if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || max_leaf < 7)  // OSXSAVE & AVX
+		return(CONVERSION_SSE2);
+	xcr0 = (ui8) _xgetbv(0);
+	if ((xcr0 & 0x06) != 0x06)  // OS saves YMM state
+		return(CONVERSION_SSE2);
+	__cpuidex(info, 7, 0);
+	if ((info[1] & (1 << 16)) && (xcr0 & 0xE6) == 0xE6)  // AVX-512F & OS saves ZMM state
+		return(CONVERSION_AVX512);
+	if (info[1] & (1 << 5))  // AVX2
+		return(CONVERSION_AVX2);
+
+	return(CONVERSION_SSE2);
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f"))
+		return(CONVERSION_AVX512);
+	if (__builtin_cpu_supports("avx2"))
+		return(CONVERSION_AVX2);
+	if (__builtin_cpu_supports("sse2"))
+		return(CONVERSION_SSE2);
+
+	return(CONVERSION_SCALAR);
+#endif
+}
+
+#endif  // CONVERSION_X86
@@ -0,0 +1,81 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+#ifndef SAMPLE_CONVERSION_IN
+#define SAMPLE_CONVERSION_IN
+
+// Includes
+#include "medlib_m12.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	#define CONVERSION_X86
+	#include <immintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h>
+		#define CONVERSION_TARGET(isa)
+	#else
+		#define CONVERSION_TARGET(isa)	__attribute__((target(isa)))
+	#endif
+#endif
+
+// Instruction Sets (selected at run time)
+#define CONVERSION_SCALAR	0
+#define CONVERSION_SSE2		1
+#define CONVERSION_AVX2		2
+#define CONVERSION_AVX512	3
+
+// Conversion Kernel Table
+typedef struct {
+	si4	instruction_set;
+	void	(*si4_to_sf8)(si4 *in, sf8 *out, si8 n_samps);
+	void	(*si4_to_sf4)(si4 *in, sf4 *out, si8 n_samps);
+	si8	(*si4_to_si2)(si4 *in, si2 *out, si8 n_samps);
+	void	(*sf8_to_sf4)(sf8 *in, sf4 *out, si8 n_samps);
+	si8	(*sf8_to_si4)(sf8 *in, si4 *out, si8 n_samps);
+	si8	(*sf8_to_si2)(sf8 *in, si2 *out, si8 n_samps);
+} CONVERSION_KERNELS;
+
+
+// Prototypes
+void		initialize_conversion_kernels(si4 max_instruction_set);
+const si1	*conversion_instruction_set_string(void);
+// dispatching kernels: integer outputs saturate to the MED infinities & return the number of samples clipped
+// sf8 inputs are rounded half away from zero, NaNs become the MED NaN of the output type
+// outputs may overlay inputs at the same base address (conversions run front to back)
+void		convert_si4_to_sf8(si4 *in, sf8 *out, si8 n_samps);
+void		convert_si4_to_sf4(si4 *in, sf4 *out, si8 n_samps);
+si8		convert_si4_to_si2(si4 *in, si2 *out, si8 n_samps);
+void		convert_sf8_to_sf4(sf8 *in, sf4 *out, si8 n_samps);
+si8		convert_sf8_to_si4(sf8 *in, si4 *out, si8 n_samps);
+si8		convert_sf8_to_si2(sf8 *in, si2 *out, si8 n_samps);
+// scalar kernels (also used for vector loop tails)
+void		si4_to_sf8_scalar(si4 *in, sf8 *out, si8 n_samps);
+void		si4_to_sf4_scalar(si4 *in, sf4 *out, si8 n_samps);
+si8		si4_to_si2_scalar(si4 *in, si2 *out, si8 n_samps);
+void		sf8_to_sf4_scalar(sf8 *in, sf4 *out, si8 n_samps);
+si8		sf8_to_si4_scalar(sf8 *in, si4 *out, si8 n_samps);
+si8		sf8_to_si2_scalar(sf8 *in, si2 *out, si8 n_samps);
+#ifdef CONVERSION_X86
+void		si4_to_sf8_sse2(si4 *in, sf8 *out, si8 n_samps);
+void		si4_to_sf4_sse2(si4 *in, sf4 *out, si8 n_samps);
+si8		si4_to_si2_sse2(si4 *in, si2 *out, si8 n_samps);
+void		sf8_to_sf4_sse2(sf8 *in, sf4 *out, si8 n_samps);
+si8		sf8_to_si4_sse2(sf8 *in, si4 *out, si8 n_samps);
+si8		sf8_to_si2_sse2(sf8 *in, si2 *out, si8 n_samps);
+void		si4_to_sf8_avx2(si4 *in, sf8 *out, si8 n_samps);
+void		si4_to_sf4_avx2(si4 *in, sf4 *out, si8 n_samps);
+si8		si4_to_si2_avx2(si4 *in, si2 *out, si8 n_samps);
+void		sf8_to_sf4_avx2(sf8 *in, sf4 *out, si8 n_samps);
+si8		sf8_to_si4_avx2(sf8 *in, si4 *out, si8 n_samps);
+si8		sf8_to_si2_avx2(sf8 *in, si2 *out, si8 n_samps);
+void		si4_to_sf8_avx512(si4 *in, sf8 *out, si8 n_samps);
+void		si4_to_sf4_avx512(si4 *in, sf4 *out, si8 n_samps);
+si8		si4_to_si2_avx512(si4 *in, si2 *out, si8 n_samps);
+void		sf8_to_sf4_avx512(sf8 *in, sf4 *out, si8 n_samps);
+si8		sf8_to_si4_avx512(sf8 *in, si4 *out, si8 n_samps);
+si8		sf8_to_si2_avx512(sf8 *in, si2 *out, si8 n_samps);
+si4		supported_instruction_set(void);
+#endif
+
+
+#endif /* SAMPLE_CONVERSION_IN */
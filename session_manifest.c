@@ -0,0 +1,660 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Session manifest
+// Facts every cold open rederives (channel list, contigua, & record index) are saved in a versioned sidecar file next to the session directory
+// (<session>.medd.manifest), so later opens read them from one memory mapped file instead of reading every index & record file. The session itself is
+// still opened by medlib (its channel & segment structures are what the gateways read through).
+// The manifest lists the files & directories its contents depend on (session, channel, & records directories, every segment's time series indices, & record
+// indices files & journals) with their sizes & modification times: any change (e.g. an appended block, or an added record) makes it stale, & it is rewritten.
+// Manifests are written to a temporary file & renamed, so readers never see a partial manifest. Writing fails quietly on read-only media.
+
+
+#include "session_manifest.h"
+
+#if defined MACOS_m12 || defined LINUX_m12
+	#include <sys/stat.h>
+	#include <sys/mman.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <dirent.h>
+#endif
+#ifdef WINDOWS_m12
+	#include <sys/stat.h>
+#endif
+
+
+// returns mapped manifest, or NULL if there is none, or it is stale or unreadable
+SESSION_MANIFEST	*load_session_manifest(si1 *sess_path)
+{
+	si1			manifest_file[FULL_FILE_NAME_BYTES_m12];
+	si8			i, file_bytes;
+	void			*map;
+	MANIFEST_HEADER		*hdr;
+	MANIFEST_DEPENDENCY	dep;
+	SESSION_MANIFEST	*sm;
+#if defined MACOS_m12 || defined LINUX_m12
+	si4			fd;
+	struct stat		sb;
+#endif
+#ifdef WINDOWS_m12
+	HANDLE			file_handle, map_handle;
+	LARGE_INTEGER		size;
+#endif
+
+
+	manifest_file_name(sess_path, manifest_file);
+
+	// map file
+#if defined MACOS_m12 || defined LINUX_m12
+	fd = open(manifest_file, O_RDONLY);
+	if (fd < 0)
+		return(NULL);
+	if (fstat(fd, &sb) != 0 || sb.st_size < (off_t) sizeof(MANIFEST_HEADER)) {
+		close(fd);
+		return(NULL);
+	}
+	file_bytes = (si8) sb.st_size;
+	map = mmap(NULL, (size_t) file_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);  // mapping stays valid
+	if (map == MAP_FAILED)
+		return(NULL);
+#endif
+#ifdef WINDOWS_m12
+	file_handle = CreateFileA(manifest_file, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file_handle == INVALID_HANDLE_VALUE)
+		return(NULL);
+	if (GetFileSizeEx(file_handle, &size) == 0 || size.QuadPart < (LONGLONG) sizeof(MANIFEST_HEADER)) {
+		CloseHandle(file_handle);
+		return(NULL);
+	}
+	file_bytes = (si8) size.QuadPart;
+	map_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (map_handle == NULL) {
+		CloseHandle(file_handle);
+		return(NULL);
+	}
+	map = MapViewOfFile(map_handle, FILE_MAP_READ, 0, 0, 0);
+	if (map == NULL) {
+		CloseHandle(map_handle);
+		CloseHandle(file_handle);
+		return(NULL);
+	}
+#endif
+
+	sm = (SESSION_MANIFEST *) calloc((size_t) 1, sizeof(SESSION_MANIFEST));
+	sm->map = map;
+	sm->map_bytes = file_bytes;
+	sm->mapped = TRUE_m12;
+#ifdef WINDOWS_m12
+	sm->file_handle = file_handle;
+	sm->map_handle = map_handle;
+#endif
+	if (attach_session_manifest(sm) == FALSE_m12) {
+		free_session_manifest(sm);
+		return(NULL);
+	}
+	hdr = sm->header;
+
+	// check dependencies (stat only, nothing is read)
+	for (i = 0; i < hdr->number_of_dependencies; ++i) {
+		memcpy((void *) dep.path, (void *) sm->dependencies[i].path, (size_t) MANIFEST_PATH_BYTES);
+		dep.path[MANIFEST_PATH_BYTES - 1] = 0;
+		stamp_dependency(sess_path, &dep);
+		if (dep.mtime != sm->dependencies[i].mtime || dep.size != sm->dependencies[i].size) {
+			free_session_manifest(sm);
+			return(NULL);
+		}
+	}
+
+	return(sm);
+}
+
+
+// builds manifest of an open session (all segments must be mapped), returns manifest file contents (caller frees), or NULL if it cannot be built
+ui1	*build_session_manifest(SESSION_m12 *sess)
+{
+	si1				**chan_names, *tmp_name, sess_name[FULL_FILE_NAME_BYTES_m12], recd_name[MANIFEST_PATH_BYTES], number_str[FILE_NUMBERING_DIGITS_m12 + 1];
+	si1				path[FULL_FILE_NAME_BYTES_m12];
+	ui1				*buf;
+	si4				i, j, k, n_chans, n_segs, seg_idx, max_chans;
+	si8				m, n_contigs, n_recs, max_recs, n_deps, max_deps, n_entries, bytes;
+	CHANNEL_m12			*chan, *ref_chan;
+	SEGMENT_m12			*seg;
+	CONTIGUON_m12			*contigua;
+	TIME_SERIES_METADATA_SECTION_2_m12	*tmd2;
+	FILE_PROCESSING_STRUCT_m12	*ri_fps;
+	RECORD_JOURNAL			*jnl;
+	SEGMENT_RECORD			*seg_recs;
+	MANIFEST_HEADER			*hdr;
+	MANIFEST_CHANNEL		*m_chans;
+	MANIFEST_CONTIGUON		*m_contigs;
+	MANIFEST_RECORD			*m_recs;
+	MANIFEST_DEPENDENCY		*m_deps;
+#if defined MACOS_m12 || defined LINUX_m12
+	DIR				*dir;
+	struct dirent			*entry;
+#endif
+#ifdef WINDOWS_m12
+	HANDLE				find_handle;
+	WIN32_FIND_DATAA		find_data;
+#endif
+
+
+	// reference channel must map the whole session
+	ref_chan = globals_m12->reference_channel;
+	if (ref_chan == NULL || ref_chan->segments == NULL)
+		return(NULL);
+	n_segs = TIME_SLICE_SEGMENT_COUNT_m12(&ref_chan->time_slice);
+	seg_idx = G_get_segment_index_m12(ref_chan->time_slice.start_segment_number);
+	if (n_segs != globals_m12->number_of_session_segments || seg_idx != 0)
+		return(NULL);
+	for (j = 0; j < n_segs; ++j)
+		if (ref_chan->segments[j] == NULL || ref_chan->segments[j]->metadata_fps == NULL)
+			return(NULL);
+
+	// contigua (from reference channel indices)
+	if (read_segment_indices(ref_chan) == FALSE_m12)
+		return(NULL);
+	n_contigs = index_contigua(sess, &contigua);
+	if (n_contigs <= 0)
+		return(NULL);
+
+	// channel directories (all channels of the session, open or not)
+	n_chans = max_chans = 0;
+	chan_names = NULL;
+#if defined MACOS_m12 || defined LINUX_m12
+	dir = opendir(sess->path);
+	if (dir != NULL) {
+		while ((entry = readdir(dir)) != NULL) {
+			sprintf_m12(path, "%s", entry->d_name);
+#endif
+#ifdef WINDOWS_m12
+	sprintf_m12(path, "%s\\*.%s", sess->path, TIME_SERIES_CHANNEL_DIRECTORY_TYPE_STRING_m12);
+	find_handle = FindFirstFileA(path, &find_data);
+	if (find_handle != INVALID_HANDLE_VALUE) {
+		do {
+			sprintf_m12(path, "%s", find_data.cFileName);
+#endif
+			k = (si4) strlen(path) - (si4) strlen(TIME_SERIES_CHANNEL_DIRECTORY_TYPE_STRING_m12) - 1;
+			if (k < 1 || path[k] != '.' || strcmp(path + k + 1, TIME_SERIES_CHANNEL_DIRECTORY_TYPE_STRING_m12) || k >= BASE_FILE_NAME_BYTES_m12)
+				continue;
+			path[k] = 0;
+			if (n_chans == max_chans) {
+				max_chans = (max_chans) ? max_chans << 1 : 64;
+				chan_names = (si1 **) realloc((void *) chan_names, (size_t) max_chans * sizeof(si1 *));
+			}
+			chan_names[n_chans] = (si1 *) malloc((size_t) BASE_FILE_NAME_BYTES_m12);
+			strcpy(chan_names[n_chans++], path);
+#if defined MACOS_m12 || defined LINUX_m12
+		}
+		closedir(dir);
+	}
+#endif
+#ifdef WINDOWS_m12
+		} while (FindNextFileA(find_handle, &find_data));
+		FindClose(find_handle);
+	}
+#endif
+	if (n_chans == 0) {
+		free_m12((void *) contigua, __FUNCTION__);
+		return(NULL);
+	}
+	for (i = 1; i < n_chans; ++i) {  // sort names (insertion: directory order is arbitrary, but usually nearly sorted)
+		for (j = i; j > 0 && strcmp(chan_names[j - 1], chan_names[j]) > 0; --j) {
+			tmp_name = chan_names[j];
+			chan_names[j] = chan_names[j - 1];
+			chan_names[j - 1] = tmp_name;
+		}
+	}
+
+	// records directory & session records file names (file system session name first, as in add_record)
+	strcpy(sess_name, globals_m12->fs_session_name);
+	sprintf_m12(path, "%s/%s.%s", sess->path, sess_name, RECORD_INDICES_FILE_TYPE_STRING_m12);
+	if (G_exists_m12(path) == DOES_NOT_EXIST_m12) {
+		sprintf_m12(path, "%s/%s.%s", sess->path, globals_m12->uh_session_name, RECORD_INDICES_FILE_TYPE_STRING_m12);
+		if (G_exists_m12(path) == FILE_EXISTS_m12)
+			strcpy(sess_name, globals_m12->uh_session_name);
+	}
+	sprintf_m12(recd_name, "%s.%s", sess_name, RECORD_DIRECTORY_TYPE_STRING_m12);
+
+	// allocate manifest (records & dependencies grow as found)
+	max_recs = 1024;
+	max_deps = ((si8) n_chans * (si8) (n_segs + 1)) + ((si8) n_segs << 1) + 3;
+	bytes = (si8) sizeof(MANIFEST_HEADER) + ((si8) n_chans * (si8) sizeof(MANIFEST_CHANNEL)) + (n_contigs * (si8) sizeof(MANIFEST_CONTIGUON));
+	m_chans = (MANIFEST_CHANNEL *) calloc((size_t) n_chans, sizeof(MANIFEST_CHANNEL));
+	m_contigs = (MANIFEST_CONTIGUON *) calloc((size_t) n_contigs, sizeof(MANIFEST_CONTIGUON));
+	m_recs = (MANIFEST_RECORD *) malloc((size_t) max_recs * sizeof(MANIFEST_RECORD));
+	m_deps = (MANIFEST_DEPENDENCY *) calloc((size_t) max_deps, sizeof(MANIFEST_DEPENDENCY));
+	n_recs = n_deps = 0;
+
+	// channels & their dependencies (directory, & every segment's indices: the last grows while recording, & any may be rewritten)
+	for (i = 0; i < n_chans; ++i) {
+		strcpy(m_chans[i].name, chan_names[i]);
+		m_chans[i].sampling_frequency = FREQUENCY_NO_ENTRY_m12;
+		m_chans[i].number_of_samples = SAMPLE_NUMBER_NO_ENTRY_m12;
+		for (j = 0; j < sess->number_of_time_series_channels; ++j) {
+			chan = sess->time_series_channels[j];
+			if (strcmp(chan->name, chan_names[i]) || chan->segments == NULL)
+				continue;
+			k = G_get_segment_index_m12(chan->time_slice.start_segment_number) + TIME_SLICE_SEGMENT_COUNT_m12(&chan->time_slice) - 1;
+			seg = chan->segments[k];
+			if (seg != NULL && seg->metadata_fps != NULL) {
+				tmd2 = &seg->metadata_fps->metadata->time_series_section_2;
+				m_chans[i].sampling_frequency = tmd2->sampling_frequency;
+				m_chans[i].number_of_samples = tmd2->absolute_start_sample_number + tmd2->number_of_samples;
+			}
+			break;
+		}
+		snprintf(m_deps[n_deps++].path, MANIFEST_PATH_BYTES, "%s.%s", chan_names[i], TIME_SERIES_CHANNEL_DIRECTORY_TYPE_STRING_m12);
+		for (j = 1; j <= n_segs; ++j) {
+			G_numerical_fixed_width_string_m12(number_str, FILE_NUMBERING_DIGITS_m12, j);
+			snprintf(m_deps[n_deps++].path, MANIFEST_PATH_BYTES, "%s.%s/%s_s%s.%s/%s_s%s.%s", chan_names[i], TIME_SERIES_CHANNEL_DIRECTORY_TYPE_STRING_m12, chan_names[i], number_str, \
+				 TIME_SERIES_SEGMENT_DIRECTORY_TYPE_STRING_m12, chan_names[i], number_str, TIME_SERIES_INDICES_FILE_TYPE_STRING_m12);
+		}
+		free((void *) chan_names[i]);
+	}
+	free((void *) chan_names);
+
+	// contigua
+	for (m = 0; m < n_contigs; ++m) {
+		m_contigs[m].start_time = contigua[m].start_time;
+		m_contigs[m].end_time = contigua[m].end_time;
+		m_contigs[m].start_sample_number = contigua[m].start_sample_number;
+		m_contigs[m].end_sample_number = contigua[m].end_sample_number;
+	}
+	free_m12((void *) contigua, __FUNCTION__);
+
+	// records (session level file, then segmented session records files & their journals), & their dependencies
+	m_deps[n_deps++].path[0] = 0;  // session directory
+	snprintf(m_deps[n_deps++].path, MANIFEST_PATH_BYTES, "%s.%s", sess_name, RECORD_INDICES_FILE_TYPE_STRING_m12);
+	snprintf(m_deps[n_deps++].path, MANIFEST_PATH_BYTES, "%s", recd_name);
+	for (j = 0; j <= n_segs; ++j) {
+		jnl = NULL;
+		if (j == 0) {
+			sprintf_m12(path, "%s/%s.%s", sess->path, sess_name, RECORD_INDICES_FILE_TYPE_STRING_m12);
+		} else {
+			G_numerical_fixed_width_string_m12(number_str, FILE_NUMBERING_DIGITS_m12, j);
+			sprintf_m12(path, "%s/%s/%s_s%s.%s", sess->path, recd_name, sess_name, number_str, RJNL_FILE_TYPE_STRING);
+			snprintf(m_deps[n_deps++].path, MANIFEST_PATH_BYTES, "%s/%s_s%s.%s", recd_name, sess_name, number_str, RJNL_FILE_TYPE_STRING);  // journal (a dependency even if absent)
+			jnl = read_record_journal(path);
+			sprintf_m12(path, "%s/%s/%s_s%s.%s", sess->path, recd_name, sess_name, number_str, RECORD_INDICES_FILE_TYPE_STRING_m12);
+		}
+		ri_fps = NULL;
+		if (G_exists_m12(path) == FILE_EXISTS_m12) {
+			if (j)
+				snprintf(m_deps[n_deps++].path, MANIFEST_PATH_BYTES, "%s/%s_s%s.%s", recd_name, sess_name, number_str, RECORD_INDICES_FILE_TYPE_STRING_m12);
+			ri_fps = G_read_file_m12(NULL, path, 0, 0, FPS_FULL_FILE_m12, NULL, NULL, USE_GLOBAL_BEHAVIOR_m12);
+		}
+		if (ri_fps == NULL && jnl == NULL)
+			continue;
+		seg_recs = collect_segment_records(ri_fps, NULL, jnl, NULL, 0, &n_entries);  // journal merged (tombstones applied)
+		for (m = 0; m < n_entries; ++m) {
+			if (seg_recs[m].live == FALSE_m12)
+				continue;
+			if (n_recs == max_recs) {
+				max_recs <<= 1;
+				m_recs = (MANIFEST_RECORD *) realloc((void *) m_recs, (size_t) max_recs * sizeof(MANIFEST_RECORD));
+			}
+			m_recs[n_recs].start_time = seg_recs[m].ri.start_time;
+			m_recs[n_recs].type_code = seg_recs[m].ri.type_code;
+			m_recs[n_recs++].segment_number = j;
+		}
+		free((void *) seg_recs);
+		free_record_journal(jnl);
+		FPS_free_processing_struct_m12(ri_fps, TRUE_m12);
+	}
+	if (n_recs > 1)
+		qsort((void *) m_recs, (size_t) n_recs, sizeof(MANIFEST_RECORD), compare_manifest_records);
+	for (m = 0; m < n_deps; ++m)
+		stamp_dependency(sess->path, m_deps + m);
+	bytes += (n_recs * (si8) sizeof(MANIFEST_RECORD)) + (n_deps * (si8) sizeof(MANIFEST_DEPENDENCY));
+
+	// assemble
+	buf = (ui1 *) calloc((size_t) bytes, sizeof(ui1));
+	hdr = (MANIFEST_HEADER *) buf;
+	hdr->magic = MANIFEST_MAGIC;
+	hdr->version = MANIFEST_VERSION;
+	hdr->header_bytes = (ui4) sizeof(MANIFEST_HEADER);
+	hdr->file_bytes = bytes;
+	hdr->session_start_time = globals_m12->session_start_time;
+	hdr->session_end_time = globals_m12->session_end_time;
+	hdr->number_of_channels = n_chans;
+	hdr->number_of_segments = n_segs;
+	hdr->number_of_contigua = n_contigs;
+	hdr->number_of_records = n_recs;
+	hdr->number_of_dependencies = n_deps;
+	hdr->frequencies_vary = globals_m12->time_series_frequencies_vary;
+	hdr->channels_offset = (si8) sizeof(MANIFEST_HEADER);
+	hdr->contigua_offset = hdr->channels_offset + ((si8) n_chans * (si8) sizeof(MANIFEST_CHANNEL));
+	hdr->records_offset = hdr->contigua_offset + (n_contigs * (si8) sizeof(MANIFEST_CONTIGUON));
+	hdr->dependencies_offset = hdr->records_offset + (n_recs * (si8) sizeof(MANIFEST_RECORD));
+	memcpy((void *) (buf + hdr->channels_offset), (void *) m_chans, (size_t) n_chans * sizeof(MANIFEST_CHANNEL));
+	memcpy((void *) (buf + hdr->contigua_offset), (void *) m_contigs, (size_t) n_contigs * sizeof(MANIFEST_CONTIGUON));
+	memcpy((void *) (buf + hdr->records_offset), (void *) m_recs, (size_t) n_recs * sizeof(MANIFEST_RECORD));
+	memcpy((void *) (buf + hdr->dependencies_offset), (void *) m_deps, (size_t) n_deps * sizeof(MANIFEST_DEPENDENCY));
+	free((void *) m_chans);
+	free((void *) m_contigs);
+	free((void *) m_recs);
+	free((void *) m_deps);
+
+	return(buf);
+}
+
+
+// writes manifest contents to a temporary file & renames it (atomic replacement), returns FALSE_m12 if it could not be written
+TERN_m12	save_session_manifest(si1 *sess_path, ui1 *buf)
+{
+	si1		manifest_file[FULL_FILE_NAME_BYTES_m12], tmp_file[FULL_FILE_NAME_BYTES_m12];
+	si8		bytes, written;
+	FILE		*fp;
+
+
+	bytes = ((MANIFEST_HEADER *) buf)->file_bytes;
+	manifest_file_name(sess_path, manifest_file);
+#ifdef WINDOWS_m12
+	sprintf_m12(tmp_file, "%s.%lu.tmp", manifest_file, (unsigned long) GetCurrentProcessId());
+#else
+	sprintf_m12(tmp_file, "%s.%ld.tmp", manifest_file, (long) getpid());
+#endif
+	fp = fopen(tmp_file, "wb");
+	if (fp == NULL)
+		return(FALSE_m12);
+	written = (si8) fwrite((void *) buf, sizeof(ui1), (size_t) bytes, fp);
+	if (fclose(fp) != 0 || written != bytes) {
+		remove(tmp_file);
+		return(FALSE_m12);
+	}
+#ifdef WINDOWS_m12
+	if (MoveFileExA(tmp_file, manifest_file, MOVEFILE_REPLACE_EXISTING) == 0) {
+#else
+	if (rename(tmp_file, manifest_file) != 0) {
+#endif
+		remove(tmp_file);
+		return(FALSE_m12);
+	}
+
+	return(TRUE_m12);
+}
+
+
+TERN_m12	write_session_manifest(SESSION_m12 *sess)
+{
+	ui1		*buf;
+	TERN_m12	saved;
+
+
+	buf = build_session_manifest(sess);
+	if (buf == NULL)
+		return(FALSE_m12);
+	saved = save_session_manifest(sess->path, buf);
+	free((void *) buf);
+
+	return(saved);
+}
+
+
+// checks header & section bounds of manifest contents in sm->map, & sets section pointers
+TERN_m12	attach_session_manifest(SESSION_MANIFEST *sm)
+{
+	si8		file_bytes;
+	MANIFEST_HEADER	*hdr;
+
+
+	file_bytes = sm->map_bytes;
+	if (file_bytes < (si8) sizeof(MANIFEST_HEADER))
+		return(FALSE_m12);
+	hdr = sm->header = (MANIFEST_HEADER *) sm->map;
+	if (hdr->magic != MANIFEST_MAGIC || hdr->version != MANIFEST_VERSION || hdr->header_bytes != (ui4) sizeof(MANIFEST_HEADER) || hdr->file_bytes != file_bytes)
+		return(FALSE_m12);
+	if (hdr->channels_offset + ((si8) hdr->number_of_channels * (si8) sizeof(MANIFEST_CHANNEL)) > file_bytes || \
+	    hdr->contigua_offset + (hdr->number_of_contigua * (si8) sizeof(MANIFEST_CONTIGUON)) > file_bytes || \
+	    hdr->records_offset + (hdr->number_of_records * (si8) sizeof(MANIFEST_RECORD)) > file_bytes || \
+	    hdr->dependencies_offset + (hdr->number_of_dependencies * (si8) sizeof(MANIFEST_DEPENDENCY)) > file_bytes)
+		return(FALSE_m12);
+	sm->channels = (MANIFEST_CHANNEL *) ((ui1 *) sm->map + hdr->channels_offset);
+	sm->contigua = (MANIFEST_CONTIGUON *) ((ui1 *) sm->map + hdr->contigua_offset);
+	sm->records = (MANIFEST_RECORD *) ((ui1 *) sm->map + hdr->records_offset);
+	sm->dependencies = (MANIFEST_DEPENDENCY *) ((ui1 *) sm->map + hdr->dependencies_offset);
+
+	return(TRUE_m12);
+}
+
+
+void	free_session_manifest(SESSION_MANIFEST *sm)
+{
+	if (sm == NULL)
+		return;
+
+	if (sm->mapped == TRUE_m12) {
+#if defined MACOS_m12 || defined LINUX_m12
+		munmap(sm->map, (size_t) sm->map_bytes);
+#endif
+#ifdef WINDOWS_m12
+		UnmapViewOfFile(sm->map);
+		CloseHandle(sm->map_handle);
+		CloseHandle(sm->file_handle);
+#endif
+	} else {
+		free(sm->map);
+	}
+	free((void *) sm);
+
+	return;
+}
+
+
+// copies manifest contigua into medlib contigua (caller frees with free_m12()), returns number of contigua
+si8	manifest_contigua(SESSION_MANIFEST *sm, CONTIGUON_m12 **contigua)
+{
+	si8		i, n_contigs;
+	CONTIGUON_m12	*contigs;
+
+
+	n_contigs = sm->header->number_of_contigua;
+	*contigua = NULL;
+	if (n_contigs <= 0)
+		return(0);
+
+	contigs = (CONTIGUON_m12 *) calloc_m12((size_t) n_contigs, sizeof(CONTIGUON_m12), __FUNCTION__, USE_GLOBAL_BEHAVIOR_m12);
+	for (i = 0; i < n_contigs; ++i) {
+		contigs[i].start_time = sm->contigua[i].start_time;
+		contigs[i].end_time = sm->contigua[i].end_time;
+		contigs[i].start_sample_number = sm->contigua[i].start_sample_number;
+		contigs[i].end_sample_number = sm->contigua[i].end_sample_number;
+	}
+	*contigua = contigs;
+
+	return(n_contigs);
+}
+
+
+// session directory named by a gateway's file list (before the session is opened): a session directory, or the parent of a channel directory
+// returns FALSE_m12 if it cannot be known without opening (e.g. a regular expression)
+TERN_m12	manifest_session_path(void *file_list, si4 n_files, si1 *sess_path)
+{
+	si1	*name, *c;
+	si4	len, ext_len;
+
+
+	name = (n_files) ? ((si1 **) file_list)[0] : (si1 *) file_list;
+	if (name == NULL || *name == 0 || strlen(name) >= FULL_FILE_NAME_BYTES_m12)
+		return(FALSE_m12);
+	strcpy(sess_path, name);
+	len = (si4) strlen(sess_path);
+	while (len > 1 && (sess_path[len - 1] == '/' || sess_path[len - 1] == '\\'))
+		sess_path[--len] = 0;
+
+	// channel directory => parent
+	ext_len = (si4) strlen(TIME_SERIES_CHANNEL_DIRECTORY_TYPE_STRING_m12);
+	if (len > ext_len + 1 && sess_path[len - ext_len - 1] == '.' && strcmp(sess_path + len - ext_len, TIME_SERIES_CHANNEL_DIRECTORY_TYPE_STRING_m12) == 0) {
+		for (c = sess_path + len - 1; c > sess_path && *c != '/' && *c != '\\'; --c);
+		*c = 0;
+		len = (si4) strlen(sess_path);
+	}
+
+	// session directory
+	ext_len = (si4) strlen(SESSION_DIRECTORY_TYPE_STRING_m12);
+	if (len > ext_len + 1 && sess_path[len - ext_len - 1] == '.' && strcmp(sess_path + len - ext_len, SESSION_DIRECTORY_TYPE_STRING_m12) == 0)
+		return(TRUE_m12);
+
+	return(FALSE_m12);
+}
+
+
+void	manifest_file_name(si1 *sess_path, si1 *manifest_file)
+{
+	sprintf_m12(manifest_file, "%s.%s", sess_path, MANIFEST_FILE_SUFFIX);
+
+	return;
+}
+
+
+// sets dependency's modification time & size (MANIFEST_NO_FILE if it does not exist; directories have size 0), returns TRUE_m12 if it exists
+TERN_m12	stamp_dependency(si1 *sess_path, MANIFEST_DEPENDENCY *dep)
+{
+	si1		path[FULL_FILE_NAME_BYTES_m12];
+#if defined MACOS_m12 || defined LINUX_m12
+	struct stat	sb;
+#endif
+#ifdef WINDOWS_m12
+	struct __stat64	sb;
+#endif
+
+
+	if (*dep->path)
+		sprintf_m12(path, "%s/%s", sess_path, dep->path);
+	else
+		strcpy(path, sess_path);
+
+#if defined MACOS_m12 || defined LINUX_m12
+	if (stat(path, &sb) != 0) {
+		dep->mtime = dep->size = MANIFEST_NO_FILE;
+		return(FALSE_m12);
+	}
+	#ifdef MACOS_m12
+	dep->mtime = ((si8) sb.st_mtimespec.tv_sec * (si8) 1000000000) + (si8) sb.st_mtimespec.tv_nsec;
+	#else
+	dep->mtime = ((si8) sb.st_mtim.tv_sec * (si8) 1000000000) + (si8) sb.st_mtim.tv_nsec;
+	#endif
+	dep->size = (S_ISDIR(sb.st_mode)) ? 0 : (si8) sb.st_size;
+#endif
+#ifdef WINDOWS_m12
+	if (_stat64(path, &sb) != 0) {
+		dep->mtime = dep->size = MANIFEST_NO_FILE;
+		return(FALSE_m12);
+	}
+	dep->mtime = (si8) sb.st_mtime * (si8) 1000000000;
+	dep->size = (sb.st_mode & _S_IFDIR) ? 0 : (si8) sb.st_size;
+#endif
+
+	return(TRUE_m12);
+}
+
+
+// reads the time series indices of the channel's mapped segments not yet read (index files only, sample data is not read)
+TERN_m12	read_segment_indices(CHANNEL_m12 *chan)
+{
+	si1		path[FULL_FILE_NAME_BYTES_m12];
+	si4		j, seg_idx, n_segs;
+	SEGMENT_m12	*seg;
+
+
+	if (chan->segments == NULL)
+		return(FALSE_m12);
+
+	n_segs = TIME_SLICE_SEGMENT_COUNT_m12(&chan->time_slice);
+	seg_idx = G_get_segment_index_m12(chan->time_slice.start_segment_number);
+	for (j = 0; j < n_segs; ++j) {
+		seg = chan->segments[seg_idx + j];
+		if (seg == NULL || seg->time_series_indices_fps != NULL)
+			continue;
+		sprintf_m12(path, "%s/%s.%s", seg->path, seg->name, TIME_SERIES_INDICES_FILE_TYPE_STRING_m12);
+		seg->time_series_indices_fps = G_read_file_m12(NULL, path, 0, 0, FPS_FULL_FILE_m12, (LEVEL_HEADER_m12 *) seg, NULL, USE_GLOBAL_BEHAVIOR_m12);
+		if (seg->time_series_indices_fps == NULL)
+			return(FALSE_m12);
+	}
+
+	return(TRUE_m12);
+}
+
+
+// builds session contigua from the reference channel's time series indices (negative file offsets mark discontinuities), returns number of contigua
+// NOTE: this assumes all discontinuities are session wide, which is not required by MED
+si8	index_contigua(SESSION_m12 *sess, CONTIGUON_m12 **contigua)
+{
+	si4					i, seg_idx, n_segs;
+	si8					j, n_blocks, n_contigs, abs_start_samp, end_samp, end_time;
+	CHANNEL_m12				*chan;
+	SEGMENT_m12				*seg;
+	TIME_SERIES_INDEX_m12			*tsi;
+	TIME_SERIES_METADATA_SECTION_2_m12	*tmd2;
+	CONTIGUON_m12				*contigs;
+
+
+	*contigua = NULL;
+	chan = globals_m12->reference_channel;
+	n_segs = TIME_SLICE_SEGMENT_COUNT_m12(&chan->time_slice);
+	seg_idx = G_get_segment_index_m12(chan->time_slice.start_segment_number);
+
+	// count contigua
+	for (i = 0, n_contigs = 1; i < n_segs; ++i) {
+		seg = chan->segments[seg_idx + i];
+		if (seg == NULL || seg->metadata_fps == NULL || seg->time_series_indices_fps == NULL)
+			return(0);
+		tsi = seg->time_series_indices_fps->time_series_indices;
+		n_blocks = seg->metadata_fps->metadata->time_series_section_2.number_of_blocks;
+		for (j = (i == 0) ? 1 : 0; j < n_blocks; ++j)
+			if (tsi[j].file_offset < 0)
+				++n_contigs;
+	}
+	contigs = (CONTIGUON_m12 *) calloc_m12((size_t) n_contigs, sizeof(CONTIGUON_m12), __FUNCTION__, USE_GLOBAL_BEHAVIOR_m12);
+
+	// fill contigua (block end times from sample counts, as medlib does)
+	end_samp = end_time = 0;
+	for (i = 0, n_contigs = 0; i < n_segs; ++i) {
+		seg = chan->segments[seg_idx + i];
+		tsi = seg->time_series_indices_fps->time_series_indices;
+		tmd2 = &seg->metadata_fps->metadata->time_series_section_2;
+		n_blocks = tmd2->number_of_blocks;
+		abs_start_samp = tmd2->absolute_start_sample_number;
+		for (j = 0; j < n_blocks; ++j) {
+			if (n_contigs == 0 || tsi[j].file_offset < 0) {
+				if (n_contigs) {
+					contigs[n_contigs - 1].end_sample_number = end_samp;
+					contigs[n_contigs - 1].end_time = end_time;
+				}
+				contigs[n_contigs].start_sample_number = abs_start_samp + tsi[j].start_sample_number;
+				contigs[n_contigs].start_time = tsi[j].start_time;
+				++n_contigs;
+			}
+			end_samp = (abs_start_samp + tsi[j + 1].start_sample_number) - 1;  // terminal index follows last block
+			end_time = tsi[j].start_time + (si8) round(((sf8) (tsi[j + 1].start_sample_number - tsi[j].start_sample_number) * (sf8) 1e6) / tmd2->sampling_frequency) - 1;
+		}
+	}
+	if (n_contigs == 0) {
+		free_m12((void *) contigs, __FUNCTION__);
+		return(0);
+	}
+	contigs[n_contigs - 1].end_sample_number = end_samp;
+	contigs[n_contigs - 1].end_time = end_time;
+	*contigua = contigs;
+
+	return(n_contigs);
+}
+
+
+si4	compare_manifest_records(const void *a, const void *b)
+{
+	si8	a_time, b_time;
+
+
+	a_time = ((MANIFEST_RECORD *) a)->start_time;
+	b_time = ((MANIFEST_RECORD *) b)->start_time;
+	if (a_time > b_time)
+		return(1);
+	if (a_time < b_time)
+		return(-1);
+
+	return(0);
+}
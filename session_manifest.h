@@ -0,0 +1,90 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+#ifndef SESSION_MANIFEST_IN
+#define SESSION_MANIFEST_IN
+
+// Includes
+#include "medlib_m12.h"
+#include "record_journal.h"
+
+// Miscellaneous
+#define MANIFEST_MAGIC			((ui8) 0x46494E414D44454D)	// "MEDMANIF" (little endian)
+#define MANIFEST_VERSION		((ui4) 2)			// increment when any manifest structure changes
+#define MANIFEST_FILE_SUFFIX		"manifest"			// sidecar: <session directory>.manifest
+#define MANIFEST_PATH_BYTES		256				// dependency paths (relative to session directory)
+#define MANIFEST_NO_FILE		((si8) -1)			// dependency size & mtime of a file that did not exist
+
+// Session Manifest File Structures (all sections 8 byte aligned)
+typedef struct {
+	ui8			magic;
+	ui4			version;
+	ui4			header_bytes;
+	si8			file_bytes;
+	si8			session_start_time, session_end_time;
+	si4			number_of_channels;
+	si4			number_of_segments;  // segments of the reference channel
+	si8			number_of_contigua;
+	si8			number_of_records;
+	si8			number_of_dependencies;
+	si8			channels_offset, contigua_offset, records_offset, dependencies_offset;  // bytes from file start
+	TERN_m12		frequencies_vary;
+	si1			pad[7];
+} MANIFEST_HEADER;
+
+typedef struct {
+	si1			name[BASE_FILE_NAME_BYTES_m12];
+	sf8			sampling_frequency;  // FREQUENCY_NO_ENTRY_m12: channel was not open when manifest was written
+	si8			number_of_samples;  // SAMPLE_NUMBER_NO_ENTRY_m12: channel was not open when manifest was written
+} MANIFEST_CHANNEL;
+
+typedef struct {  // reference channel (discontinuities are assumed to be session wide)
+	si8			start_time, end_time;
+	si8			start_sample_number, end_sample_number;
+} MANIFEST_CONTIGUON;
+
+typedef struct {  // session & segmented session records, sorted by time (terminal indices excluded)
+	si8			start_time;
+	ui4			type_code;
+	si4			segment_number;  // 0: session level records
+} MANIFEST_RECORD;
+
+typedef struct {  // files & directories whose changes invalidate the manifest
+	si1			path[MANIFEST_PATH_BYTES];  // "" is the session directory
+	si8			mtime;  // nanoseconds (seconds resolution on some file systems)
+	si8			size;
+} MANIFEST_DEPENDENCY;
+
+// Loaded Manifest (sections point into the mapped file, or into built contents)
+typedef struct {
+	MANIFEST_HEADER		*header;
+	MANIFEST_CHANNEL	*channels;
+	MANIFEST_CONTIGUON	*contigua;
+	MANIFEST_RECORD		*records;
+	MANIFEST_DEPENDENCY	*dependencies;
+	void			*map;  // mapped file, or built contents (allocated)
+	si8			map_bytes;
+	TERN_m12		mapped;
+#ifdef WINDOWS_m12
+	HANDLE			file_handle, map_handle;
+#endif
+} SESSION_MANIFEST;
+
+
+// Prototypes
+SESSION_MANIFEST	*load_session_manifest(si1 *sess_path);
+ui1			*build_session_manifest(SESSION_m12 *sess);
+TERN_m12		save_session_manifest(si1 *sess_path, ui1 *buf);
+TERN_m12		write_session_manifest(SESSION_m12 *sess);
+TERN_m12		attach_session_manifest(SESSION_MANIFEST *sm);
+void			free_session_manifest(SESSION_MANIFEST *sm);
+si8			manifest_contigua(SESSION_MANIFEST *sm, CONTIGUON_m12 **contigua);
+TERN_m12		manifest_session_path(void *file_list, si4 n_files, si1 *sess_path);
+void			manifest_file_name(si1 *sess_path, si1 *manifest_file);
+TERN_m12		stamp_dependency(si1 *sess_path, MANIFEST_DEPENDENCY *dep);
+TERN_m12		read_segment_indices(CHANNEL_m12 *chan);
+si8			index_contigua(SESSION_m12 *sess, CONTIGUON_m12 **contigua);
+si4			compare_manifest_records(const void *a, const void *b);
+
+
+#endif /* SESSION_MANIFEST_IN */
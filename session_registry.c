@@ -0,0 +1,272 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Session registry
+// Keeps several sessions open between mex calls, identified by integer handles, so alternating between sessions does not reopen them.
+// Each session has its own medlib globals, so everything medlib keeps about an open session survives while others are current: switching sessions
+// installs the other session's globals pointer (no fields are copied). Idle globals are installed while no session is current.
+// A session that was closed or evicted can be reopened under its old handle, so callers holding a handle need not know it was evicted.
+// Sessions beyond REGISTRY_MAX_SESSIONS, or beyond REGISTRY_BYTE_BUDGET (estimated), are freed least recently used first.
+// NOTE: the free function passed to initialize_registry() frees the session & its client data, & is called with the session's globals installed.
+
+
+#include "session_registry.h"
+
+// Globals
+static REGISTRY_ENTRY		**registry = NULL;
+static si4			n_registry_entries = 0, next_handle = 1;
+static REGISTRY_ENTRY		*current_entry = NULL;
+static ui8			registry_clock = 0;
+static void			(*free_entry)(REGISTRY_ENTRY *entry) = NULL;
+static GLOBALS_m12		*idle_globals = NULL;  // installed while no session is current (a session opened in them takes them over)
+
+
+// call after medlib is initialized, & before any session is opened
+void	initialize_registry(void (*free_entry_f)(REGISTRY_ENTRY *entry))
+{
+	free_entry = free_entry_f;
+	idle_globals = globals_m12;
+
+	return;
+}
+
+
+// returns entry for handle (REGISTRY_NO_HANDLE: the current entry), made current, or NULL if no such session
+REGISTRY_ENTRY	*get_registry_entry(si4 handle)
+{
+	si4		i;
+	REGISTRY_ENTRY	*entry;
+
+
+	if (handle == REGISTRY_NO_HANDLE) {
+		entry = current_entry;
+	} else {
+		for (i = 0, entry = NULL; i < n_registry_entries; ++i) {
+			if (registry[i]->handle == handle) {
+				entry = registry[i];
+				break;
+			}
+		}
+	}
+	if (entry == NULL)
+		return(NULL);
+
+	if (entry != current_entry) {
+		globals_m12 = entry->globals;  // current session's globals stay with its entry
+		current_entry = entry;
+	}
+	entry->last_use = ++registry_clock;
+
+	return(entry);
+}
+
+
+// returns first entry for which match_f() returns TRUE_m12, made current, or NULL if none matches (lets gateways key sessions by e.g. path)
+REGISTRY_ENTRY	*find_registry_entry(TERN_m12 (*match_f)(REGISTRY_ENTRY *entry, void *arg), void *arg)
+{
+	si4		i;
+
+
+	for (i = 0; i < n_registry_entries; ++i)
+		if ((*match_f)(registry[i], arg) == TRUE_m12)
+			return(get_registry_entry(registry[i]->handle));
+
+	return(NULL);
+}
+
+
+// leaves no session current, & installs new globals to open a session in (call before opening a session)
+void	suspend_current_session(void)
+{
+	if (current_entry == NULL && idle_globals != NULL) {  // may hold a failed open's state
+		globals_m12 = idle_globals;
+		G_free_globals_m12(FALSE_m12);
+	}
+	current_entry = NULL;
+	idle_globals = new_session_globals();
+
+	return;
+}
+
+
+// adds a newly opened session (its globals are the current globals) & makes it current, returns entry
+// handle: REGISTRY_NO_HANDLE assigns a new handle, otherwise the session is registered under the passed handle (reopened after close or eviction)
+REGISTRY_ENTRY	*register_session(SESSION_m12 *sess, void *client_data, si4 handle)
+{
+	REGISTRY_ENTRY	*entry;
+
+
+	entry = (REGISTRY_ENTRY *) calloc((size_t) 1, sizeof(REGISTRY_ENTRY));
+	if (handle == REGISTRY_NO_HANDLE)
+		handle = next_handle++;
+	else if (handle >= next_handle)
+		next_handle = handle + 1;
+	entry->handle = handle;
+	entry->sess = sess;
+	entry->client_data = client_data;
+	entry->globals = globals_m12;  // session was opened in the idle globals (suspended by caller)
+	if (globals_m12 == idle_globals)
+		idle_globals = NULL;
+	entry->bytes = estimate_session_bytes(sess);
+	entry->last_use = ++registry_clock;
+	registry = (REGISTRY_ENTRY **) realloc((void *) registry, (size_t) (n_registry_entries + 1) * sizeof(REGISTRY_ENTRY *));
+	registry[n_registry_entries++] = entry;
+	current_entry = entry;
+	evict_sessions();
+
+	return(entry);
+}
+
+
+// frees session (with its own globals installed) & its globals, & removes it from the registry
+void	unregister_session(REGISTRY_ENTRY *entry)
+{
+	si4		i;
+	REGISTRY_ENTRY	*resume_entry;
+
+
+	for (i = 0; i < n_registry_entries; ++i)
+		if (registry[i] == entry)
+			break;
+	if (i == n_registry_entries)
+		return;
+	registry[i] = registry[--n_registry_entries];
+
+	// switch to session's globals
+	resume_entry = (entry == current_entry) ? NULL : current_entry;
+	globals_m12 = entry->globals;
+	current_entry = NULL;
+	if (free_entry != NULL)
+		(*free_entry)(entry);
+	G_free_globals_m12(FALSE_m12);
+	free((void *) entry);
+
+	// switch back
+	if (resume_entry == NULL) {
+		install_idle_globals();
+	} else {
+		globals_m12 = resume_entry->globals;
+		current_entry = resume_entry;
+	}
+
+	return;
+}
+
+
+// re-estimates entry's footprint after a read (client_bytes: gateway buffers held between calls), & frees sessions over budget
+void	update_session_bytes(REGISTRY_ENTRY *entry, si8 client_bytes)
+{
+	entry->bytes = estimate_session_bytes(entry->sess) + client_bytes;
+	evict_sessions();
+
+	return;
+}
+
+
+// estimates memory held by an open session: segment structures, metadata, time series indices, & each channel's decompression buffers
+// NOTE: medlib does not report allocations per session, so this counts the dominant structures only
+si8	estimate_session_bytes(SESSION_m12 *sess)
+{
+	si4					i, j, n_segs;
+	si8					bytes, max_block_bytes, max_block_samps;
+	CHANNEL_m12				*chan;
+	SEGMENT_m12				*seg;
+	TIME_SERIES_METADATA_SECTION_2_m12	*tmd2;
+
+
+	if (sess == NULL)
+		return(0);
+
+	n_segs = globals_m12->number_of_session_segments;
+	bytes = sizeof(SESSION_m12);
+	for (i = 0; i < sess->number_of_time_series_channels; ++i) {
+		chan = sess->time_series_channels[i];
+		bytes += sizeof(CHANNEL_m12);
+		if (chan->segments == NULL)
+			continue;
+		max_block_bytes = max_block_samps = 0;
+		for (j = 0; j < n_segs; ++j) {
+			seg = chan->segments[j];
+			if (seg == NULL)
+				continue;
+			bytes += sizeof(SEGMENT_m12);
+			if (seg->metadata_fps == NULL)
+				continue;
+			bytes += sizeof(FILE_PROCESSING_STRUCT_m12) + sizeof(METADATA_m12);
+			tmd2 = &seg->metadata_fps->metadata->time_series_section_2;
+			if (seg->time_series_indices_fps != NULL)
+				bytes += sizeof(FILE_PROCESSING_STRUCT_m12) + ((tmd2->number_of_blocks + 1) * (si8) sizeof(TIME_SERIES_INDEX_m12));
+			if (tmd2->maximum_block_bytes > max_block_bytes)
+				max_block_bytes = tmd2->maximum_block_bytes;
+			if (tmd2->maximum_block_samples > max_block_samps)
+				max_block_samps = tmd2->maximum_block_samples;
+		}
+		bytes += max_block_bytes + (max_block_samps * (si8) sizeof(si4));  // cached decompression buffers
+	}
+
+	return(bytes);
+}
+
+
+// frees least recently used sessions (not the current one) while over the session or byte limits, returns number freed
+si4	evict_sessions(void)
+{
+	si4		i, n_freed;
+	si8		total_bytes;
+	REGISTRY_ENTRY	*lru;
+
+
+	n_freed = 0;
+	while (n_registry_entries > 1) {
+		total_bytes = 0;
+		lru = NULL;
+		for (i = 0; i < n_registry_entries; ++i) {
+			total_bytes += registry[i]->bytes;
+			if (registry[i] == current_entry)
+				continue;
+			if (lru == NULL || registry[i]->last_use < lru->last_use)
+				lru = registry[i];
+		}
+		if (lru == NULL || (n_registry_entries <= REGISTRY_MAX_SESSIONS && total_bytes <= REGISTRY_BYTE_BUDGET))
+			break;
+		unregister_session(lru);
+		++n_freed;
+	}
+
+	return(n_freed);
+}
+
+
+void	free_registry(void)
+{
+	while (n_registry_entries)
+		unregister_session(registry[n_registry_entries - 1]);
+	if (registry != NULL)
+		free((void *) registry);
+	registry = NULL;
+	current_entry = NULL;
+
+	return;
+}
+
+
+// returns new medlib globals, installed as globals_m12 (the previously installed globals are left to their owner)
+GLOBALS_m12	*new_session_globals(void)
+{
+	globals_m12 = NULL;
+	G_initialize_medlib_m12(FALSE_m12, FALSE_m12);
+
+	return(globals_m12);
+}
+
+
+void	install_idle_globals(void)
+{
+	if (idle_globals == NULL)
+		idle_globals = new_session_globals();
+	else
+		globals_m12 = idle_globals;
+
+	return;
+}
+
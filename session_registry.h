@@ -0,0 +1,43 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+#ifndef SESSION_REGISTRY_IN
+#define SESSION_REGISTRY_IN
+
+// Includes
+#include "medlib_m12.h"
+#include "prefetch.h"
+
+// Miscellaneous
+#define REGISTRY_NO_HANDLE		0
+#define REGISTRY_MAX_SESSIONS		16
+#define REGISTRY_BYTE_BUDGET		((si8) 1 << 32)	// least recently used sessions beyond this are freed (the current session is kept)
+
+// Session Registry Structures
+typedef struct {
+	si4			handle;
+	SESSION_m12		*sess;
+	void			*client_data;  // gateway state tied to the session (e.g. matrix_MED's data matrix)
+	PAGE_PREDICTOR		page_predictor;
+	si8			bytes;  // estimated
+	ui8			last_use;
+	GLOBALS_m12		*globals;  // session's own medlib globals (installed as globals_m12 while the session is current)
+} REGISTRY_ENTRY;
+
+
+// Prototypes
+void			initialize_registry(void (*free_entry_f)(REGISTRY_ENTRY *entry));
+REGISTRY_ENTRY		*get_registry_entry(si4 handle);
+REGISTRY_ENTRY		*find_registry_entry(TERN_m12 (*match_f)(REGISTRY_ENTRY *entry, void *arg), void *arg);
+void			suspend_current_session(void);
+REGISTRY_ENTRY		*register_session(SESSION_m12 *sess, void *client_data, si4 handle);
+void			unregister_session(REGISTRY_ENTRY *entry);
+void			update_session_bytes(REGISTRY_ENTRY *entry, si8 client_bytes);
+si8			estimate_session_bytes(SESSION_m12 *sess);
+si4			evict_sessions(void);
+void			free_registry(void);
+GLOBALS_m12		*new_session_globals(void);
+void			install_idle_globals(void);
+
+
+#endif /* SESSION_REGISTRY_IN */
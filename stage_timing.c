@@ -0,0 +1,186 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Stage timing
+// Gateways time the stages of a call (session read, metadata, records, decoding ...) when the caller asks for timing, so slow calls can be profiled
+// in production without a profiler build. Stages are timed by the calling thread: wall time, & CPU time of all the process's threads (worker threads included).
+// A stage begun more than once in a call accumulates. When timing is not enabled, every function returns without reading a clock.
+
+
+#include "stage_timing.h"
+
+#ifndef WINDOWS_m12
+	#include <time.h>
+#endif
+
+
+void	initialize_stage_timing(STAGE_TIMING *st, TERN_m12 enabled)
+{
+	memset((void *) st, 0, sizeof(STAGE_TIMING));
+	st->enabled = enabled;
+	if (enabled == TRUE_m12) {
+		st->start_wall = wall_seconds();
+		st->start_cpu = cpu_seconds();
+	}
+
+	return;
+}
+
+
+// ends current stage (if any), & starts timing the named stage
+void	begin_stage(STAGE_TIMING *st, const si1 *name)
+{
+	si4	i;
+
+
+	if (st->enabled != TRUE_m12)
+		return;
+
+	end_stage(st);
+	for (i = 0; i < st->n_stages; ++i)
+		if (strcmp(st->stages[i].name, name) == 0)
+			break;
+	if (i == st->n_stages) {
+		if (st->n_stages == TIMING_MAX_STAGES)
+			return;
+		st->stages[i].name = name;
+		st->stages[i].wall = st->stages[i].cpu = (sf8) 0.0;
+		++st->n_stages;
+	}
+	st->current = st->stages + i;
+	st->stage_wall = wall_seconds();
+	st->stage_cpu = cpu_seconds();
+
+	return;
+}
+
+
+void	end_stage(STAGE_TIMING *st)
+{
+	if (st->enabled != TRUE_m12 || st->current == NULL)
+		return;
+
+	st->current->wall += wall_seconds() - st->stage_wall;
+	st->current->cpu += cpu_seconds() - st->stage_cpu;
+	st->current = NULL;
+
+	return;
+}
+
+
+// ends current stage, & sets call totals (time outside the named stages is included)
+void	finish_stage_timing(STAGE_TIMING *st)
+{
+	if (st->enabled != TRUE_m12)
+		return;
+
+	end_stage(st);
+	st->wall = wall_seconds() - st->start_wall;
+	st->cpu = cpu_seconds() - st->start_cpu;
+
+	return;
+}
+
+
+// monotonic seconds (arbitrary origin)
+sf8	wall_seconds(void)
+{
+#ifdef WINDOWS_m12
+	LARGE_INTEGER	count, freq;
+	
+	
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&freq);
+	
+	return((sf8) count.QuadPart / (sf8) freq.QuadPart);
+#else
+	struct timespec	ts;
+	
+	
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	
+	return((sf8) ts.tv_sec + ((sf8) ts.tv_nsec / (sf8) 1e9));
+#endif
+}
+
+
+// CPU seconds used by all threads of the process
+sf8	cpu_seconds(void)
+{
+#ifdef WINDOWS_m12
+	FILETIME	creation, exit, kernel, user;
+	ULARGE_INTEGER	k, u;
+	
+	
+	GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+	k.LowPart = kernel.dwLowDateTime;
+	k.HighPart = kernel.dwHighDateTime;
+	u.LowPart = user.dwLowDateTime;
+	u.HighPart = user.dwHighDateTime;
+	
+	return((sf8) (k.QuadPart + u.QuadPart) / (sf8) 1e7);  // 100 ns units
+#else
+	struct timespec	ts;
+	
+	
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	
+	return((sf8) ts.tv_sec + ((sf8) ts.tv_nsec / (sf8) 1e9));
+#endif
+}
+
+
+// counts compressed bytes & blocks spanned by the sliced segments of the session's active channels
+// for gateways that decode inside medlib (bytes_read & blocks_decoded are the slice's, not counted as decoded)
+void	count_slice_blocks(SESSION_m12 *sess, si8 *bytes, si8 *blocks)
+{
+	si4			i, j, seg_idx, n_segs;
+	si8			n_blocks, start_samp, end_samp, lo, hi, mid, start_block, end_block;
+	CHANNEL_m12		*chan;
+	SEGMENT_m12		*seg;
+	TIME_SERIES_INDEX_m12	*tsi;
+
+
+	*bytes = *blocks = 0;
+	for (i = 0; i < sess->number_of_time_series_channels; ++i) {
+		chan = sess->time_series_channels[i];
+		if ((chan->flags & LH_CHANNEL_ACTIVE_m12) == 0 || chan->segments == NULL)
+			continue;
+		n_segs = TIME_SLICE_SEGMENT_COUNT_m12(&chan->time_slice);
+		seg_idx = G_get_segment_index_m12(chan->time_slice.start_segment_number);
+		for (j = 0; j < n_segs; ++j) {
+			seg = chan->segments[seg_idx + j];
+			if (seg == NULL || seg->metadata_fps == NULL || seg->time_series_indices_fps == NULL)
+				continue;
+			tsi = seg->time_series_indices_fps->time_series_indices;
+			n_blocks = seg->metadata_fps->metadata->time_series_section_2.number_of_blocks;
+			if (n_blocks <= 0)
+				continue;
+			start_samp = seg->time_slice.start_sample_number - seg->metadata_fps->metadata->time_series_section_2.absolute_start_sample_number;
+			end_samp = seg->time_slice.end_sample_number - seg->metadata_fps->metadata->time_series_section_2.absolute_start_sample_number;
+
+			// blocks containing start & end samples (binary search)
+			for (lo = 0, hi = n_blocks - 1; lo < hi;) {
+				mid = (lo + hi + 1) >> 1;
+				if (tsi[mid].start_sample_number <= start_samp)
+					lo = mid;
+				else
+					hi = mid - 1;
+			}
+			start_block = lo;
+			for (hi = n_blocks - 1; lo < hi;) {
+				mid = (lo + hi + 1) >> 1;
+				if (tsi[mid].start_sample_number <= end_samp)
+					lo = mid;
+				else
+					hi = mid - 1;
+			}
+			end_block = lo;
+
+			*blocks += (end_block - start_block) + 1;
+			*bytes += REMOVE_DISCONTINUITY_m12(tsi[end_block + 1].file_offset) - REMOVE_DISCONTINUITY_m12(tsi[start_block].file_offset);
+		}
+	}
+
+	return;
+}
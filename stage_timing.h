@@ -0,0 +1,84 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+#ifndef STAGE_TIMING_IN
+#define STAGE_TIMING_IN
+
+// Includes
+#include "medlib_m12.h"
+
+// Miscellaneous
+#define TIMING_MAX_STAGES	16
+
+// Matlab Timing Structure (same layout in every gateway that returns it)
+#define NUMBER_OF_TIMING_FIELDS_mat		6
+#define TIMING_FIELD_NAMES_mat { \
+	"wall", \
+	"cpu", \
+	"stages", \
+	"channels", \
+	"bytes_read", \
+	"blocks_decoded" \
+}
+#define TIMING_FIELDS_WALL_IDX_mat		0
+#define TIMING_FIELDS_CPU_IDX_mat		1
+#define TIMING_FIELDS_STAGES_IDX_mat		2
+#define TIMING_FIELDS_CHANNELS_IDX_mat		3
+#define TIMING_FIELDS_BYTES_READ_IDX_mat	4
+#define TIMING_FIELDS_BLOCKS_DECODED_IDX_mat	5
+
+// Matlab Timing Stage Structure
+#define NUMBER_OF_TIMING_STAGE_FIELDS_mat	3
+#define TIMING_STAGE_FIELD_NAMES_mat { \
+	"name", \
+	"wall", \
+	"cpu" \
+}
+#define TIMING_STAGE_FIELDS_NAME_IDX_mat	0
+#define TIMING_STAGE_FIELDS_WALL_IDX_mat	1
+#define TIMING_STAGE_FIELDS_CPU_IDX_mat		2
+
+// Matlab Timing Channel Structure
+#define NUMBER_OF_TIMING_CHANNEL_FIELDS_mat	5
+#define TIMING_CHANNEL_FIELD_NAMES_mat { \
+	"name", \
+	"decode", \
+	"filter", \
+	"bytes_read", \
+	"blocks_decoded" \
+}
+#define TIMING_CHANNEL_FIELDS_NAME_IDX_mat		0
+#define TIMING_CHANNEL_FIELDS_DECODE_IDX_mat		1
+#define TIMING_CHANNEL_FIELDS_FILTER_IDX_mat		2
+#define TIMING_CHANNEL_FIELDS_BYTES_READ_IDX_mat	3
+#define TIMING_CHANNEL_FIELDS_BLOCKS_DECODED_IDX_mat	4
+
+// Stage Timing Structures
+typedef struct {
+	const si1	*name;  // static string
+	sf8		wall, cpu;  // seconds (cpu: all threads of the process)
+} TIMING_STAGE;
+
+typedef struct {
+	TERN_m12	enabled;
+	si4		n_stages;
+	TIMING_STAGE	stages[TIMING_MAX_STAGES];
+	TIMING_STAGE	*current;  // stage being timed (NULL: none)
+	sf8		start_wall, start_cpu;  // call
+	sf8		stage_wall, stage_cpu;  // current stage
+	sf8		wall, cpu;  // call totals (set by finish_stage_timing())
+	si8		bytes_read, blocks_decoded;
+} STAGE_TIMING;
+
+
+// Prototypes
+void		initialize_stage_timing(STAGE_TIMING *st, TERN_m12 enabled);
+void		begin_stage(STAGE_TIMING *st, const si1 *name);
+void		end_stage(STAGE_TIMING *st);
+void		finish_stage_timing(STAGE_TIMING *st);
+sf8		wall_seconds(void);
+sf8		cpu_seconds(void);
+void		count_slice_blocks(SESSION_m12 *sess, si8 *bytes, si8 *blocks);
+
+
+#endif /* STAGE_TIMING_IN */
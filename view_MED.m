@@ -12,7 +12,7 @@ function view_MED(varargin)
 
     % ---------- Clean mex slate ----------
 
-    evalin('base', 'clear load_session matrix_MED_exec read_MED_exec add_record_exec delete_record_exec')
+    evalin('base', 'clear load_session matrix_MED_exec read_MED_exec add_record_exec delete_record_exec compact_records_exec')
 
     % ------------ GUI layout -------------
 
@@ -79,6 +79,7 @@ function view_MED(varargin)
     mps.Detrend = 1;
     mps.Contigua = 1;
     mps.ChanFreqs = 1;
+    mps.Prefetch = 1;  % build next page while current page is viewed
 
     FORWARD = 1;
     BACKWARD = 2;
@@ -595,6 +596,7 @@ function view_MED(varargin)
     mps.Ranges = false;
     mps.Records = false;
     add_record_flag = false;
+    records_journaled = false;  % record edits are journaled, & compacted into the record files on close
     calendar_time_flag = true;
     uUTC_flag = false;
     oUTC_flag = false;
@@ -2451,11 +2453,7 @@ function view_MED(varargin)
                 drawnow;
             end
             close(d);
-            mps.Persist = 2;  % close
-            [~] = matrix_MED_exec(mps);  % close to allow writing of record files by delete_record_exec()
-            mps.Persist = 4; % set back to read
-            err = delete_record_exec(chan_paths{1}, password, rec_time, rec_code);
-            clear delete_record_exec;
+            err = matrix_MED_exec(mps, 'delete_record', rec_time, rec_code);  % edits the open session's records (session stays open)
             if (err < 0)
                 set(fig, 'Pointer', 'arrow');
                 if (err == -1)
@@ -2465,6 +2463,7 @@ function view_MED(varargin)
                 end
                 return;
             else
+                records_journaled = true;
                 delete(record_lines{rec_idx}.line);
                 delete(record_lines{rec_idx}.flag);
             end
@@ -2870,11 +2869,7 @@ function view_MED(varargin)
             rec_time = page_start + round(page_duration * (data_x / data_ax_width));
    
             % add record to MED file
-            mps.Persist = 2;  % close
-            [~] = matrix_MED_exec(mps);  % close to allow writing of record files by add_record_exec()
-            mps.Persist = 4; % set back to read
-            err = add_record_exec(chan_paths{1}, password, rec_type, rec_time, rec_text, rec_enc);
-            clear add_record_exec;
+            err = matrix_MED_exec(mps, 'add_record', rec_type, rec_time, rec_text, rec_enc);  % edits the open session's records (session stays open)
             if (err < 0)
                 if (err == -1)
                     errordlg('Error adding record', 'View MED');
@@ -2889,6 +2884,7 @@ function view_MED(varargin)
                 set(fig, 'Pointer', 'arrow');
                 return;
             end
+            records_journaled = true;
 
             % add record line to session map
             new_rec_time_prop = double(rec_time - sess_start) / sess_duration;
@@ -3114,6 +3110,10 @@ function view_MED(varargin)
     function figure_close_callback(~, ~)
         mps.Persist = 2;  % close
         [~] = matrix_MED_exec(mps);  % close matrix
+        if (records_journaled == true)
+            [~] = compact_records_exec(chan_paths{1}, password);  % fold record journals into record files
+            clear compact_records_exec;
+        end
         delete(fig);
         if (isempty(rec_d) == false)
             delete(rec_d);
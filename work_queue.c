@@ -0,0 +1,196 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+// Work stealing scheduler
+// Tasks are dealt to the workers in contiguous runs (so neighboring tasks, e.g. sequential block ranges, stay on one worker).
+// A worker that runs out takes the back half of another worker's remaining run, which balances uneven channel lengths.
+
+
+#include "work_queue.h"
+
+
+si4	logical_cores(void)
+{
+	si4	n_cores;
+#ifdef WINDOWS_m12
+	SYSTEM_INFO	sys_info;
+
+
+	GetSystemInfo(&sys_info);
+	n_cores = (si4) sys_info.dwNumberOfProcessors;
+#else
+	n_cores = (si4) sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	if (n_cores < 1)
+		n_cores = 1;
+
+	return(n_cores);
+}
+
+
+// number of workers to use for n_tasks
+si4	work_queue_workers(si8 n_tasks)
+{
+	si4	n_workers;
+
+
+	n_workers = logical_cores();
+	if (n_workers > WQ_MAX_WORKERS)
+		n_workers = WQ_MAX_WORKERS;
+	if ((si8) n_workers > n_tasks)
+		n_workers = (si4) n_tasks;
+	if (n_workers < 1)
+		n_workers = 1;
+
+	return(n_workers);
+}
+
+
+// runs all tasks & returns when they have completed
+void	run_work_queue(WQ_TASK *tasks, si8 n_tasks, si4 n_workers)
+{
+	si4			i;
+	si8			j, start, end;
+	WORK_QUEUE		wq;
+	WQ_DEQUE		*dq;
+	WQ_WORKER		*workers;
+	PROC_THREAD_INFO_m12	*proc_thread_infos;
+
+
+	if (n_tasks <= 0)
+		return;
+	if (n_workers < 1)
+		n_workers = 1;
+	if ((si8) n_workers > n_tasks)
+		n_workers = (si4) n_tasks;
+
+	// single worker: run in calling thread
+	if (n_workers == 1) {
+		for (j = 0; j < n_tasks; ++j)
+			(*tasks[j].task_f)(tasks[j].arg, 0);
+		return;
+	}
+
+	// deal tasks in contiguous runs
+	wq.tasks = tasks;
+	wq.n_tasks = n_tasks;
+	wq.n_workers = n_workers;
+	wq.deques = (WQ_DEQUE *) calloc((size_t) n_workers, sizeof(WQ_DEQUE));
+	for (i = 0; i < n_workers; ++i) {
+		dq = wq.deques + i;
+		pthread_mutex_init_m12(&dq->mutex, NULL);
+		dq->task_idxs = (si8 *) malloc((size_t) n_tasks * sizeof(si8));  // room for any amount stolen
+		start = (n_tasks * (si8) i) / (si8) n_workers;
+		end = (n_tasks * (si8) (i + 1)) / (si8) n_workers;
+		for (j = start; j < end; ++j)
+			dq->task_idxs[j - start] = j;
+		dq->head = 0;
+		dq->tail = end - start;
+	}
+
+	// launch workers
+	workers = (WQ_WORKER *) malloc((size_t) n_workers * sizeof(WQ_WORKER));
+	proc_thread_infos = (PROC_THREAD_INFO_m12 *) calloc((size_t) n_workers, sizeof(PROC_THREAD_INFO_m12));
+	for (i = 0; i < n_workers; ++i) {
+		workers[i].wq = &wq;
+		workers[i].id = i;
+		proc_thread_infos[i].thread_f = work_queue_worker;
+		proc_thread_infos[i].thread_label = "work_queue_worker";
+		proc_thread_infos[i].priority = PROC_HIGH_PRIORITY_m12;
+		proc_thread_infos[i].arg = (void *) (workers + i);
+	}
+	PROC_distribute_jobs_m12(proc_thread_infos, n_workers, 0, TRUE_m12);  // no reserved cores, wait for completion
+
+	// clean up
+	for (i = 0; i < n_workers; ++i) {
+		dq = wq.deques + i;
+		pthread_mutex_destroy_m12(&dq->mutex);
+		free((void *) dq->task_idxs);
+	}
+	free((void *) wq.deques);
+	free((void *) workers);
+	free((void *) proc_thread_infos);
+
+	return;
+}
+
+
+pthread_rval_m12	work_queue_worker(void *ptr)
+{
+	si8			task_idx;
+	WQ_TASK			*task;
+	WQ_WORKER		*worker;
+	PROC_THREAD_INFO_m12	*pi;
+
+
+	pi = (PROC_THREAD_INFO_m12 *) ptr;
+	pi->status = PROC_THREAD_RUNNING_m12;  // volatile
+
+	worker = (WQ_WORKER *) pi->arg;
+	while ((task_idx = next_task(worker->wq, worker->id)) >= 0) {
+		task = worker->wq->tasks + task_idx;
+		(*task->task_f)(task->arg, worker->id);
+	}
+
+	pi->status = PROC_THREAD_FINISHED_m12;  // volatile
+
+	return((pthread_rval_m12) 0);
+}
+
+
+// returns index of next task for worker, or -1 when no work remains
+si8	next_task(WORK_QUEUE *wq, si4 id)
+{
+	si8		task_idx;
+	WQ_DEQUE	*dq;
+
+
+	dq = wq->deques + id;
+	do {
+		task_idx = -1;
+		pthread_mutex_lock_m12(&dq->mutex);
+		if (dq->head < dq->tail)
+			task_idx = dq->task_idxs[dq->head++];
+		pthread_mutex_unlock_m12(&dq->mutex);
+		if (task_idx >= 0)
+			return(task_idx);
+	} while (steal_tasks(wq, id) > 0);
+
+	return(-1);
+}
+
+
+// moves the back half of another worker's tasks to this worker, returns number moved
+// NOTE: tasks are never created while the queue runs, so one pass finding every deque empty means the work is done
+si8	steal_tasks(WORK_QUEUE *wq, si4 id)
+{
+	si4		i, victim;
+	si8		n_avail, n_stolen;
+	WQ_DEQUE	*vdq, *dq;
+
+
+	dq = wq->deques + id;
+	for (i = 1; i < wq->n_workers; ++i) {
+		victim = (id + i) % wq->n_workers;
+		vdq = wq->deques + victim;
+		n_stolen = 0;
+		pthread_mutex_lock_m12(&vdq->mutex);
+		n_avail = vdq->tail - vdq->head;
+		if (n_avail > 0) {
+			n_stolen = (n_avail + 1) >> 1;
+			vdq->tail -= n_stolen;
+			// this deque is empty, so no thief reads the entries being written
+			memcpy((void *) dq->task_idxs, (void *) (vdq->task_idxs + vdq->tail), (size_t) n_stolen * sizeof(si8));
+		}
+		pthread_mutex_unlock_m12(&vdq->mutex);
+		if (n_stolen > 0) {
+			pthread_mutex_lock_m12(&dq->mutex);
+			dq->head = 0;
+			dq->tail = n_stolen;
+			pthread_mutex_unlock_m12(&dq->mutex);
+			return(n_stolen);
+		}
+	}
+
+	return(0);
+}
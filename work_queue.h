@@ -0,0 +1,47 @@
+
+// Copyright Dark Horse Neuro Inc, 2024
+
+#ifndef WORK_QUEUE_IN
+#define WORK_QUEUE_IN
+
+// Includes
+#include "medlib_m12.h"
+
+// Miscellaneous
+#define WQ_MAX_WORKERS		256
+
+// Work Queue Structures
+typedef struct {
+	void	(*task_f)(void *arg, si4 worker_id);  // worker_id indexes per-worker resources (0 to n_workers - 1)
+	void	*arg;
+} WQ_TASK;
+
+typedef struct {
+	pthread_mutex_t_m12	mutex;
+	si8			*task_idxs;
+	si8			head, tail;  // owner takes from head, thieves take from tail
+} WQ_DEQUE;
+
+typedef struct {
+	WQ_TASK		*tasks;
+	si8		n_tasks;
+	si4		n_workers;
+	WQ_DEQUE	*deques;
+} WORK_QUEUE;
+
+typedef struct {
+	WORK_QUEUE	*wq;
+	si4		id;
+} WQ_WORKER;
+
+
+// Prototypes
+si4			logical_cores(void);
+si4			work_queue_workers(si8 n_tasks);
+void			run_work_queue(WQ_TASK *tasks, si8 n_tasks, si4 n_workers);
+pthread_rval_m12	work_queue_worker(void *ptr);
+si8			next_task(WORK_QUEUE *wq, si4 id);
+si8			steal_tasks(WORK_QUEUE *wq, si4 id);
+
+
+#endif /* WORK_QUEUE_IN */